@@ -6,7 +6,9 @@
 #include "medusa/document.hpp"
 #include "medusa/architecture.hpp"
 #include "medusa/control_flow_graph.hpp"
+#include "medusa/function_graph.hpp"
 #include "medusa/task.hpp"
+#include "medusa/signature.hpp"
 
 #include <fstream>
 #include <string>
@@ -31,17 +33,7 @@ private:
     virtual void Run(void);
 
   protected:
-    bool CreateFunction(Address const& rAddr);
-
-    /*! This method computes the size of a function.
-    * \param rFuncAddr is the function address.
-    * \param EndAddress is set by this method and contains the end of the function.
-    * \param rFunctionLength is set by this method and contains the size of the function.
-    * \param rInstructionCounter is set by this method and contains the number of instruction in the function.
-    * \param LengthThreshold is the maximum size of this function, it this value is reached, this method returns false.
-    * \return Returns true if the size of the function can be computed, otherwise it returns false.
-    */
-    bool ComputeFunctionLength(Address const& rFuncAddr, Address& rEndAddress, u16& rFunctionLength, u16& rInstructionCounter, u32 LengthThreshold) const;
+    bool CreateFunction(Address const& rAddr, bool Force = false);
 
     Document& m_rDoc;
     Address   m_Addr;
@@ -56,13 +48,47 @@ private:
     virtual std::string GetName(void) const;
     virtual void Run(void);
 
+    //! This method creates references of an instruction which is already in the document and disassembles code it leads to.
+    bool Follow(Address const& rAddr);
+
   protected:
     bool Disassemble(Address const& rAddr);
     bool DisassembleBasicBlock(Address const& rAddr, std::list<Instruction::SPType>& rBasicBlock);
     bool CreateCrossReferences(Address const& rAddr);
 
-    Architecture& m_rArch;
-    u8            m_Mode;
+    //! This method locates a reference to a banked memory area in the current bank.
+    Address ResolveReference(Address const& rAddr) const;
+
+    Architecture&           m_rArch;
+    u8                      m_Mode;
+    BankedMemoryArea const* m_pBankedMemArea; //! bank switches are only followed if the document has one
+    TBank                   m_CurBank;
+  };
+
+  class ReanalyzeTask : public MakeFunctionTask
+  {
+  public:
+    ReanalyzeTask(Document& rDoc, Address::List const& rModifiedAddresses);
+    virtual ~ReanalyzeTask(void);
+
+    virtual std::string GetName(void) const;
+    virtual void Run(void);
+
+  protected:
+    Address::List m_ModifiedAddresses;
+  };
+
+  class ResolveJumpTablesTask : public Task
+  {
+  public:
+    ResolveJumpTablesTask(Document& rDoc);
+    ~ResolveJumpTablesTask(void);
+
+    virtual std::string GetName(void) const;
+    virtual void Run(void);
+
+  protected:
+    Document& m_rDoc;
   };
 
   class DisassembleFunctionTask : public DisassembleTask
@@ -114,6 +140,20 @@ private:
     Document& m_rDoc;
   };
 
+  class ApplySignaturesTask : public Task
+  {
+  public:
+    ApplySignaturesTask(Document& rDoc, SignatureDatabase::SPType spSigDb);
+    ~ApplySignaturesTask(void);
+
+    virtual std::string GetName(void) const;
+    virtual void Run(void);
+
+  protected:
+    Document&                 m_rDoc;
+    SignatureDatabase::SPType m_spSigDb;
+  };
+
 public:
 
   Analyzer(void)
@@ -140,6 +180,12 @@ public:
   { return new DisassembleAllFunctionsTask(rDoc); }
   Task* CreateAnalyzeStackAllFunctionsTask(Document& rDoc) const
   { return new AnalyzeStackAllFunctionsTask(rDoc); }
+  Task* CreateReanalyzeTask(Document& rDoc, Address::List const& rModifiedAddresses) const
+  { return new ReanalyzeTask(rDoc, rModifiedAddresses); }
+  Task* CreateResolveJumpTablesTask(Document& rDoc) const
+  { return new ResolveJumpTablesTask(rDoc); }
+  Task* CreateApplySignaturesTask(Document& rDoc, SignatureDatabase::SPType spSigDb) const
+  { return new ApplySignaturesTask(rDoc, spSigDb); }
 
   bool MakeAsciiString(Document& rDoc, Address const& rAddr) const;
   bool MakeWindowsString(Document& rDoc, Address const& rAddr) const;
@@ -161,8 +207,18 @@ public:
     u16& rInstructionCounter,
     u32 LengthThreshold) const;
 
+  /*! This method retrieves the graph of a function from the database, or builds it if it's missing or outdated.
+   * \param rDoc contains all cells.
+   * \param rFuncAddr is the address of the function.
+   * \param rFuncGraph is set by this method.
+   * \return Returns true if the graph is available, otherwise it returns false.
+   */
+  bool GetFunctionGraph(Document const& rDoc, Address const& rFuncAddr, FunctionGraph& rFuncGraph) const;
+
   bool BuildControlFlowGraph(Document const& rDoc, std::string const& rLblName, ControlFlowGraph& rCfg) const;
   bool BuildControlFlowGraph(Document const& rDoc, Address const& rAddr,        ControlFlowGraph& rCfg) const;
+  //! This method fills rCfg with basic blocks of rFuncGraph, it returns true if the function returns.
+  bool BuildControlFlowGraph(Document const& rDoc, FunctionGraph const& rFuncGraph, ControlFlowGraph& rCfg) const;
 
   bool FormatCell(
     Document      const& rDoc,
@@ -0,0 +1,122 @@
+#ifndef MEDUSA_BATCH_HPP
+#define MEDUSA_BATCH_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/binary_stream.hpp"
+#include "medusa/document.hpp"
+#include "medusa/module.hpp"
+#include "medusa/signature.hpp"
+#include "medusa/task.hpp"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+MEDUSA_NAMESPACE_BEGIN
+
+//! BatchAnalyzer analyzes many files in one process: modules are loaded once, architectures and
+//! operating systems are shared, and a fixed number of workers analyze one whole document each.
+//! Each document is saved with its own database, so results are written as soon as it's done.
+class Medusa_EXPORT BatchAnalyzer
+{
+public:
+  enum Status
+  {
+    Analyzed,
+    Unsupported, //! no loader supports both the file and an available architecture
+    TooLarge,    //! the document would exceed the memory limit, nothing is saved
+    TimedOut,    //! the analysis was stopped, the database contains what was found
+    Cancelled,
+    Failed,
+  };
+
+  struct Result
+  {
+    Path        m_FilePath;
+    Path        m_DatabasePath;
+    Status      m_Status;
+    std::string m_LoaderName;
+    std::string m_Error;
+    u64         m_Size;      //! size of the file in bytes
+    u64         m_Footprint; //! estimated memory of the document in bytes
+    u64         m_Elapsed;   //! in ms
+  };
+  typedef std::vector<Result> ResultVector;
+
+  //! Report aggregates the results of a run, sizes are counted for every processed file.
+  struct Report
+  {
+    u32 m_FileNo;
+    u32 m_AnalyzedNo;
+    u32 m_FailedNo;
+    u64 m_Size;
+    u64 m_Elapsed; //! in ms
+
+    double GetFilesPerSecond(void) const;
+    double GetMegaBytesPerSecond(void) const;
+  };
+
+  //! This function is called by workers as soon as a document is done, calls are serialized.
+  typedef std::function<void (Result const& rResult)> ResultFunctionType;
+
+  //! Modules are loaded here, so the analyzer must be created before workers of other analyzers run.
+  BatchAnalyzer(Path const& rModPath);
+
+  bool IsReady(void) const { return m_Session.IsReady(); }
+
+  //! The first database module is used if the name is empty.
+  void SetDatabaseName(std::string const& rDatabaseName) { m_DatabaseName = rDatabaseName; }
+  //! Databases are saved next to each file if the directory is empty.
+  void SetOutputDirectory(Path const& rOutputDir)        { m_OutputDir = rOutputDir; }
+  //! All cores are used if the number of workers is 0.
+  void SetWorkerNo(u32 WorkerNo)                          { m_WorkerNo = WorkerNo; }
+  //! The limit is in bytes for each document, 0 means no limit.
+  void SetMemoryLimit(u64 MemoryLimit)                    { m_MemoryLimit = MemoryLimit; }
+  //! The timeout is in seconds for each document, 0 means no timeout.
+  void SetTimeout(u32 Timeout)                            { m_Timeout = Timeout; }
+  //! Loaders which support it analyze documents by windows with this budget in bytes (see StreamAnalyzer), 0 disables it.
+  void SetStreamingBudget(u64 StreamingBudget)            { m_StreamingBudget = StreamingBudget; }
+
+  //! This method loads signatures once, they're matched against every document.
+  bool SetSignatures(Path const& rSignaturePath);
+
+  /*! This method analyzes files and returns once they're all done.
+   * \param rResults is filled in the order of rFilePaths.
+   * \param OnResult is called for each file in the order they're done.
+   */
+  Report Run(std::vector<Path> const& rFilePaths, ResultVector& rResults, ResultFunctionType OnResult = nullptr);
+
+  //! This method can be called from any thread, running documents are stopped and others are skipped.
+  void Cancel(void);
+
+  static char const* GetStatusName(Status ResultStatus);
+
+  //! This method estimates the memory of a mapped document: the stream plus a cell slot per mapped byte.
+  static u64 EstimateFootprint(Document const& rDoc, BinaryStream const& rBinStrm);
+
+private:
+  void _Analyze(Path const& rFilePath, std::string const& rDatabaseName, Path const& rDatabasePath, Result& rResult);
+
+  BatchSession              m_Session;
+  std::string               m_DatabaseName;
+  Path                      m_OutputDir;
+  u32                       m_WorkerNo;
+  u64                       m_MemoryLimit;
+  u32                       m_Timeout;
+  u64                       m_StreamingBudget;
+  SignatureDatabase::SPType m_spSigDb;
+
+  typedef std::mutex MutexType;
+  MutexType                           m_Mutex;
+  std::atomic<bool>                   m_Cancelled;
+  std::set<CancellationToken::SPType> m_RunningTokens; //! tokens of running documents, for Cancel
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_BATCH_HPP
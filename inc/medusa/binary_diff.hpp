@@ -0,0 +1,78 @@
+#ifndef MEDUSA_BINARY_DIFF_HPP
+#define MEDUSA_BINARY_DIFF_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+#include "medusa/document.hpp"
+#include "medusa/fingerprint.hpp"
+
+#include <map>
+#include <vector>
+#include <ostream>
+
+MEDUSA_NAMESPACE_BEGIN
+
+//! BinaryDiff matches the functions of two documents (e.g. two versions of a binary).
+class Medusa_EXPORT BinaryDiff
+{
+public:
+  enum MatchType
+  {
+    ExactMatch,      //! Both functions have the same normalized instructions
+    StructuralMatch, //! Both functions have a similar control flow graph
+    CallGraphMatch,  //! Both functions are called at the same place by matched functions
+  };
+
+  struct Match
+  {
+    Address   m_OldAddress;
+    Address   m_NewAddress;
+    double    m_Similarity;
+    MatchType m_Type;
+  };
+
+  typedef std::vector<Match> MatchList;
+
+  BinaryDiff(Document& rOldDoc, Document& rNewDoc);
+
+  //! Functions are matched structurally only if their similarity is above this threshold.
+  void SetStructuralThreshold(double Threshold) { m_StructThreshold = Threshold; }
+  //! Callees of matched functions are matched if their similarity is above this threshold.
+  void SetCallGraphThreshold(double Threshold)  { m_CallGraphThreshold = Threshold; }
+
+  /*! This method computes fingerprints of both documents and matches their functions.
+   * Fingerprints are kept in databases, so only modified functions are fingerprinted again.
+   * \return Returns false if a document doesn't contain any function.
+   */
+  bool Compute(void);
+
+  MatchList const& GetMatches(void) const { return m_Matches; }
+  Address::Vector  GetUnmatchedOldFunctions(void) const;
+  Address::Vector  GetUnmatchedNewFunctions(void) const;
+
+  //! This method writes a human readable report.
+  void Report(std::ostream& rOutput) const;
+
+private:
+  void _ComputeFingerprints(Document& rDoc, FunctionFingerprint::Map& rFingerprints) const;
+  void _MatchExact(void);
+  void _MatchStructural(void);
+  void _MatchCallGraph(void);
+  bool _AddMatch(Address const& rOldAddr, Address const& rNewAddr, double Similarity, MatchType Type);
+
+  Document&                  m_rOldDoc;
+  Document&                  m_rNewDoc;
+  FunctionFingerprint::Map   m_OldFingerprints;
+  FunctionFingerprint::Map   m_NewFingerprints;
+  std::map<Address, Address> m_OldToNew;
+  std::map<Address, Address> m_NewToOld;
+  MatchList                  m_Matches;
+  double                     m_StructThreshold;
+  double                     m_CallGraphThreshold;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_BINARY_DIFF_HPP
@@ -7,22 +7,54 @@
 #include "medusa/exception.hpp"
 #include "medusa/export.hpp"
 #include "medusa/util.hpp"
+#include "medusa/patch_overlay.hpp"
 
+#include <algorithm>
 #include <string>
 #include <cstring>
 #include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
 
 #include <boost/type_traits.hpp>
 #include <boost/filesystem/path.hpp>
 
 MEDUSA_NAMESPACE_BEGIN
 
+//! Span is a view of contiguous elements, it doesn't own them.
+template<typename T>
+class Span
+{
+public:
+  Span(void) : m_pData(nullptr), m_Size(0) {}
+  Span(T* pData, size_t Size) : m_pData(pData), m_Size(Size) {}
+
+  T*     data(void)  const { return m_pData;          }
+  size_t size(void)  const { return m_Size;           }
+  bool   empty(void) const { return m_Size == 0;      }
+  T*     begin(void) const { return m_pData;          }
+  T*     end(void)   const { return m_pData + m_Size; }
+
+  T& operator[](size_t Index) const { return m_pData[Index]; }
+
+private:
+  T*     m_pData;
+  size_t m_Size;
+};
+
 //! BinaryStream is a generic class to handle memory access.
+//! Writes never modify the original content, they're kept in a patch overlay which is applied on reads.
 class Medusa_EXPORT BinaryStream
 {
 public:
   typedef std::shared_ptr<BinaryStream> SPType;
 
+  enum
+  {
+    MaxStringLength = 0x100000, //! longer strings are considered as not terminated
+  };
+
   BinaryStream(void);
   virtual ~BinaryStream(void);
 
@@ -70,35 +102,98 @@ public:
   template<typename T, size_t N>
   bool Read(TOffset Position, T (&rData)[N]) const
   {
-    for (size_t i = 0; i < N; ++i)
-    {
-      if (Read(Position, rData[i]) == false)
-        return false;
-      Position += sizeof(T);
-    }
+    if (!Read(Position, static_cast<void*>(rData), sizeof(rData)))
+      return false;
+    if (TestEndian(m_Endianness))
+      EndianSwapArray(rData, N);
     return true;
   }
 
-  u16 StringLength(TOffset Position) const
+  /*! This method reads Count elements at once, scalars are swapped if needed.
+   * Structures are copied as is, their fields must be swapped by the caller.
+   */
+  template<typename T>
+  bool ReadArray(TOffset Position, u64 Count, std::vector<T>& rValues) const
   {
-    if (Position > m_Size)
-      return 0;
-    u16 Limit = static_cast<u16>(static_cast<u64>(m_Size) - Position); // TODO m_Size should be u64?
-    if (Limit == 0)
+    static_assert(std::is_pod<T>::value, "only plain old data can be read");
+    if (Count > m_Size / sizeof(T))
+      return false;
+    rValues.resize(static_cast<size_t>(Count));
+    if (Count == 0)
+      return true;
+    if (!Read(Position, static_cast<void*>(rValues.data()), static_cast<size_t>(Count * sizeof(T))))
+      return false;
+    if (TestEndian(m_Endianness))
+      EndianSwapArray(rValues.data(), rValues.size());
+    return true;
+  }
+
+  /*! This method returns a view of Count elements without copying them.
+   * The span is empty if the stream is not entirely mapped, if the elements are misaligned or patched,
+   * or if they're scalars which must be swapped. Structures are returned as is.
+   */
+  template<typename T>
+  Span<T const> GetSpan(TOffset Position, u64 Count) const
+  {
+    static_assert(std::is_pod<T>::value, "only plain old data can be viewed");
+    if (m_pBuffer == nullptr || Count == 0 || Count > m_Size / sizeof(T))
+      return Span<T const>();
+    if (Position + Count * sizeof(T) < Position || Position + Count * sizeof(T) > m_Size)
+      return Span<T const>();
+    if (std::is_arithmetic<T>::value && sizeof(T) != 1 && TestEndian(m_Endianness))
+      return Span<T const>();
+    if (m_spOverlay->IsPatched(m_OverlayOffset + Position, Count * sizeof(T)))
+      return Span<T const>();
+
+    u8 const* pDataPosition = reinterpret_cast<u8 const*>(m_pBuffer) + Position;
+    if (reinterpret_cast<uintptr_t>(pDataPosition) % std::alignment_of<T>::value != 0)
+      return Span<T const>();
+    return Span<T const>(reinterpret_cast<T const*>(pDataPosition), static_cast<size_t>(Count));
+  }
+
+  //! This method returns a view like GetSpan, elements are copied in rStorage only if they can't be viewed.
+  template<typename T>
+  bool ReadSpan(TOffset Position, u64 Count, Span<T const>& rSpan, std::vector<T>& rStorage) const
+  {
+    rSpan = GetSpan<T>(Position, Count);
+    if (!rSpan.empty() || Count == 0)
+      return true;
+    if (!ReadArray(Position, Count, rStorage))
+      return false;
+    rSpan = Span<T const>(rStorage.data(), rStorage.size());
+    return true;
+  }
+
+  //! This method returns the length of a null-terminated string, or 0 if it's empty or not terminated.
+  u32 StringLength(TOffset Position) const
+  {
+    if (Position >= m_Size)
       return 0;
+    u64 Limit = std::min<u64>(m_Size - Position, MaxStringLength);
+    if (m_pBuffer == nullptr)
+      return _StringLengthMapped(Position, Limit);
     char const* pDst = static_cast<char const*>(m_pBuffer) + Position;
-    u16 StrLen = static_cast<u16>(::strnlen(pDst, Limit));
-    if (pDst[StrLen] != '\0')
+    size_t StrLen = ::strnlen(pDst, static_cast<size_t>(Limit));
+    // The length only changes if the string or its terminator is patched
+    if (m_spOverlay->IsPatched(m_OverlayOffset + Position, std::min<u64>(StrLen + 1, Limit)))
+      return _StringLengthMapped(Position, Limit);
+    if (StrLen == Limit)
       return 0;
-    return StrLen;
+    return static_cast<u32>(StrLen);
   }
 
   bool Read(TOffset Position, std::string& rString) const
   {
-    u16 StrLen = StringLength(Position);
+    u32 StrLen = StringLength(Position);
     if (StrLen == 0)
       return false;
 
+    if (m_pBuffer == nullptr || m_spOverlay->IsPatched(m_OverlayOffset + Position, StrLen))
+    {
+      rString.resize(StrLen);
+      return Read(Position, &rString[0], StrLen);
+    }
+
     char const* pDst = static_cast<char const*>(m_pBuffer) + Position;
     rString.assign(pDst, StrLen);
     return true;
@@ -113,12 +208,21 @@ public:
   //! This method reads a buffer, no swap will be performed.
   bool Read(TOffset Position, u8* pData, size_t Length) const
   {
-    if (m_pBuffer == nullptr)
+    if (!ReadOriginal(Position, pData, Length))
       return false;
+    _Patch(Position, pData, Length);
+    return true;
+  }
 
+  //! This method reads a buffer without its patches, no swap will be performed.
+  bool ReadOriginal(TOffset Position, void* pData, size_t Length) const
+  {
     if (Position + Length < Position || Position + Length > m_Size)
       return false;
 
+    if (m_pBuffer == nullptr)
+      return _ReadMapped(Position, pData, Length);
+
     u8 const* pDataPosition = reinterpret_cast<u8 const*>(m_pBuffer) + Position;
     memcpy(pData, pDataPosition, Length);
     return true;
@@ -162,42 +266,50 @@ public:
     return Write(Position, static_cast<u8 const*>(pData), Length);
   }
 
+  //! This method patches a buffer, the write can be undone with the overlay.
   bool Write(TOffset Position, u8 const* pData, size_t Length)
   {
-    if (m_pBuffer == nullptr)
-      return false;
-
     if (Position + Length < Position || Position + Length > m_Size)
       return false;
 
-    u8* pDataPosition = reinterpret_cast<u8*>(m_pBuffer) + Position;
-    memcpy(pDataPosition, pData, Length);
-    return true;
+    return m_spOverlay->Write(m_OverlayOffset + Position, pData, Length);
   }
 
-  u32         GetSize(void)   const { return m_Size;    }
+  u64         GetSize(void)   const { return m_Size;    }
+  //! This method returns the original content, or nullptr if the stream is not entirely mapped.
+  //! Read must be used to get the patched content.
   void const* GetBuffer(void) const { return m_pBuffer; }
 
-  std::string const &GetSha1(void) const
-  {
-    if (m_Sha1.empty())
-      m_Sha1 = Sha1(m_pBuffer, m_Size);
-    return m_Sha1;
-  }
+  //! The overlay is shared with views of this stream, this is the position of the stream in it.
+  PatchOverlay::SPType GetOverlay(void)       const { return m_spOverlay;     }
+  TOffset              GetOverlayOffset(void) const { return m_OverlayOffset; }
+
+  //! This method saves the patched content, the original file is not modified.
+  bool Export(Path const& rFilePath) const;
+
+  //! The hash is computed on the original content.
+  std::string const &GetSha1(void) const;
 
 protected:
   template <typename DataType>
   bool ReadGeneric(TOffset Position, DataType& rData) const
   {
-    if (m_pBuffer == nullptr)
-      return false;
-
-    if (Position + sizeof(DataType) > m_Size)
+    if (Position + sizeof(DataType) < Position || Position + sizeof(DataType) > m_Size)
       return false;
 
-    u8 const* pDataPosition = reinterpret_cast<u8 const*>(m_pBuffer) + Position;
+    if (m_pBuffer == nullptr)
+    {
+      if (!_ReadMapped(Position, &rData, sizeof(DataType)))
+        return false;
+    }
+    else
+    {
+      // The data could be misaligned
+      u8 const* pDataPosition = reinterpret_cast<u8 const*>(m_pBuffer) + Position;
+      ::memcpy(&rData, pDataPosition, sizeof(DataType));
+    }
+    _Patch(Position, &rData, sizeof(DataType));
 
-    rData = *reinterpret_cast<DataType const*>(pDataPosition);
     if (TestEndian(m_Endianness))
       EndianSwap(rData);
     return true;
@@ -206,26 +318,35 @@ protected:
   template <typename DataType>
   bool WriteGeneric(TOffset Position, DataType& rData)
   {
-    if (m_pBuffer == nullptr)
+    if (Position + sizeof(DataType) < Position || Position + sizeof(DataType) > m_Size)
       return false;
 
-    if (Position + sizeof(DataType) > m_Size)
-      return false;
+    typename boost::remove_const<DataType>::type Data = rData;
+    if (TestEndian(m_Endianness))
+      EndianSwap(Data);
 
-    typename boost::remove_const<DataType>::type* pDataPosition
-      = reinterpret_cast< typename boost::remove_const<DataType>::type* >(m_pBuffer) + Position;
+    return m_spOverlay->Write(m_OverlayOffset + Position, reinterpret_cast<u8 const*>(&Data), sizeof(DataType));
+  }
 
-    *pDataPosition = rData;
-    if (TestEndian(m_Endianness))
-      EndianSwap(pDataPosition);
-    return true;
+  //! This method copies patched bytes over original ones, the lookup doesn't lock if the range isn't patched.
+  void _Patch(TOffset Position, void* pData, u64 Length) const
+  {
+    if (m_spOverlay->IsPatched(m_OverlayOffset + Position, Length))
+      m_spOverlay->Apply(m_OverlayOffset + Position, static_cast<u8*>(pData), Length);
   }
 
-  Path                m_Path;
-  void*               m_pBuffer;
-  u32                 m_Size;
-  EEndianness         m_Endianness;
-  mutable std::string m_Sha1;
+  //! This method is used when m_pBuffer is nullptr, the range is already checked.
+  virtual bool _ReadMapped(TOffset Position, void* pData, u64 Length) const;
+  //! This method reads the string by chunks, it's used when the buffer can't be scanned in place.
+  u32          _StringLengthMapped(TOffset Position, u64 Limit) const;
+
+  Path                 m_Path;
+  void*                m_pBuffer;
+  u64                  m_Size;
+  EEndianness          m_Endianness;
+  mutable std::string  m_Sha1;
+  PatchOverlay::SPType m_spOverlay;
+  TOffset              m_OverlayOffset;
 
 private:
   BinaryStream(BinaryStream const&);
@@ -233,31 +354,90 @@ private:
 };
 
 //! FileBinaryStream is a generic class for file access.
+//! Large files are mapped by windows on demand, so the used address space stays bounded.
 class Medusa_EXPORT FileBinaryStream : public BinaryStream
 {
 public:
-  FileBinaryStream(Path const& rFilePath = Path());
+  enum MappingMode
+  {
+    AutoMapping,     //! windowed mapping is used above FullMappingLimit
+    FullMapping,
+    WindowedMapping,
+  };
+
+  enum : u64
+  {
+    FullMappingLimit = 0x40000000, //! 1 GB
+    WindowSize       = 0x4000000,  //! 64 MB, it must be aligned on the mapping granularity
+    MaxWindowNo      = 8,
+  };
+
+  FileBinaryStream(Path const& rFilePath = Path(), MappingMode Mode = AutoMapping);
   virtual ~FileBinaryStream(void);
 
   void Open(boost::filesystem::path const& rFilePath);
   void Close(void);
 
+  void        SetMappingMode(MappingMode Mode) { m_Mode = Mode; }
+  MappingMode GetMappingMode(void) const       { return m_Mode; }
+  bool        IsWindowed(void) const           { return m_pBuffer == nullptr && m_Size != 0; }
+
 protected:
+  virtual bool _ReadMapped(TOffset Position, void* pData, u64 Length) const;
+
+  //! These methods are platform specific, Sequential hints the system to read ahead.
+  void* _MapView(TOffset Offset, u64 Size, bool Sequential) const;
+  void  _UnmapView(void* pView, u64 Size) const;
+  void  _UnmapAllViews(void);
+
+  struct Window
+  {
+    u64 m_Index;
+    u8* m_pView;
+    u64 m_Size;
+  };
+
   TFileHandle             m_FileHandle;
   TMapHandle              m_MapHandle;
+  MappingMode             m_Mode;
+
+  // Windows are sorted from the most recently used
+  typedef std::mutex      MutexType;
+  mutable MutexType       m_WindowMutex;
+  mutable std::vector<Window> m_Windows;
+  mutable u64             m_LastWindowIndex;
 };
 
 //! MemoryBinaryStream is similar to BinaryStream.
 class Medusa_EXPORT MemoryBinaryStream : public BinaryStream
 {
 public:
-  MemoryBinaryStream(void const* pMem = nullptr, u32 MemSize = 0);
+  MemoryBinaryStream(void const* pMem = nullptr, u64 MemSize = 0);
   virtual ~MemoryBinaryStream(void);
 
-  void Open(void const* pMem, u32 MemSize);
+  void Open(void const* pMem, u64 MemSize);
   void Close(void);
 };
 
+//! SubBinaryStream is a view of a range of another stream, e.g. a slice of a universal binary.
+//! Nothing is copied, so the parent stream must outlive the view. Both share the same patches.
+class Medusa_EXPORT SubBinaryStream : public BinaryStream
+{
+public:
+  //! The range is truncated to the end of rParent.
+  SubBinaryStream(BinaryStream const& rParent, TOffset Offset, u64 Size);
+  virtual ~SubBinaryStream(void);
+
+  BinaryStream const& GetParent(void) const { return m_rParent; }
+  TOffset             GetOffset(void) const { return m_Offset;  }
+
+protected:
+  virtual bool _ReadMapped(TOffset Position, void* pData, u64 Length) const;
+
+  BinaryStream const& m_rParent;
+  TOffset             m_Offset;
+};
+
 MEDUSA_NAMESPACE_END
 
 #endif // MEDUSA_BINARY_STREAM_HPP
\ No newline at end of file
@@ -6,18 +6,84 @@
 #include "medusa/types.hpp"
 #include "medusa/address.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <mutex>
 #include <sstream>
 #include <string>
 #include <list>
 #include <set>
+#include <vector>
 
 MEDUSA_NAMESPACE_BEGIN
 
+//! TextView refers to characters owned by someone else, it follows the interface of std::string_view.
+//! A view returned by PrintData is only valid until the next modification of it.
+class TextView
+{
+public:
+  typedef char const* const_iterator;
+  static size_t const npos = static_cast<size_t>(-1);
+
+  TextView(void)                             : m_pData(""),             m_Length(0)                  {}
+  TextView(char const* pData)                : m_pData(pData),          m_Length(std::strlen(pData)) {}
+  TextView(char const* pData, size_t Length) : m_pData(pData),          m_Length(Length)             {}
+  TextView(std::string const& rString)       : m_pData(rString.data()), m_Length(rString.length())   {}
+
+  char const*    data(void)   const { return m_pData;            }
+  size_t         size(void)   const { return m_Length;           }
+  size_t         length(void) const { return m_Length;           }
+  bool           empty(void)  const { return m_Length == 0;      }
+  const_iterator begin(void)  const { return m_pData;            }
+  const_iterator end(void)    const { return m_pData + m_Length; }
+  char operator[](size_t Index) const { return m_pData[Index];   }
+
+  TextView substr(size_t Position, size_t Length = npos) const
+  {
+    if (Position > m_Length)
+      Position = m_Length;
+    return TextView(m_pData + Position, std::min(Length, m_Length - Position));
+  }
+
+  std::string str(void) const { return std::string(m_pData, m_Length); }
+
+  bool operator==(TextView const& rText) const
+  { return m_Length == rText.m_Length && std::equal(m_pData, m_pData + m_Length, rText.m_pData); }
+  bool operator!=(TextView const& rText) const
+  { return !(*this == rText); }
+
+private:
+  char const* m_pData;
+  size_t      m_Length;
+};
+
+//! ArrayView refers to contiguous elements owned by someone else.
+template<typename Type>
+class ArrayView
+{
+public:
+  typedef Type const* const_iterator;
+
+  ArrayView(void)                            : m_pBegin(nullptr), m_pEnd(nullptr)       {}
+  ArrayView(Type const* pBegin, size_t Size) : m_pBegin(pBegin),  m_pEnd(pBegin + Size) {}
+
+  const_iterator begin(void) const { return m_pBegin;                              }
+  const_iterator end(void)   const { return m_pEnd;                                }
+  size_t         size(void)  const { return static_cast<size_t>(m_pEnd - m_pBegin); }
+  bool           empty(void) const { return m_pBegin == m_pEnd;                    }
+  Type const& operator[](size_t Index) const { return m_pBegin[Index];             }
+
+private:
+  Type const* m_pBegin;
+  Type const* m_pEnd;
+};
+
 class Mark
 {
 public:
   typedef std::list<Mark> List;
+  typedef ArrayView<Mark> View;
 
   enum Type
   {
@@ -46,15 +112,39 @@ private:
   u16 m_Length;
 };
 
+//! LineView refers to a line stored in the arenas of a PrintData or a LineCache.
+class Medusa_EXPORT LineView
+{
+public:
+  LineView(Address const& rAddress, TextView const& rText, Mark::View const& rMarks, ArrayView<u16> const& rOperandsOffset)
+    : m_Address(rAddress), m_Text(rText), m_Marks(rMarks), m_OperandsOffset(rOperandsOffset) {}
+
+  Address        const& GetAddress(void)        const { return m_Address;        }
+  TextView       const& GetText(void)           const { return m_Text;           }
+  Mark::View     const& GetMarks(void)          const { return m_Marks;          }
+  ArrayView<u16> const& GetOperandsOffset(void) const { return m_OperandsOffset; }
+
+  bool                  GetOperandNo(u16 Offset, u8& rOperandNo) const;
+
+private:
+  Address        m_Address;
+  TextView       m_Text;
+  Mark::View     m_Marks;
+  ArrayView<u16> m_OperandsOffset;
+};
+
+//! LineData owns a copy of a line, it outlives the PrintData it comes from.
 class Medusa_EXPORT LineData
 {
 public:
   LineData(Address const& rAddress = Address(), std::string const& rText = "", Mark::List const& rMarks = Mark::List(), std::set<u16> const& rOperandsOffset = std::set<u16>())
     : m_Address(rAddress), m_Text(rText), m_Marks(rMarks), m_OperandsOffset(rOperandsOffset) {}
+  explicit LineData(LineView const& rLine);
 
   Address     const& GetAddress(void)         const { return m_Address; }
   std::string const& GetText(void)            const { return m_Text; }
   Mark::List  const& GetMarks(void)           const { return m_Marks; }
+  std::set<u16> const& GetOperandsOffset(void) const { return m_OperandsOffset; }
 
   bool               GetOperandNo(u16 Offset, u8& rOperandNo) const;
 
@@ -65,6 +155,9 @@ private:
   std::set<u16> m_OperandsOffset;
 };
 
+//! PrintData stores formatted lines in flat arenas: all characters are kept in one string,
+//! marks and operand offsets in vectors, and each line only records where its parts start.
+//! Clear keeps the capacity of the arenas, so formatting again the same view doesn't allocate.
 class Medusa_EXPORT PrintData
 {
 public:
@@ -72,33 +165,39 @@ public:
 
   void PrependAddress(bool Flag) { m_PrependAddress = Flag; }
   void SetIndent(u8 Indent) { m_Indent = Indent; }
+  bool IsAddressPrepended(void) const { return m_PrependAddress; }
+  u8   GetIndent(void)          const { return m_Indent;         }
 
   PrintData& operator()(Address const& rAddress);
 
-  PrintData& AppendMnemonic (std::string const& rMnemonic)
+  PrintData& AppendMnemonic (TextView const& rMnemonic)
   { _AppendText(rMnemonic, Mark::MnemonicType);   return *this; }
-  PrintData& AppendRegister (std::string const& rRegister)
+  PrintData& AppendRegister (TextView const& rRegister)
   { _AppendText(rRegister, Mark::RegisterType);   return *this; }
-  PrintData& AppendImmediate(std::string const& rImmediate)
+  PrintData& AppendImmediate(TextView const& rImmediate)
   { _AppendText(rImmediate, Mark::ImmediateType); return *this; }
   PrintData& AppendImmediate(u64 Immediate, u32 Bits, u8 Base = 0x10);
-  PrintData& AppendLabel    (std::string const& rLabel)
+  PrintData& AppendLabel    (TextView const& rLabel)
   { _AppendText(rLabel, Mark::LabelType);         return *this; }
-  PrintData& AppendKeyword  (std::string const& rKeyword)
+  PrintData& AppendKeyword  (TextView const& rKeyword)
   { _AppendText(rKeyword, Mark::KeywordType);     return *this; }
-  PrintData& AppendOperator (std::string const& rOperator)
+  PrintData& AppendOperator (TextView const& rOperator)
   { _AppendText(rOperator, Mark::OperatorType);   return *this; }
-  PrintData& AppendCharacter(std::string const& rCharacter)
+  PrintData& AppendCharacter(TextView const& rCharacter)
   { _AppendText(rCharacter, Mark::CharacterType); return *this; }
-  PrintData& AppendString   (std::string const& rString)
+  PrintData& AppendString   (TextView const& rString)
   { _AppendText(rString, Mark::StringType);       return *this; }
-  PrintData& AppendComment  (std::string const& rComment)
+  PrintData& AppendComment  (TextView const& rComment)
   { _AppendText(rComment, Mark::CommentType);     return *this; }
 
   PrintData& AppendAddress(Address const& rAddress);
   PrintData& AppendSpace(u16 SpaceNo = 1);
   PrintData& AppendNewLine(void);
 
+  //! This method appends a line which was already formatted, e.g. by a line cache.
+  //! It must be called at the beginning of a line.
+  PrintData& AppendLine(LineView const& rLine);
+
   PrintData& MarkOffset(void);
 
   Address::List GetAddresses(void) const;
@@ -109,7 +208,8 @@ public:
   Mark::List    GetMarks(void) const;
   bool          GetLine(u16 LineNo, u16& rOffset, LineData& rLine) const;
   bool          GetLine(Address const& rAddress, u16 Offset, LineData& rLine) const;
-  std::string const& GetCurrentText(void) const { return m_CurrentText; }
+  TextView      GetCurrentText(void) const;
+  u32           GetNumberOfLines(void) const;
   u16           GetLineNo(Address const& rAddress) const;
   bool          GetLineOffset(Address const& rAddress, u16& rOffset) const;
 
@@ -123,31 +223,52 @@ public:
   u16 GetHeight(void) const
   { return m_Height; }
 
+  //! Views given to callbacks are only valid during the call.
   typedef std::function<void (
     Address const& rAddress,
-    std::string const& rText,
-    Mark::List const& rMarks)>
+    TextView const& rText,
+    Mark::View const& rMarks)>
     LineCallback;
   void ForEachLine(LineCallback Callback) const;
 
+  typedef std::function<void (LineView const& rLine)> LineViewCallback;
+  void ForEachLineView(LineViewCallback Callback, u32 FirstLine = 0) const;
+
   void Clear(void);
 
 private:
-  void _AppendText(std::string const& rText, Mark::Type MarkType);
+  struct LineRecord
+  {
+    Address m_Address;
+    u32     m_TextOffset;
+    u32     m_MarkOffset;
+    u32     m_OperandOffset;
+    u16     m_TextLength;
+    u16     m_MarkNo;
+    u16     m_OperandNo;
+  };
 
-  bool                m_PrependAddress;
+  void     _AppendText(TextView const& rText, Mark::Type MarkType);
+  void     _AppendLinePrefix(void);
+  void     _PushLine(void);
+  LineView _GetLineView(LineRecord const& rLine) const;
 
-  Address             m_CurrentAddress;
-  std::string         m_CurrentText;
-  Mark::List          m_CurrentMarks;
-  std::set<u16>       m_CurrentOperandsOffset;
-  u16                 m_CurrentCommentOffset;
+  bool                    m_PrependAddress;
 
-  std::list<LineData> m_Lines;
-  u16                 m_Width;
-  u16                 m_LineWidth;
-  u16                 m_Height;
-  u8                  m_Indent;
+  Address                 m_CurrentAddress;
+  u32                     m_CurrentTextOffset;    //! beginning of the current line in m_Texts
+  u32                     m_CurrentMarkOffset;    //! first mark of the current line in m_Marks
+  u32                     m_CurrentOperandOffset; //! first operand offset of the current line
+  u16                     m_CurrentCommentOffset;
+
+  std::string             m_Texts;
+  std::vector<Mark>       m_Marks;
+  std::vector<u16>        m_OperandsOffset;       //! relative to the beginning of their line
+  std::vector<LineRecord> m_Lines;
+  u16                     m_Width;
+  u16                     m_LineWidth;
+  u16                     m_Height;
+  u8                      m_Indent;
 
   typedef std::mutex MutexType;
   mutable MutexType m_Mutex;
@@ -155,4 +276,6 @@ private:
 
 MEDUSA_NAMESPACE_END
 
+Medusa_EXPORT std::ostream& operator<<(std::ostream& rOstrm, medusa::TextView const& rText);
+
 #endif // !MEDUSA_CELL_TEXT_HPP
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef MEDUSA_CHANGE_JOURNAL_HPP
+#define MEDUSA_CHANGE_JOURNAL_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+#include "medusa/label.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+MEDUSA_NAMESPACE_BEGIN
+
+//! ChangeJournal records modifications of a document and delivers them in batches.
+//! Recording only appends to a buffer, a worker thread delivers the buffer once the delay is
+//! elapsed, or Flush can be called at the end of a task. Modified addresses are sorted and
+//! duplicates are removed, label changes keep their order.
+class Medusa_EXPORT ChangeJournal
+{
+public:
+  enum
+  {
+    DefaultDelay = 50, //! in milliseconds, 0 delivers each change immediately
+  };
+
+  struct LabelChange
+  {
+    Address m_Address;
+    Label   m_Label;
+    bool    m_Removed;
+  };
+  typedef std::vector<LabelChange> LabelChangeVector;
+
+  //! This function receives a batch, it's called without any lock held.
+  typedef std::function<void (bool DocumentUpdated, LabelChangeVector const& rLabels, Address::List const& rAddresses)> DeliverCallbackType;
+
+  ChangeJournal(DeliverCallbackType Deliver, u32 Delay = DefaultDelay);
+  ~ChangeJournal(void);
+
+  void SetDelay(u32 Delay);
+  u32  GetDelay(void) const { return m_Delay; }
+
+  void AddDocumentUpdate(void);
+  void AddLabelUpdate(Address const& rAddress, Label const& rLabel, bool Removed);
+  void AddLabelUpdate(LabelChangeVector const& rLabels);
+  void AddAddressUpdate(Address const& rAddress);
+  void AddAddressUpdate(Address::List const& rAddresses);
+
+  //! This method delivers pending changes synchronously.
+  void Flush(void);
+
+  //! This method drops pending changes without delivering them.
+  void Clear(void);
+
+  //! This method stops the worker thread, pending changes are kept.
+  void Stop(void);
+
+  u64 GetChangeNo(void) const { return m_ChangeNo; }
+  u64 GetBatchNo(void)  const { return m_BatchNo;  }
+
+private:
+  bool _IsEmpty(void) const;
+  void _Notify(bool WasEmpty);
+  void _Run(void);
+
+  DeliverCallbackType     m_Deliver;
+  std::atomic<u32>        m_Delay;
+
+  bool                    m_DocumentUpdated;
+  LabelChangeVector       m_Labels;
+  Address::Vector         m_Addresses;
+
+  std::atomic<u64>        m_ChangeNo; //! number of recorded changes
+  std::atomic<u64>        m_BatchNo;  //! number of delivered batches
+  u64                     m_TakenNo;  //! number of batches taken from the journal, guarded by m_Mutex
+
+  bool                    m_Running;
+  std::thread             m_Thread;
+  std::condition_variable m_CondVar;
+
+  typedef std::mutex MutexType;
+  mutable MutexType       m_Mutex;
+
+  //! Batches are delivered in order, a subscriber is allowed to flush from its callback
+  std::recursive_mutex    m_DeliverMutex;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_CHANGE_JOURNAL_HPP
@@ -15,6 +15,8 @@
 
 MEDUSA_NAMESPACE_BEGIN
 
+class CancellationToken;
+
 //! ControlFlowGraph is a graph which contains BasicBlock.
 class Medusa_EXPORT ControlFlowGraph
 {
@@ -56,7 +58,12 @@ public:
 
   Type const& GetGraph(void) const { return m_Graph; }
 
-  bool Layout(PositionMap& rPosMap);
+  /*! This method computes the position of each basic block with GraphLayout.
+   * \param rPosMap is bound to positions kept by this graph.
+   * \param pToken allows to cancel the computation, it can be nullptr.
+   * \return Returns false if the layout was cancelled.
+   */
+  bool Layout(PositionMap& rPosMap, CancellationToken const* pToken = nullptr);
   void GetBasicBlockPosition(BasicBlockVertexProperties);
 
   void ForEachBasicBlock(std::function<void (BasicBlockVertexProperties const&)> Predicat) const;
@@ -81,6 +88,7 @@ private:
   Document const& m_rDoc;
   Type            m_Graph;
   VertexMap       m_VertexMap;
+  PointVector     m_LayoutPoints;
   PositionMap     m_Layout;
 };
 
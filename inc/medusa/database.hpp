@@ -13,6 +13,9 @@
 #include "medusa/label.hpp"
 #include "medusa/xref.hpp"
 #include "medusa/detail.hpp"
+#include "medusa/fingerprint.hpp"
+#include "medusa/function_graph.hpp"
+#include "medusa/graph_layout.hpp"
 
 #include <boost/filesystem/path.hpp>
 
@@ -27,6 +30,9 @@ public:
   typedef std::function<void (MemoryArea const& rMemoryArea)>                MemoryAreaCallback;
   typedef std::function<void (Address const& rAddress, Label const& rLabel)> LabelCallback;
 
+  typedef std::vector<std::pair<Address, Label>>   LabelVector;
+  typedef std::vector<std::pair<Address, Address>> CrossReferenceVector; //! pairs of (to, from)
+
   Database(void);
   virtual ~Database(void);
 
@@ -39,6 +45,16 @@ public:
   virtual bool Flush(void);
   virtual bool Close(void);
 
+  // Stream
+  //! These methods write results as soon as they're found instead of keeping them until Flush, so a large
+  //! document can be analyzed with bounded memory (see StreamAnalyzer). Architectures and memory areas must
+  //! be added before BeginStream. Once the stream is ended, the database is already saved and Flush does nothing.
+  //! The default implementation doesn't support streaming.
+  virtual bool BeginStream(void);
+  virtual bool StreamCellData(Address const& rAddress, CellData const& rCellData);
+  virtual bool StreamLabel(Address const& rAddress, Label const& rLabel);
+  virtual bool EndStream(void);
+
   // BinaryStream
   Database& SetBinaryStream(BinaryStream::SPType spBinStrm);
   BinaryStream::SPType const GetBinaryStream(void) const;
@@ -75,11 +91,21 @@ public:
   virtual bool GetLabelAddress(Label const& rLabel, Address& rAddress) const = 0;
   virtual void ForEachLabel(LabelCallback Callback) = 0;
 
+  /*! This method adds labels at once, a label whose name is already used gets a new version.
+   * \param Force replaces existing labels, auto-generated labels are always replaced.
+   * \param rRemovedLabels receives the replaced labels.
+   * \param rAddedLabels receives the added labels with their final version.
+   */
+  virtual bool AddLabels(LabelVector const& rLabels, bool Force, LabelVector& rRemovedLabels, LabelVector& rAddedLabels);
+
   // CrossRef
   virtual bool AddCrossReference(Address const& rTo, Address const& rFrom) = 0;
   virtual bool RemoveCrossReference(Address const& rFrom) = 0;
   virtual bool RemoveCrossReferences(void) = 0;
 
+  //! This method adds cross references at once, the default implementation calls AddCrossReference for each of them.
+  virtual bool AddCrossReferences(CrossReferenceVector const& rCrossRefs);
+
   virtual bool HasCrossReferenceFrom(Address const& rTo) const = 0;
   virtual bool GetCrossReferenceFrom(Address const& rTo, Address::List& rFromList) const = 0;
 
@@ -115,6 +141,18 @@ public:
   virtual bool BindDetailId(Address const& rAddress, u8 Index, Id DtlId) = 0;
   virtual bool UnbindDetailId(Address const& rAddress, u8 Index) = 0;
 
+  // Fingerprint
+  virtual bool GetFunctionFingerprint(Address const& rFuncAddr, FunctionFingerprint& rFingerprint) const = 0;
+  virtual bool SetFunctionFingerprint(Address const& rFuncAddr, FunctionFingerprint const& rFingerprint) = 0;
+
+  // Function graph
+  virtual bool GetFunctionGraph(Address const& rFuncAddr, FunctionGraph& rFuncGraph) const = 0;
+  virtual bool SetFunctionGraph(Address const& rFuncAddr, FunctionGraph const& rFuncGraph) = 0;
+
+  // Function layout
+  virtual bool GetFunctionLayout(Address const& rFuncAddr, GraphLayout& rFuncLayout) const = 0;
+  virtual bool SetFunctionLayout(Address const& rFuncAddr, GraphLayout const& rFuncLayout) = 0;
+
 protected:
   BinaryStream::SPType m_spBinStrm;
   std::string m_OsName;
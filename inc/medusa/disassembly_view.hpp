@@ -8,6 +8,8 @@
 #include "medusa/medusa.hpp"
 #include "medusa/view.hpp"
 #include "medusa/cell_text.hpp"
+#include "medusa/line_cache.hpp"
+#include "medusa/line_index.hpp"
 
 #include <map>
 #include <set>
@@ -44,13 +46,24 @@ public:
     Indent             = 1 << 2,
   };
 
-  FormatDisassembly(Medusa const& rCore, PrintData& rPrintData) : m_rCore(rCore), m_rPrintData(rPrintData) {}
+  //! If pLineCache is not null, lines of cached addresses are replayed instead of being formatted.
+  FormatDisassembly(Medusa const& rCore, PrintData& rPrintData, LineCache* pLineCache = nullptr)
+    : m_rCore(rCore), m_rPrintData(rPrintData), m_pLineCache(pLineCache), m_pPendingAddresses(nullptr) {}
+
+  //! If pPendingAddresses is not null, addresses missing from the line cache aren't formatted:
+  //! placeholder lines are appended instead and the address is added to pPendingAddresses.
+  void SetPendingAddresses(Address::List* pPendingAddresses) { m_pPendingAddresses = pPendingAddresses; }
   void operator()(Address::List const& rAddresses, u32 Flags);
   void operator()(Address const& rAddress, u32 Flags, u16 LinesNo);
   void operator()(std::pair<Address const&, Address const&> const& rAddressesRange, u32 Flags);
 
+  //! This method returns the number of lines of a cell without formatting it.
+  //! Lines added by the architecture (e.g. function prototypes in operands) aren't counted.
+  static u16 GetLineNo(Document const& rDoc, Address const& rAddress, u32 Flags);
+
 private:
   void _Format          (Address const& rAddress, u32 Flags);
+  void _FormatLines     (Address const& rAddress, u32 Flags);
   void _FormatHeader    (Address const& rAddress, u32 Flags);
   void _FormatAddress   (Address const& rAddress, u32 Flags);
   void _FormatCell      (Address const& rAddress, u32 Flags);
@@ -59,9 +72,12 @@ private:
   void _FormatXref      (Address const& rAddress, u32 Flags);
   void _FormatMemoryArea(Address const& rAddress, u32 Flags);
   void _FormatEmpty     (Address const& rAddress, u32 Flags);
+  void _FormatPlaceholder(Address const& rAddress, u32 Flags);
 
-  Medusa const& m_rCore;
-  PrintData&    m_rPrintData;
+  Medusa const&  m_rCore;
+  PrintData&     m_rPrintData;
+  LineCache*     m_pLineCache;
+  Address::List* m_pPendingAddresses;
 };
 
 class Medusa_EXPORT DisassemblyView : public View
@@ -103,8 +119,18 @@ public:
   bool             SetSelection(u32 xOffset, u32 yOffset);
 
   bool             GoTo(Address const& rAddress, bool SaveHistory = true);
+  bool             GoToLine(u32 Line);
   bool             GetAddressFromPosition(Address& rAddress, u32 xPos, u32 yPos) const;
 
+  u32              GetNumberOfLines(void);
+  bool             GetTopLine(u32& rLine);
+
+  LineCache const& GetLineCache(void) const { return m_LineCache; }
+
+  virtual void     OnMemoryAreaUpdated(MemoryArea const& rMemArea, bool Removed);
+  virtual void     OnAddressUpdated(Address::List const& rAddressList);
+  virtual void     OnLabelUpdated(Address const& rAddress, Label const& rLabel, bool Removed);
+
   void             BeginSelection(u32 x, u32 y);        //! Absolute to the view
   void             EndSelection(u32 x, u32 y);          //! Absolute to the view
   void             ResetSelection(void);
@@ -142,6 +168,8 @@ protected:
   mutable MutexType m_Mutex;
   Medusa&           m_rCore;
   u32               m_FormatFlags;
+  LineCache         m_LineCache;          //! Formatted lines of addresses already displayed
+  LineIndex         m_LineIndex;          //! Line number of each address
   FormatDisassembly m_Format;
   PrintData         m_PrintData;
 
@@ -13,8 +13,10 @@
 #include "medusa/event_queue.hpp"
 #include "medusa/detail.hpp"
 #include "medusa/database.hpp"
+#include "medusa/change_journal.hpp"
 
 #include <set>
+#include <map>
 #include <mutex>
 #include <boost/bimap.hpp>
 #include <boost/thread/mutex.hpp>
@@ -38,6 +40,15 @@ public:
   typedef boost::signals2::connection                ConnectionType;
 
 
+  //! Subscriber receives notifications of a document, they're not called on the GUI thread:
+  //! - memory area, task and quit notifications are sent synchronously by the modifying thread,
+  //! - label, address and document notifications are delivered in batches by the change journal
+  //!   (see GetChangeJournal), from its worker thread or from the thread which flushes it (e.g. at
+  //!   the end of a task), or synchronously by the modifying thread if its delay is 0.
+  //! Inside a batch, labels are notified first in their original order, then the document, then
+  //! all modified addresses at once, sorted and without duplicates. So an address notification can
+  //! follow a label notification which was recorded after it.
+  //! A subscriber which touches GUI objects must queue this work to the GUI thread.
   class Medusa_EXPORT Subscriber
   {
     friend class Document;
@@ -109,6 +120,12 @@ public:
 
   void                          Connect(u32 Type, Subscriber* pSubscriber);
 
+                                //! Label and address notifications are delivered in batches by this journal.
+  ChangeJournal&                GetChangeJournal(void) { return m_Journal; }
+
+                                //! This method notifies subscribers that a task changed its status (see Task::Status).
+  void                          NotifyTaskUpdated(std::string const& rTaskName, u8 Status);
+
   // Memory Area
 
                                 /*! This method adds a new memory area.
@@ -122,6 +139,16 @@ public:
                                  */
   MemoryArea const*             GetMemoryArea(Address const& Addr) const;
 
+                                /*! This method returns the memory area of rAddr like GetMemoryArea, but a bank of
+                                 * a BankedMemoryArea is mapped the first time it's referenced.
+                                 */
+  MemoryArea const*             MapMemoryArea(Address const& rAddr);
+
+                                /*! This method returns the banked memory area rAddr depends on: the one whose window
+                                 * contains rAddr in any bank, otherwise one with the same addressing type.
+                                 */
+  BankedMemoryArea const*       GetBankedMemoryArea(Address const& rAddr) const;
+
   // Binary Stream
 
   BinaryStream const&           GetBinaryStream(void) const
@@ -143,10 +170,16 @@ public:
   void                          RemoveLabel(Address const& rAddr);
   void                          ForEachLabel(Database::LabelCallback Callback) const;
 
+                                //! This method adds labels like AddLabel, but the database and the views are updated once.
+  void                          AddLabels(Database::LabelVector const& rLabels, bool Force = true);
+
   // CrossRef
   bool                          AddCrossReference(Address const& rTo, Address const& rFrom);
   bool                          RemoveCrossReference(Address const& rFrom);
   bool                          RemoveCrossReferences(void);
+  bool                          AddCrossReferences(Database::CrossReferenceVector const& rCrossRefs);
+                                //! This method removes a cross reference, and the label of its destination if it was generated for it.
+  void                          RemoveCrossReferenceAndDerivedLabel(Address const& rFrom);
 
   bool                          HasCrossReferenceFrom(Address const& rTo) const;
   bool                          GetCrossReferenceFrom(Address const& rTo, Address::List& rFromList) const;
@@ -209,6 +242,8 @@ public:
                                 */
   MultiCell::Map const&         GetMultiCells(void) const { return m_MultiCells; }
 
+  bool                          RemoveMultiCell(Address const& rAddr);
+
   // Detail
 
   bool                          GetValueDetail(Id ConstId, ValueDetail& rConstDtl) const;
@@ -224,6 +259,33 @@ public:
   bool                          BindDetailId(Address const& rAddress, u8 Index, Id DtlId);
   bool                          UnbindDetailId(Address const& rAddress, u8 Index);
 
+  // Fingerprint
+
+  bool                          GetFunctionFingerprint(Address const& rFuncAddr, FunctionFingerprint& rFingerprint) const;
+  bool                          SetFunctionFingerprint(Address const& rFuncAddr, FunctionFingerprint const& rFingerprint);
+
+  // Function graph
+
+  bool                          GetFunctionGraph(Address const& rFuncAddr, FunctionGraph& rFuncGraph) const;
+  bool                          SetFunctionGraph(Address const& rFuncAddr, FunctionGraph const& rFuncGraph);
+
+  // Function layout
+
+                                /*! This method retrieves the cached layout of a function graph.
+                                 *  \param rFuncAddr is the address of the function.
+                                 *  \param rFuncLayout is filled with the layout, its signature must be checked by the caller.
+                                 *  \return Returns false if no layout is cached.
+                                 */
+  bool                          GetFunctionLayout(Address const& rFuncAddr, GraphLayout& rFuncLayout) const;
+  bool                          SetFunctionLayout(Address const& rFuncAddr, GraphLayout const& rFuncLayout);
+
+                                /*! This method returns functions which contain an address in one of their basic blocks.
+                                 *  \param rAddr is the address to look for.
+                                 *  \param rFuncAddrs is filled with addresses of functions, a function can be shared by several functions.
+                                 *  \return Returns true if at least one function is found, otherwise it returns false.
+                                 */
+  bool                          GetFunctionsContaining(Address const& rAddr, Address::List& rFuncAddrs) const;
+
   // Address
 
                                 /*! This method makes an Address.
@@ -269,22 +331,39 @@ public:
 private:
   void RemoveLabelIfNeeded(Address const& rAddr);
 
+  void _BuildFunctionIndex(void) const;
+  void _IndexFunctionGraph(Address const& rFuncAddr, FunctionGraph const& rFuncGraph) const;
+
+  // basic block address -> (basic block length, function address)
+  typedef std::multimap<Address, std::pair<u32, Address>> BasicBlockOwnerMapType;
+  typedef std::map<Address, Address::Vector>              FunctionBasicBlockMapType;
+
   typedef std::mutex MutexType;
 
   Database::SPType                        m_spDatabase;
   MultiCell::Map                          m_MultiCells;
   mutable MutexType                       m_CellMutex;
 
+  MutexType                               m_BankMutex;
+
   std::deque<Address>                     m_AddressHistory;
   std::deque<Address>::size_type          m_AddressHistoryIndex;
   MutexType                               m_AddressHistoryMutex;
 
+  mutable BasicBlockOwnerMapType          m_BasicBlockOwners;
+  mutable FunctionBasicBlockMapType       m_FunctionBasicBlocks;
+  mutable u32                             m_MaxBasicBlockLength;
+  mutable bool                            m_IsFunctionIndexBuilt;
+  mutable MutexType                       m_FunctionIndexMutex;
+
   Subscriber::QuitSignalType              m_QuitSignal;
   Subscriber::DocumentUpdatedSignalType   m_DocumentUpdatedSignal;
   Subscriber::MemoryAreaUpdatedSignalType m_MemoryAreaUpdatedSignal;
   Subscriber::AddressUpdatedSignalType    m_AddressUpdatedSignal;
   Subscriber::LabelUpdatedSignalType      m_LabelUpdatedSignal;
   Subscriber::TaskUpdatedSignalType       m_TaskUpdatedSignal;
+
+  ChangeJournal                           m_Journal;
 };
 
 MEDUSA_NAMESPACE_END
@@ -6,6 +6,8 @@
 #include "medusa/export.hpp"
 #include <boost/detail/endian.hpp>
 
+#include <cstddef>
+
 MEDUSA_NAMESPACE_BEGIN
 
 enum EEndianness
@@ -75,6 +77,22 @@ template<> inline void EndianSwap<s64>(s64& rData)
     (rData << 56);
 }
 
+//! These functions swap arrays of scalars, they use SIMD instructions when available.
+Medusa_EXPORT void EndianSwapArray(u16* pData, size_t Count);
+Medusa_EXPORT void EndianSwapArray(u32* pData, size_t Count);
+Medusa_EXPORT void EndianSwapArray(u64* pData, size_t Count);
+
+inline void EndianSwapArray(s16* pData, size_t Count) { EndianSwapArray(reinterpret_cast<u16*>(pData), Count); }
+inline void EndianSwapArray(s32* pData, size_t Count) { EndianSwapArray(reinterpret_cast<u32*>(pData), Count); }
+inline void EndianSwapArray(s64* pData, size_t Count) { EndianSwapArray(reinterpret_cast<u64*>(pData), Count); }
+
+//! Other types are swapped one by one, which does nothing for bytes and structures.
+template<typename T> inline void EndianSwapArray(T* pData, size_t Count)
+{
+  for (size_t i = 0; i < Count; ++i)
+    EndianSwap(pData[i]);
+}
+
 MEDUSA_NAMESPACE_END
 
 #endif // MEDUSA_ENDIAN_HPP
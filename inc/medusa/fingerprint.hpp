@@ -0,0 +1,78 @@
+#ifndef MEDUSA_FINGERPRINT_HPP
+#define MEDUSA_FINGERPRINT_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+
+#include <string>
+#include <map>
+
+MEDUSA_NAMESPACE_BEGIN
+
+class Document;
+
+//! FunctionFingerprint summarizes a function in order to compare it with functions from another document.
+class Medusa_EXPORT FunctionFingerprint
+{
+public:
+  typedef std::map<Address, FunctionFingerprint> Map;
+
+  enum InstructionClass
+  {
+    OtherClass,
+    CallClass,
+    JumpClass,
+    ConditionalJumpClass,
+    ReturnClass,
+    MemoryClass,
+    ImmediateClass,
+    InstructionClassCount
+  };
+
+  FunctionFingerprint(void);
+
+  /*! This method computes the fingerprint of a function.
+   * \param rDoc contains the disassembled function.
+   * \param rFuncAddr is the address of the function.
+   * \return Returns true if the control flow graph of the function can be built, otherwise false.
+   */
+  bool Compute(Document const& rDoc, Address const& rFuncAddr);
+
+  //! This method tells if the fingerprint was computed for the function as it is now, bytes of the function are compared.
+  bool IsUpToDate(Document const& rDoc, Address const& rFuncAddr) const;
+
+  /*! This method returns the similarity of two fingerprints.
+   * \return Returns a value between 0.0 (nothing in common) and 1.0 (same structure).
+   */
+  double Similarity(FunctionFingerprint const& rFingerprint) const;
+
+  bool IsValid(void)                         const { return m_NumberOfInstructions != 0; }
+  u64  GetInstructionHash(void)              const { return m_InsnHash;               }
+  u64  GetStructuralHash(void)               const { return m_StructHash;             }
+  u32  GetNumberOfBasicBlocks(void)          const { return m_NumberOfBasicBlocks;    }
+  u32  GetNumberOfEdges(void)                const { return m_NumberOfEdges;          }
+  u32  GetNumberOfInstructions(void)         const { return m_NumberOfInstructions;   }
+  u32  GetNumberOfCallers(void)              const { return m_NumberOfCallers;        }
+  u32  GetInstructionClass(u8 Class)         const { return Class < InstructionClassCount ? m_Histogram[Class] : 0; }
+  Address::Vector const& GetCallees(void)    const { return m_Callees;                }
+
+  std::string Dump(void) const;
+  bool        Parse(std::string const& rDump);
+
+private:
+  u64             m_InsnHash;
+  u64             m_StructHash;
+  u64             m_ContentHash; //! see FunctionGraph::GetContentHash
+  u32             m_NumberOfBasicBlocks;
+  u32             m_NumberOfEdges;
+  u32             m_NumberOfInstructions;
+  u32             m_NumberOfCallers;
+  u32             m_Histogram[InstructionClassCount];
+  Address::Vector m_Callees;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_FINGERPRINT_HPP
@@ -0,0 +1,83 @@
+#ifndef MEDUSA_FUNCTION_GRAPH_HPP
+#define MEDUSA_FUNCTION_GRAPH_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+
+#include <string>
+#include <vector>
+
+MEDUSA_NAMESPACE_BEGIN
+
+class Document;
+
+//! FunctionGraph holds basic block boundaries and edges of a function.
+//! It's computed once when the function is created and kept in the database,
+//! so the analyzer doesn't have to walk the control flow again.
+class Medusa_EXPORT FunctionGraph
+{
+public:
+  enum Flags
+  {
+    HasReturnFlag         = 1 << 0, //! at least one unconditional return was reached
+    HasUnresolvedJumpFlag = 1 << 1, //! the destination of a jump couldn't be determined
+  };
+
+  struct BasicBlock
+  {
+    Address          m_Address;
+    std::vector<u16> m_InstructionLengths;
+  };
+
+  struct Edge
+  {
+    u32 m_Source;      //! index of the source basic block
+    u32 m_Destination; //! index of the destination basic block
+    u8  m_Type;        //! see BasicBlockEdgeProperties::Type
+  };
+
+  FunctionGraph(void);
+
+  /*! This method walks the control flow of a function and records its basic blocks.
+   * \param rDoc contains the disassembled function.
+   * \param rFuncAddr is the address of the function.
+   * \param LengthThreshold is the maximum size of this function, 0 means unlimited.
+   * \return Returns false if the function is empty or if LengthThreshold is reached.
+   */
+  bool Build(Document const& rDoc, Address const& rFuncAddr, u32 LengthThreshold = 0);
+
+  //! This method tells if the graph still matches the function as it is now.
+  bool IsUpToDate(Document const& rDoc, Address const& rFuncAddr) const;
+
+  //! This method hashes the current bytes of all instructions of the graph, it fails if one can't be read.
+  bool ComputeContentHash(Document const& rDoc, u64& rContentHash) const;
+
+  bool IsValid(void)                                const { return !m_BasicBlocks.empty();                 }
+  bool HasReturn(void)                              const { return (m_Flags & HasReturnFlag) ? true : false; }
+  bool HasUnresolvedJump(void)                      const { return (m_Flags & HasUnresolvedJumpFlag) ? true : false; }
+  u32  GetLength(void)                              const { return m_Length;                               }
+  u32  GetNumberOfInstructions(void)                const { return m_NumberOfInstructions;                 }
+  u64  GetContentHash(void)                         const { return m_ContentHash;                          }
+  std::vector<BasicBlock> const& GetBasicBlocks(void) const { return m_BasicBlocks;                        }
+  std::vector<Edge>       const& GetEdges(void)       const { return m_Edges;                              }
+
+  //! This method returns addresses of all instructions contained in a basic block.
+  Address::List GetBasicBlockAddresses(u32 BasicBlockIndex) const;
+
+  std::string Dump(void) const;
+  bool        Parse(std::string const& rDump);
+
+private:
+  u32                     m_Flags;
+  u32                     m_Length;
+  u32                     m_NumberOfInstructions;
+  u64                     m_ContentHash; //! hash of instruction bytes when the graph was built
+  std::vector<BasicBlock> m_BasicBlocks;
+  std::vector<Edge>       m_Edges;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_FUNCTION_GRAPH_HPP
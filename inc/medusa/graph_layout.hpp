@@ -0,0 +1,117 @@
+#ifndef MEDUSA_GRAPH_LAYOUT_HPP
+#define MEDUSA_GRAPH_LAYOUT_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+
+#include <string>
+#include <vector>
+
+MEDUSA_NAMESPACE_BEGIN
+
+class CancellationToken;
+
+//! GraphLayout places the nodes of a graph in layers, from top to bottom.
+//! It's cheaper than a full Sugiyama layout: linear chains of nodes are collapsed,
+//! strongly connected components are laid out independently and in parallel,
+//! then they are placed as the nodes of an acyclic graph.
+//! A layout can also hold positions computed elsewhere, so it can be cached in the database.
+class Medusa_EXPORT GraphLayout
+{
+public:
+  enum
+  {
+    NodeDistance  = 25,
+    LayerDistance = 50,
+    SweepNo       = 4,  //! number of barycenter passes to reduce crossings
+  };
+
+  struct Point
+  {
+    s32 m_X;
+    s32 m_Y;
+  };
+  typedef std::vector<Point> PointList;
+
+  GraphLayout(void);
+
+  //! This method adds a node and returns its index, nodes must be added before edges.
+  u32  AddNode(u32 Width, u32 Height);
+  bool AddEdge(u32 Source, u32 Destination);
+
+  u32  GetNumberOfNodes(void)            const { return static_cast<u32>(m_Nodes.size()); }
+  u32  GetNumberOfEdges(void)            const { return static_cast<u32>(m_Edges.size()); }
+  u32  GetNodeWidth(u32 NodeIndex)       const { return m_Nodes[NodeIndex].m_Width;       }
+  u32  GetNodeHeight(u32 NodeIndex)      const { return m_Nodes[NodeIndex].m_Height;      }
+  u32  GetEdgeSource(u32 EdgeIndex)      const { return m_Edges[EdgeIndex].m_Source;      }
+  u32  GetEdgeDestination(u32 EdgeIndex) const { return m_Edges[EdgeIndex].m_Destination; }
+
+  //! This method identifies sizes of nodes and edges, a cached layout is only valid for the same signature.
+  u64  GetSignature(void) const;
+
+  /*! This method computes the position of each node and the bends of each edge.
+   * \param pToken is checked between each step, it can be nullptr.
+   * \return Returns false if the computation was cancelled, the previous layout is lost.
+   */
+  bool Compute(CancellationToken const* pToken = nullptr);
+
+  bool IsComputed(void) const { return m_IsComputed; }
+
+  //! Positions are the center of nodes.
+  Point const&     GetNodePosition(u32 NodeIndex) const { return m_Nodes[NodeIndex].m_Position; }
+  //! Bends are ordered from the source to the destination, they don't include the end points.
+  PointList const& GetEdgeBends(u32 EdgeIndex)    const { return m_Edges[EdgeIndex].m_Bends;    }
+  u32              GetWidth(void)                 const { return m_Width;                       }
+  u32              GetHeight(void)                const { return m_Height;                      }
+
+  //! These methods store a layout computed by another algorithm.
+  void SetNodePosition(u32 NodeIndex, Point const& rPosition);
+  void SetEdgeBends(u32 EdgeIndex, PointList const& rBends);
+  void SetSize(u32 Width, u32 Height);
+
+  std::string Dump(void) const;
+  bool        Parse(std::string const& rDump);
+
+private:
+  struct Node
+  {
+    u32   m_Width;
+    u32   m_Height;
+    Point m_Position;
+  };
+
+  struct Edge
+  {
+    u32       m_Source;
+    u32       m_Destination;
+    PointList m_Bends;
+  };
+
+  struct Box
+  {
+    u32 m_Width;
+    u32 m_Height;
+  };
+
+  typedef std::vector<std::pair<u32, u32>> EdgeListType;
+
+  /*! This function places boxes in layers, cycles are broken by a depth-first search from Entry.
+   * \param rCenters is filled with the center of each box, relative to the top left corner.
+   * \return Returns false if pToken was cancelled.
+   */
+  static bool _LayoutLayers(
+    std::vector<Box> const& rBoxes, EdgeListType const& rEdges, u32 Entry,
+    std::vector<Point>& rCenters, u32& rWidth, u32& rHeight,
+    CancellationToken const* pToken);
+
+  std::vector<Node> m_Nodes;
+  std::vector<Edge> m_Edges;
+  u32               m_Width;
+  u32               m_Height;
+  bool              m_IsComputed;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_GRAPH_LAYOUT_HPP
@@ -0,0 +1,87 @@
+#ifndef MEDUSA_JUMP_TABLE_HPP
+#define MEDUSA_JUMP_TABLE_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+#include "medusa/instruction.hpp"
+#include "medusa/information.hpp"
+#include "medusa/function_graph.hpp"
+
+MEDUSA_NAMESPACE_BEGIN
+
+class Document;
+
+//! JumpTable recovers the destinations of an indirect jump which dispatches through a table,
+//! e.g. jmp [table + index * scale] or mov reg, [table + index * scale]; jmp reg.
+class Medusa_EXPORT JumpTable
+{
+public:
+  enum
+  {
+    DefaultMaxEntries = 0x400, //! entries read when the bounds check can't be found
+  };
+
+  JumpTable(void);
+
+  //! This method tells if an instruction is an indirect jump which could use a jump table.
+  static bool IsCandidate(Instruction const& rInsn);
+
+  /*! This method retrieves the destinations of a jump table which was previously resolved.
+   * Each entry of the table holds a cross-reference to its destination.
+   * \param rDoc contains the jump table.
+   * \param rJmpAddr is the address of the indirect jump.
+   * \param rInsn is the indirect jump.
+   * \param rTargets is filled with the destinations.
+   * \return Returns false if the jump doesn't refer to a resolved jump table.
+   */
+  static bool GetTargets(Document const& rDoc, Address const& rJmpAddr, Instruction const& rInsn, Address::List& rTargets);
+
+  /*! This method backtracks the base, the index register and the bounds check of an indirect jump,
+   * then it reads the table from the binary stream. It doesn't modify the document.
+   * \param rDoc contains the function, it's not const because of the symbolic engine.
+   * \param rFuncGraph is the graph of the function which contains the jump.
+   * \param rFuncAddr is the address of the function.
+   * \param rJmpAddr is the address of the indirect jump.
+   * \param MaxEntries is the maximum number of entries read when the bounds check is unknown.
+   * \return Returns true if at least one destination was found.
+   */
+  bool Resolve(
+    Document           & rDoc,
+    FunctionGraph const& rFuncGraph,
+    Address       const& rFuncAddr,
+    Address       const& rJmpAddr,
+    u32                  MaxEntries = DefaultMaxEntries);
+
+  Address       const& GetJumpAddress(void)    const { return m_JmpAddr;    }
+  Address       const& GetTableAddress(void)   const { return m_TblAddr;    }
+  u8                   GetEntrySize(void)      const { return m_EntrySize;  }
+  bool                 IsRelative(void)        const { return m_IsRelative; }
+  bool                 IsBounded(void)         const { return m_IsBounded;  }
+  Address::List const& GetTargets(void)        const { return m_Targets;    }
+
+  //! This method returns the address which holds the cross-reference from the jump to its table.
+  static Address GetReferenceAddress(Address const& rJmpAddr, Instruction const& rInsn);
+
+private:
+  bool _DecodeMemoryOperand(Document& rDoc, Address const& rFuncAddr, Instruction const& rInsn);
+  bool _BacktrackJumpRegister(Document& rDoc, Address const& rFuncAddr, Instruction const& rInsn);
+  bool _FindBound(Document const& rDoc, FunctionGraph const& rFuncGraph, u32& rNumberOfEntries) const;
+  bool _IsIndexRegister(u32 RegId) const;
+  bool _ReadEntries(Document const& rDoc, u32 NumberOfEntries);
+
+  CpuInformation const* m_pCpuInfo;
+  Address               m_JmpAddr;
+  Address               m_TblAddr;
+  u32                   m_IdxRegId;
+  u8                    m_Scale;
+  u8                    m_EntrySize;
+  bool                  m_IsRelative; //! entries are signed offsets from the table address
+  bool                  m_IsBounded;  //! the number of entries comes from the bounds check
+  Address::List         m_Targets;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_JUMP_TABLE_HPP
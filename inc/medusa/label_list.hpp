@@ -0,0 +1,105 @@
+#ifndef MEDUSA_LABEL_LIST_HPP
+#define MEDUSA_LABEL_LIST_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+#include "medusa/label.hpp"
+#include "medusa/change_journal.hpp"
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+MEDUSA_NAMESPACE_BEGIN
+
+class Document;
+
+//! LabelList is a sorted and filtered snapshot of the labels of a document, so a view can fetch
+//! any row by its index. Label updates are queued from any thread, then applied in one batch
+//! which reports the inserted and removed row ranges.
+//! Except for AddLabelUpdate and HasPendingUpdates, methods must be called from a single thread.
+class Medusa_EXPORT LabelList
+{
+public:
+  enum SortKey
+  {
+    SortByName,
+    SortByType,
+    SortByAddress,
+  };
+
+  enum RowsChange
+  {
+    BeginInsertRows,
+    EndInsertRows,
+    BeginRemoveRows,
+    EndRemoveRows,
+    BeginReset,
+    EndReset,
+  };
+
+  enum
+  {
+    LargeBatchSize = 0x400, //! above this number of updates, the list is merged and reset
+  };
+
+  struct Entry
+  {
+    Address     m_Address;
+    Label       m_Label;
+    std::string m_Name;  //! cached result of Label::GetLabel
+  };
+
+  //! This function is called around each modification of rows, LastRow is included.
+  typedef std::function<void (RowsChange Change, u32 FirstRow, u32 LastRow)> RowsCallbackType;
+
+  LabelList(void);
+
+  /*! This method sets which labels are listed, Rebuild must be called to apply it.
+   * \param rPattern is searched in label names, case is ignored.
+   * \param ExcludedTypes removes labels which have one of these flags.
+   */
+  void SetFilter(std::string const& rPattern, u16 ExcludedTypes = Label::Local);
+
+  //! This method takes a new snapshot of rDoc labels, pending updates are dropped.
+  void Rebuild(Document const& rDoc);
+
+  void    Sort(SortKey Key, bool Ascending);
+  SortKey GetSortKey(void)   const { return m_SortKey;   }
+  bool    IsAscending(void)  const { return m_Ascending; }
+
+  u32          GetSize(void) const { return static_cast<u32>(m_Entries.size()); }
+  Entry const& GetEntry(u32 Row) const { return m_Entries[Row]; }
+
+  //! This method returns the first row of a label located at rAddress.
+  bool FindRow(Address const& rAddress, u32& rRow) const;
+
+  //! This method queues an update, it returns true if the queue was empty.
+  bool AddLabelUpdate(Address const& rAddress, Label const& rLabel, bool Removed);
+  bool HasPendingUpdates(void) const;
+
+  //! This method applies queued updates, Callback is called around each modification.
+  void ApplyUpdates(RowsCallbackType Callback);
+
+private:
+  bool _IsListed(Label const& rLabel, std::string const& rName) const;
+  bool _Less(Entry const& rLhs, Entry const& rRhs) const;
+  void _Sort(void);
+
+  std::vector<Entry>                   m_Entries;
+  std::string                          m_Pattern;
+  u16                                  m_ExcludedTypes;
+  SortKey                              m_SortKey;
+  bool                                 m_Ascending;
+
+  ChangeJournal::LabelChangeVector     m_PendingUpdates;
+  typedef std::mutex MutexType;
+  mutable MutexType                    m_PendingMutex;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_LABEL_LIST_HPP
@@ -0,0 +1,118 @@
+#ifndef MEDUSA_LINE_CACHE_HPP
+#define MEDUSA_LINE_CACHE_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+#include "medusa/cell_text.hpp"
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+MEDUSA_NAMESPACE_BEGIN
+
+//! LineCache keeps the formatted lines of each address, so a view only formats addresses
+//! which are newly exposed. Texts, marks and operand offsets of all lines are stored in flat
+//! arenas, an address only refers to a range of line records.
+//! A cache is bound to a set of format flags, it must be cleared if they change.
+//! Lines can be formatted while the document is modified by another thread, so each address has
+//! an epoch which is bumped when it's invalidated: lines formatted before are dropped by Insert.
+class Medusa_EXPORT LineCache
+{
+public:
+  enum
+  {
+    DefaultMaxLines = 0x40000, //! live lines kept before the cache is flushed
+    EpochNo         = 0x100,   //! addresses share epochs, a collision only costs a dropped insertion
+  };
+
+  LineCache(u32 MaxLines = DefaultMaxLines);
+
+  bool Contains(Address const& rAddress) const;
+  u16  GetLineNo(Address const& rAddress) const;
+
+  /*! This method retrieves one line of an address.
+   * \param rAddress is the address of the line.
+   * \param LineIndex is the index of the line relative to rAddress.
+   * \param rLine is filled with the line.
+   * \return Returns false if the line isn't cached.
+   */
+  bool GetLine(Address const& rAddress, u16 LineIndex, LineData& rLine) const;
+
+  /*! This method appends all cached lines of an address.
+   * \param rAddress is the address to replay.
+   * \param rPrintData receives the lines.
+   * \return Returns false if rAddress isn't cached, in this case rPrintData is untouched.
+   */
+  bool Replay(Address const& rAddress, PrintData& rPrintData) const;
+
+  /*! This method stores the lines of rPrintData which belong to rAddress, previous lines are replaced.
+   * \param FirstLine is the first line of rPrintData to look at.
+   */
+  void Insert(Address const& rAddress, PrintData const& rPrintData, u32 FirstLine = 0);
+
+  //! This method returns the epoch of rAddress, it must be read before formatting its lines.
+  u32  GetEpoch(Address const& rAddress) const;
+
+  /*! This method stores the lines of rPrintData like Insert, unless rAddress was invalidated after Epoch was read.
+   * \param Epoch is the value returned by GetEpoch before rAddress was formatted.
+   * \return Returns false if the lines are outdated, in this case they're not stored.
+   */
+  bool Insert(Address const& rAddress, PrintData const& rPrintData, u32 FirstLine, u32 Epoch);
+
+  void Invalidate(Address const& rAddress);
+  void Invalidate(Address::List const& rAddresses);
+  void Clear(void);
+
+  u64 GetHitCount(void)  const { return m_HitCount;  }
+  u64 GetMissCount(void) const { return m_MissCount; }
+  u32 GetLiveLineNo(void) const;
+
+private:
+  struct LineRecord
+  {
+    u32 m_TextOffset;
+    u32 m_MarkOffset;
+    u32 m_OperandOffset;
+    u16 m_TextLength;
+    u16 m_MarkNo;
+    u16 m_OperandNo;
+  };
+
+  struct Entry
+  {
+    u32 m_FirstLine;
+    u16 m_LineNo;
+  };
+
+  typedef std::unordered_map<Address, Entry> EntryMapType;
+
+  LineView _GetLine(LineRecord const& rRecord, Address const& rAddress) const;
+  void     _Insert(Address const& rAddress, PrintData const& rPrintData, u32 FirstLine);
+  void     _Invalidate(Address const& rAddress);
+  u32&     _GetEpoch(Address const& rAddress) const;
+  void     _Erase(EntryMapType::iterator itEntry);
+  void     _Compact(void);
+
+  EntryMapType            m_Entries;
+  std::vector<LineRecord> m_Lines;
+  std::string             m_Texts;
+  std::vector<Mark>       m_Marks;
+  std::vector<u16>        m_OperandsOffset;
+  u32                     m_LiveLineNo;
+  u32                     m_MaxLines;
+  mutable u32             m_Epochs[EpochNo];
+
+  mutable u64             m_HitCount;
+  mutable u64             m_MissCount;
+
+  typedef std::mutex MutexType;
+  mutable MutexType m_Mutex;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_LINE_CACHE_HPP
@@ -0,0 +1,96 @@
+#ifndef MEDUSA_LINE_INDEX_HPP
+#define MEDUSA_LINE_INDEX_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+
+#include <functional>
+#include <mutex>
+#include <set>
+#include <vector>
+
+MEDUSA_NAMESPACE_BEGIN
+
+class Document;
+class MemoryArea;
+
+//! LineIndex maps addresses to line numbers of a listing and back in O(log n).
+//! Memory areas are split in blocks of addresses, a Fenwick tree holds the number of lines
+//! of each block. Modified blocks are only counted again on the next query.
+class Medusa_EXPORT LineIndex
+{
+public:
+  enum
+  {
+    DefaultBlockSize = 0x100,
+  };
+
+  //! This function returns the number of lines displayed for a cell.
+  typedef std::function<u16 (Address const& rAddress)> LineCounterType;
+
+  LineIndex(Document const& rDoc, LineCounterType LineCounter, u32 BlockSize = DefaultBlockSize);
+
+  //! This method must be called when memory areas change, the index is built again on the next query.
+  void Invalidate(void);
+
+  //! This method marks blocks which contain modified addresses.
+  void Update(Address::List const& rAddresses);
+
+  u32  GetNumberOfLines(void);
+
+  /*! This method retrieves the line of an address.
+   * \param rAddress is the address, if it's inside a cell the line of the cell is returned.
+   * \param rLine is the first line of the cell.
+   * \return Returns false if rAddress isn't contained in a memory area.
+   */
+  bool ConvertAddressToLine(Address const& rAddress, u32& rLine);
+
+  /*! This method retrieves the address displayed at a line.
+   * \param Line is the line number.
+   * \param rAddress is the address of the cell.
+   * \param rLineOffset is the offset of Line relative to the first line of rAddress.
+   * \return Returns false if Line is out of the listing.
+   */
+  bool ConvertLineToAddress(u32 Line, Address& rAddress, u16& rLineOffset);
+
+private:
+  struct Area
+  {
+    MemoryArea const* m_pMemArea;
+    TOffset           m_BaseOffset;
+    u32               m_Size;
+    u32               m_FirstBlock;
+  };
+
+  typedef std::function<bool (Address const& rAddress, u16 LineNo)> CellCallbackType;
+
+  bool _Prepare(void);
+  void _Build(void);
+  bool _FindBlock(Address const& rAddress, u32& rBlockIndex) const;
+  Area const* _GetArea(u32 BlockIndex) const;
+  void _ForEachCellInBlock(u32 BlockIndex, CellCallbackType Callback) const;
+  u32  _CountBlock(u32 BlockIndex) const;
+
+  void _AddToTree(u32 BlockIndex, s64 Delta);
+  u32  _GetLinesBefore(u32 BlockIndex) const;
+  bool _FindBlockFromLine(u32 Line, u32& rBlockIndex, u32& rLinesBefore) const;
+
+  Document const&   m_rDoc;
+  LineCounterType   m_LineCounter;
+  u32               m_BlockSize;
+  bool              m_IsBuilt;
+
+  std::vector<Area> m_Areas;
+  std::vector<u32>  m_BlockLines; //! number of lines of each block
+  std::vector<u32>  m_Tree;       //! Fenwick tree of m_BlockLines, 1-based
+  std::set<u32>     m_DirtyBlocks;
+
+  typedef std::mutex MutexType;
+  mutable MutexType m_Mutex;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_LINE_INDEX_HPP
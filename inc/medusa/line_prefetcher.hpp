@@ -0,0 +1,71 @@
+#ifndef MEDUSA_LINE_PREFETCHER_HPP
+#define MEDUSA_LINE_PREFETCHER_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+#include "medusa/cell_text.hpp"
+#include "medusa/line_cache.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+MEDUSA_NAMESPACE_BEGIN
+
+class Medusa;
+
+//! LinePrefetcher formats addresses into a line cache on its own thread, so a view only
+//! replays cached lines. The requested page is formatted first, then the pages below and above it.
+//! A new request cancels the previous one.
+class Medusa_EXPORT LinePrefetcher
+{
+public:
+  enum
+  {
+    DefaultPageNo = 2, //! pages formatted above and below the requested one
+  };
+
+  //! This function is called from the prefetcher thread when the requested page is cached.
+  typedef std::function<void (void)> PageReadyCallbackType;
+
+  LinePrefetcher(Medusa const& rCore, LineCache& rLineCache, u32 FormatFlags, PageReadyCallbackType PageReady, u32 PageNo = DefaultPageNo);
+  ~LinePrefetcher(void);
+
+  /*! This method asks for a page to be formatted.
+   * \param rTopAddress is the first address of the page.
+   * \param AddressNo is the number of addresses of a page.
+   */
+  void Request(Address const& rTopAddress, u32 AddressNo);
+
+  //! This method stops the thread, pending requests are dropped.
+  void Stop(void);
+
+private:
+  void _Run(void);
+  bool _FormatRange(Address const& rFirstAddress, u32 AddressNo, u32 Generation, Address& rNextAddress);
+  bool _IsCancelled(u32 Generation) const { return !m_Running || m_Generation != Generation; }
+
+  Medusa const&           m_rCore;
+  LineCache&              m_rLineCache;
+  u32                     m_FormatFlags;
+  PageReadyCallbackType   m_PageReady;
+  u32                     m_PageNo;
+
+  Address                 m_TopAddress;
+  u32                     m_AddressNo;
+  bool                    m_HasRequest;
+  std::atomic<u32>        m_Generation;
+  std::atomic<bool>       m_Running;
+
+  std::mutex              m_Mutex;
+  std::condition_variable m_CondVar;
+  std::thread             m_Thread;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_LINE_PREFETCHER_HPP
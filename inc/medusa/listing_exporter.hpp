@@ -0,0 +1,76 @@
+#ifndef MEDUSA_LISTING_EXPORTER_HPP
+#define MEDUSA_LISTING_EXPORTER_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+#include "medusa/cell_text.hpp"
+#include "medusa/disassembly_view.hpp"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+MEDUSA_NAMESPACE_BEGIN
+
+class Medusa;
+class MemoryArea;
+
+//! ListingExporter writes the whole disassembly of a document without any view.
+//! Memory areas are split in chunks of addresses which are formatted in parallel by
+//! independent FormatDisassembly, the results are written in order.
+class Medusa_EXPORT ListingExporter
+{
+public:
+  enum OutputType
+  {
+    TextOutput,      //! same lines as the text front-end
+    JsonLinesOutput, //! one JSON object per line with its address, text and marks
+  };
+
+  enum
+  {
+    DefaultChunkSize  = 0x1000,   //! number of bytes of memory area formatted by a task
+    DefaultBufferSize = 0x100000, //! size of the buffer of the output file
+  };
+
+  ListingExporter(Medusa const& rCore, u32 FormatFlags = FormatDisassembly::ShowAddress | FormatDisassembly::AddSpaceBeforeXref, u32 ChunkSize = DefaultChunkSize);
+
+  /*! This method exports the listing to a stream.
+   * \param rOutput receives the listing.
+   * \param Type is the format of the listing.
+   * \return Returns false if nothing could be exported or if writing failed.
+   */
+  bool Export(std::ostream& rOutput, OutputType Type);
+
+  //! This method exports the listing to a file, it's overwritten if it already exists.
+  bool Export(boost::filesystem::path const& rPath, OutputType Type);
+
+  u64 GetNumberOfLines(void) const { return m_LineNo; }
+
+private:
+  struct Chunk
+  {
+    MemoryArea const* m_pMemArea;
+    TOffset           m_BeginOffset;
+    TOffset           m_EndOffset;
+  };
+
+  void          _SplitInChunks(std::vector<Chunk>& rChunks) const;
+  Address::List _GetChunkAddresses(Chunk const& rChunk) const;
+  u64           _FormatChunk(Chunk const& rChunk, OutputType Type, std::string& rOutput) const;
+  static void   _AppendJsonLine(LineView const& rLine, std::string const& rAddress, std::string& rOutput);
+  static void   _AppendJsonString(TextView const& rText, std::string& rOutput);
+
+  Medusa const& m_rCore;
+  u32           m_FormatFlags;
+  u32           m_ChunkSize;
+  u64           m_LineNo;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_LISTING_EXPORTER_HPP
@@ -31,6 +31,9 @@ public:
   virtual bool        IsCompatible(BinaryStream const& rBinStrm) = 0;
   virtual void        Map(Document& rDoc, Architecture::VSPType const& rArchs) = 0;
   virtual void        FilterAndConfigureArchitectures(Architecture::VSPType& rArchs) const = 0;
+
+  //! A loader which inserts the option "Streaming" can ask to analyze the document window by window (see StreamAnalyzer).
+  bool                IsStreaming(void) const { return m_CfgMdl.IsSet("Streaming") && m_CfgMdl.GetBoolean("Streaming"); }
 };
 
 typedef Loader* (*TGetLoader)(void);
@@ -106,9 +106,6 @@ private:
   Log(void);
   ~Log(void);
 
-  typedef std::map<std::string, std::string> LogMap;
-
-  static LogMap                     m_LogMap;
   static LogWrapper::LoggerCallback m_pLog;
 };
 
@@ -38,6 +38,18 @@ public:
   void                            AddTask(Task* pTask);
   void                            WaitForTasks(void);
 
+                                  //! This method cancels the running task and removes queued ones.
+  void                            CancelTasks(void);
+
+                                  //! This method cancels each task which is still running Timeout seconds after it started, 0 removes the timeout.
+  void                            SetTasksTimeout(u32 Timeout);
+
+                                  /*! This method retrieves the progress of the running task.
+                                   * \param rDone and rTotal are counted in units of the task, rTotal is 0 if unknown.
+                                   * \return Returns false if no task is running.
+                                   */
+  bool                            GetTaskProgress(std::string& rName, u64& rDone, u64& rTotal) const;
+
   bool                            Start(
     BinaryStream::SPType spBinaryStream,
     Database::SPType spDatabase,
@@ -93,6 +105,11 @@ public:
                                    */
   void                            Analyze(Address const& rAddr, Architecture::SPType spArch = nullptr, u8 Mode = 0);
 
+                                  /*! This method updates functions affected by modified cells, the rest of the document is left untouched.
+                                   * \param rModifiedAddresses contains addresses of cells modified by the user.
+                                   */
+  void                            Reanalyze(Address::List const& rModifiedAddresses);
+
                                   /*! This method builds a control flow graph from an address.
                                    * \param rAddr is the start address.
                                    * \param rCfg is the filled control flow graph.
@@ -120,6 +137,12 @@ public:
   Address                         MakeAddress(Loader::SPType pLoader, Architecture::SPType pArch, TBase Base, TOffset Offset);
 
   bool                            CreateFunction(Address const& rAddr);
+
+                                  /*! This method names known functions using a signature file.
+                                   * \param rSignaturePath is the path of a file saved with SignatureDatabase::Save.
+                                   * \return Returns true if the signature file is loaded, the matching is done asynchronously.
+                                   */
+  bool                            ApplySignatures(Path const& rSignaturePath);
   void                            FindFunctionAddressFromAddress(Address::List& rFunctionAddress, Address const& rAddress) const;
 
   bool                            MakeAsciiString(Address const& rAddr)
@@ -36,6 +36,7 @@ public:
   };
 
   typedef std::function<void (TOffset, CellData::SPType)> CellDataPredicat;
+  typedef std::function<bool (TOffset, CellData::SPType)> CellDataRangePredicat;
 
   MemoryArea(
     std::string const& rName,
@@ -62,6 +63,10 @@ public:
   virtual bool           SetCellData(TOffset Offset, CellData::SPType spCell, Address::List& rDeletedCellAddresses, bool Force) = 0;
   virtual void           ForEachCellData(CellDataPredicat Predicat) const = 0;
 
+  //! This method calls Predicat for each cell which overlaps [BeginOffset, EndOffset) until it returns false.
+  //! The first cell can start before BeginOffset, bytes which belong to no cell are skipped.
+  void ForEachCellDataInRange(TOffset BeginOffset, TOffset EndOffset, CellDataRangePredicat Predicat) const;
+
   bool IsCellPresent(Address const& rAddress) const
   {
     if (GetBaseAddress().GetBase() != rAddress.GetBase())
@@ -104,6 +109,7 @@ public:
     : MemoryArea(rName, Access, DefaultArchitectureTag, DefaultArchitectureMode)
     , m_FileOffset(FileOffset), m_FileSize(FileSize)
     , m_VirtualBase(rVirtualBase), m_VirtualSize(VirtualSize)
+    , m_MaxCellLength(1)
   {}
 
   virtual ~MappedMemoryArea(void);
@@ -141,11 +147,66 @@ protected:
   Address            m_VirtualBase;
   u32                m_VirtualSize;
   CellDataVectorType m_Cells;
+  u16                m_MaxCellLength; //! a cell can't overlap an offset further than this
 
   typedef std::mutex MutexType;
   mutable MutexType m_Mutex;
 };
 
+//! BankedMemoryArea is a switchable window (e.g. ROM banks of a cartridge), it behaves like a MappedMemoryArea
+//! for its default bank (the base of the window address) and other banks are mapped the first time they're
+//! referenced (see Document::MapMemoryArea), so unused banks cost nothing.
+//! Bank registers tell which writes select a bank, addresses outside the window are located in bank 0.
+class Medusa_EXPORT BankedMemoryArea : public MappedMemoryArea
+{
+public:
+  struct BankRegister
+  {
+    TOffset m_Begin;     //! first written offset which selects the bank
+    TOffset m_End;       //! excluded
+    u8      m_Shift;     //! position of the written bits in the bank number
+    u16     m_Mask;      //! written bits which are kept
+    bool    m_ZeroIsOne; //! selecting 0 selects 1 (e.g. GameBoy MBC1)
+  };
+  typedef std::vector<BankRegister> BankRegisterVectorType;
+
+  //! FileOffset is the offset of bank 0, banks are contiguous in the file and are named rPrefix followed by their number.
+  BankedMemoryArea(
+    std::string const& rPrefix,
+    TOffset FileOffset, u32 BankSize,
+    Address const& rWindowBase, TBank BankNo,
+    u32 Access,
+    Tag DefaultArchitectureTag = MEDUSA_ARCH_UNK,
+    u8 DefaultArchitectureMode = 0
+    );
+
+  virtual ~BankedMemoryArea(void);
+
+  virtual std::string Dump(void) const;
+
+  TBank GetBankNumber(void) const  { return m_BankNo; }
+  TBank GetDefaultBank(void) const { return m_VirtualBase.GetBase(); }
+  bool  IsInWindow(TOffset Offset) const { return m_VirtualBase.IsBetween(m_VirtualSize, Offset); }
+
+  void                          AddBankRegister(BankRegister const& rBankReg) { m_BankRegs.push_back(rBankReg); }
+  BankRegisterVectorType const& GetBankRegisters(void) const { return m_BankRegs; }
+
+  //! This method updates rBank if Offset is a bank register, it returns false otherwise.
+  bool SelectBank(TOffset Offset, u64 Value, TBank& rBank) const;
+
+  //! This method returns rAddress in Bank if it's located in the window, and in bank 0 otherwise.
+  Address ResolveAddress(Address const& rAddress, TBank Bank) const;
+
+  //! This method returns a new memory area for Bank, or nullptr if Bank is the default one or doesn't exist.
+  MemoryArea* MakeBankMemoryArea(TBank Bank) const;
+
+private:
+  std::string            m_Prefix;
+  TOffset                m_BankFileOffset;
+  TBank                  m_BankNo;
+  BankRegisterVectorType m_BankRegs;
+};
+
 class Medusa_EXPORT VirtualMemoryArea : public MemoryArea
 {
 public:
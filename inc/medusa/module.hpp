@@ -10,6 +10,8 @@
 #include "medusa/exception.hpp"
 #include "medusa/export.hpp"
 #include <map>
+#include <set>
+#include <vector>
 
 MEDUSA_NAMESPACE_BEGIN
 
@@ -75,7 +77,7 @@ DECL_MODULE_TRAITS(OperatingSystemModuleTraits, TGetOperatingSystem, "os_",   "G
 class Medusa_EXPORT ModuleManager
 {
 private:
-  ModuleManager(void) : m_ArchIdPool(0x0), m_DefaultArchitectureTag(MEDUSA_ARCH_UNK) {}
+  ModuleManager(void) : m_Instantiated(false), m_ArchIdPool(0x0), m_DefaultArchitectureTag(MEDUSA_ARCH_UNK) {}
   ~ModuleManager(void) {}
   ModuleManager(ModuleManager const&);
   ModuleManager& operator=(ModuleManager const&);
@@ -83,6 +85,19 @@ private:
 public:
   typedef std::map<std::string, TGetEmulator> EmulatorMap;
 
+  //! ModuleDescriptor is kept for each loaded module, only the factory of its kind is set.
+  //! Modules are loaded once per process, then instances are created from their factory.
+  struct ModuleDescriptor
+  {
+    Path                m_Path;
+    std::string         m_Name;
+    TGetLoader          m_pGetLoader;
+    TGetArchitecture    m_pGetArchitecture;
+    TGetOperatingSystem m_pGetOperatingSystem;
+    TGetEmulator        m_pGetEmulator;
+    TGetDatabase        m_pGetDatabase;
+  };
+  typedef std::vector<ModuleDescriptor> ModuleDescriptorVector;
 
   static ModuleManager& Instance(void)
   {
@@ -116,6 +131,24 @@ public:
     return (ExportedFunctionType)Mod.Load<ExportedFunctionType>(pModHandle, ModuleType::GetExportedFunctionName());
   }
 
+  //! This method loads the modules of a directory, it does nothing if the directory is already registered.
+  bool                   RegisterModules(Path const& rModPath);
+  ModuleDescriptorVector GetModuleDescriptors(void) const;
+
+  //! This method returns new instances of compatible loaders, the most specific first.
+  //! Each loader is probed in parallel, and it only keeps the state of rBinStrm.
+  Loader::VSPType        ProbeLoaders(BinaryStream const& rBinStrm) const;
+
+  //! These methods return new instances, so they can be used by several documents at once.
+  Architecture::VSPType  MakeArchitectures(void) const;
+  Database::SPType       MakeDatabase(std::string const& rDatabaseName) const;
+  Database::VSPType      MakeDatabases(void) const;
+  OperatingSystem::SPType MakeOperatingSystem(Loader::SPType spLdr, Architecture::SPType spArch) const;
+
+  //! This method instantiates the modules of a directory once and registers their architectures,
+  //! architectures and operating systems are then only read, so documents can share them.
+  bool                   ShareModules(Path const& rModPath);
+
   void LoadDatabases(boost::filesystem::path const& rModPath); // TODO: since we can't afford to have binstrm, we should change this method name
   void LoadModules(boost::filesystem::path const& rModPath, BinaryStream const& rBinStrm);
   void UnloadModules(void);
@@ -137,8 +170,14 @@ public:
   Architecture::VSPType GetArchitectures(void) const;
 
 private:
+  void _InstantiateModules(void);
+
   typedef std::mutex MutexType;
-  MutexType                        m_Mutex;
+  mutable MutexType                m_Mutex;
+
+  std::set<Path>                   m_ModulePaths;
+  ModuleDescriptorVector           m_Descriptors;
+  bool                             m_Instantiated;
 
   u32                              m_ArchIdPool;
   Tag                              m_DefaultArchitectureTag;
@@ -151,6 +190,29 @@ private:
   EmulatorMap                      m_Emulators;
 };
 
+//! BatchSession selects modules for many documents, they're only loaded by the first session.
+//! Architectures and operating systems are shared, every document gets its own loader and
+//! database, so sessions can be used from several threads.
+class Medusa_EXPORT BatchSession
+{
+public:
+  BatchSession(Path const& rModPath);
+
+  bool        IsReady(void)       const { return m_Ready;   }
+  Path const& GetModulePath(void) const { return m_ModPath; }
+
+  //! This method selects the most specific loader which supports at least one architecture.
+  bool SelectModules(BinaryStream const& rBinStrm,
+    Loader::SPType& rspLoader, Architecture::VSPType& rArchitectures, OperatingSystem::SPType& rspOperatingSystem) const;
+
+  Loader::VSPType  ProbeLoaders(BinaryStream const& rBinStrm) const;
+  Database::SPType MakeDatabase(std::string const& rDatabaseName) const;
+
+private:
+  Path m_ModPath;
+  bool m_Ready;
+};
+
 MEDUSA_NAMESPACE_END
 
 #endif // MEDUSA_MODULE_HPP
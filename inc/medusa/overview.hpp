@@ -0,0 +1,106 @@
+#ifndef MEDUSA_OVERVIEW_HPP
+#define MEDUSA_OVERVIEW_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+#include "medusa/cell.hpp"
+
+#include <mutex>
+#include <set>
+#include <vector>
+
+MEDUSA_NAMESPACE_BEGIN
+
+class Document;
+class MemoryArea;
+
+//! Overview splits the bytes of all memory areas in a fixed number of buckets and counts how
+//! many bytes of each cell type they contain, e.g. one bucket per pixel of a scrollbar.
+//! Buckets which contain modified addresses are only counted again on the next query, and
+//! are reported as changed so a view only redraws them.
+class Medusa_EXPORT Overview
+{
+public:
+  enum
+  {
+    DefaultBucketNo = 0x400,
+    CellTypeNo      = Cell::StringType + 1,
+  };
+
+  struct Medusa_EXPORT Bucket
+  {
+    Bucket(void) { Clear(); }
+
+    void Clear(void);
+    u64  GetSize(void) const;
+    //! This method returns the cell type which covers the most bytes.
+    u8   GetMainCellType(void) const;
+
+    bool operator==(Bucket const& rBucket) const;
+    bool operator!=(Bucket const& rBucket) const { return !(*this == rBucket); }
+
+    u64  m_Sizes[CellTypeNo]; //! number of bytes of each cell type
+  };
+
+  Overview(Document const& rDoc, u32 BucketNo = DefaultBucketNo);
+
+  //! This method must be called when memory areas change, buckets are counted again on the next query.
+  void Invalidate(void);
+
+  //! This method marks buckets which contain modified addresses.
+  void Update(Address::List const& rAddresses);
+
+  //! This method changes the number of buckets, they're counted again on the next query.
+  void SetNumberOfBuckets(u32 BucketNo);
+  //! This method returns the number of buckets actually used, it can be lower for tiny documents.
+  u32  GetNumberOfBuckets(void);
+
+  bool GetBucket(u32 BucketIndex, Bucket& rBucket);
+
+  /*! This method retrieves buckets whose content changed since the previous call.
+   * \param rBucketIndexes receives the indexes, all buckets are returned after a rebuild.
+   */
+  void GetChangedBuckets(std::vector<u32>& rBucketIndexes);
+
+  //! This method returns the sum of all buckets, i.e. the coverage of the document.
+  Bucket GetStatistics(void);
+
+  bool ConvertAddressToBucket(Address const& rAddress, u32& rBucketIndex);
+
+  //! This method returns the address of the cell which contains the first byte of a bucket.
+  bool ConvertBucketToAddress(u32 BucketIndex, Address& rAddress);
+
+private:
+  struct Area
+  {
+    MemoryArea const* m_pMemArea;
+    TOffset           m_BaseOffset;
+    u32               m_Size;
+    u64               m_Position; //! position of the first byte among all memory areas
+  };
+
+  bool  _Prepare(void);
+  void  _Build(void);
+  void  _CountBucket(u32 BucketIndex, Bucket& rBucket) const;
+  void  _CountRange(Area const& rArea, TOffset BeginOffset, TOffset EndOffset, Bucket& rBucket) const;
+  bool  _ConvertAddressToPosition(Address const& rAddress, u64& rPosition) const;
+
+  Document const&     m_rDoc;
+  u32                 m_BucketNo;
+  u64                 m_BucketSize;  //! number of bytes of a bucket
+  bool                m_IsBuilt;
+
+  std::vector<Area>   m_Areas;
+  std::vector<Bucket> m_Buckets;
+  std::set<u32>       m_DirtyBuckets;
+  std::set<u32>       m_ChangedBuckets;
+
+  typedef std::mutex MutexType;
+  mutable MutexType m_Mutex;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_OVERVIEW_HPP
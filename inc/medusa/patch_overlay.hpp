@@ -0,0 +1,115 @@
+#ifndef MEDUSA_PATCH_OVERLAY_HPP
+#define MEDUSA_PATCH_OVERLAY_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+MEDUSA_NAMESPACE_BEGIN
+
+class BinaryStream;
+
+//! PatchOverlay holds the modifications of a binary stream, the original content is never written.
+//! A page is copied on its first write, then reads look up a bitmap to know if they must be
+//! patched, so reading an unmodified page doesn't take any lock.
+class Medusa_EXPORT PatchOverlay
+{
+public:
+  typedef std::shared_ptr<PatchOverlay> SPType;
+
+  enum : u64
+  {
+    PageBits = 12,
+    PageSize = 1 << PageBits,
+  };
+
+  //! Patch is a run of modified bytes, a list of patches is the diff saved in databases.
+  struct Patch
+  {
+    TOffset         m_Offset;
+    std::vector<u8> m_Data;
+  };
+  typedef std::vector<Patch> PatchVector;
+
+  //! rOrigin provides the original content, it must outlive the overlay.
+  PatchOverlay(BinaryStream const& rOrigin);
+  ~PatchOverlay(void);
+
+  //! This method drops all patches and the history, it must be called when the origin is reopened.
+  void Reset(void);
+
+  bool IsEmpty(void) const { return m_PageNo.load(std::memory_order_acquire) == 0; }
+  u64  GetPageNo(void) const { return m_PageNo.load(std::memory_order_acquire); }
+
+  //! This method returns true if at least one byte of the range lies in a copied page.
+  bool IsPatched(TOffset Offset, u64 Length) const
+  {
+    if (IsEmpty() || Length == 0)
+      return false;
+    return _IsPatched(Offset, Length);
+  }
+
+  //! This method copies the patched bytes of the range over pData, which holds the original ones.
+  void Apply(TOffset Offset, u8* pData, u64 Length) const;
+
+  //! This method writes the range in copied pages, the range must be checked by the caller.
+  //! If Record is false, the write can't be undone (e.g. when patches are loaded).
+  bool Write(TOffset Offset, u8 const* pData, u64 Length, bool Record = true);
+
+  //! These methods restore the state before or after the last write, they return false if there's none.
+  bool   Undo(void);
+  bool   Redo(void);
+  size_t GetUndoNo(void) const;
+  size_t GetRedoNo(void) const;
+  void   ClearHistory(void);
+
+  //! This method returns the bytes which differ from the origin, sorted by offset.
+  bool GetPatches(PatchVector& rPatches) const;
+
+  //! This method writes patches without recording them in the history.
+  bool ApplyPatches(PatchVector const& rPatches);
+
+private:
+  struct Step
+  {
+    TOffset          m_Offset;
+    std::vector<u8>  m_OldData;
+    std::vector<u8>  m_NewData;
+    std::vector<u64> m_NewPages; //! pages copied by this step, they're dropped when it's undone
+  };
+
+  bool _IsPatched(TOffset Offset, u64 Length) const;
+  bool _IsPagePatched(u64 PageIdx) const;
+  bool _Write(TOffset Offset, u8 const* pData, u64 Length, std::vector<u64>* pNewPages);
+  void _Read(TOffset Offset, u8* pData, u64 Length) const;
+  void _DropPage(u64 PageIdx);
+
+  typedef std::unordered_map<u64, std::unique_ptr<u8[]>> PageMap;
+
+  BinaryStream const&                  m_rOrigin;
+
+  //! Bits of copied pages, it's allocated on the first write and read without lock
+  std::unique_ptr<std::atomic<u64>[]> m_spBitmap;
+  u64                                  m_BitmapSize;
+  std::atomic<u64>                     m_PageNo;
+
+  PageMap                              m_Pages;
+  std::vector<Step>                    m_UndoSteps;
+  std::vector<Step>                    m_RedoSteps;
+
+  typedef std::mutex MutexType;
+  mutable MutexType                    m_Mutex;
+
+  PatchOverlay(PatchOverlay const&);
+  PatchOverlay& operator=(PatchOverlay const&);
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_PATCH_OVERLAY_HPP
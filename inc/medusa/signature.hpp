@@ -0,0 +1,125 @@
+#ifndef MEDUSA_SIGNATURE_HPP
+#define MEDUSA_SIGNATURE_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/address.hpp"
+#include "medusa/document.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+MEDUSA_NAMESPACE_BEGIN
+
+//! Signature is a masked byte pattern which identifies a known function.
+class Medusa_EXPORT Signature
+{
+public:
+  typedef std::vector<Signature> List;
+
+  Signature(std::string const& rName = "");
+
+  /*! This method builds the signature from a disassembled function.
+   * Operand bytes which could be modified by a relocation (immediate,
+   * displacement, relative and absolute values) are wildcarded.
+   * \param rDoc contains the disassembled function.
+   * \param rFuncAddr is the address of the function.
+   * \param MaxLength is the maximum length of the signature in bytes.
+   * \return Returns true if at least one byte was added, otherwise false.
+   */
+  bool Build(Document const& rDoc, Address const& rFuncAddr, u32 MaxLength = DefaultLength);
+
+  //! This method appends a byte, set IsWildcard if this byte must be ignored while matching.
+  void AddByte(u8 Byte, bool IsWildcard = false);
+
+  bool Match(u8 const* pBuffer, u32 Length) const;
+
+  std::string const&      GetName(void)   const { return m_Name;          }
+  u32                     GetLength(void) const { return static_cast<u32>(m_Bytes.size()); }
+  std::vector<u8> const&  GetBytes(void)  const { return m_Bytes;         }
+  std::vector<u8> const&  GetMask(void)   const { return m_Mask;          }
+
+  std::string ToString(void) const;
+
+  enum { DefaultLength = 32, MinimumLength = 8 };
+
+private:
+  std::string     m_Name;
+  std::vector<u8> m_Bytes;
+  std::vector<u8> m_Mask;  //! 0xff means significant byte, 0x00 means wildcard
+};
+
+//! SignatureDatabase stores signatures in a compact trie which can be saved to disk.
+class Medusa_EXPORT SignatureDatabase
+{
+public:
+  typedef std::shared_ptr<SignatureDatabase> SPType;
+
+  SignatureDatabase(void);
+
+  /*! This method adds a signature to the trie.
+   * If two different functions share the same pattern, the pattern is marked as
+   * ambiguous and is never reported as a match.
+   */
+  bool Add(Signature const& rSig);
+
+  /*! This method generates signatures for all named functions of a document.
+   * Auto-generated labels (fcn_xxxx) are skipped since they don't carry information.
+   * \return Returns the number of added signatures.
+   */
+  u32  AddDocument(Document const& rDoc, u32 MaxLength = Signature::DefaultLength);
+
+  /*! This method looks for the longest signature which matches the buffer.
+   * \param pBuffer points to the beginning of the function.
+   * \param Length is the number of readable bytes.
+   * \param rName is set to the name of the matched function.
+   * \return Returns true if an unique signature matches, otherwise false.
+   */
+  bool Match(u8 const* pBuffer, u32 Length, std::string& rName) const;
+
+  bool Load(Path const& rPath);
+  bool Save(Path const& rPath) const;
+
+  u32  GetNumberOfSignatures(void) const { return m_SignatureCounter; }
+  u32  GetNumberOfNodes(void)      const { return static_cast<u32>(m_Nodes.size()); }
+  u32  GetMaximumLength(void)      const { return m_MaxLength; }
+
+private:
+  enum
+  {
+    NoNode      = 0xffffffff,
+    NoName      = 0xffffffff,
+    Ambiguous   = 0xfffffffe,
+  };
+
+  enum NodeFlags
+  {
+    NodeNone     = 0,
+    NodeWildcard = 1 << 0,
+  };
+
+  // OPTIMIZEME: children are linked by sibling, it could be slow for nodes with lots of children
+  struct Node
+  {
+    u32 m_FirstChild;
+    u32 m_NextSibling;
+    u32 m_NameIndex;
+    u8  m_Value;
+    u8  m_Flags;
+  };
+
+  u32  _FindChild(u32 NodeIdx, u8 Value, u8 Flags) const;
+  u32  _AddChild(u32 NodeIdx, u8 Value, u8 Flags);
+  void _Match(u32 NodeIdx, u8 const* pBuffer, u32 Length, u32 Depth, u32& rBestDepth, u32& rBestName) const;
+
+  std::vector<Node>        m_Nodes;
+  std::vector<std::string> m_Names;
+  u32                      m_SignatureCounter;
+  u32                      m_MaxLength;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_SIGNATURE_HPP
@@ -0,0 +1,96 @@
+#ifndef MEDUSA_STREAM_ANALYZER_HPP
+#define MEDUSA_STREAM_ANALYZER_HPP
+
+#include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
+#include "medusa/architecture.hpp"
+#include "medusa/configuration.hpp"
+#include "medusa/database.hpp"
+#include "medusa/document.hpp"
+#include "medusa/task.hpp"
+
+#include <algorithm>
+#include <string>
+
+MEDUSA_NAMESPACE_BEGIN
+
+//! StreamAnalyzer analyzes mapped memory areas window by window, it's used for raw images (e.g. flash dumps)
+//! which are too large to keep a cell slot for each byte. Code is found by linear sweep and strings by
+//! looking for terminated printable characters. Results are written to the database as soon as they're
+//! found (see Database::BeginStream), so the memory used only depends on the budget, not on the file.
+class Medusa_EXPORT StreamAnalyzer : public Task
+{
+public:
+  enum : u64
+  {
+    DefaultMemoryBudget = 0x10000000, //! 256 MB
+    MinimumMemoryBudget = 0x100000,   //! 1 MB
+  };
+
+  enum : u32
+  {
+    DefaultOverlap       = 0x1000,
+    MinimumOverlap       = 0x20,   //! an instruction must fit in it
+    DefaultInstructionNo = 8,
+    DefaultStringLength  = 5,
+    PaddingLength        = 4,      //! shorter runs of 00 or ff bytes can be code
+  };
+
+  struct Statistics
+  {
+    u64 m_WindowNo;
+    u64 m_ByteNo;
+    u64 m_InstructionNo;
+    u64 m_CodeNo;        //! runs of instructions kept as code
+    u64 m_StringNo;
+    u64 m_PeakMemory;    //! size of the largest window buffer in bytes
+  };
+
+  //! spArch is used for memory areas which don't have their own architecture.
+  StreamAnalyzer(Document& rDoc, Database::SPType spDb, Architecture::SPType spArch);
+  virtual ~StreamAnalyzer(void);
+
+  virtual std::string GetName(void) const;
+  virtual void Run(void);
+
+  //! This method reads the options "Memory budget" and "Window overlap" if they're present, see RawLoader.
+  void Configure(ConfigurationModel const& rCfgMdl);
+
+  //! The budget is in bytes, half of it is used for the window and the rest is left to the modules and the database.
+  void SetMemoryBudget(u64 MemoryBudget)       { m_MemoryBudget = std::max<u64>(MemoryBudget, MinimumMemoryBudget); }
+  //! The overlap is only read ahead, so an instruction or a string can cross the end of a window.
+  void SetOverlap(u32 Overlap)                 { m_Overlap = std::max<u32>(Overlap, MinimumOverlap); }
+  //! Shorter runs of valid instructions are considered as data.
+  void SetMinimumInstructionNo(u32 InstructionNo) { m_MinInsnNo = std::max<u32>(InstructionNo, 1); }
+  //! The terminator is not counted.
+  void SetMinimumStringLength(u32 StringLength)   { m_MinStrLen = std::max<u32>(StringLength, 1); }
+
+  u64 GetWindowSize(void) const { return ComputeWindowSize(m_MemoryBudget, m_Overlap); }
+  Statistics const& GetStatistics(void) const { return m_Stats; }
+
+  //! This method returns false if the database doesn't support streaming or if it failed while writing.
+  bool IsSucceeded(void) const { return m_IsSucceeded; }
+
+  //! The window plus its overlap never exceeds half of the budget.
+  static u64 ComputeWindowSize(u64 MemoryBudget, u32 Overlap);
+
+private:
+  class Window;
+
+  bool _AnalyzeMemoryArea(MemoryArea const& rMemArea, Window& rWin);
+
+  Document&            m_rDoc;
+  Database::SPType     m_spDb;
+  Architecture::SPType m_spArch;
+  u64                  m_MemoryBudget;
+  u32                  m_Overlap;
+  u32                  m_MinInsnNo;
+  u32                  m_MinStrLen;
+  Statistics           m_Stats;
+  bool                 m_IsSucceeded;
+};
+
+MEDUSA_NAMESPACE_END
+
+#endif // !MEDUSA_STREAM_ANALYZER_HPP
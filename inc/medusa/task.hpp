@@ -2,45 +2,137 @@
 #define MEDUSA_TASK_HPP
 
 #include "medusa/namespace.hpp"
+#include "medusa/types.hpp"
+#include "medusa/export.hpp"
 
 #include <iostream>
 #include <thread>
 #include <queue>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <mutex>
 
 MEDUSA_NAMESPACE_BEGIN
 
-class Task
+//! CancellationToken is shared between a task and the sub-tasks it runs, so they stop together.
+class Medusa_EXPORT CancellationToken
 {
 public:
+  typedef std::shared_ptr<CancellationToken> SPType;
+  typedef std::chrono::steady_clock          ClockType;
+
+  CancellationToken(void);
+
+  void Cancel(void) { m_IsCancelled = true; }
+
+  //! This method sets the time after which the token is cancelled, an earlier deadline is kept.
+  void SetDeadline(ClockType::time_point Deadline);
+
+  //! This method returns true if the token was cancelled or if its deadline is exceeded.
+  bool IsCancelled(void) const;
+  bool IsTimedOut(void) const;
+
+  //! These methods return true if IsCancelled or IsTimedOut already returned true for this reason.
+  bool WasCancelled(void) const { return m_WasCancelled; }
+  bool WasTimedOut(void) const  { return m_WasTimedOut;  }
+
+private:
+  std::atomic<bool>            m_IsCancelled;
+  std::atomic<ClockType::rep>  m_Deadline; //! 0 means no deadline
+  mutable std::atomic<bool>    m_WasCancelled;
+  mutable std::atomic<bool>    m_WasTimedOut;
+};
+
+class Medusa_EXPORT Task
+{
+  friend class TaskManager;
+
+public:
+  enum Status
+  {
+    Started,
+    Done,
+    Cancelled,
+    TimedOut,
+  };
+
+  Task(void);
   virtual ~Task(void) {}
   virtual std::string GetName(void) const = 0;
   virtual void Run(void) = 0;
+
+  //! Progress is counted in units chosen by each task, the total is only an estimation.
+  void SetTotal(u64 Total)      { m_Total = Total;  }
+  void AddToTotal(u64 Count)    { m_Total += Count; }
+  void Advance(u64 Count = 1)   { m_Done += Count;  }
+  u64  GetTotal(void) const     { return m_Total;   }
+  u64  GetDone(void) const      { return m_Done;    }
+
+  void Cancel(void)                                            { m_spToken->Cancel(); }
+  void SetDeadline(CancellationToken::ClockType::time_point Deadline) { m_spToken->SetDeadline(Deadline); }
+
+  //! Long loops must check this method and return as soon as it's true.
+  bool IsCancelled(void) const { return m_spToken->IsCancelled(); }
+
+  CancellationToken::SPType GetCancellationToken(void) const { return m_spToken; }
+  void SetCancellationToken(CancellationToken::SPType spToken) { m_spToken = spToken; }
+
+  //! This method returns Started until the task is run, then its final status.
+  u8 GetStatus(void) const { return m_Status; }
+
+private:
+  //! This method computes the final status from the checks done by Run.
+  u8 _ComputeStatus(void) const;
+
+  std::atomic<u8>           m_Status;
+  std::atomic<u64>          m_Done;
+  std::atomic<u64>          m_Total;
+  CancellationToken::SPType m_spToken;
 };
 
-class TaskManager
+class Medusa_EXPORT TaskManager
 {
 public:
-  typedef std::function<void (Task const*)> NotifyFunctionType;
+  //! This function is called with Task::Started before a task is run, and with its final status after.
+  typedef std::function<void (Task const*, u8 Status)> NotifyFunctionType;
 
   TaskManager(NotifyFunctionType const& rNotify);
   ~TaskManager(void);
 
   void Start(void);
   void Stop(void);
+
+  //! This method waits until all queued tasks are run, the manager keeps accepting new tasks.
   void Wait(void);
 
   void AddTask(Task* pTask);
 
+  void CancelCurrentTask(void);
+
+  //! This method cancels the current task and removes all queued ones.
+  void CancelAllTasks(void);
+
+  //! This method cancels each task which runs longer than Timeout, the running one included.
+  //! A zero timeout removes it for the next tasks.
+  void SetTimeout(CancellationToken::ClockType::duration Timeout);
+
+  bool GetCurrentTaskProgress(std::string& rName, u64& rDone, u64& rTotal) const;
+
 private:
+  void _RunTask(Task* pTask);
+
   std::atomic<bool>       m_Running;
   std::thread             m_Thread;
   std::condition_variable m_CondVar;
+  std::condition_variable m_IdleCondVar;
   std::queue<Task*>       m_Tasks;
-  std::mutex              m_Mutex;
+  mutable std::mutex      m_Mutex;
   NotifyFunctionType      m_Notify;
+  Task*                   m_pCurTask;
+  CancellationToken::ClockType::duration m_Timeout; //! zero means no timeout
 };
 
 MEDUSA_NAMESPACE_END
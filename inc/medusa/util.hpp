@@ -7,6 +7,7 @@
 #include <medusa/log.hpp>
 
 #include <string>
+#include <functional>
 
 
 MEDUSA_NAMESPACE_BEGIN
@@ -19,9 +20,17 @@ std::string Medusa_EXPORT Base64Decode(std::string const &rBase64Data);
 
 std::string Medusa_EXPORT Sha1(void const *pData, size_t Length);
 Id          Medusa_EXPORT Sha1(std::string const &Name);
+//! This function computes the SHA1 of data read by chunks, Reader returns the number of bytes read or 0 at the end.
+std::string Medusa_EXPORT Sha1Chunks(std::function<size_t (void* pBuffer, size_t BufferSize)> Reader);
+
+//! This function computes the 64-bit FNV-1a hash of data, Hash allows to chain several buffers.
+u64         Medusa_EXPORT Fnv1a(void const *pData, size_t Length, u64 Hash = 0xcbf29ce484222325ULL);
 
 Id          Medusa_EXPORT RandomId(void);
 
+//! This function splits [0, Count) in chunks and runs Callback on each of them in parallel.
+void        Medusa_EXPORT ParallelFor(size_t Count, std::function<void (size_t Begin, size_t End)> Callback);
+
 MEDUSA_NAMESPACE_END
 
 #endif // !MEDUSA_UTIL_HPP
\ No newline at end of file
@@ -121,8 +121,16 @@ bool GameBoyArchitecture::GameBoyCpuInformation::IsRegisterAliased(u32 Id0, u32
   return false;
 }
 
+// The bank of an address in the switchable window (4000-7fff) tells which part of the ROM is used
 bool GameBoyArchitecture::Translate(Address const& rVirtAddr, TOffset& rPhysOff)
 {
+  TOffset Offset = rVirtAddr.GetOffset();
+  if (Offset < 0x4000)
+    rPhysOff = Offset;
+  else if (Offset < 0x8000)
+    rPhysOff = rVirtAddr.GetBase() * 0x4000 + (Offset - 0x4000);
+  else
+    return false;
   return true;
 }
 
@@ -7,14 +7,110 @@
 #include "medusa/log.hpp"
 #include "medusa/module.hpp"
 #include "medusa/symbolic.hpp"
+#include "medusa/jump_table.hpp"
+#include "medusa/os.hpp"
+#include "medusa/util.hpp"
 
+#include <algorithm>
 #include <list>
+#include <map>
+#include <set>
 #include <stack>
+#include <chrono>
 
 #include <boost/foreach.hpp>
 
 MEDUSA_NAMESPACE_BEGIN
 
+typedef std::vector<std::pair<Address, Label>> LabelVectorType;
+
+// Labels are collected before being analyzed, so a task knows its amount of work and can stop between two labels
+static LabelVectorType CollectLabels(Document const& rDoc, std::function<bool (Label const& rLabel)> Predicate)
+{
+  LabelVectorType Labels;
+  rDoc.ForEachLabel([&](Address const& rAddress, Label const& rLabel)
+  {
+    if (Predicate(rLabel))
+      Labels.push_back(std::make_pair(rAddress, rLabel));
+  });
+  return Labels;
+}
+
+// References are made from an instruction or one of its operands, so they're located in its first bytes.
+// The longest instruction of the supported architectures is 15 bytes (x86), others are at most 4 bytes
+// (ARM, AVR8) or 3 bytes (GameBoy), so no reference is made further than this from the start of a cell.
+static u32 const MaxReferenceOffset = 15;
+
+static bool IsFunctionLabel(Label const& rLabel)
+{
+  u16 LblType = rLabel.GetType() & Label::CellMask;
+  bool IsExported = ((rLabel.GetType() & Label::AccessMask) == Label::Exported) ? true : false;
+  bool IsGlobal   = ((rLabel.GetType() & Label::AccessMask) == Label::Global)   ? true : false;
+
+  return LblType == Label::Function || ((LblType == Label::Code) && (IsExported || IsGlobal));
+}
+
+typedef std::map<u32, u64> RegisterValueMapType;
+
+// Only constants assigned to registers are followed, which is enough for the usual
+// "ld a, n / ld (nn), a" sequence, an instruction without semantic forgets everything
+static void TrackBankSwitch(Instruction const& rInsn, BankedMemoryArea const& rBankedMemArea, RegisterValueMapType& rRegVals, TBank& rBank)
+{
+  auto const& rSem = rInsn.GetSemantic();
+  if (rSem.empty())
+  {
+    rRegVals.clear();
+    return;
+  }
+
+  auto GetValue = [&rRegVals](Expression::SPType spExpr, u64& rValue) -> bool
+  {
+    if (auto spConstExpr = expr_cast<ConstantExpression>(spExpr))
+    {
+      rValue = spConstExpr->GetConstant();
+      return true;
+    }
+    if (auto spIdExpr = expr_cast<IdentifierExpression>(spExpr))
+    {
+      auto itRegVal = rRegVals.find(spIdExpr->GetId());
+      if (itRegVal == std::end(rRegVals))
+        return false;
+      rValue = itRegVal->second;
+      return true;
+    }
+    return false;
+  };
+
+  for (auto spExpr : rSem)
+  {
+    auto spAssignExpr = expr_cast<AssignmentExpression>(spExpr);
+    if (spAssignExpr == nullptr)
+    {
+      rRegVals.clear();
+      continue;
+    }
+
+    u64 Value;
+    bool IsKnown = GetValue(spAssignExpr->GetSourceExpression(), Value);
+    auto spDstExpr = spAssignExpr->GetDestinationExpression();
+
+    if (auto spIdExpr = expr_cast<IdentifierExpression>(spDstExpr))
+    {
+      if (IsKnown)
+        rRegVals[spIdExpr->GetId()] = Value;
+      else
+        rRegVals.erase(spIdExpr->GetId());
+      continue;
+    }
+
+    u64 RegOff;
+    auto spMemExpr = expr_cast<MemoryExpression>(spDstExpr);
+    if (spMemExpr == nullptr || !IsKnown || !GetValue(spMemExpr->GetOffsetExpression(), RegOff))
+      continue;
+    rBankedMemArea.SelectBank(RegOff, Value, rBank);
+  }
+}
+
 Analyzer::MakeFunctionTask::MakeFunctionTask(Document& rDoc, Address const& rFuncAddr)
   : m_rDoc(rDoc), m_Addr(rFuncAddr)
 {
@@ -34,14 +130,17 @@ void Analyzer::MakeFunctionTask::Run(void)
   CreateFunction(m_Addr);
 }
 
-bool Analyzer::MakeFunctionTask::CreateFunction(Address const& rAddr)
+bool Analyzer::MakeFunctionTask::CreateFunction(Address const& rAddr, bool Force)
 {
-  Address FuncEnd;
-  u16 FuncLen;
-  u16 InsnCnt;
+  // Basic blocks are recorded here once, so the function length and its control flow graph
+  // don't require to walk the function again
+  FunctionGraph FuncGraph;
 
-  if (ComputeFunctionLength(rAddr, FuncEnd, FuncLen, InsnCnt, 0x1000) == true)
+  if (FuncGraph.Build(m_rDoc, rAddr, 0x1000) && (FuncGraph.HasReturn() || FuncGraph.HasUnresolvedJump()))
   {
+    u16 FuncLen = static_cast<u16>(FuncGraph.GetLength());
+    u16 InsnCnt = static_cast<u16>(FuncGraph.GetNumberOfInstructions());
+
     Log::Write("core")
       << "Function found"
       << ": address="               << rAddr.ToString()
@@ -51,8 +150,9 @@ bool Analyzer::MakeFunctionTask::CreateFunction(Address const& rAddr)
 
     Label FuncLbl(rAddr, Label::Function | Label::Global);
     Function* pFunction = new Function(FuncLbl.GetLabel(), FuncLen, InsnCnt);
-    m_rDoc.SetMultiCell(rAddr, pFunction, false);
+    m_rDoc.SetMultiCell(rAddr, pFunction, Force);
     m_rDoc.AddLabel(rAddr, FuncLbl, false);
+    m_rDoc.SetFunctionGraph(rAddr, FuncGraph);
   }
   else
   {
@@ -101,97 +201,9 @@ bool Analyzer::MakeFunctionTask::CreateFunction(Address const& rAddr)
   return true;
 }
 
-bool Analyzer::MakeFunctionTask::ComputeFunctionLength(Address const& rFuncAddr, Address& rEndAddress, u16& rFunctionLength, u16& rInstructionCounter, u32 LengthThreshold) const
-{
-  std::stack<Address> CallStack;
-  std::map<Address, bool> VisitedInstruction;
-  bool RetReached = false;
-
-  u32 FuncLen                = 0x0;
-  Address CurAddr            = rFuncAddr;
-  Address EndAddr            = rFuncAddr;
-  rFunctionLength            = 0x0;
-  rInstructionCounter        = 0x0;
-  MemoryArea const* pMemArea = m_rDoc.GetMemoryArea(CurAddr);
-
-  auto Lbl = m_rDoc.GetLabelFromAddress(CurAddr);
-  if ((Lbl.GetType() & Label::AccessMask) == Label::Imported)
-    return false;
-
-  if (pMemArea == nullptr)
-    return false;
-
-  CallStack.push(CurAddr);
-
-  while (!CallStack.empty())
-  {
-    CurAddr = CallStack.top();
-    CallStack.pop();
-
-    while(m_rDoc.ContainsCode(CurAddr))
-    {
-      auto spInsn = std::static_pointer_cast<Instruction>(m_rDoc.GetCell(CurAddr));
-
-      if (spInsn == nullptr)
-      {
-        Log::Write("core") << "instruction at " << CurAddr.ToString() << " is null" << LogEnd;
-        break;
-      }
-
-      if (VisitedInstruction[CurAddr])
-      {
-        CurAddr += spInsn->GetLength();
-        continue;
-      }
-
-      FuncLen += static_cast<u32>(spInsn->GetLength());
-
-      VisitedInstruction[CurAddr] = true;
-
-      rFunctionLength += static_cast<u32>(spInsn->GetLength());
-      rInstructionCounter++;
-
-      if (spInsn->GetSubType() & Instruction::JumpType)
-      {
-        Address DstAddr;
-
-        if (spInsn->GetSubType() & Instruction::ConditionalType)
-          CallStack.push(CurAddr + spInsn->GetLength());
-
-        if (spInsn->Operand(0)->GetType() & O_MEM)
-          break;
-
-        if (!spInsn->GetOperandReference(m_rDoc, 0, CurAddr, DstAddr))// && !m_rDoc.IsPresent(DstAddr))
-        {
-          RetReached = true; // HACK: This is not really true...
-          break;
-        }
-
-        CurAddr = DstAddr;
-        continue;
-      }
-
-      else if (spInsn->GetSubType() & Instruction::ReturnType && !(spInsn->GetSubType() & Instruction::ConditionalType))
-      {
-        RetReached = true;
-        if (EndAddr < CurAddr)
-          EndAddr = CurAddr;
-        break;
-      }
-
-      CurAddr += spInsn->GetLength();
-
-      if (LengthThreshold && FuncLen > LengthThreshold)
-        return false;
-    } // end while (m_Document.IsPresent(CurAddr))
-  } // while (!CallStack.empty())
-
-  return RetReached;
-}
-
-
 Analyzer::DisassembleTask::DisassembleTask(Document& rDoc, Address const& rAddr, Architecture& rArch, u8 Mode)
   : MakeFunctionTask(rDoc, rAddr), m_rArch(rArch), m_Mode(Mode)
+  , m_pBankedMemArea(nullptr), m_CurBank(0)
 {
 }
 
@@ -218,7 +230,9 @@ bool Analyzer::DisassembleTask::Disassemble(Address const& rAddr)
   std::stack<Address> CallStack;
   Address::List FuncAddr;
   Address CurAddr             = rAddr;
-  MemoryArea const* pMemArea  = m_rDoc.GetMemoryArea(CurAddr);
+  MemoryArea const* pMemArea  = m_rDoc.MapMemoryArea(CurAddr);
+  RegisterValueMapType RegVals;
+  m_pBankedMemArea            = m_rDoc.GetBankedMemoryArea(CurAddr);
 
   if (pMemArea == nullptr)
   {
@@ -230,17 +244,24 @@ bool Analyzer::DisassembleTask::Disassemble(Address const& rAddr)
   CallStack.push(CurAddr);
 
   // Do we still have functions to disassemble?
-  while (!CallStack.empty())
+  while (!CallStack.empty() && !IsCancelled())
   {
     // Retrieve the last function
     CurAddr = CallStack.top();
     CallStack.pop();
     bool FunctionIsFinished = false;
 
+    // Code outside of the window runs with the bank selected by default
+    if (m_pBankedMemArea != nullptr)
+    {
+      m_CurBank = m_pBankedMemArea->IsInWindow(CurAddr.GetOffset()) ? CurAddr.GetBase() : m_pBankedMemArea->GetDefaultBank();
+      RegVals.clear();
+    }
+
     //Log::Write("debug") << "Analyzing address: " << CurAddr.ToString() << LogEnd;
 
-    // Disassemble a function
-    while (!m_rDoc.ContainsCode(CurAddr))
+    // Disassemble a function, a long one can be cancelled between its basic blocks
+    while (!m_rDoc.ContainsCode(CurAddr) && !IsCancelled())
     {
       //Log::Write("debug") << "Disassembling basic block at " << CurAddr.ToString() << LogEnd;
 
@@ -257,6 +278,8 @@ bool Analyzer::DisassembleTask::Disassemble(Address const& rAddr)
 
       for (auto itInsn = std::begin(BasicBlock); itInsn != std::end(BasicBlock); ++itInsn)
       {
+        CurAddr = ResolveReference(CurAddr);
+
         if (m_rDoc.ContainsCode(CurAddr))
         {
           //Log::Write("debug") << "Instruction is already disassembled at " << CurAddr.ToString() << LogEnd;
@@ -271,15 +294,22 @@ bool Analyzer::DisassembleTask::Disassemble(Address const& rAddr)
           continue;
         }
 
-        for (u8 i = 0; i < OPERAND_NO; ++i)
+        // The operand of an indirect jump refers to its table, not to code
+        if (!JumpTable::IsCandidate(**itInsn))
         {
-          Address DstAddr;
-          if ((*itInsn)->GetOperandReference(m_rDoc, i, CurAddr, DstAddr))
-            CallStack.push(DstAddr);
+          for (u8 i = 0; i < OPERAND_NO; ++i)
+          {
+            Address DstAddr;
+            if ((*itInsn)->GetOperandReference(m_rDoc, i, CurAddr, DstAddr))
+              CallStack.push(ResolveReference(DstAddr));
+          }
         }
 
         CreateCrossReferences(CurAddr);
 
+        if (m_pBankedMemArea != nullptr)
+          TrackBankSwitch(**itInsn, *m_pBankedMemArea, RegVals, m_CurBank);
+
         auto InsnType = (*itInsn)->GetSubType();
         if (InsnType == Instruction::NoneType || InsnType == Instruction::ConditionalType)
           CurAddr += (*itInsn)->GetLength();
@@ -309,6 +339,7 @@ bool Analyzer::DisassembleTask::Disassemble(Address const& rAddr)
             break;
           }
 
+          DstAddr = ResolveReference(DstAddr);
           FuncAddr.push_back(DstAddr);
           CurAddr = DstAddr;
           break;
@@ -340,13 +371,14 @@ bool Analyzer::DisassembleTask::Disassemble(Address const& rAddr)
             CallStack.push(CurAddr + pLastInsn->GetLength());
 
           // Sometime, we can't determine the destination address, so we give up
-          if (!pLastInsn->GetOperandReference(m_rDoc, 0, CurAddr, DstAddr))
+          // Indirect jumps are handled later by ResolveJumpTablesTask
+          if (JumpTable::IsCandidate(*pLastInsn) || !pLastInsn->GetOperandReference(m_rDoc, 0, CurAddr, DstAddr))
           {
             FunctionIsFinished = true;
             break;
           }
 
-          CurAddr = DstAddr;
+          CurAddr = ResolveReference(DstAddr);
           break;
         } // end JumpType
 
@@ -365,10 +397,42 @@ bool Analyzer::DisassembleTask::Disassemble(Address const& rAddr)
   return true;
 }
 
+bool Analyzer::DisassembleTask::Follow(Address const& rAddr)
+{
+  auto spInsn = std::dynamic_pointer_cast<Instruction const>(m_rDoc.GetCell(rAddr));
+  if (spInsn == nullptr)
+    return false;
+
+  m_pBankedMemArea = m_rDoc.GetBankedMemoryArea(rAddr);
+  if (m_pBankedMemArea != nullptr)
+    m_CurBank = m_pBankedMemArea->IsInWindow(rAddr.GetOffset()) ? rAddr.GetBase() : m_pBankedMemArea->GetDefaultBank();
+
+  CreateCrossReferences(rAddr);
+
+  // Disassemble stops on known code, so only new code is walked
+  auto InsnType = spInsn->GetSubType();
+  bool IsLast = (InsnType & (Instruction::JumpType | Instruction::ReturnType)) && !(InsnType & Instruction::ConditionalType);
+  if (!IsLast)
+    Disassemble(ResolveReference(rAddr + spInsn->GetLength()));
+
+  Address DstAddr;
+  if (!(InsnType & (Instruction::CallType | Instruction::JumpType)) || JumpTable::IsCandidate(*spInsn))
+    return true;
+  if (!spInsn->GetOperandReference(m_rDoc, 0, rAddr, DstAddr))
+    return true;
+
+  DstAddr = ResolveReference(DstAddr);
+  Disassemble(DstAddr);
+  if (InsnType & Instruction::CallType)
+    CreateFunction(DstAddr);
+
+  return true;
+}
+
 bool Analyzer::DisassembleTask::DisassembleBasicBlock(Address const& rAddr, std::list<Instruction::SPType>& rBasicBlock)
 {
   Address CurAddr = rAddr;
-  MemoryArea const* pMemArea = m_rDoc.GetMemoryArea(CurAddr);
+  MemoryArea const* pMemArea = m_rDoc.MapMemoryArea(CurAddr);
 
   try
   {
@@ -381,9 +445,12 @@ bool Analyzer::DisassembleTask::DisassembleBasicBlock(Address const& rAddr, std:
 
     while (/*m_rDoc.IsPresent(CurAddr)*/ true)
     {
+      // Code which falls through the window of a banked memory area runs the selected bank
+      CurAddr = ResolveReference(CurAddr);
+
       // If we changed the current memory area, we must update it
       if (!pMemArea->IsCellPresent(CurAddr))
-        if ((pMemArea = m_rDoc.GetMemoryArea(CurAddr)) == nullptr)
+        if ((pMemArea = m_rDoc.MapMemoryArea(CurAddr)) == nullptr)
           throw std::string("unable to get memory area for address: ") + CurAddr.ToString();
 
       // If the current memory area is not executable, we skip this execution flow
@@ -457,6 +524,11 @@ bool Analyzer::DisassembleTask::CreateCrossReferences(Address const& rAddr)
     Address DstAddr;
     if (!spInsn->GetOperandReference(m_rDoc, CurOp, rAddr, DstAddr))
       continue;
+    if (m_pBankedMemArea != nullptr)
+    {
+      DstAddr = ResolveReference(DstAddr);
+      m_rDoc.MapMemoryArea(DstAddr);
+    }
 
     //if (!m_rDoc.IsPresent(DstAddr))
     //  continue;
@@ -479,7 +551,8 @@ bool Analyzer::DisassembleTask::CreateCrossReferences(Address const& rAddr)
     switch (spInsn->GetSubType() & (Instruction::CallType | Instruction::JumpType))
     {
     case Instruction::CallType: LblTy = Label::Code | Label::Local; break;
-    case Instruction::JumpType: LblTy = Label::Code | Label::Local; break;
+    case Instruction::JumpType: LblTy = JumpTable::IsCandidate(*spInsn) ?
+                                  Label::Data | Label::Global : Label::Code | Label::Local; break;
     case Instruction::NoneType: LblTy = (m_rDoc.GetMemoryArea(DstAddr)->GetAccess() & MemoryArea::Execute) ?
                                   Label::Code | Label::Local : Label::Data | Label::Global;
     default: break;
@@ -491,6 +564,270 @@ bool Analyzer::DisassembleTask::CreateCrossReferences(Address const& rAddr)
   return true;
 }
 
+Address Analyzer::DisassembleTask::ResolveReference(Address const& rAddr) const
+{
+  if (m_pBankedMemArea == nullptr)
+    return rAddr;
+  return m_pBankedMemArea->ResolveAddress(rAddr, m_CurBank);
+}
+
+Analyzer::ReanalyzeTask::ReanalyzeTask(Document& rDoc, Address::List const& rModifiedAddresses)
+  : MakeFunctionTask(rDoc, Address()), m_ModifiedAddresses(rModifiedAddresses)
+{
+}
+
+Analyzer::ReanalyzeTask::~ReanalyzeTask(void)
+{
+}
+
+std::string Analyzer::ReanalyzeTask::GetName(void) const
+{
+  return "reanalyze";
+}
+
+void Analyzer::ReanalyzeTask::Run(void)
+{
+  auto StartTime = std::chrono::steady_clock::now();
+
+  // Modified cells drop references they don't make anymore, then code they lead to is disassembled
+  for (auto const& rModAddr : m_ModifiedAddresses)
+  {
+    if (IsCancelled())
+      break;
+
+    auto spCell = m_rDoc.GetCell(rModAddr);
+    if (spCell == nullptr)
+      continue;
+
+    auto spInsn = std::dynamic_pointer_cast<Instruction const>(spCell);
+
+    // References of an indirect jump are owned by its jump table
+    if (spInsn == nullptr || !JumpTable::IsCandidate(*spInsn))
+    {
+      Address::List DstAddrs;
+      for (u8 CurOp = 0; spInsn != nullptr && CurOp < OPERAND_NO; ++CurOp)
+      {
+        Address DstAddr;
+        if (spInsn->GetOperandReference(m_rDoc, CurOp, rModAddr, DstAddr))
+          DstAddrs.push_back(DstAddr);
+      }
+
+      // A reference is made from the cell or from one of its operands, an erased instruction
+      // leaves unknown bytes where its operands were
+      u32 CellLen = spCell->GetLength();
+      while (CellLen < MaxReferenceOffset && m_rDoc.ContainsUnknown(rModAddr + CellLen))
+        ++CellLen;
+      for (u32 CurOff = 0; CurOff < CellLen; ++CurOff)
+      {
+        Address FromAddr = rModAddr + CurOff, ToAddr;
+        if (!m_rDoc.GetCrossReferenceTo(FromAddr, ToAddr))
+          continue;
+        if (std::find(std::begin(DstAddrs), std::end(DstAddrs), ToAddr) == std::end(DstAddrs))
+          m_rDoc.RemoveCrossReferenceAndDerivedLabel(FromAddr);
+      }
+    }
+
+    if (spInsn == nullptr)
+      continue;
+
+    auto spArch = ModuleManager::Instance().GetArchitecture(spInsn->GetArchitectureTag());
+    if (spArch == nullptr)
+      continue;
+
+    DisassembleTask DisasmTask(m_rDoc, rModAddr, *spArch, spInsn->GetMode());
+    DisasmTask.SetCancellationToken(GetCancellationToken());
+    DisasmTask.Follow(rModAddr);
+  }
+
+  // Only functions which own a modified address, or which reference it, are affected
+  Address::List AffectedFuncs;
+  for (auto const& rModAddr : m_ModifiedAddresses)
+  {
+    m_rDoc.GetFunctionsContaining(rModAddr, AffectedFuncs);
+
+    // e.g. code was created where a jump of a function used to lead nowhere
+    Address::List FromAddrs;
+    if (!m_rDoc.GetCrossReferenceFrom(rModAddr, FromAddrs))
+      continue;
+    for (auto const& rFromAddr : FromAddrs)
+      m_rDoc.GetFunctionsContaining(rFromAddr, AffectedFuncs);
+  }
+
+  u32 UpdatedFuncCnt = 0;
+  SetTotal(AffectedFuncs.size());
+  for (auto const& rFuncAddr : AffectedFuncs)
+  {
+    Advance();
+    if (m_rDoc.ContainsCode(rFuncAddr) && CreateFunction(rFuncAddr, true))
+    {
+      ++UpdatedFuncCnt;
+      continue;
+    }
+
+    // The function is no longer valid (e.g. its entry point was undefined)
+    Log::Write("core") << "function " << rFuncAddr << " is not valid anymore" << LogEnd;
+    m_rDoc.SetFunctionGraph(rFuncAddr, FunctionGraph());
+    auto const pMultiCell = m_rDoc.GetMultiCell(rFuncAddr);
+    if (pMultiCell != nullptr && pMultiCell->GetType() == MultiCell::FunctionType)
+      m_rDoc.RemoveMultiCell(rFuncAddr);
+  }
+
+  auto Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - StartTime);
+  Log::Write("core")
+    << "reanalyze: " << m_ModifiedAddresses.size() << " modified address(es), "
+    << UpdatedFuncCnt << "/" << AffectedFuncs.size() << " function(s) updated in "
+    << Elapsed.count() << "us"
+    << LogEnd;
+}
+
+Analyzer::ResolveJumpTablesTask::ResolveJumpTablesTask(Document& rDoc)
+  : m_rDoc(rDoc)
+{
+}
+
+Analyzer::ResolveJumpTablesTask::~ResolveJumpTablesTask(void)
+{
+}
+
+std::string Analyzer::ResolveJumpTablesTask::GetName(void) const
+{
+  return "resolve jump tables";
+}
+
+void Analyzer::ResolveJumpTablesTask::Run(void)
+{
+  auto StartTime = std::chrono::steady_clock::now();
+
+  struct Candidate
+  {
+    Address       m_FuncAddr;
+    Address       m_JmpAddr;
+    FunctionGraph m_FuncGraph;
+  };
+
+  Analyzer Anlz;
+  std::set<Address> KnownJmpAddrs;
+  u32 CandCnt = 0, TblCnt = 0, BoundedTblCnt = 0, EntryCnt = 0;
+  u32 OldInsnCnt = 0, NewInsnCnt = 0;
+
+  // Destinations of a jump table can contain other jump tables, so we iterate until nothing new is found
+  while (!IsCancelled())
+  {
+    std::vector<Candidate> Cands;
+    for (auto const& rMultiCell : m_rDoc.GetMultiCells())
+    {
+      if (rMultiCell.second->GetType() != MultiCell::FunctionType)
+        continue;
+
+      FunctionGraph FuncGraph;
+      if (!Anlz.GetFunctionGraph(m_rDoc, rMultiCell.first, FuncGraph))
+        continue;
+
+      for (u32 BscBlkIdx = 0; BscBlkIdx < FuncGraph.GetBasicBlocks().size(); ++BscBlkIdx)
+      {
+        auto BscBlkAddrs = FuncGraph.GetBasicBlockAddresses(BscBlkIdx);
+        if (BscBlkAddrs.empty() || !KnownJmpAddrs.insert(BscBlkAddrs.back()).second)
+          continue;
+
+        auto spInsn = std::dynamic_pointer_cast<Instruction const>(m_rDoc.GetCell(BscBlkAddrs.back()));
+        if (spInsn == nullptr || !JumpTable::IsCandidate(*spInsn))
+          continue;
+
+        // This jump table was resolved in a previous analysis
+        Address::List JmpTblDsts;
+        if (JumpTable::GetTargets(m_rDoc, BscBlkAddrs.back(), *spInsn, JmpTblDsts))
+          continue;
+
+        Candidate NewCand = { rMultiCell.first, BscBlkAddrs.back(), FuncGraph };
+        Cands.push_back(NewCand);
+      }
+    }
+
+    if (Cands.empty())
+      break;
+    CandCnt += static_cast<u32>(Cands.size());
+    AddToTotal(Cands.size());
+
+    // Backtracking is the expensive part and it doesn't modify the document, so it's done in parallel
+    std::vector<JumpTable> JmpTbls(Cands.size());
+    std::vector<u8> IsResolved(Cands.size(), 0);
+    ParallelFor(Cands.size(), [&](size_t Begin, size_t End)
+    {
+      for (size_t i = Begin; i < End && !IsCancelled(); ++i)
+        if (JmpTbls[i].Resolve(m_rDoc, Cands[i].m_FuncGraph, Cands[i].m_FuncAddr, Cands[i].m_JmpAddr))
+          IsResolved[i] = 1;
+    });
+
+    Address::List ModifiedAddrs;
+    std::set<Address> AffectedFuncAddrs;
+    for (size_t i = 0; i < Cands.size() && !IsCancelled(); ++i)
+    {
+      Advance();
+      if (!IsResolved[i])
+        continue;
+
+      auto const& rJmpTbl  = JmpTbls[i];
+      auto const& rJmpAddr = rJmpTbl.GetJumpAddress();
+      auto const& rTblAddr = rJmpTbl.GetTableAddress();
+
+      auto spArch = ModuleManager::Instance().GetArchitecture(m_rDoc.GetArchitectureTag(rJmpAddr));
+      auto spJmpInsn = std::dynamic_pointer_cast<Instruction const>(m_rDoc.GetCell(rJmpAddr));
+      if (spArch == nullptr || spJmpInsn == nullptr)
+        continue;
+      u8 Mode = m_rDoc.GetMode(rJmpAddr);
+
+      // Entries are defined first, since modifying a cell removes its cross-reference
+      Address EntryAddr = rTblAddr;
+      for (size_t EntryIdx = 0; EntryIdx < rJmpTbl.GetTargets().size(); ++EntryIdx, EntryAddr += rJmpTbl.GetEntrySize())
+        m_rDoc.ChangeValueSize(EntryAddr, rJmpTbl.GetEntrySize() * 8, false);
+
+      EntryAddr = rTblAddr;
+      for (auto const& rDstAddr : rJmpTbl.GetTargets())
+      {
+        m_rDoc.AddCrossReference(rDstAddr, EntryAddr);
+        m_rDoc.AddLabel(rDstAddr, Label(rDstAddr, Label::Code | Label::Local), false);
+        DisassembleTask DisasmTask(m_rDoc, rDstAddr, *spArch, Mode);
+        DisasmTask.SetCancellationToken(GetCancellationToken());
+        DisasmTask.Run();
+        EntryAddr += rJmpTbl.GetEntrySize();
+      }
+
+      m_rDoc.AddCrossReference(rTblAddr, JumpTable::GetReferenceAddress(rJmpAddr, *spJmpInsn));
+      m_rDoc.AddLabel(rTblAddr, Label(rTblAddr, Label::Data | Label::Global), false);
+
+      ModifiedAddrs.push_back(rJmpAddr);
+      if (AffectedFuncAddrs.insert(Cands[i].m_FuncAddr).second)
+        OldInsnCnt += Cands[i].m_FuncGraph.GetNumberOfInstructions();
+
+      ++TblCnt;
+      if (rJmpTbl.IsBounded())
+        ++BoundedTblCnt;
+      EntryCnt += static_cast<u32>(rJmpTbl.GetTargets().size());
+    }
+
+    if (ModifiedAddrs.empty())
+      break;
+
+    // Functions which own a jump table now include its destinations, even if the task is cancelled
+    ReanalyzeTask(m_rDoc, ModifiedAddrs).Run();
+
+    for (auto const& rFuncAddr : AffectedFuncAddrs)
+    {
+      FunctionGraph FuncGraph;
+      if (Anlz.GetFunctionGraph(m_rDoc, rFuncAddr, FuncGraph))
+        NewInsnCnt += FuncGraph.GetNumberOfInstructions();
+    }
+  }
+
+  auto Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime);
+  Log::Write("core")
+    << "jump tables: " << TblCnt << "/" << CandCnt << " indirect jump(s) resolved"
+    << " (" << BoundedTblCnt << " bounded), " << EntryCnt << " entries"
+    << ", instructions in affected functions: " << OldInsnCnt << " -> " << NewInsnCnt
+    << ", " << Elapsed.count() << "ms"
+    << LogEnd;
+}
+
 Analyzer::DisassembleFunctionTask::DisassembleFunctionTask(Document& rDoc, Address const& rAddr, Architecture& rArch, u8 Mode)
   : DisassembleTask(rDoc, rAddr, rArch, Mode)
 {
@@ -528,29 +865,31 @@ std::string Analyzer::DisassembleAllFunctionsTask::GetName(void) const
 void Analyzer::DisassembleAllFunctionsTask::Run(void)
 {
   /* Disassemble all symbols if possible */
-  m_rDoc.ForEachLabel([&](Address const& rAddress, Label const& rLabel)
-  {
-    u16 LblType = rLabel.GetType() & Label::CellMask;
-    bool IsExported = ((rLabel.GetType() & Label::AccessMask) == Label::Exported) ? true : false;
-    bool IsGlobal   = ((rLabel.GetType() & Label::AccessMask) == Label::Global)   ? true : false;
+  auto FuncLbls = CollectLabels(m_rDoc, IsFunctionLabel);
+  SetTotal(FuncLbls.size());
 
-    if (!(LblType == Label::Function || ((LblType == Label::Code) && (IsExported || IsGlobal))))
-      return;
+  for (auto const& rFuncLbl : FuncLbls)
+  {
+    if (IsCancelled())
+      break;
+    Advance();
 
+    auto const& rAddress = rFuncLbl.first;
     Log::Write("core") << "disassembling function " << rAddress << LogEnd;
 
     auto spArch = ModuleManager::Instance().GetArchitecture(m_rDoc.GetArchitectureTag(rAddress));
     if (spArch == nullptr)
     {
       Log::Write("core") << "there's no architecture for " << rAddress << LogEnd;
-      return;
+      continue;
     }
 
     u8 Mode = m_rDoc.GetMode(rAddress);
 
     DisassembleFunctionTask DisasmFuncTask(m_rDoc, rAddress, *spArch, Mode);
+    DisasmFuncTask.SetCancellationToken(GetCancellationToken());
     DisasmFuncTask.Run();
-  });
+  }
 }
 
 Analyzer::FindAllStringTask::FindAllStringTask(Document& rDoc) : m_rDoc(rDoc)
@@ -568,13 +907,15 @@ std::string Analyzer::FindAllStringTask::GetName(void) const
 
 void Analyzer::FindAllStringTask::Run(void)
 {
-  m_rDoc.ForEachLabel([this](Address const& rAddress, Label const& rLabel)
+  auto DataLbls = CollectLabels(m_rDoc, [](Label const& rLabel)
   {
-    if ((rLabel.GetType() & Label::AccessMask) == Label::Imported)
-      return;
-    if ((rLabel.GetType() & Label::CellMask) != Label::Data)
-      return;
+    return (rLabel.GetType() & Label::AccessMask) != Label::Imported
+      &&   (rLabel.GetType() & Label::CellMask)   == Label::Data;
+  });
+  SetTotal(DataLbls.size());
 
+  auto FindString = [this](Address const& rAddress)
+  {
     BinaryStream const& rBinStrm = m_rDoc.GetBinaryStream();
     TOffset StrOff;
 
@@ -649,7 +990,15 @@ void Analyzer::FindAllStringTask::Run(void)
       auto spString = std::make_shared<String>(String::Utf8Type, RawLen);
       m_rDoc.SetCellWithLabel(rAddress, spString, Label(CurStr, Label::String | Label::Global), true);
     }
-  });
+  };
+
+  for (auto const& rDataLbl : DataLbls)
+  {
+    if (IsCancelled())
+      break;
+    Advance();
+    FindString(rDataLbl.first);
+  }
 }
 
 Analyzer::AnalyzeStackAllFunctionsTask::AnalyzeStackAllFunctionsTask(Document& rDoc)
@@ -668,16 +1017,11 @@ std::string Analyzer::AnalyzeStackAllFunctionsTask::GetName(void) const
 
 void Analyzer::AnalyzeStackAllFunctionsTask::Run(void)
 {
-    /* Disassemble all symbols if possible */
-  m_rDoc.ForEachLabel([&](Address const& rAddress, Label const& rLabel)
-  {
-    u16 LblType = rLabel.GetType() & Label::CellMask;
-    bool IsExported = ((rLabel.GetType() & Label::AccessMask) == Label::Exported) ? true : false;
-    bool IsGlobal   = ((rLabel.GetType() & Label::AccessMask) == Label::Global)   ? true : false;
-
-    if (!(LblType == Label::Function || ((LblType == Label::Code) && (IsExported || IsGlobal))))
-      return;
+  auto FuncLbls = CollectLabels(m_rDoc, IsFunctionLabel);
+  SetTotal(FuncLbls.size());
 
+  auto AnalyzeStack = [&](Address const& rAddress)
+  {
     Log::Write("core") << "analyzing stack for function " << rAddress << LogEnd;
 
     auto ArchTag  = m_rDoc.GetArchitectureTag(rAddress);
@@ -746,102 +1090,149 @@ void Analyzer::AnalyzeStackAllFunctionsTask::Run(void)
       }
 
       m_rDoc.SetComment(rCurAddr, NewCmt);
-      return true;
+      return !IsCancelled();
     });
+  };
 
-  });
-
+  for (auto const& rFuncLbl : FuncLbls)
+  {
+    if (IsCancelled())
+      break;
+    Advance();
+    AnalyzeStack(rFuncLbl.first);
+  }
 }
 
-bool Analyzer::ComputeFunctionLength(
-  Document const& rDoc,
-  Address const& rFunctionAddress,
-  Address& EndAddress,
-  u16& rFunctionLength,
-  u16& rInstructionCounter,
-  u32 LengthThreshold) const
+Analyzer::ApplySignaturesTask::ApplySignaturesTask(Document& rDoc, SignatureDatabase::SPType spSigDb)
+  : m_rDoc(rDoc), m_spSigDb(spSigDb)
 {
-  std::stack<Address> CallStack;
-  std::map<Address, bool> VisitedInstruction;
-  bool RetReached = false;
-
-  u32 FuncLen                = 0x0;
-  Address CurAddr            = rFunctionAddress;
-  Address EndAddr            = rFunctionAddress;
-  rFunctionLength            = 0x0;
-  rInstructionCounter        = 0x0;
-  MemoryArea const* pMemArea = rDoc.GetMemoryArea(CurAddr);
+}
 
-  auto Lbl = rDoc.GetLabelFromAddress(rFunctionAddress);
-  if ((Lbl.GetType() & Label::AccessMask) == Label::Imported)
-    return false;
+Analyzer::ApplySignaturesTask::~ApplySignaturesTask(void)
+{
+}
 
-  if (pMemArea == nullptr)
-    return false;
+std::string Analyzer::ApplySignaturesTask::GetName(void) const
+{
+  return "apply signatures";
+}
 
-  CallStack.push(CurAddr);
+void Analyzer::ApplySignaturesTask::Run(void)
+{
+  if (m_spSigDb == nullptr || m_spSigDb->GetNumberOfSignatures() == 0)
+    return;
 
-  while (!CallStack.empty())
+  struct Candidate
   {
-    CurAddr = CallStack.top();
-    CallStack.pop();
+    Address     m_Addr;
+    TOffset     m_FileOff;
+    u32         m_Length;
+    std::string m_Name;
+  };
+
+  auto StartTime = std::chrono::steady_clock::now();
+
+  /* Only functions which weren't named by the loader are candidates */
+  BinaryStream const& rBinStrm = m_rDoc.GetBinaryStream();
+  std::vector<Candidate> Candidates;
+  for (auto const& rMultiCell : m_rDoc.GetMultiCells())
+  {
+    if (rMultiCell.second->GetType() != MultiCell::FunctionType)
+      continue;
 
-    while(rDoc.ContainsCode(CurAddr))
-    {
-      auto spInsn = std::static_pointer_cast<Instruction>(rDoc.GetCell(CurAddr));
+    auto FuncLbl = m_rDoc.GetLabelFromAddress(rMultiCell.first);
+    if (FuncLbl.GetType() != Label::Unknown && !FuncLbl.IsAutoGenerated())
+      continue;
 
-      if (spInsn == nullptr)
-      {
-        Log::Write("core") << "instruction at " << CurAddr.ToString() << " is null" << LogEnd;
-        break;
-      }
+    Candidate CurCand;
+    CurCand.m_Addr = rMultiCell.first;
+    if (!m_rDoc.ConvertAddressToFileOffset(CurCand.m_Addr, CurCand.m_FileOff))
+      continue;
+    if (CurCand.m_FileOff >= rBinStrm.GetSize())
+      continue;
+    CurCand.m_Length = static_cast<u32>(std::min<u64>(m_spSigDb->GetMaximumLength(), rBinStrm.GetSize() - CurCand.m_FileOff));
+    Candidates.push_back(CurCand);
+  }
 
-      if (VisitedInstruction[CurAddr])
-      {
-        CurAddr += spInsn->GetLength();
+  SetTotal(Candidates.size());
+
+  /* Matching only reads the binary stream, so we can split it across all cores */
+  ParallelFor(Candidates.size(), [&](size_t Begin, size_t End)
+  {
+    std::vector<u8> FuncBuf(m_spSigDb->GetMaximumLength());
+    for (size_t i = Begin; i < End && !IsCancelled(); ++i)
+    {
+      Advance();
+      auto& rCand = Candidates[i];
+      if (!rBinStrm.Read(rCand.m_FileOff, FuncBuf.data(), rCand.m_Length))
         continue;
-      }
+      m_spSigDb->Match(FuncBuf.data(), rCand.m_Length, rCand.m_Name);
+    }
+  });
 
-      FuncLen += static_cast<u32>(spInsn->GetLength());
+  /* Document modifications are done sequentially */
+  OperatingSystem::SPType spOs;
+  auto OsName = m_rDoc.GetOperatingSystemName();
+  if (!OsName.empty())
+    spOs = ModuleManager::Instance().GetOperatingSystem(OsName);
 
-      VisitedInstruction[CurAddr] = true;
+  u32 MatchCnt = 0;
+  for (auto const& rCand : Candidates)
+  {
+    if (IsCancelled())
+      break;
+    if (rCand.m_Name.empty())
+      continue;
 
-      rFunctionLength += static_cast<u32>(spInsn->GetLength());
-      rInstructionCounter++;
+    ++MatchCnt;
+    m_rDoc.AddLabel(rCand.m_Addr, Label(rCand.m_Name, Label::Function | Label::Global), true);
 
-      if (spInsn->GetSubType() & Instruction::JumpType)
-      {
-        Address DstAddr;
+    auto const pFunc = dynamic_cast<Function const*>(m_rDoc.GetMultiCell(rCand.m_Addr));
+    if (pFunc != nullptr)
+      m_rDoc.SetMultiCell(rCand.m_Addr, new Function(rCand.m_Name, pFunc->GetSize(), pFunc->GetInstructionCounter()), true);
 
-        if (spInsn->GetSubType() & Instruction::ConditionalType)
-          CallStack.push(CurAddr + spInsn->GetLength());
+    if (spOs == nullptr)
+      continue;
 
-        if (spInsn->Operand(0)->GetType() & O_MEM)
-          break;
+    Id FuncId = Sha1(rCand.m_Name);
+    FunctionDetail FuncDtl;
+    if (!spOs->GetFunctionDetail(FuncId, FuncDtl))
+      continue;
+    if (!m_rDoc.SetFunctionDetail(FuncId, FuncDtl) || !m_rDoc.BindDetailId(rCand.m_Addr, 0, FuncId))
+      Log::Write("core") << "unable to apply function detail for " << rCand.m_Name << " @" << rCand.m_Addr << LogEnd;
+  }
 
-        if (!spInsn->GetOperandReference(rDoc, 0, CurAddr, DstAddr))
-          break;
+  // The time per 10k functions compares binaries of different sizes
+  auto Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime);
+  Log::Write("core")
+    << "signature: " << MatchCnt << "/" << Candidates.size()
+    << " function(s) identified in " << Elapsed.count() << "ms"
+    << " (" << (Candidates.empty() ? 0 : Elapsed.count() * 10000 / Candidates.size()) << "ms per 10k functions)"
+    << LogEnd;
+}
 
-        CurAddr = DstAddr;
-        continue;
-      }
+bool Analyzer::ComputeFunctionLength(
+  Document const& rDoc,
+  Address const& rFunctionAddress,
+  Address& EndAddress,
+  u16& rFunctionLength,
+  u16& rInstructionCounter,
+  u32 LengthThreshold) const
+{
+  rFunctionLength     = 0x0;
+  rInstructionCounter = 0x0;
 
-      else if (spInsn->GetSubType() & Instruction::ReturnType && !(spInsn->GetSubType() & Instruction::ConditionalType))
-      {
-        RetReached = true;
-        if (EndAddr < CurAddr)
-          EndAddr = CurAddr;
-        break;
-      }
+  FunctionGraph FuncGraph;
+  if (!GetFunctionGraph(rDoc, rFunctionAddress, FuncGraph))
+    return false;
 
-      CurAddr += spInsn->GetLength();
+  if (LengthThreshold && FuncGraph.GetLength() > LengthThreshold)
+    return false;
 
-      if (LengthThreshold && FuncLen > LengthThreshold)
-        return false;
-    } // end while (m_Document.IsPresent(CurAddr))
-  } // while (!CallStack.empty())
+  rFunctionLength     = static_cast<u16>(FuncGraph.GetLength());
+  rInstructionCounter = static_cast<u16>(FuncGraph.GetNumberOfInstructions());
 
-  return RetReached;
+  return FuncGraph.HasReturn();
 }
 
 bool Analyzer::MakeAsciiString(Document& rDoc, Address const& rAddr) const
@@ -943,113 +1334,36 @@ bool Analyzer::BuildControlFlowGraph(Document const& rDoc, std::string const& rL
   return BuildControlFlowGraph(rDoc, rLblAddr, rCfg);
 }
 
-bool Analyzer::BuildControlFlowGraph(Document const& rDoc, Address const& rAddr, ControlFlowGraph& rCfg) const
+bool Analyzer::GetFunctionGraph(Document const& rDoc, Address const& rFuncAddr, FunctionGraph& rFuncGraph) const
 {
-  std::stack<Address> CallStack;
-  Address::List Addresses;
-  typedef std::tuple<Address, Address, BasicBlockEdgeProperties::Type> TupleEdge;
-  std::list<TupleEdge> Edges;
-  std::map<Address, bool> VisitedInstruction;
-  bool RetReached = false;
-
-  Address CurAddr = rAddr;
+  if (rDoc.GetFunctionGraph(rFuncAddr, rFuncGraph) && rFuncGraph.IsUpToDate(rDoc, rFuncAddr))
+    return true;
 
-  MemoryArea const* pMemArea = rDoc.GetMemoryArea(CurAddr);
+  return rFuncGraph.Build(rDoc, rFuncAddr);
+}
 
-  if (pMemArea == nullptr)
+bool Analyzer::BuildControlFlowGraph(Document const& rDoc, Address const& rAddr, ControlFlowGraph& rCfg) const
+{
+  FunctionGraph FuncGraph;
+  if (!GetFunctionGraph(rDoc, rAddr, FuncGraph))
     return false;
 
-  CallStack.push(CurAddr);
-
-  while (!CallStack.empty())
-  {
-    CurAddr = CallStack.top();
-    CallStack.pop();
-
-    while (rDoc.ContainsCode(CurAddr))
-    {
-      auto spInsn = std::static_pointer_cast<Instruction>(rDoc.GetCell(CurAddr));
-
-      // If the current address is already visited
-      if (VisitedInstruction[CurAddr])
-      {
-        // ... and if the current instruction is the end of the function, we take another address from the callstack
-        if (spInsn->GetSubType() & Instruction::ReturnType && !(spInsn->GetSubType() & Instruction::ConditionalType))
-          break;
-
-        // if not, we try with the next address.
-        CurAddr += spInsn->GetLength();
-        continue;
-      }
-
-      Addresses.push_back(CurAddr);
-      VisitedInstruction[CurAddr] = true;
-
-      if (spInsn->GetSubType() & Instruction::JumpType)
-      {
-        Address DstAddr;
-
-        if (spInsn->Operand(0)->GetType() & O_MEM)
-          break;
-
-         if (!spInsn->GetOperandReference(rDoc, 0, CurAddr, DstAddr))
-          break;
-
-        if (spInsn->GetSubType() & Instruction::ConditionalType)
-        {
-          Address NextAddr = CurAddr + spInsn->GetLength();
-          Edges.push_back(TupleEdge(DstAddr, CurAddr,  BasicBlockEdgeProperties::True ));
-          Edges.push_back(TupleEdge(NextAddr, CurAddr, BasicBlockEdgeProperties::False));
-          CallStack.push(NextAddr);
-        }
-        else
-        {
-          Edges.push_back(TupleEdge(DstAddr, CurAddr, BasicBlockEdgeProperties::Unconditional));
-        }
-
-        CurAddr = DstAddr;
-        continue;
-      }
-
-      else if (spInsn->GetSubType() & Instruction::ReturnType && !(spInsn->GetSubType() & Instruction::ConditionalType))
-      {
-        RetReached = true;
-        break;
-      }
-
-      CurAddr += spInsn->GetLength();
-    } // end while (m_Document.IsPresent(CurAddr))
-  } // while (!CallStack.empty())
-
-  BasicBlockVertexProperties FirstBasicBlock(rDoc, Addresses);
-
-  // This case is required because a jmp type insn can be located just before the entry point of a function,
-  // thus nothing can split this part (which normally is done by the call <func>)
-  Address::List FirstSplitAddrs;
-  if (FirstBasicBlock.Split(rAddr, FirstSplitAddrs))
-    rCfg.AddBasicBlockVertex(BasicBlockVertexProperties(rDoc, FirstSplitAddrs));
-
-  rCfg.AddBasicBlockVertex(FirstBasicBlock);
-
-  for (auto itEdge = std::begin(Edges); itEdge != std::end(Edges); ++itEdge)
-  {
-    static const char *TypeStr[] =
-    {
-      "Unknown",
-      "Unconditional",
-      "True",
-      "False"
-    };
-    bool Res = rCfg.SplitBasicBlock(std::get<0>(*itEdge), std::get<1>(*itEdge), std::get<2>(*itEdge));
-    Log::Write("core") << "dst: " << std::get<0>(*itEdge) << ", src: " << std::get<1>(*itEdge) << ", type: " << TypeStr[std::get<2>(*itEdge)] << (Res ? ", succeed" : ", failed") << LogEnd;
-  }
+  return BuildControlFlowGraph(rDoc, FuncGraph, rCfg);
+}
 
-  for (auto itEdge = std::begin(Edges); itEdge != std::end(Edges); ++itEdge)
-    rCfg.AddBasicBlockEdge(BasicBlockEdgeProperties(std::get<2>(*itEdge)), std::get<1>(*itEdge), std::get<0>(*itEdge));
+bool Analyzer::BuildControlFlowGraph(Document const& rDoc, FunctionGraph const& rFuncGraph, ControlFlowGraph& rCfg) const
+{
+  auto const& rBscBlks = rFuncGraph.GetBasicBlocks();
+  for (u32 CurBscBlk = 0; CurBscBlk < rBscBlks.size(); ++CurBscBlk)
+    rCfg.AddBasicBlockVertex(BasicBlockVertexProperties(rDoc, rFuncGraph.GetBasicBlockAddresses(CurBscBlk)));
 
-  rCfg.Finalize(rDoc);
+  for (auto const& rEdge : rFuncGraph.GetEdges())
+    rCfg.AddBasicBlockEdge(
+      BasicBlockEdgeProperties(static_cast<BasicBlockEdgeProperties::Type>(rEdge.m_Type)),
+      rBscBlks[rEdge.m_Source].m_Address,
+      rBscBlks[rEdge.m_Destination].m_Address);
 
-  return RetReached;
+  return rFuncGraph.HasReturn();
 }
 
 bool Analyzer::FormatCell(Document const& rDoc, Address const& rAddress, Cell const& rCell, PrintData &rPrintData) const
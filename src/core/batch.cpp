@@ -0,0 +1,351 @@
+#include "medusa/batch.hpp"
+#include "medusa/analyzer.hpp"
+#include "medusa/log.hpp"
+#include "medusa/memory_area.hpp"
+#include "medusa/stream_analyzer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <thread>
+
+#include <boost/filesystem/operations.hpp>
+
+MEDUSA_NAMESPACE_USE;
+
+double BatchAnalyzer::Report::GetFilesPerSecond(void) const
+{
+  if (m_Elapsed == 0)
+    return 0.0;
+  return m_FileNo * 1000.0 / m_Elapsed;
+}
+
+double BatchAnalyzer::Report::GetMegaBytesPerSecond(void) const
+{
+  if (m_Elapsed == 0)
+    return 0.0;
+  return m_Size / (1024.0 * 1024.0) * 1000.0 / m_Elapsed;
+}
+
+BatchAnalyzer::BatchAnalyzer(Path const& rModPath)
+  : m_Session(rModPath)
+  , m_WorkerNo(0)
+  , m_MemoryLimit(0)
+  , m_Timeout(0)
+  , m_StreamingBudget(0)
+  , m_Cancelled(false)
+{
+}
+
+bool BatchAnalyzer::SetSignatures(Path const& rSignaturePath)
+{
+  auto spSigDb = std::make_shared<SignatureDatabase>();
+  if (!spSigDb->Load(rSignaturePath))
+    return false;
+  m_spSigDb = spSigDb;
+  return true;
+}
+
+BatchAnalyzer::Report BatchAnalyzer::Run(std::vector<Path> const& rFilePaths, ResultVector& rResults, ResultFunctionType OnResult)
+{
+  auto StartTime = std::chrono::steady_clock::now();
+  m_Cancelled = false;
+
+  Report Rpt;
+  Rpt.m_FileNo     = static_cast<u32>(rFilePaths.size());
+  Rpt.m_AnalyzedNo = 0;
+  Rpt.m_FailedNo   = 0;
+  Rpt.m_Size       = 0;
+  Rpt.m_Elapsed    = 0;
+
+  Result DefRes;
+  DefRes.m_Status    = Failed;
+  DefRes.m_Size      = 0;
+  DefRes.m_Footprint = 0;
+  DefRes.m_Elapsed   = 0;
+  rResults.assign(rFilePaths.size(), DefRes);
+
+  auto DbName = m_DatabaseName;
+  if (DbName.empty())
+  {
+    auto AllDbs = ModuleManager::Instance().GetDatabases();
+    if (!AllDbs.empty())
+      DbName = AllDbs.front()->GetName();
+  }
+  auto spExtDb = m_Session.MakeDatabase(DbName);
+  std::string DbExt = spExtDb != nullptr ? spExtDb->GetExtension() : std::string();
+
+  // Files with the same name in different directories must not share a database
+  std::vector<Path> DbPaths;
+  std::map<Path, u32> DbPathNo;
+  for (auto const& rFilePath : rFilePaths)
+  {
+    Path DbPath = m_OutputDir.empty() ? rFilePath : m_OutputDir / rFilePath.filename();
+    u32 SameNo = DbPathNo[DbPath]++;
+    if (SameNo != 0)
+      DbPath += ("." + std::to_string(SameNo)).c_str();
+    DbPath += DbExt.c_str();
+    DbPaths.push_back(DbPath);
+  }
+
+  // Larger files are started first, so workers finish at about the same time
+  std::vector<u64> FileSizes(rFilePaths.size());
+  for (size_t FileIdx = 0; FileIdx < rFilePaths.size(); ++FileIdx)
+  {
+    boost::system::error_code ErrCode;
+    auto FileSize = boost::filesystem::file_size(rFilePaths[FileIdx], ErrCode);
+    FileSizes[FileIdx] = ErrCode ? 0 : static_cast<u64>(FileSize);
+  }
+  std::vector<size_t> Order(rFilePaths.size());
+  std::iota(std::begin(Order), std::end(Order), 0);
+  std::stable_sort(std::begin(Order), std::end(Order), [&FileSizes](size_t FileIdx0, size_t FileIdx1)
+  {
+    return FileSizes[FileIdx0] > FileSizes[FileIdx1];
+  });
+
+  size_t WorkerNo = m_WorkerNo != 0 ? m_WorkerNo : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  WorkerNo = std::min(WorkerNo, rFilePaths.size());
+
+  std::atomic<size_t> NextIdx(0);
+  std::mutex ResultMutex;
+  std::vector<std::thread> Workers;
+  for (size_t WorkerIdx = 0; WorkerIdx < WorkerNo; ++WorkerIdx)
+  {
+    Workers.push_back(std::thread([&]()
+    {
+      for (size_t CurIdx = NextIdx++; CurIdx < Order.size(); CurIdx = NextIdx++)
+      {
+        auto FileIdx = Order[CurIdx];
+        auto& rRes   = rResults[FileIdx];
+        if (m_Cancelled)
+        {
+          rRes.m_FilePath     = rFilePaths[FileIdx];
+          rRes.m_DatabasePath = DbPaths[FileIdx];
+          rRes.m_Status       = Cancelled;
+        }
+        else if (spExtDb == nullptr)
+        {
+          rRes.m_FilePath = rFilePaths[FileIdx];
+          rRes.m_Error    = "no database module available";
+        }
+        else
+          _Analyze(rFilePaths[FileIdx], DbName, DbPaths[FileIdx], rRes);
+
+        if (OnResult)
+        {
+          std::lock_guard<std::mutex> Lock(ResultMutex);
+          OnResult(rRes);
+        }
+      }
+    }));
+  }
+  for (auto& rWorker : Workers)
+    rWorker.join();
+
+  for (auto const& rRes : rResults)
+  {
+    Rpt.m_Size += rRes.m_Size;
+    if (rRes.m_Status == Analyzed)
+      ++Rpt.m_AnalyzedNo;
+    else if (rRes.m_Status == Failed)
+      ++Rpt.m_FailedNo;
+  }
+  Rpt.m_Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count();
+
+  Log::Write("core")
+    << "batch: " << Rpt.m_AnalyzedNo << "/" << Rpt.m_FileNo
+    << " file(s) analyzed by " << static_cast<u32>(WorkerNo)
+    << " worker(s) in " << Rpt.m_Elapsed << "ms"
+    << LogEnd;
+  return Rpt;
+}
+
+void BatchAnalyzer::Cancel(void)
+{
+  m_Cancelled = true;
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  for (auto const& rspToken : m_RunningTokens)
+    rspToken->Cancel();
+}
+
+char const* BatchAnalyzer::GetStatusName(Status ResultStatus)
+{
+  switch (ResultStatus)
+  {
+  case Analyzed:    return "analyzed";
+  case Unsupported: return "unsupported";
+  case TooLarge:    return "too large";
+  case TimedOut:    return "timed out";
+  case Cancelled:   return "cancelled";
+  case Failed:      return "failed";
+  default:          return "unknown";
+  }
+}
+
+u64 BatchAnalyzer::EstimateFootprint(Document const& rDoc, BinaryStream const& rBinStrm)
+{
+  // A windowed stream only keeps one window mapped
+  auto pFileBinStrm = dynamic_cast<FileBinaryStream const*>(&rBinStrm);
+  u64 Footprint = rBinStrm.GetSize();
+  if (pFileBinStrm != nullptr && pFileBinStrm->IsWindowed())
+    Footprint = std::min<u64>(Footprint, FileBinaryStream::WindowSize);
+
+  // Mapped areas keep a slot for each byte which could start a cell, virtual ones don't store cells
+  rDoc.ForEachMemoryArea([&Footprint](MemoryArea const& rMemArea)
+  {
+    if (dynamic_cast<MappedMemoryArea const*>(&rMemArea) != nullptr)
+      Footprint += static_cast<u64>(rMemArea.GetSize()) * sizeof(CellData::SPType);
+  });
+  return Footprint;
+}
+
+void BatchAnalyzer::_Analyze(Path const& rFilePath, std::string const& rDatabaseName, Path const& rDatabasePath, Result& rResult)
+{
+  auto StartTime = std::chrono::steady_clock::now();
+  rResult.m_FilePath     = rFilePath;
+  rResult.m_DatabasePath = rDatabasePath;
+  rResult.m_Status       = Failed;
+
+  auto spToken = std::make_shared<CancellationToken>();
+  if (m_Timeout != 0)
+    spToken->SetDeadline(CancellationToken::ClockType::now() + std::chrono::seconds(m_Timeout));
+  {
+    std::lock_guard<MutexType> Lock(m_Mutex);
+    m_RunningTokens.insert(spToken);
+  }
+  if (m_Cancelled)
+    spToken->Cancel();
+
+  bool IsRejected = false;
+  try
+  {
+    // A file larger than the limit is read through a window instead of being mapped at once
+    auto FileSize = boost::filesystem::file_size(rFilePath);
+    auto MapMode  = m_MemoryLimit != 0 && FileSize > m_MemoryLimit ? FileBinaryStream::WindowedMapping : FileBinaryStream::AutoMapping;
+    auto spBinStrm = std::make_shared<FileBinaryStream>(rFilePath, MapMode);
+    rResult.m_Size = spBinStrm->GetSize();
+
+    Loader::SPType spLdr;
+    Architecture::VSPType Archs;
+    OperatingSystem::SPType spOs;
+    if (!m_Session.SelectModules(*spBinStrm, spLdr, Archs, spOs))
+      rResult.m_Status = Unsupported;
+
+    else
+    {
+      rResult.m_LoaderName = spLdr->GetName();
+
+      // Loaders are created for each document, so their options can be changed
+      auto& rLdrCfg = spLdr->GetConfigurationModel();
+      if (m_StreamingBudget != 0 && rLdrCfg.IsSet("Streaming"))
+      {
+        rLdrCfg.SetBoolean("Streaming", true);
+        rLdrCfg.SetUint64("Memory budget", m_StreamingBudget);
+      }
+
+      auto spDb = m_Session.MakeDatabase(rDatabaseName);
+      if (spDb == nullptr)
+        throw Exception("database module \"" + rDatabaseName + "\" is not available");
+      if (!spDb->Create(rDatabasePath, true))
+        throw Exception("unable to create database \"" + rDatabasePath.string() + "\"");
+
+      // Architectures are registered by the session, so only the database needs them
+      for (auto const& rspArch : Archs)
+        spDb->RegisterArchitectureTag(rspArch->GetTag());
+      spDb->SetBinaryStream(spBinStrm);
+      spBinStrm->SetEndianness(Archs.front()->GetEndianness());
+
+      Document Doc;
+      Doc.Use(spDb);
+      spLdr->Map(Doc, Archs);
+
+      // A streamed document only keeps its window in memory
+      bool IsStreaming = spLdr->IsStreaming();
+      rResult.m_Footprint = IsStreaming ? rLdrCfg.GetUint64("Memory budget") : EstimateFootprint(Doc, *spBinStrm);
+      if (m_MemoryLimit != 0 && rResult.m_Footprint > m_MemoryLimit)
+      {
+        rResult.m_Status = TooLarge;
+        IsRejected = true;
+      }
+
+      else
+      {
+        // Tasks are run by the worker in the order Medusa::Start queues them
+        Analyzer Anlz;
+        std::vector<std::unique_ptr<Task>> Tasks;
+        StreamAnalyzer* pStrmAnlz = nullptr;
+        if (IsStreaming)
+        {
+          pStrmAnlz = new StreamAnalyzer(Doc, spDb, Archs.front());
+          pStrmAnlz->Configure(rLdrCfg);
+          Tasks.emplace_back(pStrmAnlz);
+        }
+        else
+        {
+          if (spOs != nullptr)
+          {
+            spDb->SetOperatingSystemName(spOs->GetName());
+            spOs->ProvideDetails(Doc);
+          }
+
+          Tasks.emplace_back(Anlz.CreateDisassembleAllFunctionsTask(Doc));
+          Tasks.emplace_back(Anlz.CreateResolveJumpTablesTask(Doc));
+          Tasks.emplace_back(Anlz.CreateAnalyzeStackAllFunctionsTask(Doc));
+          Tasks.emplace_back(Anlz.CreateFindAllStringTask(Doc));
+          if (m_spSigDb != nullptr)
+            Tasks.emplace_back(Anlz.CreateApplySignaturesTask(Doc, m_spSigDb));
+        }
+
+        for (auto& rupTask : Tasks)
+        {
+          if (spToken->IsCancelled())
+            break;
+          rupTask->SetCancellationToken(spToken);
+          rupTask->Run();
+        }
+
+        if (spOs != nullptr && !spToken->IsCancelled())
+          for (auto const& rMCell : Doc.GetMultiCells())
+            if (rMCell.second->GetType() == MultiCell::FunctionType)
+              spOs->AnalyzeFunction(Doc, rMCell.first);
+
+        if (pStrmAnlz != nullptr && !pStrmAnlz->IsSucceeded())
+          throw Exception("unable to stream the analysis to database \"" + rDatabasePath.string() + "\"");
+
+        Doc.GetChangeJournal().Flush();
+        if (!spDb->Close())
+          throw Exception("unable to save database \"" + rDatabasePath.string() + "\"");
+
+        if (spToken->IsTimedOut())
+          rResult.m_Status = TimedOut;
+        else if (spToken->IsCancelled())
+          rResult.m_Status = Cancelled;
+        else
+          rResult.m_Status = Analyzed;
+      }
+    }
+  }
+  catch (Exception& e)
+  {
+    rResult.m_Error = e.What();
+  }
+  catch (std::exception& e)
+  {
+    rResult.m_Error = e.what();
+  }
+
+  // The document saves its database when it's destroyed, a rejected one must not be kept
+  if (IsRejected)
+  {
+    boost::system::error_code ErrCode;
+    boost::filesystem::remove(rDatabasePath, ErrCode);
+  }
+
+  {
+    std::lock_guard<MutexType> Lock(m_Mutex);
+    m_RunningTokens.erase(spToken);
+  }
+  rResult.m_Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count();
+}
@@ -0,0 +1,287 @@
+#include "medusa/binary_diff.hpp"
+#include "medusa/log.hpp"
+#include "medusa/util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <tuple>
+#include <unordered_map>
+
+MEDUSA_NAMESPACE_BEGIN
+
+namespace
+{
+  char const* MatchTypeToString(BinaryDiff::MatchType Type)
+  {
+    switch (Type)
+    {
+    case BinaryDiff::ExactMatch:      return "exact";
+    case BinaryDiff::StructuralMatch: return "structural";
+    case BinaryDiff::CallGraphMatch:  return "call-graph";
+    default:                          return "unknown";
+    }
+  }
+}
+
+BinaryDiff::BinaryDiff(Document& rOldDoc, Document& rNewDoc)
+  : m_rOldDoc(rOldDoc)
+  , m_rNewDoc(rNewDoc)
+  , m_StructThreshold(0.85)
+  , m_CallGraphThreshold(0.5)
+{
+}
+
+bool BinaryDiff::Compute(void)
+{
+  m_OldFingerprints.clear();
+  m_NewFingerprints.clear();
+  m_OldToNew.clear();
+  m_NewToOld.clear();
+  m_Matches.clear();
+
+  auto StartTime = std::chrono::steady_clock::now();
+
+  _ComputeFingerprints(m_rOldDoc, m_OldFingerprints);
+  _ComputeFingerprints(m_rNewDoc, m_NewFingerprints);
+
+  auto FpTime = std::chrono::steady_clock::now();
+
+  if (m_OldFingerprints.empty() || m_NewFingerprints.empty())
+    return false;
+
+  _MatchExact();
+  size_t ExactCnt = m_Matches.size();
+  _MatchStructural();
+  size_t StructCnt = m_Matches.size() - ExactCnt;
+  _MatchCallGraph();
+  size_t CallGraphCnt = m_Matches.size() - ExactCnt - StructCnt;
+
+  auto EndTime = std::chrono::steady_clock::now();
+
+  Log::Write("core")
+    << "diff: " << m_Matches.size() << " match(es)"
+    << " (exact: " << ExactCnt << ", structural: " << StructCnt << ", call-graph: " << CallGraphCnt << ")"
+    << ", fingerprinting: " << std::chrono::duration_cast<std::chrono::milliseconds>(FpTime - StartTime).count() << "ms"
+    << ", matching: "       << std::chrono::duration_cast<std::chrono::milliseconds>(EndTime - FpTime).count() << "ms"
+    << LogEnd;
+
+  return true;
+}
+
+Address::Vector BinaryDiff::GetUnmatchedOldFunctions(void) const
+{
+  Address::Vector Unmatched;
+  for (auto const& rFp : m_OldFingerprints)
+    if (m_OldToNew.find(rFp.first) == std::end(m_OldToNew))
+      Unmatched.push_back(rFp.first);
+  return Unmatched;
+}
+
+Address::Vector BinaryDiff::GetUnmatchedNewFunctions(void) const
+{
+  Address::Vector Unmatched;
+  for (auto const& rFp : m_NewFingerprints)
+    if (m_NewToOld.find(rFp.first) == std::end(m_NewToOld))
+      Unmatched.push_back(rFp.first);
+  return Unmatched;
+}
+
+void BinaryDiff::Report(std::ostream& rOutput) const
+{
+  auto Unmatched = [&](Document const& rDoc, Address::Vector const& rFuncs, char const* pHdr)
+  {
+    rOutput << "## " << pHdr << " (" << rFuncs.size() << ")\n";
+    for (auto const& rAddr : rFuncs)
+      rOutput << rAddr.ToString() << " " << rDoc.GetLabelFromAddress(rAddr).GetLabel() << "\n";
+  };
+
+  rOutput << "# Medusa diff report\n";
+  rOutput << "## Matched functions (" << m_Matches.size() << ")\n";
+  for (auto const& rMatch : m_Matches)
+  {
+    auto OldLbl = m_rOldDoc.GetLabelFromAddress(rMatch.m_OldAddress);
+    auto NewLbl = m_rNewDoc.GetLabelFromAddress(rMatch.m_NewAddress);
+    rOutput
+      << rMatch.m_OldAddress.ToString() << " " << OldLbl.GetLabel()
+      << " -> "
+      << rMatch.m_NewAddress.ToString() << " " << NewLbl.GetLabel()
+      << " " << MatchTypeToString(rMatch.m_Type)
+      << " " << static_cast<int>(rMatch.m_Similarity * 100) << "%\n";
+  }
+  Unmatched(m_rOldDoc, GetUnmatchedOldFunctions(), "Removed functions");
+  Unmatched(m_rNewDoc, GetUnmatchedNewFunctions(), "Added functions");
+  rOutput << std::flush;
+}
+
+void BinaryDiff::_ComputeFingerprints(Document& rDoc, FunctionFingerprint::Map& rFingerprints) const
+{
+  Address::Vector FuncAddrs;
+  for (auto const& rMultiCell : rDoc.GetMultiCells())
+    if (rMultiCell.second->GetType() == MultiCell::FunctionType)
+      FuncAddrs.push_back(rMultiCell.first);
+
+  // Reuse fingerprints from the database when the function hasn't changed
+  std::vector<FunctionFingerprint> Fingerprints(FuncAddrs.size());
+  std::vector<u8> IsComputed(FuncAddrs.size(), 0);
+  ParallelFor(FuncAddrs.size(), [&](size_t Begin, size_t End)
+  {
+    for (size_t i = Begin; i < End; ++i)
+    {
+      if (rDoc.GetFunctionFingerprint(FuncAddrs[i], Fingerprints[i]) && Fingerprints[i].IsUpToDate(rDoc, FuncAddrs[i]))
+        continue;
+      if (Fingerprints[i].Compute(rDoc, FuncAddrs[i]))
+        IsComputed[i] = 1;
+    }
+  });
+
+  u32 ComputedCnt = 0;
+  for (size_t i = 0; i < FuncAddrs.size(); ++i)
+  {
+    if (!Fingerprints[i].IsValid())
+      continue;
+    if (IsComputed[i])
+    {
+      rDoc.SetFunctionFingerprint(FuncAddrs[i], Fingerprints[i]);
+      ++ComputedCnt;
+    }
+    rFingerprints[FuncAddrs[i]] = Fingerprints[i];
+  }
+
+  Log::Write("core") << "diff: " << rFingerprints.size() << " fingerprint(s), " << ComputedCnt << " computed" << LogEnd;
+}
+
+void BinaryDiff::_MatchExact(void)
+{
+  typedef std::unordered_map<u64, Address::Vector> HashMapType;
+  HashMapType OldHashes, NewHashes;
+
+  for (auto const& rFp : m_OldFingerprints)
+    OldHashes[rFp.second.GetInstructionHash()].push_back(rFp.first);
+  for (auto const& rFp : m_NewFingerprints)
+    NewHashes[rFp.second.GetInstructionHash()].push_back(rFp.first);
+
+  // Only unique hashes are reliable, small functions like stubs often share the same hash
+  for (auto const& rOldHash : OldHashes)
+  {
+    if (rOldHash.second.size() != 1)
+      continue;
+    auto itNewHash = NewHashes.find(rOldHash.first);
+    if (itNewHash == std::end(NewHashes) || itNewHash->second.size() != 1)
+      continue;
+    _AddMatch(rOldHash.second.front(), itNewHash->second.front(), 1.0, ExactMatch);
+  }
+}
+
+void BinaryDiff::_MatchStructural(void)
+{
+  Address::Vector OldFuncs = GetUnmatchedOldFunctions();
+  Address::Vector NewFuncs = GetUnmatchedNewFunctions();
+
+  if (OldFuncs.empty() || NewFuncs.empty())
+    return;
+
+  // Each old function looks for its best candidate, this is the expensive part so it's done in parallel
+  typedef std::tuple<double, Address, Address> CandidateType;
+  std::vector<CandidateType> Candidates(OldFuncs.size(), CandidateType(0.0, Address(), Address()));
+  ParallelFor(OldFuncs.size(), [&](size_t Begin, size_t End)
+  {
+    for (size_t i = Begin; i < End; ++i)
+    {
+      auto const& rOldFp = m_OldFingerprints.at(OldFuncs[i]);
+      double BestSim = 0.0;
+      for (auto const& rNewAddr : NewFuncs)
+      {
+        double CurSim = rOldFp.Similarity(m_NewFingerprints.at(rNewAddr));
+        if (CurSim <= BestSim)
+          continue;
+        BestSim = CurSim;
+        Candidates[i] = std::make_tuple(CurSim, OldFuncs[i], rNewAddr);
+      }
+    }
+  });
+
+  // Best candidates are selected first
+  std::sort(std::begin(Candidates), std::end(Candidates), [](CandidateType const& rLhs, CandidateType const& rRhs)
+  {
+    return std::get<0>(rLhs) > std::get<0>(rRhs);
+  });
+
+  for (auto const& rCand : Candidates)
+  {
+    if (std::get<0>(rCand) < m_StructThreshold)
+      break;
+    _AddMatch(std::get<1>(rCand), std::get<2>(rCand), std::get<0>(rCand), StructuralMatch);
+  }
+}
+
+void BinaryDiff::_MatchCallGraph(void)
+{
+  std::deque<std::pair<Address, Address>> MatchQueue;
+  for (auto const& rMatch : m_Matches)
+    MatchQueue.push_back(std::make_pair(rMatch.m_OldAddress, rMatch.m_NewAddress));
+
+  // When two functions are matched, their callees are likely to be matched too
+  while (!MatchQueue.empty())
+  {
+    auto CurMatch = MatchQueue.front();
+    MatchQueue.pop_front();
+
+    auto const& rOldCallees = m_OldFingerprints.at(CurMatch.first).GetCallees();
+    auto const& rNewCallees = m_NewFingerprints.at(CurMatch.second).GetCallees();
+
+    for (size_t OldIdx = 0; OldIdx < rOldCallees.size(); ++OldIdx)
+    {
+      auto const& rOldCallee = rOldCallees[OldIdx];
+      if (m_OldToNew.find(rOldCallee) != std::end(m_OldToNew))
+        continue;
+      auto itOldFp = m_OldFingerprints.find(rOldCallee);
+      if (itOldFp == std::end(m_OldFingerprints))
+        continue;
+
+      // Prefer the callee located at the same call site index
+      double BestSim = 0.0;
+      Address BestAddr;
+      for (size_t NewIdx = 0; NewIdx < rNewCallees.size(); ++NewIdx)
+      {
+        auto const& rNewCallee = rNewCallees[NewIdx];
+        if (m_NewToOld.find(rNewCallee) != std::end(m_NewToOld))
+          continue;
+        auto itNewFp = m_NewFingerprints.find(rNewCallee);
+        if (itNewFp == std::end(m_NewFingerprints))
+          continue;
+
+        double CurSim = itOldFp->second.Similarity(itNewFp->second);
+        if (NewIdx == OldIdx)
+          CurSim += 0.05;
+        if (CurSim <= BestSim)
+          continue;
+        BestSim  = CurSim;
+        BestAddr = rNewCallee;
+      }
+
+      if (BestSim < m_CallGraphThreshold)
+        continue;
+
+      if (_AddMatch(rOldCallee, BestAddr, std::min(BestSim, 1.0), CallGraphMatch))
+        MatchQueue.push_back(std::make_pair(rOldCallee, BestAddr));
+    }
+  }
+}
+
+bool BinaryDiff::_AddMatch(Address const& rOldAddr, Address const& rNewAddr, double Similarity, MatchType Type)
+{
+  if (m_OldToNew.find(rOldAddr) != std::end(m_OldToNew))
+    return false;
+  if (m_NewToOld.find(rNewAddr) != std::end(m_NewToOld))
+    return false;
+
+  m_OldToNew[rOldAddr] = rNewAddr;
+  m_NewToOld[rNewAddr] = rOldAddr;
+
+  Match NewMatch = { rOldAddr, rNewAddr, Similarity, Type };
+  m_Matches.push_back(NewMatch);
+  return true;
+}
+
+MEDUSA_NAMESPACE_END
@@ -0,0 +1,163 @@
+#include "medusa/binary_stream.hpp"
+
+#include <fstream>
+
+MEDUSA_NAMESPACE_USE;
+
+/* binary stream */
+
+std::string const& BinaryStream::GetSha1(void) const
+{
+  if (!m_Sha1.empty())
+    return m_Sha1;
+
+  if (m_pBuffer != nullptr)
+  {
+    m_Sha1 = Sha1(m_pBuffer, static_cast<size_t>(m_Size));
+    return m_Sha1;
+  }
+
+  TOffset CurOff = 0;
+  m_Sha1 = Sha1Chunks([&](void* pBuffer, size_t BufferSize) -> size_t
+  {
+    size_t ReadSize = static_cast<size_t>(std::min<u64>(BufferSize, m_Size - CurOff));
+    if (ReadSize == 0 || !ReadOriginal(CurOff, pBuffer, ReadSize))
+      return 0;
+    CurOff += ReadSize;
+    return ReadSize;
+  });
+  return m_Sha1;
+}
+
+bool BinaryStream::Export(Path const& rFilePath) const
+{
+  std::ofstream File(rFilePath.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!File.is_open())
+    return false;
+
+  // Large streams are not mapped at once, they're saved by chunks
+  std::vector<u8> Chunk(0x100000);
+  for (TOffset CurOff = 0; CurOff < m_Size; CurOff += Chunk.size())
+  {
+    size_t ChunkSize = static_cast<size_t>(std::min<u64>(Chunk.size(), m_Size - CurOff));
+    if (!Read(CurOff, Chunk.data(), ChunkSize))
+      return false;
+    if (!File.write(reinterpret_cast<char const*>(Chunk.data()), ChunkSize))
+      return false;
+  }
+
+  return true;
+}
+
+bool BinaryStream::_ReadMapped(TOffset Position, void* pData, u64 Length) const
+{
+  return false;
+}
+
+u32 BinaryStream::_StringLengthMapped(TOffset Position, u64 Limit) const
+{
+  char Chunk[0x100];
+  u64 StrLen = 0;
+  while (StrLen < Limit)
+  {
+    u64 ChunkSize = std::min<u64>(sizeof(Chunk), Limit - StrLen);
+    if (!Read(Position + StrLen, Chunk, static_cast<size_t>(ChunkSize)))
+      return 0;
+    size_t ChunkLen = ::strnlen(Chunk, static_cast<size_t>(ChunkSize));
+    StrLen += ChunkLen;
+    if (ChunkLen != ChunkSize)
+      return static_cast<u32>(StrLen);
+  }
+  return 0;
+}
+
+/* file binary stream */
+
+bool FileBinaryStream::_ReadMapped(TOffset Position, void* pData, u64 Length) const
+{
+  std::lock_guard<MutexType> Lock(m_WindowMutex);
+
+  u8* pDst = static_cast<u8*>(pData);
+  while (Length != 0)
+  {
+    u64 WndIdx = Position / WindowSize;
+    auto itWnd = std::find_if(std::begin(m_Windows), std::end(m_Windows), [WndIdx](Window const& rWnd)
+    {
+      return rWnd.m_Index == WndIdx;
+    });
+
+    if (itWnd == std::end(m_Windows))
+    {
+      // The least recently used window is the last one
+      if (m_Windows.size() >= MaxWindowNo)
+      {
+        _UnmapView(m_Windows.back().m_pView, m_Windows.back().m_Size);
+        m_Windows.pop_back();
+      }
+
+      TOffset WndOff = WndIdx * WindowSize;
+      Window NewWnd;
+      NewWnd.m_Index = WndIdx;
+      NewWnd.m_Size  = std::min<u64>(WindowSize, m_Size - WndOff);
+      NewWnd.m_pView = static_cast<u8*>(_MapView(WndOff, NewWnd.m_Size, WndIdx == m_LastWindowIndex + 1));
+      if (NewWnd.m_pView == nullptr)
+        return false;
+      m_Windows.insert(std::begin(m_Windows), NewWnd);
+    }
+    else if (itWnd != std::begin(m_Windows))
+      std::rotate(std::begin(m_Windows), itWnd, itWnd + 1);
+    m_LastWindowIndex = WndIdx;
+
+    auto const& rWnd = m_Windows.front();
+    u64 WndOff  = Position - rWnd.m_Index * WindowSize;
+    u64 CopyLen = std::min<u64>(Length, rWnd.m_Size - WndOff);
+    ::memcpy(pDst, rWnd.m_pView + WndOff, static_cast<size_t>(CopyLen));
+
+    pDst     += CopyLen;
+    Position += CopyLen;
+    Length   -= CopyLen;
+  }
+
+  return true;
+}
+
+void FileBinaryStream::_UnmapAllViews(void)
+{
+  std::lock_guard<MutexType> Lock(m_WindowMutex);
+  for (auto const& rWnd : m_Windows)
+    _UnmapView(rWnd.m_pView, rWnd.m_Size);
+  m_Windows.clear();
+  // Reading from the first window is considered as sequential
+  m_LastWindowIndex = ~0ULL;
+}
+
+/* sub binary stream */
+
+SubBinaryStream::SubBinaryStream(BinaryStream const& rParent, TOffset Offset, u64 Size)
+  : BinaryStream()
+  , m_rParent(rParent)
+  , m_Offset(std::min<u64>(Offset, rParent.GetSize()))
+{
+  m_Path       = rParent.GetPath();
+  m_Size       = std::min<u64>(Size, rParent.GetSize() - m_Offset);
+  m_Endianness = rParent.GetEndianness();
+
+  // Patches are written in the overlay of the parent, so both see them
+  m_spOverlay     = rParent.GetOverlay();
+  m_OverlayOffset = rParent.GetOverlayOffset() + m_Offset;
+
+  // A windowed parent is read on demand, otherwise the view points to its buffer
+  if (rParent.GetBuffer() != nullptr)
+    m_pBuffer = const_cast<u8*>(static_cast<u8 const*>(rParent.GetBuffer())) + m_Offset;
+}
+
+SubBinaryStream::~SubBinaryStream(void)
+{
+  // The buffer belongs to the parent
+  m_pBuffer = nullptr;
+}
+
+bool SubBinaryStream::_ReadMapped(TOffset Position, void* pData, u64 Length) const
+{
+  return m_rParent.ReadOriginal(m_Offset + Position, pData, static_cast<size_t>(Length));
+}
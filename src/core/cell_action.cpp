@@ -35,7 +35,9 @@ public:
   virtual void Do(void)
   {
     // TODO: iterate
-    m_rCore.GetDocument().DeleteCell(m_pView->GetCursorAddress());
+    auto const& rAddr = m_pView->GetCursorAddress();
+    if (m_rCore.GetDocument().DeleteCell(rAddr))
+      m_rCore.Reanalyze(Address::List(1, rAddr));
   }
 };
 
@@ -65,7 +67,9 @@ public:
   virtual void Do(void)
   {
     // TODO: iterate
-    m_rCore.GetDocument().ChangeValueSize(m_pView->GetCursorAddress(), 16, true);
+    auto const& rAddr = m_pView->GetCursorAddress();
+    if (m_rCore.GetDocument().ChangeValueSize(rAddr, 16, true))
+      m_rCore.Reanalyze(Address::List(1, rAddr));
   }
 };
 
@@ -95,7 +99,9 @@ public:
   virtual void Do(void)
   {
     // TODO: iterate
-    m_rCore.GetDocument().ChangeValueSize(m_pView->GetCursorAddress(), 32, true);
+    auto const& rAddr = m_pView->GetCursorAddress();
+    if (m_rCore.GetDocument().ChangeValueSize(rAddr, 32, true))
+      m_rCore.Reanalyze(Address::List(1, rAddr));
   }
 };
 
@@ -125,7 +131,9 @@ public:
   virtual void Do(void)
   {
     // TODO: iterate
-    m_rCore.GetDocument().ChangeValueSize(m_pView->GetCursorAddress(), 64, true);
+    auto const& rAddr = m_pView->GetCursorAddress();
+    if (m_rCore.GetDocument().ChangeValueSize(rAddr, 64, true))
+      m_rCore.Reanalyze(Address::List(1, rAddr));
   }
 };
 
@@ -170,7 +178,8 @@ public:
       default: return;
       }
 
-      m_rCore.GetDocument().ChangeValueSize(rAddr, NewSize * 8, true);
+      if (m_rCore.GetDocument().ChangeValueSize(rAddr, NewSize * 8, true))
+        m_rCore.Reanalyze(Address::List(1, rAddr));
     }
   }
 };
@@ -636,7 +645,9 @@ public:
     //  }
     //}
     // TODO: iterate
-    m_rCore.MakeAsciiString(m_pView->GetCursorAddress());
+    auto const& rAddr = m_pView->GetCursorAddress();
+    if (m_rCore.MakeAsciiString(rAddr))
+      m_rCore.Reanalyze(Address::List(1, rAddr));
   }
 };
 
@@ -679,7 +690,9 @@ public:
     //  }
     //}
     // TODO: iterate
-    m_rCore.MakeWindowsString(m_pView->GetCursorAddress());
+    auto const& rAddr = m_pView->GetCursorAddress();
+    if (m_rCore.MakeWindowsString(rAddr))
+      m_rCore.Reanalyze(Address::List(1, rAddr));
   }
 };
 
@@ -2,35 +2,80 @@
 
 MEDUSA_NAMESPACE_USE;
 
-bool LineData::GetOperandNo(u16 Offset, u8& rOperandNo) const
+namespace
 {
-  if (m_OperandsOffset.empty())
-    return false;
+  // Operand offsets are sorted, an offset belongs to the last operand which starts before it
+  template<typename Iterator>
+  bool GetOperandNoFromOffsets(Iterator itOprdOff, Iterator itOprdOffEnd, size_t TextLength, u16 Offset, u8& rOperandNo)
+  {
+    if (itOprdOff == itOprdOffEnd)
+      return false;
 
-  if ((Offset + 1) >= m_Text.length()) // NOTE: we have to add 1 since m_Text includes '\n' character
-    return false;
+    if ((Offset + 1U) >= TextLength) // NOTE: we have to add 1 since the text includes '\n' character
+      return false;
 
-  rOperandNo = 0;
-  for (u16 OprdOff : m_OperandsOffset)
-  {
-    if (Offset < OprdOff)
+    rOperandNo = 0;
+    for (; itOprdOff != itOprdOffEnd; ++itOprdOff)
     {
-      if (rOperandNo == 0)
-        return false;
-      --rOperandNo;
-      return true;
+      if (Offset < *itOprdOff)
+      {
+        if (rOperandNo == 0)
+          return false;
+        --rOperandNo;
+        return true;
+      }
+      ++rOperandNo;
     }
-    ++rOperandNo;
+
+    --rOperandNo;
+    return true;
   }
 
-  --rOperandNo;
-  return true;
+  // Integers are written without stream, setw and setfill('0') are emulated with MinDigitNo
+  size_t FormatInteger(char* pBuffer, size_t BufferSize, u64 Value, u8 Base, u32 MinDigitNo)
+  {
+    static char const s_Digits[] = "0123456789abcdef";
+    char Digits[64];
+    size_t DigitNo = 0;
+
+    do
+    {
+      Digits[DigitNo++] = s_Digits[Value % Base];
+      Value /= Base;
+    } while (Value != 0 && DigitNo < sizeof(Digits));
+
+    size_t Length = 0;
+    for (; MinDigitNo > DigitNo && Length + DigitNo < BufferSize; --MinDigitNo)
+      pBuffer[Length++] = '0';
+    while (DigitNo != 0 && Length < BufferSize)
+      pBuffer[Length++] = Digits[--DigitNo];
+    return Length;
+  }
+}
+
+bool LineView::GetOperandNo(u16 Offset, u8& rOperandNo) const
+{
+  return GetOperandNoFromOffsets(std::begin(m_OperandsOffset), std::end(m_OperandsOffset), m_Text.length(), Offset, rOperandNo);
+}
+
+LineData::LineData(LineView const& rLine)
+  : m_Address(rLine.GetAddress())
+  , m_Text(rLine.GetText().str())
+  , m_Marks(std::begin(rLine.GetMarks()), std::end(rLine.GetMarks()))
+  , m_OperandsOffset(std::begin(rLine.GetOperandsOffset()), std::end(rLine.GetOperandsOffset()))
+{
+}
+
+bool LineData::GetOperandNo(u16 Offset, u8& rOperandNo) const
+{
+  return GetOperandNoFromOffsets(std::begin(m_OperandsOffset), std::end(m_OperandsOffset), m_Text.length(), Offset, rOperandNo);
 }
 
 PrintData::PrintData(void)
   : m_Width(), m_LineWidth(), m_Height()
   , m_PrependAddress(true)
   , m_Indent(2)
+  , m_CurrentTextOffset(), m_CurrentMarkOffset(), m_CurrentOperandOffset()
   , m_CurrentCommentOffset()
 {
 }
@@ -44,45 +89,63 @@ PrintData& PrintData::operator()(Address const& rAddress)
 
 PrintData& PrintData::AppendImmediate(u64 Immediate, u32 Bits, u8 Base)
 {
-  std::ostringstream Buf;
+  char Buf[80];
+  size_t Len = 0;
 
   switch (Base)
   {
   case  2:
     {
-      Buf << "0b";
+      Buf[Len++] = '0';
+      Buf[Len++] = 'b';
+      if (Bits > 64)
+        Bits = 64;
       while (Bits--)
-        Buf << ((Immediate & (1 << Bits)) ? "1" : "0");
-      return AppendImmediate(Buf.str());
+        Buf[Len++] = (Immediate & (1ULL << Bits)) ? '1' : '0';
+      return AppendImmediate(TextView(Buf, Len));
     }
-  case  8: Buf << std::oct << "0";  break;
-  case 10: Buf << std::dec;         break;
-  default: Buf << std::hex << "0x"; break;
+  case  8: Buf[Len++] = '0';                      break;
+  case 10:                                        break;
+  default: Buf[Len++] = '0'; Buf[Len++] = 'x'; Base = 0x10; break;
   }
 
-  Buf << std::setfill('0') << std::setw(Bits / 4) << Immediate;
-  return AppendImmediate(Buf.str());
+  Len += FormatInteger(Buf + Len, sizeof(Buf) - Len, Immediate, Base, Bits / 4);
+  return AppendImmediate(TextView(Buf, Len));
 }
 
 PrintData& PrintData::AppendAddress(Address const& rAddress)
 {
+  // Same output as Address::ToString, but without allocation
+  char Buf[64];
+  size_t Len = 0;
+  auto AddrType = rAddress.GetAddressingType();
+  if (AddrType != Address::FlatType && AddrType != Address::UnknownType)
+  {
+    Len += FormatInteger(Buf, sizeof(Buf) - 1, rAddress.GetBase(), 0x10, rAddress.GetBaseSize() / 4);
+    Buf[Len++] = ':';
+  }
+  Len += FormatInteger(Buf + Len, sizeof(Buf) - Len, rAddress.GetOffset(), 0x10, rAddress.GetOffsetSize() / 4);
+
   m_PrependAddress = false;
-  _AppendText(rAddress.ToString(), Mark::ImmediateType);
+  _AppendText(TextView(Buf, Len), Mark::ImmediateType);
   m_PrependAddress = true;
   return *this;
 }
 
 PrintData& PrintData::AppendSpace(u16 SpaceNo)
 {
-  std::string Spaces(static_cast<std::string::size_type>(SpaceNo), ' ');
-  _AppendText(Spaces, Mark::UnprintableType);
+  _AppendLinePrefix();
+
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  m_Texts.append(static_cast<std::string::size_type>(SpaceNo), ' ');
+  m_Marks.push_back(Mark(Mark::UnprintableType, SpaceNo));
+  m_LineWidth += SpaceNo;
   return *this;
 }
 
 PrintData& PrintData::AppendNewLine(void)
 {
-  if (m_PrependAddress && m_CurrentText.empty())
-    AppendAddress(m_CurrentAddress).AppendSpace(m_Indent);
+  _AppendLinePrefix();
 
   std::lock_guard<MutexType> Lock(m_Mutex);
   ++m_Height;
@@ -90,19 +153,35 @@ PrintData& PrintData::AppendNewLine(void)
     m_Width = m_LineWidth;
   m_LineWidth = 0;
 
-  m_CurrentText += "\n";
-  m_CurrentMarks.push_back(Mark(Mark::UnprintableType, 1));
-  m_Lines.push_back(LineData(m_CurrentAddress, m_CurrentText, m_CurrentMarks, m_CurrentOperandsOffset));
+  m_Texts += '\n';
+  m_Marks.push_back(Mark(Mark::UnprintableType, 1));
+  _PushLine();
+  return *this;
+}
 
-  m_CurrentText = "";
-  m_CurrentMarks.clear();
-  m_CurrentOperandsOffset.clear();
+PrintData& PrintData::AppendLine(LineView const& rLine)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  ++m_Height;
+  auto const& rText = rLine.GetText();
+  u16 LineWidth = static_cast<u16>(rText.empty() ? 0 : rText.length() - 1); // NOTE: the text ends with '\n'
+  if (LineWidth > m_Width)
+    m_Width = LineWidth;
+
+  m_CurrentAddress = rLine.GetAddress();
+  m_Texts.append(rText.data(), rText.length());
+  m_Marks.insert(std::end(m_Marks), std::begin(rLine.GetMarks()), std::end(rLine.GetMarks()));
+  m_OperandsOffset.insert(std::end(m_OperandsOffset), std::begin(rLine.GetOperandsOffset()), std::end(rLine.GetOperandsOffset()));
+  _PushLine();
   return *this;
 }
 
 PrintData& PrintData::MarkOffset(void)
 {
-  m_CurrentOperandsOffset.insert(m_CurrentText.length());
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  u16 OprdOff = static_cast<u16>(m_Texts.length() - m_CurrentTextOffset);
+  if (m_OperandsOffset.size() == m_CurrentOperandOffset || m_OperandsOffset.back() < OprdOff)
+    m_OperandsOffset.push_back(OprdOff);
   return *this;
 }
 
@@ -111,8 +190,8 @@ Address::List PrintData::GetAddresses(void) const
   Address::List Addrs;
 
   std::lock_guard<MutexType> Lock(m_Mutex);
-  for (auto const& Line : m_Lines)
-    Addrs.push_back(Line.GetAddress());
+  for (auto const& rLine : m_Lines)
+    Addrs.push_back(rLine.m_Address);
   Addrs.push_back(m_CurrentAddress);
   return Addrs;
 }
@@ -122,7 +201,7 @@ bool PrintData::GetFirstAddress(Address& rAddress) const
   std::lock_guard<MutexType> Lock(m_Mutex);
   if (m_Lines.empty())
     return false;
-  rAddress = m_Lines.front().GetAddress();
+  rAddress = m_Lines.front().m_Address;
   return true;
 }
 
@@ -131,77 +210,49 @@ bool PrintData::GetLastAddress(Address& rAddress) const
   std::lock_guard<MutexType> Lock(m_Mutex);
   if (m_Lines.empty())
     return false;
-  rAddress = m_Lines.back().GetAddress();
+  rAddress = m_Lines.back().m_Address;
   return true;
 }
 
 std::string PrintData::GetTexts(void) const
 {
-  std::string Texts;
-
   std::lock_guard<MutexType> Lock(m_Mutex);
-  for (auto const& rLine : m_Lines)
-    Texts += rLine.GetText();
-  Texts += m_CurrentText;
-  return Texts;
+  return m_Texts;
 }
 
 std::vector<std::string> PrintData::GetTextLines(void) const
 {
   std::vector<std::string> Lines;
-  Lines.reserve(m_Lines.size());
 
   std::lock_guard<MutexType> Lock(m_Mutex);
+  Lines.reserve(m_Lines.size());
   for (auto const& rLine : m_Lines)
-    Lines.push_back(rLine.GetText());
+    Lines.push_back(m_Texts.substr(rLine.m_TextOffset, rLine.m_TextLength));
   return Lines;
 }
 
 Mark::List PrintData::GetMarks(void) const
 {
-  Mark::List Marks;
-
   std::lock_guard<MutexType> Lock(m_Mutex);
-  for (auto const& rLine : m_Lines)
-    for (auto const& rMark : rLine.GetMarks())
-      Marks.push_back(rMark);
-  for (auto const& rMark : m_CurrentMarks)
-    Marks.push_back(rMark);
-  return Marks;
+  return Mark::List(std::begin(m_Marks), std::end(m_Marks));
 }
 
 bool PrintData::GetLine(u16 LineNo, u16& rOffset, LineData& rLine) const
 {
   std::lock_guard<MutexType> Lock(m_Mutex);
 
-  if (m_Lines.empty())
-    return false;
-
-  if (LineNo > m_Lines.size())
+  if (LineNo >= m_Lines.size())
     return false;
 
+  // The offset is the number of previous lines which belong to the same address
   u16 LineOff = 0;
-  Address RefAddr = Address();
-  for (auto const& rCurLine : m_Lines)
-  {
-    if (!(RefAddr == rCurLine.GetAddress()))
-    {
-      RefAddr = rCurLine.GetAddress();
-      LineOff = 0;
-    }
-
-    if (LineNo-- == 0)
-    {
-      rOffset = LineOff;
-      rLine = rCurLine;
-      return true;
-    }
-
-    if (RefAddr == rCurLine.GetAddress())
-      ++LineOff;
-  }
+  auto const& rCurLine = m_Lines[LineNo];
+  while (LineOff < LineNo && m_Lines[LineNo - LineOff - 1].m_Address == rCurLine.m_Address)
+    ++LineOff;
 
-  return false;
+  rOffset = LineOff;
+  rLine = LineData(_GetLineView(rCurLine));
+  return true;
 }
 
 bool PrintData::GetLine(Address const& rAddress, u16 Offset, LineData& rLine) const
@@ -209,11 +260,11 @@ bool PrintData::GetLine(Address const& rAddress, u16 Offset, LineData& rLine) co
   std::lock_guard<MutexType> Lock(m_Mutex);
   for (auto const& rCurLine : m_Lines)
   {
-    if (rCurLine.GetAddress() == rAddress)
+    if (rCurLine.m_Address == rAddress)
     {
       if (Offset == 0x0)
       {
-        rLine = rCurLine;
+        rLine = LineData(_GetLineView(rCurLine));
         return true;
       }
       else
@@ -223,12 +274,24 @@ bool PrintData::GetLine(Address const& rAddress, u16 Offset, LineData& rLine) co
   return false;
 }
 
+TextView PrintData::GetCurrentText(void) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  return TextView(m_Texts.data() + m_CurrentTextOffset, m_Texts.length() - m_CurrentTextOffset);
+}
+
+u32 PrintData::GetNumberOfLines(void) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  return static_cast<u32>(m_Lines.size());
+}
+
 u16 PrintData::GetLineNo(Address const& rAddress) const
 {
   std::lock_guard<MutexType> Lock(m_Mutex);
   u16 LineNo = 0x0;
   for (auto const& rCurLine : m_Lines)
-    if (rCurLine.GetAddress() == rAddress)
+    if (rCurLine.m_Address == rAddress)
       ++LineNo;
   return LineNo;
 }
@@ -239,7 +302,7 @@ bool PrintData::GetLineOffset(Address const& rAddress, u16& rOffset) const
   std::lock_guard<MutexType> Lock(m_Mutex);
   for (auto const& rCurLine : m_Lines)
   {
-    if (rCurLine.GetAddress() == rAddress)
+    if (rCurLine.m_Address == rAddress)
       return true;
     else
       ++rOffset;
@@ -249,17 +312,23 @@ bool PrintData::GetLineOffset(Address const& rAddress, u16& rOffset) const
 
 bool PrintData::GetOperandNo(Address const& rAddress, u16 xOffset, u16 yOffset, u8& rOperandNo) const
 {
-  LineData Line;
-  if (!GetLine(rAddress, yOffset, Line))
-    return false;
-  return Line.GetOperandNo(xOffset, rOperandNo);
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  for (auto const& rCurLine : m_Lines)
+  {
+    if (!(rCurLine.m_Address == rAddress))
+      continue;
+    if (yOffset-- != 0x0)
+      continue;
+    return _GetLineView(rCurLine).GetOperandNo(xOffset, rOperandNo);
+  }
+  return false;
 }
 
 bool PrintData::Contains(Address const& rAddress) const
 {
   std::lock_guard<MutexType> Lock(m_Mutex);
   for (auto const& rCurLine : m_Lines)
-    if (rCurLine.GetAddress() == rAddress)
+    if (rCurLine.m_Address == rAddress)
       return true;
   return false;
 }
@@ -268,19 +337,28 @@ void PrintData::ForEachLine(LineCallback Callback) const
 {
   std::lock_guard<MutexType> Lock(m_Mutex);
   for (auto const& rLine : m_Lines)
-    Callback(rLine.GetAddress(), rLine.GetText(), rLine.GetMarks());
+  {
+    auto CurLine = _GetLineView(rLine);
+    Callback(CurLine.GetAddress(), CurLine.GetText(), CurLine.GetMarks());
+  }
 }
 
-void PrintData::_AppendText(std::string const& rText, Mark::Type MarkType)
+void PrintData::ForEachLineView(LineViewCallback Callback, u32 FirstLine) const
 {
-  if (m_PrependAddress && m_CurrentText.empty())
-    AppendAddress(m_CurrentAddress).AppendSpace(m_Indent);
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  for (size_t LineIdx = FirstLine; LineIdx < m_Lines.size(); ++LineIdx)
+    Callback(_GetLineView(m_Lines[LineIdx]));
+}
+
+void PrintData::_AppendText(TextView const& rText, Mark::Type MarkType)
+{
+  _AppendLinePrefix();
 
   u16 TextLen = static_cast<u16>(rText.length());
   {
     std::lock_guard<MutexType> Lock(m_Mutex);
-    m_CurrentText.append(rText);
-    m_CurrentMarks.push_back(Mark(MarkType, TextLen));
+    m_Texts.append(rText.data(), rText.length());
+    m_Marks.push_back(Mark(MarkType, TextLen));
     m_LineWidth += TextLen;
   }
 
@@ -288,15 +366,56 @@ void PrintData::_AppendText(std::string const& rText, Mark::Type MarkType)
     AppendSpace(16 - TextLen);
 }
 
+void PrintData::_AppendLinePrefix(void)
+{
+  if (m_PrependAddress && m_Texts.length() == m_CurrentTextOffset)
+    AppendAddress(m_CurrentAddress).AppendSpace(m_Indent);
+}
+
+void PrintData::_PushLine(void)
+{
+  LineRecord NewLine;
+  NewLine.m_Address       = m_CurrentAddress;
+  NewLine.m_TextOffset    = m_CurrentTextOffset;
+  NewLine.m_MarkOffset    = m_CurrentMarkOffset;
+  NewLine.m_OperandOffset = m_CurrentOperandOffset;
+  NewLine.m_TextLength    = static_cast<u16>(m_Texts.length() - m_CurrentTextOffset);
+  NewLine.m_MarkNo        = static_cast<u16>(m_Marks.size() - m_CurrentMarkOffset);
+  NewLine.m_OperandNo     = static_cast<u16>(m_OperandsOffset.size() - m_CurrentOperandOffset);
+  m_Lines.push_back(NewLine);
+
+  m_CurrentTextOffset    = static_cast<u32>(m_Texts.length());
+  m_CurrentMarkOffset    = static_cast<u32>(m_Marks.size());
+  m_CurrentOperandOffset = static_cast<u32>(m_OperandsOffset.size());
+}
+
+LineView PrintData::_GetLineView(LineRecord const& rLine) const
+{
+  return LineView(
+    rLine.m_Address,
+    TextView(m_Texts.data() + rLine.m_TextOffset, rLine.m_TextLength),
+    Mark::View(m_Marks.data() + rLine.m_MarkOffset, rLine.m_MarkNo),
+    ArrayView<u16>(m_OperandsOffset.data() + rLine.m_OperandOffset, rLine.m_OperandNo));
+}
+
 void PrintData::Clear(void)
 {
+  // Arenas keep their capacity, formatting again won't allocate
   std::lock_guard<MutexType> Lock(m_Mutex);
-  m_CurrentAddress = Address();
-  m_CurrentText.clear();
-  m_CurrentMarks.clear();
-  m_CurrentOperandsOffset.clear();
+  m_CurrentAddress       = Address();
+  m_CurrentTextOffset    = 0;
+  m_CurrentMarkOffset    = 0;
+  m_CurrentOperandOffset = 0;
+  m_Texts.clear();
+  m_Marks.clear();
+  m_OperandsOffset.clear();
   m_Lines.clear();
   m_Width     = 0;
   m_LineWidth = 0;
   m_Height    = 0;
-}
\ No newline at end of file
+}
+
+std::ostream& operator<<(std::ostream& rOstrm, medusa::TextView const& rText)
+{
+  return rOstrm.write(rText.data(), static_cast<std::streamsize>(rText.length()));
+}
@@ -0,0 +1,187 @@
+#include "medusa/change_journal.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+MEDUSA_NAMESPACE_USE;
+
+ChangeJournal::ChangeJournal(DeliverCallbackType Deliver, u32 Delay)
+  : m_Deliver(Deliver)
+  , m_Delay(Delay)
+  , m_DocumentUpdated(false)
+  , m_ChangeNo(0)
+  , m_BatchNo(0)
+  , m_TakenNo(0)
+  , m_Running(true)
+{
+  m_Thread = std::thread(&ChangeJournal::_Run, this);
+}
+
+ChangeJournal::~ChangeJournal(void)
+{
+  Stop();
+}
+
+void ChangeJournal::SetDelay(u32 Delay)
+{
+  m_Delay = Delay;
+  if (Delay == 0)
+    Flush();
+}
+
+void ChangeJournal::AddDocumentUpdate(void)
+{
+  bool WasEmpty;
+  {
+    std::lock_guard<MutexType> Lock(m_Mutex);
+    WasEmpty = _IsEmpty();
+    m_DocumentUpdated = true;
+  }
+  ++m_ChangeNo;
+  _Notify(WasEmpty);
+}
+
+void ChangeJournal::AddLabelUpdate(Address const& rAddress, Label const& rLabel, bool Removed)
+{
+  bool WasEmpty;
+  {
+    std::lock_guard<MutexType> Lock(m_Mutex);
+    WasEmpty = _IsEmpty();
+    LabelChange CurChg = { rAddress, rLabel, Removed };
+    m_Labels.push_back(CurChg);
+  }
+  ++m_ChangeNo;
+  _Notify(WasEmpty);
+}
+
+void ChangeJournal::AddLabelUpdate(LabelChangeVector const& rLabels)
+{
+  if (rLabels.empty())
+    return;
+
+  bool WasEmpty;
+  {
+    std::lock_guard<MutexType> Lock(m_Mutex);
+    WasEmpty = _IsEmpty();
+    m_Labels.insert(std::end(m_Labels), std::begin(rLabels), std::end(rLabels));
+  }
+  ++m_ChangeNo;
+  _Notify(WasEmpty);
+}
+
+void ChangeJournal::AddAddressUpdate(Address const& rAddress)
+{
+  bool WasEmpty;
+  {
+    std::lock_guard<MutexType> Lock(m_Mutex);
+    WasEmpty = _IsEmpty();
+    m_Addresses.push_back(rAddress);
+  }
+  ++m_ChangeNo;
+  _Notify(WasEmpty);
+}
+
+void ChangeJournal::AddAddressUpdate(Address::List const& rAddresses)
+{
+  if (rAddresses.empty())
+    return;
+
+  bool WasEmpty;
+  {
+    std::lock_guard<MutexType> Lock(m_Mutex);
+    WasEmpty = _IsEmpty();
+    m_Addresses.insert(std::end(m_Addresses), std::begin(rAddresses), std::end(rAddresses));
+  }
+  ++m_ChangeNo;
+  _Notify(WasEmpty);
+}
+
+void ChangeJournal::Flush(void)
+{
+  std::lock_guard<std::recursive_mutex> DeliverLock(m_DeliverMutex);
+
+  bool              DocUpdated;
+  LabelChangeVector Labels;
+  Address::Vector   Addrs;
+  {
+    std::lock_guard<MutexType> Lock(m_Mutex);
+    if (_IsEmpty())
+      return;
+    DocUpdated = m_DocumentUpdated;
+    m_DocumentUpdated = false;
+    Labels.swap(m_Labels);
+    Addrs.swap(m_Addresses);
+    ++m_TakenNo;
+  }
+
+  // The worker must not wait for a batch which was flushed by a caller
+  m_CondVar.notify_one();
+
+  // Subscribers receive each modified address once, in order
+  std::sort(std::begin(Addrs), std::end(Addrs));
+  Address::List AddrList(std::begin(Addrs), std::unique(std::begin(Addrs), std::end(Addrs)));
+
+  ++m_BatchNo;
+  m_Deliver(DocUpdated, Labels, AddrList);
+}
+
+void ChangeJournal::Clear(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  m_DocumentUpdated = false;
+  m_Labels.clear();
+  m_Addresses.clear();
+}
+
+void ChangeJournal::Stop(void)
+{
+  {
+    std::lock_guard<MutexType> Lock(m_Mutex);
+    if (!m_Running)
+      return;
+    m_Running = false;
+  }
+  m_CondVar.notify_one();
+  if (m_Thread.joinable())
+    m_Thread.join();
+}
+
+bool ChangeJournal::_IsEmpty(void) const
+{
+  return !m_DocumentUpdated && m_Labels.empty() && m_Addresses.empty();
+}
+
+void ChangeJournal::_Notify(bool WasEmpty)
+{
+  // Without delay, the caller delivers its own change like a regular signal
+  if (m_Delay == 0)
+  {
+    Flush();
+    return;
+  }
+
+  // The worker only needs to be woken up by the first change of a batch
+  if (WasEmpty)
+    m_CondVar.notify_one();
+}
+
+void ChangeJournal::_Run(void)
+{
+  std::unique_lock<MutexType> Lock(m_Mutex);
+  while (m_Running)
+  {
+    m_CondVar.wait(Lock, [this] { return !m_Running || !_IsEmpty(); });
+    if (!m_Running)
+      break;
+
+    // Changes recorded during the delay are delivered in the same batch
+    u64 TakenNo = m_TakenNo;
+    m_CondVar.wait_for(Lock, std::chrono::milliseconds(m_Delay.load()), [this, TakenNo] { return !m_Running || m_TakenNo != TakenNo; });
+    if (m_TakenNo != TakenNo)
+      continue;
+
+    Lock.unlock();
+    Flush();
+    Lock.lock();
+  }
+}
@@ -1,10 +1,9 @@
 #include "medusa/control_flow_graph.hpp"
 #include <boost/graph/graphviz.hpp>
-#include <boost/graph/kamada_kawai_spring_layout.hpp>
-#include <boost/graph/fruchterman_reingold.hpp>
-#include <boost/graph/random_layout.hpp>
 #include "medusa/address.hpp"
 #include "medusa/instruction.hpp"
+#include "medusa/graph_layout.hpp"
+#include "medusa/task.hpp"
 #include "medusa/log.hpp"
 
 MEDUSA_NAMESPACE_USE
@@ -40,6 +39,14 @@ bool ControlFlowGraph::AddBasicBlockEdge(BasicBlockEdgeProperties const& rEdge,
 
 bool ControlFlowGraph::FindBasicBlock(Address const& rAddr, BasicBlockVertexDescriptor& BasicBlckDesc)
 {
+  // Most of the time, rAddr is the first address of a basic block
+  auto itVertex = m_VertexMap.find(rAddr);
+  if (itVertex != std::end(m_VertexMap))
+  {
+    BasicBlckDesc = itVertex->second;
+    return true;
+  }
+
   for (auto itVertexPair = std::begin(m_VertexMap); itVertexPair != std::end(m_VertexMap); ++itVertexPair)
   {
     if (m_Graph[itVertexPair->second].Contains(rAddr))
@@ -127,18 +134,30 @@ void ControlFlowGraph::Finalize(Document const& rDoc)
   }
 }
 
-bool ControlFlowGraph::Layout(PositionMap& rPosMap)
+bool ControlFlowGraph::Layout(PositionMap& rPosMap, CancellationToken const* pToken)
 {
-  PointVector BscBlkPts;
-  BscBlkPts.resize(boost::num_vertices(m_Graph));
-  rPosMap = PositionMap(BscBlkPts.begin(), boost::get(boost::vertex_index, m_Graph));
+  // Basic blocks don't have any size here, only their relative positions matter
+  GraphLayout BscBlkLayout;
+  BasicBlockIterator BscBlkIter, BscBlkIterEnd;
+  for (boost::tie(BscBlkIter, BscBlkIterEnd) = boost::vertices(m_Graph); BscBlkIter != BscBlkIterEnd; ++BscBlkIter)
+    BscBlkLayout.AddNode(0, 0);
 
-  boost::random_graph_layout(m_Graph, rPosMap, boost::square_topology<>(50.0));
+  auto EdgeRange = boost::edges(m_Graph);
+  for (auto itEdge = EdgeRange.first; itEdge != EdgeRange.second; ++itEdge)
+    BscBlkLayout.AddEdge(
+      static_cast<u32>(boost::source(*itEdge, m_Graph)),
+      static_cast<u32>(boost::target(*itEdge, m_Graph)));
 
-  BasicBlockIterator BscBlkIter, BscBlkIterEnd;
+  if (!BscBlkLayout.Compute(pToken))
+    return false;
+
+  m_LayoutPoints.resize(boost::num_vertices(m_Graph));
+  m_Layout = rPosMap = PositionMap(m_LayoutPoints.begin(), boost::get(boost::vertex_index, m_Graph));
   for (boost::tie(BscBlkIter, BscBlkIterEnd) = boost::vertices(m_Graph); BscBlkIter != BscBlkIterEnd; ++BscBlkIter)
   {
-    std::cout << rPosMap[*BscBlkIter][0] << " " << rPosMap[*BscBlkIter][1] << std::endl;
+    auto const& rPos = BscBlkLayout.GetNodePosition(static_cast<u32>(*BscBlkIter));
+    rPosMap[*BscBlkIter][0] = rPos.m_X;
+    rPosMap[*BscBlkIter][1] = rPos.m_Y;
   }
 
   return true;
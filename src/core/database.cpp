@@ -46,6 +46,26 @@ bool Database::Close(void)
   return false;
 }
 
+bool Database::BeginStream(void)
+{
+  return false;
+}
+
+bool Database::StreamCellData(Address const& rAddress, CellData const& rCellData)
+{
+  return false;
+}
+
+bool Database::StreamLabel(Address const& rAddress, Label const& rLabel)
+{
+  return false;
+}
+
+bool Database::EndStream(void)
+{
+  return false;
+}
+
 Database& Database::SetBinaryStream(BinaryStream::SPType spBinStrm)
 {
   m_spBinStrm = spBinStrm;
@@ -68,4 +88,36 @@ std::string Database::GetOperatingSystemName(void) const
   return m_OsName;
 }
 
+bool Database::AddLabels(LabelVector const& rLabels, bool Force, LabelVector& rRemovedLabels, LabelVector& rAddedLabels)
+{
+  for (auto const& rLblPair : rLabels)
+  {
+    Label OldLbl, NewLbl = rLblPair.second;
+    if (GetLabel(rLblPair.first, OldLbl))
+    {
+      if ((!Force && !OldLbl.IsAutoGenerated()) || OldLbl == NewLbl)
+        continue;
+      if (!RemoveLabel(rLblPair.first))
+        return false;
+      rRemovedLabels.push_back(std::make_pair(rLblPair.first, OldLbl));
+    }
+
+    Address Addr;
+    while (GetLabelAddress(NewLbl, Addr))
+      NewLbl.IncrementVersion();
+    if (!AddLabel(rLblPair.first, NewLbl))
+      return false;
+    rAddedLabels.push_back(std::make_pair(rLblPair.first, NewLbl));
+  }
+  return true;
+}
+
+bool Database::AddCrossReferences(CrossReferenceVector const& rCrossRefs)
+{
+  bool Res = true;
+  for (auto const& rXRef : rCrossRefs)
+    Res &= AddCrossReference(rXRef.first, rXRef.second);
+  return Res;
+}
+
 MEDUSA_NAMESPACE_END
@@ -96,7 +96,71 @@ void FormatDisassembly::operator()(std::pair<Address const&, Address const&> con
   }
 }
 
+u16 FormatDisassembly::GetLineNo(Document const& rDoc, Address const& rAddress, u32 Flags)
+{
+  u16 LineNo = 0;
+
+  // Header
+  if (rDoc.GetStartAddress() == rAddress)
+    LineNo += 4;
+
+  // MemoryArea
+  auto pMemArea = rDoc.GetMemoryArea(rAddress);
+  if (pMemArea != nullptr && pMemArea->GetBaseAddress() == rAddress)
+    LineNo += 2;
+
+  // XRefs
+  if (rDoc.HasCrossReferenceFrom(rAddress))
+    LineNo += (Flags & AddSpaceBeforeXref) ? 2 : 1;
+
+  // Label
+  if (rDoc.GetLabelFromAddress(rAddress).GetType() != Label::Unknown)
+    ++LineNo;
+
+  // Multicell
+  if (rDoc.GetMultiCell(rAddress) != nullptr)
+    ++LineNo;
+
+  // Cell and its comment
+  if (rDoc.GetCellType(rAddress) != Cell::CellType)
+  {
+    ++LineNo;
+    std::string Cmt;
+    if (rDoc.GetComment(rAddress, Cmt))
+      LineNo += static_cast<u16>(std::count(std::begin(Cmt), std::end(Cmt), '\n'));
+  }
+
+  return LineNo;
+}
+
 void FormatDisassembly::_Format(Address const& rAddress, u32 Flags)
+{
+  if (m_pLineCache == nullptr)
+  {
+    _FormatLines(rAddress, Flags);
+    return;
+  }
+
+  if (m_pLineCache->Replay(rAddress, m_rPrintData))
+    return;
+
+  // The address will be formatted by someone else, e.g. a background thread
+  if (m_pPendingAddresses != nullptr)
+  {
+    m_pPendingAddresses->push_back(rAddress);
+    _FormatPlaceholder(rAddress, Flags);
+    return;
+  }
+
+  // Lines are formatted in place, the cache copies them from the first new line
+  // unless rAddress is invalidated meanwhile (the epoch is read before the document)
+  u32 Epoch = m_pLineCache->GetEpoch(rAddress);
+  u32 FirstLine = m_rPrintData.GetNumberOfLines();
+  _FormatLines(rAddress, Flags);
+  m_pLineCache->Insert(rAddress, m_rPrintData, FirstLine, Epoch);
+}
+
+void FormatDisassembly::_FormatLines(Address const& rAddress, u32 Flags)
 {
   auto& rDoc = m_rCore.GetDocument();
 
@@ -149,6 +213,15 @@ void FormatDisassembly::_Format(Address const& rAddress, u32 Flags)
   }
 }
 
+void FormatDisassembly::_FormatPlaceholder(Address const& rAddress, u32 Flags)
+{
+  // The expected number of lines is kept, so the view doesn't jump when the real lines arrive
+  m_rPrintData(rAddress);
+  u16 LineNo = std::max<u16>(GetLineNo(m_rCore.GetDocument(), rAddress, Flags), 1);
+  for (u16 i = 0; i < LineNo; ++i)
+    m_rPrintData.AppendComment(";; ...").AppendNewLine();
+}
+
 void FormatDisassembly::_FormatHeader(Address const& rAddress, u32 Flags)
 {
   m_rPrintData.AppendComment(";; File disassembled with ").AppendComment(Medusa::GetVersion()).AppendNewLine();
@@ -265,10 +338,20 @@ void DisassemblyView::GetDimension(u32& rWidth, u32& rHeight) const
 }
 
 FullDisassemblyView::FullDisassemblyView(Medusa& rCore, u32 FormatFlags, u32 Width, u32 Height, Address const& rAddress)
-  : View(Document::Subscriber::DocumentUpdated, rCore.GetDocument())
+  : View(
+    Document::Subscriber::DocumentUpdated
+  | Document::Subscriber::MemoryAreaUpdated
+  | Document::Subscriber::AddressUpdated
+  | Document::Subscriber::LabelUpdated,
+    rCore.GetDocument())
   , m_rCore(rCore)
   , m_FormatFlags(FormatFlags)
-  , m_Format(rCore, m_PrintData)
+  , m_LineCache()
+  , m_LineIndex(rCore.GetDocument(), [this](Address const& rAddress)
+  {
+    return FormatDisassembly::GetLineNo(m_rDoc, rAddress, m_FormatFlags);
+  })
+  , m_Format(rCore, m_PrintData, &m_LineCache)
   , m_Top(rAddress)
   , m_Cursor(rAddress)
   , m_SelectionBegin(), m_SelectionEnd()
@@ -348,6 +431,27 @@ bool FullDisassemblyView::MoveView(s32 xOffset, s32 yOffset)
     return true;
   }
 
+  // Long moves rely on the line index instead of walking the cells
+  u32 TopLine;
+  if ((yOffset > 1 || yOffset < -1) && m_LineIndex.ConvertAddressToLine(m_Top.m_Address, TopLine))
+  {
+    s64 NewLine = static_cast<s64>(TopLine) + yNewOffset;
+    Address NewAddr;
+    u16 NewOffset;
+    if (!m_LineIndex.ConvertLineToAddress(static_cast<u32>(NewLine < 0 ? 0 : NewLine), NewAddr, NewOffset))
+      return false;
+
+    m_Top.m_Address = NewAddr;
+    m_Top.m_yAddressOffset = NewOffset;
+    Refresh();
+
+    // The index doesn't count lines added by the architecture, so the offset is clamped
+    u16 NewLineNo = m_PrintData.GetLineNo(NewAddr);
+    if (NewLineNo != 0 && m_Top.m_yAddressOffset >= NewLineNo)
+      m_Top.m_yAddressOffset = NewLineNo - 1;
+    return true;
+  }
+
   auto const& rDoc = m_rCore.GetDocument();
 
   Address NewAddr;
@@ -561,6 +665,39 @@ bool FullDisassemblyView::GoTo(Address const& rAddress, bool SaveHistory)
   return true;
 }
 
+bool FullDisassemblyView::GoToLine(u32 Line)
+{
+  Address TopAddr;
+  u16 TopOffset;
+  if (!m_LineIndex.ConvertLineToAddress(Line, TopAddr, TopOffset))
+    return false;
+
+  {
+    std::lock_guard<MutexType> Lock(m_Mutex);
+
+    m_Top.m_Address = TopAddr;
+    m_Top.m_yAddressOffset = TopOffset;
+  }
+  OnDocumentUpdated();
+
+  return true;
+}
+
+u32 FullDisassemblyView::GetNumberOfLines(void)
+{
+  return m_LineIndex.GetNumberOfLines();
+}
+
+bool FullDisassemblyView::GetTopLine(u32& rLine)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+
+  if (!m_LineIndex.ConvertAddressToLine(m_Top.m_Address, rLine))
+    return false;
+  rLine += m_Top.m_yAddressOffset;
+  return true;
+}
+
 bool FullDisassemblyView::GetAddressFromPosition(Address& rAddress, u32 xPos, u32 yPos) const
 {
   std::lock_guard<MutexType> Lock(m_Mutex);
@@ -573,6 +710,37 @@ bool FullDisassemblyView::GetAddressFromPosition(Address& rAddress, u32 xPos, u3
   return true;
 }
 
+void FullDisassemblyView::OnMemoryAreaUpdated(MemoryArea const& rMemArea, bool Removed)
+{
+  m_LineCache.Clear();
+  m_LineIndex.Invalidate();
+}
+
+void FullDisassemblyView::OnAddressUpdated(Address::List const& rAddressList)
+{
+  m_LineCache.Invalidate(rAddressList);
+  m_LineIndex.Update(rAddressList);
+}
+
+void FullDisassemblyView::OnLabelUpdated(Address const& rAddress, Label const& rLabel, bool Removed)
+{
+  // The label has its own line, so the address may not have the same number of lines
+  m_LineCache.Invalidate(rAddress);
+  m_LineIndex.Update(Address::List(1, rAddress));
+
+  // Operands which refer to this label must be formatted again
+  Address::List RefAddrs;
+  if (!m_rDoc.GetCrossReferenceFrom(rAddress, RefAddrs))
+    return;
+  for (auto const& rRefAddr : RefAddrs)
+  {
+    Address CellAddr;
+    if (m_rDoc.GetNearestAddress(rRefAddr, CellAddr))
+      m_LineCache.Invalidate(CellAddr);
+    m_LineCache.Invalidate(rRefAddr);
+  }
+}
+
 void FullDisassemblyView::BeginSelection(u32 x, u32 y)
 {
   _ConvertViewOffsetToAddressOffset(m_SelectionBegin, x, y);
@@ -11,11 +11,25 @@ MEDUSA_NAMESPACE_BEGIN
 
 Document::Document(void)
 : m_AddressHistoryIndex()
+, m_MaxBasicBlockLength()
+, m_IsFunctionIndexBuilt(false)
+, m_Journal([this](bool DocumentUpdated, ChangeJournal::LabelChangeVector const& rLabels, Address::List const& rAddresses)
+{
+  // This order is part of the Subscriber contract, see document.hpp
+  for (auto const& rLblChg : rLabels)
+    m_LabelUpdatedSignal(rLblChg.m_Address, rLblChg.m_Label, rLblChg.m_Removed);
+  if (DocumentUpdated)
+    m_DocumentUpdatedSignal();
+  if (!rAddresses.empty())
+    m_AddressUpdatedSignal(rAddresses);
+})
 {
 }
 
 Document::~Document(void)
 {
+  m_Journal.Stop();
+  m_Journal.Clear();
   if (m_spDatabase)
     m_spDatabase->Close();
   m_QuitSignal();
@@ -38,8 +52,16 @@ bool Document::Flush(void)
 void Document::RemoveAll(void)
 {
   m_spDatabase = nullptr;
+  {
+    std::lock_guard<MutexType> FuncIdxLock(m_FunctionIndexMutex);
+    m_BasicBlockOwners.clear();
+    m_FunctionBasicBlocks.clear();
+    m_MaxBasicBlockLength  = 0;
+    m_IsFunctionIndexBuilt = false;
+  }
   std::lock_guard<MutexType> Lock(m_CellMutex);
   m_MultiCells.erase(std::begin(m_MultiCells), std::end(m_MultiCells));
+  m_Journal.Clear();
   m_QuitSignal.disconnect_all_slots();
   m_DocumentUpdatedSignal.disconnect_all_slots();
   m_MemoryAreaUpdatedSignal.disconnect_all_slots();
@@ -69,11 +91,53 @@ void Document::Connect(u32 Type, Document::Subscriber* pSubscriber)
     pSubscriber->m_TaskUpdatedConnection = m_TaskUpdatedSignal.connect(boost::bind(&Subscriber::OnTaskUpdated, pSubscriber, _1, _2));
 }
 
+void Document::NotifyTaskUpdated(std::string const& rTaskName, u8 Status)
+{
+  m_TaskUpdatedSignal(rTaskName, Status);
+}
+
 MemoryArea const* Document::GetMemoryArea(Address const& rAddr) const
 {
   return m_spDatabase->GetMemoryArea(rAddr);
 }
 
+MemoryArea const* Document::MapMemoryArea(Address const& rAddr)
+{
+  auto pMemArea = GetMemoryArea(rAddr);
+  if (pMemArea != nullptr)
+    return pMemArea;
+
+  auto pBankedMemArea = GetBankedMemoryArea(rAddr);
+  if (pBankedMemArea == nullptr || !pBankedMemArea->IsInWindow(rAddr.GetOffset()))
+    return nullptr;
+
+  // Another task could reference the same bank at the same time
+  std::lock_guard<MutexType> Lock(m_BankMutex);
+  pMemArea = GetMemoryArea(rAddr);
+  if (pMemArea != nullptr)
+    return pMemArea;
+
+  auto pBankMemArea = pBankedMemArea->MakeBankMemoryArea(rAddr.GetBase());
+  if (pBankMemArea == nullptr)
+    return nullptr;
+  AddMemoryArea(pBankMemArea);
+  return pBankMemArea;
+}
+
+BankedMemoryArea const* Document::GetBankedMemoryArea(Address const& rAddr) const
+{
+  BankedMemoryArea const* pBankedMemArea = nullptr;
+  m_spDatabase->ForEachMemoryArea([&](MemoryArea const& rMemArea)
+  {
+    auto pCurMemArea = dynamic_cast<BankedMemoryArea const*>(&rMemArea);
+    if (pCurMemArea == nullptr || pCurMemArea->GetBaseAddress().GetAddressingType() != rAddr.GetAddressingType())
+      return;
+    if (pBankedMemArea == nullptr || pCurMemArea->IsInWindow(rAddr.GetOffset()))
+      pBankedMemArea = pCurMemArea;
+  });
+  return pBankedMemArea;
+}
+
 Label Document::GetLabelFromAddress(Address const& rAddr) const
 {
   Label CurLbl;
@@ -123,12 +187,12 @@ void Document::AddLabel(Address const& rAddr, Label const& rLabel, bool Force)
     if (!m_spDatabase->RemoveLabel(rAddr))
       return;
 
-    m_LabelUpdatedSignal(rAddr, OldLbl, true);
+    m_Journal.AddLabelUpdate(rAddr, OldLbl, true);
   }
 
   m_spDatabase->AddLabel(rAddr, NewLbl);
-  m_LabelUpdatedSignal(rAddr, NewLbl, false);
-  m_DocumentUpdatedSignal();
+  m_Journal.AddLabelUpdate(rAddr, NewLbl, false);
+  m_Journal.AddDocumentUpdate();
 }
 
 void Document::RemoveLabel(Address const& rAddr)
@@ -136,8 +200,8 @@ void Document::RemoveLabel(Address const& rAddr)
   Label CurLbl;
   m_spDatabase->GetLabel(rAddr, CurLbl);
   m_spDatabase->RemoveLabel(rAddr);
-  m_LabelUpdatedSignal(rAddr, CurLbl, true);
-  m_DocumentUpdatedSignal();
+  m_Journal.AddLabelUpdate(rAddr, CurLbl, true);
+  m_Journal.AddDocumentUpdate();
 }
 
 void Document::ForEachLabel(Database::LabelCallback Callback) const
@@ -145,14 +209,57 @@ void Document::ForEachLabel(Database::LabelCallback Callback) const
   m_spDatabase->ForEachLabel(Callback);
 }
 
+void Document::AddLabels(Database::LabelVector const& rLabels, bool Force)
+{
+  Database::LabelVector Labels, RemovedLabels, AddedLabels;
+  Labels.reserve(rLabels.size());
+  for (auto const& rLblPair : rLabels)
+    if (!rLblPair.second.GetName().empty())
+      Labels.push_back(rLblPair);
+
+  if (!m_spDatabase->AddLabels(Labels, Force, RemovedLabels, AddedLabels))
+    Log::Write("core") << "unable to add all labels" << LogEnd;
+  if (RemovedLabels.empty() && AddedLabels.empty())
+    return;
+
+  ChangeJournal::LabelChangeVector Changes;
+  Changes.reserve(RemovedLabels.size() + AddedLabels.size());
+  for (auto const& rLblPair : RemovedLabels)
+  {
+    ChangeJournal::LabelChange RmChg = { rLblPair.first, rLblPair.second, true };
+    Changes.push_back(RmChg);
+  }
+  for (auto const& rLblPair : AddedLabels)
+  {
+    ChangeJournal::LabelChange AddChg = { rLblPair.first, rLblPair.second, false };
+    Changes.push_back(AddChg);
+  }
+  m_Journal.AddLabelUpdate(Changes);
+  m_Journal.AddDocumentUpdate();
+}
+
 bool Document::AddCrossReference(Address const& rTo, Address const& rFrom)
 {
-  return m_spDatabase->AddCrossReference(rTo, rFrom);
+  if (!m_spDatabase->AddCrossReference(rTo, rFrom))
+    return false;
+
+  // The xref line of the destination has changed
+  m_Journal.AddAddressUpdate(rTo);
+  return true;
 }
 
 bool Document::RemoveCrossReference(Address const& rFrom)
 {
-  return m_spDatabase->RemoveCrossReference(rFrom);
+  Address To;
+  bool HasTo = m_spDatabase->GetCrossReferenceTo(rFrom, To);
+  if (!m_spDatabase->RemoveCrossReference(rFrom))
+    return false;
+
+  if (HasTo)
+  {
+    m_Journal.AddAddressUpdate(To);
+  }
+  return true;
 }
 
 bool Document::RemoveCrossReferences(void)
@@ -160,6 +267,20 @@ bool Document::RemoveCrossReferences(void)
   return m_spDatabase->RemoveCrossReferences();
 }
 
+bool Document::AddCrossReferences(Database::CrossReferenceVector const& rCrossRefs)
+{
+  if (rCrossRefs.empty())
+    return true;
+
+  bool Res = m_spDatabase->AddCrossReferences(rCrossRefs);
+
+  Address::List Addrs;
+  for (auto const& rXRef : rCrossRefs)
+    Addrs.push_back(rXRef.first);
+  m_Journal.AddAddressUpdate(Addrs);
+  return Res;
+}
+
 bool Document::HasCrossReferenceFrom(Address const& rTo) const
 {
   return m_spDatabase->HasCrossReferenceFrom(rTo);
@@ -219,13 +340,13 @@ bool Document::MakeString(Address const& rAddress, u8 StringType, u16 StringLeng
   TOffset FileOff;
   if (!ConvertAddressToFileOffset(rAddress, FileOff))
     return false;
-  u16 StrLen = GetBinaryStream().StringLength(FileOff);
+  u32 StrLen = GetBinaryStream().StringLength(FileOff);
   if (StrLen == 0)
     return false;
   if (StrLen > StringLength)
     return false;
   ++StrLen; // we want to include '\0'
-  auto spNewStr = std::make_shared<String>(StringType, std::min(StrLen, StringLength));
+  auto spNewStr = std::make_shared<String>(StringType, static_cast<u16>(std::min<u32>(StrLen, StringLength)));
   return SetCell(rAddress, spNewStr, Force);
 }
 
@@ -238,7 +359,8 @@ bool Document::SetComment(Address const& rAddress, std::string const& rComment)
 {
   if (m_spDatabase->SetComment(rAddress, rComment))
   {
-    m_DocumentUpdatedSignal();
+    m_Journal.AddDocumentUpdate();
+    m_Journal.AddAddressUpdate(rAddress);
     return true;
   }
   return false;
@@ -346,14 +468,14 @@ bool Document::SetCell(Address const& rAddr, Cell::SPType spCell, bool Force)
     if (GetCell(rErsdAddr) == nullptr)
     {
       if (HasCrossReferenceTo(rErsdAddr))
-        RemoveCrossReference(rErsdAddr);
+        RemoveCrossReferenceAndDerivedLabel(rErsdAddr);
 
       if (HasCrossReferenceFrom(rErsdAddr))
       {
         auto Label = GetLabelFromAddress(rErsdAddr);
         if (Label.GetType() != Label::Unknown)
         {
-          m_LabelUpdatedSignal(rErsdAddr, Label, true);
+          m_Journal.AddLabelUpdate(rErsdAddr, Label, true);
         }
       }
     }
@@ -362,8 +484,8 @@ bool Document::SetCell(Address const& rAddr, Cell::SPType spCell, bool Force)
   AddressList.push_back(rAddr);
   AddressList.merge(ErasedAddresses);
 
-  m_DocumentUpdatedSignal();
-  m_AddressUpdatedSignal(AddressList);
+  m_Journal.AddDocumentUpdate();
+  m_Journal.AddAddressUpdate(AddressList);
 
   return true;
 }
@@ -380,14 +502,14 @@ bool Document::SetCellWithLabel(Address const& rAddr, Cell::SPType spCell, Label
     if (GetCell(rErsdAddr) == nullptr)
     {
       if (HasCrossReferenceTo(rErsdAddr))
-        RemoveCrossReference(rErsdAddr);
+        RemoveCrossReferenceAndDerivedLabel(rErsdAddr);
 
       if (HasCrossReferenceFrom(rErsdAddr))
       {
         auto Label = GetLabelFromAddress(rErsdAddr);
         if (Label.GetType() != Label::Unknown)
         {
-          m_LabelUpdatedSignal(rErsdAddr, Label, true);
+          m_Journal.AddLabelUpdate(rErsdAddr, Label, true);
         }
       }
     }
@@ -408,13 +530,13 @@ bool Document::SetCellWithLabel(Address const& rAddr, Cell::SPType spCell, Label
     if (!m_spDatabase->RemoveLabel(rAddr))
       return false;
 
-    m_LabelUpdatedSignal(rAddr, OldLabel, true);
+    m_Journal.AddLabelUpdate(rAddr, OldLabel, true);
   }
   m_spDatabase->AddLabel(rAddr, rLabel);
 
-  m_LabelUpdatedSignal(rAddr, rLabel, false);
-  m_DocumentUpdatedSignal();
-  m_AddressUpdatedSignal(AddressList);
+  m_Journal.AddLabelUpdate(rAddr, rLabel, false);
+  m_Journal.AddDocumentUpdate();
+  m_Journal.AddAddressUpdate(AddressList);
 
   return true;
 }
@@ -424,10 +546,11 @@ bool Document::DeleteCell(Address const& rAddr)
   if (!m_spDatabase->DeleteCellData(rAddr))
     return false;
 
-  Address::List DelAddr;
-  DelAddr.push_back(rAddr);
-  m_AddressUpdatedSignal(DelAddr);
-  m_DocumentUpdatedSignal();
+  if (HasCrossReferenceTo(rAddr))
+    RemoveCrossReferenceAndDerivedLabel(rAddr);
+
+  m_Journal.AddAddressUpdate(rAddr);
+  m_Journal.AddDocumentUpdate();
   RemoveLabelIfNeeded(rAddr);
 
   return true;
@@ -465,10 +588,24 @@ bool Document::SetMultiCell(Address const& rAddr, MultiCell* pMultiCell, bool Fo
   m_MultiCells[rAddr] = pMultiCell;
   m_spDatabase->AddMultiCell(rAddr, *pMultiCell);
 
-  m_DocumentUpdatedSignal();
-  Address::List AddressList;
-  AddressList.push_back(rAddr);
-  m_AddressUpdatedSignal(AddressList);
+  m_Journal.AddDocumentUpdate();
+  m_Journal.AddAddressUpdate(rAddr);
+  return true;
+}
+
+bool Document::RemoveMultiCell(Address const& rAddr)
+{
+  {
+    std::lock_guard<MutexType> Lock(m_CellMutex);
+    auto itMultiCell = m_MultiCells.find(rAddr);
+    if (itMultiCell == std::end(m_MultiCells))
+      return false;
+    m_MultiCells.erase(itMultiCell);
+  }
+  m_spDatabase->RemoveMultiCell(rAddr);
+
+  m_Journal.AddDocumentUpdate();
+  m_Journal.AddAddressUpdate(rAddr);
   return true;
 }
 
@@ -517,6 +654,73 @@ bool Document::UnbindDetailId(Address const& rAddress, u8 Index)
   return m_spDatabase->UnbindDetailId(rAddress, Index);
 }
 
+bool Document::GetFunctionFingerprint(Address const& rFuncAddr, FunctionFingerprint& rFingerprint) const
+{
+  return m_spDatabase->GetFunctionFingerprint(rFuncAddr, rFingerprint);
+}
+
+bool Document::SetFunctionFingerprint(Address const& rFuncAddr, FunctionFingerprint const& rFingerprint)
+{
+  return m_spDatabase->SetFunctionFingerprint(rFuncAddr, rFingerprint);
+}
+
+bool Document::GetFunctionGraph(Address const& rFuncAddr, FunctionGraph& rFuncGraph) const
+{
+  return m_spDatabase->GetFunctionGraph(rFuncAddr, rFuncGraph);
+}
+
+bool Document::SetFunctionGraph(Address const& rFuncAddr, FunctionGraph const& rFuncGraph)
+{
+  if (!m_spDatabase->SetFunctionGraph(rFuncAddr, rFuncGraph))
+    return false;
+
+  std::lock_guard<MutexType> Lock(m_FunctionIndexMutex);
+  if (m_IsFunctionIndexBuilt)
+    _IndexFunctionGraph(rFuncAddr, rFuncGraph);
+  return true;
+}
+
+bool Document::GetFunctionLayout(Address const& rFuncAddr, GraphLayout& rFuncLayout) const
+{
+  return m_spDatabase->GetFunctionLayout(rFuncAddr, rFuncLayout);
+}
+
+bool Document::SetFunctionLayout(Address const& rFuncAddr, GraphLayout const& rFuncLayout)
+{
+  return m_spDatabase->SetFunctionLayout(rFuncAddr, rFuncLayout);
+}
+
+bool Document::GetFunctionsContaining(Address const& rAddr, Address::List& rFuncAddrs) const
+{
+  std::lock_guard<MutexType> Lock(m_FunctionIndexMutex);
+  if (!m_IsFunctionIndexBuilt)
+    _BuildFunctionIndex();
+
+  bool Found = false;
+
+  // Basic blocks are sorted by their first address, so we only have to look
+  // at basic blocks which start at most m_MaxBasicBlockLength bytes before rAddr
+  auto itBscBlk = m_BasicBlockOwners.upper_bound(rAddr);
+  while (itBscBlk != std::begin(m_BasicBlockOwners))
+  {
+    --itBscBlk;
+    Address const& rBscBlkAddr = itBscBlk->first;
+    if (rBscBlkAddr.GetBase() != rAddr.GetBase())
+      break;
+    if (rAddr.GetOffset() - rBscBlkAddr.GetOffset() >= m_MaxBasicBlockLength)
+      break;
+    if (rAddr.GetOffset() - rBscBlkAddr.GetOffset() >= itBscBlk->second.first)
+      continue;
+
+    auto const& rFuncAddr = itBscBlk->second.second;
+    if (std::find(std::begin(rFuncAddrs), std::end(rFuncAddrs), rFuncAddr) == std::end(rFuncAddrs))
+      rFuncAddrs.push_back(rFuncAddr);
+    Found = true;
+  }
+
+  return Found;
+}
+
 Address Document::MakeAddress(TBase Base, TOffset Offset) const
 {
   MemoryArea const* pMemArea = GetMemoryArea(Address(Base, Offset));
@@ -734,6 +938,84 @@ bool Document::GetNearestAddress(Address const& rAddress, Address& rNearestAddre
   return m_spDatabase->MoveAddress(rAddress, rNearestAddress, 0);
 }
 
+void Document::RemoveCrossReferenceAndDerivedLabel(Address const& rFrom)
+{
+  Address To;
+  bool HasTo = GetCrossReferenceTo(rFrom, To);
+  RemoveCrossReference(rFrom);
+  if (!HasTo || HasCrossReferenceFrom(To))
+    return;
+
+  // Labels generated by the analyzer are only meaningful while they're referenced
+  auto Lbl = GetLabelFromAddress(To);
+  if (Lbl.GetType() == Label::Unknown || !Lbl.IsAutoGenerated())
+    return;
+  if ((Lbl.GetType() & Label::CellMask) == Label::Function)
+    return;
+  u16 LblAccess = Lbl.GetType() & Label::AccessMask;
+  if (LblAccess == Label::Exported || LblAccess == Label::Imported)
+    return;
+  RemoveLabel(To);
+}
+
+void Document::_BuildFunctionIndex(void) const
+{
+  m_BasicBlockOwners.clear();
+  m_FunctionBasicBlocks.clear();
+  m_MaxBasicBlockLength = 0;
+
+  {
+    std::lock_guard<MutexType> Lock(m_CellMutex);
+    for (auto const& rMultiCell : m_MultiCells)
+    {
+      if (rMultiCell.second->GetType() != MultiCell::FunctionType)
+        continue;
+      FunctionGraph FuncGraph;
+      if (!m_spDatabase->GetFunctionGraph(rMultiCell.first, FuncGraph))
+        continue;
+      _IndexFunctionGraph(rMultiCell.first, FuncGraph);
+    }
+  }
+
+  m_IsFunctionIndexBuilt = true;
+}
+
+void Document::_IndexFunctionGraph(Address const& rFuncAddr, FunctionGraph const& rFuncGraph) const
+{
+  // Remove the previous basic blocks of this function
+  auto itFuncBscBlks = m_FunctionBasicBlocks.find(rFuncAddr);
+  if (itFuncBscBlks != std::end(m_FunctionBasicBlocks))
+  {
+    for (auto const& rBscBlkAddr : itFuncBscBlks->second)
+    {
+      auto Range = m_BasicBlockOwners.equal_range(rBscBlkAddr);
+      for (auto itOwner = Range.first; itOwner != Range.second;)
+      {
+        if (itOwner->second.second == rFuncAddr)
+          itOwner = m_BasicBlockOwners.erase(itOwner);
+        else
+          ++itOwner;
+      }
+    }
+    m_FunctionBasicBlocks.erase(itFuncBscBlks);
+  }
+
+  if (!rFuncGraph.IsValid())
+    return;
+
+  auto& rBscBlkAddrs = m_FunctionBasicBlocks[rFuncAddr];
+  for (auto const& rBscBlk : rFuncGraph.GetBasicBlocks())
+  {
+    u32 BscBlkLen = 0;
+    for (auto InsnLen : rBscBlk.m_InstructionLengths)
+      BscBlkLen += InsnLen;
+    m_BasicBlockOwners.insert(std::make_pair(rBscBlk.m_Address, std::make_pair(BscBlkLen, rFuncAddr)));
+    rBscBlkAddrs.push_back(rBscBlk.m_Address);
+    if (m_MaxBasicBlockLength < BscBlkLen)
+      m_MaxBasicBlockLength = BscBlkLen;
+  }
+}
+
 void Document::RemoveLabelIfNeeded(Address const& rAddr)
 {
   auto Lbl = GetLabelFromAddress(rAddr);
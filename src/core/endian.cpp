@@ -1,5 +1,10 @@
 #include "medusa/endian.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define MEDUSA_ENDIAN_SSE2
+#endif
+
 MEDUSA_NAMESPACE_BEGIN
 
 bool TestEndian(EEndianness Endianness)
@@ -13,4 +18,72 @@ bool TestEndian(EEndianness Endianness)
 #endif
 }
 
+#ifdef MEDUSA_ENDIAN_SSE2
+namespace
+{
+  // Swap bytes of each 16-bit lane
+  inline __m128i Swap16(__m128i Value)
+  {
+    return _mm_or_si128(_mm_slli_epi16(Value, 8), _mm_srli_epi16(Value, 8));
+  }
+
+  // Swap 16-bit lanes of each 32-bit lane, then their bytes
+  inline __m128i Swap32(__m128i Value)
+  {
+    Value = _mm_shufflelo_epi16(Value, _MM_SHUFFLE(2, 3, 0, 1));
+    Value = _mm_shufflehi_epi16(Value, _MM_SHUFFLE(2, 3, 0, 1));
+    return Swap16(Value);
+  }
+
+  // Swap 32-bit lanes of each 64-bit lane, then their bytes
+  inline __m128i Swap64(__m128i Value)
+  {
+    return Swap32(_mm_shuffle_epi32(Value, _MM_SHUFFLE(2, 3, 0, 1)));
+  }
+
+  template<typename T, __m128i (*SwapFunc)(__m128i)>
+  size_t SwapBlocks(T* pData, size_t Count)
+  {
+    size_t const ElemPerBlk = sizeof(__m128i) / sizeof(T);
+    size_t BlkCount = Count / ElemPerBlk;
+    for (size_t i = 0; i < BlkCount; ++i)
+    {
+      __m128i* pBlk = reinterpret_cast<__m128i*>(pData + i * ElemPerBlk);
+      _mm_storeu_si128(pBlk, SwapFunc(_mm_loadu_si128(pBlk)));
+    }
+    return BlkCount * ElemPerBlk;
+  }
+}
+#endif
+
+void EndianSwapArray(u16* pData, size_t Count)
+{
+  size_t i = 0;
+#ifdef MEDUSA_ENDIAN_SSE2
+  i = SwapBlocks<u16, Swap16>(pData, Count);
+#endif
+  for (; i < Count; ++i)
+    EndianSwap(pData[i]);
+}
+
+void EndianSwapArray(u32* pData, size_t Count)
+{
+  size_t i = 0;
+#ifdef MEDUSA_ENDIAN_SSE2
+  i = SwapBlocks<u32, Swap32>(pData, Count);
+#endif
+  for (; i < Count; ++i)
+    EndianSwap(pData[i]);
+}
+
+void EndianSwapArray(u64* pData, size_t Count)
+{
+  size_t i = 0;
+#ifdef MEDUSA_ENDIAN_SSE2
+  i = SwapBlocks<u64, Swap64>(pData, Count);
+#endif
+  for (; i < Count; ++i)
+    EndianSwap(pData[i]);
+}
+
 MEDUSA_NAMESPACE_END
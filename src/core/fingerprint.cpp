@@ -0,0 +1,236 @@
+#include "medusa/fingerprint.hpp"
+#include "medusa/document.hpp"
+#include "medusa/analyzer.hpp"
+#include "medusa/control_flow_graph.hpp"
+#include "medusa/instruction.hpp"
+#include "medusa/function.hpp"
+#include "medusa/function_graph.hpp"
+#include "medusa/util.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <cstring>
+
+MEDUSA_NAMESPACE_BEGIN
+
+namespace
+{
+  // FNV-1a is enough here, we only need a stable and cheap hash
+  // Values are hashed in little-endian, so fingerprints don't depend on the host
+  void HashValue(u64& rHash, u64 Value)
+  {
+    u8 Bytes[sizeof(Value)];
+    for (u8 i = 0; i < sizeof(Value); ++i)
+      Bytes[i] = static_cast<u8>(Value >> (i * 8));
+    rHash = Fnv1a(Bytes, sizeof(Bytes), rHash);
+  }
+
+  double CompareCounter(u32 Lhs, u32 Rhs)
+  {
+    u32 Max = std::max(Lhs, Rhs);
+    if (Max == 0)
+      return 1.0;
+    return 1.0 - static_cast<double>(std::max(Lhs, Rhs) - std::min(Lhs, Rhs)) / Max;
+  }
+}
+
+FunctionFingerprint::FunctionFingerprint(void)
+  : m_InsnHash()
+  , m_StructHash()
+  , m_ContentHash()
+  , m_NumberOfBasicBlocks()
+  , m_NumberOfEdges()
+  , m_NumberOfInstructions()
+  , m_NumberOfCallers()
+  , m_Callees()
+{
+  ::memset(m_Histogram, 0, sizeof(m_Histogram));
+}
+
+bool FunctionFingerprint::Compute(Document const& rDoc, Address const& rFuncAddr)
+{
+  *this = FunctionFingerprint();
+
+  FunctionGraph FuncGraph;
+  ControlFlowGraph Cfg(rDoc);
+  Analyzer Anlz;
+  if (!Anlz.GetFunctionGraph(rDoc, rFuncAddr, FuncGraph) || !Anlz.BuildControlFlowGraph(rDoc, FuncGraph, Cfg))
+    return false;
+  if (!FuncGraph.ComputeContentHash(rDoc, m_ContentHash))
+    return false;
+
+  auto const& rGraph = Cfg.GetGraph();
+  m_NumberOfBasicBlocks = static_cast<u32>(boost::num_vertices(rGraph));
+  m_NumberOfEdges       = static_cast<u32>(boost::num_edges(rGraph));
+
+  // The shape of the graph must not depend on the order of vertices, so we sort it
+  std::vector<u64>     BlockShapes;
+  std::vector<Address> InsnAddrs;
+  auto VertexRange = boost::vertices(rGraph);
+  for (auto itVertex = VertexRange.first; itVertex != VertexRange.second; ++itVertex)
+  {
+    auto const& rBscBlk = rGraph[*itVertex];
+    u64 Shape = (static_cast<u64>(rBscBlk.GetNumberOfInstruction()) << 32)
+      | (static_cast<u64>(boost::out_degree(*itVertex, rGraph)) << 16)
+      | static_cast<u64>(boost::in_degree(*itVertex, rGraph));
+    BlockShapes.push_back(Shape);
+    InsnAddrs.insert(std::end(InsnAddrs), std::begin(rBscBlk.GetAddresses()), std::end(rBscBlk.GetAddresses()));
+  }
+  std::sort(std::begin(BlockShapes), std::end(BlockShapes));
+  std::sort(std::begin(InsnAddrs), std::end(InsnAddrs));
+  InsnAddrs.erase(std::unique(std::begin(InsnAddrs), std::end(InsnAddrs)), std::end(InsnAddrs));
+
+  // Instructions are normalized: values (addresses, immediates, displacements) are ignored
+  // since they're likely to change between two versions of the same function
+  m_InsnHash = Fnv1a(nullptr, 0);
+  for (auto const& rInsnAddr : InsnAddrs)
+  {
+    auto spInsn = std::dynamic_pointer_cast<Instruction const>(rDoc.GetCell(rInsnAddr));
+    if (spInsn == nullptr)
+      continue;
+
+    ++m_NumberOfInstructions;
+    HashValue(m_InsnHash, spInsn->GetOpcode());
+    HashValue(m_InsnHash, spInsn->GetSubType());
+
+    bool HasMem = false, HasImm = false;
+    for (u8 CurOp = 0; CurOp < OPERAND_NO; ++CurOp)
+    {
+      auto const pOprd = spInsn->Operand(CurOp);
+      HashValue(m_InsnHash, pOprd->GetType());
+      if (pOprd->GetType() & O_REG)
+        HashValue(m_InsnHash, pOprd->GetReg());
+      if (pOprd->GetType() & O_MEM)
+        HashValue(m_InsnHash, pOprd->GetSecReg());
+      HasMem |= (pOprd->GetType() & O_MEM) ? true : false;
+      HasImm |= (pOprd->GetType() & O_IMM) ? true : false;
+    }
+
+    auto InsnType = spInsn->GetSubType();
+    if (InsnType & Instruction::CallType)
+    {
+      ++m_Histogram[CallClass];
+      Address CalleeAddr;
+      if (spInsn->GetOperandReference(rDoc, 0, rInsnAddr, CalleeAddr))
+        m_Callees.push_back(CalleeAddr);
+    }
+    else if (InsnType & Instruction::JumpType)
+      ++m_Histogram[(InsnType & Instruction::ConditionalType) ? ConditionalJumpClass : JumpClass];
+    else if (InsnType & Instruction::ReturnType)
+      ++m_Histogram[ReturnClass];
+    else if (HasMem)
+      ++m_Histogram[MemoryClass];
+    else if (HasImm)
+      ++m_Histogram[ImmediateClass];
+    else
+      ++m_Histogram[OtherClass];
+  }
+
+  if (m_NumberOfInstructions == 0)
+    return false;
+
+  m_StructHash = Fnv1a(nullptr, 0);
+  HashValue(m_StructHash, m_NumberOfBasicBlocks);
+  HashValue(m_StructHash, m_NumberOfEdges);
+  for (auto Shape : BlockShapes)
+    HashValue(m_StructHash, Shape);
+  for (u8 CurCls = 0; CurCls < InstructionClassCount; ++CurCls)
+    HashValue(m_StructHash, m_Histogram[CurCls]);
+
+  Address::List Callers;
+  if (rDoc.GetCrossReferenceFrom(rFuncAddr, Callers))
+    m_NumberOfCallers = static_cast<u32>(Callers.size());
+
+  return true;
+}
+
+bool FunctionFingerprint::IsUpToDate(Document const& rDoc, Address const& rFuncAddr) const
+{
+  if (!IsValid())
+    return false;
+
+  if (dynamic_cast<Function const*>(rDoc.GetMultiCell(rFuncAddr)) == nullptr)
+    return false;
+
+  // A patch may keep the size of the function, so its bytes are hashed again
+  FunctionGraph FuncGraph;
+  Analyzer Anlz;
+  u64 ContentHash;
+  if (!Anlz.GetFunctionGraph(rDoc, rFuncAddr, FuncGraph) || !FuncGraph.ComputeContentHash(rDoc, ContentHash))
+    return false;
+
+  return ContentHash == m_ContentHash;
+}
+
+double FunctionFingerprint::Similarity(FunctionFingerprint const& rFingerprint) const
+{
+  if (m_InsnHash == rFingerprint.m_InsnHash)
+    return 1.0;
+
+  double Score = 0.0;
+  Score += 2.0 * CompareCounter(m_NumberOfBasicBlocks,  rFingerprint.m_NumberOfBasicBlocks);
+  Score += 2.0 * CompareCounter(m_NumberOfEdges,        rFingerprint.m_NumberOfEdges);
+  Score += 1.0 * CompareCounter(m_NumberOfInstructions, rFingerprint.m_NumberOfInstructions);
+  Score += 1.0 * CompareCounter(static_cast<u32>(m_Callees.size()), static_cast<u32>(rFingerprint.m_Callees.size()));
+  Score += 0.5 * CompareCounter(m_NumberOfCallers,      rFingerprint.m_NumberOfCallers);
+
+  u32 HistDist = 0, HistTotal = 0;
+  for (u8 CurCls = 0; CurCls < InstructionClassCount; ++CurCls)
+  {
+    HistDist  += std::max(m_Histogram[CurCls], rFingerprint.m_Histogram[CurCls]) - std::min(m_Histogram[CurCls], rFingerprint.m_Histogram[CurCls]);
+    HistTotal += std::max(m_Histogram[CurCls], rFingerprint.m_Histogram[CurCls]);
+  }
+  Score += 2.5 * (HistTotal == 0 ? 1.0 : 1.0 - static_cast<double>(HistDist) / HistTotal);
+
+  // Same structure, but instructions differ
+  if (m_StructHash == rFingerprint.m_StructHash)
+    Score += 1.0;
+
+  return Score / 10.0;
+}
+
+std::string FunctionFingerprint::Dump(void) const
+{
+  std::ostringstream oss;
+  oss << std::hex << std::showbase;
+  oss << "fp(" << m_InsnHash << " " << m_StructHash << " " << m_ContentHash
+    << " " << m_NumberOfBasicBlocks << " " << m_NumberOfEdges
+    << " " << m_NumberOfInstructions << " " << m_NumberOfCallers;
+  for (u8 CurCls = 0; CurCls < InstructionClassCount; ++CurCls)
+    oss << " " << m_Histogram[CurCls];
+  oss << " " << m_Callees.size();
+  for (auto const& rCallee : m_Callees)
+    oss << " " << rCallee.Dump();
+  oss << ")";
+  return oss.str();
+}
+
+bool FunctionFingerprint::Parse(std::string const& rDump)
+{
+  *this = FunctionFingerprint();
+
+  if (rDump.compare(0, 3, "fp(") != 0)
+    return false;
+
+  std::istringstream iss(rDump.substr(3));
+  size_t CalleeNo;
+  iss >> std::hex >> m_InsnHash >> m_StructHash >> m_ContentHash
+    >> m_NumberOfBasicBlocks >> m_NumberOfEdges
+    >> m_NumberOfInstructions >> m_NumberOfCallers;
+  for (u8 CurCls = 0; CurCls < InstructionClassCount; ++CurCls)
+    iss >> m_Histogram[CurCls];
+  if (!(iss >> CalleeNo))
+    return false;
+
+  for (size_t i = 0; i < CalleeNo; ++i)
+  {
+    Address CurCallee;
+    if (!(iss >> CurCallee))
+      return false;
+    m_Callees.push_back(CurCallee);
+  }
+
+  return true;
+}
+
+MEDUSA_NAMESPACE_END
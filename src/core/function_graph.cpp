@@ -0,0 +1,341 @@
+#include "medusa/function_graph.hpp"
+#include "medusa/document.hpp"
+#include "medusa/basic_block.hpp"
+#include "medusa/instruction.hpp"
+#include "medusa/function.hpp"
+#include "medusa/label.hpp"
+#include "medusa/jump_table.hpp"
+#include "medusa/util.hpp"
+
+#include <map>
+#include <set>
+#include <stack>
+#include <tuple>
+#include <sstream>
+
+MEDUSA_NAMESPACE_BEGIN
+
+FunctionGraph::FunctionGraph(void)
+  : m_Flags()
+  , m_Length()
+  , m_NumberOfInstructions()
+  , m_ContentHash()
+  , m_BasicBlocks()
+  , m_Edges()
+{
+}
+
+bool FunctionGraph::Build(Document const& rDoc, Address const& rFuncAddr, u32 LengthThreshold)
+{
+  *this = FunctionGraph();
+
+  auto Lbl = rDoc.GetLabelFromAddress(rFuncAddr);
+  if ((Lbl.GetType() & Label::AccessMask) == Label::Imported)
+    return false;
+
+  if (rDoc.GetMemoryArea(rFuncAddr) == nullptr)
+    return false;
+
+  struct InstructionInformation
+  {
+    u16 m_Length;
+    u8  m_SubType;
+  };
+
+  typedef std::tuple<Address, Address, BasicBlockEdgeProperties::Type> TupleEdge;
+
+  std::map<Address, InstructionInformation> Insns;
+  std::set<Address>                         Leaders;
+  std::vector<TupleEdge>                    Edges;
+  std::stack<Address>                       CallStack;
+
+  Leaders.insert(rFuncAddr);
+  CallStack.push(rFuncAddr);
+
+  // First, we walk the control flow once and record each instruction with its type
+  while (!CallStack.empty())
+  {
+    Address CurAddr = CallStack.top();
+    CallStack.pop();
+
+    while (rDoc.ContainsCode(CurAddr))
+    {
+      // The following instructions are already known
+      if (Insns.find(CurAddr) != std::end(Insns))
+        break;
+
+      auto spInsn = std::dynamic_pointer_cast<Instruction const>(rDoc.GetCell(CurAddr));
+      if (spInsn == nullptr)
+        break;
+
+      u16 InsnLen  = static_cast<u16>(spInsn->GetLength());
+      u8  InsnType = spInsn->GetSubType();
+      InstructionInformation InsnInfo = { InsnLen, InsnType };
+      Insns[CurAddr] = InsnInfo;
+      m_Length += InsnLen;
+      ++m_NumberOfInstructions;
+
+      if (LengthThreshold && m_Length > LengthThreshold)
+        return false;
+
+      if (InsnType & Instruction::JumpType)
+      {
+        Address DstAddr;
+
+        if (InsnType & Instruction::ConditionalType)
+        {
+          Address NextAddr = CurAddr + InsnLen;
+          Leaders.insert(NextAddr);
+          Edges.push_back(TupleEdge(CurAddr, NextAddr, BasicBlockEdgeProperties::False));
+          CallStack.push(NextAddr);
+        }
+
+        // Destinations of a resolved jump table are all reachable from this jump
+        Address::List JmpTblDsts;
+        if (JumpTable::GetTargets(rDoc, CurAddr, *spInsn, JmpTblDsts))
+        {
+          for (auto const& rJmpTblDst : JmpTblDsts)
+          {
+            Leaders.insert(rJmpTblDst);
+            Edges.push_back(TupleEdge(CurAddr, rJmpTblDst, BasicBlockEdgeProperties::Unconditional));
+            CallStack.push(rJmpTblDst);
+          }
+          break;
+        }
+
+        if (spInsn->Operand(0)->GetType() & O_MEM)
+          break;
+
+        if (!spInsn->GetOperandReference(rDoc, 0, CurAddr, DstAddr))
+        {
+          m_Flags |= HasUnresolvedJumpFlag;
+          break;
+        }
+
+        Leaders.insert(DstAddr);
+        Edges.push_back(TupleEdge(CurAddr, DstAddr, (InsnType & Instruction::ConditionalType)
+          ? BasicBlockEdgeProperties::True
+          : BasicBlockEdgeProperties::Unconditional));
+        CurAddr = DstAddr;
+        continue;
+      }
+
+      else if (InsnType & Instruction::ReturnType && !(InsnType & Instruction::ConditionalType))
+      {
+        m_Flags |= HasReturnFlag;
+        break;
+      }
+
+      CurAddr += InsnLen;
+    } // end while (rDoc.ContainsCode(CurAddr))
+  } // while (!CallStack.empty())
+
+  if (Insns.empty())
+  {
+    *this = FunctionGraph();
+    return false;
+  }
+
+  // Then, instructions are split in basic blocks: a basic block starts on a branch destination
+  // or after a branch, and ends before a gap (e.g. the padding after a jump)
+  std::map<Address, u32> InsnToBlock;
+  std::vector<u8>        LastInsnTypes;
+  Address                PrevEndAddr;
+  bool                   IsEndOfBlock = true;
+  for (auto const& rInsn : Insns)
+  {
+    if (IsEndOfBlock || rInsn.first != PrevEndAddr || Leaders.find(rInsn.first) != std::end(Leaders))
+    {
+      BasicBlock NewBlk;
+      NewBlk.m_Address = rInsn.first;
+      m_BasicBlocks.push_back(NewBlk);
+      LastInsnTypes.push_back(0);
+    }
+
+    u32 CurBlkIdx = static_cast<u32>(m_BasicBlocks.size() - 1);
+    m_BasicBlocks.back().m_InstructionLengths.push_back(rInsn.second.m_Length);
+    LastInsnTypes.back() = rInsn.second.m_SubType;
+    InsnToBlock[rInsn.first] = CurBlkIdx;
+
+    u8 InsnType  = rInsn.second.m_SubType;
+    PrevEndAddr  = rInsn.first + rInsn.second.m_Length;
+    IsEndOfBlock = (InsnType & Instruction::JumpType)
+      || (InsnType & Instruction::ReturnType && !(InsnType & Instruction::ConditionalType));
+  }
+
+  std::set<std::pair<u32, u32>> KnownEdges;
+  auto AddEdge = [&](u32 SrcIdx, u32 DstIdx, BasicBlockEdgeProperties::Type Type)
+  {
+    if (!KnownEdges.insert(std::make_pair(SrcIdx, DstIdx)).second)
+      return;
+    Edge NewEdge = { SrcIdx, DstIdx, static_cast<u8>(Type) };
+    m_Edges.push_back(NewEdge);
+  };
+
+  for (auto const& rEdge : Edges)
+  {
+    auto itSrc = InsnToBlock.find(std::get<0>(rEdge));
+    auto itDst = InsnToBlock.find(std::get<1>(rEdge));
+    if (itSrc == std::end(InsnToBlock) || itDst == std::end(InsnToBlock))
+      continue;
+    AddEdge(itSrc->second, itDst->second, std::get<2>(rEdge));
+  }
+
+  // Finally, basic blocks which fall through the next one are connected
+  for (u32 CurBlkIdx = 0; CurBlkIdx + 1 < m_BasicBlocks.size(); ++CurBlkIdx)
+  {
+    u8 InsnType = LastInsnTypes[CurBlkIdx];
+    if (InsnType & Instruction::JumpType && !(InsnType & Instruction::ConditionalType))
+      continue;
+    if (InsnType & Instruction::ReturnType && !(InsnType & Instruction::ConditionalType))
+      continue;
+
+    auto const& rCurBlk = m_BasicBlocks[CurBlkIdx];
+    Address EndAddr = rCurBlk.m_Address;
+    for (auto InsnLen : rCurBlk.m_InstructionLengths)
+      EndAddr += InsnLen;
+    if (EndAddr != m_BasicBlocks[CurBlkIdx + 1].m_Address)
+      continue;
+
+    AddEdge(CurBlkIdx, CurBlkIdx + 1, BasicBlockEdgeProperties::Next);
+  }
+
+  // Bytes are hashed once the graph is built, so the graph can tell later if the function was patched
+  if (!ComputeContentHash(rDoc, m_ContentHash))
+    m_ContentHash = 0;
+
+  return true;
+}
+
+bool FunctionGraph::IsUpToDate(Document const& rDoc, Address const& rFuncAddr) const
+{
+  if (!IsValid())
+    return false;
+
+  auto const pFunc = dynamic_cast<Function const*>(rDoc.GetMultiCell(rFuncAddr));
+  if (pFunc == nullptr)
+    return false;
+
+  if (pFunc->GetSize() != static_cast<u16>(m_Length))
+    return false;
+
+  if (!rDoc.ContainsCode(rFuncAddr))
+    return false;
+
+  // A patch may keep the size of the function, so its bytes are hashed again
+  u64 ContentHash;
+  if (!ComputeContentHash(rDoc, ContentHash))
+    return false;
+  return ContentHash == m_ContentHash;
+}
+
+bool FunctionGraph::ComputeContentHash(Document const& rDoc, u64& rContentHash) const
+{
+  auto const& rBinStrm = rDoc.GetBinaryStream();
+  std::vector<u8> Buffer;
+
+  rContentHash = Fnv1a(nullptr, 0);
+  for (auto const& rBscBlk : m_BasicBlocks)
+  {
+    u32 BscBlkLen = 0;
+    for (auto InsnLen : rBscBlk.m_InstructionLengths)
+      BscBlkLen += InsnLen;
+
+    // Instructions of a basic block are contiguous
+    TOffset FileOff;
+    if (!rDoc.ConvertAddressToFileOffset(rBscBlk.m_Address, FileOff))
+      return false;
+    Buffer.resize(BscBlkLen);
+    if (!rBinStrm.Read(FileOff, Buffer.data(), Buffer.size()))
+      return false;
+    rContentHash = Fnv1a(Buffer.data(), Buffer.size(), rContentHash);
+  }
+
+  return true;
+}
+
+Address::List FunctionGraph::GetBasicBlockAddresses(u32 BasicBlockIndex) const
+{
+  Address::List Addrs;
+  if (BasicBlockIndex >= m_BasicBlocks.size())
+    return Addrs;
+
+  auto const& rBscBlk = m_BasicBlocks[BasicBlockIndex];
+  Address CurAddr = rBscBlk.m_Address;
+  for (auto InsnLen : rBscBlk.m_InstructionLengths)
+  {
+    Addrs.push_back(CurAddr);
+    CurAddr += InsnLen;
+  }
+  return Addrs;
+}
+
+std::string FunctionGraph::Dump(void) const
+{
+  std::ostringstream oss;
+  oss << std::hex << std::showbase;
+  oss << "fg(" << m_Flags << " " << m_Length << " " << m_NumberOfInstructions << " " << m_ContentHash;
+
+  oss << " " << m_BasicBlocks.size();
+  for (auto const& rBscBlk : m_BasicBlocks)
+  {
+    oss << " " << rBscBlk.m_Address.Dump() << " " << rBscBlk.m_InstructionLengths.size();
+    for (auto InsnLen : rBscBlk.m_InstructionLengths)
+      oss << " " << InsnLen;
+  }
+
+  oss << " " << m_Edges.size();
+  for (auto const& rEdge : m_Edges)
+    oss << " " << rEdge.m_Source << " " << rEdge.m_Destination << " " << static_cast<u32>(rEdge.m_Type);
+
+  oss << ")";
+  return oss.str();
+}
+
+bool FunctionGraph::Parse(std::string const& rDump)
+{
+  *this = FunctionGraph();
+
+  if (rDump.compare(0, 3, "fg(") != 0)
+    return false;
+
+  std::istringstream iss(rDump.substr(3));
+  size_t BscBlkNo, EdgeNo;
+  iss >> std::hex >> m_Flags >> m_Length >> m_NumberOfInstructions >> m_ContentHash;
+  if (!(iss >> BscBlkNo))
+    return false;
+
+  for (size_t i = 0; i < BscBlkNo; ++i)
+  {
+    BasicBlock CurBscBlk;
+    size_t InsnNo;
+    if (!(iss >> CurBscBlk.m_Address >> InsnNo))
+      return false;
+    for (size_t j = 0; j < InsnNo; ++j)
+    {
+      u16 InsnLen;
+      if (!(iss >> InsnLen))
+        return false;
+      CurBscBlk.m_InstructionLengths.push_back(InsnLen);
+    }
+    m_BasicBlocks.push_back(CurBscBlk);
+  }
+
+  if (!(iss >> EdgeNo))
+    return false;
+
+  for (size_t i = 0; i < EdgeNo; ++i)
+  {
+    u32 Src, Dst, Type;
+    if (!(iss >> Src >> Dst >> Type))
+      return false;
+    if (Src >= m_BasicBlocks.size() || Dst >= m_BasicBlocks.size())
+      return false;
+    Edge CurEdge = { Src, Dst, static_cast<u8>(Type) };
+    m_Edges.push_back(CurEdge);
+  }
+
+  return true;
+}
+
+MEDUSA_NAMESPACE_END
@@ -0,0 +1,612 @@
+#include "medusa/graph_layout.hpp"
+#include "medusa/task.hpp"
+#include "medusa/util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <sstream>
+
+MEDUSA_NAMESPACE_USE;
+
+namespace
+{
+  u32 const InvalidIndex = std::numeric_limits<u32>::max();
+
+  bool IsCancelled(CancellationToken const* pToken)
+  {
+    return pToken != nullptr && pToken->IsCancelled();
+  }
+}
+
+GraphLayout::GraphLayout(void)
+  : m_Nodes()
+  , m_Edges()
+  , m_Width()
+  , m_Height()
+  , m_IsComputed(false)
+{
+}
+
+u32 GraphLayout::AddNode(u32 Width, u32 Height)
+{
+  Node NewNode = { Width, Height, Point() };
+  m_Nodes.push_back(NewNode);
+  m_IsComputed = false;
+  return static_cast<u32>(m_Nodes.size() - 1);
+}
+
+bool GraphLayout::AddEdge(u32 Source, u32 Destination)
+{
+  if (Source >= m_Nodes.size() || Destination >= m_Nodes.size())
+    return false;
+
+  Edge NewEdge = { Source, Destination, PointList() };
+  m_Edges.push_back(NewEdge);
+  m_IsComputed = false;
+  return true;
+}
+
+u64 GraphLayout::GetSignature(void) const
+{
+  // Values are hashed in little-endian, so signatures of stored layouts don't depend on the host
+  u64 Hash = Fnv1a(nullptr, 0);
+  auto Mix = [&Hash](u32 Value)
+  {
+    u8 Bytes[sizeof(Value)];
+    for (u8 i = 0; i < sizeof(Value); ++i)
+      Bytes[i] = static_cast<u8>(Value >> (i * 8));
+    Hash = Fnv1a(Bytes, sizeof(Bytes), Hash);
+  };
+
+  Mix(GetNumberOfNodes());
+  for (auto const& rNode : m_Nodes)
+  {
+    Mix(rNode.m_Width);
+    Mix(rNode.m_Height);
+  }
+  Mix(GetNumberOfEdges());
+  for (auto const& rEdge : m_Edges)
+  {
+    Mix(rEdge.m_Source);
+    Mix(rEdge.m_Destination);
+  }
+  return Hash;
+}
+
+bool GraphLayout::Compute(CancellationToken const* pToken)
+{
+  m_IsComputed = false;
+  m_Width      = 0;
+  m_Height     = 0;
+  for (auto& rEdge : m_Edges)
+    rEdge.m_Bends.clear();
+
+  u32 NodeNo = GetNumberOfNodes();
+  if (NodeNo == 0)
+  {
+    m_IsComputed = true;
+    return true;
+  }
+
+  std::vector<std::vector<u32>> Succs(NodeNo), Preds(NodeNo);
+  for (auto const& rEdge : m_Edges)
+  {
+    if (rEdge.m_Source == rEdge.m_Destination)
+      continue;
+    Succs[rEdge.m_Source].push_back(rEdge.m_Destination);
+    Preds[rEdge.m_Destination].push_back(rEdge.m_Source);
+  }
+
+  // First, linear chains are collapsed: a node follows its predecessor when they're only connected
+  // to each other. The first node is the entry of the graph, it always starts a chain.
+  auto IsFollower = [&](u32 Node)
+  {
+    return Node != 0 && Preds[Node].size() == 1 && Succs[Preds[Node][0]].size() == 1;
+  };
+
+  std::vector<std::vector<u32>> Chains;
+  std::vector<u32>              NodeChains(NodeNo, InvalidIndex);
+  std::vector<u32>              NodeRanks(NodeNo, 0); //! position of the node in its chain
+  auto AddChain = [&](u32 Head)
+  {
+    u32 ChainIdx = static_cast<u32>(Chains.size());
+    Chains.push_back(std::vector<u32>());
+    auto& rChain = Chains.back();
+    for (u32 CurNode = Head;;)
+    {
+      NodeChains[CurNode] = ChainIdx;
+      NodeRanks[CurNode]  = static_cast<u32>(rChain.size());
+      rChain.push_back(CurNode);
+      if (Succs[CurNode].size() != 1)
+        break;
+      u32 NextNode = Succs[CurNode][0];
+      if (!IsFollower(NextNode) || NodeChains[NextNode] != InvalidIndex)
+        break;
+      CurNode = NextNode;
+    }
+  };
+
+  for (u32 Node = 0; Node < NodeNo; ++Node)
+    if (!IsFollower(Node))
+      AddChain(Node);
+  // Cycles which are only made of followers don't have a head
+  for (u32 Node = 0; Node < NodeNo; ++Node)
+    if (NodeChains[Node] == InvalidIndex)
+      AddChain(Node);
+
+  u32 ChainNo = static_cast<u32>(Chains.size());
+  std::vector<Box>              ChainBoxes(ChainNo);
+  std::vector<std::vector<u32>> ChainSuccs(ChainNo);
+  std::vector<bool>             ChainLoops(ChainNo, false);
+  for (u32 ChainIdx = 0; ChainIdx < ChainNo; ++ChainIdx)
+  {
+    auto const& rChain = Chains[ChainIdx];
+    Box ChainBox = { 0, static_cast<u32>(rChain.size() - 1) * LayerDistance };
+    for (auto Node : rChain)
+    {
+      ChainBox.m_Width   = std::max(ChainBox.m_Width, m_Nodes[Node].m_Width);
+      ChainBox.m_Height += m_Nodes[Node].m_Height;
+    }
+    ChainBoxes[ChainIdx] = ChainBox;
+  }
+
+  for (auto const& rEdge : m_Edges)
+  {
+    if (rEdge.m_Source == rEdge.m_Destination)
+      continue;
+    u32 SrcChain = NodeChains[rEdge.m_Source];
+    u32 DstChain = NodeChains[rEdge.m_Destination];
+    if (SrcChain == DstChain)
+    {
+      if (NodeRanks[rEdge.m_Destination] <= NodeRanks[rEdge.m_Source])
+        ChainLoops[SrcChain] = true;
+      continue;
+    }
+    ChainSuccs[SrcChain].push_back(DstChain);
+  }
+
+  if (IsCancelled(pToken))
+    return false;
+
+  // Then, chains are grouped in strongly connected components (Tarjan)
+  std::vector<std::vector<u32>>   Sccs;
+  std::vector<u32>                ChainSccs(ChainNo, InvalidIndex);
+  std::vector<u32>                Indexes(ChainNo, InvalidIndex), LowLinks(ChainNo, 0);
+  std::vector<u32>                SccStack;
+  std::vector<bool>               OnStack(ChainNo, false);
+  std::vector<std::pair<u32, u32>> CallStack; //! chain and index of its next successor
+  u32 CurIndex = 0;
+
+  for (u32 Root = 0; Root < ChainNo; ++Root)
+  {
+    if (Indexes[Root] != InvalidIndex)
+      continue;
+
+    Indexes[Root] = LowLinks[Root] = CurIndex++;
+    SccStack.push_back(Root);
+    OnStack[Root] = true;
+    CallStack.push_back(std::make_pair(Root, 0));
+
+    while (!CallStack.empty())
+    {
+      u32 CurChain = CallStack.back().first;
+      u32 SuccIdx  = CallStack.back().second;
+      if (SuccIdx < ChainSuccs[CurChain].size())
+      {
+        ++CallStack.back().second;
+        u32 Succ = ChainSuccs[CurChain][SuccIdx];
+        if (Indexes[Succ] == InvalidIndex)
+        {
+          Indexes[Succ] = LowLinks[Succ] = CurIndex++;
+          SccStack.push_back(Succ);
+          OnStack[Succ] = true;
+          CallStack.push_back(std::make_pair(Succ, 0));
+        }
+        else if (OnStack[Succ])
+          LowLinks[CurChain] = std::min(LowLinks[CurChain], Indexes[Succ]);
+        continue;
+      }
+
+      if (LowLinks[CurChain] == Indexes[CurChain])
+      {
+        u32 SccIdx = static_cast<u32>(Sccs.size());
+        Sccs.push_back(std::vector<u32>());
+        u32 Member;
+        do
+        {
+          Member = SccStack.back();
+          SccStack.pop_back();
+          OnStack[Member]   = false;
+          ChainSccs[Member] = SccIdx;
+          Sccs.back().push_back(Member);
+        } while (Member != CurChain);
+        std::sort(std::begin(Sccs.back()), std::end(Sccs.back()));
+      }
+
+      CallStack.pop_back();
+      if (!CallStack.empty())
+      {
+        u32 Parent = CallStack.back().first;
+        LowLinks[Parent] = std::min(LowLinks[Parent], LowLinks[CurChain]);
+      }
+    }
+  }
+
+  u32 SccNo = static_cast<u32>(Sccs.size());
+  std::vector<u32> ChainLocals(ChainNo); //! index of the chain in its component
+  for (auto const& rScc : Sccs)
+    for (u32 LocalIdx = 0; LocalIdx < rScc.size(); ++LocalIdx)
+      ChainLocals[rScc[LocalIdx]] = LocalIdx;
+
+  // Components don't depend on each other, so they're laid out in parallel.
+  // The member with the lowest index is the entry, it's usually the header of a loop.
+  std::vector<Box>   SccBoxes(SccNo);
+  std::vector<Point> ChainCenters(ChainNo); //! relative to the top left corner of the component
+  std::atomic<bool>  IsSccCancelled(false);
+  ParallelFor(SccNo, [&](size_t Begin, size_t End)
+  {
+    for (size_t SccIdx = Begin; SccIdx < End && !IsSccCancelled; ++SccIdx)
+    {
+      auto const& rMembers = Sccs[SccIdx];
+      std::vector<Box> Boxes;
+      EdgeListType     Edges;
+      for (u32 LocalIdx = 0; LocalIdx < rMembers.size(); ++LocalIdx)
+      {
+        Boxes.push_back(ChainBoxes[rMembers[LocalIdx]]);
+        for (auto Succ : ChainSuccs[rMembers[LocalIdx]])
+          if (ChainSccs[Succ] == SccIdx)
+            Edges.push_back(std::make_pair(LocalIdx, ChainLocals[Succ]));
+      }
+
+      std::vector<Point> Centers;
+      u32 Width, Height;
+      if (!_LayoutLayers(Boxes, Edges, 0, Centers, Width, Height, pToken))
+      {
+        IsSccCancelled = true;
+        return;
+      }
+
+      // Back edges are routed on the left of their component
+      u32 Margin = (rMembers.size() > 1 || ChainLoops[rMembers.front()]) ? NodeDistance : 0;
+      for (u32 LocalIdx = 0; LocalIdx < rMembers.size(); ++LocalIdx)
+      {
+        Point Center = { Centers[LocalIdx].m_X + static_cast<s32>(Margin), Centers[LocalIdx].m_Y };
+        ChainCenters[rMembers[LocalIdx]] = Center;
+      }
+      Box SccBox = { Width + Margin, Height };
+      SccBoxes[SccIdx] = SccBox;
+    }
+  });
+
+  if (IsSccCancelled || IsCancelled(pToken))
+    return false;
+
+  // Components form an acyclic graph which is laid out the same way
+  EdgeListType SccEdges;
+  for (u32 ChainIdx = 0; ChainIdx < ChainNo; ++ChainIdx)
+    for (auto Succ : ChainSuccs[ChainIdx])
+      if (ChainSccs[ChainIdx] != ChainSccs[Succ])
+        SccEdges.push_back(std::make_pair(ChainSccs[ChainIdx], ChainSccs[Succ]));
+  std::sort(std::begin(SccEdges), std::end(SccEdges));
+  SccEdges.erase(std::unique(std::begin(SccEdges), std::end(SccEdges)), std::end(SccEdges));
+
+  std::vector<Point> SccCenters;
+  u32 Width, Height;
+  if (!_LayoutLayers(SccBoxes, SccEdges, ChainSccs[0], SccCenters, Width, Height, pToken))
+    return false;
+
+  // Finally, chains are expanded, their nodes are stacked from the top of the chain
+  std::vector<s32> SccLefts(SccNo);
+  for (u32 SccIdx = 0; SccIdx < SccNo; ++SccIdx)
+  {
+    SccLefts[SccIdx] = SccCenters[SccIdx].m_X - static_cast<s32>(SccBoxes[SccIdx].m_Width / 2);
+    s32 SccTop       = SccCenters[SccIdx].m_Y - static_cast<s32>(SccBoxes[SccIdx].m_Height / 2);
+
+    for (auto ChainIdx : Sccs[SccIdx])
+    {
+      s32 CenterX = SccLefts[SccIdx] + ChainCenters[ChainIdx].m_X;
+      s32 CurTop  = SccTop + ChainCenters[ChainIdx].m_Y - static_cast<s32>(ChainBoxes[ChainIdx].m_Height / 2);
+      for (auto Node : Chains[ChainIdx])
+      {
+        auto& rNode = m_Nodes[Node];
+        Point Position = { CenterX, CurTop + static_cast<s32>(rNode.m_Height / 2) };
+        rNode.m_Position = Position;
+        CurTop += static_cast<s32>(rNode.m_Height) + LayerDistance;
+      }
+    }
+  }
+
+  for (auto& rEdge : m_Edges)
+  {
+    if (rEdge.m_Source == rEdge.m_Destination)
+      continue;
+
+    // A follower is right below its predecessor
+    if (NodeChains[rEdge.m_Source] == NodeChains[rEdge.m_Destination]
+      && NodeRanks[rEdge.m_Destination] == NodeRanks[rEdge.m_Source] + 1)
+      continue;
+
+    auto const& rSrc = m_Nodes[rEdge.m_Source];
+    auto const& rDst = m_Nodes[rEdge.m_Destination];
+    s32 SrcTop    = rSrc.m_Position.m_Y - static_cast<s32>(rSrc.m_Height / 2);
+    s32 SrcBottom = SrcTop + static_cast<s32>(rSrc.m_Height);
+    s32 DstTop    = rDst.m_Position.m_Y - static_cast<s32>(rDst.m_Height / 2);
+    s32 DstBottom = DstTop + static_cast<s32>(rDst.m_Height);
+
+    if (DstTop > SrcBottom)
+    {
+      if (rSrc.m_Position.m_X == rDst.m_Position.m_X)
+        continue;
+      s32 BendY = DstTop - LayerDistance / 2;
+      Point Bends[] = { { rSrc.m_Position.m_X, BendY }, { rDst.m_Position.m_X, BendY } };
+      rEdge.m_Bends.assign(std::begin(Bends), std::end(Bends));
+    }
+
+    // EdgeItem draws a back edge from the left of its destination to the top of its source
+    else
+    {
+      s32 LeftX = SccLefts[ChainSccs[NodeChains[rEdge.m_Source]]] + NodeDistance / 2;
+      s32 SrcY  = SrcTop    - LayerDistance / 4;
+      s32 DstY  = DstBottom + LayerDistance / 4;
+      Point Bends[] = { { rSrc.m_Position.m_X, SrcY }, { LeftX, SrcY }, { LeftX, DstY } };
+      rEdge.m_Bends.assign(std::begin(Bends), std::end(Bends));
+    }
+  }
+
+  m_Width      = Width;
+  m_Height     = Height;
+  m_IsComputed = true;
+  return true;
+}
+
+void GraphLayout::SetNodePosition(u32 NodeIndex, Point const& rPosition)
+{
+  if (NodeIndex >= m_Nodes.size())
+    return;
+  m_Nodes[NodeIndex].m_Position = rPosition;
+}
+
+void GraphLayout::SetEdgeBends(u32 EdgeIndex, PointList const& rBends)
+{
+  if (EdgeIndex >= m_Edges.size())
+    return;
+  m_Edges[EdgeIndex].m_Bends = rBends;
+}
+
+void GraphLayout::SetSize(u32 Width, u32 Height)
+{
+  m_Width      = Width;
+  m_Height     = Height;
+  m_IsComputed = true;
+}
+
+std::string GraphLayout::Dump(void) const
+{
+  std::ostringstream oss;
+  oss << std::hex << std::showbase;
+  oss << "gl(" << m_Width << " " << m_Height;
+
+  // Coordinates can be negative, they're stored as unsigned values
+  oss << " " << m_Nodes.size();
+  for (auto const& rNode : m_Nodes)
+    oss << " " << rNode.m_Width << " " << rNode.m_Height
+        << " " << static_cast<u32>(rNode.m_Position.m_X) << " " << static_cast<u32>(rNode.m_Position.m_Y);
+
+  oss << " " << m_Edges.size();
+  for (auto const& rEdge : m_Edges)
+  {
+    oss << " " << rEdge.m_Source << " " << rEdge.m_Destination << " " << rEdge.m_Bends.size();
+    for (auto const& rBend : rEdge.m_Bends)
+      oss << " " << static_cast<u32>(rBend.m_X) << " " << static_cast<u32>(rBend.m_Y);
+  }
+
+  oss << ")";
+  return oss.str();
+}
+
+bool GraphLayout::Parse(std::string const& rDump)
+{
+  *this = GraphLayout();
+
+  if (rDump.compare(0, 3, "gl(") != 0)
+    return false;
+
+  std::istringstream iss(rDump.substr(3));
+  size_t NodeNo, EdgeNo;
+  u32 Width, Height;
+  iss >> std::hex;
+  if (!(iss >> Width >> Height >> NodeNo))
+    return false;
+
+  for (size_t i = 0; i < NodeNo; ++i)
+  {
+    u32 NodeWidth, NodeHeight, X, Y;
+    if (!(iss >> NodeWidth >> NodeHeight >> X >> Y))
+      return false;
+    Point Position = { static_cast<s32>(X), static_cast<s32>(Y) };
+    SetNodePosition(AddNode(NodeWidth, NodeHeight), Position);
+  }
+
+  if (!(iss >> EdgeNo))
+    return false;
+
+  for (size_t i = 0; i < EdgeNo; ++i)
+  {
+    u32 Src, Dst;
+    size_t BendNo;
+    if (!(iss >> Src >> Dst >> BendNo))
+      return false;
+    if (!AddEdge(Src, Dst))
+      return false;
+
+    PointList Bends;
+    for (size_t j = 0; j < BendNo; ++j)
+    {
+      u32 X, Y;
+      if (!(iss >> X >> Y))
+        return false;
+      Point Bend = { static_cast<s32>(X), static_cast<s32>(Y) };
+      Bends.push_back(Bend);
+    }
+    SetEdgeBends(GetNumberOfEdges() - 1, Bends);
+  }
+
+  SetSize(Width, Height);
+  return true;
+}
+
+bool GraphLayout::_LayoutLayers(
+  std::vector<Box> const& rBoxes, EdgeListType const& rEdges, u32 Entry,
+  std::vector<Point>& rCenters, u32& rWidth, u32& rHeight,
+  CancellationToken const* pToken)
+{
+  u32 BoxNo = static_cast<u32>(rBoxes.size());
+  rCenters.assign(BoxNo, Point());
+  rWidth  = 0;
+  rHeight = 0;
+  if (BoxNo == 0)
+    return true;
+
+  std::vector<std::vector<u32>> Succs(BoxNo);
+  for (auto const& rEdge : rEdges)
+    if (rEdge.first != rEdge.second)
+      Succs[rEdge.first].push_back(rEdge.second);
+
+  // Edges which go back to a box being visited close a cycle, they're ignored for layering
+  enum { Unvisited, Visiting, Visited };
+  std::vector<u8>                  States(BoxNo, Unvisited);
+  std::vector<std::vector<u32>>    FwdSuccs(BoxNo), FwdPreds(BoxNo);
+  std::vector<std::pair<u32, u32>> CallStack;
+  for (u32 i = 0; i <= BoxNo; ++i)
+  {
+    u32 Root = (i == 0) ? Entry : i - 1;
+    if (States[Root] != Unvisited)
+      continue;
+
+    States[Root] = Visiting;
+    CallStack.push_back(std::make_pair(Root, 0));
+    while (!CallStack.empty())
+    {
+      u32 CurBox  = CallStack.back().first;
+      u32 SuccIdx = CallStack.back().second;
+      if (SuccIdx == Succs[CurBox].size())
+      {
+        States[CurBox] = Visited;
+        CallStack.pop_back();
+        continue;
+      }
+
+      ++CallStack.back().second;
+      u32 Succ = Succs[CurBox][SuccIdx];
+      if (States[Succ] == Visiting)
+        continue;
+      FwdSuccs[CurBox].push_back(Succ);
+      FwdPreds[Succ].push_back(CurBox);
+      if (States[Succ] == Unvisited)
+      {
+        States[Succ] = Visiting;
+        CallStack.push_back(std::make_pair(Succ, 0));
+      }
+    }
+  }
+
+  if (IsCancelled(pToken))
+    return false;
+
+  // Each box is placed one layer below its lowest predecessor, boxes are visited in topological order
+  std::vector<u32> Layers(BoxNo, 0), InDegrees(BoxNo), Order;
+  Order.reserve(BoxNo);
+  for (u32 CurBox = 0; CurBox < BoxNo; ++CurBox)
+  {
+    InDegrees[CurBox] = static_cast<u32>(FwdPreds[CurBox].size());
+    if (InDegrees[CurBox] == 0)
+      Order.push_back(CurBox);
+  }
+  u32 LayerNo = 1;
+  for (size_t i = 0; i < Order.size(); ++i)
+  {
+    u32 CurBox = Order[i];
+    for (auto Succ : FwdSuccs[CurBox])
+    {
+      Layers[Succ] = std::max(Layers[Succ], Layers[CurBox] + 1);
+      LayerNo      = std::max(LayerNo, Layers[Succ] + 1);
+      if (--InDegrees[Succ] == 0)
+        Order.push_back(Succ);
+    }
+  }
+
+  std::vector<std::vector<u32>> LayerBoxes(LayerNo);
+  std::vector<double>           Positions(BoxNo), Keys(BoxNo);
+  for (auto CurBox : Order)
+  {
+    Positions[CurBox] = static_cast<double>(LayerBoxes[Layers[CurBox]].size());
+    LayerBoxes[Layers[CurBox]].push_back(CurBox);
+  }
+
+  // Crossings are reduced by sorting boxes on the barycenter of their neighbors
+  auto SortLayer = [&](std::vector<u32>& rLayer, std::vector<std::vector<u32>> const& rNeighbors)
+  {
+    for (auto CurBox : rLayer)
+    {
+      auto const& rNbrs = rNeighbors[CurBox];
+      if (rNbrs.empty())
+      {
+        Keys[CurBox] = Positions[CurBox];
+        continue;
+      }
+      double Sum = 0.0;
+      for (auto Nbr : rNbrs)
+        Sum += Positions[Nbr];
+      Keys[CurBox] = Sum / rNbrs.size();
+    }
+    std::stable_sort(std::begin(rLayer), std::end(rLayer), [&Keys](u32 Lhs, u32 Rhs) { return Keys[Lhs] < Keys[Rhs]; });
+    for (u32 Pos = 0; Pos < rLayer.size(); ++Pos)
+      Positions[rLayer[Pos]] = static_cast<double>(Pos);
+  };
+
+  for (u32 Sweep = 0; Sweep < SweepNo; ++Sweep)
+  {
+    if (IsCancelled(pToken))
+      return false;
+    for (u32 Layer = 1; Layer < LayerNo; ++Layer)
+      SortLayer(LayerBoxes[Layer], FwdPreds);
+    for (u32 Layer = LayerNo - 1; Layer-- > 0;)
+      SortLayer(LayerBoxes[Layer], FwdSuccs);
+  }
+
+  // Layers are centered horizontally, boxes of a layer are aligned on their top
+  std::vector<u32> LayerWidths(LayerNo, 0), LayerHeights(LayerNo, 0);
+  for (u32 Layer = 0; Layer < LayerNo; ++Layer)
+  {
+    auto const& rLayer = LayerBoxes[Layer];
+    for (auto CurBox : rLayer)
+    {
+      LayerWidths[Layer] += rBoxes[CurBox].m_Width;
+      LayerHeights[Layer] = std::max(LayerHeights[Layer], rBoxes[CurBox].m_Height);
+    }
+    if (!rLayer.empty())
+      LayerWidths[Layer] += static_cast<u32>(rLayer.size() - 1) * NodeDistance;
+    rWidth = std::max(rWidth, LayerWidths[Layer]);
+  }
+
+  s32 CurTop = 0;
+  for (u32 Layer = 0; Layer < LayerNo; ++Layer)
+  {
+    s32 CurLeft = static_cast<s32>((rWidth - LayerWidths[Layer]) / 2);
+    for (auto CurBox : LayerBoxes[Layer])
+    {
+      Point Center =
+      {
+        CurLeft + static_cast<s32>(rBoxes[CurBox].m_Width  / 2),
+        CurTop  + static_cast<s32>(rBoxes[CurBox].m_Height / 2)
+      };
+      rCenters[CurBox] = Center;
+      CurLeft += static_cast<s32>(rBoxes[CurBox].m_Width) + NodeDistance;
+    }
+    CurTop += static_cast<s32>(LayerHeights[Layer]) + LayerDistance;
+  }
+  rHeight = static_cast<u32>(CurTop - LayerDistance);
+
+  return true;
+}
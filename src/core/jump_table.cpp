@@ -0,0 +1,476 @@
+#include "medusa/jump_table.hpp"
+#include "medusa/document.hpp"
+#include "medusa/symbolic.hpp"
+#include "medusa/module.hpp"
+#include "medusa/extend.hpp"
+
+#include <set>
+
+MEDUSA_NAMESPACE_BEGIN
+
+namespace
+{
+  bool GetIdentifier(Expression::SPType spExpr, u32& rId)
+  {
+    auto spIdExpr = expr_cast<IdentifierExpression>(spExpr);
+    if (spIdExpr != nullptr)
+    {
+      rId = spIdExpr->GetId();
+      return true;
+    }
+
+    auto spTrkIdExpr = expr_cast<TrackedIdentifierExpression>(spExpr);
+    if (spTrkIdExpr != nullptr)
+    {
+      rId = spTrkIdExpr->GetId();
+      return true;
+    }
+
+    return false;
+  }
+
+  //! This function matches table + index * scale, operands can be in any order.
+  bool MatchIndexExpression(Expression::SPType spExpr, u64& rDisp, u32& rIdxId, u8& rScale)
+  {
+    auto spOpExpr = expr_cast<OperationExpression>(spExpr);
+    if (spOpExpr == nullptr || spOpExpr->GetOperation() != OperationExpression::OpAdd)
+      return false;
+
+    auto spConstExpr = expr_cast<ConstantExpression>(spOpExpr->GetRightExpression());
+    auto spIdxExpr   = spOpExpr->GetLeftExpression();
+    if (spConstExpr == nullptr)
+    {
+      spConstExpr = expr_cast<ConstantExpression>(spOpExpr->GetLeftExpression());
+      spIdxExpr   = spOpExpr->GetRightExpression();
+    }
+    if (spConstExpr == nullptr)
+      return false;
+
+    rDisp  = spConstExpr->GetConstant();
+    rScale = 1;
+
+    auto spScaleOpExpr = expr_cast<OperationExpression>(spIdxExpr);
+    if (spScaleOpExpr != nullptr)
+    {
+      auto spScaleExpr = expr_cast<ConstantExpression>(spScaleOpExpr->GetRightExpression());
+      if (spScaleExpr == nullptr)
+        return false;
+
+      switch (spScaleOpExpr->GetOperation())
+      {
+      case OperationExpression::OpMul: rScale = static_cast<u8>(spScaleExpr->GetConstant());      break;
+      case OperationExpression::OpLls: rScale = static_cast<u8>(1 << spScaleExpr->GetConstant()); break;
+      default:                         return false;
+      }
+      spIdxExpr = spScaleOpExpr->GetLeftExpression();
+    }
+
+    return GetIdentifier(spIdxExpr, rIdxId);
+  }
+
+  //! This function executes a function symbolically until rAddr is reached and backtracks RegId from there.
+  Expression::List BacktrackRegisterAt(Document& rDoc, Address const& rFuncAddr, Address const& rAddr, u32 RegId)
+  {
+    Expression::List Exprs;
+    std::set<Address> VisitedAddrs;
+
+    Symbolic Sym(rDoc);
+    Sym.FollowFunction(false);
+
+    Sym.Execute(rFuncAddr, [&](Symbolic::Context const& rSymCtxt, Address const& rCurAddr, Address::List& rNextAddresses)
+    {
+      if (rCurAddr == rAddr)
+      {
+        Exprs = rSymCtxt.BacktrackRegister(rCurAddr, RegId);
+        return false;
+      }
+
+      // Symbolic execution doesn't stop on loops, so we stop it once an address is reached twice
+      return VisitedAddrs.insert(rCurAddr).second;
+    });
+
+    return Exprs;
+  }
+
+  //! This function tells if a conditional jump also holds when both compared values are equal.
+  //! Unsigned and signed "or equal" conditions (e.g. ja/jbe, jg/jle) combine the zero flag with another
+  //! flag, while their strict counterparts (e.g. jae/jb, jge/jl) test a single flag or a xor.
+  bool IsInclusiveCondition(Instruction const& rGuardInsn, bool& rIsInclusive)
+  {
+    auto const& rSem = rGuardInsn.GetSemantic();
+    if (rSem.size() != 1)
+      return false;
+
+    auto spCondExpr = expr_cast<IfElseConditionExpression>(rSem.front());
+    if (spCondExpr == nullptr)
+      return false;
+
+    auto spRefExpr = spCondExpr->GetReferenceExpression();
+    auto spOpExpr  = expr_cast<OperationExpression>(spRefExpr);
+    if (spOpExpr != nullptr)
+    {
+      switch (spOpExpr->GetOperation())
+      {
+      case OperationExpression::OpOr:  rIsInclusive = true;  return true;
+      case OperationExpression::OpXor: rIsInclusive = false; return true;
+      default:                         return false;
+      }
+    }
+
+    u32 FlagId;
+    if (!GetIdentifier(spRefExpr, FlagId))
+      return false;
+    rIsInclusive = false;
+    return true;
+  }
+}
+
+JumpTable::JumpTable(void)
+  : m_pCpuInfo(nullptr)
+  , m_JmpAddr()
+  , m_TblAddr()
+  , m_IdxRegId()
+  , m_Scale()
+  , m_EntrySize()
+  , m_IsRelative(false)
+  , m_IsBounded(false)
+  , m_Targets()
+{
+}
+
+bool JumpTable::IsCandidate(Instruction const& rInsn)
+{
+  auto InsnType = rInsn.GetSubType();
+  if (!(InsnType & Instruction::JumpType) || (InsnType & Instruction::ConditionalType))
+    return false;
+
+  auto const pOprd = rInsn.Operand(0);
+  if (pOprd == nullptr)
+    return false;
+
+  // jmp [table + index * scale], without index it's likely a thunk (e.g. jmp [imported_function])
+  if (pOprd->GetType() & O_MEM)
+    return (pOprd->GetType() & O_SREG) ? true : false;
+
+  // jmp reg
+  return (pOprd->GetType() & O_REG) ? true : false;
+}
+
+Address JumpTable::GetReferenceAddress(Address const& rJmpAddr, Instruction const& rInsn)
+{
+  // Same convention as the analyzer uses when it creates cross-references from an operand
+  Address RefAddr;
+  if (!rInsn.GetOperandAddress(0, rJmpAddr, RefAddr))
+    RefAddr = rJmpAddr;
+  return RefAddr;
+}
+
+bool JumpTable::GetTargets(Document const& rDoc, Address const& rJmpAddr, Instruction const& rInsn, Address::List& rTargets)
+{
+  if (!IsCandidate(rInsn))
+    return false;
+
+  Address TblAddr;
+  if (!rDoc.GetCrossReferenceTo(GetReferenceAddress(rJmpAddr, rInsn), TblAddr))
+    return false;
+
+  auto spTblCell = rDoc.GetCell(TblAddr);
+  if (spTblCell == nullptr || spTblCell->GetType() != Cell::ValueType || spTblCell->GetLength() == 0)
+    return false;
+
+  // Each entry refers to its destination, the table ends on the first entry which doesn't
+  Address CurAddr = TblAddr;
+  for (u32 EntryIdx = 0; EntryIdx < DefaultMaxEntries; ++EntryIdx, CurAddr += spTblCell->GetLength())
+  {
+    if (EntryIdx != 0 && rDoc.HasCrossReferenceFrom(CurAddr))
+      break;
+
+    Address DstAddr;
+    if (!rDoc.GetCrossReferenceTo(CurAddr, DstAddr) || !rDoc.ContainsCode(DstAddr))
+      break;
+
+    rTargets.push_back(DstAddr);
+  }
+
+  return !rTargets.empty();
+}
+
+bool JumpTable::Resolve(
+  Document           & rDoc,
+  FunctionGraph const& rFuncGraph,
+  Address       const& rFuncAddr,
+  Address       const& rJmpAddr,
+  u32                  MaxEntries)
+{
+  *this = JumpTable();
+  m_JmpAddr = rJmpAddr;
+
+  auto spInsn = std::dynamic_pointer_cast<Instruction const>(rDoc.GetCell(rJmpAddr));
+  if (spInsn == nullptr || !IsCandidate(*spInsn))
+    return false;
+
+  auto spArch = ModuleManager::Instance().GetArchitecture(rDoc.GetArchitectureTag(rJmpAddr));
+  if (spArch == nullptr)
+    return false;
+  m_pCpuInfo = spArch->GetCpuInformation();
+  if (m_pCpuInfo == nullptr)
+    return false;
+
+  bool IsDecoded = (spInsn->Operand(0)->GetType() & O_MEM)
+    ? _DecodeMemoryOperand(rDoc, rFuncAddr, *spInsn)
+    : _BacktrackJumpRegister(rDoc, rFuncAddr, *spInsn);
+  if (!IsDecoded || m_EntrySize == 0)
+    return false;
+
+  u32 EntryNo = MaxEntries;
+  m_IsBounded = _FindBound(rDoc, rFuncGraph, EntryNo) && EntryNo <= MaxEntries;
+  if (!m_IsBounded)
+    EntryNo = MaxEntries;
+
+  return _ReadEntries(rDoc, EntryNo);
+}
+
+bool JumpTable::_DecodeMemoryOperand(Document& rDoc, Address const& rFuncAddr, Instruction const& rInsn)
+{
+  auto const pOprd = rInsn.Operand(0);
+  u64 OprdType = pOprd->GetType();
+
+  m_IdxRegId  = pOprd->GetSecReg();
+  m_Scale     = static_cast<u8>((OprdType & SC_MASK) >> 8);
+  m_EntrySize = rInsn.GetOperandReferenceLength(0) / 8;
+  if (m_Scale == 0)
+    m_Scale = 1;
+  if (m_EntrySize == 0)
+    m_EntrySize = m_JmpAddr.GetOffsetSize() / 8;
+
+  // The displacement (and pc when it's relative) gives the table address
+  if (!rInsn.GetOperandReference(rDoc, 0, m_JmpAddr, m_TblAddr))
+    return false;
+
+  u16 BaseRegId = pOprd->GetReg();
+  if (BaseRegId == 0 || (OprdType & O_REG_PC_REL))
+    return true;
+
+  // Otherwise, the base register must hold a constant (e.g. lea base, [table])
+  for (auto spExpr : BacktrackRegisterAt(rDoc, rFuncAddr, m_JmpAddr, BaseRegId))
+  {
+    auto spAssignExpr = expr_cast<AssignmentExpression>(spExpr);
+    if (spAssignExpr == nullptr)
+      continue;
+
+    u32 DstId;
+    if (!GetIdentifier(spAssignExpr->GetDestinationExpression(), DstId) || !m_pCpuInfo->IsRegisterAliased(DstId, BaseRegId))
+      continue;
+
+    auto spConstExpr = expr_cast<ConstantExpression>(spAssignExpr->GetSourceExpression());
+    if (spConstExpr == nullptr)
+      return false;
+
+    m_TblAddr.SetOffset(m_TblAddr.GetOffset() + spConstExpr->GetConstant());
+    return true;
+  }
+
+  return false;
+}
+
+bool JumpTable::_BacktrackJumpRegister(Document& rDoc, Address const& rFuncAddr, Instruction const& rInsn)
+{
+  auto Exprs = BacktrackRegisterAt(rDoc, rFuncAddr, m_JmpAddr, rInsn.Operand(0)->GetReg());
+
+  // Expressions are sorted from the jump to the beginning of the block, so the nearest load comes first
+  for (auto spExpr : Exprs)
+  {
+    FilterVisitor MemVst([](Expression::SPType spExpr) -> Expression::SPType
+    {
+      return expr_cast<MemoryExpression>(spExpr) != nullptr ? spExpr : nullptr;
+    });
+    spExpr->Visit(&MemVst);
+
+    for (auto spMatchedExpr : MemVst.GetMatchedExpressions())
+    {
+      auto spMemExpr = expr_cast<MemoryExpression>(spMatchedExpr);
+      u64 Disp;
+      if (!MatchIndexExpression(spMemExpr->GetOffsetExpression(), Disp, m_IdxRegId, m_Scale))
+        continue;
+
+      m_EntrySize = static_cast<u8>(spMemExpr->GetAccessSizeInBit() / 8);
+      m_TblAddr   = m_JmpAddr;
+      m_TblAddr.SetOffset(Disp);
+
+      // When the loaded entry is added to the table address, the table holds relative offsets
+      FilterVisitor RelVst([&](Expression::SPType spExpr) -> Expression::SPType
+      {
+        auto spOpExpr = expr_cast<OperationExpression>(spExpr);
+        if (spOpExpr == nullptr || spOpExpr->GetOperation() != OperationExpression::OpAdd)
+          return nullptr;
+
+        auto spLeftExpr  = spOpExpr->GetLeftExpression();
+        auto spRightExpr = spOpExpr->GetRightExpression();
+        auto spConstExpr = expr_cast<ConstantExpression>(spRightExpr);
+        if (spConstExpr == nullptr)
+        {
+          spConstExpr = expr_cast<ConstantExpression>(spLeftExpr);
+          spLeftExpr  = spRightExpr;
+        }
+        if (spConstExpr == nullptr || spConstExpr->GetConstant() != Disp)
+          return nullptr;
+
+        auto spSextExpr = expr_cast<OperationExpression>(spLeftExpr);
+        if (expr_cast<MemoryExpression>(spLeftExpr) == nullptr
+          && (spSextExpr == nullptr || spSextExpr->GetOperation() != OperationExpression::OpSext))
+          return nullptr;
+
+        return spExpr;
+      }, 1);
+      spExpr->Visit(&RelVst);
+      m_IsRelative = !RelVst.GetMatchedExpressions().empty();
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool JumpTable::_IsIndexRegister(u32 RegId) const
+{
+  return RegId == m_IdxRegId || m_pCpuInfo->IsRegisterAliased(RegId, m_IdxRegId);
+}
+
+bool JumpTable::_FindBound(Document const& rDoc, FunctionGraph const& rFuncGraph, u32& rNumberOfEntries) const
+{
+  // A pre-scaled index can't be compared with the number of entries
+  if (m_IdxRegId == 0 || m_Scale != m_EntrySize)
+    return false;
+
+  // Find the basic block which ends with the jump
+  auto const& rBscBlks = rFuncGraph.GetBasicBlocks();
+  u32 BscBlkIdx = 0;
+  for (; BscBlkIdx < rBscBlks.size(); ++BscBlkIdx)
+  {
+    auto BscBlkAddrs = rFuncGraph.GetBasicBlockAddresses(BscBlkIdx);
+    if (!BscBlkAddrs.empty() && BscBlkAddrs.back() == m_JmpAddr)
+      break;
+  }
+  if (BscBlkIdx == rBscBlks.size())
+    return false;
+
+  // We walk backward looking for: cmp index, bound ; j(a|ae) default ; ... ; jmp
+  // The index register can only be moved or used to load the entry between the check and the jump
+  std::shared_ptr<Instruction const> spGuardInsn;
+  for (u8 Depth = 0; Depth < 4; ++Depth)
+  {
+    auto BscBlkAddrs = rFuncGraph.GetBasicBlockAddresses(BscBlkIdx);
+    for (auto itAddr = BscBlkAddrs.rbegin(); itAddr != BscBlkAddrs.rend(); ++itAddr)
+    {
+      if (*itAddr == m_JmpAddr)
+        continue;
+
+      auto spInsn = std::dynamic_pointer_cast<Instruction const>(rDoc.GetCell(*itAddr));
+      if (spInsn == nullptr)
+        return false;
+
+      auto InsnType = spInsn->GetSubType();
+      auto const pDstOprd = spInsn->Operand(0);
+      auto const pSrcOprd = spInsn->Operand(1);
+      bool DstIsIdx = (pDstOprd->GetType() & O_REG) && !(pDstOprd->GetType() & O_MEM) && _IsIndexRegister(pDstOprd->GetReg());
+
+      if ((InsnType & Instruction::JumpType) && (InsnType & Instruction::ConditionalType))
+      {
+        // Two checks, we don't guess which one bounds the index
+        if (spGuardInsn != nullptr)
+          return false;
+        spGuardInsn = spInsn;
+        continue;
+      }
+
+      if (InsnType != Instruction::NoneType)
+        return false;
+
+      if (spGuardInsn != nullptr && spInsn->GetUpdatedFlags() != 0)
+      {
+        if (!DstIsIdx || !(pSrcOprd->GetType() & O_IMM))
+          return false;
+
+        // cmp index, bound ; ja default (or jbe table) accepts bound itself, jae (or jb) doesn't
+        bool IsInclusive;
+        if (!IsInclusiveCondition(*spGuardInsn, IsInclusive))
+          return false;
+
+        rNumberOfEntries = static_cast<u32>(pSrcOprd->GetValue()) + (IsInclusive ? 1 : 0);
+        return rNumberOfEntries != 0;
+      }
+
+      if (DstIsIdx && spGuardInsn == nullptr)
+      {
+        bool SrcUsesIdx =
+          ((pSrcOprd->GetType() & (O_REG | O_MEM)) && pSrcOprd->GetReg() != 0 && _IsIndexRegister(pSrcOprd->GetReg()))
+          || ((pSrcOprd->GetType() & O_SREG) && _IsIndexRegister(pSrcOprd->GetSecReg()));
+        if (!SrcUsesIdx)
+          return false;
+      }
+    }
+
+    // Only a straight line is followed
+    u32 PrevBscBlkIdx = 0, PrevBscBlkNo = 0;
+    for (auto const& rEdge : rFuncGraph.GetEdges())
+    {
+      if (rEdge.m_Destination != BscBlkIdx)
+        continue;
+      PrevBscBlkIdx = rEdge.m_Source;
+      ++PrevBscBlkNo;
+    }
+    if (PrevBscBlkNo != 1)
+      return false;
+    BscBlkIdx = PrevBscBlkIdx;
+  }
+
+  return false;
+}
+
+bool JumpTable::_ReadEntries(Document const& rDoc, u32 NumberOfEntries)
+{
+  auto const& rBinStrm = rDoc.GetBinaryStream();
+
+  Address CurAddr = m_TblAddr;
+  for (u32 EntryIdx = 0; EntryIdx < NumberOfEntries; ++EntryIdx, CurAddr += m_EntrySize)
+  {
+    auto const pMemArea = rDoc.GetMemoryArea(CurAddr);
+    TOffset FileOff;
+    if (pMemArea == nullptr || !pMemArea->ConvertOffsetToFileOffset(CurAddr.GetOffset(), FileOff))
+      break;
+
+    // Without bounds check, the table ends where something else starts
+    if (!m_IsBounded && EntryIdx != 0 && (rDoc.HasCrossReferenceFrom(CurAddr) || rDoc.ContainsCode(CurAddr)))
+      break;
+
+    u64 Entry;
+    bool IsRead = false;
+    switch (m_EntrySize)
+    {
+    case 2: { u16 Entry16; IsRead = rBinStrm.Read(FileOff, Entry16); Entry = m_IsRelative ? SignExtend<s64, 16>(Entry16) : Entry16; break; }
+    case 4: { u32 Entry32; IsRead = rBinStrm.Read(FileOff, Entry32); Entry = m_IsRelative ? SignExtend<s64, 32>(Entry32) : Entry32; break; }
+    case 8: { u64 Entry64; IsRead = rBinStrm.Read(FileOff, Entry64); Entry = Entry64;                                                break; }
+    default: return false;
+    }
+    if (!IsRead)
+      break;
+
+    Address DstAddr = m_JmpAddr;
+    DstAddr.SetOffset(m_IsRelative ? m_TblAddr.GetOffset() + Entry : Entry);
+
+    auto const pDstMemArea = rDoc.GetMemoryArea(DstAddr);
+    if (pDstMemArea == nullptr || !(pDstMemArea->GetAccess() & MemoryArea::Execute))
+      break;
+
+    m_Targets.push_back(DstAddr);
+  }
+
+  // A single entry without bounds check is likely a false positive
+  if (!m_IsBounded && m_Targets.size() < 2)
+    m_Targets.clear();
+
+  return !m_Targets.empty();
+}
+
+MEDUSA_NAMESPACE_END
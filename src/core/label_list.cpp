@@ -0,0 +1,293 @@
+#include "medusa/label_list.hpp"
+#include "medusa/document.hpp"
+#include "medusa/util.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <thread>
+
+MEDUSA_NAMESPACE_USE;
+
+LabelList::LabelList(void)
+  : m_ExcludedTypes(Label::Local)
+  , m_SortKey(SortByAddress)
+  , m_Ascending(true)
+{
+}
+
+void LabelList::SetFilter(std::string const& rPattern, u16 ExcludedTypes)
+{
+  m_Pattern = rPattern;
+  std::transform(std::begin(m_Pattern), std::end(m_Pattern), std::begin(m_Pattern), ::tolower);
+  m_ExcludedTypes = ExcludedTypes;
+}
+
+void LabelList::Rebuild(Document const& rDoc)
+{
+  // Updates received while the snapshot is taken are applied later, a label can't be listed twice
+  {
+    std::lock_guard<MutexType> Lock(m_PendingMutex);
+    m_PendingUpdates.clear();
+  }
+
+  std::vector<Entry> Entries;
+  rDoc.ForEachLabel([&](Address const& rAddr, Label const& rLbl)
+  {
+    std::string Name = rLbl.GetLabel();
+    if (!_IsListed(rLbl, Name))
+      return;
+    Entry CurEntry = { rAddr, rLbl, Name };
+    Entries.push_back(CurEntry);
+  });
+
+  m_Entries.swap(Entries);
+  _Sort();
+}
+
+void LabelList::Sort(SortKey Key, bool Ascending)
+{
+  if (m_SortKey == Key && m_Ascending == Ascending)
+    return;
+  m_SortKey   = Key;
+  m_Ascending = Ascending;
+  _Sort();
+}
+
+bool LabelList::FindRow(Address const& rAddress, u32& rRow) const
+{
+  if (m_SortKey == SortByAddress)
+  {
+    auto itEntry = std::lower_bound(std::begin(m_Entries), std::end(m_Entries), rAddress,
+      [this](Entry const& rEntry, Address const& rAddr)
+    {
+      return m_Ascending ? rEntry.m_Address < rAddr : rAddr < rEntry.m_Address;
+    });
+    if (itEntry == std::end(m_Entries) || !(itEntry->m_Address == rAddress))
+      return false;
+    rRow = static_cast<u32>(itEntry - std::begin(m_Entries));
+    return true;
+  }
+
+  for (u32 Row = 0; Row < m_Entries.size(); ++Row)
+  {
+    if (m_Entries[Row].m_Address == rAddress)
+    {
+      rRow = Row;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LabelList::AddLabelUpdate(Address const& rAddress, Label const& rLabel, bool Removed)
+{
+  std::lock_guard<MutexType> Lock(m_PendingMutex);
+  bool WasEmpty = m_PendingUpdates.empty();
+  ChangeJournal::LabelChange LblChg = { rAddress, rLabel, Removed };
+  m_PendingUpdates.push_back(LblChg);
+  return WasEmpty;
+}
+
+bool LabelList::HasPendingUpdates(void) const
+{
+  std::lock_guard<MutexType> Lock(m_PendingMutex);
+  return !m_PendingUpdates.empty();
+}
+
+void LabelList::ApplyUpdates(RowsCallbackType Callback)
+{
+  ChangeJournal::LabelChangeVector Updates;
+  {
+    std::lock_guard<MutexType> Lock(m_PendingMutex);
+    Updates.swap(m_PendingUpdates);
+  }
+  if (Updates.empty())
+    return;
+
+  auto Notify = [&Callback](RowsChange Change, u32 FirstRow, u32 LastRow)
+  {
+    if (Callback)
+      Callback(Change, FirstRow, LastRow);
+  };
+  auto Less = [this](Entry const& rLhs, Entry const& rRhs) { return _Less(rLhs, rRhs); };
+
+  // Only the last update of a label matters, e.g. a label added then removed is ignored
+  typedef std::pair<Entry, bool> StateType;
+  std::vector<StateType> States;
+  States.reserve(Updates.size());
+  for (auto const& rUpdate : Updates)
+  {
+    std::string Name = rUpdate.m_Label.GetLabel();
+    if (!_IsListed(rUpdate.m_Label, Name))
+      continue;
+    Entry CurEntry = { rUpdate.m_Address, rUpdate.m_Label, Name };
+    States.push_back(StateType(CurEntry, !rUpdate.m_Removed));
+  }
+  std::stable_sort(std::begin(States), std::end(States), [&Less](StateType const& rLhs, StateType const& rRhs)
+  {
+    return Less(rLhs.first, rRhs.first);
+  });
+
+  // States are sorted like the list, so removed rows and added entries are sorted too
+  std::vector<u32>   RemovedRows;
+  std::vector<Entry> AddedEntries;
+  for (size_t StateIdx = 0; StateIdx < States.size(); ++StateIdx)
+  {
+    if (StateIdx + 1 < States.size() && !Less(States[StateIdx].first, States[StateIdx + 1].first))
+      continue;
+    auto const& rState = States[StateIdx];
+    auto itEntry = std::lower_bound(std::begin(m_Entries), std::end(m_Entries), rState.first, Less);
+    bool IsListed = itEntry != std::end(m_Entries) && !Less(rState.first, *itEntry);
+    if (rState.second && !IsListed)
+      AddedEntries.push_back(std::move(States[StateIdx].first));
+    else if (!rState.second && IsListed)
+      RemovedRows.push_back(static_cast<u32>(itEntry - std::begin(m_Entries)));
+  }
+
+  if (RemovedRows.empty() && AddedEntries.empty())
+    return;
+
+  // A large batch is merged in one pass, views have to fetch their rows again
+  if (RemovedRows.size() + AddedEntries.size() > LargeBatchSize)
+  {
+    Notify(BeginReset, 0, 0);
+
+    size_t DstIdx = 0, RmIdx = 0;
+    for (size_t SrcIdx = 0; SrcIdx < m_Entries.size(); ++SrcIdx)
+    {
+      if (RmIdx < RemovedRows.size() && RemovedRows[RmIdx] == SrcIdx)
+      {
+        ++RmIdx;
+        continue;
+      }
+      if (DstIdx != SrcIdx)
+        m_Entries[DstIdx] = std::move(m_Entries[SrcIdx]);
+      ++DstIdx;
+    }
+    m_Entries.resize(DstIdx);
+
+    std::vector<Entry> Entries;
+    Entries.reserve(m_Entries.size() + AddedEntries.size());
+    std::merge(
+      std::make_move_iterator(std::begin(m_Entries)),    std::make_move_iterator(std::end(m_Entries)),
+      std::make_move_iterator(std::begin(AddedEntries)), std::make_move_iterator(std::end(AddedEntries)),
+      std::back_inserter(Entries), Less);
+    m_Entries.swap(Entries);
+
+    Notify(EndReset, 0, 0);
+    return;
+  }
+
+  // Contiguous removed rows are removed together, from the last one so indexes stay valid
+  for (size_t RangeEnd = RemovedRows.size(); RangeEnd != 0;)
+  {
+    size_t RangeBeg = RangeEnd - 1;
+    while (RangeBeg != 0 && RemovedRows[RangeBeg - 1] + 1 == RemovedRows[RangeBeg])
+      --RangeBeg;
+
+    u32 FirstRow = RemovedRows[RangeBeg], LastRow = RemovedRows[RangeEnd - 1];
+    Notify(BeginRemoveRows, FirstRow, LastRow);
+    m_Entries.erase(std::begin(m_Entries) + FirstRow, std::begin(m_Entries) + LastRow + 1);
+    Notify(EndRemoveRows, FirstRow, LastRow);
+
+    RangeEnd = RangeBeg;
+  }
+
+  // Added entries which fall between the same rows are inserted together
+  for (size_t RangeBeg = 0; RangeBeg < AddedEntries.size();)
+  {
+    auto itPos = std::lower_bound(std::begin(m_Entries), std::end(m_Entries), AddedEntries[RangeBeg], Less);
+    size_t RangeEnd = RangeBeg + 1;
+    while (RangeEnd < AddedEntries.size() && (itPos == std::end(m_Entries) || Less(AddedEntries[RangeEnd], *itPos)))
+      ++RangeEnd;
+
+    u32 FirstRow = static_cast<u32>(itPos - std::begin(m_Entries));
+    u32 LastRow  = FirstRow + static_cast<u32>(RangeEnd - RangeBeg) - 1;
+    Notify(BeginInsertRows, FirstRow, LastRow);
+    m_Entries.insert(itPos, std::begin(AddedEntries) + RangeBeg, std::begin(AddedEntries) + RangeEnd);
+    Notify(EndInsertRows, FirstRow, LastRow);
+
+    RangeBeg = RangeEnd;
+  }
+}
+
+bool LabelList::_IsListed(Label const& rLabel, std::string const& rName) const
+{
+  if (rLabel.GetType() & m_ExcludedTypes)
+    return false;
+  if (m_Pattern.empty())
+    return true;
+
+  auto itFound = std::search(std::begin(rName), std::end(rName), std::begin(m_Pattern), std::end(m_Pattern),
+    [](char NameChr, char PatChr) { return ::tolower(static_cast<unsigned char>(NameChr)) == PatChr; });
+  return itFound != std::end(rName);
+}
+
+bool LabelList::_Less(Entry const& rLhs, Entry const& rRhs) const
+{
+  Entry const& rFst = m_Ascending ? rLhs : rRhs;
+  Entry const& rSnd = m_Ascending ? rRhs : rLhs;
+
+  switch (m_SortKey)
+  {
+  case SortByName:
+    {
+      int Res = rFst.m_Name.compare(rSnd.m_Name);
+      if (Res != 0)
+        return Res < 0;
+    }
+    break;
+
+  case SortByType:
+    if (rFst.m_Label.GetType() != rSnd.m_Label.GetType())
+      return rFst.m_Label.GetType() < rSnd.m_Label.GetType();
+    break;
+
+  case SortByAddress:
+    if (!(rFst.m_Address == rSnd.m_Address))
+      return rFst.m_Address < rSnd.m_Address;
+    break;
+  }
+
+  // Ties are always ordered the same way, so each label has a single place in the list
+  if (!(rLhs.m_Address == rRhs.m_Address))
+    return rLhs.m_Address < rRhs.m_Address;
+  int Res = rLhs.m_Name.compare(rRhs.m_Name);
+  if (Res != 0)
+    return Res < 0;
+  return rLhs.m_Label.GetType() < rRhs.m_Label.GetType();
+}
+
+void LabelList::_Sort(void)
+{
+  auto Less = [this](Entry const& rLhs, Entry const& rRhs) { return _Less(rLhs, rRhs); };
+
+  // Chunks are sorted in parallel, then merged two by two
+  size_t EntryNo   = m_Entries.size();
+  size_t ThreadNo  = std::max(1U, std::thread::hardware_concurrency());
+  size_t ChunkSize = std::max<size_t>(0x4000, (EntryNo + ThreadNo - 1) / ThreadNo);
+  size_t ChunkNo   = (EntryNo + ChunkSize - 1) / ChunkSize;
+  auto   itBeg     = std::begin(m_Entries);
+
+  ParallelFor(ChunkNo, [&](size_t Begin, size_t End)
+  {
+    for (size_t ChunkIdx = Begin; ChunkIdx < End; ++ChunkIdx)
+      std::sort(itBeg + ChunkIdx * ChunkSize, itBeg + std::min(EntryNo, (ChunkIdx + 1) * ChunkSize), Less);
+  });
+
+  for (size_t Width = ChunkSize; Width < EntryNo; Width *= 2)
+  {
+    size_t PairNo = (EntryNo + 2 * Width - 1) / (2 * Width);
+    ParallelFor(PairNo, [&](size_t Begin, size_t End)
+    {
+      for (size_t PairIdx = Begin; PairIdx < End; ++PairIdx)
+      {
+        size_t MidIdx = PairIdx * 2 * Width + Width;
+        if (MidIdx >= EntryNo)
+          continue;
+        std::inplace_merge(itBeg + PairIdx * 2 * Width, itBeg + MidIdx, itBeg + std::min(EntryNo, MidIdx + Width), Less);
+      }
+    });
+  }
+}
@@ -0,0 +1,225 @@
+#include "medusa/line_cache.hpp"
+
+#include <algorithm>
+
+MEDUSA_NAMESPACE_USE;
+
+LineCache::LineCache(u32 MaxLines)
+  : m_LiveLineNo()
+  , m_MaxLines(MaxLines)
+  , m_HitCount()
+  , m_MissCount()
+{
+  std::fill(std::begin(m_Epochs), std::end(m_Epochs), 0);
+}
+
+bool LineCache::Contains(Address const& rAddress) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  return m_Entries.find(rAddress) != std::end(m_Entries);
+}
+
+u16 LineCache::GetLineNo(Address const& rAddress) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  auto itEntry = m_Entries.find(rAddress);
+  if (itEntry == std::end(m_Entries))
+    return 0;
+  return itEntry->second.m_LineNo;
+}
+
+bool LineCache::GetLine(Address const& rAddress, u16 LineIndex, LineData& rLine) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  auto itEntry = m_Entries.find(rAddress);
+  if (itEntry == std::end(m_Entries))
+    return false;
+  if (LineIndex >= itEntry->second.m_LineNo)
+    return false;
+  rLine = LineData(_GetLine(m_Lines[itEntry->second.m_FirstLine + LineIndex], rAddress));
+  return true;
+}
+
+bool LineCache::Replay(Address const& rAddress, PrintData& rPrintData) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  auto itEntry = m_Entries.find(rAddress);
+  if (itEntry == std::end(m_Entries))
+  {
+    ++m_MissCount;
+    return false;
+  }
+
+  ++m_HitCount;
+  auto const& rEntry = itEntry->second;
+  for (u32 LineIdx = rEntry.m_FirstLine; LineIdx < rEntry.m_FirstLine + rEntry.m_LineNo; ++LineIdx)
+    rPrintData.AppendLine(_GetLine(m_Lines[LineIdx], rAddress));
+  return true;
+}
+
+void LineCache::Insert(Address const& rAddress, PrintData const& rPrintData, u32 FirstLine)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  _Insert(rAddress, rPrintData, FirstLine);
+}
+
+u32 LineCache::GetEpoch(Address const& rAddress) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  return _GetEpoch(rAddress);
+}
+
+bool LineCache::Insert(Address const& rAddress, PrintData const& rPrintData, u32 FirstLine, u32 Epoch)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+
+  // rAddress was invalidated while it was formatted, its lines may be outdated
+  if (_GetEpoch(rAddress) != Epoch)
+    return false;
+
+  _Insert(rAddress, rPrintData, FirstLine);
+  return true;
+}
+
+void LineCache::_Insert(Address const& rAddress, PrintData const& rPrintData, u32 FirstLine)
+{
+  auto itEntry = m_Entries.find(rAddress);
+  if (itEntry != std::end(m_Entries))
+    _Erase(itEntry);
+
+  // Dead lines are only reclaimed when they take more room than live ones
+  if (m_Lines.size() > 2 * static_cast<size_t>(m_LiveLineNo) + 0x1000)
+    _Compact();
+  if (m_LiveLineNo >= m_MaxLines)
+  {
+    m_Entries.clear();
+    m_Lines.clear();
+    m_Texts.clear();
+    m_Marks.clear();
+    m_OperandsOffset.clear();
+    m_LiveLineNo = 0;
+  }
+
+  Entry NewEntry = { static_cast<u32>(m_Lines.size()), 0 };
+  rPrintData.ForEachLineView([&](LineView const& rLine)
+  {
+    if (!(rLine.GetAddress() == rAddress))
+      return;
+
+    LineRecord CurRec;
+    CurRec.m_TextOffset    = static_cast<u32>(m_Texts.size());
+    CurRec.m_TextLength    = static_cast<u16>(rLine.GetText().length());
+    CurRec.m_MarkOffset    = static_cast<u32>(m_Marks.size());
+    CurRec.m_MarkNo        = static_cast<u16>(rLine.GetMarks().size());
+    CurRec.m_OperandOffset = static_cast<u32>(m_OperandsOffset.size());
+    CurRec.m_OperandNo     = static_cast<u16>(rLine.GetOperandsOffset().size());
+
+    m_Texts.append(rLine.GetText().data(), rLine.GetText().length());
+    m_Marks.insert(std::end(m_Marks), std::begin(rLine.GetMarks()), std::end(rLine.GetMarks()));
+    m_OperandsOffset.insert(std::end(m_OperandsOffset), std::begin(rLine.GetOperandsOffset()), std::end(rLine.GetOperandsOffset()));
+    m_Lines.push_back(CurRec);
+    ++NewEntry.m_LineNo;
+  }, FirstLine);
+
+  m_LiveLineNo += NewEntry.m_LineNo;
+  m_Entries[rAddress] = NewEntry;
+}
+
+void LineCache::Invalidate(Address const& rAddress)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  _Invalidate(rAddress);
+}
+
+void LineCache::Invalidate(Address::List const& rAddresses)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  for (auto const& rAddr : rAddresses)
+    _Invalidate(rAddr);
+}
+
+void LineCache::Clear(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  for (auto& rEpoch : m_Epochs)
+    ++rEpoch;
+  m_Entries.clear();
+  m_Lines.clear();
+  m_Texts.clear();
+  m_Marks.clear();
+  m_OperandsOffset.clear();
+  m_LiveLineNo = 0;
+}
+
+u32 LineCache::GetLiveLineNo(void) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  return m_LiveLineNo;
+}
+
+LineView LineCache::_GetLine(LineRecord const& rRecord, Address const& rAddress) const
+{
+  // Lines are replayed from the arenas without any copy
+  return LineView(
+    rAddress,
+    TextView(m_Texts.data() + rRecord.m_TextOffset, rRecord.m_TextLength),
+    Mark::View(m_Marks.data() + rRecord.m_MarkOffset, rRecord.m_MarkNo),
+    ArrayView<u16>(m_OperandsOffset.data() + rRecord.m_OperandOffset, rRecord.m_OperandNo));
+}
+
+void LineCache::_Invalidate(Address const& rAddress)
+{
+  ++_GetEpoch(rAddress);
+  auto itEntry = m_Entries.find(rAddress);
+  if (itEntry != std::end(m_Entries))
+    _Erase(itEntry);
+}
+
+u32& LineCache::_GetEpoch(Address const& rAddress) const
+{
+  return m_Epochs[std::hash<Address>()(rAddress) % EpochNo];
+}
+
+void LineCache::_Erase(EntryMapType::iterator itEntry)
+{
+  // Arenas are append only, lines of the erased entry are reclaimed by _Compact
+  m_LiveLineNo -= itEntry->second.m_LineNo;
+  m_Entries.erase(itEntry);
+}
+
+void LineCache::_Compact(void)
+{
+  std::vector<LineRecord> Lines;
+  std::string             Texts;
+  std::vector<Mark>       Marks;
+  std::vector<u16>        OprdsOff;
+
+  Lines.reserve(m_LiveLineNo);
+  for (auto& rEntry : m_Entries)
+  {
+    u32 FirstLine = static_cast<u32>(Lines.size());
+    for (u32 LineIdx = rEntry.second.m_FirstLine; LineIdx < rEntry.second.m_FirstLine + rEntry.second.m_LineNo; ++LineIdx)
+    {
+      LineRecord CurRec = m_Lines[LineIdx];
+
+      Texts.append(m_Texts, CurRec.m_TextOffset, CurRec.m_TextLength);
+      CurRec.m_TextOffset = static_cast<u32>(Texts.size() - CurRec.m_TextLength);
+
+      auto itMark = std::begin(m_Marks) + CurRec.m_MarkOffset;
+      CurRec.m_MarkOffset = static_cast<u32>(Marks.size());
+      Marks.insert(std::end(Marks), itMark, itMark + CurRec.m_MarkNo);
+
+      auto itOprd = std::begin(m_OperandsOffset) + CurRec.m_OperandOffset;
+      CurRec.m_OperandOffset = static_cast<u32>(OprdsOff.size());
+      OprdsOff.insert(std::end(OprdsOff), itOprd, itOprd + CurRec.m_OperandNo);
+
+      Lines.push_back(CurRec);
+    }
+    rEntry.second.m_FirstLine = FirstLine;
+  }
+
+  m_Lines.swap(Lines);
+  m_Texts.swap(Texts);
+  m_Marks.swap(Marks);
+  m_OperandsOffset.swap(OprdsOff);
+}
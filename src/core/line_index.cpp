@@ -0,0 +1,256 @@
+#include "medusa/line_index.hpp"
+#include "medusa/document.hpp"
+#include "medusa/memory_area.hpp"
+#include "medusa/util.hpp"
+
+#include <algorithm>
+
+MEDUSA_NAMESPACE_USE;
+
+LineIndex::LineIndex(Document const& rDoc, LineCounterType LineCounter, u32 BlockSize)
+  : m_rDoc(rDoc)
+  , m_LineCounter(LineCounter)
+  , m_BlockSize(BlockSize ? BlockSize : DefaultBlockSize)
+  , m_IsBuilt(false)
+{
+}
+
+void LineIndex::Invalidate(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  m_IsBuilt = false;
+  m_Areas.clear();
+  m_BlockLines.clear();
+  m_Tree.clear();
+  m_DirtyBlocks.clear();
+}
+
+void LineIndex::Update(Address::List const& rAddresses)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!m_IsBuilt)
+    return;
+
+  for (auto const& rAddr : rAddresses)
+  {
+    u32 BlkIdx;
+    if (!_FindBlock(rAddr, BlkIdx))
+      continue;
+
+    // The cell could have grown over the following blocks
+    auto spCellData = _GetArea(BlkIdx)->m_pMemArea->GetCellData(rAddr.GetOffset());
+    u32 CellLen = (spCellData != nullptr) ? spCellData->GetLength() : 1;
+    u32 LastBlkIdx = BlkIdx + (CellLen + m_BlockSize - 1) / m_BlockSize;
+
+    for (; BlkIdx <= LastBlkIdx && BlkIdx < m_BlockLines.size(); ++BlkIdx)
+      m_DirtyBlocks.insert(BlkIdx);
+  }
+}
+
+u32 LineIndex::GetNumberOfLines(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!_Prepare())
+    return 0;
+  return _GetLinesBefore(static_cast<u32>(m_BlockLines.size()));
+}
+
+bool LineIndex::ConvertAddressToLine(Address const& rAddress, u32& rLine)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!_Prepare())
+    return false;
+
+  Address CellAddr;
+  if (!m_rDoc.GetNearestAddress(rAddress, CellAddr))
+    return false;
+
+  u32 BlkIdx;
+  if (!_FindBlock(CellAddr, BlkIdx))
+    return false;
+
+  rLine = _GetLinesBefore(BlkIdx);
+  _ForEachCellInBlock(BlkIdx, [&](Address const& rCurAddr, u16 LineNo)
+  {
+    if (!(rCurAddr < CellAddr))
+      return false;
+    rLine += LineNo;
+    return true;
+  });
+  return true;
+}
+
+bool LineIndex::ConvertLineToAddress(u32 Line, Address& rAddress, u16& rLineOffset)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!_Prepare())
+    return false;
+
+  u32 BlkIdx, LinesBefore;
+  if (!_FindBlockFromLine(Line, BlkIdx, LinesBefore))
+    return false;
+
+  bool Found = false;
+  u32 Remaining = Line - LinesBefore;
+  _ForEachCellInBlock(BlkIdx, [&](Address const& rCurAddr, u16 LineNo)
+  {
+    rAddress = rCurAddr;
+    if (Remaining < LineNo)
+    {
+      rLineOffset = static_cast<u16>(Remaining);
+      Found = true;
+      return false;
+    }
+    Remaining -= LineNo;
+    return true;
+  });
+  return Found;
+}
+
+bool LineIndex::_Prepare(void)
+{
+  if (!m_IsBuilt)
+    _Build();
+
+  // Modified blocks are counted again and their difference is propagated in the tree
+  for (u32 BlkIdx : m_DirtyBlocks)
+  {
+    u32 NewLineNo = _CountBlock(BlkIdx);
+    s64 Delta = static_cast<s64>(NewLineNo) - static_cast<s64>(m_BlockLines[BlkIdx]);
+    if (Delta == 0)
+      continue;
+    m_BlockLines[BlkIdx] = NewLineNo;
+    _AddToTree(BlkIdx, Delta);
+  }
+  m_DirtyBlocks.clear();
+
+  return !m_BlockLines.empty();
+}
+
+void LineIndex::_Build(void)
+{
+  m_Areas.clear();
+  m_DirtyBlocks.clear();
+
+  u32 BlkNo = 0;
+  m_rDoc.ForEachMemoryArea([&](MemoryArea const& rMemArea)
+  {
+    Area CurArea = { &rMemArea, rMemArea.GetBaseAddress().GetOffset(), rMemArea.GetSize(), BlkNo };
+    if (CurArea.m_Size == 0)
+      return;
+    m_Areas.push_back(CurArea);
+    BlkNo += (CurArea.m_Size + m_BlockSize - 1) / m_BlockSize;
+  });
+
+  // Blocks don't depend on each other, so the first count is done in parallel
+  m_BlockLines.assign(BlkNo, 0);
+  ParallelFor(BlkNo, [&](size_t Begin, size_t End)
+  {
+    for (size_t BlkIdx = Begin; BlkIdx < End; ++BlkIdx)
+      m_BlockLines[BlkIdx] = _CountBlock(static_cast<u32>(BlkIdx));
+  });
+
+  m_Tree.assign(BlkNo + 1, 0);
+  for (u32 TreeIdx = 1; TreeIdx <= BlkNo; ++TreeIdx)
+  {
+    m_Tree[TreeIdx] += m_BlockLines[TreeIdx - 1];
+    u32 ParentIdx = TreeIdx + (TreeIdx & (~TreeIdx + 1));
+    if (ParentIdx <= BlkNo)
+      m_Tree[ParentIdx] += m_Tree[TreeIdx];
+  }
+
+  m_IsBuilt = true;
+}
+
+bool LineIndex::_FindBlock(Address const& rAddress, u32& rBlockIndex) const
+{
+  for (auto const& rArea : m_Areas)
+  {
+    if (!rArea.m_pMemArea->IsCellPresent(rAddress))
+      continue;
+    rBlockIndex = rArea.m_FirstBlock + static_cast<u32>((rAddress.GetOffset() - rArea.m_BaseOffset) / m_BlockSize);
+    return true;
+  }
+  return false;
+}
+
+LineIndex::Area const* LineIndex::_GetArea(u32 BlockIndex) const
+{
+  Area const* pArea = nullptr;
+  for (auto const& rArea : m_Areas)
+    if (BlockIndex >= rArea.m_FirstBlock)
+      pArea = &rArea;
+  return pArea;
+}
+
+void LineIndex::_ForEachCellInBlock(u32 BlockIndex, CellCallbackType Callback) const
+{
+  auto const* pArea = _GetArea(BlockIndex);
+  if (pArea == nullptr)
+    return;
+
+  auto const* pMemArea = pArea->m_pMemArea;
+  TOffset BegOff = pArea->m_BaseOffset + static_cast<TOffset>(BlockIndex - pArea->m_FirstBlock) * m_BlockSize;
+  TOffset EndOff = std::min<TOffset>(BegOff + m_BlockSize, pArea->m_BaseOffset + pArea->m_Size);
+
+  pMemArea->ForEachCellDataInRange(BegOff, EndOff, [&](TOffset Offset, CellData::SPType)
+  {
+    // A cell which starts in the previous block belongs to it
+    if (Offset < BegOff)
+      return true;
+    Address CurAddr = pMemArea->MakeAddress(Offset);
+    return Callback(CurAddr, m_LineCounter(CurAddr));
+  });
+}
+
+u32 LineIndex::_CountBlock(u32 BlockIndex) const
+{
+  u32 LineNo = 0;
+  _ForEachCellInBlock(BlockIndex, [&LineNo](Address const&, u16 CellLineNo)
+  {
+    LineNo += CellLineNo;
+    return true;
+  });
+  return LineNo;
+}
+
+void LineIndex::_AddToTree(u32 BlockIndex, s64 Delta)
+{
+  for (u32 TreeIdx = BlockIndex + 1; TreeIdx < m_Tree.size(); TreeIdx += (TreeIdx & (~TreeIdx + 1)))
+    m_Tree[TreeIdx] = static_cast<u32>(static_cast<s64>(m_Tree[TreeIdx]) + Delta);
+}
+
+u32 LineIndex::_GetLinesBefore(u32 BlockIndex) const
+{
+  u32 LineNo = 0;
+  for (u32 TreeIdx = BlockIndex; TreeIdx != 0; TreeIdx &= TreeIdx - 1)
+    LineNo += m_Tree[TreeIdx];
+  return LineNo;
+}
+
+bool LineIndex::_FindBlockFromLine(u32 Line, u32& rBlockIndex, u32& rLinesBefore) const
+{
+  u32 BlkNo = static_cast<u32>(m_BlockLines.size());
+  u32 Step = 1;
+  while (Step <= BlkNo / 2)
+    Step <<= 1;
+
+  // Look for the last block whose preceding lines don't exceed Line
+  u32 Pos = 0, Remaining = Line;
+  for (; Step != 0; Step >>= 1)
+  {
+    u32 NextPos = Pos + Step;
+    if (NextPos <= BlkNo && m_Tree[NextPos] <= Remaining)
+    {
+      Pos = NextPos;
+      Remaining -= m_Tree[NextPos];
+    }
+  }
+
+  if (Pos >= BlkNo)
+    return false;
+
+  rBlockIndex  = Pos;
+  rLinesBefore = Line - Remaining;
+  return true;
+}
@@ -0,0 +1,112 @@
+#include "medusa/line_prefetcher.hpp"
+#include "medusa/medusa.hpp"
+#include "medusa/disassembly_view.hpp"
+
+MEDUSA_NAMESPACE_USE;
+
+LinePrefetcher::LinePrefetcher(Medusa const& rCore, LineCache& rLineCache, u32 FormatFlags, PageReadyCallbackType PageReady, u32 PageNo)
+  : m_rCore(rCore)
+  , m_rLineCache(rLineCache)
+  , m_FormatFlags(FormatFlags)
+  , m_PageReady(PageReady)
+  , m_PageNo(PageNo)
+  , m_AddressNo()
+  , m_HasRequest(false)
+  , m_Generation(0)
+  , m_Running(true)
+{
+  m_Thread = std::thread(&LinePrefetcher::_Run, this);
+}
+
+LinePrefetcher::~LinePrefetcher(void)
+{
+  Stop();
+}
+
+void LinePrefetcher::Request(Address const& rTopAddress, u32 AddressNo)
+{
+  {
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_TopAddress = rTopAddress;
+    m_AddressNo  = AddressNo ? AddressNo : 1;
+    m_HasRequest = true;
+    ++m_Generation;
+  }
+  m_CondVar.notify_one();
+}
+
+void LinePrefetcher::Stop(void)
+{
+  {
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    if (!m_Running)
+      return;
+    m_Running = false;
+  }
+  m_CondVar.notify_one();
+  if (m_Thread.joinable())
+    m_Thread.join();
+}
+
+void LinePrefetcher::_Run(void)
+{
+  auto const& rDoc = m_rCore.GetDocument();
+
+  for (;;)
+  {
+    Address TopAddr;
+    u32 AddrNo, Gen;
+    {
+      std::unique_lock<std::mutex> Lock(m_Mutex);
+      while (m_Running && !m_HasRequest)
+        m_CondVar.wait(Lock);
+      if (!m_Running)
+        return;
+      TopAddr      = m_TopAddress;
+      AddrNo       = m_AddressNo;
+      Gen          = m_Generation;
+      m_HasRequest = false;
+    }
+
+    // The visible page is the only one which has to be notified
+    Address NextAddr;
+    bool HasNext = _FormatRange(TopAddr, AddrNo, Gen, NextAddr);
+    if (_IsCancelled(Gen))
+      continue;
+    m_PageReady();
+
+    if (HasNext)
+      _FormatRange(NextAddr, AddrNo * m_PageNo, Gen, NextAddr);
+    if (_IsCancelled(Gen))
+      continue;
+
+    Address AboveAddr;
+    if (rDoc.MoveAddress(TopAddr, AboveAddr, -static_cast<s64>(AddrNo * m_PageNo)) && !(AboveAddr == TopAddr))
+      _FormatRange(AboveAddr, AddrNo * m_PageNo, Gen, NextAddr);
+  }
+}
+
+bool LinePrefetcher::_FormatRange(Address const& rFirstAddress, u32 AddressNo, u32 Generation, Address& rNextAddress)
+{
+  auto const& rDoc = m_rCore.GetDocument();
+  PrintData Print;
+  FormatDisassembly Format(m_rCore, Print, &m_rLineCache);
+
+  Address CurAddr = rFirstAddress;
+  for (u32 i = 0; i < AddressNo; ++i)
+  {
+    if (_IsCancelled(Generation))
+      return false;
+
+    // Formatting a missing address inserts it in the cache, it's done like a view does
+    // so both produce the same lines
+    if (!m_rLineCache.Contains(CurAddr))
+      Format(CurAddr, m_FormatFlags, 1);
+
+    if (!rDoc.GetNextAddress(CurAddr, CurAddr))
+      return false;
+  }
+
+  rNextAddress = CurAddr;
+  return true;
+}
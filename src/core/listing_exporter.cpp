@@ -0,0 +1,222 @@
+#include "medusa/listing_exporter.hpp"
+#include "medusa/medusa.hpp"
+#include "medusa/memory_area.hpp"
+#include "medusa/util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+MEDUSA_NAMESPACE_USE;
+
+ListingExporter::ListingExporter(Medusa const& rCore, u32 FormatFlags, u32 ChunkSize)
+  : m_rCore(rCore)
+  , m_FormatFlags(FormatFlags)
+  , m_ChunkSize(ChunkSize ? ChunkSize : DefaultChunkSize)
+  , m_LineNo()
+{
+}
+
+bool ListingExporter::Export(std::ostream& rOutput, OutputType Type)
+{
+  m_LineNo = 0;
+
+  std::vector<Chunk> Chunks;
+  _SplitInChunks(Chunks);
+  if (Chunks.empty())
+    return false;
+
+  // Chunks are formatted by batches to bound the memory used by pending outputs,
+  // workers take the next chunk available so a slow chunk doesn't stall the others
+  size_t WorkerNo = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  size_t BatchSize = WorkerNo * 4;
+  std::vector<std::string> Outputs(BatchSize);
+  std::vector<u64>         LineNos(BatchSize);
+
+  for (size_t BatchBeg = 0; BatchBeg < Chunks.size(); BatchBeg += BatchSize)
+  {
+    size_t BatchEnd = std::min(BatchBeg + BatchSize, Chunks.size());
+    std::atomic<size_t> NextChunk(BatchBeg);
+
+    ParallelFor(WorkerNo, [&](size_t, size_t)
+    {
+      for (;;)
+      {
+        size_t ChunkIdx = NextChunk++;
+        if (ChunkIdx >= BatchEnd)
+          break;
+        auto& rOutput = Outputs[ChunkIdx - BatchBeg];
+        rOutput.clear();
+        LineNos[ChunkIdx - BatchBeg] = _FormatChunk(Chunks[ChunkIdx], Type, rOutput);
+      }
+    });
+
+    for (size_t ChunkIdx = BatchBeg; ChunkIdx < BatchEnd; ++ChunkIdx)
+    {
+      auto const& rChunkOutput = Outputs[ChunkIdx - BatchBeg];
+      rOutput.write(rChunkOutput.data(), static_cast<std::streamsize>(rChunkOutput.size()));
+      m_LineNo += LineNos[ChunkIdx - BatchBeg];
+    }
+
+    if (!rOutput)
+      return false;
+  }
+
+  return true;
+}
+
+bool ListingExporter::Export(boost::filesystem::path const& rPath, OutputType Type)
+{
+  // The buffer must be set before the file is opened
+  std::vector<char> Buffer(DefaultBufferSize);
+  std::ofstream File;
+  File.rdbuf()->pubsetbuf(Buffer.data(), static_cast<std::streamsize>(Buffer.size()));
+  File.open(rPath.string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!File.is_open())
+    return false;
+
+  if (!Export(File, Type))
+    return false;
+
+  File.flush();
+  return File.good();
+}
+
+void ListingExporter::_SplitInChunks(std::vector<Chunk>& rChunks) const
+{
+  m_rCore.GetDocument().ForEachMemoryArea([&](MemoryArea const& rMemArea)
+  {
+    TOffset BaseOff = rMemArea.GetBaseAddress().GetOffset();
+    TOffset EndOff  = BaseOff + rMemArea.GetSize();
+    for (TOffset ChunkOff = BaseOff; ChunkOff < EndOff; ChunkOff += m_ChunkSize)
+    {
+      Chunk CurChunk = { &rMemArea, ChunkOff, std::min<TOffset>(ChunkOff + m_ChunkSize, EndOff) };
+      rChunks.push_back(CurChunk);
+    }
+  });
+}
+
+Address::List ListingExporter::_GetChunkAddresses(Chunk const& rChunk) const
+{
+  Address::List Addrs;
+  auto const* pMemArea = rChunk.m_pMemArea;
+
+  pMemArea->ForEachCellDataInRange(rChunk.m_BeginOffset, rChunk.m_EndOffset, [&](TOffset Offset, CellData::SPType)
+  {
+    // A cell which starts in the previous chunk belongs to it
+    if (Offset >= rChunk.m_BeginOffset)
+      Addrs.push_back(pMemArea->MakeAddress(Offset));
+    return true;
+  });
+
+  return Addrs;
+}
+
+u64 ListingExporter::_FormatChunk(Chunk const& rChunk, OutputType Type, std::string& rOutput) const
+{
+  auto Addrs = _GetChunkAddresses(rChunk);
+  if (Addrs.empty())
+    return 0;
+
+  PrintData Print;
+  FormatDisassembly Format(m_rCore, Print);
+  Format(Addrs, m_FormatFlags);
+
+  if (Type == TextOutput)
+  {
+    Print.ForEachLine([&](Address const&, TextView const& rText, Mark::View const&)
+    {
+      rOutput.append(rText.data(), rText.length());
+    });
+    return Print.GetNumberOfLines();
+  }
+
+  // Lines of the same address follow each other, so its string is only built once
+  Address LastAddr;
+  std::string AddrStr;
+  bool HasAddr = false;
+  Print.ForEachLineView([&](LineView const& rLine)
+  {
+    if (!HasAddr || !(rLine.GetAddress() == LastAddr))
+    {
+      LastAddr = rLine.GetAddress();
+      AddrStr  = LastAddr.ToString();
+      HasAddr  = true;
+    }
+    _AppendJsonLine(rLine, AddrStr, rOutput);
+  });
+  return Print.GetNumberOfLines();
+}
+
+void ListingExporter::_AppendJsonLine(LineView const& rLine, std::string const& rAddress, std::string& rOutput)
+{
+  static char const* s_MarkTypes[] =
+  {
+    "unknown", "unprintable", "mnemonic", "register", "immediate", "label",
+    "keyword", "operator", "character", "string", "comment",
+  };
+
+  auto const& rText = rLine.GetText();
+  TextView Text = (!rText.empty() && rText[rText.length() - 1] == '\n') ? rText.substr(0, rText.length() - 1) : rText;
+
+  rOutput += "{\"address\":\"";
+  rOutput += rAddress;
+  rOutput += "\",\"text\":";
+  _AppendJsonString(Text, rOutput);
+  rOutput += ",\"marks\":[";
+
+  // Unprintable marks are only spaces, their offsets are implied by the other ones
+  bool IsFirstMark = true;
+  size_t MarkOff = 0;
+  for (auto const& rMark : rLine.GetMarks())
+  {
+    u16 MarkType = rMark.GetType();
+    if (MarkType != Mark::UnprintableType && MarkOff < Text.length())
+    {
+      if (!IsFirstMark)
+        rOutput += ',';
+      IsFirstMark = false;
+      rOutput += "{\"type\":\"";
+      rOutput += MarkType < sizeof(s_MarkTypes) / sizeof(*s_MarkTypes) ? s_MarkTypes[MarkType] : s_MarkTypes[0];
+      rOutput += "\",\"offset\":";
+      rOutput += std::to_string(MarkOff);
+      rOutput += ",\"length\":";
+      rOutput += std::to_string(rMark.GetLength());
+      rOutput += '}';
+    }
+    MarkOff += rMark.GetLength();
+  }
+
+  rOutput += "]}\n";
+}
+
+void ListingExporter::_AppendJsonString(TextView const& rText, std::string& rOutput)
+{
+  static char const s_HexDigits[] = "0123456789abcdef";
+
+  rOutput += '"';
+  for (char CurChr : rText)
+  {
+    switch (CurChr)
+    {
+    case '"':  rOutput += "\\\""; break;
+    case '\\': rOutput += "\\\\"; break;
+    case '\n': rOutput += "\\n";  break;
+    case '\r': rOutput += "\\r";  break;
+    case '\t': rOutput += "\\t";  break;
+    default:
+      // Texts aren't guaranteed to be UTF-8 (e.g. characters of a string cell), so bytes above ASCII are escaped too
+      if (static_cast<u8>(CurChr) < 0x20 || static_cast<u8>(CurChr) >= 0x80)
+      {
+        rOutput += "\\u00";
+        rOutput += s_HexDigits[static_cast<u8>(CurChr) >> 4];
+        rOutput += s_HexDigits[static_cast<u8>(CurChr) & 0xf];
+      }
+      else
+        rOutput += CurChr;
+      break;
+    }
+  }
+  rOutput += '"';
+}
@@ -3,7 +3,6 @@
 MEDUSA_NAMESPACE_BEGIN
 
 LogWrapper::MutexType      LogWrapper::m_Mutex;
-Log::LogMap                Log::m_LogMap;
 LogWrapper::LoggerCallback Log::m_pLog;
 
 template<> LogWrapper& LogWrapper::operator<<(s8 Value)
@@ -78,7 +77,10 @@ LogWrapper& LogEnd(LogWrapper &rLogWrapper)
 
 LogWrapper Log::Write(std::string const& rType)
 {
-  return LogWrapper(Log::m_pLog, rType, Log::m_LogMap[rType]);
+  // Messages are built in several statements, so each thread needs its own buffers
+  typedef std::map<std::string, std::string> LogMap;
+  static thread_local LogMap s_LogMap;
+  return LogWrapper(Log::m_pLog, rType, s_LogMap[rType]);
 }
 
 MEDUSA_NAMESPACE_END
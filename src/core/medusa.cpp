@@ -3,6 +3,7 @@
 #include "medusa/module.hpp"
 #include "medusa/xref.hpp"
 #include "medusa/log.hpp"
+#include "medusa/stream_analyzer.hpp"
 #include "medusa/user_configuration.hpp"
 
 #include <cstring>
@@ -14,7 +15,21 @@
 MEDUSA_NAMESPACE_BEGIN
 
 Medusa::Medusa(void)
-  : m_TaskManager([] (Task const* pTask) { Log::Write("core") << "Task \"" << pTask->GetName() << "\" is done" << LogEnd; })
+  : m_TaskManager([this] (Task const* pTask, u8 Status)
+  {
+    // Subscribers see the whole result of a task as soon as it's done
+    if (Status != Task::Started)
+      m_Document.GetChangeJournal().Flush();
+    m_Document.NotifyTaskUpdated(pTask->GetName(), Status);
+
+    switch (Status)
+    {
+    case Task::Done:      Log::Write("core") << "Task \"" << pTask->GetName() << "\" is done"      << LogEnd; break;
+    case Task::Cancelled: Log::Write("core") << "Task \"" << pTask->GetName() << "\" is cancelled" << LogEnd; break;
+    case Task::TimedOut:  Log::Write("core") << "Task \"" << pTask->GetName() << "\" timed out"    << LogEnd; break;
+    default:              break;
+    }
+  })
   , m_Document()
   , m_Analyzer()
 {
@@ -53,6 +68,22 @@ void Medusa::AddTask(Task* pTask)
 void Medusa::WaitForTasks(void)
 {
   m_TaskManager.Wait();
+  m_Document.GetChangeJournal().Flush();
+}
+
+void Medusa::CancelTasks(void)
+{
+  m_TaskManager.CancelAllTasks();
+}
+
+void Medusa::SetTasksTimeout(u32 Timeout)
+{
+  m_TaskManager.SetTimeout(std::chrono::seconds(Timeout));
+}
+
+bool Medusa::GetTaskProgress(std::string& rName, u64& rDone, u64& rTotal) const
+{
+  return m_TaskManager.GetCurrentTaskProgress(rName, rDone, rTotal);
 }
 
 bool Medusa::Start(
@@ -84,6 +115,15 @@ bool Medusa::Start(
   /* Map the file to the document */
   spLoader->Map(m_Document, spArchitectures); // Should it be async?
 
+  /* Large images are analyzed by windows, results are written to the database as they're found */
+  if (spLoader->IsStreaming())
+  {
+    auto pStrmAnlz = new StreamAnalyzer(m_Document, spDatabase, spArchitectures.front());
+    pStrmAnlz->Configure(spLoader->GetConfigurationModel());
+    AddTask(pStrmAnlz);
+    return true;
+  }
+
   /* Try to define functions and structures if possible */
   if (spOperatingSystem)
   {
@@ -94,12 +134,21 @@ bool Medusa::Start(
   /* Disassemble the file with the default analyzer */
   AddTask(m_Analyzer.CreateDisassembleAllFunctionsTask(m_Document));
 
+  /* Follow indirect jumps which dispatch through a table (e.g. switch) */
+  AddTask(m_Analyzer.CreateResolveJumpTablesTask(m_Document));
+
   /* Analyze the stack for each functions */
   AddTask(m_Analyzer.CreateAnalyzeStackAllFunctionsTask(m_Document));
 
   /* Find all strings using the previous analyze */
   AddTask(m_Analyzer.CreateFindAllStringTask(m_Document));
 
+  /* Name known functions if the user provides signatures */
+  UserConfiguration UserCfg;
+  auto SigPath = UserCfg.GetOption("core.signatures_path");
+  if (!SigPath.empty())
+    ApplySignatures(SigPath);
+
   /* Analyze all functions */
   if (spOperatingSystem)
   {
@@ -305,6 +354,9 @@ bool Medusa::OpenDocument(AskDatabaseFunctionType AskDatabase)
 
 bool Medusa::CloseDocument(void)
 {
+  // The running task must leave Run before the document it works on is emptied
+  m_TaskManager.CancelAllTasks();
+  m_TaskManager.Wait();
   m_Document.RemoveAll();
   return true;
 }
@@ -339,6 +391,15 @@ void Medusa::Analyze(Address const& rAddr, Architecture::SPType spArch, u8 Mode)
     Mode = spArch->GetDefaultMode(rAddr);
 
   AddTask(m_Analyzer.CreateDisassembleTask(m_Document, rAddr, *spArch, Mode));
+
+  Address::List ModifiedAddresses;
+  ModifiedAddresses.push_back(rAddr);
+  Reanalyze(ModifiedAddresses);
+}
+
+void Medusa::Reanalyze(Address::List const& rModifiedAddresses)
+{
+  AddTask(m_Analyzer.CreateReanalyzeTask(m_Document, rModifiedAddresses));
 }
 
 bool Medusa::BuildControlFlowGraph(Address const& rAddr, ControlFlowGraph& rCfg) const
@@ -412,4 +473,14 @@ bool Medusa::CreateFunction(Address const& rAddr)
   return true;
 }
 
+bool Medusa::ApplySignatures(Path const& rSignaturePath)
+{
+  auto spSigDb = std::make_shared<SignatureDatabase>();
+  if (!spSigDb->Load(rSignaturePath))
+    return false;
+
+  AddTask(m_Analyzer.CreateApplySignaturesTask(m_Document, spSigDb));
+  return true;
+}
+
 MEDUSA_NAMESPACE_END
@@ -4,6 +4,8 @@
 #include "medusa/instruction.hpp"
 #include "medusa/character.hpp"
 
+#include <algorithm>
+
 #include <boost/format.hpp>
 
 MEDUSA_NAMESPACE_BEGIN
@@ -24,6 +26,45 @@ MemoryArea::~MemoryArea(void)
 {
 }
 
+void MemoryArea::ForEachCellDataInRange(TOffset BeginOffset, TOffset EndOffset, CellDataRangePredicat Predicat) const
+{
+  TOffset CurOff = BeginOffset;
+
+  // Only the first offset can be inside a cell which starts before the range
+  if (GetCellData(CurOff) == nullptr)
+  {
+    Address PrevAddr;
+    if (GetNearestAddress(MakeAddress(CurOff), PrevAddr))
+    {
+      auto spPrevCellData = GetCellData(PrevAddr.GetOffset());
+      if (spPrevCellData != nullptr)
+      {
+        TOffset PrevEndOff = PrevAddr.GetOffset() + std::max<u16>(spPrevCellData->GetLength(), 1);
+        if (PrevEndOff > CurOff)
+        {
+          if (!Predicat(PrevAddr.GetOffset(), spPrevCellData))
+            return;
+          CurOff = PrevEndOff;
+        }
+      }
+    }
+  }
+
+  while (CurOff < EndOffset)
+  {
+    auto spCellData = GetCellData(CurOff);
+    if (spCellData == nullptr)
+    {
+      ++CurOff;
+      continue;
+    }
+
+    if (!Predicat(CurOff, spCellData))
+      return;
+    CurOff += std::max<u16>(spCellData->GetLength(), 1);
+  }
+}
+
 MappedMemoryArea::~MappedMemoryArea(void)
 {
   m_Cells.clear();
@@ -121,6 +162,8 @@ bool MappedMemoryArea::SetCellData(TOffset Offset, CellData::SPType spCellData,
   }
 
   m_Cells[CellOffset] = spCellData;
+  if (spCellData->GetLength() > m_MaxCellLength)
+    m_MaxCellLength = spCellData->GetLength();
   ++CellOffset;
   for (; CellOffset < NewSize; ++CellOffset)
     m_Cells[CellOffset] = nullptr;
@@ -329,10 +372,12 @@ bool MappedMemoryArea::ConvertOffsetToFileOffset(TOffset Offset, TOffset& rFileO
   return true;
 }
 
-// OPTIMIZEME: This function could be very time consumming (use deque?)
+// Only the previous cell which could overlap Offset is looked for, so undefined bytes
+// far from any cell don't scan the whole memory area
 bool MappedMemoryArea::_GetPreviousCellOffset(TOffset Offset, TOffset& rPreviousOffset) const
 {
-  while (Offset != 0x0)
+  TOffset LimitOffset = (Offset > m_MaxCellLength) ? Offset - m_MaxCellLength : 0x0;
+  while (Offset != LimitOffset)
   {
     --Offset;
     if (m_Cells[Offset] != nullptr)
@@ -345,6 +390,92 @@ bool MappedMemoryArea::_GetPreviousCellOffset(TOffset Offset, TOffset& rPrevious
   return false;
 }
 
+static std::string MakeBankName(std::string const& rPrefix, TBank Bank)
+{
+  return (boost::format("%s%02x") % rPrefix % Bank).str();
+}
+
+BankedMemoryArea::BankedMemoryArea(
+  std::string const& rPrefix,
+  TOffset FileOffset, u32 BankSize,
+  Address const& rWindowBase, TBank BankNo,
+  u32 Access,
+  Tag DefaultArchitectureTag,
+  u8 DefaultArchitectureMode)
+  : MappedMemoryArea(
+    MakeBankName(rPrefix, rWindowBase.GetBase()),
+    FileOffset + rWindowBase.GetBase() * BankSize, BankSize,
+    rWindowBase, BankSize,
+    Access, DefaultArchitectureTag, DefaultArchitectureMode)
+  , m_Prefix(rPrefix)
+  , m_BankFileOffset(FileOffset)
+  , m_BankNo(BankNo)
+{
+}
+
+BankedMemoryArea::~BankedMemoryArea(void)
+{
+}
+
+std::string BankedMemoryArea::Dump(void) const
+{
+  char Buf[4];
+  Buf[0] = (m_Access & MemoryArea::Read)    ? 'R' : '-';
+  Buf[1] = (m_Access & MemoryArea::Write)   ? 'W' : '-';
+  Buf[2] = (m_Access & MemoryArea::Execute) ? 'X' : '-';
+  Buf[3] = '\0';
+
+  std::ostringstream oss;
+  oss << std::hex << std::showbase;
+  oss << "ma(b " << m_Prefix << " " << m_BankFileOffset << " " << m_VirtualSize << " " << m_VirtualBase.Dump() << " " << m_BankNo << " " << Buf;
+  for (auto const& rBankReg : m_BankRegs)
+    oss << " " << rBankReg.m_Begin << " " << rBankReg.m_End << " " << static_cast<u16>(rBankReg.m_Shift) << " " << rBankReg.m_Mask << " " << rBankReg.m_ZeroIsOne;
+  oss << ")";
+  return oss.str();
+}
+
+bool BankedMemoryArea::SelectBank(TOffset Offset, u64 Value, TBank& rBank) const
+{
+  for (auto const& rBankReg : m_BankRegs)
+  {
+    if (Offset < rBankReg.m_Begin || Offset >= rBankReg.m_End)
+      continue;
+
+    u32 Bits = static_cast<u32>(Value) & rBankReg.m_Mask;
+    if (Bits == 0 && rBankReg.m_ZeroIsOne)
+      Bits = 1;
+    u32 Bank = (rBank & ~(static_cast<u32>(rBankReg.m_Mask) << rBankReg.m_Shift)) | (Bits << rBankReg.m_Shift);
+
+    // Unused lines of the bank number are not wired, so the selected bank wraps
+    rBank = static_cast<TBank>(m_BankNo != 0 ? Bank % m_BankNo : Bank);
+    return true;
+  }
+
+  return false;
+}
+
+Address BankedMemoryArea::ResolveAddress(Address const& rAddress, TBank Bank) const
+{
+  if (rAddress.GetAddressingType() != m_VirtualBase.GetAddressingType())
+    return rAddress;
+
+  TBank ResBank = IsInWindow(rAddress.GetOffset()) ? Bank : 0;
+  return Address(rAddress.GetAddressingType(), ResBank, rAddress.GetOffset(), rAddress.GetBaseSize(), rAddress.GetOffsetSize());
+}
+
+MemoryArea* BankedMemoryArea::MakeBankMemoryArea(TBank Bank) const
+{
+  if (Bank == GetDefaultBank() || Bank >= m_BankNo)
+    return nullptr;
+
+  Address BankBase(m_VirtualBase.GetAddressingType(), Bank, m_VirtualBase.GetOffset(), m_VirtualBase.GetBaseSize(), m_VirtualBase.GetOffsetSize());
+  return new MappedMemoryArea(
+    MakeBankName(m_Prefix, Bank),
+    m_BankFileOffset + Bank * m_VirtualSize, m_VirtualSize,
+    BankBase, m_VirtualSize,
+    m_Access, m_DefaultArchitectureTag, m_DefaultArchitectureMode);
+}
+
 VirtualMemoryArea::~VirtualMemoryArea(void)
 {
 }
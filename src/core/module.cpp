@@ -1,23 +1,32 @@
 #include "medusa/module.hpp"
 #include "medusa/log.hpp"
+#include "medusa/util.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <memory>
 
 #include <boost/filesystem.hpp>
 
 MEDUSA_NAMESPACE_BEGIN
 
-void ModuleManager::LoadDatabases(boost::filesystem::path const& rModPath)
+bool ModuleManager::RegisterModules(Path const& rModPath)
 {
+  std::lock_guard<MutexType> Lock(m_Mutex);
   try
   {
-    const boost::filesystem::path CurDir = rModPath;
-    Module Module;
+    auto const ModDir = boost::filesystem::system_complete(rModPath);
+    if (m_ModulePaths.find(ModDir) != std::end(m_ModulePaths))
+      return true;
 
-    Log::Write("core") << "Module directory: " << boost::filesystem::system_complete(CurDir) << LogEnd;
+    Log::Write("core") << "Module directory: " << ModDir << LogEnd;
+
+    auto StartTime = std::chrono::steady_clock::now();
+    Module Module;
+    ModuleDescriptorVector NewDescs;
 
     boost::filesystem::directory_iterator End;
-    for (boost::filesystem::directory_iterator It(CurDir);
+    for (boost::filesystem::directory_iterator It(ModDir);
       It != End; ++It)
     {
       auto const& rFilename = It->path().string();
@@ -35,164 +44,201 @@ void ModuleManager::LoadDatabases(boost::filesystem::path const& rModPath)
         continue;
       }
 
-      TGetArchitecture pGetArchitecture = Module.Load<TGetArchitecture>(pMod, "GetArchitecture");
-      if (pGetArchitecture != nullptr)
-      {
-        Log::Write("core") << "is an architecture" << LogEnd;
+      auto ModDesc   = ModuleDescriptor();
+      ModDesc.m_Path = FullPath;
+      ModDesc.m_Name = It->path().stem().string();
 
-        Architecture* pArchitecture = pGetArchitecture();
-        Architecture::SPType ArchitecturePtr(pArchitecture);
-        m_Architectures.push_back(ArchitecturePtr);
-        continue;
-      }
+      if ((ModDesc.m_pGetLoader = Module.Load<TGetLoader>(pMod, "GetLoader")) != nullptr)
+        Log::Write("core") << "is a loader" << LogEnd;
 
-      TGetOperatingSystem pGetOperatingSystem = Module.Load<TGetOperatingSystem>(pMod, "GetOperatingSystem");
-      if (pGetOperatingSystem != nullptr)
-      {
-        Log::Write("core") << "is an operating system" << LogEnd;
+      else if ((ModDesc.m_pGetArchitecture = Module.Load<TGetArchitecture>(pMod, "GetArchitecture")) != nullptr)
+        Log::Write("core") << "is an architecture" << LogEnd;
 
-        OperatingSystem* pOperatingSystem = pGetOperatingSystem();
-        OperatingSystem::SPType spOperatingSystem(pOperatingSystem);
-        m_OperatingSystems.push_back(spOperatingSystem);
-        continue;
-      }
+      else if ((ModDesc.m_pGetOperatingSystem = Module.Load<TGetOperatingSystem>(pMod, "GetOperatingSystem")) != nullptr)
+        Log::Write("core") << "is an operating system" << LogEnd;
 
-      TGetEmulator pGetEmulator = Module.Load<TGetEmulator>(pMod, "GetEmulator");
-      if (pGetEmulator != nullptr)
+      // Emulators and databases are looked up by name, it's only known by an instance
+      else if ((ModDesc.m_pGetEmulator = Module.Load<TGetEmulator>(pMod, "GetEmulator")) != nullptr)
       {
         Log::Write("core") << "is an emulator" << LogEnd;
-
-        Emulator* pEmulator = pGetEmulator(nullptr, nullptr, nullptr);
-        m_Emulators[pEmulator->GetName()] = pGetEmulator;
-        delete pEmulator;
-        continue;
+        std::unique_ptr<Emulator> upEmulator(ModDesc.m_pGetEmulator(nullptr, nullptr, nullptr));
+        ModDesc.m_Name = upEmulator->GetName();
       }
 
-      TGetDatabase pGetDatabase = Module.Load<TGetDatabase>(pMod, "GetDatabase");
-      if (pGetDatabase != nullptr)
+      else if ((ModDesc.m_pGetDatabase = Module.Load<TGetDatabase>(pMod, "GetDatabase")) != nullptr)
       {
         Log::Write("core") << "is a database" << LogEnd;
+        std::unique_ptr<Database> upDatabase(ModDesc.m_pGetDatabase());
+        ModDesc.m_Name = upDatabase->GetName();
+      }
 
-        Database* pDatabase = pGetDatabase();
-        Database::SPType spDatabase(pDatabase);
-        m_Databases.push_back(spDatabase);
+      else
+      {
+        Log::Write("core") << "is unknown (ignored)" << LogEnd;
         continue;
       }
 
-      Log::Write("core") << "is unknown (ignored)" << LogEnd;
+      NewDescs.push_back(ModDesc);
     }
+
+    // The directory order is not specified, modules are sorted to always select the same ones
+    std::sort(std::begin(NewDescs), std::end(NewDescs), [](ModuleDescriptor const& rDesc0, ModuleDescriptor const& rDesc1)
+    {
+      return rDesc0.m_Path < rDesc1.m_Path;
+    });
+    m_Descriptors.insert(std::end(m_Descriptors), std::begin(NewDescs), std::end(NewDescs));
+    m_ModulePaths.insert(ModDir);
+
+    Log::Write("core")
+      << "registered " << NewDescs.size() << " module(s) in "
+      << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count() << "ms"
+      << LogEnd;
+    return true;
   }
   catch (std::exception &e)
   {
     Log::Write("core") << e.what() << LogEnd;
   }
+  return false;
 }
 
-void ModuleManager::LoadModules(boost::filesystem::path const& rModPath, BinaryStream const& rBinStrm)
+ModuleManager::ModuleDescriptorVector ModuleManager::GetModuleDescriptors(void) const
 {
-  try
-  {
-    const boost::filesystem::path CurDir = rModPath;
-    Module Module;
-
-    Log::Write("core") << "Module directory: " << boost::filesystem::system_complete(CurDir) << LogEnd;
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  return m_Descriptors;
+}
 
-    boost::filesystem::directory_iterator End;
-    for (boost::filesystem::directory_iterator It(CurDir);
-      It != End; ++It)
+Loader::VSPType ModuleManager::ProbeLoaders(BinaryStream const& rBinStrm) const
+{
+  std::vector<TGetLoader> LdrFactories;
+  for (auto const& rModDesc : GetModuleDescriptors())
+    if (rModDesc.m_pGetLoader != nullptr)
+      LdrFactories.push_back(rModDesc.m_pGetLoader);
+
+  // A loader which fails to probe the stream must not prevent the others
+  std::vector<Loader::SPType> ProbedLdrs(LdrFactories.size());
+  ParallelFor(LdrFactories.size(), [&](size_t Begin, size_t End)
+  {
+    for (size_t LdrIdx = Begin; LdrIdx < End; ++LdrIdx)
     {
-      auto const& rFilename = It->path().string();
-
-      if (rFilename.substr(rFilename.find_last_of(".") + 1) != Module::GetExtension())
-        continue;
-
-      auto FullPath = boost::filesystem::system_complete(*It).string();
-      Log::Write("core") << "Module: \"" << rFilename << "\" ";
-
-      void* pMod = Module.Load(FullPath);
-      if (pMod == nullptr)
+      try
       {
-        Log::Write("core") << "can't be loaded" << LogEnd;
-        continue;
+        Loader::SPType spLdr(LdrFactories[LdrIdx]());
+        if (spLdr->IsCompatible(rBinStrm))
+          ProbedLdrs[LdrIdx] = spLdr;
       }
-
-      TGetLoader pGetLoader = Module.Load<TGetLoader>(pMod, "GetLoader");
-      if (pGetLoader != nullptr)
+      catch (Exception&)
       {
-        Log::Write("core") << "is a loader ";
-
-        Loader* pLoader = pGetLoader();
-        if (pLoader->IsCompatible(rBinStrm))
-        {
-          Loader::SPType LoaderPtr(pLoader);
-          m_Loaders.push_back(LoaderPtr);
-          Log::Write("core") << "(loaded)" << LogEnd;
-        }
-        else
-        {
-          Log::Write("core") << "(unloaded)" << LogEnd;
-          delete pLoader;
-        }
-        continue;
       }
-
-      TGetArchitecture pGetArchitecture = Module.Load<TGetArchitecture>(pMod, "GetArchitecture");
-      if (pGetArchitecture != nullptr)
+      catch (std::exception&)
       {
-        Log::Write("core") << "is an architecture" << LogEnd;
-
-        Architecture* pArchitecture = pGetArchitecture();
-        Architecture::SPType ArchitecturePtr(pArchitecture);
-        m_Architectures.push_back(ArchitecturePtr);
-        continue;
       }
+    }
+  });
 
-      TGetOperatingSystem pGetOperatingSystem = Module.Load<TGetOperatingSystem>(pMod, "GetOperatingSystem");
-      if (pGetOperatingSystem != nullptr)
-      {
-        Log::Write("core") << "is an operating system" << LogEnd;
-
-        OperatingSystem* pOperatingSystem = pGetOperatingSystem();
-        OperatingSystem::SPType spOperatingSystem(pOperatingSystem);
-        m_OperatingSystems.push_back(spOperatingSystem);
-        continue;
-      }
+  Loader::VSPType CompatLdrs;
+  for (auto const& rspLdr : ProbedLdrs)
+    if (rspLdr != nullptr)
+      CompatLdrs.push_back(rspLdr);
 
-      TGetEmulator pGetEmulator = Module.Load<TGetEmulator>(pMod, "GetEmulator");
-      if (pGetEmulator != nullptr)
-      {
-        Log::Write("core") << "is an emulator" << LogEnd;
+  std::stable_sort(std::begin(CompatLdrs), std::end(CompatLdrs), [](Loader::SPType spLdr0, Loader::SPType spLdr1)
+  {
+    return spLdr0->GetDepth() > spLdr1->GetDepth();
+  });
+  return CompatLdrs;
+}
 
-        Emulator* pEmulator = pGetEmulator(nullptr, nullptr, nullptr);
-        m_Emulators[pEmulator->GetName()] = pGetEmulator;
-        delete pEmulator;
-        continue;
-      }
+Architecture::VSPType ModuleManager::MakeArchitectures(void) const
+{
+  Architecture::VSPType Archs;
+  for (auto const& rModDesc : GetModuleDescriptors())
+    if (rModDesc.m_pGetArchitecture != nullptr)
+      Archs.push_back(Architecture::SPType(rModDesc.m_pGetArchitecture()));
+  return Archs;
+}
 
-      TGetDatabase pGetDatabase = Module.Load<TGetDatabase>(pMod, "GetDatabase");
-      if (pGetDatabase != nullptr)
-      {
-        Log::Write("core") << "is a database" << LogEnd;
+Database::SPType ModuleManager::MakeDatabase(std::string const& rDatabaseName) const
+{
+  for (auto const& rModDesc : GetModuleDescriptors())
+    if (rModDesc.m_pGetDatabase != nullptr && rModDesc.m_Name == rDatabaseName)
+      return Database::SPType(rModDesc.m_pGetDatabase());
+  return Database::SPType();
+}
 
-        Database* pDatabase = pGetDatabase();
-        Database::SPType spDatabase(pDatabase);
-        m_Databases.push_back(spDatabase);
-        continue;
-      }
+Database::VSPType ModuleManager::MakeDatabases(void) const
+{
+  Database::VSPType Dbs;
+  for (auto const& rModDesc : GetModuleDescriptors())
+    if (rModDesc.m_pGetDatabase != nullptr)
+      Dbs.push_back(Database::SPType(rModDesc.m_pGetDatabase()));
+  return Dbs;
+}
 
-      Log::Write("core") << "is unknown (ignored)" << LogEnd;
-    }
+OperatingSystem::SPType ModuleManager::MakeOperatingSystem(Loader::SPType spLdr, Architecture::SPType spArch) const
+{
+  for (auto const& rModDesc : GetModuleDescriptors())
+  {
+    if (rModDesc.m_pGetOperatingSystem == nullptr)
+      continue;
+    OperatingSystem::SPType spOs(rModDesc.m_pGetOperatingSystem());
+    if (spOs->IsSupported(*spLdr, *spArch))
+      return spOs;
   }
-  catch (std::exception &e)
+  return OperatingSystem::SPType();
+}
+
+bool ModuleManager::ShareModules(Path const& rModPath)
+{
+  if (!RegisterModules(rModPath))
+    return false;
+  _InstantiateModules();
+
+  for (auto const& rspArch : m_Architectures)
+    if (!RegisterArchitecture(rspArch))
+      Log::Write("core") << "unable to register architecture " << rspArch->GetName() << LogEnd;
+  return true;
+}
+
+void ModuleManager::_InstantiateModules(void)
+{
+  if (m_Instantiated)
+    return;
+
+  for (auto const& rModDesc : GetModuleDescriptors())
   {
-    Log::Write("core") << e.what() << LogEnd;
+    if (rModDesc.m_pGetArchitecture != nullptr)
+      m_Architectures.push_back(Architecture::SPType(rModDesc.m_pGetArchitecture()));
+    else if (rModDesc.m_pGetOperatingSystem != nullptr)
+      m_OperatingSystems.push_back(OperatingSystem::SPType(rModDesc.m_pGetOperatingSystem()));
+    else if (rModDesc.m_pGetEmulator != nullptr)
+      m_Emulators[rModDesc.m_Name] = rModDesc.m_pGetEmulator;
+    else if (rModDesc.m_pGetDatabase != nullptr)
+      m_Databases.push_back(Database::SPType(rModDesc.m_pGetDatabase()));
   }
+  m_Instantiated = true;
+}
 
-  if (!m_Loaders.empty())
-    std::sort(std::begin(m_Loaders), std::end(m_Loaders), [](Loader::SPType spLdr0, Loader::SPType spLdr1)
-        {
-          return spLdr0->GetDepth() > spLdr1->GetDepth();
-        });
+void ModuleManager::LoadDatabases(boost::filesystem::path const& rModPath)
+{
+  if (!RegisterModules(rModPath))
+    return;
+  _InstantiateModules();
+}
+
+void ModuleManager::LoadModules(boost::filesystem::path const& rModPath, BinaryStream const& rBinStrm)
+{
+  if (!RegisterModules(rModPath))
+    return;
+  _InstantiateModules();
+
+  auto StartTime = std::chrono::steady_clock::now();
+  m_Loaders = ProbeLoaders(rBinStrm);
+  for (auto const& rspLdr : m_Loaders)
+    Log::Write("core") << "Loader: \"" << rspLdr->GetName() << "\" is compatible" << LogEnd;
+  Log::Write("core")
+    << "probed loaders in "
+    << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count() << "ms"
+    << LogEnd;
 }
 
 void ModuleManager::UnloadModules(void)
@@ -203,6 +249,7 @@ void ModuleManager::UnloadModules(void)
   m_Databases.clear();
   m_OperatingSystems.clear();
   m_Emulators.clear();
+  m_Instantiated = false;
 }
 
 Architecture::SPType ModuleManager::GetArchitecture(Tag ArchTag) const
@@ -231,6 +278,11 @@ Architecture::SPType ModuleManager::FindArchitecture(Tag ArchTag) const
 
 bool ModuleManager::RegisterArchitecture(Architecture::SPType spArch)
 {
+  // Documents register their architectures, an id must not be taken twice by the same one
+  auto itArch = m_TaggedArchitectures.find(spArch->GetTag());
+  if (itArch != std::end(m_TaggedArchitectures) && itArch->second == spArch)
+    return true;
+
   u8 Id = 0;
   bool FoundId = false;
 
@@ -314,4 +366,44 @@ Architecture::VSPType ModuleManager::GetArchitectures(void) const
   return m_Architectures;
 }
 
+/* batch session */
+
+BatchSession::BatchSession(Path const& rModPath)
+  : m_ModPath(rModPath)
+  , m_Ready(ModuleManager::Instance().ShareModules(rModPath))
+{
+}
+
+bool BatchSession::SelectModules(BinaryStream const& rBinStrm,
+  Loader::SPType& rspLoader, Architecture::VSPType& rArchitectures, OperatingSystem::SPType& rspOperatingSystem) const
+{
+  auto& rModMgr = ModuleManager::Instance();
+
+  // A generic loader could be the only one to support an architecture
+  for (auto const& rspLdr : ProbeLoaders(rBinStrm))
+  {
+    auto Archs = rModMgr.GetArchitectures();
+    rspLdr->FilterAndConfigureArchitectures(Archs);
+    if (Archs.empty())
+      continue;
+
+    rspLoader          = rspLdr;
+    rArchitectures     = Archs;
+    rspOperatingSystem = rModMgr.GetOperatingSystem(rspLdr, Archs.front());
+    return true;
+  }
+
+  return false;
+}
+
+Loader::VSPType BatchSession::ProbeLoaders(BinaryStream const& rBinStrm) const
+{
+  return ModuleManager::Instance().ProbeLoaders(rBinStrm);
+}
+
+Database::SPType BatchSession::MakeDatabase(std::string const& rDatabaseName) const
+{
+  return ModuleManager::Instance().MakeDatabase(rDatabaseName);
+}
+
 MEDUSA_NAMESPACE_END
@@ -0,0 +1,264 @@
+#include "medusa/overview.hpp"
+#include "medusa/document.hpp"
+#include "medusa/memory_area.hpp"
+#include "medusa/util.hpp"
+
+#include <algorithm>
+
+MEDUSA_NAMESPACE_USE;
+
+void Overview::Bucket::Clear(void)
+{
+  std::fill(std::begin(m_Sizes), std::end(m_Sizes), 0);
+}
+
+u64 Overview::Bucket::GetSize(void) const
+{
+  u64 Size = 0;
+  for (auto CurSize : m_Sizes)
+    Size += CurSize;
+  return Size;
+}
+
+u8 Overview::Bucket::GetMainCellType(void) const
+{
+  auto itMax = std::max_element(std::begin(m_Sizes), std::end(m_Sizes));
+  if (*itMax == 0)
+    return Cell::CellType;
+  return static_cast<u8>(itMax - std::begin(m_Sizes));
+}
+
+bool Overview::Bucket::operator==(Bucket const& rBucket) const
+{
+  return std::equal(std::begin(m_Sizes), std::end(m_Sizes), std::begin(rBucket.m_Sizes));
+}
+
+Overview::Overview(Document const& rDoc, u32 BucketNo)
+  : m_rDoc(rDoc)
+  , m_BucketNo(BucketNo ? BucketNo : DefaultBucketNo)
+  , m_BucketSize(1)
+  , m_IsBuilt(false)
+{
+}
+
+void Overview::Invalidate(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  m_IsBuilt = false;
+}
+
+void Overview::Update(Address::List const& rAddresses)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!m_IsBuilt)
+    return;
+
+  for (auto const& rAddr : rAddresses)
+  {
+    u64 Pos;
+    if (!_ConvertAddressToPosition(rAddr, Pos))
+      continue;
+
+    // The cell could cover the following buckets
+    auto const* pMemArea = m_rDoc.GetMemoryArea(rAddr);
+    auto spCellData = (pMemArea != nullptr) ? pMemArea->GetCellData(rAddr.GetOffset()) : CellData::SPType();
+    u64 CellLen = (spCellData != nullptr && spCellData->GetLength() != 0) ? spCellData->GetLength() : 1;
+    u64 LastPos = Pos + CellLen - 1;
+
+    for (u64 BktIdx = Pos / m_BucketSize; BktIdx <= LastPos / m_BucketSize && BktIdx < m_Buckets.size(); ++BktIdx)
+      m_DirtyBuckets.insert(static_cast<u32>(BktIdx));
+  }
+}
+
+void Overview::SetNumberOfBuckets(u32 BucketNo)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (BucketNo == 0 || BucketNo == m_BucketNo)
+    return;
+  m_BucketNo = BucketNo;
+  m_IsBuilt  = false;
+}
+
+u32 Overview::GetNumberOfBuckets(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!_Prepare())
+    return 0;
+  return static_cast<u32>(m_Buckets.size());
+}
+
+bool Overview::GetBucket(u32 BucketIndex, Bucket& rBucket)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!_Prepare())
+    return false;
+  if (BucketIndex >= m_Buckets.size())
+    return false;
+  rBucket = m_Buckets[BucketIndex];
+  return true;
+}
+
+void Overview::GetChangedBuckets(std::vector<u32>& rBucketIndexes)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  rBucketIndexes.clear();
+  if (!_Prepare())
+    return;
+  rBucketIndexes.assign(std::begin(m_ChangedBuckets), std::end(m_ChangedBuckets));
+  m_ChangedBuckets.clear();
+}
+
+Overview::Bucket Overview::GetStatistics(void)
+{
+  Bucket Stats;
+
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!_Prepare())
+    return Stats;
+  for (auto const& rBkt : m_Buckets)
+    for (u8 CellType = 0; CellType < CellTypeNo; ++CellType)
+      Stats.m_Sizes[CellType] += rBkt.m_Sizes[CellType];
+  return Stats;
+}
+
+bool Overview::ConvertAddressToBucket(Address const& rAddress, u32& rBucketIndex)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!_Prepare())
+    return false;
+
+  u64 Pos;
+  if (!_ConvertAddressToPosition(rAddress, Pos))
+    return false;
+  rBucketIndex = static_cast<u32>(std::min<u64>(Pos / m_BucketSize, m_Buckets.size() - 1));
+  return true;
+}
+
+bool Overview::ConvertBucketToAddress(u32 BucketIndex, Address& rAddress)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!_Prepare())
+    return false;
+  if (BucketIndex >= m_Buckets.size())
+    return false;
+
+  u64 Pos = static_cast<u64>(BucketIndex) * m_BucketSize;
+  for (auto const& rArea : m_Areas)
+  {
+    if (Pos >= rArea.m_Position + rArea.m_Size)
+      continue;
+
+    // If the bucket starts inside a cell, the cell is returned
+    TOffset Off = rArea.m_BaseOffset + (Pos > rArea.m_Position ? Pos - rArea.m_Position : 0);
+    if (!rArea.m_pMemArea->GetNearestAddress(rArea.m_pMemArea->MakeAddress(Off), rAddress))
+      rAddress = rArea.m_pMemArea->MakeAddress(Off);
+    return true;
+  }
+  return false;
+}
+
+bool Overview::_Prepare(void)
+{
+  if (!m_IsBuilt)
+    _Build();
+
+  for (u32 BktIdx : m_DirtyBuckets)
+  {
+    Bucket NewBkt;
+    _CountBucket(BktIdx, NewBkt);
+    if (NewBkt == m_Buckets[BktIdx])
+      continue;
+    m_Buckets[BktIdx] = NewBkt;
+    m_ChangedBuckets.insert(BktIdx);
+  }
+  m_DirtyBuckets.clear();
+
+  return !m_Buckets.empty();
+}
+
+void Overview::_Build(void)
+{
+  m_Areas.clear();
+  m_DirtyBuckets.clear();
+  m_ChangedBuckets.clear();
+
+  u64 TotalSize = 0;
+  m_rDoc.ForEachMemoryArea([&](MemoryArea const& rMemArea)
+  {
+    Area CurArea = { &rMemArea, rMemArea.GetBaseAddress().GetOffset(), rMemArea.GetSize(), TotalSize };
+    if (CurArea.m_Size == 0)
+      return;
+    m_Areas.push_back(CurArea);
+    TotalSize += CurArea.m_Size;
+  });
+
+  // A document smaller than the number of buckets gets one byte per bucket
+  m_BucketSize = std::max<u64>((TotalSize + m_BucketNo - 1) / m_BucketNo, 1);
+  u32 BktNo = static_cast<u32>((TotalSize + m_BucketSize - 1) / m_BucketSize);
+
+  m_Buckets.assign(BktNo, Bucket());
+  ParallelFor(BktNo, [&](size_t Begin, size_t End)
+  {
+    for (size_t BktIdx = Begin; BktIdx < End; ++BktIdx)
+      _CountBucket(static_cast<u32>(BktIdx), m_Buckets[BktIdx]);
+  });
+
+  for (u32 BktIdx = 0; BktIdx < BktNo; ++BktIdx)
+    m_ChangedBuckets.insert(BktIdx);
+
+  m_IsBuilt = true;
+}
+
+void Overview::_CountBucket(u32 BucketIndex, Bucket& rBucket) const
+{
+  rBucket.Clear();
+
+  // A bucket can overlap several memory areas
+  u64 BegPos = static_cast<u64>(BucketIndex) * m_BucketSize;
+  u64 EndPos = BegPos + m_BucketSize;
+  for (auto const& rArea : m_Areas)
+  {
+    u64 AreaEndPos = rArea.m_Position + rArea.m_Size;
+    if (AreaEndPos <= BegPos || rArea.m_Position >= EndPos)
+      continue;
+
+    TOffset BegOff = rArea.m_BaseOffset + (std::max(BegPos, rArea.m_Position) - rArea.m_Position);
+    TOffset EndOff = rArea.m_BaseOffset + (std::min(EndPos, AreaEndPos) - rArea.m_Position);
+    _CountRange(rArea, BegOff, EndOff, rBucket);
+  }
+}
+
+void Overview::_CountRange(Area const& rArea, TOffset BeginOffset, TOffset EndOffset, Bucket& rBucket) const
+{
+  auto const* pMemArea = rArea.m_pMemArea;
+  auto AddSize = [&](u8 CellType, u64 Size)
+  {
+    rBucket.m_Sizes[CellType < CellTypeNo ? CellType : Cell::CellType] += Size;
+  };
+
+  // The end of a cell which starts before the range is counted too
+  u64 CoveredSize = 0;
+  pMemArea->ForEachCellDataInRange(BeginOffset, EndOffset, [&](TOffset Offset, CellData::SPType spCellData)
+  {
+    TOffset CellBegOff = std::max<TOffset>(Offset, BeginOffset);
+    TOffset CellEndOff = std::min<TOffset>(Offset + std::max<u16>(spCellData->GetLength(), 1), EndOffset);
+    AddSize(spCellData->GetType(), CellEndOff - CellBegOff);
+    CoveredSize += CellEndOff - CellBegOff;
+    return true;
+  });
+
+  // Bytes which belong to no cell are unknown
+  AddSize(Cell::CellType, (EndOffset - BeginOffset) - CoveredSize);
+}
+
+bool Overview::_ConvertAddressToPosition(Address const& rAddress, u64& rPosition) const
+{
+  for (auto const& rArea : m_Areas)
+  {
+    if (!rArea.m_pMemArea->IsCellPresent(rAddress))
+      continue;
+    rPosition = rArea.m_Position + (rAddress.GetOffset() - rArea.m_BaseOffset);
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,288 @@
+#include "medusa/patch_overlay.hpp"
+#include "medusa/binary_stream.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+MEDUSA_NAMESPACE_USE;
+
+PatchOverlay::PatchOverlay(BinaryStream const& rOrigin)
+  : m_rOrigin(rOrigin)
+  , m_BitmapSize(0)
+  , m_PageNo(0)
+{
+}
+
+PatchOverlay::~PatchOverlay(void)
+{
+}
+
+void PatchOverlay::Reset(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  m_PageNo.store(0, std::memory_order_release);
+  m_spBitmap.reset();
+  m_BitmapSize = 0;
+  m_Pages.clear();
+  m_UndoSteps.clear();
+  m_RedoSteps.clear();
+}
+
+void PatchOverlay::Apply(TOffset Offset, u8* pData, u64 Length) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  _Read(Offset, pData, Length);
+}
+
+bool PatchOverlay::Write(TOffset Offset, u8 const* pData, u64 Length, bool Record)
+{
+  if (Length == 0)
+    return true;
+
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (!Record)
+    return _Write(Offset, pData, Length, nullptr);
+
+  // The replaced bytes could be patched already
+  Step NewStep;
+  NewStep.m_Offset = Offset;
+  NewStep.m_OldData.resize(static_cast<size_t>(Length));
+  if (!m_rOrigin.ReadOriginal(Offset, NewStep.m_OldData.data(), static_cast<size_t>(Length)))
+    return false;
+  _Read(Offset, NewStep.m_OldData.data(), Length);
+  NewStep.m_NewData.assign(pData, pData + Length);
+
+  if (!_Write(Offset, pData, Length, &NewStep.m_NewPages))
+    return false;
+  m_UndoSteps.push_back(std::move(NewStep));
+  m_RedoSteps.clear();
+  return true;
+}
+
+bool PatchOverlay::Undo(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (m_UndoSteps.empty())
+    return false;
+
+  // Steps are undone in reverse order, so the pages they wrote are still copied
+  Step& rStep = m_UndoSteps.back();
+  if (!_Write(rStep.m_Offset, rStep.m_OldData.data(), rStep.m_OldData.size(), nullptr))
+    return false;
+  for (auto PageIdx : rStep.m_NewPages)
+    _DropPage(PageIdx);
+
+  m_RedoSteps.push_back(std::move(rStep));
+  m_UndoSteps.pop_back();
+  return true;
+}
+
+bool PatchOverlay::Redo(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  if (m_RedoSteps.empty())
+    return false;
+
+  Step& rStep = m_RedoSteps.back();
+  rStep.m_NewPages.clear();
+  if (!_Write(rStep.m_Offset, rStep.m_NewData.data(), rStep.m_NewData.size(), &rStep.m_NewPages))
+    return false;
+
+  m_UndoSteps.push_back(std::move(rStep));
+  m_RedoSteps.pop_back();
+  return true;
+}
+
+size_t PatchOverlay::GetUndoNo(void) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  return m_UndoSteps.size();
+}
+
+size_t PatchOverlay::GetRedoNo(void) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  return m_RedoSteps.size();
+}
+
+void PatchOverlay::ClearHistory(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  m_UndoSteps.clear();
+  m_RedoSteps.clear();
+}
+
+bool PatchOverlay::GetPatches(PatchVector& rPatches) const
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  rPatches.clear();
+
+  std::vector<u64> PageIdxs;
+  PageIdxs.reserve(m_Pages.size());
+  for (auto const& rPage : m_Pages)
+    PageIdxs.push_back(rPage.first);
+  std::sort(std::begin(PageIdxs), std::end(PageIdxs));
+
+  // Copied pages are compared with the origin, a write could have restored the original bytes
+  std::vector<u8> OrgPage(PageSize);
+  for (auto PageIdx : PageIdxs)
+  {
+    TOffset PageOff = PageIdx << PageBits;
+    u64     PageLen = std::min<u64>(PageSize, m_rOrigin.GetSize() - PageOff);
+    if (!m_rOrigin.ReadOriginal(PageOff, OrgPage.data(), static_cast<size_t>(PageLen)))
+      return false;
+
+    u8 const* pPage = m_Pages.find(PageIdx)->second.get();
+    u64 CurPos = 0;
+    while (CurPos < PageLen)
+    {
+      if (pPage[CurPos] == OrgPage[CurPos])
+      {
+        ++CurPos;
+        continue;
+      }
+
+      u64 EndPos = CurPos;
+      while (EndPos < PageLen && pPage[EndPos] != OrgPage[EndPos])
+        ++EndPos;
+
+      // A run which crosses a page boundary is kept as a single patch
+      TOffset RunOff = PageOff + CurPos;
+      if (!rPatches.empty() && rPatches.back().m_Offset + rPatches.back().m_Data.size() == RunOff)
+        rPatches.back().m_Data.insert(std::end(rPatches.back().m_Data), pPage + CurPos, pPage + EndPos);
+      else
+      {
+        Patch NewPatch;
+        NewPatch.m_Offset = RunOff;
+        NewPatch.m_Data.assign(pPage + CurPos, pPage + EndPos);
+        rPatches.push_back(std::move(NewPatch));
+      }
+      CurPos = EndPos;
+    }
+  }
+
+  return true;
+}
+
+bool PatchOverlay::ApplyPatches(PatchVector const& rPatches)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+  for (auto const& rPatch : rPatches)
+  {
+    u64 PatchSize = rPatch.m_Data.size();
+    if (rPatch.m_Offset + PatchSize < rPatch.m_Offset || rPatch.m_Offset + PatchSize > m_rOrigin.GetSize())
+      return false;
+    if (!_Write(rPatch.m_Offset, rPatch.m_Data.data(), PatchSize, nullptr))
+      return false;
+  }
+  return true;
+}
+
+bool PatchOverlay::_IsPatched(TOffset Offset, u64 Length) const
+{
+  u64 LastPageIdx = (Offset + Length - 1) >> PageBits;
+  for (u64 PageIdx = Offset >> PageBits; PageIdx <= LastPageIdx; ++PageIdx)
+    if (_IsPagePatched(PageIdx))
+      return true;
+  return false;
+}
+
+bool PatchOverlay::_IsPagePatched(u64 PageIdx) const
+{
+  u64 WordIdx = PageIdx / 64;
+  if (WordIdx >= m_BitmapSize)
+    return false;
+  return ((m_spBitmap[WordIdx].load(std::memory_order_acquire) >> (PageIdx % 64)) & 1) != 0;
+}
+
+bool PatchOverlay::_Write(TOffset Offset, u8 const* pData, u64 Length, std::vector<u64>* pNewPages)
+{
+  if (Length == 0)
+    return true;
+
+  // The bitmap covers the whole origin, readers only use it once a page is counted
+  if (m_spBitmap == nullptr)
+  {
+    u64 PageNo = (m_rOrigin.GetSize() + PageSize - 1) >> PageBits;
+    m_BitmapSize = (PageNo + 63) / 64;
+    m_spBitmap.reset(new std::atomic<u64>[static_cast<size_t>(m_BitmapSize)]);
+    for (u64 WordIdx = 0; WordIdx < m_BitmapSize; ++WordIdx)
+      m_spBitmap[WordIdx].store(0, std::memory_order_relaxed);
+  }
+
+  u64 FirstPageIdx = Offset >> PageBits;
+  u64 LastPageIdx  = (Offset + Length - 1) >> PageBits;
+  if (LastPageIdx / 64 >= m_BitmapSize)
+    return false;
+
+  // Missing pages are copied first, so a failure doesn't leave a partial write
+  std::vector<u64> NewPages;
+  for (u64 PageIdx = FirstPageIdx; PageIdx <= LastPageIdx; ++PageIdx)
+  {
+    auto& rspPage = m_Pages[PageIdx];
+    if (rspPage != nullptr)
+      continue;
+
+    // The last page could be partial, its tail is never read
+    TOffset PageOff = PageIdx << PageBits;
+    u64     PageLen = std::min<u64>(PageSize, m_rOrigin.GetSize() - PageOff);
+    rspPage.reset(new u8[PageSize]());
+    if (!m_rOrigin.ReadOriginal(PageOff, rspPage.get(), static_cast<size_t>(PageLen)))
+    {
+      m_Pages.erase(PageIdx);
+      for (auto NewPageIdx : NewPages)
+        m_Pages.erase(NewPageIdx);
+      return false;
+    }
+    NewPages.push_back(PageIdx);
+  }
+
+  for (auto PageIdx : NewPages)
+  {
+    m_spBitmap[PageIdx / 64].fetch_or(1ULL << (PageIdx % 64), std::memory_order_release);
+    m_PageNo.fetch_add(1, std::memory_order_release);
+  }
+  if (pNewPages != nullptr)
+    pNewPages->insert(std::end(*pNewPages), std::begin(NewPages), std::end(NewPages));
+
+  while (Length != 0)
+  {
+    u64 PageIdx = Offset >> PageBits;
+    u64 PageOff = Offset & (PageSize - 1);
+    u64 CopyLen = std::min<u64>(Length, PageSize - PageOff);
+    ::memcpy(m_Pages[PageIdx].get() + PageOff, pData, static_cast<size_t>(CopyLen));
+
+    pData  += CopyLen;
+    Offset += CopyLen;
+    Length -= CopyLen;
+  }
+
+  return true;
+}
+
+void PatchOverlay::_Read(TOffset Offset, u8* pData, u64 Length) const
+{
+  while (Length != 0)
+  {
+    u64 PageIdx = Offset >> PageBits;
+    u64 PageOff = Offset & (PageSize - 1);
+    u64 CopyLen = std::min<u64>(Length, PageSize - PageOff);
+
+    // Bytes of pages which were not copied are left untouched
+    auto itPage = m_Pages.find(PageIdx);
+    if (itPage != std::end(m_Pages))
+      ::memcpy(pData, itPage->second.get() + PageOff, static_cast<size_t>(CopyLen));
+
+    pData  += CopyLen;
+    Offset += CopyLen;
+    Length -= CopyLen;
+  }
+}
+
+void PatchOverlay::_DropPage(u64 PageIdx)
+{
+  if (m_Pages.erase(PageIdx) == 0)
+    return;
+  m_spBitmap[PageIdx / 64].fetch_and(~(1ULL << (PageIdx % 64)), std::memory_order_release);
+  m_PageNo.fetch_sub(1, std::memory_order_release);
+}
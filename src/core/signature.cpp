@@ -0,0 +1,377 @@
+#include "medusa/signature.hpp"
+#include "medusa/instruction.hpp"
+#include "medusa/function.hpp"
+#include "medusa/log.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+MEDUSA_NAMESPACE_BEGIN
+
+Signature::Signature(std::string const& rName)
+  : m_Name(rName)
+{
+}
+
+bool Signature::Build(Document const& rDoc, Address const& rFuncAddr, u32 MaxLength)
+{
+  m_Bytes.clear();
+  m_Mask.clear();
+
+  BinaryStream const& rBinStrm = rDoc.GetBinaryStream();
+  Address CurAddr = rFuncAddr;
+
+  while (GetLength() < MaxLength && rDoc.ContainsCode(CurAddr))
+  {
+    auto spInsn = std::dynamic_pointer_cast<Instruction const>(rDoc.GetCell(CurAddr));
+    if (spInsn == nullptr || spInsn->GetLength() == 0)
+      break;
+
+    TOffset InsnOff;
+    if (!rDoc.ConvertAddressToFileOffset(CurAddr, InsnOff))
+      break;
+
+    u16 InsnLen = spInsn->GetLength();
+    std::vector<u8> InsnBytes(InsnLen);
+    if (!rBinStrm.Read(InsnOff, InsnBytes.data(), InsnLen))
+      break;
+
+    // Bytes which hold a value which could be relocated are wildcarded
+    std::vector<bool> InsnMask(InsnLen, false);
+    for (u8 CurOp = 0; CurOp < OPERAND_NO; ++CurOp)
+    {
+      auto const pOprd = spInsn->Operand(CurOp);
+      if (!(pOprd->GetType() & (O_IMM | O_DISP | O_REL | O_ABS)))
+        continue;
+
+      u8 OprdOff = pOprd->GetOffset();
+      if (OprdOff == 0 || OprdOff >= InsnLen)
+        continue;
+
+      // If we don't know the size of the value, we wildcard the rest of the instruction
+      u8 OprdLen = pOprd->GetRawLength();
+      if (OprdLen == 0 || OprdOff + OprdLen > InsnLen)
+        OprdLen = static_cast<u8>(InsnLen - OprdOff);
+
+      for (u8 i = 0; i < OprdLen; ++i)
+        InsnMask[OprdOff + i] = true;
+    }
+
+    for (u16 i = 0; i < InsnLen && GetLength() < MaxLength; ++i)
+      AddByte(InsnBytes[i], InsnMask[i]);
+
+    auto InsnType = spInsn->GetSubType();
+    if ((InsnType & Instruction::ReturnType) && !(InsnType & Instruction::ConditionalType))
+      break;
+    if ((InsnType & Instruction::JumpType) && !(InsnType & Instruction::ConditionalType))
+      break;
+
+    CurAddr += InsnLen;
+  }
+
+  return !m_Bytes.empty();
+}
+
+void Signature::AddByte(u8 Byte, bool IsWildcard)
+{
+  m_Bytes.push_back(IsWildcard ? 0x00 : Byte);
+  m_Mask.push_back(IsWildcard ? 0x00 : 0xff);
+}
+
+bool Signature::Match(u8 const* pBuffer, u32 Length) const
+{
+  if (Length < GetLength())
+    return false;
+
+  for (u32 i = 0; i < GetLength(); ++i)
+    if ((pBuffer[i] & m_Mask[i]) != m_Bytes[i])
+      return false;
+
+  return true;
+}
+
+std::string Signature::ToString(void) const
+{
+  std::ostringstream oss;
+  oss << std::hex << std::setfill('0');
+  for (u32 i = 0; i < GetLength(); ++i)
+  {
+    if (m_Mask[i] == 0x00)
+      oss << "..";
+    else
+      oss << std::setw(2) << static_cast<int>(m_Bytes[i]);
+  }
+  oss << " " << m_Name;
+  return oss.str();
+}
+
+SignatureDatabase::SignatureDatabase(void)
+  : m_SignatureCounter(0)
+  , m_MaxLength(0)
+{
+  // Root node
+  Node Root = { NoNode, NoNode, NoName, 0x00, NodeNone };
+  m_Nodes.push_back(Root);
+}
+
+bool SignatureDatabase::Add(Signature const& rSig)
+{
+  if (rSig.GetLength() < Signature::MinimumLength)
+    return false;
+
+  auto const& rBytes = rSig.GetBytes();
+  auto const& rMask  = rSig.GetMask();
+
+  u32 CurNode = 0;
+  for (u32 i = 0; i < rSig.GetLength(); ++i)
+  {
+    u8 Flags = rMask[i] == 0x00 ? NodeWildcard : NodeNone;
+    u32 NextNode = _FindChild(CurNode, rBytes[i], Flags);
+    if (NextNode == NoNode)
+      NextNode = _AddChild(CurNode, rBytes[i], Flags);
+    CurNode = NextNode;
+  }
+
+  auto& rNameIdx = m_Nodes[CurNode].m_NameIndex;
+  if (rNameIdx == NoName)
+  {
+    rNameIdx = static_cast<u32>(m_Names.size());
+    m_Names.push_back(rSig.GetName());
+    ++m_SignatureCounter;
+  }
+  // Same pattern for two different functions, we can't tell which one it is
+  else if (rNameIdx != Ambiguous && m_Names[rNameIdx] != rSig.GetName())
+    rNameIdx = Ambiguous;
+
+  if (m_MaxLength < rSig.GetLength())
+    m_MaxLength = rSig.GetLength();
+
+  return true;
+}
+
+u32 SignatureDatabase::AddDocument(Document const& rDoc, u32 MaxLength)
+{
+  u32 SigCnt = 0;
+
+  for (auto const& rMultiCell : rDoc.GetMultiCells())
+  {
+    if (rMultiCell.second->GetType() != MultiCell::FunctionType)
+      continue;
+
+    auto FuncLbl = rDoc.GetLabelFromAddress(rMultiCell.first);
+    if (FuncLbl.GetType() == Label::Unknown || FuncLbl.IsAutoGenerated())
+      continue;
+    if ((FuncLbl.GetType() & Label::AccessMask) == Label::Imported)
+      continue;
+
+    Signature FuncSig(FuncLbl.GetName());
+    if (!FuncSig.Build(rDoc, rMultiCell.first, MaxLength))
+      continue;
+
+    if (Add(FuncSig))
+      ++SigCnt;
+  }
+
+  Log::Write("core") << "signature: " << SigCnt << " signature(s) generated" << LogEnd;
+  return SigCnt;
+}
+
+bool SignatureDatabase::Match(u8 const* pBuffer, u32 Length, std::string& rName) const
+{
+  u32 BestDepth = 0;
+  u32 BestName  = NoName;
+
+  _Match(0, pBuffer, Length, 0, BestDepth, BestName);
+
+  if (BestName == NoName || BestName == Ambiguous)
+    return false;
+
+  rName = m_Names[BestName];
+  return true;
+}
+
+// Signature file layout:
+//  - magic "MSIG" and version
+//  - number of nodes, then each node (first child, next sibling, name index, value, flags)
+//  - number of names, then each name prefixed by its length (u16)
+// Integers are stored in little endian
+namespace
+{
+  u32 const SignatureMagic   = 0x4749534d; // MSIG
+  u32 const SignatureVersion = 1;
+
+  void WriteU32(std::ostream& rStrm, u32 Value)
+  {
+    u8 Buf[4] = { u8(Value), u8(Value >> 8), u8(Value >> 16), u8(Value >> 24) };
+    rStrm.write(reinterpret_cast<char const*>(Buf), sizeof(Buf));
+  }
+
+  bool ReadU32(std::istream& rStrm, u32& rValue)
+  {
+    u8 Buf[4];
+    if (!rStrm.read(reinterpret_cast<char*>(Buf), sizeof(Buf)))
+      return false;
+    rValue = Buf[0] | (Buf[1] << 8) | (Buf[2] << 16) | (static_cast<u32>(Buf[3]) << 24);
+    return true;
+  }
+}
+
+bool SignatureDatabase::Load(Path const& rPath)
+{
+  std::ifstream File(rPath.string(), std::ios::binary);
+  if (!File.is_open())
+  {
+    Log::Write("core") << "signature: unable to open " << rPath.string() << LogEnd;
+    return false;
+  }
+
+  u32 Magic, Version, NodeCnt, NameCnt, SigCnt, MaxLen;
+  if (!ReadU32(File, Magic) || Magic != SignatureMagic || !ReadU32(File, Version) || Version != SignatureVersion)
+  {
+    Log::Write("core") << "signature: " << rPath.string() << " is not a valid signature file" << LogEnd;
+    return false;
+  }
+
+  if (!ReadU32(File, SigCnt) || !ReadU32(File, MaxLen) || !ReadU32(File, NodeCnt) || NodeCnt == 0)
+    return false;
+
+  std::vector<Node> Nodes;
+  Nodes.reserve(NodeCnt);
+  for (u32 i = 0; i < NodeCnt; ++i)
+  {
+    Node CurNode;
+    char ValAndFlags[2];
+    if (!ReadU32(File, CurNode.m_FirstChild) || !ReadU32(File, CurNode.m_NextSibling) || !ReadU32(File, CurNode.m_NameIndex))
+      return false;
+    if (!File.read(ValAndFlags, sizeof(ValAndFlags)))
+      return false;
+    CurNode.m_Value = static_cast<u8>(ValAndFlags[0]);
+    CurNode.m_Flags = static_cast<u8>(ValAndFlags[1]);
+    Nodes.push_back(CurNode);
+  }
+
+  if (!ReadU32(File, NameCnt))
+    return false;
+
+  std::vector<std::string> Names;
+  Names.reserve(NameCnt);
+  for (u32 i = 0; i < NameCnt; ++i)
+  {
+    u8 LenBuf[2];
+    if (!File.read(reinterpret_cast<char*>(LenBuf), sizeof(LenBuf)))
+      return false;
+    std::string CurName(LenBuf[0] | (LenBuf[1] << 8), '\0');
+    if (!File.read(&CurName[0], CurName.size()))
+      return false;
+    Names.push_back(CurName);
+  }
+
+  // Make sure a corrupted file can't make us read out of bounds
+  for (auto const& rNode : Nodes)
+  {
+    if (rNode.m_FirstChild != NoNode && rNode.m_FirstChild >= NodeCnt)
+      return false;
+    if (rNode.m_NextSibling != NoNode && rNode.m_NextSibling >= NodeCnt)
+      return false;
+    if (rNode.m_NameIndex != NoName && rNode.m_NameIndex != Ambiguous && rNode.m_NameIndex >= NameCnt)
+      return false;
+  }
+
+  m_Nodes.swap(Nodes);
+  m_Names.swap(Names);
+  m_SignatureCounter = SigCnt;
+  m_MaxLength        = MaxLen;
+
+  Log::Write("core") << "signature: " << m_SignatureCounter << " signature(s) loaded from " << rPath.string() << LogEnd;
+  return true;
+}
+
+bool SignatureDatabase::Save(Path const& rPath) const
+{
+  std::ofstream File(rPath.string(), std::ios::binary | std::ios::trunc);
+  if (!File.is_open())
+  {
+    Log::Write("core") << "signature: unable to create " << rPath.string() << LogEnd;
+    return false;
+  }
+
+  WriteU32(File, SignatureMagic);
+  WriteU32(File, SignatureVersion);
+  WriteU32(File, m_SignatureCounter);
+  WriteU32(File, m_MaxLength);
+
+  WriteU32(File, static_cast<u32>(m_Nodes.size()));
+  for (auto const& rNode : m_Nodes)
+  {
+    WriteU32(File, rNode.m_FirstChild);
+    WriteU32(File, rNode.m_NextSibling);
+    WriteU32(File, rNode.m_NameIndex);
+    char ValAndFlags[2] = { static_cast<char>(rNode.m_Value), static_cast<char>(rNode.m_Flags) };
+    File.write(ValAndFlags, sizeof(ValAndFlags));
+  }
+
+  WriteU32(File, static_cast<u32>(m_Names.size()));
+  for (auto const& rName : m_Names)
+  {
+    u16 NameLen = static_cast<u16>(std::min<size_t>(rName.size(), 0xffff));
+    char LenBuf[2] = { static_cast<char>(NameLen), static_cast<char>(NameLen >> 8) };
+    File.write(LenBuf, sizeof(LenBuf));
+    File.write(rName.data(), NameLen);
+  }
+
+  return File.good();
+}
+
+u32 SignatureDatabase::_FindChild(u32 NodeIdx, u8 Value, u8 Flags) const
+{
+  for (u32 CurChild = m_Nodes[NodeIdx].m_FirstChild; CurChild != NoNode; CurChild = m_Nodes[CurChild].m_NextSibling)
+  {
+    auto const& rChild = m_Nodes[CurChild];
+    if (rChild.m_Flags != Flags)
+      continue;
+    if ((Flags & NodeWildcard) || rChild.m_Value == Value)
+      return CurChild;
+  }
+  return NoNode;
+}
+
+u32 SignatureDatabase::_AddChild(u32 NodeIdx, u8 Value, u8 Flags)
+{
+  u32 NewIdx = static_cast<u32>(m_Nodes.size());
+  Node NewNode = { NoNode, m_Nodes[NodeIdx].m_FirstChild, NoName, Value, Flags };
+  m_Nodes.push_back(NewNode);
+  m_Nodes[NodeIdx].m_FirstChild = NewIdx;
+  return NewIdx;
+}
+
+void SignatureDatabase::_Match(u32 NodeIdx, u8 const* pBuffer, u32 Length, u32 Depth, u32& rBestDepth, u32& rBestName) const
+{
+  auto const& rNode = m_Nodes[NodeIdx];
+
+  // Longest match wins, two different names at the same depth make the result ambiguous
+  if (rNode.m_NameIndex != NoName)
+  {
+    if (Depth > rBestDepth)
+    {
+      rBestDepth = Depth;
+      rBestName  = rNode.m_NameIndex;
+    }
+    else if (Depth == rBestDepth && rBestName != rNode.m_NameIndex)
+      rBestName = Ambiguous;
+  }
+
+  if (Depth >= Length)
+    return;
+
+  // Both the exact and the wildcard edges can match, so we have to follow both
+  for (u32 CurChild = rNode.m_FirstChild; CurChild != NoNode; CurChild = m_Nodes[CurChild].m_NextSibling)
+  {
+    auto const& rChild = m_Nodes[CurChild];
+    if (!(rChild.m_Flags & NodeWildcard) && rChild.m_Value != pBuffer[Depth])
+      continue;
+    _Match(CurChild, pBuffer, Length, Depth + 1, rBestDepth, rBestName);
+  }
+}
+
+MEDUSA_NAMESPACE_END
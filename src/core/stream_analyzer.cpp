@@ -0,0 +1,308 @@
+#include "medusa/stream_analyzer.hpp"
+#include "medusa/instruction.hpp"
+#include "medusa/log.hpp"
+#include "medusa/memory_area.hpp"
+#include "medusa/module.hpp"
+#include "medusa/string.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+MEDUSA_NAMESPACE_USE;
+
+//! Window holds a copy of a range of the document stream, patches of the document still apply on it.
+//! A file stream is read with a regular file, so the pages of the whole image are never mapped.
+class StreamAnalyzer::Window : public BinaryStream
+{
+public:
+  Window(BinaryStream const& rSource) : m_rSource(rSource)
+  {
+    m_Path       = rSource.GetPath();
+    m_Endianness = rSource.GetEndianness();
+    m_spOverlay  = rSource.GetOverlay();
+    if (dynamic_cast<FileBinaryStream const*>(&rSource) != nullptr)
+      m_File.open(m_Path.string(), std::ios::in | std::ios::binary);
+  }
+
+  u64 GetCapacity(void) const { return m_Buffer.capacity(); }
+
+  //! The buffer is reused, so it's only allocated by the first window.
+  bool Load(TOffset Offset, u64 Size)
+  {
+    m_Buffer.resize(static_cast<size_t>(Size));
+    m_pBuffer       = m_Buffer.data();
+    m_Size          = Size;
+    m_OverlayOffset = m_rSource.GetOverlayOffset() + Offset;
+
+    if (!m_File.is_open())
+      return m_rSource.ReadOriginal(Offset, m_Buffer.data(), static_cast<size_t>(Size));
+
+    m_File.clear();
+    m_File.seekg(static_cast<std::streamoff>(Offset));
+    m_File.read(reinterpret_cast<char*>(m_Buffer.data()), static_cast<std::streamsize>(Size));
+    return static_cast<u64>(m_File.gcount()) == Size;
+  }
+
+private:
+  BinaryStream const& m_rSource;
+  std::ifstream       m_File;
+  std::vector<u8>     m_Buffer;
+};
+
+StreamAnalyzer::StreamAnalyzer(Document& rDoc, Database::SPType spDb, Architecture::SPType spArch)
+  : m_rDoc(rDoc)
+  , m_spDb(spDb)
+  , m_spArch(spArch)
+  , m_MemoryBudget(DefaultMemoryBudget)
+  , m_Overlap(DefaultOverlap)
+  , m_MinInsnNo(DefaultInstructionNo)
+  , m_MinStrLen(DefaultStringLength)
+  , m_Stats()
+  , m_IsSucceeded(false)
+{
+}
+
+StreamAnalyzer::~StreamAnalyzer(void)
+{
+}
+
+std::string StreamAnalyzer::GetName(void) const
+{
+  return "stream analyzer";
+}
+
+void StreamAnalyzer::Configure(ConfigurationModel const& rCfgMdl)
+{
+  if (rCfgMdl.IsSet("Memory budget"))
+    SetMemoryBudget(rCfgMdl.GetUint64("Memory budget"));
+  if (rCfgMdl.IsSet("Window overlap"))
+    SetOverlap(rCfgMdl.GetUint32("Window overlap"));
+}
+
+u64 StreamAnalyzer::ComputeWindowSize(u64 MemoryBudget, u32 Overlap)
+{
+  // The other half is left to the modules, the database and the allocator
+  u64 ReadSize = std::max<u64>(MemoryBudget, MinimumMemoryBudget) / 2;
+  u64 ReadAhead = std::min<u64>(std::max<u32>(Overlap, MinimumOverlap), ReadSize / 2);
+  return ReadSize - ReadAhead;
+}
+
+void StreamAnalyzer::Run(void)
+{
+  m_Stats = Statistics();
+  m_IsSucceeded = false;
+
+  if (m_spDb == nullptr || m_spArch == nullptr)
+  {
+    Log::Write("core") << "stream analyzer needs a database and an architecture" << LogEnd;
+    return;
+  }
+
+  // Only file-backed areas contain something to analyze
+  std::vector<MemoryArea const*> MemAreas;
+  u64 TotalSize = 0;
+  m_rDoc.ForEachMemoryArea([&](MemoryArea const& rMemArea)
+  {
+    if (rMemArea.GetFileSize() == 0)
+      return;
+    MemAreas.push_back(&rMemArea);
+    TotalSize += rMemArea.GetFileSize();
+  });
+  SetTotal(TotalSize);
+
+  if (!m_spDb->BeginStream())
+  {
+    Log::Write("core") << "database " << m_spDb->GetName() << " doesn't support streaming" << LogEnd;
+    return;
+  }
+
+  auto StartTime = std::chrono::steady_clock::now();
+  Window Win(m_rDoc.GetBinaryStream());
+  bool Res = true;
+  for (auto pMemArea : MemAreas)
+  {
+    if (IsCancelled())
+      break;
+    if (!_AnalyzeMemoryArea(*pMemArea, Win))
+    {
+      Res = false;
+      break;
+    }
+  }
+  m_Stats.m_PeakMemory = Win.GetCapacity();
+
+  if (!m_spDb->EndStream())
+  {
+    Log::Write("core") << "unable to end the stream of database " << m_spDb->GetName() << LogEnd;
+    Res = false;
+  }
+  m_IsSucceeded = Res;
+
+  auto Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count();
+  Log::Write("core")
+    << "stream analysis: " << m_Stats.m_ByteNo << " byte(s) in " << m_Stats.m_WindowNo << " window(s)"
+    << ", " << m_Stats.m_InstructionNo << " instruction(s) in " << m_Stats.m_CodeNo << " run(s)"
+    << ", " << m_Stats.m_StringNo << " string(s)"
+    << ", window buffer: " << m_Stats.m_PeakMemory << " byte(s)"
+    << ", elapsed: " << static_cast<u64>(Elapsed) << "ms"
+    << LogEnd;
+}
+
+bool StreamAnalyzer::_AnalyzeMemoryArea(MemoryArea const& rMemArea, Window& rWin)
+{
+  BinaryStream const& rBinStrm = m_rDoc.GetBinaryStream();
+  TOffset const AreaOff = rMemArea.GetFileOffset();
+  if (AreaOff >= rBinStrm.GetSize())
+    return true;
+  TOffset const AreaEnd = AreaOff + std::min<u64>(rMemArea.GetFileSize(), rBinStrm.GetSize() - AreaOff);
+  TOffset const BaseOff = rMemArea.GetBaseAddress().GetOffset();
+
+  auto spArch = m_spArch;
+  if (rMemArea.GetArchitectureTag() != MEDUSA_ARCH_UNK)
+  {
+    auto spMemAreaArch = ModuleManager::Instance().GetArchitecture(rMemArea.GetArchitectureTag());
+    if (spMemAreaArch != nullptr)
+      spArch = spMemAreaArch;
+  }
+  u8 Mode = rMemArea.GetArchitectureMode();
+  if (Mode == 0)
+    Mode = spArch->GetDefaultMode(rMemArea.GetBaseAddress());
+  if (Mode == 0 && !spArch->GetModes().empty())
+    Mode = std::get<1>(spArch->GetModes().front());
+
+  // Windows are read with their overlap, the whole read stays in half of the budget
+  u64 const WinSize   = GetWindowSize();
+  u64 const ReadAhead = m_MemoryBudget / 2 - WinSize;
+
+  auto MakeAddr = [&](TOffset FileOff)
+  {
+    return rMemArea.MakeAddress(BaseOff + (FileOff - AreaOff));
+  };
+
+  // Instructions are kept until the run is long enough to be considered as code
+  typedef std::vector<std::pair<Address, CellData::SPType>> PendingInstructionVector;
+  PendingInstructionVector PendingInsns;
+  bool IsCode = false;
+
+  auto EndRun = [&]()
+  {
+    PendingInsns.clear();
+    IsCode = false;
+  };
+
+  auto AddInstruction = [&](TOffset FileOff, CellData::SPType spInsnData) -> bool
+  {
+    Address InsnAddr = MakeAddr(FileOff);
+    if (IsCode)
+    {
+      ++m_Stats.m_InstructionNo;
+      return m_spDb->StreamCellData(InsnAddr, *spInsnData);
+    }
+
+    PendingInsns.push_back(std::make_pair(InsnAddr, spInsnData));
+    if (PendingInsns.size() < m_MinInsnNo)
+      return true;
+
+    IsCode = true;
+    ++m_Stats.m_CodeNo;
+    Address const& rRunAddr = PendingInsns.front().first;
+    if (!m_spDb->StreamLabel(rRunAddr, Label(rRunAddr, Label::Code | Label::Global)))
+      return false;
+    for (auto const& rInsn : PendingInsns)
+    {
+      ++m_Stats.m_InstructionNo;
+      if (!m_spDb->StreamCellData(rInsn.first, *rInsn.second))
+        return false;
+    }
+    PendingInsns.clear();
+    return true;
+  };
+
+  static Utf8StringTrait Utf8Str;
+  u32 StepNo = 0;
+  TOffset CurOff = AreaOff;
+
+  while (CurOff < AreaEnd)
+  {
+    if (IsCancelled())
+      return true;
+
+    TOffset const WinOff  = CurOff;
+    TOffset const BodyEnd = WinOff + std::min<u64>(WinSize, AreaEnd - WinOff);
+    TOffset const ReadEnd = WinOff + std::min<u64>(WinSize + ReadAhead, AreaEnd - WinOff);
+    if (!rWin.Load(WinOff, ReadEnd - WinOff))
+    {
+      Log::Write("core") << "unable to read window at " << WinOff << LogEnd;
+      return false;
+    }
+    ++m_Stats.m_WindowNo;
+
+    // The sweep stops at the end of the body, the next window starts where it stopped
+    while (CurOff < BodyEnd)
+    {
+      if (++StepNo % 0x10000 == 0 && IsCancelled())
+        break;
+
+      TOffset const WinPos = CurOff - WinOff;
+
+      // Padding is decoded as valid instructions by many architectures (e.g. 00 00 on x86)
+      u8 PadByte = 0, CurByte = 0;
+      u64 PadLen = 0;
+      if (rWin.Read(WinPos, PadByte) && (PadByte == 0x00 || PadByte == 0xff))
+      {
+        while (CurOff + PadLen < ReadEnd && rWin.Read(WinPos + PadLen, CurByte) && CurByte == PadByte)
+          ++PadLen;
+        if (PadLen >= PaddingLength)
+        {
+          EndRun();
+          CurOff += PadLen;
+          continue;
+        }
+      }
+
+      s8 CurChar = 0;
+      u64 StrLen = 0;
+      while (CurOff + StrLen < ReadEnd && rWin.Read(WinPos + StrLen, CurChar) && Utf8Str.IsValidCharacter(CurChar))
+        ++StrLen;
+
+      // A printable run is data even without a terminator (e.g. a string longer than the overlap)
+      if (StrLen >= m_MinStrLen)
+      {
+        EndRun();
+        if (CurOff + StrLen < ReadEnd && StrLen < 0xffff && rWin.Read(WinPos + StrLen, CurChar) && Utf8Str.IsFinalCharacter(CurChar))
+        {
+          ++StrLen;
+          Address StrAddr = MakeAddr(CurOff);
+          String Str(String::Utf8Type, static_cast<u16>(StrLen));
+          if (!m_spDb->StreamCellData(StrAddr, *Str.GetData()) || !m_spDb->StreamLabel(StrAddr, Label(StrAddr, Label::String | Label::Global)))
+            return false;
+          ++m_Stats.m_StringNo;
+        }
+        CurOff += StrLen;
+        continue;
+      }
+
+      Instruction Insn;
+      Insn.GetData()->ArchitectureTag() = spArch->GetTag();
+      Insn.GetData()->Mode() = Mode;
+      if (spArch->Disassemble(rWin, WinPos, Insn, Mode) && Insn.GetLength() != 0)
+      {
+        if (!AddInstruction(CurOff, Insn.GetData()))
+          return false;
+        CurOff += Insn.GetLength();
+        continue;
+      }
+
+      EndRun();
+      ++CurOff;
+    }
+
+    m_Stats.m_ByteNo += CurOff - WinOff;
+    Advance(CurOff - WinOff);
+  }
+
+  EndRun();
+  return true;
+}
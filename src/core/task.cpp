@@ -2,9 +2,64 @@
 
 MEDUSA_NAMESPACE_BEGIN
 
+CancellationToken::CancellationToken(void)
+: m_IsCancelled(false)
+, m_Deadline(0)
+, m_WasCancelled(false)
+, m_WasTimedOut(false)
+{
+}
+
+void CancellationToken::SetDeadline(ClockType::time_point Deadline)
+{
+  auto NewDeadline = Deadline.time_since_epoch().count();
+  auto CurDeadline = m_Deadline.load();
+  while ((CurDeadline == 0 || NewDeadline < CurDeadline) && !m_Deadline.compare_exchange_weak(CurDeadline, NewDeadline))
+    ;
+}
+
+bool CancellationToken::IsCancelled(void) const
+{
+  if (m_IsCancelled)
+  {
+    m_WasCancelled = true;
+    return true;
+  }
+  return IsTimedOut();
+}
+
+bool CancellationToken::IsTimedOut(void) const
+{
+  auto Deadline = m_Deadline.load();
+  if (Deadline == 0 || ClockType::now().time_since_epoch().count() < Deadline)
+    return false;
+  m_WasTimedOut = true;
+  return true;
+}
+
+Task::Task(void)
+: m_Status(Started)
+, m_Done(0)
+, m_Total(0)
+, m_spToken(std::make_shared<CancellationToken>())
+{
+}
+
+u8 Task::_ComputeStatus(void) const
+{
+  // Only a check done by the task counts, a task which didn't see the token tripped has finished its work
+  if (m_spToken->WasTimedOut())
+    return TimedOut;
+  if (m_spToken->WasCancelled())
+    return Cancelled;
+  return Done;
+}
+
 TaskManager::TaskManager(NotifyFunctionType const& rNotify)
 : m_Running(false)
 , m_Notify(rNotify)
+, m_pCurTask(nullptr)
+, m_Timeout(CancellationToken::ClockType::duration::zero())
 {
   Start();
 }
@@ -34,7 +89,7 @@ void TaskManager::Start(void)
 
         pCurTask = m_Tasks.front();
         m_Tasks.pop();
-
+        m_pCurTask = pCurTask;
       }
 
       if (pCurTask == nullptr)
@@ -42,9 +97,7 @@ void TaskManager::Start(void)
         m_Running = false;
         break;
       }
-      pCurTask->Run();
-      m_Notify(pCurTask);
-      delete pCurTask;
+      _RunTask(pCurTask);
     }
 
     while (!m_Tasks.empty())
@@ -52,13 +105,11 @@ void TaskManager::Start(void)
       { std::unique_lock<std::mutex> Lock(m_Mutex);
       pCurTask = m_Tasks.front();
       m_Tasks.pop();
+      m_pCurTask = pCurTask;
       }
 
       if (pCurTask)
-      {
-        pCurTask->Run();
-        delete pCurTask;
-      }
+        _RunTask(pCurTask);
     }
   });
 }
@@ -68,19 +119,23 @@ void TaskManager::Stop(void)
   if (!m_Running)
     return;
 
-  m_Running = false;
-
-  m_Mutex.lock();
-  m_Tasks.push(nullptr);
-  m_CondVar.notify_one();
-  m_Mutex.unlock();
+  // Wait checks m_Running with the mutex held, so it can't miss this notification
+  {
+    std::unique_lock<std::mutex> Lock(m_Mutex);
+    m_Running = false;
+    m_Tasks.push(nullptr);
+    m_CondVar.notify_one();
+    m_IdleCondVar.notify_all();
+  }
   m_Thread.join();
 }
 
 void TaskManager::Wait(void)
 {
-  m_Running = false;
-  m_Thread.join();
+  // The current task is set when it's dequeued, so a task is never missed between the queue and _RunTask
+  std::unique_lock<std::mutex> Lock(m_Mutex);
+  while (m_Running && (!m_Tasks.empty() || m_pCurTask != nullptr))
+    m_IdleCondVar.wait(Lock);
 }
 
 void TaskManager::AddTask(Task* pTask)
@@ -99,4 +154,75 @@ void TaskManager::AddTask(Task* pTask)
   m_CondVar.notify_one();
 }
 
+void TaskManager::CancelCurrentTask(void)
+{
+  std::unique_lock<std::mutex> Lock(m_Mutex);
+  if (m_pCurTask != nullptr)
+    m_pCurTask->Cancel();
+}
+
+void TaskManager::CancelAllTasks(void)
+{
+  std::unique_lock<std::mutex> Lock(m_Mutex);
+  if (m_pCurTask != nullptr)
+    m_pCurTask->Cancel();
+
+  // The null task asks the thread to stop, so it must stay in the queue
+  std::queue<Task*> RemainingTasks;
+  while (!m_Tasks.empty())
+  {
+    auto pTask = m_Tasks.front();
+    m_Tasks.pop();
+    if (pTask == nullptr)
+      RemainingTasks.push(pTask);
+    else
+      delete pTask;
+  }
+  m_Tasks.swap(RemainingTasks);
+}
+
+void TaskManager::SetTimeout(CancellationToken::ClockType::duration Timeout)
+{
+  std::unique_lock<std::mutex> Lock(m_Mutex);
+  m_Timeout = Timeout;
+  if (m_pCurTask != nullptr && Timeout != CancellationToken::ClockType::duration::zero())
+    m_pCurTask->SetDeadline(CancellationToken::ClockType::now() + Timeout);
+}
+
+bool TaskManager::GetCurrentTaskProgress(std::string& rName, u64& rDone, u64& rTotal) const
+{
+  std::unique_lock<std::mutex> Lock(m_Mutex);
+  if (m_pCurTask == nullptr)
+    return false;
+  rName  = m_pCurTask->GetName();
+  rDone  = m_pCurTask->GetDone();
+  rTotal = m_pCurTask->GetTotal();
+  return true;
+}
+
+void TaskManager::_RunTask(Task* pTask)
+{
+  // The timeout starts with the task, so a task queued for a long time still gets all of it
+  {
+    std::unique_lock<std::mutex> Lock(m_Mutex);
+    if (m_Timeout != CancellationToken::ClockType::duration::zero())
+      pTask->SetDeadline(CancellationToken::ClockType::now() + m_Timeout);
+  }
+
+  m_Notify(pTask, Task::Started);
+  if (!pTask->IsCancelled())
+    pTask->Run();
+
+  // A deadline which expires after Run returned isn't seen by the task, so it's still done
+  pTask->m_Status = pTask->_ComputeStatus();
+  m_Notify(pTask, pTask->GetStatus());
+
+  {
+    std::unique_lock<std::mutex> Lock(m_Mutex);
+    m_pCurTask = nullptr;
+    m_IdleCondVar.notify_all();
+  }
+  delete pTask;
+}
+
 MEDUSA_NAMESPACE_END
@@ -14,7 +14,9 @@ BinaryStream::BinaryStream(void)
   : m_pBuffer(NULL)
   , m_Size(0x0)
   , m_Endianness(EndianUnknown)
+  , m_OverlayOffset(0x0)
 {
+  m_spOverlay = std::make_shared<PatchOverlay>(*this);
 }
 
 BinaryStream::~BinaryStream(void)
@@ -23,13 +25,15 @@ BinaryStream::~BinaryStream(void)
 
 /* file binary stream */
 
-FileBinaryStream::FileBinaryStream(boost::filesystem::path const& rFilePath)
+FileBinaryStream::FileBinaryStream(boost::filesystem::path const& rFilePath, MappingMode Mode)
 : BinaryStream()
 , m_FileHandle(-1)
 , m_MapHandle()
+, m_Mode(Mode)
+, m_LastWindowIndex(~0ULL)
 {
-  m_pBuffer = MAP_FAILED;
-  Open(rFilePath);
+  if (!rFilePath.empty())
+    Open(rFilePath);
 }
 
 FileBinaryStream::~FileBinaryStream(void)
@@ -39,6 +43,9 @@ FileBinaryStream::~FileBinaryStream(void)
 
 void FileBinaryStream::Open(boost::filesystem::path const& rFilePath)
 {
+  if (m_FileHandle != -1)
+    throw Exception("Binary stream: close the current file first before opening a new one");
+
   m_Path = rFilePath;
   m_FileHandle = open(rFilePath.string().c_str(), O_RDONLY);
 
@@ -52,32 +59,75 @@ void FileBinaryStream::Open(boost::filesystem::path const& rFilePath)
   if (fstat(m_FileHandle, &sb) == -1)
     throw Exception_System("fstat");
 
-  m_Size = sb.st_size;
+  m_Size = static_cast<u64>(sb.st_size);
 
-  m_pBuffer = mmap(
+  // Views are mapped on demand by _ReadMapped
+  if (m_Mode == WindowedMapping || (m_Mode == AutoMapping && m_Size > FullMappingLimit))
+    return;
+
+  void* pBuffer = mmap(
       NULL,
-      m_Size,
+      static_cast<size_t>(m_Size),
       PROT_READ,
       MAP_SHARED,
       m_FileHandle,
       0);
 
-  if (m_pBuffer == MAP_FAILED)
+  if (pBuffer == MAP_FAILED)
     throw Exception_System("mmap");
+  m_pBuffer = pBuffer;
 }
 
 void FileBinaryStream::Close(void)
 {
-  if (m_pBuffer != MAP_FAILED)
-    munmap(m_pBuffer, m_Size);
+  _UnmapAllViews();
+  if (m_pBuffer != nullptr)
+  {
+    munmap(m_pBuffer, static_cast<size_t>(m_Size));
+    m_pBuffer = nullptr;
+  }
   if (m_FileHandle != -1)
+  {
     close(m_FileHandle);
+    m_FileHandle = -1;
+  }
   m_Size = 0;
+  m_Sha1.clear();
+  m_spOverlay->Reset();
+}
+
+void* FileBinaryStream::_MapView(TOffset Offset, u64 Size, bool Sequential) const
+{
+  void* pView = mmap(
+      NULL,
+      static_cast<size_t>(Size),
+      PROT_READ,
+      MAP_SHARED,
+      m_FileHandle,
+      static_cast<off_t>(Offset));
+
+  if (pView == MAP_FAILED)
+    return nullptr;
+
+  // During a linear scan, the kernel can read ahead this view and the next one
+  if (Sequential)
+  {
+    madvise(pView, static_cast<size_t>(Size), MADV_SEQUENTIAL);
+    madvise(pView, static_cast<size_t>(Size), MADV_WILLNEED);
+    posix_fadvise(m_FileHandle, static_cast<off_t>(Offset + Size), static_cast<off_t>(WindowSize), POSIX_FADV_WILLNEED);
+  }
+
+  return pView;
+}
+
+void FileBinaryStream::_UnmapView(void* pView, u64 Size) const
+{
+  munmap(pView, static_cast<size_t>(Size));
 }
 
 /* memory binary stream */
 
-MemoryBinaryStream::MemoryBinaryStream(void const* pMem, u32 MemSize)
+MemoryBinaryStream::MemoryBinaryStream(void const* pMem, u64 MemSize)
   : BinaryStream()
 {
   Open(pMem, MemSize);
@@ -88,15 +138,15 @@ MemoryBinaryStream::~MemoryBinaryStream(void)
   Close();
 }
 
-void MemoryBinaryStream::Open(void const* pMem, u32 MemSize)
+void MemoryBinaryStream::Open(void const* pMem, u64 MemSize)
 {
   m_Path = boost::filesystem::unique_path();
-  m_pBuffer = ::malloc(MemSize);
+  m_pBuffer = ::malloc(static_cast<size_t>(MemSize));
   if (m_pBuffer == nullptr)
     throw Exception_System("open");
 
   m_Size = MemSize;
-  ::memcpy(m_pBuffer, pMem, MemSize);
+  ::memcpy(m_pBuffer, pMem, static_cast<size_t>(MemSize));
 }
 
 void MemoryBinaryStream::Close(void)
@@ -105,6 +155,7 @@ void MemoryBinaryStream::Close(void)
   m_pBuffer = nullptr;
   m_Size = 0x0;
   m_Endianness = EndianUnknown;
+  m_spOverlay->Reset();
 }
 
 MEDUSA_NAMESPACE_END
@@ -101,6 +101,7 @@ bool UserConfiguration::_WriteDefaultOptions(void)
     pt::ptree PropTree;
 
     PropTree.put("core.modules_path", ".");
+    PropTree.put("core.signatures_path", "");
 
     PropTree.put("color.background_listing", "#1e1e1e");
     PropTree.put("color.background_address", "#626262");
@@ -1,6 +1,9 @@
 #include "medusa/util.hpp"
 
 #include <sstream>
+#include <algorithm>
+#include <thread>
+#include <vector>
 
 // base64
 #include <boost/archive/iterators/insert_linebreaks.hpp>
@@ -57,7 +60,11 @@ std::string Base64Decode(std::string const &rBase64Data)
     namespace bai = boost::archive::iterators;
     typedef bai::transform_width<bai::binary_from_base64<const char *>, 8, 6> Base64DecodeType;
 
-    auto const End = rBase64Data.size();
+    // Each character holds 6 bits, padding is not decoded
+    auto DataLen = rBase64Data.find('=');
+    if (DataLen == std::string::npos)
+      DataLen = rBase64Data.size();
+    auto const End = DataLen * 6 / 8;
     Base64DecodeType itBase64(rBase64Data.c_str());
     for (std::string::size_type Cur = 0; Cur < End; ++Cur)
     {
@@ -74,25 +81,47 @@ std::string Base64Decode(std::string const &rBase64Data)
 }
 
 
-std::string Sha1(void const *pData, size_t Length)
+namespace
 {
-  std::ostringstream Result;
-  boost::uuids::detail::sha1 Sha1;
-  unsigned int Digest[5];
+  std::string Sha1ToString(boost::uuids::detail::sha1& rSha1)
+  {
+    std::ostringstream Result;
+    unsigned int Digest[5];
+
+    Result << std::hex << std::setfill('0') << std::setw(2);
+
+    rSha1.get_digest(Digest);
+    for (int i = 0; i < 4; ++i)
+    {
+      Result << ((Digest[i] >> 24) & 0xFF);
+      Result << ((Digest[i] >> 16) & 0xFF);
+      Result << ((Digest[i] >>  8) & 0xFF);
+      Result << ((Digest[i] >>  0) & 0xFF);
+    }
 
-  Result << std::hex << std::setfill('0') << std::setw(2);
+    return std::move(Result.str());
+  }
+}
 
+std::string Sha1(void const *pData, size_t Length)
+{
+  boost::uuids::detail::sha1 Sha1;
   Sha1.process_bytes(pData, Length);
-  Sha1.get_digest(Digest);
-  for (int i = 0; i < 4; ++i)
+  return Sha1ToString(Sha1);
+}
+
+std::string Sha1Chunks(std::function<size_t (void* pBuffer, size_t BufferSize)> Reader)
+{
+  boost::uuids::detail::sha1 Sha1;
+  std::vector<u8> Buffer(0x100000);
+  for (;;)
   {
-    Result << ((Digest[i] >> 24) & 0xFF);
-    Result << ((Digest[i] >> 16) & 0xFF);
-    Result << ((Digest[i] >>  8) & 0xFF);
-    Result << ((Digest[i] >>  0) & 0xFF);
+    size_t ReadSize = Reader(Buffer.data(), Buffer.size());
+    if (ReadSize == 0)
+      break;
+    Sha1.process_bytes(Buffer.data(), ReadSize);
   }
-
-  return std::move(Result.str());
+  return Sha1ToString(Sha1);
 }
 
 Id Sha1(std::string const &rName)
@@ -114,10 +143,35 @@ Id Sha1(std::string const &rName)
   return Sha1Id;
 }
 
+u64 Fnv1a(void const *pData, size_t Length, u64 Hash)
+{
+  auto pByte = static_cast<u8 const*>(pData);
+  for (size_t i = 0; i < Length; ++i)
+  {
+    Hash ^= pByte[i];
+    Hash *= 0x100000001b3ULL;
+  }
+  return Hash;
+}
+
 Id RandomId(void)
 {
   boost::uuids::basic_random_generator<boost::mt19937> Gen;
   return Gen();
 }
 
+void ParallelFor(size_t Count, std::function<void (size_t Begin, size_t End)> Callback)
+{
+  if (Count == 0)
+    return;
+
+  size_t ThrdNo    = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  size_t ChunkSize = (Count + ThrdNo - 1) / ThrdNo;
+  std::vector<std::thread> Threads;
+  for (size_t ChunkBeg = 0; ChunkBeg < Count; ChunkBeg += ChunkSize)
+    Threads.push_back(std::thread(Callback, ChunkBeg, std::min(ChunkBeg + ChunkSize, Count)));
+  for (auto& rThrd : Threads)
+    rThrd.join();
+}
+
 MEDUSA_NAMESPACE_END
\ No newline at end of file
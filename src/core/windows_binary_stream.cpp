@@ -10,7 +10,9 @@ BinaryStream::BinaryStream(void)
   : m_pBuffer(nullptr)
   , m_Size(0x0)
   , m_Endianness(EndianUnknown)
+  , m_OverlayOffset(0x0)
 {
+  m_spOverlay = std::make_shared<PatchOverlay>(*this);
 }
 
 BinaryStream::~BinaryStream(void)
@@ -19,12 +21,15 @@ BinaryStream::~BinaryStream(void)
 
 /* file binary stream */
 
-FileBinaryStream::FileBinaryStream(boost::filesystem::path const& rFilePath)
+FileBinaryStream::FileBinaryStream(boost::filesystem::path const& rFilePath, MappingMode Mode)
 : BinaryStream()
 , m_FileHandle(INVALID_HANDLE_VALUE)
 , m_MapHandle(nullptr)
+, m_Mode(Mode)
+, m_LastWindowIndex(~0ULL)
 {
-  Open(rFilePath);
+  if (!rFilePath.empty())
+    Open(rFilePath);
 }
 
 FileBinaryStream::~FileBinaryStream(void)
@@ -34,7 +39,7 @@ FileBinaryStream::~FileBinaryStream(void)
 
 void FileBinaryStream::Open(boost::filesystem::path const& rFilePath)
 {
-  if (m_pBuffer != nullptr)
+  if (m_FileHandle != INVALID_HANDLE_VALUE)
     throw Exception("Binary stream: close the current file first before opening a new one");
 
   m_Path       = rFilePath;
@@ -60,7 +65,7 @@ void FileBinaryStream::Open(boost::filesystem::path const& rFilePath)
   if (GetFileSizeEx(m_FileHandle, &FileSize) == FALSE)
     throw Exception_System("GetFileSizeEx");
 
-  m_Size = static_cast<u32>(FileSize.QuadPart);
+  m_Size = static_cast<u64>(FileSize.QuadPart);
 
   m_MapHandle = CreateFileMappingW(
       m_FileHandle,
@@ -74,6 +79,10 @@ void FileBinaryStream::Open(boost::filesystem::path const& rFilePath)
   if (m_MapHandle == nullptr)
     throw Exception_System("CreateFileMappingW");
 
+  // Views are mapped on demand by _ReadMapped
+  if (m_Mode == WindowedMapping || (m_Mode == AutoMapping && m_Size > FullMappingLimit))
+    return;
+
   m_pBuffer = MapViewOfFile(
       m_MapHandle,
       FILE_MAP_READ,
@@ -87,6 +96,7 @@ void FileBinaryStream::Open(boost::filesystem::path const& rFilePath)
 
 void FileBinaryStream::Close(void)
 {
+  _UnmapAllViews();
   if (m_pBuffer != nullptr)
   {
     UnmapViewOfFile(m_pBuffer);
@@ -104,11 +114,29 @@ void FileBinaryStream::Close(void)
   }
 
   m_Size = 0;
+  m_Sha1.clear();
+  m_spOverlay->Reset();
+}
+
+void* FileBinaryStream::_MapView(TOffset Offset, u64 Size, bool Sequential) const
+{
+  // Windows reads ahead mapped files by itself, Sequential is not used
+  return MapViewOfFile(
+      m_MapHandle,
+      FILE_MAP_READ,
+      static_cast<DWORD>(Offset >> 32), static_cast<DWORD>(Offset & 0xffffffff),
+      static_cast<SIZE_T>(Size)
+      );
+}
+
+void FileBinaryStream::_UnmapView(void* pView, u64 Size) const
+{
+  UnmapViewOfFile(pView);
 }
 
 /* memory binary stream */
 
-MemoryBinaryStream::MemoryBinaryStream(void const* pMem, u32 MemSize)
+MemoryBinaryStream::MemoryBinaryStream(void const* pMem, u64 MemSize)
   : BinaryStream()
 {
   Open(pMem, MemSize);
@@ -119,14 +147,14 @@ MemoryBinaryStream::~MemoryBinaryStream(void)
   Close();
 }
 
-void MemoryBinaryStream::Open(void const* pMem, u32 MemSize)
+void MemoryBinaryStream::Open(void const* pMem, u64 MemSize)
 {
   m_Path = boost::filesystem::unique_path();
-  m_pBuffer = ::malloc(MemSize);
+  m_pBuffer = ::malloc(static_cast<size_t>(MemSize));
   if (m_pBuffer == nullptr)
    throw Exception_System("malloc");
   m_Size = MemSize;
-  memcpy(m_pBuffer, pMem, MemSize);
+  memcpy(m_pBuffer, pMem, static_cast<size_t>(MemSize));
 }
 
 void MemoryBinaryStream::Close(void)
@@ -135,6 +163,7 @@ void MemoryBinaryStream::Close(void)
   m_pBuffer = nullptr;
   m_Size = 0x0;
   m_Endianness = EndianUnknown;
+  m_spOverlay->Reset();
 }
 
 MEDUSA_NAMESPACE_END
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "text_db.hpp"
 
+#include <medusa/exception.hpp>
 #include <medusa/module.hpp>
 #include <medusa/log.hpp>
 #include <medusa/util.hpp>
@@ -13,7 +14,9 @@
 #include <boost/filesystem.hpp>
 
 
-TextDatabase::TextDatabase(void) : m_DirtyLabels(false), m_IsIteratingLabels(false)
+TextDatabase::TextDatabase(void)
+  : m_ReferenceBinaryStream(false), m_IsStreamed(false), m_pStreamMemArea(nullptr)
+  , m_DirtyLabels(false), m_IsIteratingLabels(false)
 {
 }
 
@@ -54,12 +57,17 @@ bool TextDatabase::Open(boost::filesystem::path const& rDatabasePath)
   {
     UnknownState,
     BinaryStreamState,
+    BinaryStreamPathState,
+    PatchState,
     ArchitectureState,
     MemoryAreaState,
     LabelState,
     CrossReferenceState,
     MultiCellState,
     CommentState,
+    FingerprintState,
+    FunctionGraphState,
+    FunctionLayoutState,
   };
 
   State CurState = UnknownState;
@@ -67,12 +75,17 @@ bool TextDatabase::Open(boost::filesystem::path const& rDatabasePath)
   if (StrToState.empty())
   {
     StrToState["## BinaryStream"] = BinaryStreamState;
+    StrToState["## BinaryStreamPath"] = BinaryStreamPathState;
+    StrToState["## Patch"] = PatchState;
     StrToState["## Architecture"] = ArchitectureState;
     StrToState["## MemoryArea"] = MemoryAreaState;
     StrToState["## Label"] = LabelState;
     StrToState["## CrossReference"] = CrossReferenceState;
     StrToState["## MultiCell"] = MultiCellState;
     StrToState["## Comment"] = CommentState;
+    StrToState["## Fingerprint"] = FingerprintState;
+    StrToState["## FunctionGraph"] = FunctionGraphState;
+    StrToState["## FunctionLayout"] = FunctionLayoutState;
   }
 
   auto& rModMgr = ModuleManager::Instance();
@@ -99,7 +112,31 @@ bool TextDatabase::Open(boost::filesystem::path const& rDatabasePath)
         auto const RawBinStr = Base64Decode(CurLine);
         if (RawBinStr.empty())
           return false;
-        SetBinaryStream(std::make_shared<MemoryBinaryStream>(RawBinStr.c_str(), static_cast<u32>(RawBinStr.size())));
+        SetBinaryStream(std::make_shared<MemoryBinaryStream>(RawBinStr.c_str(), RawBinStr.size()));
+      }
+      break;
+    case BinaryStreamPathState:
+      try
+      {
+        SetBinaryStream(std::make_shared<FileBinaryStream>(CurLine));
+        m_ReferenceBinaryStream = true;
+      }
+      catch (Exception const& e)
+      {
+        Log::Write("db_text") << "unable to open binary stream " << CurLine << ": " << e.What() << LogEnd;
+        return false;
+      }
+      break;
+    case PatchState:
+      {
+        PatchOverlay::Patch CurPatch;
+        std::string PatchBase64;
+        std::istringstream issPatch(CurLine);
+        issPatch >> std::hex >> CurPatch.m_Offset >> PatchBase64;
+        auto const RawPatchStr = Base64Decode(PatchBase64);
+        CurPatch.m_Data.assign(std::begin(RawPatchStr), std::end(RawPatchStr));
+        if (m_spBinStrm == nullptr || !m_spBinStrm->GetOverlay()->ApplyPatches(PatchOverlay::PatchVector(1, CurPatch)))
+          Log::Write("db_text") << "unable to apply patch at " << CurPatch.m_Offset << LogEnd;
       }
       break;
     case ArchitectureState:
@@ -150,11 +187,36 @@ bool TextDatabase::Open(boost::filesystem::path const& rDatabasePath)
           iss >> Name >> VirtAddr >> VirtSize >> Access;
           pMemArea = new VirtualMemoryArea(Name, VirtAddr, VirtSize, ParseAccess(Access));
           break;
+        case 'b': // BankedMemoryArea
+          {
+            TBank BankNo;
+            iss >> Name >> FileOffset >> VirtSize >> VirtAddr >> BankNo >> Access;
+            auto pBankedMemArea = new BankedMemoryArea(Name, FileOffset, VirtSize, VirtAddr, BankNo, ParseAccess(Access));
+            BankedMemoryArea::BankRegister BankReg;
+            u16 Shift, ZeroIsOne;
+            while (iss >> BankReg.m_Begin >> BankReg.m_End >> Shift >> BankReg.m_Mask >> ZeroIsOne)
+            {
+              BankReg.m_Shift     = static_cast<u8>(Shift);
+              BankReg.m_ZeroIsOne = ZeroIsOne != 0;
+              pBankedMemArea->AddBankRegister(BankReg);
+            }
+            pMemArea = pBankedMemArea;
+          }
+          break;
         default:
           Log::Write("db_text") << "unknown memory area type" << LogEnd;
           return false;
         }
-        m_MemoryAreas.insert(pMemArea);
+
+        // A streamed database saves an area again before its cells
+        auto itMemArea = m_MemoryAreas.find(pMemArea);
+        if (itMemArea != std::end(m_MemoryAreas))
+        {
+          delete pMemArea;
+          pMemArea = *itMemArea;
+        }
+        else
+          m_MemoryAreas.insert(pMemArea);
       }
       else if (CurLine[0] == '|')
       {
@@ -266,6 +328,45 @@ bool TextDatabase::Open(boost::filesystem::path const& rDatabasePath)
           Log::Write("db_text") << "unable to set comment at " << CmtAddr << LogEnd;
       }
       break;
+    case FingerprintState:
+      {
+        Address FpAddr;
+        std::string FpDump;
+        std::istringstream issFp(CurLine);
+        issFp >> FpAddr;
+        issFp.seekg(1, std::ios::cur);
+        std::getline(issFp, FpDump);
+        FunctionFingerprint CurFp;
+        if (!CurFp.Parse(FpDump) || !SetFunctionFingerprint(FpAddr, CurFp))
+          Log::Write("db_text") << "unable to set fingerprint at " << FpAddr << LogEnd;
+      }
+      break;
+    case FunctionGraphState:
+      {
+        Address FuncAddr;
+        std::string FuncGraphDump;
+        std::istringstream issFuncGraph(CurLine);
+        issFuncGraph >> FuncAddr;
+        issFuncGraph.seekg(1, std::ios::cur);
+        std::getline(issFuncGraph, FuncGraphDump);
+        FunctionGraph CurFuncGraph;
+        if (!CurFuncGraph.Parse(FuncGraphDump) || !SetFunctionGraph(FuncAddr, CurFuncGraph))
+          Log::Write("db_text") << "unable to set function graph at " << FuncAddr << LogEnd;
+      }
+      break;
+    case FunctionLayoutState:
+      {
+        Address FuncAddr;
+        std::string FuncLayoutDump;
+        std::istringstream issFuncLayout(CurLine);
+        issFuncLayout >> FuncAddr;
+        issFuncLayout.seekg(1, std::ios::cur);
+        std::getline(issFuncLayout, FuncLayoutDump);
+        GraphLayout CurFuncLayout;
+        if (!CurFuncLayout.Parse(FuncLayoutDump) || !SetFunctionLayout(FuncAddr, CurFuncLayout))
+          Log::Write("db_text") << "unable to set function layout at " << FuncAddr << LogEnd;
+      }
+      break;
     default:
       Log::Write("db_text") << "unknown state in database" << LogEnd;
       return false;
@@ -311,33 +412,19 @@ bool TextDatabase::Flush(void)
 {
   if (m_DatabasePath.string().empty())
     return false;
+
+  // A streamed database is written by the analysis, there's nothing more in memory
+  if (m_IsStreamed)
+    return true;
+
   _FileRemoves(m_DatabasePath);
 
   std::ofstream TextFile(m_DatabasePath.string());
   if (!TextFile.is_open())
     return false;
 
-  TextFile << std::hex << std::showbase << "# Medusa Text Database\n";
-
-  // Save binary stream
-  {
-    TextFile << "## BinaryStream\n";
-    std::string Base64Data = Base64Encode(m_spBinStrm->GetBuffer(), m_spBinStrm->GetSize());
-    TextFile << Base64Data << "\n" << std::flush;
-  }
-
-  // Save architecture tag
-  {
-    std::lock_guard<std::mutex> Lock(m_ArchitectureTagLock);
-    TextFile << "## Architecture\n";
-    char const* pSep = "";
-    for (Tag ArchTag : m_ArchitectureTags)
-    {
-      TextFile << pSep << ArchTag;
-      pSep = " ";
-    }
-    TextFile << "\n";
-  }
+  if (!_SaveHeader(TextFile, m_ReferenceBinaryStream))
+    return false;
 
   // Save memory area
   {
@@ -394,6 +481,30 @@ bool TextDatabase::Flush(void)
       TextFile << itComment->first.Dump() << " " << Base64Data << "\n";
     }
   }
+
+  // Save fingerprint
+  {
+    std::lock_guard<std::mutex> Lock(m_FingerprintsMutex);
+    TextFile << "## Fingerprint\n";
+    for (auto itFp = std::begin(m_Fingerprints); itFp != std::end(m_Fingerprints); ++itFp)
+      TextFile << itFp->first.Dump() << " " << itFp->second.Dump() << "\n";
+  }
+
+  // Save function graph
+  {
+    std::lock_guard<std::mutex> Lock(m_FunctionGraphsMutex);
+    TextFile << "## FunctionGraph\n";
+    for (auto itFuncGraph = std::begin(m_FunctionGraphs); itFuncGraph != std::end(m_FunctionGraphs); ++itFuncGraph)
+      TextFile << itFuncGraph->first.Dump() << " " << itFuncGraph->second.Dump() << "\n";
+  }
+
+  // Save function layout
+  {
+    std::lock_guard<std::mutex> Lock(m_FunctionLayoutsMutex);
+    TextFile << "## FunctionLayout\n";
+    for (auto itFuncLayout = std::begin(m_FunctionLayouts); itFuncLayout != std::end(m_FunctionLayouts); ++itFuncLayout)
+      TextFile << itFuncLayout->first.Dump() << " " << itFuncLayout->second.Dump() << "\n";
+  }
   TextFile.flush();
   return true;
 }
@@ -402,6 +513,95 @@ bool TextDatabase::Close(void)
 {
   bool Res = Flush();
   m_DatabasePath = boost::filesystem::path();
+  m_ReferenceBinaryStream = false;
+  m_IsStreamed = false;
+  return Res;
+}
+
+bool TextDatabase::BeginStream(void)
+{
+  if (m_DatabasePath.string().empty() || m_spBinStrm == nullptr || m_StreamFile.is_open())
+    return false;
+
+  _FileRemoves(m_DatabasePath);
+  m_StreamFile.open(m_DatabasePath.string());
+  if (!m_StreamFile.is_open())
+    return false;
+
+  // Labels are interleaved with cells, so they're kept in another file until the end of the stream
+  m_StreamLabelPath = m_DatabasePath;
+  m_StreamLabelPath += ".lbl";
+  m_StreamLabelFile.open(m_StreamLabelPath.string());
+  if (!m_StreamLabelFile.is_open())
+    return false;
+  m_StreamLabelFile << std::hex << std::showbase;
+
+  // The image is usually too large to be copied in the database
+  m_ReferenceBinaryStream = true;
+  if (!_SaveHeader(m_StreamFile, m_ReferenceBinaryStream))
+    return false;
+
+  // Areas are saved first, so they're known even if nothing is found in them
+  {
+    std::lock_guard<std::mutex> Lock(m_MemoryAreaLock);
+    m_StreamFile << "## MemoryArea\n";
+    for (MemoryArea* pMemArea : m_MemoryAreas)
+      m_StreamFile << pMemArea->Dump() << "\n";
+  }
+  m_pStreamMemArea = nullptr;
+  return m_StreamFile.good();
+}
+
+bool TextDatabase::StreamCellData(Address const& rAddress, CellData const& rCellData)
+{
+  if (!m_StreamFile.is_open())
+    return false;
+
+  // Cell offsets are relative to the last saved area, so it's saved again before the cells of another one
+  MemoryArea const* pMemArea = m_pStreamMemArea;
+  if (pMemArea == nullptr || !pMemArea->IsCellPresent(rAddress))
+    pMemArea = GetMemoryArea(rAddress);
+  if (pMemArea == nullptr)
+    return false;
+  if (pMemArea != m_pStreamMemArea)
+  {
+    m_StreamFile << pMemArea->Dump() << "\n";
+    m_pStreamMemArea = pMemArea;
+  }
+  m_StreamFile << "|" << (rAddress.GetOffset() - pMemArea->GetBaseAddress().GetOffset()) << " " << rCellData.Dump() << "\n";
+  return m_StreamFile.good();
+}
+
+bool TextDatabase::StreamLabel(Address const& rAddress, Label const& rLabel)
+{
+  if (!m_StreamLabelFile.is_open())
+    return false;
+
+  m_StreamLabelFile << rAddress.Dump() << " " << rLabel.Dump() << "\n";
+  return m_StreamLabelFile.good();
+}
+
+bool TextDatabase::EndStream(void)
+{
+  if (!m_StreamFile.is_open())
+    return false;
+
+  bool Res = m_StreamLabelFile.is_open();
+  if (Res)
+  {
+    m_StreamLabelFile.close();
+    std::ifstream LabelFile(m_StreamLabelPath.string());
+    m_StreamFile << "## Label\n";
+    if (LabelFile.peek() != std::ifstream::traits_type::eof())
+      m_StreamFile << LabelFile.rdbuf();
+    Res = !LabelFile.bad();
+  }
+  _FileRemoves(m_StreamLabelPath);
+
+  m_StreamFile.flush();
+  Res = Res && m_StreamFile.good();
+  m_StreamFile.close();
+  m_IsStreamed = true;
   return Res;
 }
 
@@ -529,6 +729,35 @@ bool TextDatabase::AddLabel(Address const& rAddress, Label const& rLabel)
   return true;
 }
 
+bool TextDatabase::AddLabels(LabelVector const& rLabels, bool Force, LabelVector& rRemovedLabels, LabelVector& rAddedLabels)
+{
+  std::lock_guard<std::recursive_mutex> Lock(m_LabelLock);
+  for (auto const& rLblPair : rLabels)
+  {
+    Address const& rAddr = rLblPair.first;
+    Label NewLbl = rLblPair.second;
+
+    auto itOldLbl = m_LabelMap.left.find(rAddr);
+    if (itOldLbl != std::end(m_LabelMap.left))
+    {
+      if ((!Force && !itOldLbl->second.IsAutoGenerated()) || itOldLbl->second == NewLbl)
+        continue;
+      rRemovedLabels.push_back(std::make_pair(rAddr, itOldLbl->second));
+      m_LabelMap.left.erase(itOldLbl);
+      if (m_IsIteratingLabels)
+        m_DirtyLabels = true;
+    }
+
+    // The address is free, so the insertion can only fail because the name is used
+    while (!m_LabelMap.insert(LabelBimapType::value_type(rAddr, NewLbl)).second)
+      NewLbl.IncrementVersion();
+    rAddedLabels.push_back(std::make_pair(rAddr, NewLbl));
+    if (m_IsIteratingLabels)
+      m_VisitedLabels[rAddr] = false;
+  }
+  return true;
+}
+
 bool TextDatabase::RemoveLabel(Address const& rAddress)
 {
   std::lock_guard<std::recursive_mutex> Lock(m_LabelLock);
@@ -602,6 +831,15 @@ bool TextDatabase::AddCrossReference(Address const& rTo, Address const& rFrom)
   return m_CrossReferences.AddXRef(rTo, rFrom);
 }
 
+bool TextDatabase::AddCrossReferences(CrossReferenceVector const& rCrossRefs)
+{
+  std::lock_guard<std::mutex> Lock(m_CrossReferencesLock);
+  bool Res = true;
+  for (auto const& rXRef : rCrossRefs)
+    Res &= m_CrossReferences.AddXRef(rXRef.first, rXRef.second);
+  return Res;
+}
+
 bool TextDatabase::RemoveCrossReference(Address const& rFrom)
 {
   std::lock_guard<std::mutex> Lock(m_CrossReferencesLock);
@@ -735,6 +973,59 @@ bool TextDatabase::SetComment(Address const& rAddress, std::string const& rComme
   return true;
 }
 
+bool TextDatabase::_SaveHeader(std::ostream& rTextFile, bool ReferenceBinaryStream)
+{
+  rTextFile << std::hex << std::showbase << "# Medusa Text Database\n";
+
+  // Save binary stream, a file can be referenced by its path instead of being copied
+  if (ReferenceBinaryStream && dynamic_cast<FileBinaryStream const*>(m_spBinStrm.get()) != nullptr)
+  {
+    rTextFile << "## BinaryStreamPath\n";
+    rTextFile << boost::filesystem::absolute(m_spBinStrm->GetPath()).string() << "\n";
+  }
+  else
+  {
+    rTextFile << "## BinaryStream\n";
+
+    // The stream could be too large to be mapped at once, a chunk size multiple of 3 produces no padding
+    std::vector<u8> Chunk(3 * 0x100000);
+    u64 StrmSize = m_spBinStrm->GetSize();
+    for (TOffset CurOff = 0; CurOff < StrmSize; CurOff += Chunk.size())
+    {
+      u32 ChunkSize = static_cast<u32>(std::min<u64>(Chunk.size(), StrmSize - CurOff));
+      if (!m_spBinStrm->ReadOriginal(CurOff, Chunk.data(), ChunkSize))
+        return false;
+      rTextFile << Base64Encode(Chunk.data(), ChunkSize);
+    }
+    rTextFile << "\n" << std::flush;
+  }
+
+  // Save patches, only modified bytes are stored
+  {
+    PatchOverlay::PatchVector Patches;
+    if (!m_spBinStrm->GetOverlay()->GetPatches(Patches))
+      return false;
+    rTextFile << "## Patch\n";
+    for (auto const& rPatch : Patches)
+      rTextFile << rPatch.m_Offset << " " << Base64Encode(rPatch.m_Data.data(), static_cast<u32>(rPatch.m_Data.size())) << "\n";
+  }
+
+  // Save architecture tag
+  {
+    std::lock_guard<std::mutex> Lock(m_ArchitectureTagLock);
+    rTextFile << "## Architecture\n";
+    char const* pSep = "";
+    for (Tag ArchTag : m_ArchitectureTags)
+    {
+      rTextFile << pSep << ArchTag;
+      pSep = " ";
+    }
+    rTextFile << "\n";
+  }
+
+  return rTextFile.good();
+}
+
 bool TextDatabase::_FileExists(boost::filesystem::path const& rFilePath)
 {
   return boost::filesystem::exists(rFilePath);
@@ -932,3 +1223,54 @@ bool TextDatabase::UnbindDetailId(Address const& rAddress, u8 Index)
   itId->second[Index] = Id();
   return true;
 }
+
+bool TextDatabase::GetFunctionFingerprint(Address const& rFuncAddr, FunctionFingerprint& rFingerprint) const
+{
+  std::lock_guard<std::mutex> Lock(m_FingerprintsMutex);
+  auto itFp = m_Fingerprints.find(rFuncAddr);
+  if (itFp == std::end(m_Fingerprints))
+    return false;
+  rFingerprint = itFp->second;
+  return true;
+}
+
+bool TextDatabase::SetFunctionFingerprint(Address const& rFuncAddr, FunctionFingerprint const& rFingerprint)
+{
+  std::lock_guard<std::mutex> Lock(m_FingerprintsMutex);
+  m_Fingerprints[rFuncAddr] = rFingerprint;
+  return true;
+}
+
+bool TextDatabase::GetFunctionGraph(Address const& rFuncAddr, FunctionGraph& rFuncGraph) const
+{
+  std::lock_guard<std::mutex> Lock(m_FunctionGraphsMutex);
+  auto itFuncGraph = m_FunctionGraphs.find(rFuncAddr);
+  if (itFuncGraph == std::end(m_FunctionGraphs))
+    return false;
+  rFuncGraph = itFuncGraph->second;
+  return true;
+}
+
+bool TextDatabase::SetFunctionGraph(Address const& rFuncAddr, FunctionGraph const& rFuncGraph)
+{
+  std::lock_guard<std::mutex> Lock(m_FunctionGraphsMutex);
+  m_FunctionGraphs[rFuncAddr] = rFuncGraph;
+  return true;
+}
+
+bool TextDatabase::GetFunctionLayout(Address const& rFuncAddr, GraphLayout& rFuncLayout) const
+{
+  std::lock_guard<std::mutex> Lock(m_FunctionLayoutsMutex);
+  auto itFuncLayout = m_FunctionLayouts.find(rFuncAddr);
+  if (itFuncLayout == std::end(m_FunctionLayouts))
+    return false;
+  rFuncLayout = itFuncLayout->second;
+  return true;
+}
+
+bool TextDatabase::SetFunctionLayout(Address const& rFuncAddr, GraphLayout const& rFuncLayout)
+{
+  std::lock_guard<std::mutex> Lock(m_FunctionLayoutsMutex);
+  m_FunctionLayouts[rFuncAddr] = rFuncLayout;
+  return true;
+}
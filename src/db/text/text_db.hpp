@@ -39,6 +39,9 @@ public:
   typedef std::map<Id, StructureDetail>                StructureDetailMapType;
   typedef std::map<Id, FunctionDetail>                 FunctioNDetailMapType;
   typedef std::unordered_map<Address, std::vector<Id>> IdMapType;
+  typedef std::unordered_map<Address, FunctionFingerprint> FingerprintMapType;
+  typedef std::unordered_map<Address, FunctionGraph>       FunctionGraphMapType;
+  typedef std::unordered_map<Address, GraphLayout>         FunctionLayoutMapType;
 
   TextDatabase(void);
   virtual ~TextDatabase(void);
@@ -52,6 +55,12 @@ public:
   virtual bool Flush(void);
   virtual bool Close(void);
 
+  // Stream
+  virtual bool BeginStream(void);
+  virtual bool StreamCellData(Address const& rAddress, CellData const& rCellData);
+  virtual bool StreamLabel(Address const& rAddress, Label const& rLabel);
+  virtual bool EndStream(void);
+
   // BinaryStream
   //virtual FileBinaryStream const& GetFileBinaryStream(void) const;
 
@@ -84,11 +93,15 @@ public:
 
   virtual void ForEachLabel(LabelCallback Callback);
 
+  virtual bool AddLabels(LabelVector const& rLabels, bool Force, LabelVector& rRemovedLabels, LabelVector& rAddedLabels);
+
   // CrossRef
   virtual bool AddCrossReference(Address const& rTo, Address const& rFrom);
   virtual bool RemoveCrossReference(Address const& rFrom);
   virtual bool RemoveCrossReferences(void);
 
+  virtual bool AddCrossReferences(CrossReferenceVector const& rCrossRefs);
+
   virtual bool HasCrossReferenceFrom(Address const& rTo) const;
   virtual bool GetCrossReferenceFrom(Address const& rTo, Address::List& rFromList) const;
 
@@ -124,6 +137,18 @@ public:
   virtual bool BindDetailId(Address const& rAddress, u8 Index, Id DtlId);
   virtual bool UnbindDetailId(Address const& rAddress, u8 Index);
 
+  // Fingerprint
+  virtual bool GetFunctionFingerprint(Address const& rFuncAddr, FunctionFingerprint& rFingerprint) const;
+  virtual bool SetFunctionFingerprint(Address const& rFuncAddr, FunctionFingerprint const& rFingerprint);
+
+  // Function graph
+  virtual bool GetFunctionGraph(Address const& rFuncAddr, FunctionGraph& rFuncGraph) const;
+  virtual bool SetFunctionGraph(Address const& rFuncAddr, FunctionGraph const& rFuncGraph);
+
+  // Function layout
+  virtual bool GetFunctionLayout(Address const& rFuncAddr, GraphLayout& rFuncLayout) const;
+  virtual bool SetFunctionLayout(Address const& rFuncAddr, GraphLayout const& rFuncLayout);
+
 private:
   static bool _FileExists(boost::filesystem::path const& rFilePath);
   static bool _FileRemoves(boost::filesystem::path const& rFilePath);
@@ -132,7 +157,17 @@ private:
   bool _MoveAddressBackward(Address const& rAddress, Address& rMovedAddress, s64 Offset) const;
   bool _MoveAddressForward(Address const& rAddress, Address& rMovedAddress, s64 Offset) const;
 
+  //! This method saves the binary stream, its patches and the architectures.
+  bool _SaveHeader(std::ostream& rTextFile, bool ReferenceBinaryStream);
+
   boost::filesystem::path m_DatabasePath;
+  bool                    m_ReferenceBinaryStream; //! the binary stream is saved as a path instead of its content
+
+  std::ofstream           m_StreamFile;
+  std::ofstream           m_StreamLabelFile;
+  boost::filesystem::path m_StreamLabelPath;
+  bool                    m_IsStreamed;
+  MemoryArea const*       m_pStreamMemArea; //! the last saved area, cell offsets are relative to it
 
   std::list<Tag>     m_ArchitectureTags;
   mutable std::mutex m_ArchitectureTagLock;
@@ -159,6 +194,15 @@ private:
   FunctioNDetailMapType  m_FunctionsDetail;
   IdMapType              m_Ids;
   mutable std::mutex     m_DetailMutex;
+
+  FingerprintMapType m_Fingerprints;
+  mutable std::mutex m_FingerprintsMutex;
+
+  FunctionGraphMapType m_FunctionGraphs;
+  mutable std::mutex   m_FunctionGraphsMutex;
+
+  FunctionLayoutMapType m_FunctionLayouts;
+  mutable std::mutex    m_FunctionLayoutsMutex;
 };
 
 extern "C" DB_TEXT_EXPORT Database* GetDatabase(void);
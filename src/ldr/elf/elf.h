@@ -399,6 +399,7 @@ typedef struct
 #define STT_TLS    6    /* Symbol is thread-local data object*/
 #define STT_NUM    7    /* Number of defined types.  */
 #define STT_LOOS  10    /* Start of OS-specific */
+#define STT_GNU_IFUNC  10    /* Symbol is indirect code object */
 #define STT_HIOS  12    /* End of OS-specific */
 #define STT_LOPROC  13    /* Start of processor-specific */
 #define STT_HIPROC  15    /* End of processor-specific */
@@ -640,6 +641,7 @@ typedef struct
    If any adjustment is made to the ELF object after it has been
    built these entries will need to be adjusted.  */
 #define DT_ADDRRNGLO     0x6ffffe00
+#define DT_GNU_HASH      0x6ffffef5  /* GNU-style hash table.  */
 #define DT_GNU_CONFLICT  0x6ffffef8  /* Start of conflict section */
 #define DT_GNU_LIBLIST   0x6ffffef9  /* Library list */
 #define DT_CONFIG        0x6ffffefa  /* Configuration information.  */
@@ -1046,8 +1048,9 @@ typedef struct
 #define R_386_TLS_DTPMOD32 35    /* ID of module containing symbol */
 #define R_386_TLS_DTPOFF32 36    /* Offset in TLS block */
 #define R_386_TLS_TPOFF32  37    /* Negated offset in static TLS block */
+#define R_386_IRELATIVE    42    /* Adjust indirectly by program base */
 /* Keep this the last entry.  */
-#define R_386_NUM     38
+#define R_386_NUM     43
 
 /* SUN SPARC specific definitions.  */
 
@@ -2042,6 +2045,9 @@ typedef Elf32_Addr Elf32_Conflict;
 #define R_ARM_THM_SWI8    14
 #define R_ARM_XPC25    15
 #define R_ARM_THM_XPC22    16
+#define R_ARM_TLS_DTPMOD32  17  /* ID of module containing symbol */
+#define R_ARM_TLS_DTPOFF32  18  /* Offset in TLS block */
+#define R_ARM_TLS_TPOFF32  19  /* Offset in static TLS block */
 #define R_ARM_COPY    20  /* Copy symbol at runtime */
 #define R_ARM_GLOB_DAT    21  /* Create GOT entry */
 #define R_ARM_JUMP_SLOT    22  /* Create PLT entry */
@@ -2060,6 +2066,7 @@ typedef Elf32_Addr Elf32_Conflict;
 #define R_ARM_GNU_VTINHERIT  101
 #define R_ARM_THM_PC11    102  /* thumb unconditional branch */
 #define R_ARM_THM_PC9    103  /* thumb conditional branch */
+#define R_ARM_IRELATIVE    160  /* Adjust indirectly by program base */
 #define R_ARM_RXPC25    249
 #define R_ARM_RSBREL32    250
 #define R_ARM_THM_RPC22    251
@@ -2338,7 +2345,15 @@ typedef Elf32_Addr Elf32_Conflict;
 #define R_X86_64_GOTTPOFF  22  /* 32 bit signed PC relative offset
              to GOT entry for IE symbol */
 #define R_X86_64_TPOFF32  23  /* Offset in initial TLS block */
+#define R_X86_64_PC64    24  /* PC relative 64 bit */
+#define R_X86_64_GOTOFF64  25  /* 64 bit offset to GOT */
+#define R_X86_64_GOTPC32  26  /* 32 bit signed pc relative
+             offset to GOT */
+#define R_X86_64_SIZE32    32  /* Size of symbol plus 32-bit addend */
+#define R_X86_64_SIZE64    33  /* Size of symbol plus 64-bit addend */
+#define R_X86_64_IRELATIVE  37  /* Adjust indirectly by program base */
+#define R_X86_64_RELATIVE64  38  /* 64-bit adjust by program base */
 
-#define R_X86_64_NUM    24
+#define R_X86_64_NUM    39
 
 #endif // !LDR_ELF_TYPE_HPP
\ No newline at end of file
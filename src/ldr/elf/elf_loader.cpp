@@ -96,3 +96,91 @@ bool ElfLoader::FindArchitectureTagAndModeByMachine(
 
   return false;
 }
+
+ElfLoader::RelocationKind ElfLoader::_GetRelocationKind(u32 Type, u8& rSize) const
+{
+  rSize = 0;
+
+  switch (m_Machine)
+  {
+  case EM_386:
+    switch (Type)
+    {
+    case R_386_32:        rSize = 4; return RelocAbsolute;
+    case R_386_16:        rSize = 2; return RelocAbsolute;
+    case R_386_8:         rSize = 1; return RelocAbsolute;
+    case R_386_PC32:
+    case R_386_PLT32:     rSize = 4; return RelocPcRelative;
+    case R_386_PC16:      rSize = 2; return RelocPcRelative;
+    case R_386_PC8:       rSize = 1; return RelocPcRelative;
+    case R_386_GLOB_DAT:
+    case R_386_JMP_SLOT:  rSize = 4; return RelocSymbol;
+    case R_386_RELATIVE:  rSize = 4; return RelocRelative;
+    case R_386_IRELATIVE: rSize = 4; return RelocIndirect;
+    default:                         return RelocNone;
+    }
+
+  case EM_X86_64:
+    switch (Type)
+    {
+    case R_X86_64_64:         rSize = 8; return RelocAbsolute;
+    case R_X86_64_32:
+    case R_X86_64_32S:        rSize = 4; return RelocAbsolute;
+    case R_X86_64_16:         rSize = 2; return RelocAbsolute;
+    case R_X86_64_8:          rSize = 1; return RelocAbsolute;
+    case R_X86_64_PC64:       rSize = 8; return RelocPcRelative;
+    case R_X86_64_PC32:
+    case R_X86_64_PLT32:      rSize = 4; return RelocPcRelative;
+    case R_X86_64_PC16:       rSize = 2; return RelocPcRelative;
+    case R_X86_64_PC8:        rSize = 1; return RelocPcRelative;
+    case R_X86_64_GLOB_DAT:
+    case R_X86_64_JUMP_SLOT:  rSize = 8; return RelocSymbol;
+    case R_X86_64_RELATIVE:
+    case R_X86_64_RELATIVE64: rSize = 8; return RelocRelative;
+    case R_X86_64_IRELATIVE:  rSize = 8; return RelocIndirect;
+    default:                             return RelocNone;
+    }
+
+  case EM_ARM:
+    switch (Type)
+    {
+    case R_ARM_ABS32:     rSize = 4; return RelocAbsolute;
+    case R_ARM_ABS16:     rSize = 2; return RelocAbsolute;
+    case R_ARM_ABS8:      rSize = 1; return RelocAbsolute;
+    case R_ARM_REL32:     rSize = 4; return RelocPcRelative;
+    case R_ARM_GLOB_DAT:
+    case R_ARM_JUMP_SLOT: rSize = 4; return RelocSymbol;
+    case R_ARM_RELATIVE:  rSize = 4; return RelocRelative;
+    case R_ARM_IRELATIVE: rSize = 4; return RelocIndirect;
+    default:                         return RelocNone;
+    }
+
+  default:
+    return RelocNone;
+  }
+}
+
+PatchOverlay::Patch ElfLoader::_MakeRelocationPatch(TOffset Offset, u64 Value, u8 Size, EEndianness Endianness)
+{
+  PatchOverlay::Patch RelPatch;
+  RelPatch.m_Offset = Offset;
+  RelPatch.m_Data.resize(Size);
+  for (u8 i = 0; i < Size; ++i)
+  {
+    u8 ByteIdx = (Endianness == BigEndian) ? Size - 1 - i : i;
+    RelPatch.m_Data[ByteIdx] = static_cast<u8>(Value >> (i * 8));
+  }
+  return RelPatch;
+}
+
+bool ElfLoader::_ReadAddend(BinaryStream const& rBinStrm, TOffset Offset, u8 Size, s64& rAddend)
+{
+  switch (Size)
+  {
+  case 1: { s8  Addend; if (!rBinStrm.Read(Offset, Addend)) return false; rAddend = Addend; return true; }
+  case 2: { s16 Addend; if (!rBinStrm.Read(Offset, Addend)) return false; rAddend = Addend; return true; }
+  case 4: { s32 Addend; if (!rBinStrm.Read(Offset, Addend)) return false; rAddend = Addend; return true; }
+  case 8: { s64 Addend; if (!rBinStrm.Read(Offset, Addend)) return false; rAddend = Addend; return true; }
+  default: return false;
+  }
+}
@@ -5,11 +5,19 @@
 #include <medusa/document.hpp>
 #include <medusa/loader.hpp>
 #include <medusa/log.hpp>
+#include <medusa/patch_overlay.hpp>
 
 #include "elf.h"
 #include "elf_traits.hpp"
 
-#include <boost/foreach.hpp> // TODO: Use c++11 foreach instead of BOOST_FOREACH
+#include <medusa/util.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
 
 MEDUSA_NAMESPACE_USE
 
@@ -45,7 +53,7 @@ private:
       ) const;
 
   // TODO: Move and clean this function
-  template<int bit> void Map(Document& rDoc, Architecture::VSPType const& rArchs) // TODO: Use unique_ptr instead of new/delete to avoid memleak in case of exception
+  template<int bit> void Map(Document& rDoc, Architecture::VSPType const& rArchs)
   {
     if (rArchs.empty())
       return;
@@ -69,8 +77,6 @@ private:
 
     typedef ElfTraits<bit> ElfType;
     typename ElfType::Ehdr Ehdr;
-    typename ElfType::Shdr* pShStrShdr = nullptr;
-    char* pShStrTbl;
 
     if (!rBinStrm.Read(0x0, &Ehdr, sizeof(Ehdr)))
     {
@@ -79,94 +85,80 @@ private:
     }
     ElfType::EndianSwap(Ehdr, Endianness);
 
-    std::vector<typename ElfType::Shdr*> Sections;
-    std::vector<typename ElfType::Phdr*> Segments;
-
-    Sections.reserve(Ehdr.e_shnum);
-    Segments.reserve(Ehdr.e_phnum);
-
+    // Tables are read at once, string tables are used in place if the file is mapped
+    std::vector<typename ElfType::Shdr> Shdrs;
+    std::vector<typename ElfType::Shdr> Sections;
+    std::vector<typename ElfType::Phdr> Segments;
+    std::vector<char>                   ShStrStorage;
+    Span<char const>                    ShStrTbl;
 
     // Are we lucky enough to have section header?
     // We must be very carefull since Section header are not mandatory to load an executable
     // in fact, the kernel doesn't even bother reading it.
     if (Ehdr.e_shoff != 0x0)
     {
-      // Retrieve section header string tables
-      pShStrShdr = new typename ElfType::Shdr;
-      if (!rBinStrm.Read(Ehdr.e_shoff + sizeof(*pShStrShdr) * Ehdr.e_shstrndx, pShStrShdr, sizeof(*pShStrShdr)))
+      if (!rBinStrm.ReadArray(Ehdr.e_shoff, Ehdr.e_shnum, Shdrs))
       {
-        Log::Write("ldr_elf") << "Can't read SHSTR" << LogEnd;
+        Log::Write("ldr_elf") << "Can't read SHDR" << LogEnd;
         return;
       }
+      for (auto& rShdr : Shdrs)
+        ElfType::EndianSwap(rShdr, Endianness);
 
       rDoc.AddLabel(Address(Address::FlatType, 0x0, Ehdr.e_entry, 0x10, bit), Label("start", Label::Code | Label::Exported));
 
-      ElfType::EndianSwap(*pShStrShdr, Endianness);
-
-      if (pShStrShdr->sh_size > rBinStrm.GetSize())
+      // Retrieve section header string tables
+      if (Ehdr.e_shstrndx >= Shdrs.size())
+        Log::Write("ldr_elf") << "Can't read SHSTR" << LogEnd;
+      else if (Shdrs[Ehdr.e_shstrndx].sh_size > rBinStrm.GetSize())
         Log::Write("ldr_elf") << "Section string size is corrupted" << LogEnd;
       else
       {
-        pShStrTbl = new char[static_cast<u32>(pShStrShdr->sh_size)];
-        if (!rBinStrm.Read(pShStrShdr->sh_offset, pShStrTbl, static_cast<u32>(pShStrShdr->sh_size)))
+        auto const& rShStrShdr = Shdrs[Ehdr.e_shstrndx];
+        if (!rBinStrm.ReadSpan(rShStrShdr.sh_offset, rShStrShdr.sh_size, ShStrTbl, ShStrStorage))
         {
           Log::Write("ldr_elf") << "Can't read string SHDR" << LogEnd;
           return;
         }
       }
 
-      // Read all section headers
-      for (typename ElfType::Half Scn = 0; Scn < Ehdr.e_shnum; ++Scn)
+      for (auto const& rShdr : Shdrs)
       {
-        typename ElfType::Shdr* pShdr = new typename ElfType::Shdr;
-
-        if (!rBinStrm.Read(Ehdr.e_shoff + sizeof(*pShdr) * Scn, pShdr, sizeof(*pShdr)))
-        {
-          Log::Write("ldr_elf") << "Can't read SHDR" << LogEnd;
-          continue;
-        }
-        if (pShdr->sh_size == 0)
+        if (rShdr.sh_size == 0)
           continue;
-        ElfType::EndianSwap(*pShdr, Endianness);
         Log::Write("ldr_elf") << "Section found"
-          << ": va="     << pShdr->sh_addr
-          << ", offset=" << pShdr->sh_offset
-          << ", size="   << pShdr->sh_size
-          << ", name="   << pShStrTbl + pShdr->sh_name
+          << ": va="     << rShdr.sh_addr
+          << ", offset=" << rShdr.sh_offset
+          << ", size="   << rShdr.sh_size
+          << ", name="   << _GetString(ShStrTbl, rShdr.sh_name)
           << LogEnd;
 
-        if (pShdr->sh_addr == 0x0)
+        if (rShdr.sh_addr == 0x0)
           continue;
-        Sections.push_back(pShdr);
+        Sections.push_back(rShdr);
       }
     }
 
     // Are we lucky enough to have program segment header?
     if (Ehdr.e_phoff != 0x0)
     {
-      // Real all program segment headers
-      for (typename ElfType::Half Segment = 0; Segment < Ehdr.e_phnum; ++Segment)
-      {
-        typename ElfType::Phdr* pPhdr = new typename ElfType::Phdr;
+      std::vector<typename ElfType::Phdr> Phdrs;
+      if (!rBinStrm.ReadArray(Ehdr.e_phoff, Ehdr.e_phnum, Phdrs))
+        Log::Write("ldr_elf") << "Can't read PHDR" << LogEnd;
 
-        if (!rBinStrm.Read(Ehdr.e_phoff + sizeof(*pPhdr) * Segment, pPhdr, sizeof(*pPhdr)))
-        {
-          Log::Write("ldr_elf") << "Can't read PHDR" << LogEnd;
-          continue;
-        }
+      for (auto& rPhdr : Phdrs)
+      {
+        ElfType::EndianSwap(rPhdr, Endianness);
 
         // At this time, we only want PT_LOAD and PT_DYNAMIC type
-        if (pPhdr->p_type != PT_LOAD && pPhdr->p_type != PT_DYNAMIC)
-        {
-          delete pPhdr;
+        if (rPhdr.p_type != PT_LOAD && rPhdr.p_type != PT_DYNAMIC)
           continue;
-        }
 
-        Segments.push_back(pPhdr);
+        Segments.push_back(rPhdr);
         Log::Write("ldr_elf") << "Segment found"
-          << ": va="      << pPhdr->p_vaddr
-          << ", offset=" << pPhdr->p_offset
-          << ", memsz="  << pPhdr->p_memsz
+          << ": va="      << rPhdr.p_vaddr
+          << ", offset=" << rPhdr.p_offset
+          << ", memsz="  << rPhdr.p_memsz
           << LogEnd;
       }
     }
@@ -184,23 +176,19 @@ private:
     else if (Segments.size() == 0)
     {
       Log::Write("ldr_elf") << "Relocatable object" << LogEnd;
-      BOOST_FOREACH(typename ElfType::Shdr* pShdr, Sections)
+      for (auto const& rShdr : Sections)
       {
-        char const* ShName =
-          pShStrShdr && pShdr->sh_name > pShStrShdr->sh_size ?
-          "" : pShStrTbl + pShdr->sh_name;
-
         u32 MemAreaFlags = MemoryArea::Read;
 
-        if (pShdr->sh_flags & SHF_WRITE)
+        if (rShdr.sh_flags & SHF_WRITE)
           MemAreaFlags |= MemoryArea::Write;
-        if (pShdr->sh_flags & SHF_EXECINSTR)
+        if (rShdr.sh_flags & SHF_EXECINSTR)
           MemAreaFlags |= MemoryArea::Execute;
 
         rDoc.AddMemoryArea(new MappedMemoryArea(
-          ShName,
-          0x0,  static_cast<u32>(pShdr->sh_size),
-          Address(Address::FlatType, 0x0, pShdr->sh_addr, 16, bit), static_cast<u32>(pShdr->sh_size),
+          _GetString(ShStrTbl, rShdr.sh_name),
+          0x0,  static_cast<u32>(rShdr.sh_size),
+          Address(Address::FlatType, 0x0, rShdr.sh_addr, 16, bit), static_cast<u32>(rShdr.sh_size),
           MemAreaFlags,
           ArchTag, ArchMode
           ));
@@ -221,24 +209,22 @@ private:
       if (Sections.size() >= Segments.size())
       {
         Log::Write("ldr_elf") << "Relocatable object" << LogEnd;
-        BOOST_FOREACH(typename ElfType::Shdr* pShdr, Sections)
+        for (auto const& rShdr : Sections)
         {
-          char const* ShName =
-            pShStrShdr && pShdr->sh_name > pShStrShdr->sh_size ?
-            "" : pShStrTbl + pShdr->sh_name;
+          std::string ShName = _GetString(ShStrTbl, rShdr.sh_name);
 
           u32 MemAreaFlags = MemoryArea::Read;
 
-          if (pShdr->sh_flags & SHF_WRITE)
+          if (rShdr.sh_flags & SHF_WRITE)
             MemAreaFlags |= MemoryArea::Write;
-          if (pShdr->sh_flags & SHF_EXECINSTR)
+          if (rShdr.sh_flags & SHF_EXECINSTR)
             MemAreaFlags |= MemoryArea::Execute;
 
-          if (pShdr->sh_type == SHT_NOBITS)
+          if (rShdr.sh_type == SHT_NOBITS)
           {
             rDoc.AddMemoryArea(new VirtualMemoryArea(
               ShName,
-              Address(Address::FlatType, 0x0, pShdr->sh_addr, 16, bit), static_cast<u32>(pShdr->sh_size),
+              Address(Address::FlatType, 0x0, rShdr.sh_addr, 16, bit), static_cast<u32>(rShdr.sh_size),
               MemAreaFlags,
               ArchMode, ArchMode
               ));
@@ -247,8 +233,8 @@ private:
           {
             rDoc.AddMemoryArea(new MappedMemoryArea(
               ShName,
-              pShdr->sh_offset, static_cast<u32>(pShdr->sh_size),
-              Address(Address::FlatType, 0x0, pShdr->sh_addr, 16, bit), static_cast<u32>(pShdr->sh_size),
+              rShdr.sh_offset, static_cast<u32>(rShdr.sh_size),
+              Address(Address::FlatType, 0x0, rShdr.sh_addr, 16, bit), static_cast<u32>(rShdr.sh_size),
               MemAreaFlags,
               ArchTag, ArchMode
               ));
@@ -259,15 +245,15 @@ private:
       else
       {
         u32 PhdrNo = 0;
-        BOOST_FOREACH(typename ElfType::Phdr* pPhdr, Segments)
+        for (auto const& rPhdr : Segments)
         {
           u32 MemAreaFlags = 0x0;
 
-          if (pPhdr->p_flags & PF_X)
+          if (rPhdr.p_flags & PF_X)
             MemAreaFlags |= MemoryArea::Execute;
-          if (pPhdr->p_flags & PF_W)
+          if (rPhdr.p_flags & PF_W)
             MemAreaFlags |= MemoryArea::Write;
-          if (pPhdr->p_flags & PF_R)
+          if (rPhdr.p_flags & PF_R)
             MemAreaFlags |= MemoryArea::Read;
 
           std::ostringstream ShName;
@@ -275,8 +261,8 @@ private:
 
           rDoc.AddMemoryArea(new MappedMemoryArea(
                 ShName.str(),
-                pPhdr->p_offset, static_cast<u32>(pPhdr->p_filesz),
-                Address(Address::FlatType, 0x0, pPhdr->p_vaddr, 16, bit), static_cast<u32>(pPhdr->p_memsz),
+                rPhdr.p_offset, static_cast<u32>(rPhdr.p_filesz),
+                Address(Address::FlatType, 0x0, rPhdr.p_vaddr, 16, bit), static_cast<u32>(rPhdr.p_memsz),
                 MemAreaFlags,
                 ArchTag, ArchMode
                 ));
@@ -284,256 +270,470 @@ private:
       }
     }
 
-    /* Try to retrieve imported function */
-    BOOST_FOREACH(typename ElfType::Phdr* pPhdr, Segments)
+    if (!Segments.empty() || !Sections.empty())
+      _MapSymbolsAndRelocations<bit>(rDoc, Ehdr, Shdrs, Sections, Segments, Endianness);
+  }
+
+  enum RelocationKind
+  {
+    RelocNone,       //! the relocation doesn't reference a pointer, e.g. TLS or GOT relative
+    RelocAbsolute,   //! S + A
+    RelocPcRelative, //! S + A - P
+    RelocSymbol,     //! S
+    RelocRelative,   //! B + A
+    RelocIndirect,   //! B + A is the address of a resolver function
+  };
+
+  //! This method returns how a relocation type of the current machine is resolved, and its size in bytes.
+  RelocationKind _GetRelocationKind(u32 Type, u8& rSize) const;
+
+  template<int bit> void _MapSymbolsAndRelocations(
+    Document& rDoc,
+    typename ElfTraits<bit>::Ehdr const& rEhdr,
+    std::vector<typename ElfTraits<bit>::Shdr> const& rShdrs,
+    std::vector<typename ElfTraits<bit>::Shdr> const& rSections,
+    std::vector<typename ElfTraits<bit>::Phdr> const& rSegments,
+    EEndianness Endianness)
+  {
+    typedef ElfTraits<bit>         ElfType;
+    typedef typename ElfType::Sym  Sym;
+    typedef typename ElfType::Rel  Rel;
+    typedef typename ElfType::Rela Rela;
+
+    enum { ChunkSize = 0x4000, NoSymbolTable = ~0U };
+
+    BinaryStream const& rBinStrm = rDoc.GetBinaryStream();
+    auto StartTime = std::chrono::steady_clock::now();
+
+    // Workers can't query the document, so addresses are converted with the headers
+    auto ConvertAddressToOffset = [&](u64 Addr, u64 Size, TOffset& rOffset) -> bool
     {
-      typename ElfType::Addr SymTbl    = 0x0;
-      typename ElfType::Addr JmpRelTbl = 0x0;
-      typename ElfType::Addr DynStr    = 0x0;
-      typename ElfType::Addr RelaTbl   = 0x0;
-      u32 SymSz                         = 0;
-      u32 JmpRelSz                      = 0;
-      u32 DynStrSz                      = 0;
-      u32 RelaSz                        = 0;
-      u32 PltRelType                    = 0;
-
-      if (pPhdr->p_type == PT_DYNAMIC)
+      for (auto const& rShdr : rSections)
       {
-        u8* pDynamic = new u8[pPhdr->p_filesz];
-        if (!rBinStrm.Read(pPhdr->p_offset, pDynamic, pPhdr->p_filesz))
-        {
-          Log::Write("ldr_elf") << "Can't read DYN" << LogEnd;
+        if (rShdr.sh_type == SHT_NOBITS || Addr < rShdr.sh_addr || Addr + Size > rShdr.sh_addr + rShdr.sh_size)
           continue;
-        }
+        rOffset = rShdr.sh_offset + (Addr - rShdr.sh_addr);
+        return true;
+      }
+      for (auto const& rPhdr : rSegments)
+      {
+        if (rPhdr.p_type != PT_LOAD || Addr < rPhdr.p_vaddr || Addr + Size > rPhdr.p_vaddr + rPhdr.p_filesz)
+          continue;
+        rOffset = rPhdr.p_offset + (Addr - rPhdr.p_vaddr);
+        return true;
+      }
+      return false;
+    };
 
-        for (typename ElfType::Dyn *pDyn = reinterpret_cast<typename ElfType::Dyn*>(pDynamic);
-          reinterpret_cast<u8*>(pDyn) < pDynamic + pPhdr->p_filesz; ++pDyn)
-        {
-          ElfType::EndianSwap(*pDyn, Endianness);
-          switch (pDyn->d_tag)
-          {
-          case DT_JMPREL:   JmpRelTbl   = pDyn->d_un.d_ptr;                   break;
-          case DT_PLTRELSZ: JmpRelSz    = static_cast<u32>(pDyn->d_un.d_val); break;
+    struct SymbolTable
+    {
+      std::vector<Sym>  m_Symbols;
+      std::vector<char> m_StrStorage;
+      Span<char const>  m_Strings;
+      bool              m_IsDynamic;
+    };
+
+    struct RelocationTable
+    {
+      std::vector<Rel>  m_Rels;
+      std::vector<Rela> m_Relas;
+      u32               m_SymTblIdx;
+      u64               m_BaseAddress; //! only relocatable objects have relocations relative to their section
+    };
+
+    // String tables point to their own storage, so symbol tables must not be moved
+    std::vector<SymbolTable>     SymTbls;
+    std::vector<RelocationTable> RelTbls;
+    std::vector<u32>             SymTblIdxBySection(rShdrs.size(), NoSymbolTable);
+    SymTbls.reserve(rShdrs.size() + 1);
+
+    auto ReadRelocations = [&](TOffset Offset, u64 Size, bool HasAddend, u32 SymTblIdx, u64 BaseAddr) -> bool
+    {
+      RelocationTable RelTbl;
+      RelTbl.m_SymTblIdx   = SymTblIdx;
+      RelTbl.m_BaseAddress = BaseAddr;
+      if (HasAddend
+        ? !rBinStrm.ReadArray(Offset, Size / sizeof(Rela), RelTbl.m_Relas)
+        : !rBinStrm.ReadArray(Offset, Size / sizeof(Rel),  RelTbl.m_Rels))
+        return false;
+      RelTbls.push_back(std::move(RelTbl));
+      return true;
+    };
+
+    // Sections tell everything, including the static symbol table
+    bool HasDynSym = false;
+    for (u32 ShIdx = 0; ShIdx < rShdrs.size(); ++ShIdx)
+    {
+      auto const& rShdr = rShdrs[ShIdx];
+      if ((rShdr.sh_type != SHT_SYMTAB && rShdr.sh_type != SHT_DYNSYM) || rShdr.sh_link >= rShdrs.size())
+        continue;
+
+      auto const& rStrShdr = rShdrs[rShdr.sh_link];
+      SymTbls.push_back(SymbolTable());
+      auto& rSymTbl = SymTbls.back();
+      rSymTbl.m_IsDynamic = (rShdr.sh_type == SHT_DYNSYM);
+      if (!rBinStrm.ReadArray(rShdr.sh_offset, rShdr.sh_size / sizeof(Sym), rSymTbl.m_Symbols)
+        || !rBinStrm.ReadSpan(rStrShdr.sh_offset, rStrShdr.sh_size, rSymTbl.m_Strings, rSymTbl.m_StrStorage))
+      {
+        Log::Write("ldr_elf") << "Can't read SYMTAB" << LogEnd;
+        SymTbls.pop_back();
+        continue;
+      }
+      HasDynSym |= rSymTbl.m_IsDynamic;
+      SymTblIdxBySection[ShIdx] = static_cast<u32>(SymTbls.size() - 1);
+    }
+
+    for (auto const& rShdr : rShdrs)
+    {
+      if (rShdr.sh_type != SHT_REL && rShdr.sh_type != SHT_RELA)
+        continue;
 
-          case DT_RELA:     RelaTbl     = pDyn->d_un.d_ptr;                   break;
-          case DT_RELASZ:   RelaSz      = static_cast<u32>(pDyn->d_un.d_val); break;
+      u32 SymTblIdx = rShdr.sh_link < rShdrs.size() ? SymTblIdxBySection[rShdr.sh_link] : NoSymbolTable;
+      u64 BaseAddr  = (rEhdr.e_type == ET_REL && rShdr.sh_info < rShdrs.size()) ? rShdrs[rShdr.sh_info].sh_addr : 0;
+      if (!ReadRelocations(rShdr.sh_offset, rShdr.sh_size, rShdr.sh_type == SHT_RELA, SymTblIdx, BaseAddr))
+        Log::Write("ldr_elf") << "Can't read REL" << LogEnd;
+    }
 
-          case DT_SYMTAB:   SymTbl      = pDyn->d_un.d_ptr;                   break;
-          case DT_SYMENT:   SymSz       = static_cast<u32>(pDyn->d_un.d_val); break;
+    // Without sections, the dynamic segment gives the dynamic symbols and relocations
+    for (auto const& rPhdr : rSegments)
+    {
+      if (rPhdr.p_type != PT_DYNAMIC || (HasDynSym && !RelTbls.empty()))
+        continue;
 
-          case DT_STRTAB:   DynStr      = pDyn->d_un.d_ptr;                   break;
-          case DT_STRSZ:    DynStrSz    = static_cast<u32>(pDyn->d_un.d_val); break;
+      std::vector<typename ElfType::Dyn> Dyns;
+      if (!rBinStrm.ReadArray(rPhdr.p_offset, rPhdr.p_filesz / sizeof(typename ElfType::Dyn), Dyns))
+      {
+        Log::Write("ldr_elf") << "Can't read DYN" << LogEnd;
+        continue;
+      }
 
-          case DT_PLTREL:   PltRelType  = static_cast<u32>(pDyn->d_un.d_val); break;
-          default:                                                            break;
-          }
+      u64 SymTbl = 0, StrTbl = 0, StrSz = 0, HashTbl = 0, GnuHashTbl = 0;
+      u64 RelTbl = 0, RelSz = 0, RelaTbl = 0, RelaSz = 0, JmpRelTbl = 0, JmpRelSz = 0, PltRelType = 0;
+      for (auto& rDyn : Dyns)
+      {
+        ElfType::EndianSwap(rDyn, Endianness);
+        switch (rDyn.d_tag)
+        {
+        case DT_SYMTAB:   SymTbl     = rDyn.d_un.d_ptr; break;
+        case DT_STRTAB:   StrTbl     = rDyn.d_un.d_ptr; break;
+        case DT_STRSZ:    StrSz      = rDyn.d_un.d_val; break;
+        case DT_HASH:     HashTbl    = rDyn.d_un.d_ptr; break;
+        case DT_GNU_HASH: GnuHashTbl = rDyn.d_un.d_ptr; break;
+        case DT_REL:      RelTbl     = rDyn.d_un.d_ptr; break;
+        case DT_RELSZ:    RelSz      = rDyn.d_un.d_val; break;
+        case DT_RELA:     RelaTbl    = rDyn.d_un.d_ptr; break;
+        case DT_RELASZ:   RelaSz     = rDyn.d_un.d_val; break;
+        case DT_JMPREL:   JmpRelTbl  = rDyn.d_un.d_ptr; break;
+        case DT_PLTRELSZ: JmpRelSz   = rDyn.d_un.d_val; break;
+        case DT_PLTREL:   PltRelType = rDyn.d_un.d_val; break;
+        default:                                        break;
         }
+      }
 
-        delete[] pDynamic;
-
-        if (SymTbl == 0x0 || JmpRelTbl == 0x0)
-          break;
+      u32 DynSymIdx = NoSymbolTable;
+      for (u32 SymTblIdx = 0; SymTblIdx < SymTbls.size(); ++SymTblIdx)
+        if (SymTbls[SymTblIdx].m_IsDynamic)
+          DynSymIdx = SymTblIdx;
+      if (DynSymIdx == NoSymbolTable && SymTbl != 0x0)
+        DynSymIdx = static_cast<u32>(SymTbls.size());
 
-        TOffset SymTblOff     = 0x0;
-        TOffset JmpRelTblOff  = 0x0;
-        TOffset DynStrOff     = 0x0;
-        TOffset RelaTblOff    = 0x0;
-        rDoc.ConvertAddressToFileOffset(Address(Address::FlatType, 0x0, SymTbl),    SymTblOff);
-        rDoc.ConvertAddressToFileOffset(Address(Address::FlatType, 0x0, JmpRelTbl), JmpRelTblOff);
-        rDoc.ConvertAddressToFileOffset(Address(Address::FlatType, 0x0, DynStr),    DynStrOff);
-        rDoc.ConvertAddressToFileOffset(Address(Address::FlatType, 0x0, RelaTbl),   RelaTblOff);
+      TOffset TblOff;
+      if (RelTbls.empty())
+      {
+        if (RelTbl != 0x0 && ConvertAddressToOffset(RelTbl, RelSz, TblOff))
+          ReadRelocations(TblOff, RelSz, false, DynSymIdx, 0);
+        if (RelaTbl != 0x0 && ConvertAddressToOffset(RelaTbl, RelaSz, TblOff))
+          ReadRelocations(TblOff, RelaSz, true, DynSymIdx, 0);
+        if (JmpRelTbl != 0x0 && ConvertAddressToOffset(JmpRelTbl, JmpRelSz, TblOff))
+          ReadRelocations(TblOff, JmpRelSz, PltRelType == DT_RELA, DynSymIdx, 0);
+      }
 
-        u8*   pReloc      = new u8[JmpRelSz];
-        char* pDynSymStr  = new char[DynStrSz];
-        u8*   pRelocA     = new u8[RelaSz];
+      if (HasDynSym || SymTbl == 0x0)
+        break;
 
-        if (!rBinStrm.Read(JmpRelTblOff, pReloc, JmpRelSz))
-        {
-          Log::Write("ldr_elf") << "Can't read REL" << LogEnd;
-          return;
-        }
-        if (!rBinStrm.Read(DynStrOff, pDynSymStr, DynStrSz))
-        {
-          Log::Write("ldr_elf") << "Can't read DYNSTR" << LogEnd;
-          return;
-        }
-        if (!rBinStrm.Read(RelaTblOff, pRelocA, RelaSz))
+      // The number of dynamic symbols is only known through the hash tables or the relocations
+      u64 SymNo = 0;
+      std::vector<u32> HashHdr;
+      if (HashTbl != 0x0 && ConvertAddressToOffset(HashTbl, 2 * sizeof(u32), TblOff) && rBinStrm.ReadArray(TblOff, 2, HashHdr))
+        SymNo = HashHdr[1];
+      else if (GnuHashTbl != 0x0 && ConvertAddressToOffset(GnuHashTbl, 4 * sizeof(u32), TblOff) && rBinStrm.ReadArray(TblOff, 4, HashHdr))
+      {
+        // The last symbol is the end of the chain of the highest bucket
+        u32 BucketNo = HashHdr[0], SymOff = HashHdr[1];
+        TOffset BucketOff = TblOff + 4 * sizeof(u32) + HashHdr[2] * sizeof(typename ElfType::Addr);
+        std::vector<u32> Buckets;
+        if (rBinStrm.ReadArray(BucketOff, BucketNo, Buckets))
         {
-          Log::Write("ldr_elf") << "Can't read RELA" << LogEnd;
-          return;
+          u32 LastSymIdx = Buckets.empty() ? 0 : *std::max_element(std::begin(Buckets), std::end(Buckets));
+          SymNo = std::max(LastSymIdx, SymOff);
+          if (LastSymIdx >= SymOff)
+          {
+            TOffset ChainOff = BucketOff + BucketNo * sizeof(u32) + (LastSymIdx - SymOff) * sizeof(u32);
+            u32 ChainVal;
+            while (rBinStrm.Read(ChainOff, ChainVal))
+            {
+              ++SymNo;
+              if (ChainVal & 1)
+                break;
+              ChainOff += sizeof(u32);
+            }
+          }
         }
+      }
+      for (auto const& rRelTbl : RelTbls)
+      {
+        for (auto const& rRel : rRelTbl.m_Rels)
+          SymNo = std::max<u64>(SymNo, _GetRelocationSymbol<bit>(rRel.r_info, Endianness) + 1);
+        for (auto const& rRela : rRelTbl.m_Relas)
+          SymNo = std::max<u64>(SymNo, _GetRelocationSymbol<bit>(rRela.r_info, Endianness) + 1);
+      }
 
-        // XXX: At this time, it's unclear if we R_XXX_JMP_SLOT is always a Rel, Rela or both
-        // We assume that it's Rela for now
-        if (pReloc != nullptr && JmpRelSz != 0x0)
+      SymTbls.push_back(SymbolTable());
+      auto& rSymTbl = SymTbls.back();
+      rSymTbl.m_IsDynamic = true;
+      TOffset StrOff;
+      if (!ConvertAddressToOffset(SymTbl, SymNo * sizeof(Sym), TblOff)
+        || !ConvertAddressToOffset(StrTbl, StrSz, StrOff)
+        || !rBinStrm.ReadArray(TblOff, SymNo, rSymTbl.m_Symbols)
+        || !rBinStrm.ReadSpan(StrOff, StrSz, rSymTbl.m_Strings, rSymTbl.m_StrStorage))
+      {
+        Log::Write("ldr_elf") << "Can't read DYNSYM" << LogEnd;
+        SymTbls.pop_back();
+      }
+      break;
+    }
+
+    // Symbols are converted to labels in chunks, dynamic symbols first so exported labels are kept
+    Database::LabelVector Labels;
+    u64 SymNo = 0;
+    for (int PassNo = 0; PassNo < 2; ++PassNo)
+    {
+      for (auto& rSymTbl : SymTbls)
+      {
+        if (rSymTbl.m_IsDynamic != (PassNo == 0))
+          continue;
+
+        SymNo += rSymTbl.m_Symbols.size();
+        size_t ChunkNo = (rSymTbl.m_Symbols.size() + ChunkSize - 1) / ChunkSize;
+        std::vector<Database::LabelVector> ChunkLabels(ChunkNo);
+        ParallelFor(ChunkNo, [&](size_t Begin, size_t End)
         {
-          if (PltRelType == DT_REL)
+          for (size_t ChunkIdx = Begin; ChunkIdx < End; ++ChunkIdx)
           {
-            Log::Write("ldr_elf") << "PLt relocs are Rel" << LogEnd;
-            typename ElfType::Rel* pRel = reinterpret_cast<typename ElfType::Rel*>(pReloc);
-            for (u32 i = 0; i < JmpRelSz / sizeof(*pRel); ++pRel, ++i)
+            size_t SymEnd = std::min(rSymTbl.m_Symbols.size(), (ChunkIdx + 1) * ChunkSize);
+            for (size_t SymIdx = ChunkIdx * ChunkSize; SymIdx < SymEnd; ++SymIdx)
             {
-              ElfType::EndianSwap(*pRel, Endianness);
-
-              typename ElfType::Sym CurSym;
-              u32 SymIdx;
-              if (bit == 32)
-                SymIdx = static_cast<u32>(pRel->r_info >> 8);
-              else
-                SymIdx = static_cast<u64>(pRel->r_info) >> 32;
-              TOffset CurSymOff = SymTblOff + SymIdx * sizeof(CurSym);
+              auto& rSym = rSymTbl.m_Symbols[SymIdx];
+              ElfType::EndianSwap(rSym, Endianness);
 
-              if (!rBinStrm.Read(CurSymOff, &CurSym, sizeof(CurSym)))
+              u16 LblType;
+              switch (ELF32_ST_TYPE(rSym.st_info))
               {
-                Log::Write("ldr_elf") << "Can't read SYM" << LogEnd;
-                continue;
+              case STT_FUNC: case STT_GNU_IFUNC:              LblType = Label::Code; break;
+              case STT_OBJECT: case STT_COMMON: case STT_NOTYPE: LblType = Label::Data; break;
+              default:                                         continue;
               }
-              ElfType::EndianSwap(CurSym, Endianness);
-              if (pDynSymStr[CurSym.st_name] == '\0')
+              if (rSym.st_shndx == SHN_UNDEF)
                 continue;
+              if (ELF32_ST_BIND(rSym.st_info) == STB_LOCAL)
+                LblType |= Label::Local;
+              else
+                LblType |= rSymTbl.m_IsDynamic ? Label::Exported : Label::Global;
 
-              TOffset FuncOff;
-              if (!rDoc.ConvertAddressToFileOffset(pRel->r_offset, FuncOff))
-              {
-                Log::Write("ldr_elf") << "Can't convert address of REL" << LogEnd;
+              // ARM mapping symbols ($a, $t, $d) only mark the kind of content
+              std::string SymName = _GetString(rSymTbl.m_Strings, rSym.st_name);
+              if (SymName.empty() || SymName[0] == '$')
                 continue;
-              }
 
-              typename ElfType::Addr FuncPlt;
-              if (!rBinStrm.Read(FuncOff, FuncPlt))
-              {
-                Log::Write("ldr_elf") << "Can't read FUNPLT" << LogEnd;
+              u64 SymVal = _GetSymbolValue<bit>(rEhdr, rShdrs, rSym);
+              if (SymVal == 0x0 && rEhdr.e_type != ET_REL)
                 continue;
-              }
-
-              Address FuncPltAddr(Address::FlatType, 0x0, FuncPlt, 0, bit);
-
-              Log::Write("ldr_elf")
-                << "Symbol found"
-                << ": address=" << pRel->r_offset
-                << ", plt=" << FuncPlt
-                << ", name=" << pDynSymStr + CurSym.st_name
-                << LogEnd;
-
-              Address FuncAddr(Address::FlatType, 0x0, static_cast<TOffset>(pRel->r_offset), 0, bit);
-              std::string FuncName(pDynSymStr + CurSym.st_name);
-
-              rDoc.AddLabel(FuncAddr, Label(FuncName, Label::Data | Label::Imported));
-              //rDoc.AddLabel(FuncPltAddr, Label(FuncName + "@plt", Label::Code | Label::Global));
+              ChunkLabels[ChunkIdx].push_back(std::make_pair(
+                Address(Address::FlatType, 0x0, SymVal, 0x10, bit),
+                Label(SymName, LblType)));
             }
           }
-          else if (PltRelType == DT_RELA)
+        });
+
+        for (auto& rChunk : ChunkLabels)
+          Labels.insert(std::end(Labels), std::begin(rChunk), std::end(rChunk));
+      }
+    }
+    rDoc.AddLabels(Labels, false);
+
+    auto SymbolTime = std::chrono::steady_clock::now();
+    Log::Write("ldr_elf")
+      << "Symbols: " << SymNo << " parsed, " << Labels.size() << " labels in "
+      << std::chrono::duration_cast<std::chrono::milliseconds>(SymbolTime - StartTime).count() << "ms"
+      << LogEnd;
+
+    // Relocations are resolved in chunks, imported slots are labeled and pointers are referenced.
+    // Resolved values are written in the patch overlay like a dynamic loader would, the image isn't
+    // rebased (B is 0) and sections of relocatable objects aren't laid out, so they're left untouched.
+    Database::LabelVector          ImportLabels;
+    Database::CrossReferenceVector XRefs;
+    PatchOverlay::PatchVector      RelPatches;
+    bool const ApplyRelocations = rEhdr.e_type != ET_REL;
+    u64 RelNo = 0;
+    for (auto const& rRelTbl : RelTbls)
+    {
+      SymbolTable const* pSymTbl = rRelTbl.m_SymTblIdx < SymTbls.size() ? &SymTbls[rRelTbl.m_SymTblIdx] : nullptr;
+      bool   HasAddend = !rRelTbl.m_Relas.empty();
+      size_t EntryNo   = HasAddend ? rRelTbl.m_Relas.size() : rRelTbl.m_Rels.size();
+      size_t ChunkNo   = (EntryNo + ChunkSize - 1) / ChunkSize;
+      std::vector<Database::LabelVector>          ChunkLabels(ChunkNo);
+      std::vector<Database::CrossReferenceVector> ChunkXRefs(ChunkNo);
+      std::vector<PatchOverlay::PatchVector>      ChunkPatches(ChunkNo);
+      RelNo += EntryNo;
+
+      ParallelFor(ChunkNo, [&](size_t Begin, size_t End)
+      {
+        for (size_t ChunkIdx = Begin; ChunkIdx < End; ++ChunkIdx)
+        {
+          size_t EntryEnd = std::min(EntryNo, (ChunkIdx + 1) * ChunkSize);
+          for (size_t EntryIdx = ChunkIdx * ChunkSize; EntryIdx < EntryEnd; ++EntryIdx)
           {
-            Log::Write("ldr_elf") << "PLt relocs are Rela" << LogEnd;
-            typename ElfType::Rela* pRela = reinterpret_cast<typename ElfType::Rela*>(pReloc);
-            for (u32 i = 0; i < JmpRelSz / sizeof(*pRela); ++pRela, ++i)
+            u64 RelOff, RelInfo;
+            s64 Addend = 0;
+            if (HasAddend)
             {
-              ElfType::EndianSwap(*pRela, Endianness);
-
-              typename ElfType::Sym CurSym;
-              u32 SymIdx;
-              if (bit == 32)
-                SymIdx = static_cast<u32>(pRela->r_info >> 8);
-              else
-                SymIdx = static_cast<u64>(pRela->r_info) >> 32;
-              TOffset CurSymOff = SymTblOff + SymIdx * sizeof(CurSym);
-
-              if (!rBinStrm.Read(CurSymOff, &CurSym, sizeof(CurSym)))
-              {
-                Log::Write("ldr_elf") << "Can't read SYM" << LogEnd;
-                continue;
-              }
+              Rela CurRela = rRelTbl.m_Relas[EntryIdx];
+              ElfType::EndianSwap(CurRela, Endianness);
+              RelOff  = CurRela.r_offset;
+              RelInfo = CurRela.r_info;
+              Addend  = CurRela.r_addend;
+            }
+            else
+            {
+              Rel CurRel = rRelTbl.m_Rels[EntryIdx];
+              ElfType::EndianSwap(CurRel, Endianness);
+              RelOff  = CurRel.r_offset;
+              RelInfo = CurRel.r_info;
+            }
 
-              if (pDynSymStr[CurSym.st_name] == '\0')
-                continue;
+            u8 RelSize;
+            u32 RelType = (bit == 32) ? static_cast<u32>(ELF32_R_TYPE(RelInfo)) : static_cast<u32>(ELF64_R_TYPE(RelInfo));
+            u32 SymIdx  = (bit == 32) ? static_cast<u32>(ELF32_R_SYM(RelInfo))  : static_cast<u32>(ELF64_R_SYM(RelInfo));
+            auto RelKind = _GetRelocationKind(RelType, RelSize);
+            if (RelKind == RelocNone)
+              continue;
 
-              ElfType::EndianSwap(CurSym, Endianness);
+            u64 SlotVa = rRelTbl.m_BaseAddress + RelOff;
+            Address SlotAddr(Address::FlatType, 0x0, SlotVa, 0x10, bit);
+            Sym const* pSym = (pSymTbl != nullptr && SymIdx != 0 && SymIdx < pSymTbl->m_Symbols.size())
+              ? &pSymTbl->m_Symbols[SymIdx] : nullptr;
 
-              TOffset FuncOff;
-              if (!rDoc.ConvertAddressToFileOffset(pRela->r_offset, FuncOff))
-              {
-                Log::Write("ldr_elf") << "Can't convert address of RELA" << LogEnd;
+            // Undefined symbols are imported, only pointer slots are labeled
+            if (SymIdx != 0 && (pSym == nullptr || pSym->st_shndx == SHN_UNDEF))
+            {
+              if (pSym == nullptr || RelSize != bit / 8 || (RelKind != RelocSymbol && RelKind != RelocAbsolute))
                 continue;
-              }
+              std::string SymName = _GetString(pSymTbl->m_Strings, pSym->st_name);
+              if (!SymName.empty())
+                ChunkLabels[ChunkIdx].push_back(std::make_pair(SlotAddr, Label(SymName, Label::Data | Label::Imported)));
+              continue;
+            }
 
-              typename ElfType::Addr FuncPlt;
-              if (!rBinStrm.Read(FuncOff, FuncPlt))
-              {
-                Log::Write("ldr_elf") << "Can't read FUNPLT" << LogEnd;
+            // Rel entries keep their addend in the slot
+            if (!HasAddend && RelKind != RelocSymbol)
+            {
+              TOffset SlotOff;
+              if (!ConvertAddressToOffset(SlotVa, RelSize, SlotOff) || !_ReadAddend(rBinStrm, SlotOff, RelSize, Addend))
                 continue;
-              }
-
-              FuncPlt &= ~0xf; // TODO: Find a better way to do this...
-
-              Log::Write("ldr_elf")
-                << "Symbol found"
-                << ": address=" << pRela->r_offset
-                << ", plt=" << FuncPlt
-                << ", name=" << pDynSymStr + CurSym.st_name
-                << LogEnd;
-
-              Address FuncAddr(Address::FlatType, 0x0, static_cast<TOffset>(pRela->r_offset), 0x10, bit);
-              std::string FuncName(pDynSymStr + CurSym.st_name);
-
-              rDoc.ChangeValueSize(FuncAddr, bit, true);
-              rDoc.AddLabel(FuncAddr, Label(FuncName, Label::Data | Label::Imported));
-              //rDoc.AddLabel(FuncPlt, Label(FuncName + "@plt", Label::Code | Label::Global));
-              //rDoc.InsertMultiCell(FuncPlt, new Function);
             }
-          } // if (PltRelType == DT_REL)
-        } // if (pReloc != 0x0 && JmpRelSz != 0x0)
-
-        if (pRelocA != nullptr && RelaSz)
-        {
-          typename ElfType::Rela* pRela = reinterpret_cast<typename ElfType::Rela*>(pRelocA);
-          for (u32 i = 0; i < RelaSz / sizeof(*pRela); ++i, ++pRela)
-          {
-            ElfType::EndianSwap(*pRela, Endianness);
-
-            typename ElfType::Sym CurSym;
-            u32     SymIdx    = pRela->r_info >> (sizeof(pRela->r_info) * 8 / 2);
-            TOffset CurSymOff = SymTblOff + SymIdx * sizeof(CurSym);
 
-            if (!rBinStrm.Read(CurSymOff, &CurSym, sizeof(CurSym)))
+            u64 SymVal = pSym != nullptr ? _GetSymbolValue<bit>(rEhdr, rShdrs, *pSym) : 0;
+            u64 Target, Value;
+            bool HasValue = ApplyRelocations;
+            switch (RelKind)
             {
-              Log::Write("ldr_elf") << "Can't read SYM" << LogEnd;
-              continue;
+            case RelocAbsolute:   Target = Value = SymVal + Addend; break;
+            case RelocSymbol:     Target = Value = SymVal;          break;
+            case RelocRelative:   Target = Value = Addend;          break; // the image isn't rebased
+            case RelocPcRelative: // the referenced address depends on the instruction
+              Target    = SymVal;
+              Value     = SymVal + Addend - SlotVa;
+              HasValue &= pSym != nullptr;
+              break;
+            default:              // the resolver function isn't run
+              Target    = Addend;
+              Value     = 0x0;
+              HasValue  = false;
+              break;
             }
 
-            ElfType::EndianSwap(CurSym, Endianness);
-
-            Log::Write("ldr_elf")
-              << "Symbol found"
-              << ": address=" << pRela->r_offset
-              << ", name=" << pDynSymStr + CurSym.st_name
-              << LogEnd;
+            TOffset SlotOff;
+            if (HasValue && ConvertAddressToOffset(SlotVa, RelSize, SlotOff))
+              ChunkPatches[ChunkIdx].push_back(_MakeRelocationPatch(rBinStrm.GetOverlayOffset() + SlotOff, Value, RelSize, Endianness));
 
-            Address SymAddr(Address::FlatType, 0x0, static_cast<TOffset>(pRela->r_offset), 0x10, bit);
-            std::string SymName(pDynSymStr + CurSym.st_name);
+            if (bit == 32)
+              Target &= 0xffffffff;
+            if (Target == 0x0)
+              continue;
 
-            // TODO: Use ELFXX_ST_TYPE instead
-            if ((CurSym.st_info & 0xf) == STT_FUNC)
-              rDoc.AddLabel(SymAddr, Label(SymName, Label::Code | Label::Exported));
-            else
-              rDoc.AddLabel(SymAddr, Label(SymName, Label::Data | Label::Exported));
+            ChunkXRefs[ChunkIdx].push_back(std::make_pair(Address(Address::FlatType, 0x0, Target, 0x10, bit), SlotAddr));
           }
-
-          delete [] pDynSymStr;
-          delete [] pReloc;
-          delete [] pRelocA;
         }
-      }
+      });
+
+      for (auto& rChunk : ChunkLabels)
+        ImportLabels.insert(std::end(ImportLabels), std::begin(rChunk), std::end(rChunk));
+      for (auto& rChunk : ChunkXRefs)
+        XRefs.insert(std::end(XRefs), std::begin(rChunk), std::end(rChunk));
+      for (auto& rChunk : ChunkPatches)
+        RelPatches.insert(std::end(RelPatches), std::begin(rChunk), std::end(rChunk));
     }
 
-    /* Clean the whole thing */
-    BOOST_FOREACH(typename ElfType::Shdr* pShdr, Sections)
-      delete pShdr;
+    // Slots are written once all addends are read, so a slot is never relocated twice
+    if (!RelPatches.empty() && !rBinStrm.GetOverlay()->ApplyPatches(RelPatches))
+      Log::Write("ldr_elf") << "unable to apply relocations" << LogEnd;
+
+    for (auto const& rImport : ImportLabels)
+      rDoc.ChangeValueSize(rImport.first, bit, true);
+    rDoc.AddLabels(ImportLabels);
+    rDoc.AddCrossReferences(XRefs);
 
-    BOOST_FOREACH(typename ElfType::Phdr* pPhdr, Segments)
-      delete pPhdr;
+    Log::Write("ldr_elf")
+      << "Relocations: " << RelNo << " parsed, " << RelPatches.size() << " applied, " << ImportLabels.size() << " imports, " << XRefs.size() << " references in "
+      << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - SymbolTime).count() << "ms"
+      << LogEnd;
+  }
 
-    delete pShStrShdr;
+  //! This method returns the symbol index of a relocation which is not swapped yet.
+  template<int bit> static u64 _GetRelocationSymbol(typename ElfTraits<bit>::Addr Info, EEndianness Endianness)
+  {
+    if (TestEndian(Endianness))
+      ::EndianSwap(Info);
+    return (bit == 32) ? ELF32_R_SYM(static_cast<u64>(Info)) : ELF64_R_SYM(static_cast<u64>(Info));
   }
+
+  //! This method returns the address of a symbol, symbols of relocatable objects are relative to their section.
+  template<int bit> static u64 _GetSymbolValue(
+    typename ElfTraits<bit>::Ehdr const& rEhdr,
+    std::vector<typename ElfTraits<bit>::Shdr> const& rShdrs,
+    typename ElfTraits<bit>::Sym const& rSym)
+  {
+    u64 SymVal = rSym.st_value;
+    if (rEhdr.e_machine == EM_ARM && ELF32_ST_TYPE(rSym.st_info) == STT_FUNC)
+      SymVal &= ~1ULL; // thumb bit
+    if (rEhdr.e_type == ET_REL && rSym.st_shndx < rShdrs.size())
+      SymVal += rShdrs[rSym.st_shndx].sh_addr;
+    return SymVal;
+  }
+
+  //! This method returns a string of a string table, or an empty string if Index is out of bounds.
+  static std::string _GetString(Span<char const> const& rStrTbl, u64 Index)
+  {
+    if (Index >= rStrTbl.size())
+      return "";
+    char const* pStr = rStrTbl.data() + Index;
+    return std::string(pStr, ::strnlen(pStr, static_cast<size_t>(rStrTbl.size() - Index)));
+  }
+
+  static bool _ReadAddend(BinaryStream const& rBinStrm, TOffset Offset, u8 Size, s64& rAddend);
+
+  //! This method returns the patch which writes the Size low bytes of Value at Offset of the overlay.
+  static PatchOverlay::Patch _MakeRelocationPatch(TOffset Offset, u64 Value, u8 Size, EEndianness Endianness);
 };
 
 extern "C" LDR_ELF_EXPORT Loader* GetLoader(void);
@@ -33,7 +33,20 @@ enum CartridgeType
   ROM_MBC1_RAM,
   ROM_MBC1_RAM_BATTERY,
   ROM_MBC2,
-  ROM_MBC2_BATTERY
+  ROM_MBC2_BATTERY,
+
+  ROM_MBC3_TIMER_BATTERY         = 0x0F,
+  ROM_MBC3_TIMER_RAM_BATTERY,
+  ROM_MBC3,
+  ROM_MBC3_RAM,
+  ROM_MBC3_RAM_BATTERY,
+
+  ROM_MBC5                       = 0x19,
+  ROM_MBC5_RAM,
+  ROM_MBC5_RAM_BATTERY,
+  ROM_MBC5_RUMBLE,
+  ROM_MBC5_RUMBLE_RAM,
+  ROM_MBC5_RUMBLE_RAM_BATTERY
 };
 
 static const char *s_CartridgeType[] =
@@ -52,7 +65,7 @@ static const char *s_CartridgeType[] =
 /* ROM */
 static unsigned s_RomSize[] =
 {
-  32, 64, 128, 256, 512, 1024, 2048, 4096
+  32, 64, 128, 256, 512, 1024, 2048, 4096, 8192
 };
 
 /* RAM */
@@ -3,8 +3,6 @@
 
 #include "gameboy_loader.hpp"
 
-#include <iomanip>
-#include <sstream>
 #include <algorithm>
 #include <boost/foreach.hpp>
 
@@ -54,29 +52,24 @@ void GameBoyLoader::Map(Document& rDoc, Architecture::VSPType const& rArchs)
     MemoryArea::Execute | MemoryArea::Read | MemoryArea::Write
   ));
 
-  // TODO: This memory area is not really located at 0:4000, but it's the default value
-  rDoc.AddMemoryArea(new MappedMemoryArea(
-    "ROM#01",
-    0x4000, BankSize,
-    Address(Address::BankType, 0, 0x4000, 8, 16), BankSize,
-    MemoryArea::Execute | MemoryArea::Read | MemoryArea::Write
-  ));
-
+  // A dump can be shorter than what its header tells
   BankType BankNo = GetNumberOfBank();
+  u64 FileBankNo = (rDoc.GetBinaryStream().GetSize() + BankSize - 1) / BankSize;
+  if (BankNo > FileBankNo)
+    BankNo = static_cast<BankType>(FileBankNo);
+  if (BankNo < 2)
+    BankNo = 2;
   Log::Write("ldr_gb") << "Number of bank: " << BankNo << LogEnd;
-  TOffset Offset = 0x8000;
-  for (TBank Bank = 2; Bank < BankNo; ++Bank)
-  {
-    std::ostringstream oss;
-    oss << "ROM#" << std::hex << std::setw(2) << std::setfill('0') << Bank;
-
-    rDoc.AddMemoryArea(new MappedMemoryArea(
-      oss.str().c_str(),
-      Bank * BankSize, BankSize,
-      Address(Address::BankType, Bank, 0x4000, 8, 16), BankSize,
-      MemoryArea::Execute | MemoryArea::Read | MemoryArea::Write
-    ));
-  }
+
+  // Only the bank 1 is mapped in the window, other banks are mapped once the analyzer references them
+  auto pRomWindow = new BankedMemoryArea(
+    "ROM#",
+    0x0, BankSize,
+    Address(Address::BankType, 1, 0x4000, 8, 16), BankNo,
+    MemoryArea::Execute | MemoryArea::Read | MemoryArea::Write
+  );
+  AddBankRegisters(*pRomWindow);
+  rDoc.AddMemoryArea(pRomWindow);
 
   rDoc.AddLabel(Address(Address::BankType, 0x0, 0x100, 8, 16),   Label("start",                  Label::Code | Label::Global));
   rDoc.AddLabel(Address(Address::BankType, 0x0, 0x40,  8, 16),   Label("VerticalBlankInterrupt", Label::Code | Label::Global));
@@ -154,6 +147,8 @@ TBank GameBoyLoader::GetNumberOfBank(void) const
   case 0x04: return 0x20; // 512Kbyte
   case 0x05: return 0x40; // 1Mbyte
   case 0x06: return 0x80; // 2Mbyte
+  case 0x07: return 0x100; // 4Mbyte
+  case 0x08: return 0x200; // 8Mbyte
   case 0x52: return 0x48; // 1.1Mbyte
   case 0x53: return 0x50; // 1.2Mbyte
   case 0x54: return 0x60; // 1.5Mbyte
@@ -161,6 +156,47 @@ TBank GameBoyLoader::GetNumberOfBank(void) const
   }
 }
 
+// Source: http://nocash.emubase.de/pandocs.htm
+void GameBoyLoader::AddBankRegisters(BankedMemoryArea& rRomWindow) const
+{
+  BankedMemoryArea::BankRegister const Mbc1Low  = { 0x2000, 0x4000, 0, 0x1f, true  };
+  BankedMemoryArea::BankRegister const Mbc1High = { 0x4000, 0x6000, 5, 0x03, false };
+  BankedMemoryArea::BankRegister const Mbc2     = { 0x2000, 0x4000, 0, 0x0f, true  };
+  BankedMemoryArea::BankRegister const Mbc3     = { 0x2000, 0x4000, 0, 0x7f, true  };
+  BankedMemoryArea::BankRegister const Mbc5Low  = { 0x2000, 0x3000, 0, 0xff, false };
+  BankedMemoryArea::BankRegister const Mbc5High = { 0x3000, 0x4000, 8, 0x01, false };
+
+  switch (m_GameBoyRom.CartridgeType)
+  {
+  case ROM_ONLY:
+    break;
+
+  case ROM_MBC1: case ROM_MBC1_RAM: case ROM_MBC1_RAM_BATTERY:
+    rRomWindow.AddBankRegister(Mbc1Low);
+    rRomWindow.AddBankRegister(Mbc1High);
+    break;
+
+  case ROM_MBC2: case ROM_MBC2_BATTERY:
+    rRomWindow.AddBankRegister(Mbc2);
+    break;
+
+  case ROM_MBC3_TIMER_BATTERY: case ROM_MBC3_TIMER_RAM_BATTERY:
+  case ROM_MBC3: case ROM_MBC3_RAM: case ROM_MBC3_RAM_BATTERY:
+    rRomWindow.AddBankRegister(Mbc3);
+    break;
+
+  case ROM_MBC5: case ROM_MBC5_RAM: case ROM_MBC5_RAM_BATTERY:
+  case ROM_MBC5_RUMBLE: case ROM_MBC5_RUMBLE_RAM: case ROM_MBC5_RUMBLE_RAM_BATTERY:
+    rRomWindow.AddBankRegister(Mbc5Low);
+    rRomWindow.AddBankRegister(Mbc5High);
+    break;
+
+  default:
+    Log::Write("ldr_gb") << "bank switches are not handled for cartridge type " << static_cast<u32>(m_GameBoyRom.CartridgeType) << LogEnd;
+    break;
+  }
+}
+
 void GameBoyLoader::FilterAndConfigureArchitectures(Architecture::VSPType& rArchs) const
 {
   rArchs.erase(std::remove_if(std::begin(rArchs), std::end(rArchs), [](Architecture::SPType spArch)
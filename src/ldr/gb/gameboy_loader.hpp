@@ -29,6 +29,7 @@ public:
 private:
   typedef u16 BankType;
   BankType GetNumberOfBank(void) const;
+  void     AddBankRegisters(BankedMemoryArea& rRomWindow) const;
   enum     { BankSize = 0x4000 };
 
   GameBoyRom m_GameBoyRom;
@@ -14,8 +14,10 @@ MEDUSA_NAMESPACE_USE
 #define MH_CIGAM    0xcefaedfe
 #define MH_CIGAM_64 0xcffaedfe
 
-#define FAT_MAGIC   0xcafebabe
-#define FAT_CIGAM   0xbebafeca
+#define FAT_MAGIC    0xcafebabe
+#define FAT_CIGAM    0xbebafeca
+#define FAT_MAGIC_64 0xcafebabf
+#define FAT_CIGAM_64 0xbfbafeca
 
 struct mach_header {
     u32  magic;
@@ -51,6 +53,15 @@ struct fat_arch {
     u32  align;
 };
 
+struct fat_arch_64 {
+    u32  cputype;
+    u32  cpusubtype;
+    u64  offset;
+    u64  size;
+    u32  align;
+    u32  reserved;
+};
+
 #define CPU_ARCH_MASK        0xff000000
 #define CPU_ARCH_ABI64       0x01000000
 
@@ -64,6 +75,7 @@ struct fat_arch {
 #define CPU_TYPE_MC98000    ((u32) 10)
 #define CPU_TYPE_HPPA       ((u32) 11)
 #define CPU_TYPE_ARM        ((u32) 12)
+#define CPU_TYPE_ARM64      (CPU_TYPE_ARM | CPU_ARCH_ABI64)
 #define CPU_TYPE_MC88000    ((u32) 13)
 #define CPU_TYPE_SPARC      ((u32) 14)
 #define CPU_TYPE_I860       ((u32) 15)
@@ -286,6 +298,22 @@ struct symtab_command {
     u32  strsize;
 };
 
+#define N_STAB  0xe0
+#define N_PEXT  0x10
+#define N_TYPE  0x0e
+#define N_EXT   0x01
+
+#define N_UNDF  0x0
+#define N_ABS   0x2
+#define N_SECT  0xe
+#define N_PBUD  0xc
+#define N_INDR  0xa
+
+#define N_ARM_THUMB_DEF 0x0008
+
+#define INDIRECT_SYMBOL_LOCAL 0x80000000
+#define INDIRECT_SYMBOL_ABS   0x40000000
+
 struct nlist {
     u32  n_strx; // according to the official doc, it's a s32, but it's easier to assume u32
     u8   n_type;
@@ -342,6 +370,13 @@ struct dysymtab_command {
     u32  nlocrel;
 };
 
+struct linkedit_data_command {
+    u32  cmd;
+    u32  cmdsize;
+    u32  dataoff;
+    u32  datasize;
+};
+
 struct thread_command {
     u32  cmd;
     u32  cmdsize;
@@ -2,27 +2,94 @@
 #include "mach-o_loader.hpp"
 #include "mach-o_traits.hpp"
 #include <medusa/medusa.hpp>
+#include <medusa/util.hpp>
 #include <boost/foreach.hpp>
+#include <boost/format.hpp>
 
-#define LOG_WR Log::Write("ldr_mach-o")
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
 
-#define TEXT_SECTION "__TEXT,__text"
+#define LOG_WR Log::Write("ldr_mach-o")
 
 MachOLoader::MachOLoader(void) :
   m_Machine(0),
   m_Arch64(false),
   m_Endian(EndianUnknown),
+  m_SliceOffset(0x0),
+  m_SliceSize(0x0),
   m_EntryPoint(0x0),
   m_EntryPointType(ENTRYPOINT_NONE),
-  m_TextSectionVMAddr(0x0),
+  m_TextSegmentVMAddr(0x0),
   m_SymbolsOffset(0x0),
+  m_NumberOfSymbols(0x0),
   m_StringsOffset(0x0),
-  m_ImportsAddress(0x0),
-  m_SymbolsIndex(0x0)
+  m_StringsSize(0x0),
+  m_IndirectSymbolsOffset(0x0),
+  m_NumberOfIndirectSymbols(0x0),
+  m_FunctionStartsOffset(0x0),
+  m_FunctionStartsSize(0x0)
 {
 }
 
 bool MachOLoader::IsCompatible(BinaryStream const& rBinStrm)
+{
+  typedef MachOTraits<32>  MachOType;
+  MachOType::FatHeader     FatHeader;
+
+  m_Slices.clear();
+  m_SliceOffset = 0x0;
+  m_SliceSize   = rBinStrm.GetSize();
+
+  if (!rBinStrm.Read(0x0, &FatHeader, sizeof(FatHeader))) {
+    return false;
+  }
+
+  /* Universal binaries start with a big endian header */
+  if ( FatHeader.magic != FAT_MAGIC    && FatHeader.magic != FAT_CIGAM
+    && FatHeader.magic != FAT_MAGIC_64 && FatHeader.magic != FAT_CIGAM_64) {
+    return _IsCompatibleSlice(rBinStrm);
+  }
+
+  MachOType::EndianSwap(FatHeader, BigEndian);
+  if (FatHeader.nfat_arch == 0 || FatHeader.nfat_arch > MaxSliceNo) {
+    return false;
+  }
+
+  bool Res = FatHeader.magic == FAT_MAGIC_64
+    ? _ReadFatArchs<64>(rBinStrm, FatHeader.nfat_arch)
+    : _ReadFatArchs<32>(rBinStrm, FatHeader.nfat_arch);
+  if (!Res || m_Slices.empty()) {
+    m_Slices.clear();
+    return false;
+  }
+
+  /* Slices are selected by the user, the default one is the first supported */
+  Configuration::Enum SliceEnum;
+  u32 DefaultSliceIdx = 0;
+  bool HasDefault = false;
+  for (u32 SliceIdx = 0; SliceIdx < m_Slices.size(); ++SliceIdx) {
+    auto const& rSlice = m_Slices[SliceIdx];
+    SliceEnum.push_back(Configuration::NamedField(
+      (boost::format("%s at %#x") % _GetCpuTypeName(rSlice.m_CpuType) % rSlice.m_Offset).str(),
+      SliceIdx));
+
+    bool IsSupported = rSlice.m_CpuType == CPU_TYPE_X86
+      || rSlice.m_CpuType == CPU_TYPE_X86_64
+      || rSlice.m_CpuType == CPU_TYPE_ARM;
+    if (!HasDefault && IsSupported) {
+      DefaultSliceIdx = SliceIdx;
+      HasDefault      = true;
+    }
+  }
+  m_CfgMdl.InsertEnum("Slice", SliceEnum, DefaultSliceIdx);
+  _SelectSlice(DefaultSliceIdx);
+
+  return true;
+}
+
+bool MachOLoader::_IsCompatibleSlice(BinaryStream const& rBinStrm)
 {
   typedef MachOTraits<32> MachOType;
   MachOType::MachOHeader  Header;
@@ -32,13 +99,11 @@ bool MachOLoader::IsCompatible(BinaryStream const& rBinStrm)
   }
 
   if ( Header.magic == MH_MAGIC
-    || Header.magic == MH_MAGIC_64
-    || Header.magic == FAT_MAGIC) {
+    || Header.magic == MH_MAGIC_64) {
       m_Endian = LittleEndian;
 
   } else if (Header.magic == MH_CIGAM
-          || Header.magic == MH_CIGAM_64
-          || Header.magic == FAT_CIGAM) {
+          || Header.magic == MH_CIGAM_64) {
       m_Endian = BigEndian;
 
   } else {
@@ -47,11 +112,6 @@ bool MachOLoader::IsCompatible(BinaryStream const& rBinStrm)
 
   MachOType::EndianSwap(Header, m_Endian);
 
-  /* TODO : Support Fat binaries */
-  if (Header.magic == FAT_MAGIC) {
-    return false;
-  }
-
   /* Avoid file types that have not been tested */
   if (Header.filetype != MH_EXECUTE) {
     return false;
@@ -63,8 +123,81 @@ bool MachOLoader::IsCompatible(BinaryStream const& rBinStrm)
   return true;
 }
 
+template<int bit>
+bool MachOLoader::_ReadFatArchs(BinaryStream const& rBinStrm, u32 NumberOfArchs)
+{
+  typedef MachOTraits<bit>                  MachOType;
+  std::vector<typename MachOType::FatArch>  FatArchs;
+
+  if (!rBinStrm.ReadArray(sizeof(typename MachOType::FatHeader), NumberOfArchs, FatArchs)) {
+    return false;
+  }
+
+  for (auto& rFatArch : FatArchs) {
+    MachOType::EndianSwap(rFatArch, BigEndian);
+
+    if (rFatArch.offset > rBinStrm.GetSize() || rFatArch.size > rBinStrm.GetSize() - rFatArch.offset) {
+      LOG_WR << "Slice is out of file: offset=" << static_cast<u64>(rFatArch.offset) << LogEnd;
+      continue;
+    }
+
+    /* Each slice is checked through a view, nothing is copied */
+    SubBinaryStream SliceStrm(rBinStrm, rFatArch.offset, rFatArch.size);
+    if (!_IsCompatibleSlice(SliceStrm) || m_Machine != rFatArch.cputype) {
+      continue;
+    }
+
+    Slice CurSlice = { m_Machine, m_Arch64, m_Endian, rFatArch.offset, rFatArch.size };
+    m_Slices.push_back(CurSlice);
+  }
+
+  return true;
+}
+
+void MachOLoader::_SelectSlice(u32 SliceIdx)
+{
+  if (SliceIdx >= m_Slices.size()) {
+    return;
+  }
+
+  auto const& rSlice = m_Slices[SliceIdx];
+  m_Machine     = rSlice.m_CpuType;
+  m_Arch64      = rSlice.m_Arch64;
+  m_Endian      = rSlice.m_Endian;
+  m_SliceOffset = rSlice.m_Offset;
+  m_SliceSize   = rSlice.m_Size;
+}
+
+u32 MachOLoader::_GetSelectedMachine(void) const
+{
+  if (m_Slices.empty()) {
+    return m_Machine;
+  }
+
+  u32 SliceIdx = m_CfgMdl.GetEnum("Slice");
+  return SliceIdx < m_Slices.size() ? m_Slices[SliceIdx].m_CpuType : m_Machine;
+}
+
+std::string MachOLoader::_GetCpuTypeName(u32 CpuType)
+{
+  switch (CpuType)
+  {
+  case CPU_TYPE_X86:       return "x86";
+  case CPU_TYPE_X86_64:    return "x86_64";
+  case CPU_TYPE_ARM:       return "arm";
+  case CPU_TYPE_ARM64:     return "arm64";
+  case CPU_TYPE_POWERPC:   return "ppc";
+  case CPU_TYPE_POWERPC64: return "ppc64";
+  default:                 return (boost::format("cpu %#x") % CpuType).str();
+  }
+}
+
 std::string MachOLoader::GetName(void) const
 {
+  if (!m_Slices.empty()) {
+    return "Mach-O universal";
+  }
+
   return m_Arch64
     ? "Mach-O 64-bit"
     : "Mach-O 32-bit";
@@ -77,17 +210,23 @@ u8 MachOLoader::GetDepth(void) const
 
 void MachOLoader::Map(Document& rDoc, Architecture::VSPType const& rArchs)
 {
+  if (!m_Slices.empty()) {
+    _SelectSlice(m_CfgMdl.GetEnum("Slice"));
+  }
+
+  /* The selected slice is read through a view, file offsets are relative to it */
+  SubBinaryStream SliceStrm(rDoc.GetBinaryStream(), m_SliceOffset, m_SliceSize);
+
   if (m_Arch64) {
-    Map<64>(rDoc, rArchs);
+    Map<64>(rDoc, SliceStrm, rArchs);
   } else {
-    Map<32>(rDoc, rArchs);
+    Map<32>(rDoc, SliceStrm, rArchs);
   }
 }
 
 template<int bit>
-void MachOLoader::Map(Document& rDoc, Architecture::VSPType const& rArchs)
+void MachOLoader::Map(Document& rDoc, BinaryStream const& rBinStrm, Architecture::VSPType const& rArchs)
 {
-  BinaryStream const&             rBinStrm = rDoc.GetBinaryStream();
   typedef MachOTraits<bit>        MachOType;
   typename MachOType::MachOHeader Header;
   int                             LoadCmdOff;
@@ -105,6 +244,15 @@ void MachOLoader::Map(Document& rDoc, Architecture::VSPType const& rArchs)
   }
   MachOType::EndianSwap(Header, m_Endian);
 
+  m_TextSegmentVMAddr       = 0x0;
+  m_SymbolsOffset           = 0x0;
+  m_NumberOfSymbols         = 0x0;
+  m_IndirectSymbolsOffset   = 0x0;
+  m_NumberOfIndirectSymbols = 0x0;
+  m_FunctionStartsOffset    = 0x0;
+  m_FunctionStartsSize      = 0x0;
+  m_Sections.clear();
+
   LoadCmdOff = sizeof(Header);
   for (u32 i = 0; i < Header.ncmds; i++) {
     typename MachOType::LoadCmd LoadCmd;
@@ -118,32 +266,33 @@ void MachOLoader::Map(Document& rDoc, Architecture::VSPType const& rArchs)
     switch (LoadCmd.cmd) {
     case LC_SEGMENT:
     case LC_SEGMENT_64:
-      MachOLoader::MapSegment<bit>(rDoc, LoadCmdOff, ArchTag, ArchMode);
+      MachOLoader::MapSegment<bit>(rDoc, rBinStrm, LoadCmdOff, ArchTag, ArchMode);
       break;
 
     case LC_SYMTAB:
-      MachOLoader::GetSymbols<bit>(rDoc, LoadCmdOff);
+      MachOLoader::GetSymbols<bit>(rBinStrm, LoadCmdOff);
       break;
 
     case LC_DYSYMTAB:
-      MachOLoader::GetDynamicSymbols<bit>(rDoc, LoadCmdOff);
+      MachOLoader::GetDynamicSymbols<bit>(rBinStrm, LoadCmdOff);
       break;
 
-      /*        case LC_LOAD_DYLIB:
+    case LC_FUNCTION_STARTS:
+      MachOLoader::GetFunctionStarts<bit>(rBinStrm, LoadCmdOff);
       break;
 
-      case LC_DYSYMTAB:
+      /*        case LC_LOAD_DYLIB:
       break;*/
 
       /* Entry point (up to Mac OS X 10.7) */
     case LC_THREAD:
     case LC_UNIXTHREAD:
-      MachOLoader::GetEntryPointV1(rDoc, LoadCmdOff + sizeof(LoadCmd));
+      MachOLoader::GetEntryPointV1(rBinStrm, LoadCmdOff + sizeof(LoadCmd));
       break;
 
       /* Entry point (since Mac OS X 10.8) */
     case LC_MAIN:
-      MachOLoader::GetEntryPointV2(rDoc, LoadCmdOff + sizeof(LoadCmd));
+      MachOLoader::GetEntryPointV2(rBinStrm, LoadCmdOff + sizeof(LoadCmd));
       break;
 
     default:
@@ -159,21 +308,20 @@ void MachOLoader::Map(Document& rDoc, Architecture::VSPType const& rArchs)
   /* We wait until here to add the start label because we might
   need fields from different load commands. */
   if (m_EntryPointType == ENTRYPOINT_OFFSET) {
-    if (m_TextSectionVMAddr) {
-      m_EntryPoint = m_TextSectionVMAddr + m_EntryPoint;
-    }
+    /* The offset is relative to the beginning of the file, which is mapped by __TEXT */
+    m_EntryPoint = m_TextSegmentVMAddr + m_EntryPoint;
   }
   rDoc.AddLabel(Address(Address::FlatType, 0x0, m_EntryPoint, 0x10, bit),
     Label("start", Label::Code | Label::Exported));
+
+  _MapSymbols<bit>(rDoc, rBinStrm);
 }
 
 template<int bit>
-void MachOLoader::MapSegment(Document& rDoc, int LoadCmdOff, Tag ArchTag, u8 ArchMode)
+void MachOLoader::MapSegment(Document& rDoc, BinaryStream const& rBinStrm, int LoadCmdOff, Tag ArchTag, u8 ArchMode)
 {
-  BinaryStream const&         rBinStrm = rDoc.GetBinaryStream();
   typedef MachOTraits<bit>    MachOType;
   typename MachOType::Segment Segment;
-  typename MachOType::Section Section;
   std::string                 SegmentName;
   std::string                 FullSectionName;
   u32                         MemAreaFlags;
@@ -186,23 +334,29 @@ void MachOLoader::MapSegment(Document& rDoc, int LoadCmdOff, Tag ArchTag, u8 Arc
   SegmentName = reinterpret_cast<char *>(Segment.segname);
   LoadCmdOff += sizeof(Segment);
 
-  for (u32 i = 0; i < Segment.nsects; i++) {
-    if (!rBinStrm.Read(LoadCmdOff, &Section, sizeof(Section))) {
-      LOG_WR << "Cannot access section in "
-        << Segment.segname << " segment"
-        << LogEnd;
-      return;
-    }
-    MachOType::EndianSwap(Segment, m_Endian);
+  /* Entry point offset and function starts are relative to this segment */
+  if (SegmentName == "__TEXT") {
+    m_TextSegmentVMAddr = Segment.vmaddr;
+  }
+
+  std::vector<typename MachOType::Section> Sections;
+  if (!rBinStrm.ReadArray(LoadCmdOff, Segment.nsects, Sections)) {
+    LOG_WR << "Cannot access section in "
+      << Segment.segname << " segment"
+      << LogEnd;
+    return;
+  }
+
+  for (auto& Section : Sections) {
+    MachOType::EndianSwap(Section, m_Endian);
 
     FullSectionName  = SegmentName;
     FullSectionName += ",";
     FullSectionName += reinterpret_cast<char *>(Section.sectname);
 
-    /* We might need this address to compute the entrypoint */
-    if (FullSectionName == TEXT_SECTION) {
-      m_TextSectionVMAddr = Section.addr;
-    }
+    /* Sections are referenced by symbols, their index starts from 1 */
+    SectionInfo CurScnInfo = { Section.addr, Section.size, Section.flags, Section.reserved1 };
+    m_Sections.push_back(CurScnInfo);
 
     LOG_WR << "Section found"
       << ": va="     << Section.addr
@@ -232,7 +386,7 @@ void MachOLoader::MapSegment(Document& rDoc, int LoadCmdOff, Tag ArchTag, u8 Arc
     } else {
       pNewMemArea = new MappedMemoryArea(
         FullSectionName,
-        Section.offset,
+        m_SliceOffset + Section.offset,
         static_cast<u32>(Section.size),
         Address(Address::FlatType, 0x0, Section.addr, 16, bit),
         static_cast<u32>(Section.size),
@@ -258,22 +412,11 @@ void MachOLoader::MapSegment(Document& rDoc, int LoadCmdOff, Tag ArchTag, u8 Arc
           continue;
         }
       }
-
-    // TODO: Is it the only way to import symbols in Mach-O?
-    if ((Section.flags & SECTION_TYPE) == S_LAZY_SYMBOL_POINTERS)
-    {
-      m_ImportsAddress = Section.addr;
-      m_SymbolsIndex   = Section.reserved1;
-    }
-
-      LoadCmdOff += sizeof(Section);
   }
 }
 
-void MachOLoader::GetEntryPointV1(Document& rDoc, int LoadCmdOff)
+void MachOLoader::GetEntryPointV1(BinaryStream const& rBinStrm, int LoadCmdOff)
 {
-  BinaryStream const& rBinStrm = rDoc.GetBinaryStream();
-
   switch (m_Machine) {
   case CPU_TYPE_X86:
     {
@@ -351,9 +494,8 @@ void MachOLoader::GetEntryPointV1(Document& rDoc, int LoadCmdOff)
   }
 }
 
-void MachOLoader::GetEntryPointV2(Document& rDoc, int LoadCmdOff)
+void MachOLoader::GetEntryPointV2(BinaryStream const& rBinStrm, int LoadCmdOff)
 {
-  BinaryStream const&     rBinStrm = rDoc.GetBinaryStream();
   typedef MachOTraits<32> MachOType;
   MachOType::EntryPoint   EntryPoint;
 
@@ -368,9 +510,8 @@ void MachOLoader::GetEntryPointV2(Document& rDoc, int LoadCmdOff)
 }
 
 template<int bit>
-void MachOLoader::GetSymbols(Document& rDoc, int LoadCmdOff)
+void MachOLoader::GetSymbols(BinaryStream const& rBinStrm, int LoadCmdOff)
 {
-  BinaryStream const&             rBinStrm = rDoc.GetBinaryStream();
   typedef MachOTraits<bit>        MachOType;
   typename MachOType::SymbolTable SymTab;
 
@@ -380,19 +521,15 @@ void MachOLoader::GetSymbols(Document& rDoc, int LoadCmdOff)
     return;
   }
   MachOType::EndianSwap(SymTab, m_Endian);
-  m_SymbolsOffset = SymTab.symoff;
-  m_StringsOffset = SymTab.stroff;
+  m_SymbolsOffset   = SymTab.symoff;
+  m_NumberOfSymbols = SymTab.nsyms;
+  m_StringsOffset   = SymTab.stroff;
+  m_StringsSize     = SymTab.strsize;
 }
 
 template<int bit>
-void MachOLoader::GetDynamicSymbols(Document& rDoc, int LoadCmdOff)
+void MachOLoader::GetDynamicSymbols(BinaryStream const& rBinStrm, int LoadCmdOff)
 {
-  if (m_SymbolsOffset == 0x0) {
-    LOG_WR << "Unable to get imported symbols, symbol offset is not yet initialized" << LogEnd;
-    return;
-  }
-
-  BinaryStream const&                    rBinStrm = rDoc.GetBinaryStream();
   typedef MachOTraits<bit>               MachOType;
   typename MachOType::DynamicSymbolTable DySymTab;
 
@@ -401,43 +538,196 @@ void MachOLoader::GetDynamicSymbols(Document& rDoc, int LoadCmdOff)
     LOG_WR << "Cannot read dysymtab command" << LogEnd;
     return;
   }
+  MachOType::EndianSwap(DySymTab, m_Endian);
+  m_IndirectSymbolsOffset   = DySymTab.indirectsymoff;
+  m_NumberOfIndirectSymbols = DySymTab.nindirectsyms;
+}
 
-  u64 ImpAddr = m_ImportsAddress;
-  for (u32 i = m_SymbolsIndex; i < DySymTab.nindirectsyms; ++i, ImpAddr += (bit / 8))
-  {
-    u32 SymIdx;
+template<int bit>
+void MachOLoader::GetFunctionStarts(BinaryStream const& rBinStrm, int LoadCmdOff)
+{
+  typedef MachOTraits<bit>         MachOType;
+  typename MachOType::LinkEditData FuncStarts;
+
+  if (!rBinStrm.Read(LoadCmdOff, &FuncStarts, sizeof(FuncStarts))) {
+    LOG_WR << "Cannot read function starts command" << LogEnd;
+    return;
+  }
+  MachOType::EndianSwap(FuncStarts, m_Endian);
+  m_FunctionStartsOffset = FuncStarts.dataoff;
+  m_FunctionStartsSize   = FuncStarts.datasize;
+}
+
+template<int bit>
+void MachOLoader::_MapSymbols(Document& rDoc, BinaryStream const& rBinStrm)
+{
+  typedef MachOTraits<bit>           MachOType;
+  typedef typename MachOType::Symbol Symbol;
+
+  enum { ChunkSize = 0x4000 };
+
+  auto StartTime = std::chrono::steady_clock::now();
+
+  /* Function starts are ULEB128 deltas from the __TEXT segment, the list ends with 0 */
+  std::vector<u64> FuncStarts;
+  if (m_FunctionStartsSize != 0x0) {
+    Span<u8 const>  Data;
+    std::vector<u8> DataStorage;
+    if (!rBinStrm.ReadSpan(m_FunctionStartsOffset, m_FunctionStartsSize, Data, DataStorage)) {
+      LOG_WR << "Cannot read function starts" << LogEnd;
+    }
+
+    u64 FuncAddr = m_TextSegmentVMAddr;
+    for (size_t Pos = 0; Pos < Data.size();) {
+      u64 Delta = 0;
+      u32 Shift = 0;
+      u8  Byte;
+      do {
+        Byte   = Data[Pos++];
+        Delta |= static_cast<u64>(Byte & 0x7f) << Shift;
+        Shift += 7;
+      } while ((Byte & 0x80) && Pos < Data.size() && Shift < 64);
+
+      if (Delta == 0x0) {
+        break;
+      }
+      FuncAddr += Delta;
 
-    if (!rBinStrm.Read(DySymTab.indirectsymoff + sizeof(SymIdx) * i, SymIdx)) {
-      LOG_WR << "Cannot read symbol index" << LogEnd;
+      /* Thumb functions have their lowest bit set */
+      FuncStarts.push_back(m_Machine == CPU_TYPE_ARM ? FuncAddr & ~1ULL : FuncAddr);
     }
+  }
 
-    typename MachOType::Symbol Sym;
+  /* Read tables at once, the string table is used in place if possible */
+  std::vector<Symbol> Syms;
+  std::vector<char>   StrStorage;
+  Span<char const>    StrTbl;
+  if (m_NumberOfSymbols != 0x0
+    && (!rBinStrm.ReadArray(m_SymbolsOffset, m_NumberOfSymbols, Syms)
+    ||  !rBinStrm.ReadSpan(m_StringsOffset, m_StringsSize, StrTbl, StrStorage))) {
+    LOG_WR << "Cannot read symbols" << LogEnd;
+    Syms.clear();
+  }
 
-    /* Read Symbol */
-    if (!rBinStrm.Read(m_SymbolsOffset + sizeof(Sym) * SymIdx, &Sym, sizeof(Sym))) {
-      LOG_WR << "Cannot read the symbol " << i << LogEnd;
-      continue;
+  auto GetSymbolName = [&StrTbl](Symbol const& rSym) -> std::string
+  {
+    if (rSym.n_strx >= StrTbl.size()) {
+      return std::string();
     }
+    char const* pSymName = StrTbl.data() + rSym.n_strx;
+    return std::string(pSymName, ::strnlen(pSymName, StrTbl.size() - rSym.n_strx));
+  };
+
+  /* Symbols are swapped and converted in chunks, only symbols defined in a section are labeled */
+  size_t ChunkNo = (Syms.size() + ChunkSize - 1) / ChunkSize;
+  std::vector<Database::LabelVector> ChunkLabels(ChunkNo);
+  ParallelFor(ChunkNo, [&](size_t Begin, size_t End)
+  {
+    for (size_t ChunkIdx = Begin; ChunkIdx < End; ++ChunkIdx) {
+      size_t SymEnd = std::min(Syms.size(), (ChunkIdx + 1) * ChunkSize);
+      for (size_t SymIdx = ChunkIdx * ChunkSize; SymIdx < SymEnd; ++SymIdx) {
+        auto& rSym = Syms[SymIdx];
+        MachOType::EndianSwap(rSym, m_Endian);
 
-    std::string SymName;
+        if ((rSym.n_type & N_STAB) || (rSym.n_type & N_TYPE) != N_SECT) {
+          continue;
+        }
+        if (rSym.n_sect == 0 || rSym.n_sect > m_Sections.size()) {
+          continue;
+        }
+        std::string SymName = GetSymbolName(rSym);
+        if (SymName.empty()) {
+          continue;
+        }
+
+        u64 SymAddr = rSym.n_value;
+        u16 LblType = Label::Data;
+        if (m_Sections[rSym.n_sect - 1].m_Flags & (S_ATTR_PURE_INSTRUCTIONS | S_ATTR_SOME_INSTRUCTIONS)) {
+          LblType = std::binary_search(std::begin(FuncStarts), std::end(FuncStarts), SymAddr)
+            ? Label::Function
+            : Label::Code;
+        }
 
-    /* Read Symbol Name */
-    if (!rBinStrm.Read(m_StringsOffset + Sym.n_strx, SymName)) {
-      LOG_WR << "Cannot read the symbol name " << i << LogEnd;
+        if (!(rSym.n_type & N_EXT)) {
+          LblType |= Label::Local;
+        } else {
+          LblType |= (rSym.n_type & N_PEXT) ? Label::Global : Label::Exported;
+        }
+
+        ChunkLabels[ChunkIdx].push_back(std::make_pair(
+          Address(Address::FlatType, 0x0, SymAddr, 0x10, bit),
+          Label(SymName, LblType)));
+      }
+    }
+  });
+
+  Database::LabelVector Labels;
+  for (auto& rChunk : ChunkLabels) {
+    Labels.insert(std::end(Labels), std::begin(rChunk), std::end(rChunk));
+  }
+  rDoc.AddLabels(Labels, false);
+
+  /* Named symbols are kept, other functions are only known to start here */
+  Database::LabelVector FuncLabels;
+  FuncLabels.reserve(FuncStarts.size());
+  for (auto FuncStart : FuncStarts) {
+    Address FuncAddr(Address::FlatType, 0x0, FuncStart, 0x10, bit);
+    FuncLabels.push_back(std::make_pair(FuncAddr, Label(FuncAddr, Label::Function)));
+  }
+  rDoc.AddLabels(FuncLabels, false);
+
+  /* Symbol pointers are described by the indirect symbol table */
+  std::vector<u32> IndSymIdxs;
+  if (m_NumberOfIndirectSymbols != 0x0
+    && !rBinStrm.ReadArray(m_IndirectSymbolsOffset, m_NumberOfIndirectSymbols, IndSymIdxs)) {
+    LOG_WR << "Cannot read symbol indexes" << LogEnd;
+    IndSymIdxs.clear();
+  }
+
+  Database::LabelVector ImpLabels;
+  for (auto const& rScnInfo : m_Sections) {
+    u32 ScnType = rScnInfo.m_Flags & SECTION_TYPE;
+    if ( ScnType != S_NON_LAZY_SYMBOL_POINTERS
+      && ScnType != S_LAZY_SYMBOL_POINTERS
+      && ScnType != S_LAZY_DYLIB_SYMBOL_POINTERS) {
       continue;
     }
 
-    rDoc.AddLabel(
-      Address(Address::FlatType, 0x0, ImpAddr, 0x10, bit),
-      Label(SymName, Label::Imported | Label::Data));
+    u64 PtrNo = rScnInfo.m_Size / (bit / 8);
+    for (u64 PtrIdx = 0; PtrIdx < PtrNo; ++PtrIdx) {
+      u64 IndSymIdx = rScnInfo.m_IndirectSymbolIndex + PtrIdx;
+      if (IndSymIdx >= IndSymIdxs.size()) {
+        break;
+      }
+
+      u32 SymIdx = IndSymIdxs[IndSymIdx];
+      if ((SymIdx & (INDIRECT_SYMBOL_LOCAL | INDIRECT_SYMBOL_ABS)) || SymIdx >= Syms.size()) {
+        continue;
+      }
+      std::string SymName = GetSymbolName(Syms[SymIdx]);
+      if (SymName.empty()) {
+        continue;
+      }
+
+      ImpLabels.push_back(std::make_pair(
+        Address(Address::FlatType, 0x0, rScnInfo.m_Address + PtrIdx * (bit / 8), 0x10, bit),
+        Label(SymName, Label::Imported | Label::Data)));
+    }
   }
+  rDoc.AddLabels(ImpLabels);
+
+  LOG_WR
+    << "Symbols: " << Syms.size() << " parsed, " << Labels.size() << " labels, "
+    << FuncStarts.size() << " function starts, " << ImpLabels.size() << " imports in "
+    << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count() << "ms"
+    << LogEnd;
 }
 
 void MachOLoader::FilterAndConfigureArchitectures(Architecture::VSPType& rArchs) const
 {
   std::string ArchName;
 
-  switch (m_Machine)
+  switch (_GetSelectedMachine())
   {
   case CPU_TYPE_X86:
   case CPU_TYPE_X86_64: ArchName = "Intel x86"; break;
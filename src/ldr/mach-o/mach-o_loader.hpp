@@ -7,6 +7,8 @@
 #include <medusa/log.hpp>
 
 #include <list>
+#include <string>
+#include <vector>
 
 MEDUSA_NAMESPACE_USE
 
@@ -37,27 +39,65 @@ public:
   virtual void             FilterAndConfigureArchitectures(Architecture::VSPType& rArchs) const;
 
 private:
-    template<int bit> void Map(Document& rDoc, Architecture::VSPType const& rArchs);
-    template<int bit> void MapSegment(Document& rDoc, int LoadCmdOff, Tag ArchTag, u8 ArchMode);
-                      void GetEntryPointV1(Document& rDoc, int LoadCmdOff);
-                      void GetEntryPointV2(Document& rDoc, int LoadCmdOff);
-    template<int bit> void GetSymbols(Document& rDoc, int LoadCmdOff);
-    template<int bit> void GetDynamicSymbols(Document& rDoc, int LoadCmdOff);
+    //! Slices of a universal binary, each one is a complete Mach-O file.
+    struct Slice
+    {
+      u32         m_CpuType;
+      bool        m_Arch64;
+      EEndianness m_Endian;
+      u64         m_Offset;
+      u64         m_Size;
+    };
+
+    struct SectionInfo
+    {
+      u64 m_Address;
+      u64 m_Size;
+      u32 m_Flags;
+      u32 m_IndirectSymbolIndex; //! only valid for symbol pointers
+    };
+
+    enum { MaxSliceNo = 0x20 }; //! java class files share the magic, their version is greater
+
+    bool                   _IsCompatibleSlice(BinaryStream const& rBinStrm);
+    template<int bit> bool _ReadFatArchs(BinaryStream const& rBinStrm, u32 NumberOfArchs);
+    void                   _SelectSlice(u32 SliceIdx);
+    u32                    _GetSelectedMachine(void) const;
+    static std::string     _GetCpuTypeName(u32 CpuType);
+
+    template<int bit> void Map(Document& rDoc, BinaryStream const& rBinStrm, Architecture::VSPType const& rArchs);
+    template<int bit> void MapSegment(Document& rDoc, BinaryStream const& rBinStrm, int LoadCmdOff, Tag ArchTag, u8 ArchMode);
+                      void GetEntryPointV1(BinaryStream const& rBinStrm, int LoadCmdOff);
+                      void GetEntryPointV2(BinaryStream const& rBinStrm, int LoadCmdOff);
+    template<int bit> void GetSymbols(BinaryStream const& rBinStrm, int LoadCmdOff);
+    template<int bit> void GetDynamicSymbols(BinaryStream const& rBinStrm, int LoadCmdOff);
+    template<int bit> void GetFunctionStarts(BinaryStream const& rBinStrm, int LoadCmdOff);
+
+    //! This method labels function starts, symbols and imported pointers once all load commands are read.
+    template<int bit> void _MapSymbols(Document& rDoc, BinaryStream const& rBinStrm);
 
     bool                   _FindArchitectureTagAndModeByMachine(
         Architecture::VSPType const& rArchs,
         Tag& rArchTag, u8& rArchMode) const;
 
-    u32            m_Machine;
-    bool           m_Arch64;
-    EEndianness    m_Endian;
-    u64            m_EntryPoint;
-    EntryPointType m_EntryPointType;
-    u64            m_TextSectionVMAddr;
-    u32            m_SymbolsOffset;
-    u32            m_StringsOffset;
-    u64            m_ImportsAddress;
-    u32            m_SymbolsIndex;
+    u32                      m_Machine;
+    bool                     m_Arch64;
+    EEndianness              m_Endian;
+    std::vector<Slice>       m_Slices;
+    u64                      m_SliceOffset;
+    u64                      m_SliceSize;
+    u64                      m_EntryPoint;
+    EntryPointType           m_EntryPointType;
+    u64                      m_TextSegmentVMAddr;
+    std::vector<SectionInfo> m_Sections;
+    u32                      m_SymbolsOffset;
+    u32                      m_NumberOfSymbols;
+    u32                      m_StringsOffset;
+    u32                      m_StringsSize;
+    u32                      m_IndirectSymbolsOffset;
+    u32                      m_NumberOfIndirectSymbols;
+    u32                      m_FunctionStartsOffset;
+    u32                      m_FunctionStartsSize;
 };
 
 extern "C" LDR_MACH_O_EXPORT Loader* GetLoader(void);
@@ -22,6 +22,9 @@ struct MachOTraits<32>
     typedef symtab_command       SymbolTable;
     typedef dysymtab_command     DynamicSymbolTable;
     typedef nlist                Symbol;
+    typedef fat_header           FatHeader;
+    typedef fat_arch             FatArch;
+    typedef linkedit_data_command LinkEditData;
 
     static void EndianSwap(Symbol& Symbol, EEndianness Endianness)
     {
@@ -167,6 +170,41 @@ struct MachOTraits<32>
         ::EndianSwap(LoadCmd.cmdsize);
     }
 
+    static void EndianSwap(FatHeader& FatHeader, EEndianness Endianness)
+    {
+        if (!TestEndian(Endianness)) {
+            return;
+        }
+
+        ::EndianSwap(FatHeader.magic);
+        ::EndianSwap(FatHeader.nfat_arch);
+    }
+
+    static void EndianSwap(FatArch& FatArch, EEndianness Endianness)
+    {
+        if (!TestEndian(Endianness)) {
+            return;
+        }
+
+        ::EndianSwap(FatArch.cputype);
+        ::EndianSwap(FatArch.cpusubtype);
+        ::EndianSwap(FatArch.offset);
+        ::EndianSwap(FatArch.size);
+        ::EndianSwap(FatArch.align);
+    }
+
+    static void EndianSwap(LinkEditData& LinkEditData, EEndianness Endianness)
+    {
+        if (!TestEndian(Endianness)) {
+            return;
+        }
+
+        ::EndianSwap(LinkEditData.cmd);
+        ::EndianSwap(LinkEditData.cmdsize);
+        ::EndianSwap(LinkEditData.dataoff);
+        ::EndianSwap(LinkEditData.datasize);
+    }
+
     static void EndianSwap(MachOHeader& Header, EEndianness Endianness)
     {
         if (!TestEndian(Endianness)) {
@@ -196,6 +234,9 @@ struct MachOTraits<64>
     typedef symtab_command       SymbolTable;
     typedef dysymtab_command     DynamicSymbolTable;
     typedef nlist_64             Symbol;
+    typedef fat_header           FatHeader;
+    typedef fat_arch_64          FatArch;
+    typedef linkedit_data_command LinkEditData;
 
     static void EndianSwap(Symbol& Symbol, EEndianness Endianness)
     {
@@ -346,6 +387,41 @@ struct MachOTraits<64>
         ::EndianSwap(LoadCmd.cmdsize);
     }
 
+    static void EndianSwap(FatHeader& FatHeader, EEndianness Endianness)
+    {
+        if (!TestEndian(Endianness)) {
+            return;
+        }
+
+        ::EndianSwap(FatHeader.magic);
+        ::EndianSwap(FatHeader.nfat_arch);
+    }
+
+    static void EndianSwap(FatArch& FatArch, EEndianness Endianness)
+    {
+        if (!TestEndian(Endianness)) {
+            return;
+        }
+
+        ::EndianSwap(FatArch.cputype);
+        ::EndianSwap(FatArch.cpusubtype);
+        ::EndianSwap(FatArch.offset);
+        ::EndianSwap(FatArch.size);
+        ::EndianSwap(FatArch.align);
+    }
+
+    static void EndianSwap(LinkEditData& LinkEditData, EEndianness Endianness)
+    {
+        if (!TestEndian(Endianness)) {
+            return;
+        }
+
+        ::EndianSwap(LinkEditData.cmd);
+        ::EndianSwap(LinkEditData.cmdsize);
+        ::EndianSwap(LinkEditData.dataoff);
+        ::EndianSwap(LinkEditData.datasize);
+    }
+
     static void EndianSwap(MachOHeader& Header, EEndianness Endianness)
     {
         if (!TestEndian(Endianness)) {
@@ -173,4 +173,31 @@ DEF_STRUCT_SWAP(PeImportByName,
   //Name[1];
 )
 
+DEF_STRUCT_SWAP(PeDelayLoadDescriptor,
+  ::EndianSwap(Attributes);
+  ::EndianSwap(DllNameRVA);
+  ::EndianSwap(ModuleHandleRVA);
+  ::EndianSwap(ImportAddressTableRVA);
+  ::EndianSwap(ImportNameTableRVA);
+  ::EndianSwap(BoundImportAddressTableRVA);
+  ::EndianSwap(UnloadInformationTableRVA);
+  ::EndianSwap(TimeDateStamp);
+)
+
+DEF_STRUCT_SWAP(PeBaseRelocation,
+  ::EndianSwap(VirtualAddress);
+  ::EndianSwap(SizeOfBlock);
+)
+
+DEF_STRUCT_SWAP(PeRuntimeFunction,
+  ::EndianSwap(BeginAddress);
+  ::EndianSwap(EndAddress);
+  ::EndianSwap(UnwindInfoAddress);
+)
+
+DEF_STRUCT_SWAP(PeArmRuntimeFunction,
+  ::EndianSwap(BeginAddress);
+  ::EndianSwap(UnwindData);
+)
+
 #undef DEF_STRUCT_SWAP
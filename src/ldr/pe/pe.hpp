@@ -62,6 +62,17 @@ MEDUSA_NAMESPACE_USE
 #define PE_ORDINAL_FLAG32              0x80000000
 #define PE_ORDINAL_FLAG64              0x8000000000000000ULL
 
+#define PE_REL_BASED_ABSOLUTE          0  /* padding */
+#define PE_REL_BASED_HIGH              1
+#define PE_REL_BASED_LOW               2
+#define PE_REL_BASED_HIGHLOW           3
+#define PE_REL_BASED_HIGHADJ           4  /* followed by an entry which holds the low part */
+#define PE_REL_BASED_DIR64             10
+
+#define PE_DELAYLOAD_RVA_BASED         0x1
+
+#define PE_UNW_FLAG_CHAININFO          0x4
+
 struct PeDosHeader
 {
   void Swap(EEndianness Endianness);
@@ -286,6 +297,43 @@ struct PeImportByName
   u8 Name[1];
 };
 
+struct PeDelayLoadDescriptor
+{
+  void Swap(EEndianness Endianness);
+  u32 Attributes;                 // PE_DELAYLOAD_RVA_BASED if fields are RVA, VA otherwise
+  u32 DllNameRVA;
+  u32 ModuleHandleRVA;
+  u32 ImportAddressTableRVA;
+  u32 ImportNameTableRVA;
+  u32 BoundImportAddressTableRVA;
+  u32 UnloadInformationTableRVA;
+  u32 TimeDateStamp;
+};
+
+struct PeBaseRelocation
+{
+  void Swap(EEndianness Endianness);
+  u32 VirtualAddress;
+  u32 SizeOfBlock;                // including this header, followed by u16 entries (type << 12 | offset)
+};
+
+// Exception directory entry of x64
+struct PeRuntimeFunction
+{
+  void Swap(EEndianness Endianness);
+  u32 BeginAddress;
+  u32 EndAddress;
+  u32 UnwindInfoAddress;
+};
+
+// Exception directory entry of ARM, the unwind data is packed if its lowest bits are not zero
+struct PeArmRuntimeFunction
+{
+  void Swap(EEndianness Endianness);
+  u32 BeginAddress;
+  u32 UnwindData;
+};
+
 template<int bit> struct PeTraits {};
 
 template<> struct PeTraits<32>
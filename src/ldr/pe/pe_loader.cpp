@@ -1,9 +1,15 @@
 #include "medusa/medusa.hpp"
 #include "pe_loader.hpp"
+#include "medusa/util.hpp"
 
 #include <boost/format.hpp>
 
-PeLoader::PeLoader(void) : m_Machine(PE_FILE_MACHINE_UNKNOWN), m_Magic(0x0)
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+PeLoader::PeLoader(void) : m_Machine(PE_FILE_MACHINE_UNKNOWN), m_Magic(0x0), m_SizeOfHeaders(0x0)
 {
 }
 
@@ -43,9 +49,26 @@ bool PeLoader::IsCompatible(BinaryStream const& rBinStrm)
     return false;
   FileHeader.Swap(LittleEndian);
   m_Machine = FileHeader.Machine;
-  if (!rBinStrm.Read(DosHdr.e_lfanew + sizeof(Signature) + sizeof(PeFileHeader), m_Magic))
+  TOffset OptHdrOff = DosHdr.e_lfanew + sizeof(Signature) + sizeof(PeFileHeader);
+  if (!rBinStrm.Read(OptHdrOff, m_Magic))
     return false;
 
+  // The image is mapped at its preferred base, unless the user rebases it
+  u64 ImgBase = 0x0;
+  if (m_Magic == PE_NT_OPTIONAL_HDR64_MAGIC)
+  {
+    if (!rBinStrm.Read(OptHdrOff + offsetof(PeOptionalHeader64, ImageBase), ImgBase))
+      return false;
+  }
+  else
+  {
+    u32 ImgBase32;
+    if (!rBinStrm.Read(OptHdrOff + offsetof(PeOptionalHeader32, ImageBase), ImgBase32))
+      return false;
+    ImgBase = ImgBase32;
+  }
+  m_CfgMdl.InsertUint64("Image base", ImgBase);
+
   return true;
 }
 
@@ -121,6 +144,120 @@ bool PeLoader::_FindArchitectureTagAndModeByMachine(
   return false;
 }
 
+bool PeLoader::_ConvertRvaToOffset(u64 Rva, u64 Size, TOffset& rOffset) const
+{
+  if (Rva + Size <= m_SizeOfHeaders)
+  {
+    rOffset = Rva;
+    return true;
+  }
+
+  for (auto const& rScnHdr : m_Sections)
+  {
+    if (Rva < rScnHdr.VirtualAddress || Rva + Size > static_cast<u64>(rScnHdr.VirtualAddress) + rScnHdr.SizeOfRawData)
+      continue;
+    rOffset = rScnHdr.PointerToRawData + (Rva - rScnHdr.VirtualAddress);
+    return true;
+  }
+
+  return false;
+}
+
+bool PeLoader::_ReadString(BinaryStream const& rBinStrm, u64 Rva, std::string& rString) const
+{
+  TOffset StrOff;
+  if (!_ConvertRvaToOffset(Rva, 1, StrOff))
+    return false;
+  return rBinStrm.Read(StrOff, rString);
+}
+
+template<typename T> bool PeLoader::_ReadNullTerminatedArray(BinaryStream const& rBinStrm, TOffset Offset, std::vector<T>& rValues) const
+{
+  enum { ChunkCount = 0x100 };
+
+  rValues.clear();
+  std::vector<T> Chunk;
+  while (Offset < rBinStrm.GetSize())
+  {
+    u64 Count = std::min<u64>(ChunkCount, (rBinStrm.GetSize() - Offset) / sizeof(T));
+    if (Count == 0 || !rBinStrm.ReadArray(Offset, Count, Chunk))
+      return false;
+
+    for (auto const& rValue : Chunk)
+    {
+      auto pBytes = reinterpret_cast<u8 const*>(&rValue);
+      if (std::all_of(pBytes, pBytes + sizeof(T), [](u8 Byte) { return Byte == 0x0; }))
+        return true;
+      rValues.push_back(rValue);
+    }
+    Offset += Count * sizeof(T);
+  }
+
+  return false;
+}
+
+void PeLoader::_AddImportLabels(Document& rDoc, Database::LabelVector const& rLabels)
+{
+  rDoc.AddLabels(rLabels);
+
+  // Slots are pointers, they're shown as imported functions
+  for (auto const& rImport : rLabels)
+  {
+    auto const& rSymAddr = rImport.first;
+    std::string SymName  = rImport.second.GetName();
+    rDoc.ChangeValueSize(rSymAddr, rSymAddr.GetOffsetSize(), true);
+    rDoc.BindDetailId(rSymAddr, 0, Sha1(SymName));
+    auto pFunc = new Function(SymName, 0, 0);
+    rDoc.SetMultiCell(rSymAddr, pFunc, true);
+  }
+}
+
+template<int bit> bool PeLoader::_ReadImportedSymbols(
+    BinaryStream const& rBinStrm, std::string const& rModuleName,
+    u64 ImageBase, u64 NameTableRva, u64 AddressTableRva, u64 ThunkBias,
+    Database::LabelVector& rLabels) const
+{
+  typedef PeTraits<bit> PeType;
+
+  // The name table is never bound, unlike the address table
+  TOffset ThunkOff;
+  std::vector<typename PeType::ThunkData> Thunks;
+  if (!_ConvertRvaToOffset(NameTableRva, sizeof(typename PeType::ThunkData), ThunkOff)
+    || !_ReadNullTerminatedArray(rBinStrm, ThunkOff, Thunks))
+  {
+    Log::Write("ldr_pe") << "unable to read thunks of " << rModuleName << LogEnd;
+    return false;
+  }
+
+  u64 SlotRva = AddressTableRva;
+  for (auto& rThunk : Thunks)
+  {
+    rThunk.Swap(LittleEndian);
+    std::string SymName = rModuleName + "!";
+
+    if (rThunk.IsOrdinal())
+      SymName += (boost::format("ordinal_%d") % rThunk.GetOrdinal()).str();
+    else
+    {
+      // Get ImageImportByName
+      std::string ThunkName;
+      if (!_ReadString(rBinStrm, rThunk.AddressOfData - ThunkBias + offsetof(typename PeType::ImportByName, Name), ThunkName))
+      {
+        Log::Write("ldr_pe") << "unable to read function name" << LogEnd;
+        return false;
+      }
+      SymName += ThunkName;
+    }
+
+    rLabels.push_back(std::make_pair(
+      Address(Address::FlatType, 0x0, ImageBase + SlotRva, 0, bit),
+      Label(SymName, Label::Code | Label::Imported)));
+    SlotRva += sizeof(typename PeType::ThunkData);
+  }
+
+  return true;
+}
+
 template<int bit> void PeLoader::_Map(Document& rDoc, Architecture::VSPType const& rArchs)
 {
   BinaryStream const& rBinStrm = rDoc.GetBinaryStream();
@@ -129,6 +266,8 @@ template<int bit> void PeLoader::_Map(Document& rDoc, Architecture::VSPType cons
   typename PeType::DosHeader DosHdr;
   typename PeType::NtHeaders NtHdrs;
 
+  auto StartTime = std::chrono::steady_clock::now();
+
   if (!rBinStrm.Read(0x0, &DosHdr, sizeof(DosHdr)))
   {
     Log::Write("ldr_pe") << "unable to read DOS header" << LogEnd;
@@ -143,29 +282,71 @@ template<int bit> void PeLoader::_Map(Document& rDoc, Architecture::VSPType cons
   }
   NtHdrs.Swap(LittleEndian);
 
-  u64 ImgBase  = NtHdrs.OptionalHeader.ImageBase;
-  u64 EpOff    = ImgBase + NtHdrs.OptionalHeader.AddressOfEntryPoint;
+  auto const& rOptHdr = NtHdrs.OptionalHeader;
+  u64 PrefImgBase = rOptHdr.ImageBase;
+  u64 ImgBase     = PrefImgBase;
+  if (m_CfgMdl.IsSet("Image base") && m_CfgMdl.GetUint64("Image base") != 0x0)
+    ImgBase = m_CfgMdl.GetUint64("Image base");
+  u64 EpOff    = ImgBase + rOptHdr.AddressOfEntryPoint;
   u16 NumOfScn = NtHdrs.FileHeader.NumberOfSections;
   u64 ScnOff   = DosHdr.e_lfanew + offsetof(typename PeType::NtHeaders, OptionalHeader) + NtHdrs.FileHeader.SizeOfOptionalHeader;
 
   Log::Write("ldr_pe")
-    <<   "ImageBase: "         << ImgBase
+    <<   "ImageBase: "         << PrefImgBase
+    << ", Mapped at: "         << ImgBase
     << ", EntryPoint: "        << EpOff
     << ", Number of section: " << NumOfScn
     << LogEnd;
 
+  if (!rBinStrm.ReadArray(ScnOff, NumOfScn, m_Sections))
+  {
+    Log::Write("ldr_pe") << "unable to read IMAGE_SECTION_HEADER" << LogEnd;
+    return;
+  }
+  for (auto& rScnHdr : m_Sections)
+    rScnHdr.Swap(LittleEndian);
+  m_SizeOfHeaders = rOptHdr.SizeOfHeaders;
+
   Address EpAddr(Address::FlatType, 0x0, EpOff, 0x10, bit);
   rDoc.AddLabel(EpAddr, Label("start", Label::Code | Label::Exported));
 
-  _MapSections<bit>(rDoc, rArchs, ImgBase, ScnOff, NumOfScn);
-  _ResolveImports<bit>(rDoc, ImgBase,
-    NtHdrs.OptionalHeader.DataDirectory[PE_DIRECTORY_ENTRY_IMPORT].VirtualAddress,
-    NtHdrs.OptionalHeader.DataDirectory[PE_DIRECTORY_ENTRY_IAT].VirtualAddress);
-  _ResolveExports<bit>(rDoc, ImgBase,
-    NtHdrs.OptionalHeader.DataDirectory[PE_DIRECTORY_ENTRY_EXPORT].VirtualAddress);
+  _MapSections<bit>(rDoc, rArchs, ImgBase);
+
+  auto GetDirectory = [&rOptHdr](u32 Index) -> PeDataDirectory
+  {
+    PeDataDirectory DataDir = { 0x0, 0x0 };
+    if (Index < rOptHdr.NumberOfRvaAndSizes && Index < PE_NUMBEROF_DIRECTORY_ENTRIES)
+      DataDir = rOptHdr.DataDirectory[Index];
+    return DataDir;
+  };
+
+  auto ExpDir    = GetDirectory(PE_DIRECTORY_ENTRY_EXPORT);
+  auto ImpDir    = GetDirectory(PE_DIRECTORY_ENTRY_IMPORT);
+  auto DlyImpDir = GetDirectory(PE_DIRECTORY_ENTRY_DELAY_IMPORT);
+  auto ExcpDir   = GetDirectory(PE_DIRECTORY_ENTRY_EXCEPTION);
+  auto RelocDir  = GetDirectory(PE_DIRECTORY_ENTRY_BASERELOC);
+
+  // Base relocations are applied first, so pointers read by other directories are rebased
+  if (RelocDir.VirtualAddress != 0x0 && RelocDir.Size != 0x0)
+    _ResolveBaseRelocations<bit>(rDoc, PrefImgBase, ImgBase, rOptHdr.SizeOfImage, RelocDir.VirtualAddress, RelocDir.Size);
+
+  // Exports are resolved first, other labels don't replace their names
+  if (ExpDir.VirtualAddress != 0x0)
+    _ResolveExports<bit>(rDoc, ImgBase, ExpDir.VirtualAddress, ExpDir.Size);
+  if (ImpDir.VirtualAddress != 0x0)
+    _ResolveImports<bit>(rDoc, ImgBase, ImpDir.VirtualAddress);
+  if (DlyImpDir.VirtualAddress != 0x0)
+    _ResolveDelayImports<bit>(rDoc, ImgBase, DlyImpDir.VirtualAddress);
+  if (ExcpDir.VirtualAddress != 0x0 && ExcpDir.Size != 0x0)
+    _MapRuntimeFunctions<bit>(rDoc, ImgBase, ExcpDir.VirtualAddress, ExcpDir.Size);
+
+  Log::Write("ldr_pe")
+    << "mapped in "
+    << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count() << "ms"
+    << LogEnd;
 }
 
-template<int bit> void PeLoader::_MapSections(Document& rDoc, Architecture::VSPType const& rArchs, u64 ImageBase, u64 SectionHeadersOffset, u16 NumberOfSection)
+template<int bit> void PeLoader::_MapSections(Document& rDoc, Architecture::VSPType const& rArchs, u64 ImageBase)
 {
   Tag ArchTag  = MEDUSA_ARCH_UNK;
   u8  ArchMode = 0;
@@ -173,19 +354,9 @@ template<int bit> void PeLoader::_MapSections(Document& rDoc, Architecture::VSPT
   if (!_FindArchitectureTagAndModeByMachine(rArchs, ArchTag, ArchMode))
     return;
 
-  BinaryStream const&            rBinStrm = rDoc.GetBinaryStream();
-  typedef PeTraits<bit>          PeType;
-  typename PeType::SectionHeader ScnHdr;
-
-  for (u16 ScnIdx = 0; ScnIdx < NumberOfSection; ++ScnIdx)
+  for (auto const& ScnHdr : m_Sections)
   {
     u32 Flags = MemoryArea::Read;
-    if (!rBinStrm.Read(SectionHeadersOffset + ScnIdx * sizeof(ScnHdr), &ScnHdr, sizeof(ScnHdr)))
-    {
-      Log::Write("ldr_pe") << "unable to read IMAGE_SECTION_HEADER" << LogEnd;
-      continue;
-    }
-    ScnHdr.Swap(LittleEndian);
 
     u32 ScnVirtSz = ScnHdr.Misc.VirtualSize ? ScnHdr.Misc.VirtualSize : ScnHdr.SizeOfRawData;
     std::string ScnName(reinterpret_cast<char const*>(ScnHdr.Name), 0, PE_SIZEOF_SHORT_NAME);
@@ -213,212 +384,406 @@ template<int bit> void PeLoader::_MapSections(Document& rDoc, Architecture::VSPT
     Log::Write("ldr_pe") << "found section " << ScnName << LogEnd;
   }
 }
-template<int bit> void PeLoader::_ResolveImports(Document& rDoc, u64 ImageBase, u64 ImportDirectoryRva, u64 ImportAddressTableRva)
+
+template<int bit> void PeLoader::_ResolveImports(Document& rDoc, u64 ImageBase, u64 ImportDirectoryRva)
 {
-  auto const&                       rBinStrm = rDoc.GetBinaryStream();
-  typedef PeTraits<bit>             PeType;
-  typename PeType::ImportDescriptor CurImp, EndImp;
-  ::memset(&EndImp, 0x0, sizeof(EndImp));
+  auto const&           rBinStrm = rDoc.GetBinaryStream();
+  typedef PeTraits<bit> PeType;
 
   TOffset ImpOff;
-  if (!rDoc.ConvertAddressToFileOffset(ImageBase + ImportDirectoryRva, ImpOff))
+  std::vector<typename PeType::ImportDescriptor> ImpDescs;
+  if (!_ConvertRvaToOffset(ImportDirectoryRva, sizeof(typename PeType::ImportDescriptor), ImpOff)
+    || !_ReadNullTerminatedArray(rBinStrm, ImpOff, ImpDescs))
   {
-    Log::Write("ldr_pe") << "unable to convert address import directory" << LogEnd;
+    Log::Write("ldr_pe") << "unable to read IMAGE_IMPORT_DESCRIPTOR" << LogEnd;
     return;
   }
 
-  while (true)
+  Database::LabelVector Labels;
+  for (auto& rImpDesc : ImpDescs)
   {
-    if (!rBinStrm.Read(ImpOff, &CurImp, sizeof(CurImp)))
-    {
-      Log::Write("ldr_pe") << "unable to read IMAGE_IMPORT_DESCRIPTOR" << LogEnd;
-      return;
-    }
-    ImpOff += sizeof(CurImp);
-    CurImp.Swap(LittleEndian);
-    if (!memcmp(&CurImp, &EndImp, sizeof(CurImp)))
-      break;
-
-    TOffset ImpNameOff;
-    if (!rDoc.ConvertAddressToFileOffset(ImageBase + CurImp.Name, ImpNameOff))
-    {
-      Log::Write("ldr_pe") << "unable to convert import name address to offset" << LogEnd;
-      return;
-    }
+    rImpDesc.Swap(LittleEndian);
 
     std::string ImpName;
-    if (!rBinStrm.Read(ImpNameOff, ImpName))
+    if (!_ReadString(rBinStrm, rImpDesc.Name, ImpName))
     {
       Log::Write("ldr_pe") << "unable to read import name" << LogEnd;
-      return;
+      continue;
     }
     std::transform(std::begin(ImpName), std::end(ImpName), std::begin(ImpName), ::tolower);
     Log::Write("ldr_pe") << "found import: " << ImpName << LogEnd;
 
-    // For each thunks (imported symbol) ...
-    std::string       FuncName;
-    TOffset           OrgThunkRva = CurImp.OriginalFirstThunk ? CurImp.OriginalFirstThunk : CurImp.FirstThunk,
-      ThunkRva = CurImp.FirstThunk,
-      FuncOff;
-    typename PeType::ThunkData CurOrgThunk, CurThunk, EndThunk = { 0 };
+    u64 NameTableRva = rImpDesc.OriginalFirstThunk ? rImpDesc.OriginalFirstThunk : rImpDesc.FirstThunk;
+    _ReadImportedSymbols<bit>(rBinStrm, ImpName, ImageBase, NameTableRva, rImpDesc.FirstThunk, 0x0, Labels);
+  }
 
-    TOffset OrgThunkOff;
-    if (!rDoc.ConvertAddressToFileOffset(ImageBase + OrgThunkRva, OrgThunkOff))
-    {
-      Log::Write("ldr_pe") << "unable to convert thunk address to offset" << LogEnd;
-      return;
-    }
+  _AddImportLabels(rDoc, Labels);
+  Log::Write("ldr_pe") << "imports: " << ImpDescs.size() << " modules, " << Labels.size() << " symbols" << LogEnd;
+}
 
-    TOffset ThunkOff;
-    if (!rDoc.ConvertAddressToFileOffset(ImageBase + ThunkRva, ThunkOff))
-    {
-      Log::Write("ldr_pe") << "unable to convert original thunk address to offset" << LogEnd;
-      return;
-    }
+template<int bit> void PeLoader::_ResolveDelayImports(Document& rDoc, u64 ImageBase, u64 DelayImportDirectoryRva)
+{
+  auto const&           rBinStrm = rDoc.GetBinaryStream();
+  typedef PeTraits<bit> PeType;
 
-    while (true)
-    {
-      if (!rBinStrm.Read(OrgThunkOff, &CurOrgThunk, sizeof(CurOrgThunk)))
-      {
-        Log::Write("ldr_pe") << "unable to read original thunk" << LogEnd;
-        return;
-      }
-      OrgThunkOff += sizeof(CurOrgThunk);
-      CurOrgThunk.Swap(LittleEndian);
-      if (!memcmp(&CurOrgThunk, &EndThunk, sizeof(CurThunk)))
-        break;
+  TOffset DlyOff;
+  std::vector<PeDelayLoadDescriptor> DlyDescs;
+  if (!_ConvertRvaToOffset(DelayImportDirectoryRva, sizeof(PeDelayLoadDescriptor), DlyOff)
+    || !_ReadNullTerminatedArray(rBinStrm, DlyOff, DlyDescs))
+  {
+    Log::Write("ldr_pe") << "unable to read delay-load descriptors" << LogEnd;
+    return;
+  }
 
-      if (!rBinStrm.Read(ThunkOff, &CurThunk, sizeof(CurThunk)))
-      {
-        Log::Write("ldr_pe") << "unable to read thunk" << LogEnd;
-        return;
-      }
-      ThunkOff += sizeof(CurThunk);
-      CurThunk.Swap(LittleEndian);
-      if (!memcmp(&CurThunk, &EndThunk, sizeof(CurOrgThunk)))
-        break;
+  Database::LabelVector          Labels;
+  Database::CrossReferenceVector XRefs;
+  for (auto& rDlyDesc : DlyDescs)
+  {
+    rDlyDesc.Swap(LittleEndian);
 
-      std::string SymName = ImpName + "!";
+    // Descriptors of old linkers contain VA instead of RVA
+    u64 Bias = (rDlyDesc.Attributes & PE_DELAYLOAD_RVA_BASED) ? 0x0 : ImageBase;
 
-      if (CurThunk.IsOrdinal())
-      {
-        std::stringstream OrdStrm;
-        OrdStrm << CurThunk.GetOrdinal();
-        SymName += "ordinal_" + OrdStrm.str();
-      }
-      else
-      {
-        // Get ImageImportByName
-        if (!rDoc.ConvertAddressToFileOffset(ImageBase + CurOrgThunk.Function, FuncOff))
-        {
-          Log::Write("ldr_pe") << "unable to convert function address to offset" << LogEnd;
-          return;
-        }
-        std::string ThunkName;
-        if (!rBinStrm.Read(FuncOff + offsetof(typename PeType::ImportByName, Name), ThunkName))
-        {
-          Log::Write("ldr_pe") << "unable to read function name" << LogEnd;
-          return;
-        }
-        SymName += ThunkName;
-      }
+    std::string ImpName;
+    if (!_ReadString(rBinStrm, rDlyDesc.DllNameRVA - Bias, ImpName))
+    {
+      Log::Write("ldr_pe") << "unable to read delay-load import name" << LogEnd;
+      continue;
+    }
+    std::transform(std::begin(ImpName), std::end(ImpName), std::begin(ImpName), ::tolower);
+    Log::Write("ldr_pe") << "found delay-load import: " << ImpName << LogEnd;
+
+    size_t FirstLbl = Labels.size();
+    u64    IatRva   = rDlyDesc.ImportAddressTableRVA - Bias;
+    if (!_ReadImportedSymbols<bit>(rBinStrm, ImpName, ImageBase, rDlyDesc.ImportNameTableRVA - Bias, IatRva, Bias, Labels))
+      continue;
 
-      Address SymAddr(Address::FlatType, 0x0, ImageBase + ThunkRva, 0, bit);
-      ThunkRva += sizeof(typename PeType::ThunkData);
-      Log::Write("ldr_pe") << SymAddr << ":   " << SymName << LogEnd;
-      rDoc.AddLabel(SymAddr, Label(SymName, Label::Code | Label::Imported));
-      rDoc.ChangeValueSize(SymAddr, SymAddr.GetOffsetSize(), true);
-      rDoc.BindDetailId(SymAddr, 0, Sha1(SymName));
-      auto pFunc = new Function(SymName, 0, 0);
-      rDoc.SetMultiCell(SymAddr, pFunc, true);
+    // Until the module is loaded, each slot points to a stub which calls the delay-load helper
+    TOffset IatOff;
+    std::vector<typename PeType::ThunkData> Slots;
+    u64 SlotNo = Labels.size() - FirstLbl;
+    if (!_ConvertRvaToOffset(IatRva, SlotNo * sizeof(typename PeType::ThunkData), IatOff)
+      || !rBinStrm.ReadArray(IatOff, SlotNo, Slots))
+      continue;
+    for (size_t SlotIdx = 0; SlotIdx < Slots.size(); ++SlotIdx)
+    {
+      Slots[SlotIdx].Swap(LittleEndian);
+      if (Slots[SlotIdx].Function == 0x0)
+        continue;
+      XRefs.push_back(std::make_pair(
+        Address(Address::FlatType, 0x0, Slots[SlotIdx].Function, 0x10, bit),
+        Labels[FirstLbl + SlotIdx].first));
     }
   }
+
+  _AddImportLabels(rDoc, Labels);
+  rDoc.AddCrossReferences(XRefs);
+  Log::Write("ldr_pe") << "delay-load imports: " << DlyDescs.size() << " modules, " << Labels.size() << " symbols" << LogEnd;
 }
 
-template<int bit> void PeLoader::_ResolveExports(Document& rDoc, u64 ImageBase, u64 ExportDirectoryRva)
+template<int bit> void PeLoader::_ResolveExports(Document& rDoc, u64 ImageBase, u64 ExportDirectoryRva, u32 ExportDirectorySize)
 {
   auto const& rBinStrm = rDoc.GetBinaryStream();
   typedef PeTraits<bit> PeType;
 
+  auto StartTime = std::chrono::steady_clock::now();
+
   typename PeType::ExportDirectory ExpDir;
   TOffset ExpDirOff;
-  if (!rDoc.ConvertAddressToFileOffset(ImageBase + ExportDirectoryRva, ExpDirOff))
-  {
-    Log::Write("ldr_pe") << "unable to convert export directory address to offset" << LogEnd;
-    return;
-  }
-  if (!rBinStrm.Read(ExpDirOff, &ExpDir, sizeof(ExpDir)))
+  if (!_ConvertRvaToOffset(ExportDirectoryRva, sizeof(ExpDir), ExpDirOff)
+    || !rBinStrm.Read(ExpDirOff, &ExpDir, sizeof(ExpDir)))
   {
     Log::Write("ldr_pe") << "unable to read export directory" << LogEnd;
     return;
   }
+  ExpDir.Swap(LittleEndian);
 
+  // Export tables are read at once
   TOffset FuncOff, NameOff, OrdOff;
-  if (!rDoc.ConvertAddressToFileOffset(ImageBase + ExpDir.AddressOfFunctions, FuncOff))
+  std::vector<u32> FuncRvas, SymNameRvas;
+  std::vector<u16> Ords;
+  if (!_ConvertRvaToOffset(ExpDir.AddressOfFunctions, static_cast<u64>(ExpDir.NumberOfFunctions) * sizeof(u32), FuncOff)
+    || !rBinStrm.ReadArray(FuncOff, ExpDir.NumberOfFunctions, FuncRvas))
   {
-    Log::Write("ldr_pe") << "unable to convert functions address to offset" << LogEnd;
+    Log::Write("ldr_pe") << "unable to read function rvas" << LogEnd;
     return;
   }
-  if (!rDoc.ConvertAddressToFileOffset(ImageBase + ExpDir.AddressOfNames, NameOff))
+  if (ExpDir.NumberOfNames != 0 &&
+    (  !_ConvertRvaToOffset(ExpDir.AddressOfNames,        static_cast<u64>(ExpDir.NumberOfNames) * sizeof(u32), NameOff)
+    || !_ConvertRvaToOffset(ExpDir.AddressOfNameOrdinals, static_cast<u64>(ExpDir.NumberOfNames) * sizeof(u16), OrdOff)
+    || !rBinStrm.ReadArray(NameOff, ExpDir.NumberOfNames, SymNameRvas)
+    || !rBinStrm.ReadArray(OrdOff,  ExpDir.NumberOfNames, Ords)))
   {
-    Log::Write("ldr_pe") << "unable to convert names address to offset" << LogEnd;
+    Log::Write("ldr_pe") << "unable to read export names" << LogEnd;
     return;
   }
-  if (!rDoc.ConvertAddressToFileOffset(ImageBase + ExpDir.AddressOfNameOrdinals, OrdOff))
+
+  Database::LabelVector Labels;
+  Labels.reserve(FuncRvas.size());
+  std::vector<bool> IsNamed(FuncRvas.size(), false);
+  u32 FwdNo = 0;
+
+  auto AddExport = [&](u32 FuncRva, std::string const& rSymName)
   {
-    Log::Write("ldr_pe") << "unable to convert ordinals address to offset" << LogEnd;
-    return;
-  }
+    Address SymAddr(Address::FlatType, 0x0, ImageBase + FuncRva, 0x10, bit);
+
+    // Forwarded exports point to a string like "module.function"
+    if (FuncRva >= ExportDirectoryRva && FuncRva < ExportDirectoryRva + ExportDirectorySize)
+    {
+      Labels.push_back(std::make_pair(SymAddr, Label(rSymName, Label::String | Label::Exported)));
+      ++FwdNo;
+      return;
+    }
 
-  for (u32 i = 0; i < ExpDir.NumberOfFunctions; ++i)
+    // We assume we only export function which is definitely false,
+    // but improve the analysis (false positive should be negligible)
+    Labels.push_back(std::make_pair(SymAddr, Label(rSymName, Label::Exported | Label::Function)));
+  };
+
+  for (u32 NameIdx = 0; NameIdx < SymNameRvas.size(); ++NameIdx)
   {
-    u16 Ord;
-    if (!rBinStrm.Read(OrdOff + i * sizeof(Ord), Ord))
+    u16 Ord = Ords[NameIdx];
+    if (Ord >= FuncRvas.size() || FuncRvas[Ord] == 0x0)
     {
-      Log::Write("ldr_pe") << "unable to read ordinal: " << i << LogEnd;
+      Log::Write("ldr_pe") << "invalid ordinal for export name: " << NameIdx << LogEnd;
       continue;
     }
 
-    u32 FuncRva;
-    if (!rBinStrm.Read(FuncOff + Ord * sizeof(FuncRva), FuncRva))
+    std::string SymName;
+    if (!_ReadString(rBinStrm, SymNameRvas[NameIdx], SymName))
     {
-      Log::Write("ldr_pe") << "unable to read function rva: " << i << LogEnd;
+      Log::Write("ldr_pe") << "unable to read export name" << LogEnd;
       continue;
     }
 
-    std::string SymName;
-    // Function name if available
-    if (i < ExpDir.NumberOfNames)
+    IsNamed[Ord] = true;
+    AddExport(FuncRvas[Ord], SymName);
+  }
+
+  // Unnamed exports have no entry in the ordinal table
+  for (u32 Ord = 0; Ord < FuncRvas.size(); ++Ord)
+  {
+    if (IsNamed[Ord] || FuncRvas[Ord] == 0x0)
+      continue;
+    AddExport(FuncRvas[Ord], (boost::format("ord_%d") % (Ord + ExpDir.Base)).str());
+  }
+
+  rDoc.AddLabels(Labels);
+  for (auto const& rExport : Labels)
+    if ((rExport.second.GetType() & Label::CellMask) == Label::Function)
+      rDoc.BindDetailId(rExport.first, 0, Sha1(rExport.second.GetName()));
+
+  Log::Write("ldr_pe")
+    << "exports: " << FuncRvas.size() << " functions, " << SymNameRvas.size() << " names, " << FwdNo << " forwarded in "
+    << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count() << "ms"
+    << LogEnd;
+}
+
+template<int bit> void PeLoader::_ResolveBaseRelocations(Document& rDoc, u64 PreferredImageBase, u64 ImageBase, u32 SizeOfImage, u64 BaseRelocationRva, u32 BaseRelocationSize)
+{
+  enum { ChunkSize = 0x4000 };
+
+  auto const& rBinStrm  = rDoc.GetBinaryStream();
+  auto        StartTime = std::chrono::steady_clock::now();
+
+  TOffset RelocOff;
+  if (!_ConvertRvaToOffset(BaseRelocationRva, BaseRelocationSize, RelocOff))
+  {
+    Log::Write("ldr_pe") << "unable to convert base relocation address to offset" << LogEnd;
+    return;
+  }
+
+  // Blocks are parsed first, then slots are read in parallel
+  typedef std::pair<u32, u8> SlotType; //! rva and size of the relocated value
+  std::vector<SlotType> Slots;
+  std::vector<u16>      EntryStorage;
+  u32                   UnsupportedNo = 0;
+  for (TOffset BlkOff = RelocOff, EndOff = RelocOff + BaseRelocationSize; BlkOff + sizeof(PeBaseRelocation) <= EndOff;)
+  {
+    PeBaseRelocation BlkHdr;
+    if (!rBinStrm.Read(BlkOff, &BlkHdr, sizeof(BlkHdr)))
+      break;
+    BlkHdr.Swap(LittleEndian);
+    if (BlkHdr.SizeOfBlock < sizeof(BlkHdr) || BlkOff + BlkHdr.SizeOfBlock > EndOff)
+    {
+      Log::Write("ldr_pe") << "invalid base relocation block at " << BlkOff << LogEnd;
+      break;
+    }
+
+    Span<u16 const> Entries;
+    if (!rBinStrm.ReadSpan(BlkOff + sizeof(BlkHdr), (BlkHdr.SizeOfBlock - sizeof(BlkHdr)) / sizeof(u16), Entries, EntryStorage))
+      break;
+
+    for (size_t EntryIdx = 0; EntryIdx < Entries.size(); ++EntryIdx)
     {
-      u32 SymNameRva;
-      if (!rBinStrm.Read(NameOff + i * sizeof(SymNameRva), SymNameRva))
+      u16 Entry   = Entries[EntryIdx];
+      u32 SlotRva = BlkHdr.VirtualAddress + (Entry & 0xfff);
+      switch (Entry >> 12)
       {
-        Log::Write("ldr_pe") << "unable to read export name rva: " << i << LogEnd;
-        continue;
+      case PE_REL_BASED_ABSOLUTE:                                        break;
+      case PE_REL_BASED_HIGHLOW: Slots.push_back(SlotType(SlotRva, 4)); break;
+      case PE_REL_BASED_DIR64:   Slots.push_back(SlotType(SlotRva, 8)); break;
+      case PE_REL_BASED_HIGHADJ: ++EntryIdx; ++UnsupportedNo;            break;
+      default:                   ++UnsupportedNo;                        break;
       }
-      TOffset SymNameOff;
-      if (!rDoc.ConvertAddressToFileOffset(ImageBase + SymNameRva, SymNameOff))
+    }
+
+    BlkOff += BlkHdr.SizeOfBlock;
+  }
+
+  // Slots contain addresses for the preferred image base, they're moved by the difference of the bases
+  // in the patch overlay, so the original file is left untouched
+  u64    Delta   = ImageBase - PreferredImageBase;
+  size_t ChunkNo = (Slots.size() + ChunkSize - 1) / ChunkSize;
+  std::vector<Database::CrossReferenceVector> ChunkXRefs(ChunkNo);
+  std::vector<PatchOverlay::PatchVector>      ChunkPatches(ChunkNo);
+  ParallelFor(ChunkNo, [&](size_t Begin, size_t End)
+  {
+    for (size_t ChunkIdx = Begin; ChunkIdx < End; ++ChunkIdx)
+    {
+      size_t SlotEnd = std::min(Slots.size(), (ChunkIdx + 1) * ChunkSize);
+      for (size_t SlotIdx = ChunkIdx * ChunkSize; SlotIdx < SlotEnd; ++SlotIdx)
       {
-        Log::Write("ldr_pe") << "unable to convert export name address to offset" << LogEnd;
-        continue;
+        auto const& rSlot = Slots[SlotIdx];
+        TOffset SlotOff;
+        if (!_ConvertRvaToOffset(rSlot.first, rSlot.second, SlotOff))
+          continue;
+
+        u64 Target;
+        if (rSlot.second == sizeof(u64))
+        {
+          if (!rBinStrm.Read(SlotOff, Target))
+            continue;
+        }
+        else
+        {
+          u32 Target32;
+          if (!rBinStrm.Read(SlotOff, Target32))
+            continue;
+          Target = Target32;
+        }
+
+        if (Delta != 0x0)
+        {
+          Target += Delta;
+          if (rSlot.second == sizeof(u32))
+            Target &= 0xffffffff;
+
+          PatchOverlay::Patch SlotPatch;
+          SlotPatch.m_Offset = rBinStrm.GetOverlayOffset() + SlotOff;
+          for (u8 i = 0; i < rSlot.second; ++i)
+            SlotPatch.m_Data.push_back(static_cast<u8>(Target >> (i * 8)));
+          ChunkPatches[ChunkIdx].push_back(SlotPatch);
+        }
+
+        if (Target < ImageBase || Target >= ImageBase + SizeOfImage)
+          continue;
+
+        ChunkXRefs[ChunkIdx].push_back(std::make_pair(
+          Address(Address::FlatType, 0x0, Target, 0x10, bit),
+          Address(Address::FlatType, 0x0, ImageBase + rSlot.first, 0x10, bit)));
+      }
+    }
+  });
+
+  Database::CrossReferenceVector XRefs;
+  PatchOverlay::PatchVector      Patches;
+  for (auto& rChunk : ChunkXRefs)
+    XRefs.insert(std::end(XRefs), std::begin(rChunk), std::end(rChunk));
+  for (auto& rChunk : ChunkPatches)
+    Patches.insert(std::end(Patches), std::begin(rChunk), std::end(rChunk));
+  rDoc.AddCrossReferences(XRefs);
+
+  // Slots are written once they're all read, so a slot is never moved twice
+  if (!Patches.empty() && !rBinStrm.GetOverlay()->ApplyPatches(Patches))
+    Log::Write("ldr_pe") << "unable to apply base relocations" << LogEnd;
+
+  Log::Write("ldr_pe")
+    << "base relocations: " << Slots.size() << " slots, " << Patches.size() << " rebased, " << XRefs.size() << " references, " << UnsupportedNo << " unsupported in "
+    << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count() << "ms"
+    << LogEnd;
+}
+
+template<int bit> void PeLoader::_MapRuntimeFunctions(Document& rDoc, u64 ImageBase, u64 ExceptionDirectoryRva, u32 ExceptionDirectorySize)
+{
+  auto const& rBinStrm  = rDoc.GetBinaryStream();
+  auto        StartTime = std::chrono::steady_clock::now();
+
+  TOffset ExcpOff;
+  if (!_ConvertRvaToOffset(ExceptionDirectoryRva, ExceptionDirectorySize, ExcpOff))
+  {
+    Log::Write("ldr_pe") << "unable to convert exception directory address to offset" << LogEnd;
+    return;
+  }
+
+  // Only the beginning of functions is kept, chained entries describe a part of another function
+  std::vector<u32> FuncRvas;
+  u64 EntryNo = 0;
+  switch (m_Machine)
+  {
+  case PE_FILE_MACHINE_AMD64:
+    {
+      std::vector<PeRuntimeFunction> RtFuncs;
+      if (!rBinStrm.ReadArray(ExcpOff, ExceptionDirectorySize / sizeof(PeRuntimeFunction), RtFuncs))
+      {
+        Log::Write("ldr_pe") << "unable to read exception directory" << LogEnd;
+        return;
       }
-      if (!rBinStrm.Read(SymNameOff, SymName))
+      EntryNo = RtFuncs.size();
+      FuncRvas.reserve(RtFuncs.size());
+      for (auto& rRtFunc : RtFuncs)
       {
-        Log::Write("ldr_pe") << "unable to read export name" << LogEnd;
-        continue;
+        rRtFunc.Swap(LittleEndian);
+        if (rRtFunc.UnwindInfoAddress & 0x1)
+          continue; // points to the entry of the function
+
+        TOffset UnwindOff;
+        u8 VersionAndFlags;
+        if (!_ConvertRvaToOffset(rRtFunc.UnwindInfoAddress, sizeof(VersionAndFlags), UnwindOff)
+          || !rBinStrm.Read(UnwindOff, VersionAndFlags))
+          continue;
+        if ((VersionAndFlags >> 3) & PE_UNW_FLAG_CHAININFO)
+          continue;
+        FuncRvas.push_back(rRtFunc.BeginAddress);
       }
     }
-    else
-      SymName = (boost::format("ord_%d") % (Ord + ExpDir.Base)).str();
+    break;
 
-    Address SymAddr(Address::FlatType, 0x0, ImageBase + FuncRva, 0x10, bit);
-    rDoc.AddLabel(
-      SymAddr,
-       // We assume we only export function which is definitely false,
-       // but improve the analysis (false positive should be negligible)
-      Label(SymName, Label::Exported | Label::Function));
-    rDoc.BindDetailId(SymAddr, 0, Sha1(SymName));
-
-    Log::Write("ldr_pe") << "found export name: \"" << SymName << "\", ordinal: " << Ord << LogEnd;
+  case PE_FILE_MACHINE_ARM:
+    {
+      std::vector<PeArmRuntimeFunction> RtFuncs;
+      if (!rBinStrm.ReadArray(ExcpOff, ExceptionDirectorySize / sizeof(PeArmRuntimeFunction), RtFuncs))
+      {
+        Log::Write("ldr_pe") << "unable to read exception directory" << LogEnd;
+        return;
+      }
+      EntryNo = RtFuncs.size();
+      FuncRvas.reserve(RtFuncs.size());
+      for (auto& rRtFunc : RtFuncs)
+      {
+        rRtFunc.Swap(LittleEndian);
+        FuncRvas.push_back(rRtFunc.BeginAddress & ~0x1U); // thumb bit
+      }
+    }
+    break;
+
+  default:
+    Log::Write("ldr_pe") << "exception directory is not supported for this machine" << LogEnd;
+    return;
+  }
+
+  // Named labels are kept, functions are only known to start here
+  Database::LabelVector Labels;
+  Labels.reserve(FuncRvas.size());
+  for (auto FuncRva : FuncRvas)
+  {
+    Address FuncAddr(Address::FlatType, 0x0, ImageBase + FuncRva, 0x10, bit);
+    Labels.push_back(std::make_pair(FuncAddr, Label(FuncAddr, Label::Function)));
   }
+  rDoc.AddLabels(Labels, false);
+
+  Log::Write("ldr_pe")
+    << "runtime functions: " << EntryNo << " entries, " << Labels.size() << " functions in "
+    << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count() << "ms"
+    << LogEnd;
 }
@@ -4,9 +4,13 @@
 #include <medusa/document.hpp>
 #include <medusa/loader.hpp>
 #include <medusa/log.hpp>
+#include <medusa/patch_overlay.hpp>
 
 #include "pe.hpp"
 
+#include <string>
+#include <vector>
+
 #if defined(_WIN32) || defined(WIN32)
 #ifdef ldr_pe_EXPORTS
 #  define LDR_PE_EXPORT __declspec(dllexport)
@@ -34,15 +38,41 @@ private:
   u16 m_Machine;
   u16 m_Magic;
 
+  //! Section headers are kept swapped, so RVA can be converted without querying the document.
+  std::vector<PeSectionHeader> m_Sections;
+  u32                          m_SizeOfHeaders;
+
   bool _FindArchitectureTagAndModeByMachine(
       Architecture::VSPType const& rArchs,
       Tag& rArchTag, u8& rArchMode
       ) const;
 
+  //! This method converts a RVA to a file offset if Size bytes are stored in the file.
+  bool _ConvertRvaToOffset(u64 Rva, u64 Size, TOffset& rOffset) const;
+  bool _ReadString(BinaryStream const& rBinStrm, u64 Rva, std::string& rString) const;
+
+  //! This method reads structures until one is filled with zeroes, the terminator is not returned.
+  template<typename T> bool _ReadNullTerminatedArray(BinaryStream const& rBinStrm, TOffset Offset, std::vector<T>& rValues) const;
+
+  /*! This method labels the import address table slots of a module.
+   * \param ThunkBias is subtracted from the name table entries, it's only set for old delay-load descriptors which contain VA.
+   */
+  template<int bit> bool _ReadImportedSymbols(
+      BinaryStream const& rBinStrm, std::string const& rModuleName,
+      u64 ImageBase, u64 NameTableRva, u64 AddressTableRva, u64 ThunkBias,
+      Database::LabelVector& rLabels) const;
+
   template<int bit> void _Map(Document& rDoc, Architecture::VSPType const& rArchs);
-  template<int bit> void _MapSections(Document& rDoc, Architecture::VSPType const& rArchs, u64 ImageBase, u64 SectionHeadersOffset, u16 NumberOfSection);
-  template<int bit> void _ResolveImports(Document& rDoc, u64 ImageBase, u64 ImportDirectoryRva, u64 ImportAddressTableRva);
-  template<int bit> void _ResolveExports(Document& rDoc, u64 ImageBase, u64 ExportDirectoryRva);
+  template<int bit> void _MapSections(Document& rDoc, Architecture::VSPType const& rArchs, u64 ImageBase);
+  template<int bit> void _ResolveImports(Document& rDoc, u64 ImageBase, u64 ImportDirectoryRva);
+  template<int bit> void _ResolveDelayImports(Document& rDoc, u64 ImageBase, u64 DelayImportDirectoryRva);
+  template<int bit> void _ResolveExports(Document& rDoc, u64 ImageBase, u64 ExportDirectoryRva, u32 ExportDirectorySize);
+  //! This method moves pointers of the image by ImageBase - PreferredImageBase, and references them.
+  template<int bit> void _ResolveBaseRelocations(Document& rDoc, u64 PreferredImageBase, u64 ImageBase, u32 SizeOfImage, u64 BaseRelocationRva, u32 BaseRelocationSize);
+  template<int bit> void _MapRuntimeFunctions(Document& rDoc, u64 ImageBase, u64 ExceptionDirectoryRva, u32 ExceptionDirectorySize);
+
+  //! This method labels import address table slots, they're pointers to imported functions.
+  void _AddImportLabels(Document& rDoc, Database::LabelVector const& rLabels);
 };
 
 extern "C" LDR_PE_EXPORT Loader* GetLoader(void);
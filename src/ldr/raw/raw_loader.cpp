@@ -1,5 +1,18 @@
 #include "raw_loader.hpp"
 
+#include <medusa/stream_analyzer.hpp>
+#include <medusa/log.hpp>
+
+#include <boost/format.hpp>
+
+RawLoader::RawLoader(void)
+{
+  // Large images (e.g. flash dumps) can be analyzed by windows, so the memory doesn't depend on their size
+  m_CfgMdl.InsertBoolean("Streaming", false);
+  m_CfgMdl.InsertUint64("Memory budget", StreamAnalyzer::DefaultMemoryBudget);
+  m_CfgMdl.InsertUint32("Window overlap", StreamAnalyzer::DefaultOverlap);
+}
+
 std::string RawLoader::GetName(void) const
 {
   return "Raw file";
@@ -12,12 +25,24 @@ bool RawLoader::IsCompatible(BinaryStream const& rBinStrm)
 
 void RawLoader::Map(Document& rDoc, Architecture::VSPType const& rArchs)
 {
-  rDoc.AddMemoryArea(new MappedMemoryArea(
-    "raw",
-    0x0, rDoc.GetBinaryStream().GetSize(),
-    Address(Address::FlatType, 0x0), rDoc.GetBinaryStream().GetSize(),
-    MemoryArea::Execute | MemoryArea::Read | MemoryArea::Write
-    ));
+  // Memory areas are limited to 4 GB, so larger images are mapped as consecutive areas
+  static u64 const MaxAreaSize = 0xfffff000;
+
+  u64 const RawSize = rDoc.GetBinaryStream().GetSize();
+  u32 AreaIdx = 0;
+  for (TOffset AreaOff = 0; AreaOff < RawSize; AreaOff += MaxAreaSize, ++AreaIdx)
+  {
+    u32 AreaSize = static_cast<u32>(std::min<u64>(RawSize - AreaOff, MaxAreaSize));
+    rDoc.AddMemoryArea(new MappedMemoryArea(
+      AreaIdx == 0 ? "raw" : (boost::format("raw_%d") % AreaIdx).str(),
+      AreaOff, AreaSize,
+      Address(Address::FlatType, AreaOff), AreaSize,
+      MemoryArea::Execute | MemoryArea::Read | MemoryArea::Write
+      ));
+  }
+
+  if (AreaIdx > 1)
+    Log::Write("ldr_raw") << "image mapped as " << AreaIdx << " memory areas" << LogEnd;
 }
 
 void RawLoader::FilterAndConfigureArchitectures(Architecture::VSPType& rArchs) const
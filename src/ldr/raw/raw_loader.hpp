@@ -19,6 +19,7 @@ MEDUSA_NAMESPACE_USE
 class RawLoader : public Loader
 {
 public:
+  RawLoader(void);
   virtual ~RawLoader(void) {}
 
   virtual std::string GetName(void) const;
@@ -3,8 +3,148 @@
 
 #include <medusa/medusa.hpp>
 #include <medusa/detail.hpp>
+#include <medusa/signature.hpp>
+#include <medusa/fingerprint.hpp>
+#include <medusa/binary_diff.hpp>
+#include <medusa/function_graph.hpp>
+#include <medusa/jump_table.hpp>
+#include <medusa/line_cache.hpp>
+#include <medusa/line_index.hpp>
+#include <medusa/listing_exporter.hpp>
+#include <medusa/overview.hpp>
+#include <medusa/disassembly_view.hpp>
+#include <medusa/label_list.hpp>
+#include <medusa/change_journal.hpp>
+#include <medusa/module.hpp>
+#include <medusa/batch.hpp>
+#include <medusa/stream_analyzer.hpp>
+#include <medusa/task.hpp>
+#include <medusa/control_flow_graph.hpp>
+#include <medusa/graph_layout.hpp>
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <tuple>
+#include <algorithm>
+
+#include <boost/filesystem/operations.hpp>
+
+namespace
+{
+  // Tests which need disassembled code use the text database and the x86 architecture, both modules
+  // are built next to the test executable
+  medusa::Path GetModulePath(void)
+  {
+    auto const& rMstSuite = boost::unit_test::framework::master_test_suite();
+    if (rMstSuite.argc == 0)
+      return ".";
+    auto ExeDir = medusa::Path(rMstSuite.argv[0]).parent_path();
+    return ExeDir.empty() ? medusa::Path(".") : ExeDir;
+  }
+
+  //! CodeLoader maps the whole stream as code and exports its first byte.
+  class CodeLoader : public medusa::Loader
+  {
+  public:
+    CodeLoader(medusa::Address const& rBaseAddr, medusa::Tag ArchTag, medusa::u8 ArchMode)
+      : m_BaseAddr(rBaseAddr), m_ArchTag(ArchTag), m_ArchMode(ArchMode) {}
+
+    virtual std::string GetName(void) const { return "code"; }
+    virtual medusa::u8  GetDepth(void) const { return 0; }
+    virtual bool        IsCompatible(medusa::BinaryStream const& rBinStrm) { return true; }
+    virtual void        FilterAndConfigureArchitectures(medusa::Architecture::VSPType& rArchs) const {}
+
+    virtual void Map(medusa::Document& rDoc, medusa::Architecture::VSPType const& rArchs)
+    {
+      auto Size = static_cast<medusa::u32>(rDoc.GetBinaryStream().GetSize());
+      rDoc.AddMemoryArea(new medusa::MappedMemoryArea(
+        "code", 0x0, Size, m_BaseAddr, Size,
+        medusa::MemoryArea::Read | medusa::MemoryArea::Execute,
+        m_ArchTag, m_ArchMode));
+      rDoc.AddLabel(m_BaseAddr, medusa::Label("start", medusa::Label::Code | medusa::Label::Exported));
+    }
+
+  private:
+    medusa::Address m_BaseAddr;
+    medusa::Tag     m_ArchTag;
+    medusa::u8      m_ArchMode;
+  };
+
+  //! CodeDocument analyzes 32-bit x86 code from a buffer, the database is removed when it's destroyed.
+  struct CodeDocument
+  {
+    ~CodeDocument(void)
+    {
+      m_Core.WaitForTasks();
+      m_Core.CloseDocument();
+      if (!m_DbPath.empty())
+        boost::filesystem::remove(m_DbPath);
+    }
+
+    bool Open(std::vector<medusa::u8> const& rCode, medusa::Address const& rBaseAddr = medusa::Address(0x1000))
+    {
+      using namespace medusa;
+
+      auto& rModMgr = ModuleManager::Instance();
+      auto pGetDb   = rModMgr.LoadModule<TGetDatabase>(GetModulePath(), "text");
+      auto pGetArch = rModMgr.LoadModule<TGetArchitecture>(GetModulePath(), "x86");
+      if (pGetDb == nullptr || pGetArch == nullptr)
+        return false;
+
+      Database::SPType spDb(pGetDb());
+      Architecture::SPType spArch(pGetArch());
+      m_spBinStrm = std::make_shared<MemoryBinaryStream>(rCode.data(), rCode.size());
+      m_DbPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+      if (!spDb->Create(m_DbPath, true))
+        return false;
+
+      // Registering the architecture updates its tag, so it's done before the loader uses it
+      if (!rModMgr.RegisterArchitecture(spArch))
+        return false;
+      auto spLdr = std::make_shared<CodeLoader>(rBaseAddr, spArch->GetTag(), spArch->GetModeByName("32-bit"));
+      if (!m_Core.Start(m_spBinStrm, spDb, spLdr, Architecture::VSPType(1, spArch), OperatingSystem::SPType()))
+        return false;
+      m_Core.WaitForTasks();
+      return true;
+    }
+
+    medusa::Document& GetDocument(void) { return m_Core.GetDocument(); }
+
+    medusa::Medusa               m_Core;
+    medusa::BinaryStream::SPType m_spBinStrm;
+    medusa::Path                 m_DbPath;
+  };
+
+  // Three functions at 0x1000: start calls 0x1010 (a conditional branch) and 0x1020 (a single block)
+  std::vector<medusa::u8> MakeThreeFunctions(void)
+  {
+    medusa::u8 const Code[] =
+    {
+      0x55,                         // 1000: push ebp
+      0x89, 0xe5,                   // 1001: mov ebp, esp
+      0xe8, 0x08, 0x00, 0x00, 0x00, // 1003: call 0x1010
+      0xe8, 0x13, 0x00, 0x00, 0x00, // 1008: call 0x1020
+      0x5d,                         // 100d: pop ebp
+      0xc3,                         // 100e: ret
+      0x90,
+      0x31, 0xc0,                   // 1010: xor eax, eax
+      0x83, 0xf9, 0x01,             // 1012: cmp ecx, 1
+      0x74, 0x03,                   // 1015: je 0x101a
+      0x40,                         // 1017: inc eax
+      0x40,                         // 1018: inc eax
+      0x40,                         // 1019: inc eax
+      0xc3,                         // 101a: ret
+      0x90, 0x90, 0x90, 0x90, 0x90,
+      0x8b, 0x44, 0x24, 0x04,       // 1020: mov eax, [esp + 4]
+      0x01, 0xc0,                   // 1024: add eax, eax
+      0xc3,                         // 1026: ret
+    };
+    return std::vector<medusa::u8>(std::begin(Code), std::end(Code));
+  }
+}
 
 BOOST_AUTO_TEST_SUITE(core_test_suite)
 
@@ -146,4 +286,1683 @@ BOOST_AUTO_TEST_CASE(core_structure_test_case)
   BOOST_CHECK(Core.NewDocument(std::make_shared<medusa::MemoryBinaryStream>(WinExeHdr, sizeof(WinExeHdr))) == true);
 }
 
+BOOST_AUTO_TEST_CASE(core_signature_test_case)
+{
+  BOOST_MESSAGE("Testing signature");
+
+  using namespace medusa;
+
+  // push ebp; mov ebp, esp; sub esp, imm8; mov eax, [ebp+disp8]; call rel32
+  static u8 const FuncBuf[] = { 0x55, 0x89, 0xe5, 0x83, 0xec, 0x18, 0x8b, 0x45, 0x08, 0xe8, 0x11, 0x22, 0x33, 0x44, 0xc9, 0xc3 };
+  static bool const Wildcard[] = { 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 1, 1, 1, 1, 0, 0 };
+
+  Signature Sig("known_func");
+  for (size_t i = 0; i < sizeof(FuncBuf); ++i)
+    Sig.AddByte(FuncBuf[i], Wildcard[i]);
+
+  u8 RelocFuncBuf[sizeof(FuncBuf)];
+  memcpy(RelocFuncBuf, FuncBuf, sizeof(FuncBuf));
+  RelocFuncBuf[10] = 0xaa; // relocated call
+  RelocFuncBuf[5]  = 0x28; // different stack frame size
+
+  BOOST_CHECK(Sig.Match(FuncBuf, sizeof(FuncBuf)));
+  BOOST_CHECK(Sig.Match(RelocFuncBuf, sizeof(RelocFuncBuf)));
+
+  SignatureDatabase SigDb;
+  BOOST_REQUIRE(SigDb.Add(Sig));
+
+  std::string Name;
+  BOOST_CHECK(SigDb.Match(RelocFuncBuf, sizeof(RelocFuncBuf), Name));
+  BOOST_CHECK(Name == "known_func");
+
+  RelocFuncBuf[0] = 0x90;
+  BOOST_CHECK(!SigDb.Match(RelocFuncBuf, sizeof(RelocFuncBuf), Name));
+
+  // Same pattern with another name must not match anymore
+  Signature DupSig("other_func");
+  for (size_t i = 0; i < sizeof(FuncBuf); ++i)
+    DupSig.AddByte(FuncBuf[i], Wildcard[i]);
+  SignatureDatabase AmbSigDb;
+  AmbSigDb.Add(Sig);
+  AmbSigDb.Add(DupSig);
+  BOOST_CHECK(!AmbSigDb.Match(FuncBuf, sizeof(FuncBuf), Name));
+
+  // Generate 10k random signatures, each one must be matched back to its own name
+  std::mt19937 Rng(0x1337);
+  std::vector<std::vector<u8>> Funcs;
+  for (u32 i = 0; i < 10000; ++i)
+  {
+    std::vector<u8> CurFunc(Signature::DefaultLength);
+    Signature CurSig("func_" + std::to_string(i));
+    for (auto& rByte : CurFunc)
+    {
+      rByte = static_cast<u8>(Rng());
+      CurSig.AddByte(rByte, (Rng() % 8) == 0);
+    }
+    SigDb.Add(CurSig);
+    Funcs.push_back(CurFunc);
+  }
+
+  auto SigPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  BOOST_REQUIRE(SigDb.Save(SigPath));
+  SignatureDatabase LoadedSigDb;
+  BOOST_REQUIRE(LoadedSigDb.Load(SigPath));
+  boost::filesystem::remove(SigPath);
+  BOOST_CHECK(LoadedSigDb.GetNumberOfSignatures() == SigDb.GetNumberOfSignatures());
+  BOOST_CHECK(LoadedSigDb.GetNumberOfNodes() == SigDb.GetNumberOfNodes());
+
+  u32 MatchCnt = 0;
+  for (u32 i = 0; i < Funcs.size(); ++i)
+    if (LoadedSigDb.Match(Funcs[i].data(), static_cast<u32>(Funcs[i].size()), Name) && Name == "func_" + std::to_string(i))
+      ++MatchCnt;
+  BOOST_CHECK(MatchCnt == Funcs.size());
+
+  // A function too short to reach a leaf must not be named
+  BOOST_CHECK(!LoadedSigDb.Match(Funcs[0].data(), 4, Name));
+}
+
+BOOST_AUTO_TEST_CASE(core_fingerprint_test_case)
+{
+  BOOST_MESSAGE("Testing fingerprint");
+
+  using namespace medusa;
+
+  FunctionFingerprint Fp;
+  BOOST_CHECK(!Fp.IsValid());
+  BOOST_CHECK(!Fp.Parse("bad(0x0)"));
+
+  // hashes, content hash, blocks, edges, instructions, callers, histogram, callees
+  std::string const FpDump = "fp(0x1122334455667788 0x99aabbccddeeff00 0x40 0x4 0x5 0x10 0x2 0x3 0x2 0x1 0x2 0x1 0x5 0x2 0x2 "
+    + Address(0x401000).Dump() + " " + Address(0x402000).Dump() + ")";
+  BOOST_REQUIRE(Fp.Parse(FpDump));
+  BOOST_CHECK(Fp.IsValid());
+  BOOST_CHECK(Fp.GetNumberOfBasicBlocks() == 4);
+  BOOST_CHECK(Fp.GetNumberOfInstructions() == 0x10);
+  BOOST_CHECK(Fp.GetInstructionClass(FunctionFingerprint::CallClass) == 2);
+  BOOST_REQUIRE(Fp.GetCallees().size() == 2);
+  BOOST_CHECK(Fp.GetCallees()[1] == Address(0x402000));
+
+  FunctionFingerprint ParsedFp;
+  BOOST_REQUIRE(ParsedFp.Parse(Fp.Dump()));
+  BOOST_CHECK(ParsedFp.Dump() == Fp.Dump());
+  BOOST_CHECK(ParsedFp.Similarity(Fp) == 1.0);
+
+  // Same shape with different instructions must still be similar
+  FunctionFingerprint ModFp;
+  BOOST_REQUIRE(ModFp.Parse("fp(0x1 0x99aabbccddeeff00 0x40 0x4 0x5 0x11 0x2 0x3 0x2 0x1 0x2 0x1 0x6 0x2 0x0)"));
+  BOOST_CHECK(ModFp.Similarity(Fp) > 0.8 && ModFp.Similarity(Fp) < 1.0);
+
+  // Unrelated function
+  FunctionFingerprint OtherFp;
+  BOOST_REQUIRE(OtherFp.Parse("fp(0x2 0x3 0x200 0x20 0x30 0x100 0x0 0x80 0x0 0x0 0x0 0x1 0x40 0x0 0x0)"));
+  BOOST_CHECK(OtherFp.Similarity(Fp) < 0.5);
+}
+
+BOOST_AUTO_TEST_CASE(core_binary_diff_test_case)
+{
+  BOOST_MESSAGE("Testing binary diff");
+
+  using namespace medusa;
+
+  // The new version only differs by the body of the function at 0x1010
+  auto OldCode = MakeThreeFunctions();
+  auto NewCode = OldCode;
+  NewCode[0x17] = NewCode[0x18] = NewCode[0x19] = 0x48; // dec eax
+
+  CodeDocument OldDoc, NewDoc;
+  BOOST_REQUIRE(OldDoc.Open(OldCode));
+  BOOST_REQUIRE(NewDoc.Open(NewCode));
+
+  BinaryDiff Diff(OldDoc.GetDocument(), NewDoc.GetDocument());
+  BOOST_REQUIRE(Diff.Compute());
+  BOOST_CHECK(Diff.GetUnmatchedOldFunctions().empty());
+  BOOST_CHECK(Diff.GetUnmatchedNewFunctions().empty());
+
+  std::map<Address, BinaryDiff::Match> Matches;
+  for (auto const& rMatch : Diff.GetMatches())
+    Matches[rMatch.m_OldAddress] = rMatch;
+  BOOST_REQUIRE(Matches.size() == 3);
+  BOOST_CHECK(Matches[Address(0x1000)].m_Type == BinaryDiff::ExactMatch);
+  BOOST_CHECK(Matches[Address(0x1020)].m_Type == BinaryDiff::ExactMatch);
+  BOOST_CHECK(Matches[Address(0x1010)].m_NewAddress == Address(0x1010));
+  BOOST_CHECK(Matches[Address(0x1010)].m_Type != BinaryDiff::ExactMatch);
+
+  // Fingerprints are kept, but a patch which keeps the size of the function must invalidate them
+  auto& rOldDoc = OldDoc.GetDocument();
+  FunctionFingerprint Fp;
+  BOOST_REQUIRE(rOldDoc.GetFunctionFingerprint(Address(0x1010), Fp));
+  BOOST_CHECK(Fp.IsUpToDate(rOldDoc, Address(0x1010)));
+  BOOST_REQUIRE(OldDoc.m_spBinStrm->Write(0x14, static_cast<u8>(0x02))); // cmp ecx, 2
+  BOOST_CHECK(!Fp.IsUpToDate(rOldDoc, Address(0x1010)));
+  BOOST_REQUIRE(rOldDoc.GetFunctionFingerprint(Address(0x1020), Fp));
+  BOOST_CHECK(Fp.IsUpToDate(rOldDoc, Address(0x1020)));
+}
+
+BOOST_AUTO_TEST_CASE(core_function_graph_test_case)
+{
+  BOOST_MESSAGE("Testing function graph");
+
+  using namespace medusa;
+
+  FunctionGraph FuncGraph;
+  BOOST_CHECK(!FuncGraph.IsValid());
+  BOOST_CHECK(!FuncGraph.Parse("fg(0x1 0x2 0x3 0x0 0x1 " + Address(0x1000).Dump() + " 0x1 0x2 0x1 0x0 0x1 0x1)"));
+
+  // Generate a function made of 5k basic blocks: each one contains 3 instructions and ends with a conditional jump
+  u32 const BscBlkNo = 5000;
+  std::ostringstream oss;
+  oss << std::hex << std::showbase;
+  oss << "fg(" << FunctionGraph::HasReturnFlag << " " << BscBlkNo * 6 << " " << BscBlkNo * 3 << " " << 0x1234 << " " << BscBlkNo;
+  for (u32 i = 0; i < BscBlkNo; ++i)
+    oss << " " << Address(0x400000 + i * 6).Dump() << " 0x3 0x2 0x2 0x2";
+  oss << " " << (BscBlkNo - 1) * 2;
+  for (u32 i = 0; i + 1 < BscBlkNo; ++i)
+    oss << " " << i << " " << i + 1 << " " << BasicBlockEdgeProperties::False
+        << " " << i << " " << (i * 7) % BscBlkNo << " " << BasicBlockEdgeProperties::True;
+  oss << ")";
+
+  BOOST_REQUIRE(FuncGraph.Parse(oss.str()));
+  BOOST_CHECK(FuncGraph.HasReturn());
+  BOOST_CHECK(FuncGraph.GetContentHash() == 0x1234);
+  BOOST_CHECK(FuncGraph.GetBasicBlocks().size() == BscBlkNo);
+  BOOST_CHECK(FuncGraph.GetEdges().size() == (BscBlkNo - 1) * 2);
+
+  auto BscBlkAddrs = FuncGraph.GetBasicBlockAddresses(1);
+  BOOST_REQUIRE(BscBlkAddrs.size() == 3);
+  BOOST_CHECK(BscBlkAddrs.back() == Address(0x40000a));
+
+  FunctionGraph ParsedFuncGraph;
+  BOOST_REQUIRE(ParsedFuncGraph.Parse(FuncGraph.Dump()));
+  BOOST_CHECK(ParsedFuncGraph.Dump() == FuncGraph.Dump());
+
+  // Building the control flow graph from stored basic blocks must not walk the function again
+  Document Doc;
+  ControlFlowGraph Cfg(Doc);
+  Analyzer Anlz;
+  BOOST_CHECK(Anlz.BuildControlFlowGraph(Doc, FuncGraph, Cfg));
+  BOOST_CHECK(boost::num_vertices(Cfg.GetGraph()) == BscBlkNo);
+  BOOST_CHECK(boost::num_edges(Cfg.GetGraph()) == (BscBlkNo - 1) * 2);
+
+  // The graph of a disassembled function is kept until its bytes are patched
+  CodeDocument CodeDoc;
+  BOOST_REQUIRE(CodeDoc.Open(MakeThreeFunctions()));
+  auto& rCodeDoc = CodeDoc.GetDocument();
+  FunctionGraph CodeFuncGraph;
+  BOOST_REQUIRE(rCodeDoc.GetFunctionGraph(Address(0x1010), CodeFuncGraph));
+  BOOST_CHECK(CodeFuncGraph.HasReturn());
+  BOOST_CHECK(CodeFuncGraph.GetLength() == 0xb);
+  BOOST_CHECK(CodeFuncGraph.GetBasicBlocks().size() == 3);
+  BOOST_CHECK(CodeFuncGraph.GetEdges().size() == 3);
+  BOOST_CHECK(CodeFuncGraph.IsUpToDate(rCodeDoc, Address(0x1010)));
+
+  ControlFlowGraph CodeCfg(rCodeDoc);
+  BOOST_CHECK(Anlz.BuildControlFlowGraph(rCodeDoc, Address(0x1010), CodeCfg));
+  BOOST_CHECK(boost::num_vertices(CodeCfg.GetGraph()) == 3);
+
+  auto ContentHash = CodeFuncGraph.GetContentHash();
+  BOOST_REQUIRE(CodeDoc.m_spBinStrm->Write(0x14, static_cast<u8>(0x02))); // cmp ecx, 2
+  BOOST_CHECK(!CodeFuncGraph.IsUpToDate(rCodeDoc, Address(0x1010)));
+  FunctionGraph NewFuncGraph;
+  BOOST_REQUIRE(Anlz.GetFunctionGraph(rCodeDoc, Address(0x1010), NewFuncGraph));
+  BOOST_CHECK(NewFuncGraph.GetContentHash() != ContentHash);
+  BOOST_CHECK(NewFuncGraph.GetBasicBlocks().size() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(core_reanalyze_test_case)
+{
+  BOOST_MESSAGE("Testing reanalysis of modified cells");
+
+  using namespace medusa;
+
+  // Nothing leads to the function at 0x1028 yet
+  auto Code = MakeThreeFunctions();
+  u8 const UnusedFunc[] = { 0x90, 0x40, 0x48, 0xc3 }; // 1028: inc eax; dec eax; ret
+  Code.insert(std::end(Code), std::begin(UnusedFunc), std::end(UnusedFunc));
+
+  CodeDocument CodeDoc;
+  BOOST_REQUIRE(CodeDoc.Open(Code));
+  auto& rDoc = CodeDoc.GetDocument();
+
+  // Each basic block belongs to its function, the padding doesn't
+  Address::List FuncAddrs;
+  BOOST_CHECK(rDoc.GetFunctionsContaining(Address(0x1018), FuncAddrs));
+  BOOST_CHECK(rDoc.GetFunctionsContaining(Address(0x101a), FuncAddrs));
+  BOOST_REQUIRE(FuncAddrs.size() == 1);
+  BOOST_CHECK(FuncAddrs.front() == Address(0x1010));
+  FuncAddrs.clear();
+  BOOST_CHECK(!rDoc.GetFunctionsContaining(Address(0x101c), FuncAddrs));
+  BOOST_CHECK(!rDoc.GetFunctionsContaining(Address(0x1028), FuncAddrs));
+  BOOST_CHECK(!rDoc.ContainsCode(Address(0x1028)));
+
+  // The index follows the graph of a function when it's replaced
+  FunctionGraph FuncGraph;
+  BOOST_REQUIRE(rDoc.GetFunctionGraph(Address(0x1010), FuncGraph));
+  BOOST_REQUIRE(rDoc.SetFunctionGraph(Address(0x1010), FunctionGraph()));
+  BOOST_CHECK(!rDoc.GetFunctionsContaining(Address(0x1018), FuncAddrs));
+  BOOST_REQUIRE(rDoc.SetFunctionGraph(Address(0x1010), FuncGraph));
+  BOOST_CHECK(rDoc.GetFunctionsContaining(Address(0x1018), FuncAddrs));
+
+  // The second call of start now leads to 0x1028: its previous reference is dropped and the new code is disassembled
+  FuncAddrs.clear();
+  BOOST_REQUIRE(CodeDoc.m_spBinStrm->Write(0x9, static_cast<u32>(0x1b)));
+  CodeDoc.m_Core.Reanalyze(Address::List(1, Address(0x1008)));
+  CodeDoc.m_Core.WaitForTasks();
+  BOOST_CHECK(rDoc.ContainsCode(Address(0x1029)));
+  BOOST_CHECK(rDoc.ContainsCode(Address(0x102a)));
+  BOOST_CHECK(rDoc.HasCrossReferenceFrom(Address(0x1028)));
+  BOOST_CHECK(!rDoc.HasCrossReferenceFrom(Address(0x1020)));
+  BOOST_CHECK(rDoc.GetFunctionsContaining(Address(0x102a), FuncAddrs));
+  BOOST_CHECK(FuncAddrs.size() == 1 && FuncAddrs.front() == Address(0x1028));
+
+  // A function whose entry point isn't code anymore is dropped
+  FuncAddrs.clear();
+  BOOST_REQUIRE(rDoc.DeleteCell(Address(0x1010)));
+  CodeDoc.m_Core.Reanalyze(Address::List(1, Address(0x1010)));
+  CodeDoc.m_Core.WaitForTasks();
+  BOOST_CHECK(rDoc.GetMultiCell(Address(0x1010)) == nullptr);
+  BOOST_CHECK(!rDoc.GetFunctionsContaining(Address(0x1018), FuncAddrs));
+  BOOST_CHECK(rDoc.GetMultiCell(Address(0x1020)) != nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(core_graph_layout_test_case)
+{
+  BOOST_MESSAGE("Testing graph layout");
+
+  using namespace medusa;
+
+  // Generate 500 loops: each one contains an if/else and is followed by a linear chain
+  u32 const LoopNo = 500, LoopSize = 8;
+  std::mt19937 Rng(1337);
+  std::uniform_int_distribution<u32> SizeDist(20, 300);
+  GraphLayout Layout;
+  for (u32 i = 0; i < LoopNo * LoopSize; ++i)
+    Layout.AddNode(SizeDist(Rng), SizeDist(Rng));
+  for (u32 i = 0; i < LoopNo; ++i)
+  {
+    u32 Base = i * LoopSize;
+    u32 Edges[][2] =
+    {
+      { 0, 1 }, { 1, 2 }, { 1, 3 }, { 2, 4 }, { 3, 4 }, { 4, 1 }, { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 8 }
+    };
+    for (auto const& rEdge : Edges)
+      if (Base + rEdge[1] < LoopNo * LoopSize)
+        BOOST_REQUIRE(Layout.AddEdge(Base + rEdge[0], Base + rEdge[1]));
+  }
+  BOOST_CHECK(!Layout.AddEdge(0, LoopNo * LoopSize));
+
+  // A cancelled layout is never computed
+  CancellationToken Token;
+  Token.Cancel();
+  BOOST_CHECK(!Layout.Compute(&Token));
+  BOOST_CHECK(!Layout.IsComputed());
+
+  BOOST_REQUIRE(Layout.Compute());
+  BOOST_CHECK(Layout.IsComputed());
+  BOOST_REQUIRE(Layout.GetNumberOfNodes() == LoopNo * LoopSize);
+
+  struct Rect { s32 m_Left, m_Top, m_Right, m_Bottom; };
+  std::vector<Rect> Rects;
+  for (u32 i = 0; i < Layout.GetNumberOfNodes(); ++i)
+  {
+    auto const& rPos = Layout.GetNodePosition(i);
+    Rect CurRect;
+    CurRect.m_Left   = rPos.m_X - static_cast<s32>(Layout.GetNodeWidth(i)  / 2);
+    CurRect.m_Top    = rPos.m_Y - static_cast<s32>(Layout.GetNodeHeight(i) / 2);
+    CurRect.m_Right  = CurRect.m_Left + static_cast<s32>(Layout.GetNodeWidth(i));
+    CurRect.m_Bottom = CurRect.m_Top  + static_cast<s32>(Layout.GetNodeHeight(i));
+    Rects.push_back(CurRect);
+  }
+
+  // Nodes stay inside the layout, they don't overlap and the entry is on top
+  bool IsInside = true, IsOverlapping = false;
+  for (u32 i = 0; i < Rects.size(); ++i)
+  {
+    auto const& rCur = Rects[i];
+    if (rCur.m_Left < 0 || rCur.m_Top < 0 || rCur.m_Right > static_cast<s32>(Layout.GetWidth()) || rCur.m_Bottom > static_cast<s32>(Layout.GetHeight()))
+      IsInside = false;
+    for (u32 j = i + 1; j < Rects.size(); ++j)
+    {
+      auto const& rOth = Rects[j];
+      if (rCur.m_Left < rOth.m_Right && rOth.m_Left < rCur.m_Right && rCur.m_Top < rOth.m_Bottom && rOth.m_Top < rCur.m_Bottom)
+        IsOverlapping = true;
+    }
+  }
+  BOOST_CHECK(IsInside);
+  BOOST_CHECK(!IsOverlapping);
+  BOOST_CHECK(Rects[0].m_Top == 0);
+
+  // Edges which don't close a loop go down, a loop is closed by bends on its left
+  u32 BackEdgeNo = 0;
+  bool IsGoingDown = true;
+  for (u32 i = 0; i < Layout.GetNumberOfEdges(); ++i)
+  {
+    u32 Src = Layout.GetEdgeSource(i), Dst = Layout.GetEdgeDestination(i);
+    if ((Dst % LoopSize) == 1 && (Src % LoopSize) == 4)
+    {
+      ++BackEdgeNo;
+      BOOST_CHECK(Layout.GetEdgeBends(i).size() == 3);
+      continue;
+    }
+    if (Rects[Dst].m_Top <= Rects[Src].m_Bottom)
+      IsGoingDown = false;
+  }
+  BOOST_CHECK(IsGoingDown);
+  BOOST_CHECK(BackEdgeNo == LoopNo);
+
+  GraphLayout ParsedLayout;
+  BOOST_CHECK(!ParsedLayout.Parse("gl(0x10 0x10 0x1 0x8 0x8 0x8)"));
+  BOOST_REQUIRE(ParsedLayout.Parse(Layout.Dump()));
+  BOOST_CHECK(ParsedLayout.IsComputed());
+  BOOST_CHECK(ParsedLayout.GetSignature() == Layout.GetSignature());
+  BOOST_CHECK(ParsedLayout.Dump() == Layout.Dump());
+
+  // The signature tells when a cached layout doesn't match the graph anymore
+  ParsedLayout.AddNode(10, 10);
+  BOOST_CHECK(ParsedLayout.GetSignature() != Layout.GetSignature());
+  BOOST_CHECK(!ParsedLayout.IsComputed());
+}
+
+BOOST_AUTO_TEST_CASE(core_jump_table_test_case)
+{
+  BOOST_MESSAGE("Testing jump table candidates");
+
+  using namespace medusa;
+
+  // Instruction is noncopyable, so each case is checked in place
+  auto IsCandidate = [](u8 SubType, u64 OprdType)
+  {
+    Instruction Insn;
+    Insn.SubType() = SubType;
+    Insn.Operand(0)->SetType(OprdType);
+    return JumpTable::IsCandidate(Insn);
+  };
+
+  // jmp [table + index * 4]
+  BOOST_CHECK(IsCandidate(Instruction::JumpType, O_MEM32 | O_DISP32 | O_SREG | O_SCALE4));
+  // jmp reg
+  BOOST_CHECK(IsCandidate(Instruction::JumpType, O_REG32));
+  // jmp [imported_function]
+  BOOST_CHECK(!IsCandidate(Instruction::JumpType, O_MEM32 | O_DISP32));
+  // jcc rel, call [table + index * 4]
+  BOOST_CHECK(!IsCandidate(Instruction::JumpType | Instruction::ConditionalType, O_REL32));
+  BOOST_CHECK(!IsCandidate(Instruction::CallType, O_MEM32 | O_DISP32 | O_SREG | O_SCALE4));
+
+  // start calls a switch with a bounds check at 0x1010 and one without at 0x1040, whose table ends the code
+  u8 const Code[] =
+  {
+    0xe8, 0x0b, 0x00, 0x00, 0x00,             // 1000: call 0x1010
+    0xe8, 0x36, 0x00, 0x00, 0x00,             // 1005: call 0x1040
+    0xc3,                                     // 100a: ret
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0x8b, 0x44, 0x24, 0x04,                   // 1010: mov eax, [esp + 4]
+    0x83, 0xf8, 0x02,                         // 1014: cmp eax, 2
+    0x77, 0x0e,                               // 1017: ja 0x1027
+    0xff, 0x24, 0x85, 0x30, 0x10, 0x00, 0x00, // 1019: jmp [eax * 4 + 0x1030]
+    0x40, 0xc3,                               // 1020: inc eax; ret
+    0x48, 0xc3,                               // 1022: dec eax; ret
+    0x90, 0x90, 0xc3,                         // 1024: nop; nop; ret
+    0x31, 0xc0, 0xc3,                         // 1027: xor eax, eax; ret
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0x20, 0x10, 0x00, 0x00,                   // 1030: table with 3 entries,
+    0x22, 0x10, 0x00, 0x00,
+    0x24, 0x10, 0x00, 0x00,
+    0x27, 0x10, 0x00, 0x00,                   // 103c: followed by a valid address
+    0x8b, 0x44, 0x24, 0x04,                   // 1040: mov eax, [esp + 4]
+    0x85, 0xc0,                               // 1044: test eax, eax
+    0x74, 0x0b,                               // 1046: je 0x1053
+    0xff, 0x24, 0x85, 0x54, 0x10, 0x00, 0x00, // 1048: jmp [eax * 4 + 0x1054]
+    0x40, 0xc3,                               // 104f: inc eax; ret
+    0x48, 0xc3,                               // 1051: dec eax; ret
+    0xc3,                                     // 1053: ret
+    0x4f, 0x10, 0x00, 0x00,                   // 1054: table with 2 entries
+    0x51, 0x10, 0x00, 0x00,
+  };
+
+  CodeDocument CodeDoc;
+  BOOST_REQUIRE(CodeDoc.Open(std::vector<u8>(std::begin(Code), std::end(Code))));
+  auto& rDoc = CodeDoc.GetDocument();
+  Analyzer Anlz;
+
+  // The bound comes from cmp/ja, so the entry past the end isn't read
+  FunctionGraph FuncGraph;
+  JumpTable JmpTbl;
+  BOOST_REQUIRE(Anlz.GetFunctionGraph(rDoc, Address(0x1010), FuncGraph));
+  BOOST_REQUIRE(JmpTbl.Resolve(rDoc, FuncGraph, Address(0x1010), Address(0x1019)));
+  BOOST_CHECK(JmpTbl.IsBounded());
+  BOOST_CHECK(!JmpTbl.IsRelative());
+  BOOST_CHECK(JmpTbl.GetTableAddress() == Address(0x1030));
+  BOOST_CHECK(JmpTbl.GetEntrySize() == 4);
+  Address const BndTgts[] = { Address(0x1020), Address(0x1022), Address(0x1024) };
+  BOOST_CHECK(JmpTbl.GetTargets() == Address::List(std::begin(BndTgts), std::end(BndTgts)));
+
+  // A bound greater than the maximum number of entries isn't trusted
+  BOOST_REQUIRE(JmpTbl.Resolve(rDoc, FuncGraph, Address(0x1010), Address(0x1019), 2));
+  BOOST_CHECK(!JmpTbl.IsBounded());
+  BOOST_CHECK(JmpTbl.GetTargets().size() == 2);
+
+  // The test doesn't bound the index, so the table ends with the memory area
+  BOOST_REQUIRE(Anlz.GetFunctionGraph(rDoc, Address(0x1040), FuncGraph));
+  BOOST_REQUIRE(JmpTbl.Resolve(rDoc, FuncGraph, Address(0x1040), Address(0x1048)));
+  BOOST_CHECK(!JmpTbl.IsBounded());
+  BOOST_CHECK(JmpTbl.GetTableAddress() == Address(0x1054));
+  Address const UnbTgts[] = { Address(0x104f), Address(0x1051) };
+  BOOST_CHECK(JmpTbl.GetTargets() == Address::List(std::begin(UnbTgts), std::end(UnbTgts)));
+
+  // ... and a single entry is likely a false positive
+  BOOST_CHECK(!JmpTbl.Resolve(rDoc, FuncGraph, Address(0x1040), Address(0x1048), 1));
+  BOOST_CHECK(JmpTbl.GetTargets().empty());
+
+  // The analysis resolved both tables: destinations are code and belong to their function
+  auto spJmpInsn = std::dynamic_pointer_cast<Instruction const>(rDoc.GetCell(Address(0x1019)));
+  BOOST_REQUIRE(spJmpInsn != nullptr);
+  Address::List Tgts;
+  BOOST_CHECK(JumpTable::GetTargets(rDoc, Address(0x1019), *spJmpInsn, Tgts));
+  BOOST_CHECK(Tgts == Address::List(std::begin(BndTgts), std::end(BndTgts)));
+  BOOST_CHECK(rDoc.ContainsCode(Address(0x1025)));
+  BOOST_CHECK(rDoc.ContainsCode(Address(0x1052)));
+  Address::List FuncAddrs;
+  BOOST_CHECK(rDoc.GetFunctionsContaining(Address(0x1024), FuncAddrs));
+  BOOST_CHECK(FuncAddrs.size() == 1 && FuncAddrs.front() == Address(0x1010));
+
+  // cmp/jae excludes the bound, so the executable garbage after the table isn't an entry
+  u8 const ExclCode[] =
+  {
+    0x8b, 0x44, 0x24, 0x04,                   // 1000: mov eax, [esp + 4]
+    0x83, 0xf8, 0x03,                         // 1004: cmp eax, 3
+    0x73, 0x0d,                               // 1007: jae 0x1016
+    0xff, 0x24, 0x85, 0x20, 0x10, 0x00, 0x00, // 1009: jmp [eax * 4 + 0x1020]
+    0x40, 0xc3,                               // 1010: inc eax; ret
+    0x48, 0xc3,                               // 1012: dec eax; ret
+    0x90, 0xc3,                               // 1014: nop; ret
+    0x31, 0xc0, 0xc3,                         // 1016: xor eax, eax; ret
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0x10, 0x10, 0x00, 0x00,                   // 1020: table with 3 entries,
+    0x12, 0x10, 0x00, 0x00,
+    0x14, 0x10, 0x00, 0x00,
+    0x17, 0x10, 0x00, 0x00,                   // 102c: followed by the middle of xor eax, eax
+  };
+
+  CodeDocument ExclCodeDoc;
+  BOOST_REQUIRE(ExclCodeDoc.Open(std::vector<u8>(std::begin(ExclCode), std::end(ExclCode))));
+  auto& rExclDoc = ExclCodeDoc.GetDocument();
+  BOOST_REQUIRE(Anlz.GetFunctionGraph(rExclDoc, Address(0x1000), FuncGraph));
+  BOOST_REQUIRE(JmpTbl.Resolve(rExclDoc, FuncGraph, Address(0x1000), Address(0x1009)));
+  BOOST_CHECK(JmpTbl.IsBounded());
+  Address const ExclTgts[] = { Address(0x1010), Address(0x1012), Address(0x1014) };
+  BOOST_CHECK(JmpTbl.GetTargets() == Address::List(std::begin(ExclTgts), std::end(ExclTgts)));
+  auto spXorCell = rExclDoc.GetCell(Address(0x1016));
+  BOOST_CHECK(spXorCell != nullptr && spXorCell->GetLength() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(core_line_cache_test_case)
+{
+  BOOST_MESSAGE("Testing line cache");
+
+  using namespace medusa;
+
+  // PrintData is noncopyable, so lines are formatted in place
+  auto MakeLines = [](PrintData& rLines, Address const& rAddr, char const* pMnem, u16 CmtNo)
+  {
+    rLines.PrependAddress(false);
+    rLines(rAddr);
+    rLines.AppendMnemonic(pMnem).MarkOffset().AppendRegister("eax").AppendNewLine();
+    for (u16 i = 0; i < CmtNo; ++i)
+      rLines.AppendComment("; comment").AppendNewLine();
+  };
+
+  Address Addr0(0x1000), Addr1(0x1004);
+  LineCache Cache;
+  {
+    PrintData Lines0, Lines1;
+    MakeLines(Lines0, Addr0, "push", 1);
+    MakeLines(Lines1, Addr1, "pop", 0);
+    Cache.Insert(Addr0, Lines0);
+    Cache.Insert(Addr1, Lines1);
+  }
+  BOOST_CHECK(Cache.GetLineNo(Addr0) == 2);
+  BOOST_CHECK(Cache.GetLineNo(Addr1) == 1);
+
+  // Replayed lines must be identical to formatted ones
+  PrintData Replayed;
+  BOOST_REQUIRE(Cache.Replay(Addr0, Replayed));
+  BOOST_REQUIRE(Cache.Replay(Addr1, Replayed));
+  BOOST_CHECK(!Cache.Replay(Address(0x2000), Replayed));
+  PrintData Expected;
+  MakeLines(Expected, Addr0, "push", 1);
+  MakeLines(Expected, Addr1, "pop", 0);
+  BOOST_CHECK(Replayed.GetTexts() == Expected.GetTexts());
+  BOOST_CHECK(Replayed.GetMarks().size() == Expected.GetMarks().size());
+  BOOST_CHECK(Replayed.GetLineNo(Addr0) == 2);
+  BOOST_CHECK(Replayed.GetHeight() == Expected.GetHeight());
+  BOOST_CHECK(Cache.GetHitCount() == 2 && Cache.GetMissCount() == 1);
+
+  u8 OprdNo;
+  BOOST_CHECK(Replayed.GetOperandNo(Addr0, 17, 0, OprdNo) && OprdNo == 0);
+
+  // Only the invalidated address has to be formatted again
+  Cache.Invalidate(Addr0);
+  BOOST_CHECK(!Cache.Contains(Addr0));
+  BOOST_CHECK(Cache.Contains(Addr1));
+  BOOST_CHECK(Cache.GetLiveLineNo() == 1);
+
+  // Dead lines are reclaimed without losing live ones
+  for (u32 i = 0; i < 0x2000; ++i)
+  {
+    PrintData Lines;
+    MakeLines(Lines, Addr0, "nop", i % 3);
+    Cache.Insert(Addr0, Lines);
+  }
+  LineData Line;
+  BOOST_REQUIRE(Cache.GetLine(Addr1, 0, Line));
+  BOOST_CHECK(Line.GetText() == "pop             eax\n");
+  BOOST_CHECK(Cache.GetLiveLineNo() == 1 + 1 + (0x1fff % 3));
+
+  // Lines formatted before an invalidation must not be stored, e.g. by the prefetcher
+  Address Addr2(0x1008);
+  u32 Epoch = Cache.GetEpoch(Addr2);
+  {
+    PrintData Lines;
+    MakeLines(Lines, Addr2, "ret", 0);
+    Cache.Invalidate(Addr2);
+    BOOST_CHECK(!Cache.Insert(Addr2, Lines, 0, Epoch));
+    BOOST_CHECK(!Cache.Contains(Addr2));
+
+    Epoch = Cache.GetEpoch(Addr2);
+    BOOST_CHECK(Cache.Insert(Addr2, Lines, 0, Epoch));
+    BOOST_CHECK(Cache.GetLineNo(Addr2) == 1);
+
+    Cache.Clear();
+    BOOST_CHECK(!Cache.Insert(Addr2, Lines, 0, Epoch));
+    BOOST_CHECK(!Cache.Contains(Addr2));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(core_line_index_test_case)
+{
+  BOOST_MESSAGE("Testing line index");
+
+  using namespace medusa;
+
+  CodeDocument CodeDoc;
+  BOOST_REQUIRE(CodeDoc.Open(MakeThreeFunctions()));
+  auto& rDoc = CodeDoc.GetDocument();
+
+  // Small blocks, so the tree holds several levels and cells overlap blocks
+  u32 const Flags = FormatDisassembly::ShowAddress | FormatDisassembly::AddSpaceBeforeXref;
+  auto CountLines = [&](Address const& rAddr)
+  {
+    return FormatDisassembly::GetLineNo(rDoc, rAddr, Flags);
+  };
+  LineIndex Index(rDoc, CountLines, 4);
+
+  // Lines are counted cell by cell, both conversions must agree with them
+  auto CheckIndex = [&](u32& rLineNo)
+  {
+    u32 MismatchNo = 0;
+    rLineNo = 0;
+    Address CurAddr = rDoc.GetFirstAddress();
+    do
+    {
+      u32 IdxLine;
+      if (!Index.ConvertAddressToLine(CurAddr, IdxLine) || IdxLine != rLineNo)
+        ++MismatchNo;
+
+      u16 CellLineNo = CountLines(CurAddr);
+      for (u16 LineOff = 0; LineOff < CellLineNo; ++LineOff)
+      {
+        Address IdxAddr;
+        u16 IdxLineOff;
+        if (!Index.ConvertLineToAddress(rLineNo + LineOff, IdxAddr, IdxLineOff) || !(IdxAddr == CurAddr) || IdxLineOff != LineOff)
+          ++MismatchNo;
+      }
+      rLineNo += CellLineNo;
+    } while (rDoc.GetNextAddress(CurAddr, CurAddr));
+    return MismatchNo;
+  };
+
+  u32 LineNo;
+  BOOST_CHECK(CheckIndex(LineNo) == 0);
+  BOOST_CHECK(Index.GetNumberOfLines() == LineNo);
+  Address LastAddr;
+  u16 LastOff;
+  BOOST_CHECK(!Index.ConvertLineToAddress(LineNo, LastAddr, LastOff));
+
+  // An address inside a cell is displayed on the line of the cell
+  u32 CallLine, InsideLine;
+  BOOST_REQUIRE(Index.ConvertAddressToLine(Address(0x1003), CallLine));
+  BOOST_REQUIRE(Index.ConvertAddressToLine(Address(0x1005), InsideLine));
+  BOOST_CHECK(CallLine == InsideLine);
+
+  // A modified cell is only counted again once its block is marked
+  BOOST_REQUIRE(rDoc.SetComment(Address(0x1018), "first\nsecond\nthird"));
+  BOOST_CHECK(Index.GetNumberOfLines() == LineNo);
+  Index.Update(Address::List(1, Address(0x1018)));
+  u32 NewLineNo;
+  BOOST_CHECK(CheckIndex(NewLineNo) == 0);
+  BOOST_CHECK(NewLineNo == LineNo + 2);
+  BOOST_CHECK(Index.GetNumberOfLines() == NewLineNo);
+
+  // Once invalidated, the index is built again with the same result
+  Index.Invalidate();
+  BOOST_CHECK(Index.GetNumberOfLines() == NewLineNo);
+  BOOST_CHECK(CheckIndex(NewLineNo) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(core_disassembly_view_line_test_case)
+{
+  BOOST_MESSAGE("Testing disassembly view lines");
+
+  using namespace medusa;
+
+  CodeDocument CodeDoc;
+  BOOST_REQUIRE(CodeDoc.Open(MakeThreeFunctions()));
+  auto& rDoc = CodeDoc.GetDocument();
+
+  u32 const Flags = FormatDisassembly::ShowAddress | FormatDisassembly::AddSpaceBeforeXref;
+  FullDisassemblyView View(CodeDoc.m_Core, Flags, 80, 10, rDoc.GetFirstAddress());
+  LineIndex Index(rDoc, [&](Address const& rAddr)
+  {
+    return FormatDisassembly::GetLineNo(rDoc, rAddr, Flags);
+  });
+
+  // The view counts the same lines as the listing
+  u32 LineNo = View.GetNumberOfLines();
+  BOOST_CHECK(LineNo != 0 && LineNo == Index.GetNumberOfLines());
+
+  // Going to an address puts its first line on top
+  u32 FuncLine, TopLine;
+  BOOST_REQUIRE(Index.ConvertAddressToLine(Address(0x1020), FuncLine));
+  BOOST_REQUIRE(View.GoTo(Address(0x1020), false));
+  BOOST_CHECK(View.GetTopLine(TopLine) && TopLine == FuncLine);
+
+  // Going to a line puts it on top, going past the last line fails
+  BOOST_REQUIRE(View.GoToLine(FuncLine - 1));
+  BOOST_CHECK(View.GetTopLine(TopLine) && TopLine == FuncLine - 1);
+  BOOST_CHECK(!View.GoToLine(LineNo));
+  BOOST_CHECK(View.GetTopLine(TopLine) && TopLine == FuncLine - 1);
+
+  // A new label adds a line, following addresses are moved down
+  u16 IncLineNo = FormatDisassembly::GetLineNo(rDoc, Address(0x1018), Flags);
+  rDoc.AddLabel(Address(0x1018), Label("inc_twice", Label::Code | Label::Local));
+  rDoc.GetChangeJournal().Flush();
+  u16 LblLineNo = FormatDisassembly::GetLineNo(rDoc, Address(0x1018), Flags);
+  BOOST_REQUIRE(LblLineNo > IncLineNo);
+  BOOST_CHECK(View.GetNumberOfLines() == LineNo + LblLineNo - IncLineNo);
+  BOOST_REQUIRE(View.GoTo(Address(0x1020), false));
+  BOOST_CHECK(View.GetTopLine(TopLine) && TopLine == FuncLine + LblLineNo - IncLineNo);
+}
+
+BOOST_AUTO_TEST_CASE(core_overview_test_case)
+{
+  BOOST_MESSAGE("Testing overview");
+
+  using namespace medusa;
+
+  CodeDocument CodeDoc;
+  BOOST_REQUIRE(CodeDoc.Open(MakeThreeFunctions()));
+  auto& rDoc = CodeDoc.GetDocument();
+
+  // A document smaller than the number of buckets gets one byte per bucket
+  Overview Ovw(rDoc);
+  BOOST_CHECK(Ovw.GetNumberOfBuckets() == 0x27);
+
+  // 0x27 bytes in 4 buckets of 10 bytes, the last one is shorter
+  Ovw.SetNumberOfBuckets(4);
+  BOOST_REQUIRE(Ovw.GetNumberOfBuckets() == 4);
+  u64 const BktSizes[] = { 10, 10, 10, 9 };
+  Overview::Bucket Bkt;
+  for (u32 BktIdx = 0; BktIdx < 4; ++BktIdx)
+  {
+    BOOST_REQUIRE(Ovw.GetBucket(BktIdx, Bkt));
+    BOOST_CHECK(Bkt.GetSize() == BktSizes[BktIdx]);
+    BOOST_CHECK(Bkt.GetMainCellType() == Cell::InstructionType);
+  }
+  BOOST_CHECK(!Ovw.GetBucket(4, Bkt));
+
+  // Instructions cover all bytes except the padding of each function, which are undefined values
+  auto Stats = Ovw.GetStatistics();
+  BOOST_CHECK(Stats.GetSize() == 0x27);
+  BOOST_CHECK(Stats.m_Sizes[Cell::InstructionType] == 0x21);
+  BOOST_CHECK(Stats.m_Sizes[Cell::ValueType] == 6);
+
+  u32 BktIdx;
+  BOOST_CHECK(Ovw.ConvertAddressToBucket(Address(0x1015), BktIdx) && BktIdx == 2);
+  BOOST_CHECK(Ovw.ConvertAddressToBucket(Address(0x1026), BktIdx) && BktIdx == 3);
+  BOOST_CHECK(!Ovw.ConvertAddressToBucket(Address(0x2000), BktIdx));
+
+  // A bucket which starts inside a cell returns this cell
+  Address BktAddr;
+  BOOST_CHECK(Ovw.ConvertBucketToAddress(1, BktAddr) && BktAddr == Address(0x1008));
+  BOOST_CHECK(Ovw.ConvertBucketToAddress(2, BktAddr) && BktAddr == Address(0x1012));
+
+  // All buckets are reported after a rebuild, then only those whose content changed
+  std::vector<u32> ChangedBkts;
+  Ovw.GetChangedBuckets(ChangedBkts);
+  BOOST_CHECK(ChangedBkts.size() == 4);
+  Ovw.Update(Address::List(1, Address(0x1000)));
+  Ovw.GetChangedBuckets(ChangedBkts);
+  BOOST_CHECK(ChangedBkts.empty());
+
+  // Padding after 0x101a is disassembled, it spans the two last buckets
+  CodeDoc.m_Core.Analyze(Address(0x101b));
+  CodeDoc.m_Core.WaitForTasks();
+  Address::List PadAddrs;
+  for (TOffset Off = 0x101b; Off < 0x1020; ++Off)
+    PadAddrs.push_back(Address(Off));
+  Ovw.Update(PadAddrs);
+  Ovw.GetChangedBuckets(ChangedBkts);
+  BOOST_CHECK(ChangedBkts == std::vector<u32>({ 2, 3 }));
+  BOOST_CHECK(Ovw.GetStatistics().m_Sizes[Cell::InstructionType] == 0x26);
+}
+
+BOOST_AUTO_TEST_CASE(core_listing_exporter_test_case)
+{
+  BOOST_MESSAGE("Testing listing exporter");
+
+  using namespace medusa;
+
+  CodeDocument CodeDoc;
+  BOOST_REQUIRE(CodeDoc.Open(MakeThreeFunctions()));
+  auto& rDoc = CodeDoc.GetDocument();
+  BOOST_REQUIRE(rDoc.SetComment(Address(0x1012), "caf\xe9 \"quoted\"\ttab"));
+
+  // The text listing is the same as the one of a view, whatever the size of chunks
+  PrintData Print;
+  FormatDisassembly Format(CodeDoc.m_Core, Print);
+  Address::List Addrs;
+  Address CurAddr = rDoc.GetFirstAddress();
+  do
+    Addrs.push_back(CurAddr);
+  while (rDoc.GetNextAddress(CurAddr, CurAddr));
+  Format(Addrs, FormatDisassembly::ShowAddress | FormatDisassembly::AddSpaceBeforeXref);
+
+  std::ostringstream Text, SmallChunkText;
+  ListingExporter Exporter(CodeDoc.m_Core);
+  BOOST_REQUIRE(Exporter.Export(Text, ListingExporter::TextOutput));
+  BOOST_CHECK(Text.str() == Print.GetTexts());
+  BOOST_CHECK(Exporter.GetNumberOfLines() == Print.GetNumberOfLines());
+  ListingExporter SmallChunkExporter(CodeDoc.m_Core, FormatDisassembly::ShowAddress | FormatDisassembly::AddSpaceBeforeXref, 3);
+  BOOST_REQUIRE(SmallChunkExporter.Export(SmallChunkText, ListingExporter::TextOutput));
+  BOOST_CHECK(SmallChunkText.str() == Text.str());
+
+  // JSON lines are plain ASCII, decoding their texts gives the text listing back
+  std::ostringstream Json;
+  BOOST_REQUIRE(Exporter.Export(Json, ListingExporter::JsonLinesOutput));
+  auto JsonStr = Json.str();
+  BOOST_CHECK(std::none_of(std::begin(JsonStr), std::end(JsonStr), [](char Chr) { return static_cast<u8>(Chr) >= 0x80; }));
+  BOOST_CHECK(JsonStr.find("caf\\u00e9 \\\"quoted\\\"\\ttab") != std::string::npos);
+
+  std::string Decoded;
+  std::istringstream JsonLines(JsonStr);
+  std::string JsonLine;
+  u64 JsonLineNo = 0;
+  while (std::getline(JsonLines, JsonLine))
+  {
+    ++JsonLineNo;
+    auto TextOff = JsonLine.find("\"text\":\"");
+    BOOST_REQUIRE(JsonLine.compare(0, 12, "{\"address\":\"") == 0 && TextOff != std::string::npos);
+    for (auto CurOff = TextOff + 8; CurOff < JsonLine.length() && JsonLine[CurOff] != '"'; ++CurOff)
+    {
+      if (JsonLine[CurOff] != '\\')
+      {
+        Decoded += JsonLine[CurOff];
+        continue;
+      }
+      switch (JsonLine[++CurOff])
+      {
+      case 'n': Decoded += '\n'; break;
+      case 'r': Decoded += '\r'; break;
+      case 't': Decoded += '\t'; break;
+      case 'u': Decoded += static_cast<char>(std::stoul(JsonLine.substr(CurOff + 1, 4), nullptr, 16)); CurOff += 4; break;
+      default:  Decoded += JsonLine[CurOff]; break;
+      }
+    }
+    Decoded += '\n';
+  }
+  BOOST_CHECK(JsonLineNo == Exporter.GetNumberOfLines());
+  BOOST_CHECK(Decoded == Text.str());
+}
+
+BOOST_AUTO_TEST_CASE(core_label_list_test_case)
+{
+  BOOST_MESSAGE("Testing label list");
+
+  using namespace medusa;
+
+  typedef std::tuple<LabelList::RowsChange, u32, u32> RowsChangeType;
+  std::vector<RowsChangeType> Changes;
+  auto RecordChange = [&](LabelList::RowsChange Change, u32 FirstRow, u32 LastRow)
+  {
+    Changes.push_back(std::make_tuple(Change, FirstRow, LastRow));
+  };
+
+  // 1M labels are added in one batch, local labels aren't listed
+  u32 const LabelNo = 1000000;
+  std::mt19937 Rng(42);
+  LabelList Labels;
+  for (u32 i = 0; i < LabelNo; ++i)
+  {
+    std::ostringstream oss;
+    oss << "lbl_" << std::hex << Rng();
+    Labels.AddLabelUpdate(Address(0x400000 + i * 4), Label(oss.str(), Label::Code | ((i % 10) ? Label::Global : Label::Local)), false);
+  }
+  BOOST_CHECK(Labels.HasPendingUpdates());
+
+  Labels.ApplyUpdates(RecordChange);
+
+  BOOST_CHECK(!Labels.HasPendingUpdates());
+  BOOST_REQUIRE(Labels.GetSize() == LabelNo - LabelNo / 10);
+  BOOST_REQUIRE(Changes.size() == 2);
+  BOOST_CHECK(std::get<0>(Changes[0]) == LabelList::BeginReset && std::get<0>(Changes[1]) == LabelList::EndReset);
+
+  Labels.Sort(LabelList::SortByName, false);
+  BOOST_REQUIRE(Labels.GetSize() == LabelNo - LabelNo / 10);
+
+  bool IsSorted = true;
+  for (u32 Row = 1; Row < Labels.GetSize(); ++Row)
+    if (Labels.GetEntry(Row - 1).m_Name < Labels.GetEntry(Row).m_Name)
+      IsSorted = false;
+  BOOST_CHECK(IsSorted);
+
+  // A small batch is reported as ranges of rows
+  Labels.Sort(LabelList::SortByAddress, true);
+  u32 Row;
+  BOOST_REQUIRE(Labels.FindRow(Address(0x400000 + 11 * 4), Row));
+  BOOST_CHECK(Row == 9);
+  BOOST_CHECK(!Labels.FindRow(Address(0x400000 + 10 * 4), Row));
+
+  LabelList::Entry Removed[] = { Labels.GetEntry(9), Labels.GetEntry(10), Labels.GetEntry(11) };
+  Changes.clear();
+  for (auto const& rEntry : Removed)
+    Labels.AddLabelUpdate(rEntry.m_Address, rEntry.m_Label, true);
+  Labels.AddLabelUpdate(Address(0x400001), Label("lbl_new0", Label::Code), false);
+  Labels.AddLabelUpdate(Address(0x400002), Label("lbl_new1", Label::Code), false);
+  Labels.AddLabelUpdate(Address(0x400003), Label("lbl_new2", Label::Code), false);
+  Labels.AddLabelUpdate(Address(0x400003), Label("lbl_new2", Label::Code), true);
+  Labels.ApplyUpdates(RecordChange);
+
+  BOOST_REQUIRE(Changes.size() == 4);
+  BOOST_CHECK(Changes[0] == std::make_tuple(LabelList::BeginRemoveRows, 9U, 11U));
+  BOOST_CHECK(Changes[1] == std::make_tuple(LabelList::EndRemoveRows,   9U, 11U));
+  BOOST_CHECK(Changes[2] == std::make_tuple(LabelList::BeginInsertRows, 0U, 1U));
+  BOOST_CHECK(Changes[3] == std::make_tuple(LabelList::EndInsertRows,   0U, 1U));
+  BOOST_CHECK(Labels.GetSize() == LabelNo - LabelNo / 10 - 1);
+  BOOST_CHECK(Labels.GetEntry(1).m_Name == "lbl_new1");
+
+  // Labels which don't match the filter are ignored
+  Labels.SetFilter("NEW");
+  Changes.clear();
+  Labels.AddLabelUpdate(Address(0x300000), Label("lbl_other", Label::Code), false);
+  Labels.AddLabelUpdate(Address(0x300001), Label("lbl_NewOne", Label::Code), false);
+  Labels.ApplyUpdates(RecordChange);
+  BOOST_REQUIRE(Changes.size() == 2);
+  BOOST_CHECK(Changes[0] == std::make_tuple(LabelList::BeginInsertRows, 0U, 0U));
+}
+
+BOOST_AUTO_TEST_CASE(core_change_journal_test_case)
+{
+  BOOST_MESSAGE("Testing change journal");
+
+  using namespace medusa;
+
+  u32 BatchNo = 0, DocUpdNo = 0;
+  Address::List LastAddrs;
+  ChangeJournal::LabelChangeVector LastLbls;
+  ChangeJournal Journal([&](bool DocumentUpdated, ChangeJournal::LabelChangeVector const& rLabels, Address::List const& rAddresses)
+  {
+    ++BatchNo;
+    if (DocumentUpdated)
+      ++DocUpdNo;
+    LastLbls  = rLabels;
+    LastAddrs = rAddresses;
+  }, 0);
+
+  // Without delay, each change is delivered by the caller
+  Journal.AddAddressUpdate(Address(0x1000));
+  BOOST_CHECK(BatchNo == 1 && LastAddrs.size() == 1);
+  Journal.AddDocumentUpdate();
+  BOOST_CHECK(BatchNo == 2 && DocUpdNo == 1);
+
+  // With a long delay, changes are only delivered on flush, coalesced in one batch
+  Journal.SetDelay(60 * 1000);
+  for (u32 i = 0; i < 0x1000; ++i)
+  {
+    Journal.AddAddressUpdate(Address(0x2000 - (i % 0x10)));
+    Journal.AddDocumentUpdate();
+  }
+  Journal.AddLabelUpdate(Address(0x1000), Label("old"), true);
+  Journal.AddLabelUpdate(Address(0x1000), Label("new"), false);
+  BOOST_CHECK(BatchNo == 2);
+  Journal.Flush();
+  BOOST_CHECK(BatchNo == 3 && DocUpdNo == 2);
+  BOOST_REQUIRE(LastAddrs.size() == 0x10);
+  BOOST_CHECK(LastAddrs.front() == Address(0x1ff1) && LastAddrs.back() == Address(0x2000));
+  BOOST_REQUIRE(LastLbls.size() == 2);
+  BOOST_CHECK(LastLbls[0].m_Removed && LastLbls[0].m_Label.GetName() == "old");
+  BOOST_CHECK(!LastLbls[1].m_Removed && LastLbls[1].m_Label.GetName() == "new");
+  BOOST_CHECK(Journal.GetChangeNo() == 2 + 0x2000 + 2);
+
+  // Nothing is delivered once the journal is empty
+  Journal.Flush();
+  BOOST_CHECK(BatchNo == 3);
+
+  // The worker delivers pending changes once the delay is elapsed
+  Journal.SetDelay(10);
+  Journal.AddAddressUpdate(Address(0x3000));
+  for (u32 i = 0; i < 100 && Journal.GetBatchNo() == 3; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  BOOST_CHECK(Journal.GetBatchNo() == 4);
+  Journal.Stop();
+  BOOST_CHECK(LastAddrs.size() == 1 && LastAddrs.front() == Address(0x3000));
+}
+
+BOOST_AUTO_TEST_CASE(core_task_test_case)
+{
+  BOOST_MESSAGE("Testing task cancellation");
+
+  using namespace medusa;
+
+  // This task is way too long to finish, only a cancellation can stop it
+  class CountTask : public Task
+  {
+  public:
+    CountTask(std::string const& rName, u64 Total = 1ULL << 40) : m_Name(rName), m_Total(Total) {}
+    virtual std::string GetName(void) const { return m_Name; }
+    virtual void Run(void)
+    {
+      SetTotal(m_Total);
+      volatile u64 Sum = 0;
+      for (u64 i = 0; i < m_Total && !IsCancelled(); ++i)
+      {
+        Sum += i;
+        Advance();
+      }
+    }
+  private:
+    std::string m_Name;
+    u64         m_Total;
+  };
+
+  // This task outlives its deadline but never checks it
+  class SleepTask : public Task
+  {
+  public:
+    virtual std::string GetName(void) const { return "sleep"; }
+    virtual void Run(void) { std::this_thread::sleep_for(std::chrono::milliseconds(100)); }
+  };
+
+  // Sub-tasks share the token of their parent, the status is only final once a task is run
+  CountTask Parent("parent"), Child("child");
+  Child.SetCancellationToken(Parent.GetCancellationToken());
+  Parent.Cancel();
+  BOOST_CHECK(Child.IsCancelled() && Child.GetStatus() == Task::Started);
+
+  std::mutex StatusMutex;
+  std::vector<std::pair<std::string, u8>> Statuses;
+  auto GetStatusNo = [&]()
+  {
+    std::lock_guard<std::mutex> Lock(StatusMutex);
+    return Statuses.size();
+  };
+  auto WaitFor = [](std::function<bool (void)> Predicate)
+  {
+    for (u32 i = 0; i < 500 && !Predicate(); ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return Predicate();
+  };
+
+  TaskManager TaskMgr([&](Task const* pTask, u8 Status)
+  {
+    std::lock_guard<std::mutex> Lock(StatusMutex);
+    Statuses.push_back(std::make_pair(pTask->GetName(), Status));
+  });
+
+  // Cancelling removes queued tasks, the running one stops by itself
+  TaskMgr.AddTask(new CountTask("first"));
+  TaskMgr.AddTask(new CountTask("second"));
+  std::string Name;
+  u64 Done = 0, Total = 0;
+  BOOST_REQUIRE(WaitFor([&]() { return TaskMgr.GetCurrentTaskProgress(Name, Done, Total) && Done != 0; }));
+  BOOST_CHECK(Name == "first" && Total == (1ULL << 40));
+  TaskMgr.CancelAllTasks();
+  BOOST_REQUIRE(WaitFor([&]() { return GetStatusNo() == 2; }));
+
+  // The timeout starts with each task, and it can be removed
+  TaskMgr.SetTimeout(std::chrono::milliseconds(50));
+  TaskMgr.AddTask(new CountTask("third"));
+  BOOST_REQUIRE(WaitFor([&]() { return GetStatusNo() == 4; }));
+  TaskMgr.SetTimeout(std::chrono::milliseconds::zero());
+  TaskMgr.AddTask(new CountTask("fourth", 0x1000));
+  TaskMgr.Wait();
+
+  // Only a timeout seen by the task makes it timed out
+  TaskMgr.SetTimeout(std::chrono::milliseconds(10));
+  TaskMgr.AddTask(new SleepTask);
+  TaskMgr.Wait();
+  TaskMgr.Stop();
+
+  BOOST_REQUIRE(Statuses.size() == 8);
+  BOOST_CHECK(Statuses[0].first == "first" && Statuses[0].second == Task::Started);
+  BOOST_CHECK(Statuses[1].first == "first" && Statuses[1].second == Task::Cancelled);
+  BOOST_CHECK(Statuses[2].first == "third" && Statuses[2].second == Task::Started);
+  BOOST_CHECK(Statuses[3].first == "third" && Statuses[3].second == Task::TimedOut);
+  BOOST_CHECK(Statuses[5].first == "fourth" && Statuses[5].second == Task::Done);
+  BOOST_CHECK(Statuses[7].first == "sleep" && Statuses[7].second == Task::Done);
+  BOOST_CHECK(!TaskMgr.GetCurrentTaskProgress(Name, Done, Total));
+}
+
+BOOST_AUTO_TEST_CASE(core_cancel_analysis_test_case)
+{
+  BOOST_MESSAGE("Testing cancellation of a disassembly");
+
+  using namespace medusa;
+
+  // 0x1000 returns at once, 0x1001 is a long chain of basic blocks ended by jmp $+2
+  std::vector<u8> Code(1, 0xc3);
+  u32 const JmpNo = 0x80000;
+  for (u32 i = 0; i < JmpNo; ++i)
+  {
+    Code.push_back(0xeb);
+    Code.push_back(0x00);
+  }
+  Code.push_back(0xc3);
+  Address const LastAddr(0x1001 + JmpNo * 2);
+
+  CodeDocument CodeDoc;
+  BOOST_REQUIRE(CodeDoc.Open(Code));
+  auto& rDoc = CodeDoc.GetDocument();
+
+  // The final status is sent by the task thread, while the document is still there
+  class TaskView : public View
+  {
+  public:
+    TaskView(Document& rDoc, Address const& rLastAddr)
+      : View(Document::Subscriber::TaskUpdated, rDoc), m_LastAddr(rLastAddr), m_Status(Task::Started), m_IsFinished(false) {}
+    virtual void OnTaskUpdated(std::string const& rTaskName, u8 Status)
+    {
+      if (rTaskName != "disassemble" || Status == Task::Started)
+        return;
+      m_IsFinished = m_rDoc.ContainsCode(m_LastAddr);
+      m_Status = Status;
+    }
+    Address         m_LastAddr;
+    std::atomic<u8> m_Status;
+    bool            m_IsFinished;
+  } Observer(rDoc, LastAddr);
+
+  // 0x1001 is still a value, its architecture is the one of the code at 0x1000
+  auto spArch = ModuleManager::Instance().GetArchitecture(CodeDoc.m_Core.GetCell(Address(0x1000))->GetArchitectureTag());
+  BOOST_REQUIRE(spArch != nullptr);
+  CodeDoc.m_Core.Analyze(Address(0x1001), spArch);
+  std::string Name;
+  u64 Done, Total;
+  for (u32 i = 0; i < 500 && !rDoc.ContainsCode(Address(0x1101)); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  BOOST_REQUIRE(CodeDoc.m_Core.GetTaskProgress(Name, Done, Total) && Name == "disassemble");
+
+  // Closing the document cancels the disassembly and returns once it has stopped
+  BOOST_REQUIRE(CodeDoc.m_Core.CloseDocument());
+  BOOST_CHECK(Observer.m_Status == Task::Cancelled);
+  BOOST_CHECK(!Observer.m_IsFinished);
+  BOOST_CHECK(!CodeDoc.m_Core.GetTaskProgress(Name, Done, Total));
+}
+
+BOOST_AUTO_TEST_CASE(core_binary_stream_test_case)
+{
+  BOOST_MESSAGE("Testing binary stream larger than 4 GB");
+
+  using namespace medusa;
+
+  // The file is sparse, only written blocks are allocated
+  u64 const FileSize  = 0x140000000ULL;
+  u64 const StrOff    = 0x100000010ULL;
+  u64 const CrossOff  = 70 * FileBinaryStream::WindowSize - 4;
+  u64 const TailOff   = FileSize - 4;
+  auto BinPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  {
+    std::ofstream BinFile(BinPath.string(), std::ios::binary);
+    BOOST_REQUIRE(BinFile.is_open());
+    BinFile.write("head", 5);
+  }
+  boost::filesystem::resize_file(BinPath, FileSize);
+  {
+    std::fstream BinFile(BinPath.string(), std::ios::binary | std::ios::in | std::ios::out);
+    BOOST_REQUIRE(BinFile.is_open());
+    u8 const CrossBuf[] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 };
+    BinFile.seekp(StrOff);
+    BinFile.write("beyond 4 GB", 12);
+    BinFile.seekp(CrossOff);
+    BinFile.write(reinterpret_cast<char const*>(CrossBuf), sizeof(CrossBuf));
+    BinFile.seekp(TailOff);
+    BinFile.write("tail", 4);
+  }
+
+  auto CheckStream = [&](FileBinaryStream const& rBinStrm)
+  {
+    BOOST_CHECK(rBinStrm.GetSize() == FileSize);
+
+    std::string Str;
+    BOOST_CHECK(rBinStrm.Read(0, Str) && Str == "head");
+    BOOST_CHECK(rBinStrm.Read(StrOff, Str) && Str == "beyond 4 GB");
+    BOOST_CHECK(rBinStrm.StringLength(StrOff + 7) == 4);
+
+    // This value is read across two windows
+    u64 Cross;
+    BOOST_CHECK(rBinStrm.Read(CrossOff, Cross) && Cross == 0x8877665544332211ULL);
+
+    // The last string is not terminated, and nothing can be read past the end
+    u32 Tail;
+    BOOST_CHECK(rBinStrm.Read(TailOff, Tail) && Tail == 0x6c696174);
+    BOOST_CHECK(rBinStrm.StringLength(TailOff) == 0);
+    BOOST_CHECK(!rBinStrm.Read(TailOff + 2, Tail));
+    BOOST_CHECK(!rBinStrm.Read(FileSize, Tail));
+  };
+
+  {
+    FileBinaryStream BinStrm(BinPath);
+    BinStrm.SetEndianness(LittleEndian);
+    BOOST_CHECK(BinStrm.IsWindowed());
+    BOOST_CHECK(BinStrm.GetBuffer() == nullptr);
+    CheckStream(BinStrm);
+
+    // Windows are evicted, then mapped again
+    u64 ZeroNo = 0;
+    for (u64 CurOff = 0x10; CurOff < FileSize; CurOff += 0x100000)
+    {
+      u8 Byte;
+      if (BinStrm.Read(CurOff, Byte) && Byte == 0)
+        ++ZeroNo;
+    }
+    BOOST_CHECK(ZeroNo == FileSize / 0x100000 - 1);
+    CheckStream(BinStrm);
+
+    // Views read their parent at their own offsets, even across windows
+    u64 Cross;
+    SubBinaryStream SubStrm(BinStrm, CrossOff - 0x10, 0x20);
+    BOOST_CHECK(SubStrm.GetSize() == 0x20 && SubStrm.GetBuffer() == nullptr);
+    BOOST_CHECK(SubStrm.Read(0x10, Cross) && Cross == 0x8877665544332211ULL);
+    BOOST_CHECK(!SubStrm.Read(0x1c, Cross));
+  }
+
+  if (sizeof(void*) == 8)
+  {
+    FileBinaryStream BinStrm(BinPath, FileBinaryStream::FullMapping);
+    BinStrm.SetEndianness(LittleEndian);
+    BOOST_CHECK(!BinStrm.IsWindowed());
+    CheckStream(BinStrm);
+  }
+
+  boost::filesystem::remove(BinPath);
+}
+
+BOOST_AUTO_TEST_CASE(core_binary_stream_array_test_case)
+{
+  BOOST_MESSAGE("Testing binary stream bulk readers");
+
+  using namespace medusa;
+
+  std::vector<u8> Raw(0x100003);
+  for (size_t i = 0; i < Raw.size(); ++i)
+    Raw[i] = static_cast<u8>(i);
+  MemoryBinaryStream BinStrm(Raw.data(), Raw.size());
+
+  // Misaligned arrays must match scalar reads, in both endianness
+  for (auto Endianness : { LittleEndian, BigEndian })
+  {
+    BinStrm.SetEndianness(Endianness);
+    std::vector<u16> Arr16;
+    std::vector<u32> Arr32;
+    std::vector<u64> Arr64;
+    BOOST_REQUIRE(BinStrm.ReadArray(1, 0x7ffff, Arr16));
+    BOOST_REQUIRE(BinStrm.ReadArray(1, 0x3ffff, Arr32));
+    BOOST_REQUIRE(BinStrm.ReadArray(3, 0x1ffff, Arr64));
+
+    bool IsSame = true;
+    for (u32 i = 0; i < Arr16.size(); ++i) { u16 Val; IsSame &= BinStrm.Read(1 + i * 2, Val) && Val == Arr16[i]; }
+    for (u32 i = 0; i < Arr32.size(); ++i) { u32 Val; IsSame &= BinStrm.Read(1 + i * 4, Val) && Val == Arr32[i]; }
+    for (u32 i = 0; i < Arr64.size(); ++i) { u64 Val; IsSame &= BinStrm.Read(3 + i * 8, Val) && Val == Arr64[i]; }
+    BOOST_CHECK(IsSame);
+    BOOST_CHECK(Arr32[0] == (Endianness == BigEndian ? 0x01020304 : 0x04030201));
+
+    u16 Fixed[3];
+    BOOST_CHECK(BinStrm.Read(1, Fixed) && Fixed[2] == Arr16[2]);
+  }
+
+  // Out of bounds arrays are rejected
+  std::vector<u32> Values;
+  BOOST_CHECK(!BinStrm.ReadArray(0x100000, 1, Values));
+  BOOST_CHECK(!BinStrm.ReadArray(0, ~0ULL, Values));
+  BOOST_CHECK(BinStrm.ReadArray(0x100000, 0, Values) && Values.empty());
+
+  // Spans are only available in place
+  BinStrm.SetEndianness(BigEndian);
+  BOOST_CHECK(BinStrm.GetSpan<u32>(0, 4).empty());
+  BinStrm.SetEndianness(LittleEndian);
+  auto Span32 = BinStrm.GetSpan<u32>(4, 4);
+  BOOST_CHECK(Span32.size() == 4 && Span32[0] == 0x07060504);
+  BOOST_CHECK(BinStrm.GetSpan<u32>(5, 4).empty());
+  BOOST_CHECK(BinStrm.GetSpan<char>(0x100000, 4).empty());
+  BOOST_CHECK(BinStrm.GetSpan<char>(0x100000, 3).size() == 3);
+
+  // Otherwise they're copied
+  BinStrm.SetEndianness(BigEndian);
+  Span<u32 const>  CopiedSpan;
+  std::vector<u32> Storage;
+  BOOST_CHECK(BinStrm.ReadSpan(4, 4, CopiedSpan, Storage) && CopiedSpan.data() == Storage.data() && CopiedSpan[0] == 0x04050607);
+
+  // Scalars can be written at any offset
+  BOOST_CHECK(BinStrm.Write(1, static_cast<u32>(0xaabbccdd)));
+  u8 Byte;
+  u32 Word;
+  BOOST_CHECK(BinStrm.Read(1, Byte) && Byte == 0xaa);
+  BOOST_CHECK(BinStrm.Read(1, Word) && Word == 0xaabbccdd);
+}
+
+BOOST_AUTO_TEST_CASE(core_sub_binary_stream_test_case)
+{
+  BOOST_MESSAGE("Testing binary stream views");
+
+  using namespace medusa;
+
+  std::vector<u8> Raw(0x1000);
+  for (size_t i = 0; i < Raw.size(); ++i)
+    Raw[i] = static_cast<u8>(i);
+  MemoryBinaryStream BinStrm(Raw.data(), Raw.size());
+  BinStrm.SetEndianness(BigEndian);
+
+  // The view shares the buffer of its parent
+  SubBinaryStream SubStrm(BinStrm, 0x100, 0x200);
+  BOOST_CHECK(SubStrm.GetSize() == 0x200 && SubStrm.GetOffset() == 0x100);
+  BOOST_CHECK(SubStrm.GetBuffer() == static_cast<u8 const*>(BinStrm.GetBuffer()) + 0x100);
+  BOOST_CHECK(SubStrm.GetEndianness() == BigEndian);
+
+  u32 Word;
+  std::vector<u16> Arr16;
+  BOOST_CHECK(SubStrm.Read(0x4, Word) && Word == 0x04050607);
+  BOOST_CHECK(SubStrm.ReadArray(0x1fc, 2, Arr16) && Arr16[1] == 0xfeff);
+  BOOST_CHECK(!SubStrm.Read(0x1fe, Word));
+  BOOST_CHECK(SubStrm.GetSpan<u8>(0x10, 1).data() == static_cast<u8 const*>(BinStrm.GetBuffer()) + 0x110);
+
+  // Ranges are truncated to the end of the parent
+  BOOST_CHECK(SubBinaryStream(BinStrm, 0xff0, 0x100).GetSize() == 0x10);
+  BOOST_CHECK(SubBinaryStream(BinStrm, 0x2000, 0x100).GetSize() == 0x0);
+}
+
+BOOST_AUTO_TEST_CASE(core_patch_overlay_test_case)
+{
+  BOOST_MESSAGE("Testing patch overlay");
+
+  using namespace medusa;
+
+  u64 const FileSize = 3 * PatchOverlay::PageSize + 0x10;
+  auto BinPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  auto PatchedPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  {
+    std::ofstream BinFile(BinPath.string(), std::ios::binary);
+    BOOST_REQUIRE(BinFile.is_open());
+    for (u64 i = 0; i < FileSize; ++i)
+      BinFile.put(static_cast<char>(i & 0x7f));
+  }
+
+  {
+    // The file is mapped read-only, writes must not reach it
+    FileBinaryStream BinStrm(BinPath);
+    BinStrm.SetEndianness(LittleEndian);
+    auto spOverlay = BinStrm.GetOverlay();
+    u8 const* pOrg = static_cast<u8 const*>(BinStrm.GetBuffer());
+    BOOST_REQUIRE(pOrg != nullptr);
+
+    // This value crosses a page boundary
+    u32 Word;
+    TOffset const CrossOff = PatchOverlay::PageSize - 2;
+    BOOST_CHECK(BinStrm.Write(CrossOff, static_cast<u32>(0xaabbccdd)));
+    BOOST_CHECK(BinStrm.Read(CrossOff, Word) && Word == 0xaabbccdd);
+    BOOST_CHECK(pOrg[CrossOff] == (CrossOff & 0x7f));
+    BOOST_CHECK(spOverlay->GetPageNo() == 2);
+    BOOST_CHECK(BinStrm.GetSpan<u8>(CrossOff, 4).empty());
+    BOOST_CHECK(!BinStrm.GetSpan<u8>(2 * PatchOverlay::PageSize, 4).empty());
+    BOOST_CHECK(!BinStrm.Write(FileSize - 2, Word));
+
+    // Strings are read with their patches
+    std::string Str;
+    BOOST_CHECK(BinStrm.Write(FileSize - 4, "ab", 3));
+    BOOST_CHECK(BinStrm.StringLength(FileSize - 4) == 2);
+    BOOST_CHECK(BinStrm.Read(FileSize - 4, Str) && Str == "ab");
+
+    // Views share the patches of their parent
+    SubBinaryStream SubStrm(BinStrm, PatchOverlay::PageSize, PatchOverlay::PageSize);
+    u16 Half;
+    BOOST_CHECK(SubStrm.Read(0, Half) && Half == 0xaabb);
+    BOOST_CHECK(SubStrm.Write(0x10, static_cast<u8>(0xff)));
+    u8 Byte;
+    BOOST_CHECK(BinStrm.Read(PatchOverlay::PageSize + 0x10, Byte) && Byte == 0xff);
+
+    // The diff only holds modified bytes, a run crossing pages is kept whole
+    PatchOverlay::PatchVector Patches;
+    BOOST_CHECK(spOverlay->GetPatches(Patches));
+    BOOST_REQUIRE(Patches.size() == 3);
+    BOOST_CHECK(Patches[0].m_Offset == CrossOff && Patches[0].m_Data.size() == 4);
+    BOOST_CHECK(Patches[1].m_Offset == PatchOverlay::PageSize + 0x10 && Patches[1].m_Data.size() == 1);
+    BOOST_CHECK(Patches[2].m_Offset == FileSize - 4 && Patches[2].m_Data[2] == 0x0);
+
+    // Writes are undone in reverse order, pages copied by them are dropped
+    BOOST_CHECK(spOverlay->GetUndoNo() == 3);
+    BOOST_CHECK(spOverlay->Undo() && spOverlay->Undo());
+    BOOST_CHECK(spOverlay->GetPageNo() == 2);
+    BOOST_CHECK(BinStrm.Read(FileSize - 4, Byte) && Byte == ((FileSize - 4) & 0x7f));
+    BOOST_CHECK(spOverlay->Undo() && !spOverlay->Undo());
+    BOOST_CHECK(spOverlay->IsEmpty());
+    BOOST_CHECK(BinStrm.Read(CrossOff, Word) && Word == 0x01007f7e);
+    BOOST_CHECK(spOverlay->Redo() && spOverlay->GetRedoNo() == 2);
+    BOOST_CHECK(BinStrm.Read(CrossOff, Word) && Word == 0xaabbccdd);
+
+    // The patched file is exported, the original one is untouched
+    BOOST_CHECK(BinStrm.Export(PatchedPath));
+    FileBinaryStream PatchedStrm(PatchedPath);
+    PatchedStrm.SetEndianness(LittleEndian);
+    BOOST_CHECK(PatchedStrm.GetSize() == FileSize);
+    BOOST_CHECK(PatchedStrm.Read(CrossOff, Word) && Word == 0xaabbccdd);
+
+    // Patches can be applied on another stream of the same file
+    MemoryBinaryStream MemStrm(pOrg, FileSize);
+    MemStrm.SetEndianness(LittleEndian);
+    BOOST_CHECK(spOverlay->GetPatches(Patches) && Patches.size() == 1);
+    BOOST_CHECK(MemStrm.GetOverlay()->ApplyPatches(Patches));
+    BOOST_CHECK(MemStrm.GetOverlay()->GetUndoNo() == 0);
+    BOOST_CHECK(MemStrm.Read(CrossOff, Word) && Word == 0xaabbccdd);
+  }
+
+  {
+    // Windowed streams are patched the same way
+    FileBinaryStream BinStrm(BinPath, FileBinaryStream::WindowedMapping);
+    BOOST_CHECK(BinStrm.IsWindowed() && BinStrm.GetOverlay()->IsEmpty());
+    BOOST_CHECK(BinStrm.Write(0x10, "xyz", 4));
+    std::string Str;
+    BOOST_CHECK(BinStrm.Read(0x10, Str) && Str == "xyz");
+  }
+
+  boost::filesystem::remove(BinPath);
+  boost::filesystem::remove(PatchedPath);
+}
+
+BOOST_AUTO_TEST_CASE(core_batch_session_test_case)
+{
+  BOOST_MESSAGE("Testing batch session");
+
+  using namespace medusa;
+
+  auto& rModMgr = ModuleManager::Instance();
+  auto ModPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  BOOST_REQUIRE(boost::filesystem::create_directory(ModPath));
+  {
+    std::ofstream NotModFile((ModPath / "notes.txt").string());
+  }
+
+  // A directory is only scanned by the first session
+  BatchSession Session(ModPath);
+  BOOST_CHECK(Session.IsReady());
+  auto DescNo = rModMgr.GetModuleDescriptors().size();
+  BOOST_CHECK(BatchSession(ModPath).IsReady());
+  BOOST_CHECK(rModMgr.GetModuleDescriptors().size() == DescNo);
+  BOOST_CHECK(!BatchSession(ModPath / "missing").IsReady());
+
+  // Without module, nothing can be selected
+  u8 const Raw[] = { 0x7f, 'E', 'L', 'F' };
+  MemoryBinaryStream BinStrm(Raw, sizeof(Raw));
+  Loader::SPType spLdr;
+  Architecture::VSPType Archs;
+  OperatingSystem::SPType spOs;
+  if (DescNo == 0)
+  {
+    BOOST_CHECK(Session.ProbeLoaders(BinStrm).empty());
+    BOOST_CHECK(!Session.SelectModules(BinStrm, spLdr, Archs, spOs));
+    BOOST_CHECK(Session.MakeDatabase("text") == nullptr);
+  }
+
+  boost::filesystem::remove_all(ModPath);
+}
+
+BOOST_AUTO_TEST_CASE(core_batch_analyzer_test_case)
+{
+  BOOST_MESSAGE("Testing batch analyzer");
+
+  using namespace medusa;
+
+  auto TmpPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  BOOST_REQUIRE(boost::filesystem::create_directory(TmpPath));
+  {
+    std::ofstream RawFile((TmpPath / "small.bin").string(), std::ios::binary);
+    RawFile << "\x90\x90\xc3";
+  }
+
+  BatchAnalyzer Batch(TmpPath);
+  BOOST_REQUIRE(Batch.IsReady());
+  Batch.SetOutputDirectory(TmpPath / "out");
+
+  // Results keep the order of files, and each one is reported once
+  std::vector<Path> FilePaths;
+  FilePaths.push_back(TmpPath / "missing.bin");
+  FilePaths.push_back(TmpPath / "small.bin");
+  BatchAnalyzer::ResultVector Results;
+  u32 ReportedNo = 0;
+  auto Rpt = Batch.Run(FilePaths, Results, [&ReportedNo](BatchAnalyzer::Result const&) { ++ReportedNo; });
+  BOOST_REQUIRE(Results.size() == 2);
+  BOOST_CHECK(ReportedNo == 2);
+  BOOST_CHECK(Results[0].m_FilePath == FilePaths[0]);
+  BOOST_CHECK(Results[1].m_FilePath == FilePaths[1]);
+  BOOST_CHECK(Rpt.m_FileNo == 2);
+
+  // Without module, no file can be analyzed
+  if (ModuleManager::Instance().GetModuleDescriptors().empty())
+  {
+    BOOST_CHECK(Rpt.m_AnalyzedNo == 0);
+    BOOST_CHECK(Results[0].m_Status == BatchAnalyzer::Failed);
+    BOOST_CHECK(!Results[0].m_Error.empty());
+  }
+
+  BatchAnalyzer::Report FakeRpt;
+  FakeRpt.m_FileNo  = 10;
+  FakeRpt.m_Size    = 4 * 1024 * 1024;
+  FakeRpt.m_Elapsed = 2000;
+  BOOST_CHECK(FakeRpt.GetFilesPerSecond() == 5.0);
+  BOOST_CHECK(FakeRpt.GetMegaBytesPerSecond() == 2.0);
+  FakeRpt.m_Elapsed = 0;
+  BOOST_CHECK(FakeRpt.GetFilesPerSecond() == 0.0);
+
+  BOOST_CHECK(std::string(BatchAnalyzer::GetStatusName(BatchAnalyzer::TooLarge)) == "too large");
+
+  boost::filesystem::remove_all(TmpPath);
+}
+
+BOOST_AUTO_TEST_CASE(core_stream_analyzer_test_case)
+{
+  BOOST_MESSAGE("Testing stream analyzer");
+
+  using namespace medusa;
+
+  // The window and its overlap stay in half of the budget, whatever the size of the file
+  u64 const Budget = 0x10000000;
+  u64 WinSize = StreamAnalyzer::ComputeWindowSize(Budget, 0x1000);
+  BOOST_CHECK(WinSize == Budget / 2 - 0x1000);
+
+  // A too large overlap is truncated, and a too small budget is raised
+  WinSize = StreamAnalyzer::ComputeWindowSize(Budget, 0xffffffff);
+  BOOST_CHECK(WinSize == Budget / 4);
+  WinSize = StreamAnalyzer::ComputeWindowSize(0, 0);
+  BOOST_CHECK(WinSize == StreamAnalyzer::MinimumMemoryBudget / 2 - StreamAnalyzer::MinimumOverlap);
+
+  // Without a database, nothing is analyzed
+  Document Doc;
+  StreamAnalyzer StrmAnlz(Doc, Database::SPType(), Architecture::SPType());
+  StrmAnlz.SetMemoryBudget(0x400000);
+  StrmAnlz.SetOverlap(0x100);
+  BOOST_CHECK(StrmAnlz.GetWindowSize() == 0x200000 - 0x100);
+  StrmAnlz.Run();
+  BOOST_CHECK(!StrmAnlz.IsSucceeded());
+  BOOST_CHECK(StrmAnlz.GetStatistics().m_WindowNo == 0);
+}
+
+BOOST_AUTO_TEST_CASE(core_memory_area_test_case)
+{
+  BOOST_MESSAGE("Testing cell lookup in memory area");
+
+  using namespace medusa;
+
+  MappedMemoryArea MemArea("test", 0x0, 0x10000, Address(0x400000), 0x10000, MemoryArea::Read);
+  Address::List DelAddrs;
+  BOOST_REQUIRE(MemArea.SetCellData(0x400010, std::make_shared<CellData>(Cell::InstructionType, 0, 4), DelAddrs, true));
+  BOOST_REQUIRE(MemArea.SetCellData(0x408000, std::make_shared<CellData>(Cell::StringType, 0, 0x20), DelAddrs, true));
+
+  // Bytes inside a cell don't start a cell, others are undefined values
+  BOOST_CHECK(MemArea.GetCellData(0x400010)->GetLength() == 4);
+  BOOST_CHECK(MemArea.GetCellData(0x400013) == nullptr);
+  BOOST_CHECK(MemArea.GetCellData(0x400014)->GetLength() == 1);
+  BOOST_CHECK(MemArea.GetCellData(0x40801f) == nullptr);
+  BOOST_CHECK(MemArea.GetCellData(0x408020)->GetLength() == 1);
+
+  // Undefined bytes far from any cell must not scan back to it
+  u32 UndefNo = 0;
+  for (TOffset CurOff = 0x400014; CurOff < 0x408000; ++CurOff)
+    if (MemArea.GetCellData(CurOff) != nullptr)
+      ++UndefNo;
+  BOOST_CHECK(UndefNo == 0x408000 - 0x400014);
+
+  // A range which starts inside a cell reports this cell first
+  std::vector<TOffset> CellOffs;
+  MemArea.ForEachCellDataInRange(0x400012, 0x400016, [&](TOffset Offset, CellData::SPType)
+  {
+    CellOffs.push_back(Offset);
+    return true;
+  });
+  TOffset const ExpectedOffs[] = { 0x400010, 0x400014, 0x400015 };
+  BOOST_CHECK(CellOffs == std::vector<TOffset>(std::begin(ExpectedOffs), std::end(ExpectedOffs)));
+
+  CellOffs.clear();
+  MemArea.ForEachCellDataInRange(0x407ff0, 0x409000, [&](TOffset Offset, CellData::SPType spCellData)
+  {
+    CellOffs.push_back(Offset);
+    return spCellData->GetType() != Cell::StringType;
+  });
+  BOOST_CHECK(CellOffs.size() == 0x11 && CellOffs.back() == 0x408000);
+}
+
+BOOST_AUTO_TEST_CASE(core_banked_memory_area_test_case)
+{
+  BOOST_MESSAGE("Testing banked memory area");
+
+  using namespace medusa;
+
+  // A 8 MB cartridge with a MBC5 like mapper, only the bank 1 is mapped
+  BankedMemoryArea RomWindow("ROM#", 0x0, 0x4000, Address(Address::BankType, 1, 0x4000, 8, 16), 0x200, MemoryArea::Read | MemoryArea::Execute);
+  BankedMemoryArea::BankRegister const LowReg  = { 0x2000, 0x3000, 0, 0xff, false };
+  BankedMemoryArea::BankRegister const HighReg = { 0x3000, 0x4000, 8, 0x01, false };
+  RomWindow.AddBankRegister(LowReg);
+  RomWindow.AddBankRegister(HighReg);
+  BOOST_CHECK(RomWindow.GetName() == "ROM#01");
+  BOOST_CHECK(RomWindow.GetFileOffset() == 0x4000);
+  BOOST_CHECK(RomWindow.IsCellPresent(Address(Address::BankType, 1, 0x5000, 8, 16)));
+  BOOST_CHECK(!RomWindow.IsCellPresent(Address(Address::BankType, 2, 0x5000, 8, 16)));
+
+  // Writes to registers select a bank, other writes are ignored
+  TBank Bank = 1;
+  BOOST_CHECK(RomWindow.SelectBank(0x2000, 0x34, Bank) && Bank == 0x34);
+  BOOST_CHECK(RomWindow.SelectBank(0x3000, 0x01, Bank) && Bank == 0x134);
+  BOOST_CHECK(RomWindow.SelectBank(0x2fff, 0x00, Bank) && Bank == 0x100);
+  BOOST_CHECK(!RomWindow.SelectBank(0x1000, 0x05, Bank) && Bank == 0x100);
+
+  // Only addresses in the window depend on the selected bank
+  BOOST_CHECK(RomWindow.ResolveAddress(Address(Address::BankType, 0, 0x4123, 8, 16), Bank) == Address(Address::BankType, 0x100, 0x4123, 8, 16));
+  BOOST_CHECK(RomWindow.ResolveAddress(Address(Address::BankType, 5, 0x0150, 8, 16), Bank) == Address(Address::BankType, 0, 0x0150, 8, 16));
+
+  // Banks are contiguous in the file
+  std::unique_ptr<MemoryArea> upBankMemArea(RomWindow.MakeBankMemoryArea(0x1ff));
+  BOOST_REQUIRE(upBankMemArea != nullptr);
+  BOOST_CHECK(upBankMemArea->GetName() == "ROM#1ff");
+  BOOST_CHECK(upBankMemArea->GetFileOffset() == 0x1ff * 0x4000);
+  BOOST_CHECK(upBankMemArea->GetBaseAddress() == Address(Address::BankType, 0x1ff, 0x4000, 8, 16));
+  BOOST_CHECK(RomWindow.MakeBankMemoryArea(1) == nullptr);
+  BOOST_CHECK(RomWindow.MakeBankMemoryArea(0x200) == nullptr);
+
+  // MBC1 never selects the bank 0
+  BankedMemoryArea Mbc1Window("ROM#", 0x0, 0x4000, Address(Address::BankType, 1, 0x4000, 8, 16), 0x80, MemoryArea::Read | MemoryArea::Execute);
+  BankedMemoryArea::BankRegister const Mbc1Reg = { 0x2000, 0x4000, 0, 0x1f, true };
+  Mbc1Window.AddBankRegister(Mbc1Reg);
+  Bank = 5;
+  BOOST_CHECK(Mbc1Window.SelectBank(0x2100, 0x00, Bank) && Bank == 1);
+}
+
+BOOST_AUTO_TEST_CASE(core_print_data_test_case)
+{
+  BOOST_MESSAGE("Testing print data");
+
+  using namespace medusa;
+
+  auto FormatLines = [](PrintData& rPrintData, u32 AddrNo)
+  {
+    for (u32 i = 0; i < AddrNo; ++i)
+    {
+      rPrintData(Address(0x1000 + i * 4));
+      rPrintData.AppendMnemonic("mov").MarkOffset().AppendRegister("eax").AppendOperator(",").AppendSpace()
+        .MarkOffset().AppendImmediate(i, 32).AppendNewLine();
+      rPrintData.AppendComment("; comment").AppendNewLine();
+    }
+  };
+
+  PrintData Print;
+  FormatLines(Print, 2);
+  BOOST_CHECK(Print.GetNumberOfLines() == 4);
+  BOOST_CHECK(Print.GetTexts() ==
+    "0000000000001000  mov             eax, 0x00000000\n"
+    "0000000000001000  ; comment\n"
+    "0000000000001004  mov             eax, 0x00000001\n"
+    "0000000000001004  ; comment\n");
+  BOOST_CHECK(Print.GetCurrentText().empty());
+  BOOST_CHECK(Print.GetLineNo(Address(0x1004)) == 2);
+
+  // Each line only sees its own text, marks and operands
+  u32 LineNo = 0;
+  Print.ForEachLine([&](Address const& rAddr, TextView const& rText, Mark::View const& rMarks)
+  {
+    u32 MarkLen = 0;
+    for (auto const& rMark : rMarks)
+      MarkLen += rMark.GetLength();
+    BOOST_CHECK(MarkLen == rText.length());
+    BOOST_CHECK(rText[rText.length() - 1] == '\n');
+    ++LineNo;
+  });
+  BOOST_CHECK(LineNo == 4);
+
+  u16 Off;
+  LineData Line;
+  BOOST_REQUIRE(Print.GetLine(3, Off, Line));
+  BOOST_CHECK(Off == 1 && Line.GetAddress() == Address(0x1004));
+  BOOST_CHECK(Line.GetText() == "0000000000001004  ; comment\n");
+
+  u8 OprdNo;
+  BOOST_CHECK(Print.GetOperandNo(Address(0x1004), 34, 0, OprdNo) && OprdNo == 0);
+  BOOST_CHECK(Print.GetOperandNo(Address(0x1004), 40, 0, OprdNo) && OprdNo == 1);
+  BOOST_CHECK(!Print.GetOperandNo(Address(0x1004), 4, 1, OprdNo));
+
+  Print.Clear();
+  Print.PrependAddress(false);
+  Print.AppendImmediate(5, 4, 2).AppendSpace().AppendImmediate(10, 8, 10).AppendSpace().AppendImmediate(8, 6, 8).AppendNewLine();
+  BOOST_CHECK(Print.GetTexts() == "0b0101 10 010\n");
+
+  // Arenas are reused after the first iteration, only the lines of the last one remain
+  u32 const AddrNo = 0x1000, IterNo = 0x10;
+  for (u32 i = 0; i < IterNo; ++i)
+  {
+    Print.Clear();
+    FormatLines(Print, AddrNo);
+  }
+  BOOST_CHECK(Print.GetNumberOfLines() == AddrNo * 2);
+  BOOST_CHECK(Print.GetHeight() == AddrNo * 2);
+
+  PrintData OnePass;
+  OnePass.PrependAddress(false);
+  FormatLines(OnePass, AddrNo);
+  BOOST_CHECK(Print.GetTexts() == OnePass.GetTexts());
+  BOOST_CHECK(Print.GetMarks().size() == OnePass.GetMarks().size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
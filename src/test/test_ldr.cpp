@@ -1,9 +1,536 @@
 #define BOOST_TEST_MODULE TestLoader
-#include <boost/test/unit_test.hpp> 
+#include <boost/test/unit_test.hpp>
 
+#include <medusa/medusa.hpp>
 #include <medusa/loader.hpp>
 #include <medusa/module.hpp>
 
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+
+namespace
+{
+  // Loaders are tested with the text database and the x86 architecture, all modules are built next to
+  // the test executable
+  medusa::Path GetModulePath(void)
+  {
+    auto const& rMstSuite = boost::unit_test::framework::master_test_suite();
+    if (rMstSuite.argc == 0)
+      return ".";
+    auto ExeDir = medusa::Path(rMstSuite.argv[0]).parent_path();
+    return ExeDir.empty() ? medusa::Path(".") : ExeDir;
+  }
+
+  //! ImageWriter builds a little-endian image, it grows when a value is written past its end.
+  class ImageWriter
+  {
+  public:
+    template<typename Type> void Write(medusa::TOffset Offset, Type Value)
+    {
+      _Grow(Offset + sizeof(Value));
+      auto UValue = static_cast<medusa::u64>(Value);
+      for (size_t i = 0; i < sizeof(Value); ++i)
+        m_Data[static_cast<size_t>(Offset + i)] = static_cast<medusa::u8>(UValue >> (i * 8));
+    }
+
+    //! This method is used by big-endian headers (e.g. Mach-O universal binaries).
+    template<typename Type> void WriteBigEndian(medusa::TOffset Offset, Type Value)
+    {
+      _Grow(Offset + sizeof(Value));
+      auto UValue = static_cast<medusa::u64>(Value);
+      for (size_t i = 0; i < sizeof(Value); ++i)
+        m_Data[static_cast<size_t>(Offset + sizeof(Value) - 1 - i)] = static_cast<medusa::u8>(UValue >> (i * 8));
+    }
+
+    void Write(medusa::TOffset Offset, std::string const& rStr)
+    {
+      _Grow(Offset + rStr.size() + 1);
+      std::copy(std::begin(rStr), std::end(rStr), std::begin(m_Data) + static_cast<size_t>(Offset));
+    }
+
+    void Fill(medusa::TOffset Offset, medusa::u64 Size, medusa::u8 Byte)
+    {
+      _Grow(Offset + Size);
+      std::fill_n(std::begin(m_Data) + static_cast<size_t>(Offset), static_cast<size_t>(Size), Byte);
+    }
+
+    //! This method returns the offset of Size new bytes aligned on 0x10.
+    medusa::TOffset Reserve(medusa::u64 Size)
+    {
+      medusa::TOffset Offset = (m_Data.size() + 0xf) & ~0xfULL;
+      _Grow(Offset + Size);
+      return Offset;
+    }
+
+    std::vector<medusa::u8> const& GetData(void) const { return m_Data; }
+
+  private:
+    void _Grow(medusa::u64 Size)
+    {
+      if (m_Data.size() < Size)
+        m_Data.resize(static_cast<size_t>(Size));
+    }
+
+    std::vector<medusa::u8> m_Data;
+  };
+
+  //! LoadedDocument maps an image with a loader module, the database is removed when it's destroyed.
+  struct LoadedDocument
+  {
+    ~LoadedDocument(void)
+    {
+      m_Core.WaitForTasks();
+      m_Core.CloseDocument();
+      if (!m_DbPath.empty())
+        boost::filesystem::remove(m_DbPath);
+    }
+
+    //! Configure is called once the loader has parsed the headers, so it can change its options.
+    bool Open(std::vector<medusa::u8> const& rImage, std::string const& rLdrName,
+      std::function<void (medusa::ConfigurationModel&)> Configure = nullptr)
+    {
+      using namespace medusa;
+
+      auto& rModMgr = ModuleManager::Instance();
+      auto pGetDb   = rModMgr.LoadModule<TGetDatabase>(GetModulePath(), "text");
+      auto pGetArch = rModMgr.LoadModule<TGetArchitecture>(GetModulePath(), "x86");
+      auto pGetLdr  = rModMgr.LoadModule<TGetLoader>(GetModulePath(), rLdrName);
+      if (pGetDb == nullptr || pGetArch == nullptr || pGetLdr == nullptr)
+        return false;
+
+      Database::SPType spDb(pGetDb());
+      Architecture::SPType spArch(pGetArch());
+      Loader::SPType spLdr(pGetLdr());
+      m_spBinStrm = std::make_shared<MemoryBinaryStream>(rImage.data(), rImage.size());
+      if (!spLdr->IsCompatible(*m_spBinStrm))
+        return false;
+      if (Configure)
+        Configure(spLdr->GetConfigurationModel());
+
+      m_DbPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+      if (!spDb->Create(m_DbPath, true))
+        return false;
+
+      // Registering the architecture updates its tag, so it's done before the loader uses it
+      if (!rModMgr.RegisterArchitecture(spArch))
+        return false;
+      Architecture::VSPType Archs(1, spArch);
+      spLdr->FilterAndConfigureArchitectures(Archs);
+      if (Archs.empty() || !m_Core.Start(m_spBinStrm, spDb, spLdr, Archs, OperatingSystem::SPType()))
+        return false;
+      m_Core.WaitForTasks();
+      return true;
+    }
+
+    medusa::Document& GetDocument(void) { return m_Core.GetDocument(); }
+
+    //! This method returns the original byte of the image, before the loader patched it.
+    medusa::u8 GetOriginalByte(medusa::TOffset Offset) const
+    { return static_cast<medusa::u8 const*>(m_spBinStrm->GetBuffer())[Offset]; }
+
+    medusa::Medusa               m_Core;
+    medusa::BinaryStream::SPType m_spBinStrm;
+    medusa::Path                 m_DbPath;
+  };
+
+  // ELF values used by the generated images
+  enum
+  {
+    ElfPtLoad = 1, ElfPtDynamic = 2,
+    ElfDtNull = 0, ElfDtHash = 4, ElfDtStrTab = 5, ElfDtSymTab = 6, ElfDtRela = 7, ElfDtRelaSz = 8,
+    ElfDtRelaEnt = 9, ElfDtStrSz = 10, ElfDtSymEnt = 11, ElfDtGnuHash = 0x6ffffef5,
+    ElfR64 = 1, ElfRPc32 = 2, ElfRGlobDat = 6, ElfRRelative = 8,
+  };
+
+  //! ElfImage is an x86-64 shared object without section, its symbols are only counted by a hash table.
+  //! Symbol 1 is imported, others are exported objects, relocations are written in 4 slots.
+  struct ElfImage
+  {
+    enum : medusa::u64
+    {
+      ImageBase = 0x400000,
+      SymNo     = 0x4800, // more than a chunk of the loader
+    };
+
+    ElfImage(bool UseGnuHash)
+    {
+      using namespace medusa;
+
+      // Headers and dynamic entries
+      TOffset const PhdrOff = 0x40, DynOff = 0x100;
+      m_Writer.Reserve(0x200);
+
+      // Symbols and their names
+      TOffset const SymOff = m_Writer.Reserve(SymNo * 0x18);
+      m_ObjOff = m_Writer.Reserve(SymNo * 4);
+      std::string Strings(1, '\0');
+      for (u64 SymIdx = 1; SymIdx < SymNo; ++SymIdx)
+      {
+        TOffset CurSymOff = SymOff + SymIdx * 0x18;
+        m_Writer.Write(CurSymOff, static_cast<u32>(Strings.size()));
+        m_Writer.Write(CurSymOff + 4, static_cast<u8>(0x11)); // global object
+        Strings += GetSymbolName(SymIdx);
+        Strings += '\0';
+        if (SymIdx == 1)
+          continue;
+        m_Writer.Write(CurSymOff + 6, static_cast<u16>(1));
+        m_Writer.Write(CurSymOff + 8, GetSymbolAddress(SymIdx));
+      }
+      TOffset const StrTblOff = m_Writer.Reserve(Strings.size());
+      m_Writer.Write(StrTblOff, Strings);
+
+      // DT_HASH only gives the number of symbols, DT_GNU_HASH ends the chain of its last bucket
+      TOffset const HashOff = m_Writer.Reserve(8 + (1 + SymNo) * 4);
+      m_Writer.Write(HashOff, static_cast<u32>(1));
+      m_Writer.Write(HashOff + 4, static_cast<u32>(SymNo));
+      u32 const SymBase = 2, MidSymIdx = SymNo / 2;
+      TOffset const GnuHashOff = m_Writer.Reserve(0x10 + 8 + 2 * 4 + (SymNo - SymBase) * 4);
+      m_Writer.Write(GnuHashOff, static_cast<u32>(2));
+      m_Writer.Write(GnuHashOff + 4, SymBase);
+      m_Writer.Write(GnuHashOff + 8, static_cast<u32>(1));
+      m_Writer.Write(GnuHashOff + 0xc, static_cast<u32>(6));
+      TOffset const BucketOff = GnuHashOff + 0x10 + 8;
+      m_Writer.Write(BucketOff, SymBase);
+      m_Writer.Write(BucketOff + 4, MidSymIdx);
+      for (u32 SymIdx = SymBase; SymIdx < SymNo; ++SymIdx)
+      {
+        bool IsLast = (SymIdx == MidSymIdx - 1 || SymIdx == SymNo - 1);
+        m_Writer.Write(BucketOff + 8 + (SymIdx - SymBase) * 4, static_cast<u32>(SymIdx << 1 | (IsLast ? 1 : 0)));
+      }
+
+      // Slots are filled with a pattern, relocations reference the first symbols
+      m_SlotOff = m_Writer.Reserve(0x20);
+      m_Writer.Fill(m_SlotOff, 0x20, 0xcc);
+      TOffset const RelaOff = m_Writer.Reserve(4 * 0x18);
+      u64 const Relas[][3] =
+      {
+        { GetSlotAddress(0), ElfRRelative,                     GetSymbolAddress(2) + 0x10 },
+        { GetSlotAddress(1), 3ULL << 32 | ElfR64,              8                          },
+        { GetSlotAddress(2), 1ULL << 32 | ElfRGlobDat,         0                          },
+        { GetSlotAddress(3), 2ULL << 32 | ElfRPc32,            static_cast<u64>(-4)       },
+      };
+      for (u32 RelaIdx = 0; RelaIdx < 4; ++RelaIdx)
+        for (u32 FieldIdx = 0; FieldIdx < 3; ++FieldIdx)
+          m_Writer.Write(RelaOff + RelaIdx * 0x18 + FieldIdx * 8, Relas[RelaIdx][FieldIdx]);
+
+      u64 const Dyns[][2] =
+      {
+        { ElfDtSymTab,                            ImageBase + SymOff         },
+        { ElfDtSymEnt,                            0x18                       },
+        { ElfDtStrTab,                            ImageBase + StrTblOff      },
+        { ElfDtStrSz,                             Strings.size()             },
+        { UseGnuHash ? ElfDtGnuHash : ElfDtHash,  ImageBase + (UseGnuHash ? GnuHashOff : HashOff) },
+        { ElfDtRela,                              ImageBase + RelaOff        },
+        { ElfDtRelaSz,                            4 * 0x18                   },
+        { ElfDtRelaEnt,                           0x18                       },
+        { ElfDtNull,                              0                          },
+      };
+      u64 const DynNo = sizeof(Dyns) / sizeof(*Dyns);
+      for (u64 DynIdx = 0; DynIdx < DynNo; ++DynIdx)
+      {
+        m_Writer.Write(DynOff + DynIdx * 0x10, Dyns[DynIdx][0]);
+        m_Writer.Write(DynOff + DynIdx * 0x10 + 8, Dyns[DynIdx][1]);
+      }
+
+      // ELF header, the whole image is loaded
+      u64 const ImageSize = m_Writer.GetData().size();
+      m_Writer.Write(0x0, std::string("\x7f" "ELF" "\x02\x01\x01"));
+      m_Writer.Write(0x10, static_cast<u16>(3));  // ET_DYN
+      m_Writer.Write(0x12, static_cast<u16>(62)); // EM_X86_64
+      m_Writer.Write(0x14, static_cast<u32>(1));
+      m_Writer.Write(0x20, PhdrOff);
+      m_Writer.Write(0x34, static_cast<u16>(0x40));
+      m_Writer.Write(0x36, static_cast<u16>(0x38));
+      m_Writer.Write(0x38, static_cast<u16>(2));
+      m_Writer.Write(0x3a, static_cast<u16>(0x40));
+
+      u64 const Phdrs[][6] =
+      {
+        { ElfPtLoad,    0x0,    ImageBase,          ImageSize,    ImageSize,    0x1000 },
+        { ElfPtDynamic, DynOff, ImageBase + DynOff, DynNo * 0x10, DynNo * 0x10, 0x8    },
+      };
+      for (u64 PhdrIdx = 0; PhdrIdx < 2; ++PhdrIdx)
+      {
+        TOffset CurPhdrOff = PhdrOff + PhdrIdx * 0x38;
+        m_Writer.Write(CurPhdrOff, static_cast<u32>(Phdrs[PhdrIdx][0]));
+        m_Writer.Write(CurPhdrOff + 4, static_cast<u32>(6)); // PF_R | PF_W
+        m_Writer.Write(CurPhdrOff + 8, Phdrs[PhdrIdx][1]);
+        m_Writer.Write(CurPhdrOff + 0x10, Phdrs[PhdrIdx][2]);
+        m_Writer.Write(CurPhdrOff + 0x18, Phdrs[PhdrIdx][2]);
+        m_Writer.Write(CurPhdrOff + 0x20, Phdrs[PhdrIdx][3]);
+        m_Writer.Write(CurPhdrOff + 0x28, Phdrs[PhdrIdx][4]);
+        m_Writer.Write(CurPhdrOff + 0x30, Phdrs[PhdrIdx][5]);
+      }
+    }
+
+    static std::string GetSymbolName(medusa::u64 SymIdx)
+    {
+      std::ostringstream Name;
+      Name << "sym_" << std::hex << SymIdx;
+      return Name.str();
+    }
+
+    medusa::u64 GetSymbolAddress(medusa::u64 SymIdx) const { return ImageBase + m_ObjOff + SymIdx * 4; }
+    medusa::u64 GetSlotAddress(medusa::u64 SlotIdx)  const { return ImageBase + m_SlotOff + SlotIdx * 8; }
+    medusa::TOffset GetSlotOffset(medusa::u64 SlotIdx) const { return m_SlotOff + SlotIdx * 8; }
+
+    ImageWriter     m_Writer;
+    medusa::TOffset m_ObjOff;
+    medusa::TOffset m_SlotOff;
+  };
+
+  //! PeImage is an x64 library with a code and a data section, both are stored at their RVA.
+  //! It exports 3 functions (one by ordinal), delay-loads 2 symbols, describes 3 runtime functions
+  //! and relocates 3 pointers.
+  struct PeImage
+  {
+    enum : medusa::u64
+    {
+      PreferredImageBase = 0x140000000ULL,
+      TextRva            = 0x1000,
+      DataRva            = 0x2000,
+      ImageSize          = 0x3000,
+      ExportRva          = 0x2000,
+      DelayImportRva     = 0x2200,
+      DelayIatRva        = 0x22a0,
+      PointerRva         = 0x2300,
+      ExceptionRva       = 0x2400,
+      BaseRelocationRva  = 0x2600,
+    };
+
+    PeImage(void)
+    {
+      using namespace medusa;
+
+      // Headers
+      TOffset const NtHdrOff = 0x80, OptHdrOff = NtHdrOff + 4 + 0x14, ScnOff = OptHdrOff + 0xf0;
+      m_Writer.Write(0x0, std::string("MZ"));
+      m_Writer.Write(0x3c, static_cast<u32>(NtHdrOff));
+      m_Writer.Write(NtHdrOff, std::string("PE"));
+      m_Writer.Write(NtHdrOff + 4, static_cast<u16>(0x8664));  // AMD64
+      m_Writer.Write(NtHdrOff + 6, static_cast<u16>(2));
+      m_Writer.Write(NtHdrOff + 0x14, static_cast<u16>(0xf0));
+      m_Writer.Write(NtHdrOff + 0x16, static_cast<u16>(0x2022)); // DLL
+      m_Writer.Write(OptHdrOff, static_cast<u16>(0x20b));
+      m_Writer.Write(OptHdrOff + 0x10, static_cast<u32>(TextRva + 0x60));
+      m_Writer.Write(OptHdrOff + 0x18, static_cast<u64>(PreferredImageBase));
+      m_Writer.Write(OptHdrOff + 0x20, static_cast<u32>(0x1000));
+      m_Writer.Write(OptHdrOff + 0x24, static_cast<u32>(0x200));
+      m_Writer.Write(OptHdrOff + 0x38, static_cast<u32>(ImageSize));
+      m_Writer.Write(OptHdrOff + 0x3c, static_cast<u32>(0x400));
+      m_Writer.Write(OptHdrOff + 0x6c, static_cast<u32>(0x10));
+      u32 const Dirs[][3] =
+      {
+        { 0,  ExportRva,         0x120 },
+        { 3,  ExceptionRva,      3 * 0xc },
+        { 5,  BaseRelocationRva, 0x10 },
+        { 13, DelayImportRva,    0x20 },
+      };
+      for (auto const& rDir : Dirs)
+      {
+        m_Writer.Write(OptHdrOff + 0x70 + rDir[0] * 8, rDir[1]);
+        m_Writer.Write(OptHdrOff + 0x70 + rDir[0] * 8 + 4, rDir[2]);
+      }
+
+      struct { char const* m_pName; u32 m_Rva; u32 m_Characteristics; } const Scns[] =
+      {
+        { ".text", TextRva, 0x60000020 },
+        { ".data", DataRva, 0xc0000040 },
+      };
+      for (u32 ScnIdx = 0; ScnIdx < 2; ++ScnIdx)
+      {
+        TOffset CurScnOff = ScnOff + ScnIdx * 0x28;
+        m_Writer.Write(CurScnOff, std::string(Scns[ScnIdx].m_pName));
+        m_Writer.Write(CurScnOff + 0x8, static_cast<u32>(0x1000));
+        m_Writer.Write(CurScnOff + 0xc, Scns[ScnIdx].m_Rva);
+        m_Writer.Write(CurScnOff + 0x10, static_cast<u32>(0x1000));
+        m_Writer.Write(CurScnOff + 0x14, Scns[ScnIdx].m_Rva);
+        m_Writer.Write(CurScnOff + 0x24, Scns[ScnIdx].m_Characteristics);
+      }
+
+      // Every function returns at once, 0x1030 is the stub of delay-loaded symbols
+      m_Writer.Fill(TextRva, 0x1000, 0xcc);
+      for (u32 FuncRva : { 0x1000, 0x1010, 0x1020, 0x1030, 0x1040, 0x1048, 0x1050, 0x1060 })
+        m_Writer.Write(FuncRva, static_cast<u8>(0xc3));
+      m_Writer.Fill(DataRva, 0x1000, 0x0);
+
+      // Names are sorted, their ordinals don't follow them, 0x1010 is only exported by ordinal
+      m_Writer.Write(ExportRva + 0xc, static_cast<u32>(0x2100));
+      m_Writer.Write(ExportRva + 0x10, static_cast<u32>(5));
+      m_Writer.Write(ExportRva + 0x14, static_cast<u32>(3));
+      m_Writer.Write(ExportRva + 0x18, static_cast<u32>(2));
+      m_Writer.Write(ExportRva + 0x1c, static_cast<u32>(0x2040));
+      m_Writer.Write(ExportRva + 0x20, static_cast<u32>(0x2060));
+      m_Writer.Write(ExportRva + 0x24, static_cast<u32>(0x2070));
+      u32 const FuncRvas[] = { 0x1000, 0x1010, 0x1020 };
+      for (u32 FuncIdx = 0; FuncIdx < 3; ++FuncIdx)
+        m_Writer.Write(0x2040 + FuncIdx * 4, FuncRvas[FuncIdx]);
+      m_Writer.Write(0x2060, static_cast<u32>(0x2110));
+      m_Writer.Write(0x2064, static_cast<u32>(0x2118));
+      m_Writer.Write(0x2070, static_cast<u16>(2));
+      m_Writer.Write(0x2072, static_cast<u16>(0));
+      m_Writer.Write(0x2100, std::string("test.dll"));
+      m_Writer.Write(0x2110, std::string("alpha"));
+      m_Writer.Write(0x2118, std::string("beta"));
+
+      // Delay-loaded symbols are imported by name and by ordinal, their slots point to the stub
+      m_Writer.Write(DelayImportRva, static_cast<u32>(1)); // RVA based
+      m_Writer.Write(DelayImportRva + 0x4, static_cast<u32>(0x2280));
+      m_Writer.Write(DelayImportRva + 0x8, static_cast<u32>(0x2290));
+      m_Writer.Write(DelayImportRva + 0xc, static_cast<u32>(DelayIatRva));
+      m_Writer.Write(DelayImportRva + 0x10, static_cast<u32>(0x22c0));
+      m_Writer.Write(0x2280, std::string("DELAY.dll"));
+      m_Writer.Write(DelayIatRva, static_cast<u64>(PreferredImageBase + 0x1030));
+      m_Writer.Write(DelayIatRva + 8, static_cast<u64>(PreferredImageBase + 0x1030));
+      m_Writer.Write(0x22c0, static_cast<u64>(0x22e0));
+      m_Writer.Write(0x22c8, static_cast<u64>(0x8000000000000007ULL));
+      m_Writer.Write(0x22e2, std::string("Sleep"));
+
+      // 0x1048 is a part of 0x1040, 0x1050 refers to the entry of 0x1040
+      u32 const RtFuncs[][3] =
+      {
+        { 0x1000, 0x1001, 0x2500     },
+        { 0x1040, 0x1048, 0x2500     },
+        { 0x1048, 0x1049, 0x2510     },
+        { 0x1050, 0x1051, 0x2400 | 1 },
+      };
+      for (u32 RtFuncIdx = 0; RtFuncIdx < 4; ++RtFuncIdx)
+        for (u32 FieldIdx = 0; FieldIdx < 3; ++FieldIdx)
+          m_Writer.Write(ExceptionRva + RtFuncIdx * 0xc + FieldIdx * 4, RtFuncs[RtFuncIdx][FieldIdx]);
+      m_Writer.Write(0x2500, static_cast<u8>(0x01));
+      m_Writer.Write(0x2510, static_cast<u8>(0x21)); // UNW_FLAG_CHAININFO
+
+      // The pointer and the delay-load slots are relocated, the last entry is padding
+      m_Writer.Write(PointerRva, static_cast<u64>(PreferredImageBase + 0x1010));
+      m_Writer.Write(BaseRelocationRva, static_cast<u32>(DataRva));
+      m_Writer.Write(BaseRelocationRva + 4, static_cast<u32>(0x10));
+      u16 const Entries[] = { 0xa000 | (PointerRva & 0xfff), 0xa000 | (DelayIatRva & 0xfff), 0xa000 | ((DelayIatRva + 8) & 0xfff), 0x0 };
+      for (u32 EntryIdx = 0; EntryIdx < 4; ++EntryIdx)
+        m_Writer.Write(BaseRelocationRva + 8 + EntryIdx * 2, Entries[EntryIdx]);
+    }
+
+    ImageWriter m_Writer;
+  };
+
+  //! MachOImage is a universal binary with a PowerPC slice, which isn't supported, and an x86 executable.
+  //! The x86 slice has a __text section with 4 functions: one exported, one local and two only known
+  //! from LC_FUNCTION_STARTS, the last one is the entry point.
+  struct MachOImage
+  {
+    enum : medusa::u64
+    {
+      PpcSliceOffset = 0x1000,
+      X86SliceOffset = 0x2000,
+      X86SliceSize   = 0x400,
+      TextVmAddr     = 0x1000,
+      TextOffset     = 0x200, // relative to the slice
+      TextAddr       = TextVmAddr + TextOffset,
+      MainAddr       = TextAddr,
+      UnnamedAddr    = TextAddr + 0x10,
+      EntryAddr      = TextAddr + 0x30,
+      HelperAddr     = TextAddr + 0x40,
+    };
+
+    MachOImage(void)
+    {
+      using namespace medusa;
+
+      // The fat header and its slice descriptions are always big-endian
+      m_Writer.WriteBigEndian(0x0, static_cast<u32>(0xcafebabe));
+      m_Writer.WriteBigEndian(0x4, static_cast<u32>(2));
+      u32 const FatArchs[][5] =
+      {
+        { 18, 0, PpcSliceOffset, 0x1c,         12 }, // CPU_TYPE_POWERPC
+        { 7,  3, X86SliceOffset, X86SliceSize, 12 }, // CPU_TYPE_X86
+      };
+      for (u32 FatArchIdx = 0; FatArchIdx < 2; ++FatArchIdx)
+        for (u32 FieldIdx = 0; FieldIdx < 5; ++FieldIdx)
+          m_Writer.WriteBigEndian(0x8 + FatArchIdx * 0x14 + FieldIdx * 4, FatArchs[FatArchIdx][FieldIdx]);
+
+      // The PowerPC slice is a big-endian executable without load command
+      m_Writer.WriteBigEndian(PpcSliceOffset, static_cast<u32>(0xfeedface));
+      m_Writer.WriteBigEndian(PpcSliceOffset + 0x4, static_cast<u32>(18));
+      m_Writer.WriteBigEndian(PpcSliceOffset + 0xc, static_cast<u32>(2)); // MH_EXECUTE
+
+      // Offsets of the x86 slice are relative to it
+      TOffset const SliceOff = X86SliceOffset;
+      TOffset const SegOff = 0x1c, ThreadOff = SegOff + 0x7c, SymTabOff = ThreadOff + 0x50, FuncStartsOff = SymTabOff + 0x18;
+      TOffset const SymOff = 0x300, StrOff = 0x320, FuncStartsDataOff = 0x340;
+      m_Writer.Write(SliceOff, static_cast<u32>(0xfeedface));
+      m_Writer.Write(SliceOff + 0x4, static_cast<u32>(7));
+      m_Writer.Write(SliceOff + 0x8, static_cast<u32>(3));
+      m_Writer.Write(SliceOff + 0xc, static_cast<u32>(2));
+      m_Writer.Write(SliceOff + 0x10, static_cast<u32>(4));
+      m_Writer.Write(SliceOff + 0x14, static_cast<u32>(FuncStartsOff + 0x10 - SegOff));
+
+      // __TEXT maps the whole slice, it only contains __text
+      m_Writer.Write(SliceOff + SegOff, static_cast<u32>(0x1)); // LC_SEGMENT
+      m_Writer.Write(SliceOff + SegOff + 0x4, static_cast<u32>(0x7c));
+      m_Writer.Write(SliceOff + SegOff + 0x8, std::string("__TEXT"));
+      u32 const SegFields[] = { TextVmAddr, 0x1000, 0x0, X86SliceSize, 7, 5, 1, 0 };
+      for (u32 FieldIdx = 0; FieldIdx < 8; ++FieldIdx)
+        m_Writer.Write(SliceOff + SegOff + 0x18 + FieldIdx * 4, SegFields[FieldIdx]);
+      TOffset const ScnOff = SliceOff + SegOff + 0x38;
+      m_Writer.Write(ScnOff, std::string("__text"));
+      m_Writer.Write(ScnOff + 0x10, std::string("__TEXT"));
+      u32 const ScnFields[] = { TextAddr, 0x100, TextOffset, 0, 0, 0, 0x80000400 }; // S_ATTR_(PURE|SOME)_INSTRUCTIONS
+      for (u32 FieldIdx = 0; FieldIdx < 7; ++FieldIdx)
+        m_Writer.Write(ScnOff + 0x20 + FieldIdx * 4, ScnFields[FieldIdx]);
+
+      m_Writer.Write(SliceOff + ThreadOff, static_cast<u32>(0x5)); // LC_UNIXTHREAD
+      m_Writer.Write(SliceOff + ThreadOff + 0x4, static_cast<u32>(0x50));
+      m_Writer.Write(SliceOff + ThreadOff + 0x8, static_cast<u32>(1)); // x86_THREAD_STATE32
+      m_Writer.Write(SliceOff + ThreadOff + 0xc, static_cast<u32>(16));
+      m_Writer.Write(SliceOff + ThreadOff + 0x10 + 10 * 4, static_cast<u32>(EntryAddr)); // eip
+
+      m_Writer.Write(SliceOff + SymTabOff, static_cast<u32>(0x2)); // LC_SYMTAB
+      m_Writer.Write(SliceOff + SymTabOff + 0x4, static_cast<u32>(0x18));
+      m_Writer.Write(SliceOff + SymTabOff + 0x8, static_cast<u32>(SymOff));
+      m_Writer.Write(SliceOff + SymTabOff + 0xc, static_cast<u32>(2));
+      m_Writer.Write(SliceOff + SymTabOff + 0x10, static_cast<u32>(StrOff));
+      m_Writer.Write(SliceOff + SymTabOff + 0x14, static_cast<u32>(0xf));
+
+      m_Writer.Write(SliceOff + FuncStartsOff, static_cast<u32>(0x26)); // LC_FUNCTION_STARTS
+      m_Writer.Write(SliceOff + FuncStartsOff + 0x4, static_cast<u32>(0x10));
+      m_Writer.Write(SliceOff + FuncStartsOff + 0x8, static_cast<u32>(FuncStartsDataOff));
+      m_Writer.Write(SliceOff + FuncStartsOff + 0xc, static_cast<u32>(8));
+
+      // Every function returns at once
+      m_Writer.Fill(SliceOff + TextOffset, 0x100, 0xcc);
+      for (u64 FuncAddr : { MainAddr, UnnamedAddr, EntryAddr, HelperAddr })
+        m_Writer.Write(SliceOff + FuncAddr - TextVmAddr, static_cast<u8>(0xc3));
+
+      // _main is external, _helper is local and isn't listed in function starts
+      struct { u32 m_StrIdx; u8 m_Type; u32 m_Value; } const Syms[] =
+      {
+        { 1, 0xf, MainAddr   }, // N_SECT | N_EXT
+        { 7, 0xe, HelperAddr }, // N_SECT
+      };
+      for (u32 SymIdx = 0; SymIdx < 2; ++SymIdx)
+      {
+        TOffset CurSymOff = SliceOff + SymOff + SymIdx * 0xc;
+        m_Writer.Write(CurSymOff, Syms[SymIdx].m_StrIdx);
+        m_Writer.Write(CurSymOff + 0x4, Syms[SymIdx].m_Type);
+        m_Writer.Write(CurSymOff + 0x5, static_cast<u8>(1));
+        m_Writer.Write(CurSymOff + 0x8, Syms[SymIdx].m_Value);
+      }
+      m_Writer.Write(SliceOff + StrOff + 1, std::string("_main"));
+      m_Writer.Write(SliceOff + StrOff + 7, std::string("_helper"));
+
+      // ULEB128 deltas from __TEXT: 0x200, 0x10 and 0x20, then the end of the list
+      u8 const FuncStarts[] = { 0x80, 0x04, 0x10, 0x20, 0x00 };
+      for (u32 Idx = 0; Idx < sizeof(FuncStarts); ++Idx)
+        m_Writer.Write(SliceOff + FuncStartsDataOff + Idx, FuncStarts[Idx]);
+      m_Writer.Fill(SliceOff + X86SliceSize - 1, 1, 0x0);
+    }
+
+    ImageWriter m_Writer;
+  };
+}
+
 BOOST_AUTO_TEST_SUITE(loader_test_suite)
 
 BOOST_AUTO_TEST_CASE(ldr_boot_sector_test_case)
@@ -12,6 +539,48 @@ BOOST_AUTO_TEST_CASE(ldr_boot_sector_test_case)
 
 BOOST_AUTO_TEST_CASE(ldr_elf_test_case)
 {
+  BOOST_MESSAGE("Testing ELF loader");
+
+  using namespace medusa;
+
+  for (bool UseGnuHash : { false, true })
+  {
+    BOOST_TEST_CHECKPOINT((UseGnuHash ? "DT_GNU_HASH" : "DT_HASH"));
+    ElfImage Image(UseGnuHash);
+    LoadedDocument LoadedDoc;
+    BOOST_REQUIRE(LoadedDoc.Open(Image.m_Writer.GetData(), "elf"));
+    auto& rDoc = LoadedDoc.GetDocument();
+    auto MakeAddress = [](u64 Offset) { return Address(Address::FlatType, 0x0, Offset, 0x10, 64); };
+
+    // All symbols are counted with the hash table, and labeled by chunks
+    u64 ExportNo = 0;
+    rDoc.ForEachLabel([&](Address const& rAddr, Label const& rLbl)
+    {
+      if (rLbl.GetType() & Label::Exported)
+        ++ExportNo;
+    });
+    BOOST_CHECK(ExportNo == ElfImage::SymNo - 2);
+    u64 const SymIdxs[] = { 2, 0x4000, ElfImage::SymNo - 1 };
+    for (u64 SymIdx : SymIdxs)
+      BOOST_CHECK(rDoc.GetAddressFromLabelName(ElfImage::GetSymbolName(SymIdx)).GetOffset() == Image.GetSymbolAddress(SymIdx));
+
+    // Relocations are applied to the patch overlay, the original image is untouched
+    auto const& rBinStrm = rDoc.GetBinaryStream();
+    u64 Slot;
+    u32 PcSlot;
+    BOOST_CHECK(rBinStrm.Read(Image.GetSlotOffset(0), Slot) && Slot == Image.GetSymbolAddress(2) + 0x10);
+    BOOST_CHECK(rBinStrm.Read(Image.GetSlotOffset(1), Slot) && Slot == Image.GetSymbolAddress(3) + 8);
+    BOOST_CHECK(rBinStrm.Read(Image.GetSlotOffset(2), Slot) && Slot == 0xccccccccccccccccULL);
+    BOOST_CHECK(rBinStrm.Read(Image.GetSlotOffset(3), PcSlot) && PcSlot == static_cast<u32>(Image.GetSymbolAddress(2) - 4 - Image.GetSlotAddress(3)));
+    BOOST_CHECK(LoadedDoc.GetOriginalByte(Image.GetSlotOffset(0)) == 0xcc);
+
+    // Imported slots are labeled, resolved pointers are referenced
+    auto ImpLbl = rDoc.GetLabelFromAddress(MakeAddress(Image.GetSlotAddress(2)));
+    BOOST_CHECK(ImpLbl.GetName() == ElfImage::GetSymbolName(1) && (ImpLbl.GetType() & Label::Imported));
+    Address XRefTo;
+    BOOST_CHECK(rDoc.GetCrossReferenceTo(MakeAddress(Image.GetSlotAddress(0)), XRefTo));
+    BOOST_CHECK(XRefTo.GetOffset() == Image.GetSymbolAddress(2) + 0x10);
+  }
 }
 
 BOOST_AUTO_TEST_CASE(ldr_gameboy_test_case)
@@ -20,14 +589,92 @@ BOOST_AUTO_TEST_CASE(ldr_gameboy_test_case)
 
 BOOST_AUTO_TEST_CASE(ldr_macho_test_case)
 {
+  BOOST_MESSAGE("Testing Mach-O loader");
+
+  using namespace medusa;
+
+  // The PowerPC slice isn't supported, so the x86 one is selected by default
+  MachOImage Image;
+  LoadedDocument LoadedDoc;
+  BOOST_REQUIRE(LoadedDoc.Open(Image.m_Writer.GetData(), "mach-o", [](ConfigurationModel& rCfgMdl)
+  {
+    BOOST_CHECK(rCfgMdl.GetEnum("Slice") == 1);
+  }));
+  auto& rDoc = LoadedDoc.GetDocument();
+  auto MakeAddress = [](u64 Offset) { return Address(Address::FlatType, 0x0, Offset, 0x10, 32); };
+  auto GetLabel = [&](u64 Offset) { return rDoc.GetLabelFromAddress(MakeAddress(Offset)); };
+
+  // Sections are read from the selected slice
+  auto const pTextArea = rDoc.GetMemoryArea(MakeAddress(MachOImage::TextAddr));
+  BOOST_REQUIRE(pTextArea != nullptr);
+  BOOST_CHECK(pTextArea->GetFileOffset() == MachOImage::X86SliceOffset + MachOImage::TextOffset);
+  BOOST_CHECK(rDoc.GetAddressFromLabelName("start").GetOffset() == MachOImage::EntryAddr);
+
+  // Symbols listed in function starts are functions, the others are only code
+  BOOST_CHECK(GetLabel(MachOImage::MainAddr).GetName() == "_main");
+  BOOST_CHECK((GetLabel(MachOImage::MainAddr).GetType() & Label::CellMask) == Label::Function);
+  BOOST_CHECK(GetLabel(MachOImage::MainAddr).GetType() & Label::Exported);
+  BOOST_CHECK(GetLabel(MachOImage::HelperAddr).GetName() == "_helper");
+  BOOST_CHECK((GetLabel(MachOImage::HelperAddr).GetType() & Label::CellMask) == Label::Code);
+  BOOST_CHECK(GetLabel(MachOImage::HelperAddr).GetType() & Label::Local);
+
+  // Function starts without symbol are labeled, the entry point keeps its name
+  BOOST_CHECK((GetLabel(MachOImage::UnnamedAddr).GetType() & Label::CellMask) == Label::Function);
+  BOOST_CHECK(GetLabel(MachOImage::EntryAddr).GetName() == "start");
 }
 
 BOOST_AUTO_TEST_CASE(ldr_pe_test_case)
 {
+  BOOST_MESSAGE("Testing PE loader");
+
+  using namespace medusa;
+
+  // The image is loaded at its preferred base, then rebased
+  PeImage Image;
+  u64 const ImageBases[] = { PeImage::PreferredImageBase, 0x180000000ULL };
+  for (u64 ImageBase : ImageBases)
+  {
+    BOOST_TEST_CHECKPOINT("image base " << std::hex << ImageBase);
+    LoadedDocument LoadedDoc;
+    BOOST_REQUIRE(LoadedDoc.Open(Image.m_Writer.GetData(), "pe", [&](ConfigurationModel& rCfgMdl)
+    {
+      BOOST_CHECK(rCfgMdl.GetUint64("Image base") == PeImage::PreferredImageBase);
+      rCfgMdl.SetUint64("Image base", ImageBase);
+    }));
+    auto& rDoc = LoadedDoc.GetDocument();
+    auto MakeAddress = [&](u64 Rva) { return Address(Address::FlatType, 0x0, ImageBase + Rva, 0x10, 64); };
+    auto GetLabel = [&](u64 Rva) { return rDoc.GetLabelFromAddress(MakeAddress(Rva)); };
+
+    // Names are matched with their ordinal, the unnamed export is named after its biased ordinal
+    BOOST_CHECK(GetLabel(0x1000).GetName() == "beta");
+    BOOST_CHECK(GetLabel(0x1010).GetName() == "ord_6");
+    BOOST_CHECK(GetLabel(0x1020).GetName() == "alpha");
+    BOOST_CHECK(GetLabel(0x1020).GetType() & Label::Exported);
+
+    // Delay-loaded slots are imported, they reference the rebased stub
+    BOOST_CHECK(GetLabel(PeImage::DelayIatRva).GetName() == "delay.dll!Sleep");
+    BOOST_CHECK(GetLabel(PeImage::DelayIatRva + 8).GetName() == "delay.dll!ordinal_7");
+    BOOST_CHECK(GetLabel(PeImage::DelayIatRva).GetType() & Label::Imported);
+    Address XRefTo;
+    BOOST_CHECK(rDoc.GetCrossReferenceTo(MakeAddress(PeImage::DelayIatRva + 8), XRefTo));
+    BOOST_CHECK(XRefTo.GetOffset() == ImageBase + 0x1030);
+
+    // Runtime functions start functions, unless they're chained or an export already named them
+    BOOST_CHECK((GetLabel(0x1040).GetType() & Label::CellMask) == Label::Function);
+    BOOST_CHECK(GetLabel(0x1048).GetType() == Label::Unknown);
+    BOOST_CHECK(GetLabel(0x1050).GetType() == Label::Unknown);
+
+    // Relocated pointers are moved in the patch overlay and referenced
+    u64 Pointer;
+    BOOST_CHECK(rDoc.GetBinaryStream().Read(PeImage::PointerRva, Pointer) && Pointer == ImageBase + 0x1010);
+    BOOST_CHECK(LoadedDoc.GetOriginalByte(PeImage::PointerRva + 3) == 0x40);
+    BOOST_CHECK(rDoc.GetCrossReferenceTo(MakeAddress(PeImage::PointerRva), XRefTo));
+    BOOST_CHECK(XRefTo.GetOffset() == ImageBase + 0x1010);
+  }
 }
 
 BOOST_AUTO_TEST_CASE(ldr_raw_test_case)
 {
 }
 
-BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
+BOOST_AUTO_TEST_SUITE_END()
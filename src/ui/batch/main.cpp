@@ -0,0 +1,147 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <exception>
+#include <stdexcept>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/program_options.hpp>
+
+#include <medusa/batch.hpp>
+#include <medusa/log.hpp>
+#include <medusa/user_configuration.hpp>
+
+MEDUSA_NAMESPACE_USE
+
+void TextLog(std::string const & rMsg)
+{
+  std::cerr << rMsg << std::flush;
+}
+
+void QuietLog(std::string const & rMsg)
+{
+}
+
+int main(int argc, char **argv)
+{
+  namespace fs = boost::filesystem;
+  std::vector<fs::path> input_paths;
+  fs::path mod_path;
+  fs::path out_path;
+  fs::path sig_path;
+  std::string db_name;
+  u32 jobs = 0;
+  u32 mem_limit = 0;
+  u32 timeout = 0;
+  u32 stream_budget = 0;
+
+  namespace po = boost::program_options;
+  po::options_description desc("Allowed options");
+  desc.add_options()
+    ("help,h", "produce help message")
+    ("input", po::value<std::vector<fs::path>>(&input_paths)->required(), "files to analyze, directories are walked recursively")
+    ("db-module", po::value<std::string>(&db_name), "name of the database module used to save results (default: the first one)")
+    ("out", po::value<fs::path>(&out_path), "directory of databases (default: next to each file)")
+    ("jobs,j", po::value<u32>(&jobs), "number of documents analyzed at once (default: number of cores)")
+    ("memory-limit", po::value<u32>(&mem_limit), "skip documents which would use more than this number of MB")
+    ("timeout", po::value<u32>(&timeout), "stop the analysis of a document after this number of seconds")
+    ("stream", po::value<u32>(&stream_budget), "analyze raw images by windows, using about this number of MB for each document")
+    ("signatures", po::value<fs::path>(&sig_path), "name known functions of every document with this signature file")
+    ("modules", po::value<fs::path>(&mod_path), "path of modules")
+    ("verbose,v", "print the log of modules and of the analysis")
+    ;
+  po::positional_options_description pos_desc;
+  pos_desc.add("input", -1);
+  po::variables_map var_map;
+
+  UserConfiguration usr_cfg;
+  std::string mod_path_opt;
+  if (!usr_cfg.GetOption("core.modules_path", mod_path_opt))
+    mod_path = ".";
+  else
+    mod_path = mod_path_opt;
+
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(pos_desc).run(), var_map);
+
+    if (var_map.count("help"))
+    {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+
+    // notify function must be called AFTER we checked the argument ``help''
+    po::notify(var_map);
+
+    // Workers log at the same time, so the log is only printed on demand
+    Log::SetLog(var_map.count("verbose") ? TextLog : QuietLog);
+
+    std::vector<fs::path> file_paths;
+    for (auto const& input_path : input_paths)
+    {
+      if (!fs::is_directory(input_path))
+      {
+        file_paths.push_back(input_path);
+        continue;
+      }
+      for (fs::recursive_directory_iterator it(input_path), end; it != end; ++it)
+        if (fs::is_regular_file(it->status()))
+          file_paths.push_back(it->path());
+    }
+    if (file_paths.empty())
+      throw std::runtime_error("no file to analyze");
+
+    if (!out_path.empty() && !fs::is_directory(out_path) && !fs::create_directories(out_path))
+      throw std::runtime_error("unable to create the output directory");
+
+    BatchAnalyzer batch(mod_path);
+    if (!batch.IsReady())
+      throw std::runtime_error("unable to load modules from \"" + mod_path.string() + "\"");
+
+    batch.SetDatabaseName(db_name);
+    batch.SetOutputDirectory(out_path);
+    batch.SetWorkerNo(jobs);
+    batch.SetMemoryLimit(static_cast<u64>(mem_limit) * 1024 * 1024);
+    batch.SetTimeout(timeout);
+    batch.SetStreamingBudget(static_cast<u64>(stream_budget) * 1024 * 1024);
+    if (!sig_path.empty() && !batch.SetSignatures(sig_path))
+      throw std::runtime_error("unable to load signatures from \"" + sig_path.string() + "\"");
+
+    BatchAnalyzer::ResultVector results;
+    auto report = batch.Run(file_paths, results, [](BatchAnalyzer::Result const& rResult)
+    {
+      std::cout
+        << std::setw(12) << std::left << BatchAnalyzer::GetStatusName(rResult.m_Status)
+        << std::setw(8)  << std::right << rResult.m_Elapsed << "ms "
+        << rResult.m_FilePath.string();
+      if (!rResult.m_LoaderName.empty())
+        std::cout << " (" << rResult.m_LoaderName << ")";
+      if (!rResult.m_Error.empty())
+        std::cout << ": " << rResult.m_Error;
+      std::cout << std::endl;
+    });
+
+    std::cout
+      << report.m_AnalyzedNo << "/" << report.m_FileNo << " file(s) analyzed, "
+      << report.m_FailedNo << " failed, "
+      << report.m_Size << " byte(s) in " << report.m_Elapsed << "ms: "
+      << std::fixed << std::setprecision(2)
+      << report.GetFilesPerSecond() << " files/s, "
+      << report.GetMegaBytesPerSecond() << " MB/s"
+      << std::endl;
+
+    return report.m_FailedNo == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+  }
+  catch (Exception& e)
+  {
+    std::cerr << e.What() << std::endl;
+  }
+
+  return EXIT_FAILURE;
+}
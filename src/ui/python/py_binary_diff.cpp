@@ -0,0 +1,65 @@
+#include "py_binary_diff.hpp"
+
+#include <sstream>
+
+#include <boost/python.hpp>
+
+#include <medusa/binary_diff.hpp>
+
+namespace bp = boost::python;
+
+MEDUSA_NAMESPACE_USE;
+
+namespace pydusa
+{
+  static bp::list BinaryDiff_GetMatches(BinaryDiff* pDiff)
+  {
+    bp::list Matches;
+    for (auto const& rMatch : pDiff->GetMatches())
+      Matches.append(bp::make_tuple(rMatch.m_OldAddress, rMatch.m_NewAddress, rMatch.m_Similarity, rMatch.m_Type));
+    return Matches;
+  }
+
+  static bp::list BinaryDiff_GetUnmatchedOldFunctions(BinaryDiff* pDiff)
+  {
+    bp::list Funcs;
+    for (auto const& rAddr : pDiff->GetUnmatchedOldFunctions())
+      Funcs.append(rAddr);
+    return Funcs;
+  }
+
+  static bp::list BinaryDiff_GetUnmatchedNewFunctions(BinaryDiff* pDiff)
+  {
+    bp::list Funcs;
+    for (auto const& rAddr : pDiff->GetUnmatchedNewFunctions())
+      Funcs.append(rAddr);
+    return Funcs;
+  }
+
+  static std::string BinaryDiff_Report(BinaryDiff* pDiff)
+  {
+    std::ostringstream oss;
+    pDiff->Report(oss);
+    return oss.str();
+  }
+}
+
+void PydusaBinaryDiff(void)
+{
+  bp::enum_<BinaryDiff::MatchType>("MatchType")
+    .value("ExactMatch",      BinaryDiff::ExactMatch)
+    .value("StructuralMatch", BinaryDiff::StructuralMatch)
+    .value("CallGraphMatch",  BinaryDiff::CallGraphMatch)
+    ;
+
+  bp::class_<BinaryDiff, boost::noncopyable>("BinaryDiff", bp::init<Document&, Document&>()
+    [bp::with_custodian_and_ward<1, 2, bp::with_custodian_and_ward<1, 3> >()])
+    .def("compute",                  &BinaryDiff::Compute)
+    .def("set_structural_threshold", &BinaryDiff::SetStructuralThreshold)
+    .def("set_call_graph_threshold", &BinaryDiff::SetCallGraphThreshold)
+    .add_property("matches",         pydusa::BinaryDiff_GetMatches)
+    .add_property("removed",         pydusa::BinaryDiff_GetUnmatchedOldFunctions)
+    .add_property("added",           pydusa::BinaryDiff_GetUnmatchedNewFunctions)
+    .def("report",                   pydusa::BinaryDiff_Report)
+  ;
+}
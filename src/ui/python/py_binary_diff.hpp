@@ -0,0 +1,6 @@
+#ifndef PYDUSA_BINARY_DIFF_HPP
+#define PYDUSA_BINARY_DIFF_HPP
+
+void PydusaBinaryDiff(void);
+
+#endif // !PYDUSA_BINARY_DIFF_HPP
@@ -13,7 +13,7 @@ namespace pydusa
 {
   void (FileBinaryStream::*pFileBinaryStream_Open)(boost::filesystem::path const&) = &FileBinaryStream::Open;
 
-  static bp::str FileBinaryStream_Read(FileBinaryStream *pBinStrm, unsigned int Offset, size_t Size)
+  static bp::str FileBinaryStream_Read(FileBinaryStream *pBinStrm, TOffset Offset, size_t Size)
   {
     char *pBuffer = new char[Size];
     pBinStrm->Read(Offset, pBuffer, Size);
@@ -30,10 +30,10 @@ namespace pydusa
 #else
     PyBytes_AsStringAndSize(s.ptr(), &pBuf, &Size);
 #endif
-    pBinStrm->Open(pBuf, static_cast<u32>(Size));
+    pBinStrm->Open(pBuf, static_cast<u64>(Size));
   }
 
-  static bp::str MemoryBinaryStream_Read(MemoryBinaryStream *pBinStrm, unsigned int Offset, size_t Size)
+  static bp::str MemoryBinaryStream_Read(MemoryBinaryStream *pBinStrm, TOffset Offset, size_t Size)
   {
     char *pBuffer = new char[Size];
     pBinStrm->Read(Offset, pBuffer, Size);
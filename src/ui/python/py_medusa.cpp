@@ -43,6 +43,15 @@ namespace pydusa
     });
   }
 
+  static bp::object Medusa_GetTaskProgress(Medusa* pCore)
+  {
+    std::string TaskName;
+    u64 Done, Total;
+    if (!pCore->GetTaskProgress(TaskName, Done, Total))
+      return bp::object();
+    return bp::make_tuple(TaskName, Done, Total);
+  }
+
   static Document& Medusa_GetDocument(Medusa* pCore)
   {
     return pCore->GetDocument();
@@ -71,6 +80,9 @@ void PydusaMedusa(void)
     .def("open_db",  pydusa::Medusa_OpenDatabase)
 
     .def("wait_for_tasks", &Medusa::WaitForTasks)
+    .def("cancel_tasks", &Medusa::CancelTasks)
+    .def("set_tasks_timeout", &Medusa::SetTasksTimeout)
+    .add_property("task_progress", pydusa::Medusa_GetTaskProgress)
 
     .add_property("document", bp::make_function(pydusa::Medusa_GetDocument,
       bp::return_value_policy<bp::reference_existing_object>()))
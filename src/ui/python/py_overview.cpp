@@ -0,0 +1,92 @@
+#include "py_overview.hpp"
+
+#include <boost/python.hpp>
+
+#include <medusa/overview.hpp>
+#include <medusa/document.hpp>
+
+namespace bp = boost::python;
+
+MEDUSA_NAMESPACE_USE;
+
+namespace pydusa
+{
+  static bp::list Overview_Bucket_GetSizes(Overview::Bucket const* pBucket)
+  {
+    bp::list Sizes;
+    for (u8 CellType = 0; CellType < Overview::CellTypeNo; ++CellType)
+      Sizes.append(pBucket->m_Sizes[CellType]);
+    return Sizes;
+  }
+
+  static u64 Overview_Bucket_GetSizeOf(Overview::Bucket const* pBucket, u8 CellType)
+  {
+    if (CellType >= Overview::CellTypeNo)
+      return 0;
+    return pBucket->m_Sizes[CellType];
+  }
+
+  static bp::object Overview_GetBucket(Overview* pOverview, u32 BucketIndex)
+  {
+    Overview::Bucket Bkt;
+    if (!pOverview->GetBucket(BucketIndex, Bkt))
+      return bp::object();
+    return bp::object(Bkt);
+  }
+
+  static bp::list Overview_GetChangedBuckets(Overview* pOverview)
+  {
+    std::vector<u32> BktIdxs;
+    pOverview->GetChangedBuckets(BktIdxs);
+    bp::list Bkts;
+    for (auto BktIdx : BktIdxs)
+      Bkts.append(BktIdx);
+    return Bkts;
+  }
+
+  static bp::object Overview_ConvertAddressToBucket(Overview* pOverview, Address const& rAddress)
+  {
+    u32 BktIdx;
+    if (!pOverview->ConvertAddressToBucket(rAddress, BktIdx))
+      return bp::object();
+    return bp::object(BktIdx);
+  }
+
+  static bp::object Overview_ConvertBucketToAddress(Overview* pOverview, u32 BucketIndex)
+  {
+    Address Addr;
+    if (!pOverview->ConvertBucketToAddress(BucketIndex, Addr))
+      return bp::object();
+    return bp::object(Addr);
+  }
+
+  static void Overview_Update(Overview* pOverview, bp::list Addresses)
+  {
+    Address::List Addrs;
+    for (bp::ssize_t AddrIdx = 0; AddrIdx < bp::len(Addresses); ++AddrIdx)
+      Addrs.push_back(bp::extract<Address>(Addresses[AddrIdx]));
+    pOverview->Update(Addrs);
+  }
+}
+
+void PydusaOverview(void)
+{
+  bp::class_<Overview::Bucket>("OverviewBucket", bp::no_init)
+    .add_property("size",          &Overview::Bucket::GetSize)
+    .add_property("main_type",     &Overview::Bucket::GetMainCellType)
+    .add_property("sizes",         pydusa::Overview_Bucket_GetSizes)
+    .def("size_of",                pydusa::Overview_Bucket_GetSizeOf)
+  ;
+
+  bp::class_<Overview, boost::noncopyable>("Overview", bp::init<Document const&, bp::optional<u32> >()
+    [bp::with_custodian_and_ward<1, 2>()])
+    .def("invalidate",             &Overview::Invalidate)
+    .def("update",                 pydusa::Overview_Update)
+    .add_property("bucket_number", &Overview::GetNumberOfBuckets, &Overview::SetNumberOfBuckets)
+    .def("get_bucket",             pydusa::Overview_GetBucket)
+    .def("get_changed_buckets",    pydusa::Overview_GetChangedBuckets)
+    .add_property("statistics",    &Overview::GetStatistics)
+    .def("address_to_bucket",      pydusa::Overview_ConvertAddressToBucket)
+    .def("bucket_to_address",      pydusa::Overview_ConvertBucketToAddress)
+  ;
+}
@@ -0,0 +1,6 @@
+#ifndef PYDUSA_OVERVIEW_HPP
+#define PYDUSA_OVERVIEW_HPP
+
+void PydusaOverview(void);
+
+#endif // !PYDUSA_OVERVIEW_HPP
@@ -13,6 +13,8 @@
 #include "py_database.hpp"
 #include "py_document.hpp"
 #include "py_medusa.hpp"
+#include "py_binary_diff.hpp"
+#include "py_overview.hpp"
 
 namespace bp = boost::python;
 
@@ -35,4 +37,6 @@ BOOST_PYTHON_MODULE(pydusa)
 
   PydusaDocument();
   PydusaMedusa();
+  PydusaBinaryDiff();
+  PydusaOverview();
 }
@@ -108,7 +108,7 @@ void BasicBlockItem::paintText(QPainter& p)
 
 
   QColor MarkClr = DfClr;
-  m_PrintData.ForEachLine([&](medusa::Address const& rAddr, std::string const& rText, medusa::Mark::List const& rMarks)
+  m_PrintData.ForEachLine([&](medusa::Address const& rAddr, medusa::TextView const& rText, medusa::Mark::View const& rMarks)
   {
     std::string::size_type TextOff = 0;
     for (auto const& rMark : rMarks)
@@ -129,7 +129,7 @@ void BasicBlockItem::paintText(QPainter& p)
         default:                          MarkClr = DfClr; break;
         };
         p.setPen(MarkClr);
-        QString Text = QString::fromUtf8(rText.substr(TextOff, MarkLen).c_str());
+        QString Text = QString::fromUtf8(rText.data() + TextOff, MarkLen);
         p.drawText(static_cast<int>(TextOff * wChar), Line, Text);
       }
       TextOff += MarkLen;
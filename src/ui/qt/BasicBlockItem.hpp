@@ -8,6 +8,8 @@
 #include <QGraphicsDropShadowEffect>
 #include <QStyleOptionGraphicsItem>
 
+#include <atomic>
+
 #include <medusa/medusa.hpp>
 #include <medusa/disassembly_view.hpp>
 
@@ -17,6 +19,7 @@ class BasicBlockItem : public QObject, public QGraphicsItem, public medusa::Disa
 public:
   BasicBlockItem(QObject * parent, medusa::Medusa& core, medusa::Address::List const& addresses);
 
+  // Called from the document thread, the item is only marked and repainted by the GUI thread
   virtual void OnDocumentUpdated(void);
 
   QRectF boundingRect(void) const;
@@ -44,7 +47,7 @@ private:
   qreal                      m_Z;
   QGraphicsDropShadowEffect *m_Fx;
   medusa::Medusa&            m_rCore;
-  bool                       m_NeedRepaint;
+  std::atomic<bool>          m_NeedRepaint;
   QPixmap                    m_Cache;
   QFont                      m_Font;
   QColor                     m_BackgroundColor;
@@ -5,8 +5,11 @@
 
 #include <medusa/user_configuration.hpp>
 
+#include <cmath>
 #include <list>
 
+#include <ogdf/basic/Graph.h>
+#include <ogdf/basic/GraphAttributes.h>
 #include <ogdf/layered/SugiyamaLayout.h>
 #include <ogdf/layered/MedianHeuristic.h>
 #include <ogdf/layered/OptimalRanking.h>
@@ -16,38 +19,48 @@ ControlFlowGraphScene::ControlFlowGraphScene(QObject* pParent, medusa::Medusa& r
   : QGraphicsScene(pParent)
   , m_rCore(rCore)
   , m_CfgAddr(rCfgAddr)
+  , m_IsLayoutApplied(false)
+  , m_pPendingItem(nullptr)
 {
+  medusa::UserConfiguration UserCfg;
+  setBackgroundBrush(QBrush(QColor(QString::fromStdString(UserCfg.GetOption("color.background_listing")))));
+
   if (!_Update())
     medusa::Log::Write("ui_qt") << "failed to build CFG for: " << m_CfgAddr << medusa::LogEnd;
 }
 
+ControlFlowGraphScene::~ControlFlowGraphScene(void)
+{
+  // OGDF can't be interrupted, but it's only used on small graphs
+  m_LayoutToken.Cancel();
+  if (m_LayoutThread.joinable())
+    m_LayoutThread.join();
+
+  // Items are owned by this scene only once they're added, until then they're still subscribed to the document
+  if (!m_IsLayoutApplied)
+  {
+    for (auto pEdgeItem : m_EdgeItems)
+      delete pEdgeItem;
+    for (auto pBbItem : m_BscBlkItems)
+      delete pBbItem;
+  }
+}
+
 bool ControlFlowGraphScene::_Update(void)
 {
-  ogdf::Graph Graph;
-  ogdf::GraphAttributes GraphAttr(Graph, ogdf::GraphAttributes::nodeGraphics | ogdf::GraphAttributes::edgeGraphics);
   medusa::ControlFlowGraph CFG(m_rCore.GetDocument());
 
   if (!m_rCore.BuildControlFlowGraph(m_CfgAddr, CFG))
     return false;
 
-  qreal MaxBbWidth = 0.0, MaxBbHeight = 0.0;
-
-  QFontMetrics fm(font());
-  std::map<ogdf::node,  BasicBlockItem*> Nodes;
-  std::map<ogdf::edge,  EdgeItem*      > Edges;
-  std::map<medusa::u64, ogdf::node     > UsedBscBlock;
-
   auto const& g = CFG.GetGraph();
+  medusa::UserConfiguration UserCfg;
 
-  auto AddBscBlk = [&](medusa::u64 bbId) -> BasicBlockItem*
+  // Vertices are stored in a vector, so their descriptor is also the index of their node
+  auto VertexRange = boost::vertices(g);
+  for (auto VertexIter = VertexRange.first; VertexIter != VertexRange.second; ++VertexIter)
   {
-    auto itBscBlk = UsedBscBlock.find(bbId);
-    if (itBscBlk != std::end(UsedBscBlock))
-      return Nodes[ UsedBscBlock[ bbId ] ];
-
-    medusa::UserConfiguration UserCfg;
-
-    auto const& rCurBscBlk = g[bbId];
+    auto const& rCurBscBlk = g[*VertexIter];
 
     auto pBbItem = new BasicBlockItem(this, m_rCore, rCurBscBlk.GetAddresses());
 
@@ -56,34 +69,110 @@ bool ControlFlowGraphScene::_Update(void)
     else if (rCurBscBlk.CanReturn())
       pBbItem->SetBackgroundColor(QString::fromStdString(UserCfg.GetOption("color.background_node_end")));
 
-    auto NewNode = Graph.newNode();
     auto Rect = pBbItem->boundingRect();
-    GraphAttr.width()[NewNode]  = Rect.width();
-    GraphAttr.height()[NewNode] = Rect.height();
-    MaxBbWidth  = std::max(MaxBbWidth,  Rect.width());
-    MaxBbHeight = std::max(MaxBbHeight, Rect.height());
-    Nodes[NewNode]     = pBbItem;
-    UsedBscBlock[bbId] = NewNode;
-    return pBbItem;
-  };
-
-  auto VertexRange = boost::vertices(g);
-  for (auto VertexIter = VertexRange.first; VertexIter != VertexRange.second; ++VertexIter)
-    AddBscBlk(*VertexIter);
+    m_Layout.AddNode(
+      static_cast<medusa::u32>(std::ceil(Rect.width())),
+      static_cast<medusa::u32>(std::ceil(Rect.height())));
+    m_BscBlkItems.push_back(pBbItem);
+  }
 
   auto EdgeRange = boost::edges(g);
   for (auto itEdge = EdgeRange.first; itEdge != EdgeRange.second; ++itEdge)
   {
-    auto SrcBb     = AddBscBlk(itEdge->m_source);
-    auto TgtBb     = AddBscBlk(itEdge->m_target);
-    auto NewEdge   = Graph.newEdge(UsedBscBlock[itEdge->m_source], UsedBscBlock[itEdge->m_target]);
-    auto pEdgeItem = new EdgeItem(SrcBb, TgtBb, g[*itEdge].GetType());
-    Edges[NewEdge] = pEdgeItem;
+    auto SrcIdx = static_cast<medusa::u32>(itEdge->m_source);
+    auto TgtIdx = static_cast<medusa::u32>(itEdge->m_target);
+    m_Layout.AddEdge(SrcIdx, TgtIdx);
+    m_EdgeItems.push_back(new EdgeItem(m_BscBlkItems[SrcIdx], m_BscBlkItems[TgtIdx], g[*itEdge].GetType()));
+  }
+
+  // A cached layout is only reused if no basic block changed
+  medusa::GraphLayout CachedLayout;
+  if (m_rCore.GetDocument().GetFunctionLayout(m_CfgAddr, CachedLayout)
+    && CachedLayout.IsComputed()
+    && CachedLayout.GetSignature() == m_Layout.GetSignature())
+  {
+    m_Layout = CachedLayout;
+    applyLayout();
+    return true;
+  }
+
+  m_pPendingItem = addSimpleText(QString("Computing layout of %1 basic blocks...").arg(m_Layout.GetNumberOfNodes()));
+
+  m_LayoutThread = std::thread([this]()
+  {
+    bool Res = (m_Layout.GetNumberOfNodes() > OgdfNodeThreshold)
+      ? m_Layout.Compute(&m_LayoutToken)
+      : _LayoutWithOgdf(m_Layout);
+    if (!Res || m_LayoutToken.IsCancelled())
+      return;
+
+    m_rCore.GetDocument().SetFunctionLayout(m_CfgAddr, m_Layout);
+    QMetaObject::invokeMethod(this, "applyLayout", Qt::QueuedConnection);
+  });
+  return true;
+}
+
+void ControlFlowGraphScene::applyLayout(void)
+{
+  if (m_IsLayoutApplied)
+    return;
+  m_IsLayoutApplied = true;
+
+  if (m_pPendingItem != nullptr)
+  {
+    removeItem(m_pPendingItem);
+    delete m_pPendingItem;
+    m_pPendingItem = nullptr;
+  }
+
+  QRectF GraphRect;
+  for (medusa::u32 NodeIdx = 0; NodeIdx < m_BscBlkItems.size(); ++NodeIdx)
+  {
+    auto pBbItem = m_BscBlkItems[NodeIdx];
+    addItem(pBbItem);
+    QRectF BbRect = pBbItem->boundingRect();
+    auto const& rPos = m_Layout.GetNodePosition(NodeIdx);
+    qreal x = rPos.m_X - (BbRect.width()  / 2);
+    qreal y = rPos.m_Y - (BbRect.height() / 2);
+    pBbItem->setPos(x, y);
+    GraphRect |= pBbItem->sceneBoundingRect();
+  }
+
+  for (medusa::u32 EdgeIdx = 0; EdgeIdx < m_EdgeItems.size(); ++EdgeIdx)
+  {
+    ogdf::DPolyline Bends;
+    for (auto const& rBend : m_Layout.GetEdgeBends(EdgeIdx))
+      Bends.pushBack(ogdf::DPoint(rBend.m_X, rBend.m_Y));
+    m_EdgeItems[EdgeIdx]->setBends(Bends);
+    addItem(m_EdgeItems[EdgeIdx]);
   }
 
+  qreal Margin = medusa::GraphLayout::LayerDistance;
+  setSceneRect(GraphRect.adjusted(-Margin, -Margin, Margin, Margin));
+}
+
+bool ControlFlowGraphScene::_LayoutWithOgdf(medusa::GraphLayout& rLayout)
+{
+  ogdf::Graph Graph;
+  ogdf::GraphAttributes GraphAttr(Graph, ogdf::GraphAttributes::nodeGraphics | ogdf::GraphAttributes::edgeGraphics);
+
+  std::vector<ogdf::node> Nodes;
+  std::vector<ogdf::edge> Edges;
+
+  for (medusa::u32 NodeIdx = 0; NodeIdx < rLayout.GetNumberOfNodes(); ++NodeIdx)
+  {
+    auto NewNode = Graph.newNode();
+    GraphAttr.width()[NewNode]  = rLayout.GetNodeWidth(NodeIdx);
+    GraphAttr.height()[NewNode] = rLayout.GetNodeHeight(NodeIdx);
+    Nodes.push_back(NewNode);
+  }
+
+  for (medusa::u32 EdgeIdx = 0; EdgeIdx < rLayout.GetNumberOfEdges(); ++EdgeIdx)
+    Edges.push_back(Graph.newEdge(Nodes[rLayout.GetEdgeSource(EdgeIdx)], Nodes[rLayout.GetEdgeDestination(EdgeIdx)]));
+
   auto OHL = new ogdf::OptimalHierarchyLayout;
-  OHL->nodeDistance(25.0);
-  OHL->layerDistance(50.0);
+  OHL->nodeDistance(medusa::GraphLayout::NodeDistance);
+  OHL->layerDistance(medusa::GraphLayout::LayerDistance);
   OHL->weightBalancing(0.0);
   OHL->weightSegments(0.0);
 
@@ -94,24 +183,29 @@ bool ControlFlowGraphScene::_Update(void)
   SL.setLayout(OHL);
   SL.call(GraphAttr);
 
-  for (auto itNode = std::begin(Nodes); itNode != std::end(Nodes); ++itNode)
+  for (medusa::u32 NodeIdx = 0; NodeIdx < Nodes.size(); ++NodeIdx)
   {
-    addItem(itNode->second);
-    QRectF BbRect = itNode->second->boundingRect();
-    qreal x = GraphAttr.x(itNode->first) - (BbRect.width()  / 2);
-    qreal y = GraphAttr.y(itNode->first) - (BbRect.height() / 2);
-    itNode->second->setPos(x, y);
+    medusa::GraphLayout::Point Pos =
+    {
+      static_cast<medusa::s32>(GraphAttr.x(Nodes[NodeIdx])),
+      static_cast<medusa::s32>(GraphAttr.y(Nodes[NodeIdx]))
+    };
+    rLayout.SetNodePosition(NodeIdx, Pos);
   }
 
-  for (auto itEdge = std::begin(Edges); itEdge != std::end(Edges); ++itEdge)
+  for (medusa::u32 EdgeIdx = 0; EdgeIdx < Edges.size(); ++EdgeIdx)
   {
-    auto const& rBends = GraphAttr.bends(itEdge->first);
-    itEdge->second->setBends(rBends);
-    addItem(itEdge->second);
+    medusa::GraphLayout::PointList Bends;
+    auto const& rBends = GraphAttr.bends(Edges[EdgeIdx]);
+    for (auto itBend = rBends.begin(); itBend.valid(); ++itBend)
+    {
+      medusa::GraphLayout::Point Bend = { static_cast<medusa::s32>((*itBend).m_x), static_cast<medusa::s32>((*itBend).m_y) };
+      Bends.push_back(Bend);
+    }
+    rLayout.SetEdgeBends(EdgeIdx, Bends);
   }
 
-  setSceneRect(0, 0, GraphAttr.boundingBox().width() + MaxBbWidth, GraphAttr.boundingBox().height() + MaxBbHeight);
-  medusa::UserConfiguration UserCfg;
-  setBackgroundBrush(QBrush(QColor(QString::fromStdString(UserCfg.GetOption("color.background_listing")))));
+  auto const& rBox = GraphAttr.boundingBox();
+  rLayout.SetSize(static_cast<medusa::u32>(rBox.width()), static_cast<medusa::u32>(rBox.height()));
   return true;
 }
\ No newline at end of file
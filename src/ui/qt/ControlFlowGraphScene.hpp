@@ -4,24 +4,51 @@
 #include <QtCore>
 #include <QtGui>
 #include <QGraphicsScene>
+#include <QGraphicsSimpleTextItem>
 
 #include <medusa/medusa.hpp>
 #include <medusa/function.hpp>
+#include <medusa/graph_layout.hpp>
+#include <medusa/task.hpp>
 
-#include <ogdf/basic/Graph.h>
-#include <ogdf/basic/GraphAttributes.h>
+#include <thread>
+#include <vector>
+
+class BasicBlockItem;
+class EdgeItem;
 
 class ControlFlowGraphScene : public QGraphicsScene
 {
   Q_OBJECT
 public:
+  enum
+  {
+    OgdfNodeThreshold = 200, // larger graphs are laid out with medusa::GraphLayout
+  };
+
   explicit ControlFlowGraphScene(QObject* pParent, medusa::Medusa& rCore, medusa::Address const& rCfgAddr);
+  ~ControlFlowGraphScene(void);
+
+private slots:
+  void applyLayout(void);
 
 private:
   bool _Update(void);
+  static bool _LayoutWithOgdf(medusa::GraphLayout& rLayout);
 
   medusa::Medusa& m_rCore;
   medusa::Address m_CfgAddr;
+
+  // Items are indexed like nodes and edges of m_Layout, they're added once the layout is known
+  std::vector<BasicBlockItem*> m_BscBlkItems;
+  std::vector<EdgeItem*>       m_EdgeItems;
+  bool                         m_IsLayoutApplied;
+  QGraphicsSimpleTextItem*     m_pPendingItem;
+
+  // m_Layout belongs to the layout thread until applyLayout is queued
+  medusa::GraphLayout          m_Layout;
+  medusa::CancellationToken    m_LayoutToken;
+  std::thread                  m_LayoutThread;
 };
 
 #endif // QMEDUSA_CFG_SCENE_HPP
\ No newline at end of file
@@ -21,7 +21,20 @@ DisassemblyView::DisassemblyView(QWidget * parent, medusa::Medusa * core)
   , _addrLen(static_cast<int>(core->GetDocument().GetStartAddress().ToString().length() + 1))
   , _cursorTimer(),         _cursorBlink(false)
   , _cache()
+  , _pendingAddrs()
+  , _prefetcher(*core, m_LineCache, m_FormatFlags, [this]()
+  {
+    // Called from the prefetcher thread, the view is refreshed in the GUI thread
+    QMetaObject::invokeMethod(this, "listingUpdated", Qt::QueuedConnection);
+  })
+  , _updateTimer(),         _updateScheduled(false)
 {
+  // Addresses which aren't cached yet are displayed as placeholders
+  m_Format.SetPendingAddresses(&_pendingAddrs);
+  _updateTimer.setSingleShot(true);
+  _updateTimer.setInterval(100);
+  connect(&_updateTimer, SIGNAL(timeout()), this, SLOT(flushListingUpdate()));
+
   setFont(); // this method initializes both _wChar and _hChar
   setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
   setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
@@ -47,11 +60,24 @@ DisassemblyView::DisassemblyView(QWidget * parent, medusa::Medusa * core)
 
 DisassemblyView::~DisassemblyView(void)
 {
+  // The prefetcher thread must not call this view anymore
+  _prefetcher.Stop();
 }
 
 void DisassemblyView::OnDocumentUpdated(void)
 {
-  emit viewUpdated();
+  // Called from the document thread, the view is refreshed by the GUI thread
+  QMetaObject::invokeMethod(this, "viewUpdated", Qt::QueuedConnection);
+}
+
+void DisassemblyView::OnAddressUpdated(medusa::Address::List const& rAddressList)
+{
+  medusa::FullDisassemblyView::OnAddressUpdated(rAddressList);
+
+  // Analysis updates addresses by bursts, only one refresh is done for each of them
+  if (_updateScheduled.exchange(true))
+    return;
+  QMetaObject::invokeMethod(this, "scheduleListingUpdate", Qt::QueuedConnection);
 }
 
 bool DisassemblyView::goTo(medusa::Address const& address)
@@ -99,14 +125,25 @@ void DisassemblyView::horizontalScrollBarChanged(int n)
 
 void DisassemblyView::listingUpdated(void)
 {
-  // OPTIMIZEME: this part of code is too time consumming
-  // we should find a way to only update when it's necessary
+  // Only cached lines are replayed here, missing ones are formatted by the prefetcher
   Refresh();
 
   viewport()->update();
   _needRepaint = true;
 }
 
+void DisassemblyView::scheduleListingUpdate(void)
+{
+  if (!_updateTimer.isActive())
+    _updateTimer.start();
+}
+
+void DisassemblyView::flushListingUpdate(void)
+{
+  _updateScheduled = false;
+  listingUpdated();
+}
+
 void DisassemblyView::updateCursor(void)
 {
   _cursorBlink = _cursorBlink ? false : true;
@@ -289,7 +326,7 @@ void DisassemblyView::paintText(QPainter& p)
   QColor CmClr(QString::fromStdString(UserCfg.GetOption("color.comment")));
   QColor DfClr(Qt::black);
 
-  m_PrintData.ForEachLine([&](medusa::Address const& rAddr, std::string const& rText, medusa::Mark::List const& rMarks)
+  m_PrintData.ForEachLine([&](medusa::Address const& rAddr, medusa::TextView const& rText, medusa::Mark::View const& rMarks)
   {
     if (SkippedLine)
     {
@@ -315,7 +352,7 @@ void DisassemblyView::paintText(QPainter& p)
         default:                          MarkClr = DfClr; break;
         };
         p.setPen(MarkClr);
-        QString Text = QString::fromUtf8(rText.substr(TextOff, MarkLen).c_str());
+        QString Text = QString::fromUtf8(rText.data() + TextOff, MarkLen);
         p.drawText(static_cast<int>(TextOff * _wChar), Line, Text);
       }
       TextOff += MarkLen;
@@ -345,6 +382,8 @@ void DisassemblyView::paintCursor(QPainter& p)
 
 void DisassemblyView::paintEvent(QPaintEvent * evt)
 {
+  _RequestPendingLines();
+
   if (_needRepaint == true)
   {
     _cache = QPixmap(viewport()->size());
@@ -709,3 +748,13 @@ void DisassemblyView::_UpdateActions(void)
     addAction(pUiAction);
   }
 }
+
+void DisassemblyView::_RequestPendingLines(void)
+{
+  std::lock_guard<MutexType> Lock(m_Mutex);
+
+  if (_pendingAddrs.empty())
+    return;
+  _pendingAddrs.clear();
+  _prefetcher.Request(m_Top.m_Address, m_Height);
+}
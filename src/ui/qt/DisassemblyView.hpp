@@ -13,12 +13,14 @@
 # include "Proxy.hpp"
 
 # include <vector>
+# include <atomic>
 
 # include <medusa/medusa.hpp>
 # include <medusa/address.hpp>
 # include <medusa/document.hpp>
 # include <medusa/instruction.hpp>
 # include <medusa/disassembly_view.hpp>
+# include <medusa/line_prefetcher.hpp>
 # include <medusa/cell_action.hpp>
 
 class DisassemblyView : public QAbstractScrollArea, public medusa::FullDisassemblyView
@@ -29,7 +31,9 @@ public:
   DisassemblyView(QWidget * parent, medusa::Medusa * core);
   ~DisassemblyView(void);
 
+  // Called from the document thread, GUI work is queued to the GUI thread
   virtual void OnDocumentUpdated(void);
+  virtual void OnAddressUpdated(medusa::Address::List const& rAddressList);
 
   bool goTo(medusa::Address const& address);
 
@@ -45,6 +49,8 @@ public slots:
   void viewUpdated(void);
   void horizontalScrollBarChanged(int n);
   void listingUpdated(void);
+  void scheduleListingUpdate(void);
+  void flushListingUpdate(void);
   void updateCursor(void);
   void showContextMenu(QPoint const& pos);
   void OnUiActionTriggered(medusa::Action::SPType spAction);
@@ -73,6 +79,7 @@ private:
   bool convertMouseToAddress(QMouseEvent * evt, medusa::Address & addr);
 
   void _UpdateActions(void);
+  void _RequestPendingLines(void);
 
   bool             _needRepaint;
   medusa::Medusa * _core;
@@ -82,6 +89,11 @@ private:
   QTimer           _cursorTimer;
   bool             _cursorBlink;
   QPixmap          _cache;
+
+  medusa::Address::List  _pendingAddrs;    // addresses displayed as placeholders
+  medusa::LinePrefetcher _prefetcher;      // formats pending addresses in background
+  QTimer                 _updateTimer;     // coalesces address updates
+  std::atomic<bool>      _updateScheduled;
 };
 
 #endif // !QMEDUSA_DISASSEMBLY_VIEW_HPP
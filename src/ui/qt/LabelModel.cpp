@@ -0,0 +1,132 @@
+#include "LabelModel.hpp"
+
+LabelModel::LabelModel(QObject * parent, medusa::Document& doc)
+  : QAbstractTableModel(parent)
+  , _doc(doc)
+{
+}
+
+int LabelModel::rowCount(QModelIndex const& parent) const
+{
+  if (parent.isValid())
+    return 0;
+  return static_cast<int>(_labels.GetSize());
+}
+
+int LabelModel::columnCount(QModelIndex const& parent) const
+{
+  if (parent.isValid())
+    return 0;
+  return ColumnNo;
+}
+
+QVariant LabelModel::data(QModelIndex const& index, int role) const
+{
+  if (role != Qt::DisplayRole || !index.isValid() || static_cast<medusa::u32>(index.row()) >= _labels.GetSize())
+    return QVariant();
+
+  auto const& entry = _labels.GetEntry(static_cast<medusa::u32>(index.row()));
+  switch (index.column())
+  {
+  case NameColumn:    return QString::fromStdString(entry.m_Name);
+  case TypeColumn:    return _typeToString(entry.m_Label.GetType());
+  case AddressColumn: return QString::fromStdString(entry.m_Address.ToString());
+  default:            return QVariant();
+  }
+}
+
+QVariant LabelModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+    return QVariant();
+
+  switch (section)
+  {
+  case NameColumn:    return QString("Name");
+  case TypeColumn:    return QString("Type");
+  case AddressColumn: return QString("Address");
+  default:            return QVariant();
+  }
+}
+
+void LabelModel::sort(int column, Qt::SortOrder order)
+{
+  medusa::LabelList::SortKey key;
+  switch (column)
+  {
+  case NameColumn:    key = medusa::LabelList::SortByName;    break;
+  case TypeColumn:    key = medusa::LabelList::SortByType;    break;
+  case AddressColumn: key = medusa::LabelList::SortByAddress; break;
+  default:            return;
+  }
+
+  // Pending updates must be applied with the previous order
+  applyUpdates();
+  beginResetModel();
+  _labels.Sort(key, order == Qt::AscendingOrder);
+  endResetModel();
+}
+
+bool LabelModel::getAddress(QModelIndex const& index, medusa::Address& addr) const
+{
+  if (!index.isValid() || static_cast<medusa::u32>(index.row()) >= _labels.GetSize())
+    return false;
+  addr = _labels.GetEntry(static_cast<medusa::u32>(index.row())).m_Address;
+  return true;
+}
+
+void LabelModel::addLabelUpdate(medusa::Address const& address, medusa::Label const& label, bool removed)
+{
+  // Only the first update of a batch schedules its application
+  if (_labels.AddLabelUpdate(address, label, removed))
+    QMetaObject::invokeMethod(this, "applyUpdates", Qt::QueuedConnection);
+}
+
+void LabelModel::refresh(void)
+{
+  beginResetModel();
+  _labels.Rebuild(_doc);
+  endResetModel();
+}
+
+void LabelModel::setFilter(QString const& filter)
+{
+  _labels.SetFilter(filter.toStdString());
+  refresh();
+}
+
+void LabelModel::applyUpdates(void)
+{
+  _labels.ApplyUpdates([this](medusa::LabelList::RowsChange change, medusa::u32 firstRow, medusa::u32 lastRow)
+  {
+    switch (change)
+    {
+    case medusa::LabelList::BeginInsertRows: beginInsertRows(QModelIndex(), firstRow, lastRow); break;
+    case medusa::LabelList::EndInsertRows:   endInsertRows();                                   break;
+    case medusa::LabelList::BeginRemoveRows: beginRemoveRows(QModelIndex(), firstRow, lastRow); break;
+    case medusa::LabelList::EndRemoveRows:   endRemoveRows();                                   break;
+    case medusa::LabelList::BeginReset:      beginResetModel();                                 break;
+    case medusa::LabelList::EndReset:        endResetModel();                                   break;
+    }
+  });
+}
+
+QString LabelModel::_typeToString(medusa::u16 type)
+{
+  QString labelType = "";
+  switch (type & medusa::Label::AccessMask)
+  {
+  case medusa::Label::Exported: labelType += "exported "; break;
+  case medusa::Label::Imported: labelType += "imported "; break;
+  default:                                                break;
+  }
+  switch (type & medusa::Label::CellMask)
+  {
+  case medusa::Label::Code:     labelType += "code";     break;
+  case medusa::Label::Function: labelType += "function"; break;
+  case medusa::Label::Data:     labelType += "data";     break;
+  case medusa::Label::String:   labelType += "string";   break;
+  default:                      labelType += "unknown";  break;
+  }
+  return labelType;
+}
@@ -0,0 +1,48 @@
+#ifndef QMEDUSA_LABEL_MODEL_HPP
+#define QMEDUSA_LABEL_MODEL_HPP
+
+#include <QAbstractTableModel>
+
+#include <medusa/document.hpp>
+#include <medusa/label_list.hpp>
+
+// LabelModel fetches its rows from a medusa::LabelList, only visible rows are formatted
+class LabelModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+public:
+  enum Column
+  {
+    NameColumn,
+    TypeColumn,
+    AddressColumn,
+    ColumnNo,
+  };
+
+  LabelModel(QObject * parent, medusa::Document& doc);
+
+  virtual int      rowCount(QModelIndex const& parent = QModelIndex()) const;
+  virtual int      columnCount(QModelIndex const& parent = QModelIndex()) const;
+  virtual QVariant data(QModelIndex const& index, int role = Qt::DisplayRole) const;
+  virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+  virtual void     sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+  bool getAddress(QModelIndex const& index, medusa::Address& addr) const;
+
+  // This method can be called from any thread, updates are applied later on the GUI thread
+  void addLabelUpdate(medusa::Address const& address, medusa::Label const& label, bool removed);
+
+public slots:
+  void refresh(void);
+  void setFilter(QString const& filter);
+  void applyUpdates(void);
+
+private:
+  static QString _typeToString(medusa::u16 type);
+
+  medusa::Document& _doc;
+  medusa::LabelList _labels;
+};
+
+#endif // !QMEDUSA_LABEL_MODEL_HPP
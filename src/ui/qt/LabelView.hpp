@@ -1,17 +1,18 @@
 #ifndef QMEDUSA_LABEL_VIEW_HPP
 #define QMEDUSA_LABEL_VIEW_HPP
 
+#include <QWidget>
+#include <QLineEdit>
 #include <QTreeView>
-#include <QMutex>
 
 #include <medusa/medusa.hpp>
 #include <medusa/document.hpp>
 #include <medusa/view.hpp>
 #include <medusa/label.hpp>
 
-Q_DECLARE_METATYPE(QVector<int>)
+#include "LabelModel.hpp"
 
-class LabelView : public QTreeView, public medusa::View
+class LabelView : public QWidget, public medusa::View
 {
   Q_OBJECT
 
@@ -19,23 +20,22 @@ public:
   LabelView(QWidget * parent, medusa::Medusa& core);
   virtual ~LabelView(void) {}
 
+  // Called from the document thread, labels are queued and applied in batch by the model
   virtual void OnLabelUpdated(medusa::Address const& address, medusa::Label const& label, bool removed);
 
   void Refresh(void);
 
 signals:
   void goTo(medusa::Address const& addr);
-  void labelAdded(medusa::Address const& address, medusa::Label const& label);
-  void labelRemoved(medusa::Address const& address, medusa::Label const& label);
 
 private slots:
   void onDoubleClickLabel(QModelIndex const& idx);
-  void onAddLabel(medusa::Address const& address, medusa::Label const& label);
-  void onRemoveLabel(medusa::Address const& address, medusa::Label const& label);
 
 private:
   medusa::Medusa& _core;
-  QMutex _mutex;
+  LabelModel *    _model;
+  QLineEdit *     _filter;
+  QTreeView *     _tree;
 };
 
-#endif // !QMEDUSA_LABEL_VIEW_HPP
\ No newline at end of file
+#endif // !QMEDUSA_LABEL_VIEW_HPP
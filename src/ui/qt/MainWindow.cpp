@@ -26,6 +26,9 @@ MainWindow::MainWindow()
   , _goto(this)
   , _settingsDialog(this, _medusa)
   , _undoJumpView()
+  , _taskProgress()
+  , _taskCancel("Cancel")
+  , _taskTimer()
   , _fileName("")
   , _documentOpened(false)
   , _closeWindow(false)
@@ -49,6 +52,16 @@ MainWindow::MainWindow()
   connect(this->tabWidget, SIGNAL(tabCloseRequested(int)), this, SLOT(on_tabWidget_tabCloseRequested(int)));
   connect(this, SIGNAL(logAppended(QString const &)), this, SLOT(onLogMessageAppended(QString const &)));
   connect(this, SIGNAL(lastAddressUpdated(medusa::Address const&)), this, SLOT(setCurrentAddress(medusa::Address const&)));
+
+  // Progress of the running task is polled, tasks only update atomic counters
+  _taskProgress.setMaximumWidth(300);
+  _taskProgress.hide();
+  _taskCancel.hide();
+  statusBar()->addPermanentWidget(&_taskProgress);
+  statusBar()->addPermanentWidget(&_taskCancel);
+  connect(&_taskCancel, SIGNAL(clicked()), this, SLOT(cancelTasks()));
+  connect(&_taskTimer, SIGNAL(timeout()), this, SLOT(updateTaskProgress()));
+  _taskTimer.start(250);
 }
 
 MainWindow::~MainWindow()
@@ -368,6 +381,35 @@ void MainWindow::setCurrentAddress(medusa::Address const& addr)
   statusBar()->showMessage(QString("va: %1 \xE2\x86\x92 offset: %2").arg(QString::fromStdString(addr.ToString()), OffStr));
 }
 
+void MainWindow::updateTaskProgress()
+{
+  std::string taskName;
+  medusa::u64 done, total;
+  if (!_medusa.GetTaskProgress(taskName, done, total))
+  {
+    _taskProgress.hide();
+    _taskCancel.hide();
+    return;
+  }
+
+  // A task without estimation is shown as busy
+  if (total == 0)
+    _taskProgress.setRange(0, 0);
+  else
+  {
+    _taskProgress.setRange(0, 1000);
+    _taskProgress.setValue(static_cast<int>(std::min<medusa::u64>(done, total) * 1000 / total));
+  }
+  _taskProgress.setFormat(QString("%1: %p%").arg(QString::fromStdString(taskName)));
+  _taskProgress.show();
+  _taskCancel.show();
+}
+
+void MainWindow::cancelTasks()
+{
+  _medusa.CancelTasks();
+}
+
 void MainWindow::closeEvent(QCloseEvent * event)
 {
   medusa::UserConfiguration UserCfg;
@@ -9,6 +9,8 @@
 # include <QUndoView>
 # include <QPlainTextEdit>
 # include <QListWidgetItem>
+# include <QProgressBar>
+# include <QPushButton>
 # include <medusa/medusa.hpp>
 # include "ui_MainWindow.h"
 # include "About.hpp"
@@ -63,6 +65,9 @@ public slots:
   void        goTo(medusa::Address const& addr);
   void        setCurrentAddress(medusa::Address const& addr);
 
+  void        updateTaskProgress();
+  void        cancelTasks();
+
 signals:
   void        DisassemblyViewAdded(medusa::Address const& startAddr);
   void        SemanticViewAdded(medusa::Address const& funcAddr);
@@ -84,6 +89,9 @@ private:
 
   // UI
   QUndoView                 _undoJumpView;
+  QProgressBar              _taskProgress;
+  QPushButton               _taskCancel;
+  QTimer                    _taskTimer;
 
   // Data
   QString                   _fileName;
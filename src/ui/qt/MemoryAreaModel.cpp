@@ -0,0 +1,102 @@
+#include "MemoryAreaModel.hpp"
+
+MemoryAreaModel::MemoryAreaModel(QObject * parent, medusa::Document& doc)
+  : QAbstractTableModel(parent)
+  , _doc(doc)
+  , _isRefreshPending(false)
+{
+}
+
+int MemoryAreaModel::rowCount(QModelIndex const& parent) const
+{
+  if (parent.isValid())
+    return 0;
+  return static_cast<int>(_rows.size());
+}
+
+int MemoryAreaModel::columnCount(QModelIndex const& parent) const
+{
+  if (parent.isValid())
+    return 0;
+  return ColumnNo;
+}
+
+QVariant MemoryAreaModel::data(QModelIndex const& index, int role) const
+{
+  if (role != Qt::DisplayRole || !index.isValid() || static_cast<size_t>(index.row()) >= _rows.size())
+    return QVariant();
+
+  auto const& row = _rows[index.row()];
+  switch (index.column())
+  {
+  case NameColumn:    return row.name;
+  case AddressColumn: return QString::fromStdString(row.address.ToString());
+  case SizeColumn:    return row.size;
+  case AccessColumn:  return row.access;
+  default:            return QVariant();
+  }
+}
+
+QVariant MemoryAreaModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+    return QVariant();
+
+  switch (section)
+  {
+  case NameColumn:    return QString("Name");
+  case AddressColumn: return QString("Address");
+  case SizeColumn:    return QString("Size");
+  case AccessColumn:  return QString("Access");
+  default:            return QVariant();
+  }
+}
+
+bool MemoryAreaModel::getAddress(QModelIndex const& index, medusa::Address& addr) const
+{
+  if (!index.isValid() || static_cast<size_t>(index.row()) >= _rows.size())
+    return false;
+  addr = _rows[index.row()].address;
+  return true;
+}
+
+void MemoryAreaModel::scheduleRefresh(void)
+{
+  // Loaders add memory areas one by one, they're all handled by a single refresh
+  if (!_isRefreshPending.exchange(true))
+    QMetaObject::invokeMethod(this, "refresh", Qt::QueuedConnection);
+}
+
+void MemoryAreaModel::refresh(void)
+{
+  _isRefreshPending = false;
+
+  auto acc2Str = [](medusa::u32 access) -> QString
+  {
+    QString res;
+    if (access & medusa::MemoryArea::Read)
+      res += 'R';
+    if (access & medusa::MemoryArea::Write)
+      res += 'W';
+    if (access & medusa::MemoryArea::Execute)
+      res += 'X';
+    return res;
+  };
+
+  std::vector<Row> rows;
+  _doc.ForEachMemoryArea([&](medusa::MemoryArea const& memArea)
+  {
+    Row row =
+    {
+      QString::fromStdString(memArea.GetName()),
+      memArea.GetBaseAddress(),
+      QString("%1").arg(memArea.GetSize(), 8, 16, QChar('0')),
+      acc2Str(memArea.GetAccess())
+    };
+    rows.push_back(row);
+  });
+
+  beginResetModel();
+  _rows.swap(rows);
+  endResetModel();
+}
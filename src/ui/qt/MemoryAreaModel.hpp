@@ -0,0 +1,56 @@
+#ifndef QMEDUSA_MEMORY_AREA_MODEL_HPP
+#define QMEDUSA_MEMORY_AREA_MODEL_HPP
+
+#include <QAbstractTableModel>
+
+#include <atomic>
+#include <vector>
+
+#include <medusa/document.hpp>
+#include <medusa/memory_area.hpp>
+
+// MemoryAreaModel holds a copy of the memory areas fields, it's rebuilt in one pass on updates
+class MemoryAreaModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+public:
+  enum Column
+  {
+    NameColumn,
+    AddressColumn,
+    SizeColumn,
+    AccessColumn,
+    ColumnNo,
+  };
+
+  MemoryAreaModel(QObject * parent, medusa::Document& doc);
+
+  virtual int      rowCount(QModelIndex const& parent = QModelIndex()) const;
+  virtual int      columnCount(QModelIndex const& parent = QModelIndex()) const;
+  virtual QVariant data(QModelIndex const& index, int role = Qt::DisplayRole) const;
+  virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+  bool getAddress(QModelIndex const& index, medusa::Address& addr) const;
+
+  // This method can be called from any thread, the refresh is queued on the GUI thread
+  void scheduleRefresh(void);
+
+public slots:
+  void refresh(void);
+
+private:
+  struct Row
+  {
+    QString         name;
+    medusa::Address address;
+    QString         size;
+    QString         access;
+  };
+
+  medusa::Document& _doc;
+  std::vector<Row>  _rows;
+  std::atomic<bool> _isRefreshPending;
+};
+
+#endif // !QMEDUSA_MEMORY_AREA_MODEL_HPP
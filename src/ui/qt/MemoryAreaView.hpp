@@ -2,11 +2,12 @@
 #define QMEDUSA_MEMORY_AREA_VIEW_HPP
 
 #include <QTreeView>
-#include <QMutex>
 
 #include <medusa/medusa.hpp>
 #include <medusa/view.hpp>
 
+#include "MemoryAreaModel.hpp"
+
 class MemoryAreaView : public QTreeView, public medusa::View
 {
   Q_OBJECT
@@ -20,15 +21,13 @@ public:
 
 signals:
   void goTo(medusa::Address const& addr);
-  void memoryAreaAdded(medusa::MemoryArea const& memArea);
 
 private slots:
-  void onAddMemoryArea(medusa::MemoryArea const& memArea);
   void onDoubleClickMemoryArea(QModelIndex const& idx);
 
 private:
-  medusa::Medusa& _core;
-  QMutex _mutex;
+  medusa::Medusa&   _core;
+  MemoryAreaModel * _model;
 };
 
 #endif // !QMEDUSA_MEMORY_AREA_VIEW_HPP
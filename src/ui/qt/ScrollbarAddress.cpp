@@ -1,16 +1,26 @@
 #include "ScrollbarAddress.hpp"
 
 #include <medusa/log.hpp>
+#include <medusa/disassembly_view.hpp>
 
 int ScrollbarAddress::_width = 40;
 
 ScrollbarAddress::ScrollbarAddress(QWidget * parent, medusa::Medusa& core)
-  : QWidget(parent), View(medusa::Document::Subscriber::AddressUpdated, core.GetDocument())
+  : QWidget(parent), View(medusa::Document::Subscriber::AddressUpdated | medusa::Document::Subscriber::MemoryAreaUpdated, core.GetDocument())
   , _core(core)
+  , _lineIdx(core.GetDocument(), [&core](medusa::Address const& rAddress)
+  {
+    // Use the same layout as the disassembly view
+    return medusa::FormatDisassembly::GetLineNo(core.GetDocument(), rAddress,
+      medusa::FormatDisassembly::ShowAddress | medusa::FormatDisassembly::AddSpaceBeforeXref | medusa::FormatDisassembly::Indent);
+  })
+  , _overview(core.GetDocument())
   , _img(size())
+  , _lastAddr()
+  , _needRefresh(true)
   , _lastPos(0)
   , _currPos(0)
-  , _maxPos(core.GetDocument().GetNumberOfAddress())
+  , _maxPos(1)
 {
   setFixedWidth(_width);
   setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
@@ -23,76 +33,48 @@ ScrollbarAddress::~ScrollbarAddress(void)
 {
 }
 
+void ScrollbarAddress::OnMemoryAreaUpdated(medusa::MemoryArea const& rMemArea, bool Removed)
+{
+  _lineIdx.Invalidate();
+  _overview.Invalidate();
+  _needRefresh = true;
+  emit updated();
+}
+
 void ScrollbarAddress::OnAddressUpdated(medusa::Address::List const& rAddressList)
 {
-  auto const& doc = _core.GetDocument();
+  // Modified blocks and buckets are counted again when the scrollbar is painted
+  _lineIdx.Update(rAddressList);
+  _overview.Update(rAddressList);
 
   if (!rAddressList.empty())
   {
-    doc.ConvertAddressToPosition(*rAddressList.crbegin(), _lastPos);
-    emit updated();
+    _mutex.lock();
+    _lastAddr = *rAddressList.crbegin();
+    _mutex.unlock();
   }
 
-  _mutex.lock();
-  QPainter p(&_img);
-  std::for_each(std::begin(rAddressList), std::end(rAddressList), [&](medusa::Address const& addr)
-  {
-    medusa::u32 pos;
-    if (!doc.ConvertAddressToPosition(addr, pos))
-      return;
-    auto cell = doc.GetCell(addr);
-    size_t cellLen = cell->GetLength();
-    auto y = static_cast<int>(static_cast<medusa::u64>(pos) * _img.height() / _maxPos);
-    QColor CurClr(_CellTypeToColor(doc.GetCellType(addr)));
-    QColor LastClr = _img.toImage().pixel(QPoint(0, y));
-    CurClr.setRgbF(
-      (CurClr.redF() + LastClr.redF()) / 2,
-      (CurClr.greenF() + LastClr.greenF()) / 2,
-      (CurClr.blueF() + LastClr.blueF()) / 2);
-    p.setPen(CurClr);
-    p.setBrush(CurClr);
-    auto h = static_cast<int>(static_cast<medusa::u64>(cellLen) * _img.height() / _maxPos);
-    p.drawRect(0, y, _width * 3, h); // LATER: figure out why we've to * 3 ?!?
-  });
-
-  _mutex.unlock();
+  _needRefresh = true;
+  emit updated();
 }
 
 void ScrollbarAddress::Refresh(void)
 {
-  auto const& rDoc = _core.GetDocument();
-  _maxPos = rDoc.GetNumberOfAddress();
+  _needRefresh = false;
+
   _mutex.lock();
+  // Positions are listing lines, like the disassembly view
+  _maxPos = _lineIdx.GetNumberOfLines();
+  if (_maxPos == 0)
+    _maxPos = 1;
+  _lineIdx.ConvertAddressToLine(_lastAddr, _lastPos);
+
+  // Colors come from buckets of addresses, only rows whose bucket changed are drawn again
+  std::vector<medusa::u32> changedBkts;
+  _overview.GetChangedBuckets(changedBkts);
   QPainter p(&_img);
-  rDoc.ForEachMemoryArea([&](medusa::MemoryArea const& rMemArea)
-  {
-    rMemArea.ForEachCellData([&](medusa::TOffset Offset, medusa::CellData::SPType spCellData)
-    {
-      medusa::Address CurAddr = rMemArea.GetBaseAddress() + rMemArea.MakeAddress(Offset);
-      medusa::u32 Pos;
-      if (!rDoc.ConvertAddressToPosition(CurAddr, Pos))
-        return;
-
-      size_t CellLen = spCellData->GetLength();
-      auto h = static_cast<int>(static_cast<medusa::u64>(CellLen) * _img.height() / _maxPos);
-      if (h == 0)
-        h = 1;
-
-      auto y = static_cast<int>(static_cast<medusa::u64>(Pos) * _img.height() / _maxPos);
-
-      QColor CurClr(_CellTypeToColor(spCellData->GetType()));
-      QColor LastClr = _img.toImage().pixel(QPoint(0, y));
-        CurClr.setRgbF(
-          (CurClr.redF() + LastClr.redF()) / 2,
-          (CurClr.greenF() + LastClr.greenF()) / 2,
-          (CurClr.blueF() + LastClr.blueF()) / 2);
-
-      p.setPen(CurClr);
-      p.setBrush(CurClr);
-
-      p.drawRect(0, y, _width * 3, h); // LATER: see above about * 3
-    });
-  });
+  for (auto bktIdx : changedBkts)
+    _DrawBucket(p, bktIdx);
   _mutex.unlock();
 }
 
@@ -101,6 +83,9 @@ void ScrollbarAddress::paintEvent(QPaintEvent * evt)
   if (_img.isNull())
     return;
 
+  if (_needRefresh)
+    Refresh();
+
   _mutex.lock();
   QPainter painter(this);
   painter.drawPixmap(0, 0, _img);
@@ -116,8 +101,14 @@ void ScrollbarAddress::paintEvent(QPaintEvent * evt)
 void ScrollbarAddress::resizeEvent(QResizeEvent *evt)
 {
   _mutex.lock();
-  _img = _img.scaled(evt->size());
+  _img = QPixmap(evt->size());
+  _img.fill(_CellTypeToColor(medusa::Cell::CellType));
+  // The pixmap is blank, so all buckets must be reported as changed
+  if (_img.height() > 0)
+    _overview.SetNumberOfBuckets(static_cast<medusa::u32>(_img.height()));
+  _overview.Invalidate();
   _mutex.unlock();
+  _needRefresh = true;
 }
 
 void ScrollbarAddress::mousePressEvent(QMouseEvent * evt)
@@ -129,13 +120,14 @@ void ScrollbarAddress::mouseMoveEvent(QMouseEvent * evt)
 {
   if (evt->buttons() & Qt::LeftButton)
   {
-    auto pos = static_cast<int>(static_cast<medusa::u64>(evt->y()) * _maxPos / _img.height());
+    if (evt->y() < 0 || _img.height() == 0)
+      return;
+    auto pos = static_cast<medusa::u32>(static_cast<medusa::u64>(evt->y()) * _maxPos / _img.height());
     medusa::Address addr;
-    if (!_core.GetDocument().ConvertPositionToAddress(pos, addr))
+    medusa::u16 lineOff;
+    if (!_lineIdx.ConvertLineToAddress(pos, addr, lineOff))
       return;
     _currPos = pos;
-    if (!m_rDoc.GetNearestAddress(addr, addr))
-      return;
     emit goTo(addr);
     emit updated();
   }
@@ -143,10 +135,25 @@ void ScrollbarAddress::mouseMoveEvent(QMouseEvent * evt)
 
 void ScrollbarAddress::setCurrentAddress(medusa::Address const& addr)
 {
-  if (_core.GetDocument().ConvertAddressToPosition(addr, _currPos))
+  if (_lineIdx.ConvertAddressToLine(addr, _currPos))
     emit updated();
 }
 
+void ScrollbarAddress::_DrawBucket(QPainter& p, medusa::u32 bucketIdx)
+{
+  medusa::Overview::Bucket bkt;
+  if (!_overview.GetBucket(bucketIdx, bkt))
+    return;
+
+  // A bucket can be smaller than a row of pixels if the document is tiny
+  medusa::u64 bktNo = _overview.GetNumberOfBuckets();
+  int y0 = static_cast<int>(static_cast<medusa::u64>(bucketIdx) * _img.height() / bktNo);
+  int y1 = static_cast<int>(static_cast<medusa::u64>(bucketIdx + 1) * _img.height() / bktNo);
+  p.setPen(_CellTypeToColor(bkt.GetMainCellType()));
+  for (int y = y0; y < std::max(y1, y0 + 1); ++y)
+    p.drawLine(0, y, _width * 3, y); // LATER: figure out why we've to * 3 ?!?
+}
+
 QColor const& ScrollbarAddress::_CellTypeToColor(medusa::u8 CellType) const
 {
   static const QColor s_InsClr(0x01, 0xa9, 0xdb);
@@ -7,6 +7,10 @@
 # include <medusa/address.hpp>
 # include <medusa/medusa.hpp>
 # include <medusa/view.hpp>
+# include <medusa/line_index.hpp>
+# include <medusa/overview.hpp>
+
+# include <atomic>
 
 class ScrollbarAddress : public QWidget, public medusa::View
 {
@@ -16,6 +20,7 @@ public:
   ScrollbarAddress(QWidget * parent, medusa::Medusa & core);
   virtual ~ScrollbarAddress(void);
 
+  virtual void OnMemoryAreaUpdated(medusa::MemoryArea const& rMemArea, bool Removed);
   virtual void OnAddressUpdated(medusa::Address::List const& rAddressList);
 
   void Refresh(void);
@@ -35,9 +40,14 @@ signals:
 
 private:
   QColor const& _CellTypeToColor(medusa::u8 CellType) const;
+  void          _DrawBucket(QPainter& p, medusa::u32 bucketIdx);
 
   medusa::Medusa&       _core;
+  medusa::LineIndex     _lineIdx;
+  medusa::Overview      _overview;
   QPixmap               _img;
+  medusa::Address       _lastAddr;
+  std::atomic<bool>     _needRefresh;
   medusa::u32           _lastPos;
   medusa::u32           _currPos;
   medusa::u32           _maxPos;
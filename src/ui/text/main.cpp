@@ -5,6 +5,11 @@
 #include <exception>
 #include <stdexcept>
 #include <limits>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string/join.hpp>
 #include <boost/filesystem/path.hpp>
@@ -18,9 +23,13 @@
 #include <medusa/log.hpp>
 #include <medusa/event_handler.hpp>
 #include <medusa/disassembly_view.hpp>
+#include <medusa/line_cache.hpp>
+#include <medusa/listing_exporter.hpp>
+#include <medusa/overview.hpp>
 #include <medusa/view.hpp>
 #include <medusa/module.hpp>
 #include <medusa/user_configuration.hpp>
+#include <medusa/binary_diff.hpp>
 
 MEDUSA_NAMESPACE_USE
 
@@ -33,11 +42,68 @@ public:
 
   void Print(void)
   {
-    std::cout << m_PrintData.GetTexts() << std::endl;
+    // Only lines of the view are printed, the next one starts right after them
+    size_t first = m_Top.m_yAddressOffset;
+    size_t last  = first + m_Height;
+    size_t cur   = 0;
+    m_PrintData.ForEachLine([&](Address const&, TextView const& text, Mark::View const&)
+    {
+      if (cur >= first && cur < last)
+        std::cout << text;
+      ++cur;
+    });
+    std::cout << std::endl;
   }
 
 };
 
+// Does the same work as the qt views on each notification, so the cost of notifications
+// during the analysis can be measured without a display
+class BenchViews : public View
+{
+public:
+  BenchViews(Document& rDoc)
+    : View(Document::Subscriber::MemoryAreaUpdated | Document::Subscriber::AddressUpdated | Document::Subscriber::LabelUpdated, rDoc)
+    , m_Overview(rDoc)
+    , m_NotificationNo(0)
+  {}
+
+  virtual void OnMemoryAreaUpdated(MemoryArea const& rMemArea, bool Removed)
+  {
+    m_Overview.Invalidate();
+    ++m_NotificationNo;
+  }
+
+  virtual void OnAddressUpdated(Address::List const& rAddressList)
+  {
+    // The scrollbar and the disassembly view are repainted
+    std::vector<u32> changed_bkts;
+    m_Overview.Update(rAddressList);
+    m_Overview.GetChangedBuckets(changed_bkts);
+    m_LineCache.Invalidate(rAddressList);
+    ++m_NotificationNo;
+  }
+
+  virtual void OnLabelUpdated(Address const& rAddress, Label const& rLabel, bool Removed)
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (Removed)
+      m_Labels.erase(rAddress);
+    else
+      m_Labels[rAddress] = rLabel.GetName();
+    ++m_NotificationNo;
+  }
+
+  u64 GetNotificationNo(void) const { return m_NotificationNo; }
+
+private:
+  Overview                       m_Overview;
+  LineCache                      m_LineCache;
+  std::map<Address, std::string> m_Labels;
+  std::mutex                     m_Mutex;
+  std::atomic<u64>               m_NotificationNo;
+};
+
 std::ostream& operator<<(std::ostream& out, std::pair<u32, std::string> const& p)
 {
   out << p.second;
@@ -95,7 +161,7 @@ struct AskForConfiguration : public boost::static_visitor<>
 
       if (Result == "false" || Result == "true")
       {
-        m_rCfgMdl.SetEnum(rBool.GetName(), !!(Result == "true"));
+        m_rCfgMdl.SetBoolean(rBool.GetName(), Result == "true");
         return;
       }
 
@@ -104,7 +170,7 @@ struct AskForConfiguration : public boost::static_visitor<>
 
       if (Choose == 0 || Choose == 1)
       {
-        m_rCfgMdl.SetEnum(rBool.GetName(), Choose ? true : false);
+        m_rCfgMdl.SetBoolean(rBool.GetName(), Choose ? true : false);
         return;
       }
     }
@@ -252,8 +318,18 @@ int main(int argc, char **argv)
   fs::path file_path;
   fs::path db_path;
   fs::path mod_path;
+  fs::path diff_file_path;
+  fs::path diff_db_path;
 
   bool auto_cfg = false;
+  bool bench_scroll = false;
+  bool bench_format = false;
+  bool bench_analysis = false;
+  bool attach_views = false;
+  u32 notify_delay = ChangeJournal::DefaultDelay;
+  u32 timeout = 0;
+  fs::path export_path;
+  std::string export_fmt = "text";
 
   // TODO: implement database loading...
   namespace po = boost::program_options;
@@ -263,6 +339,17 @@ int main(int argc, char **argv)
     ("exec", po::value<fs::path>(&file_path)->required(), "executable path")
     ("db", po::value<fs::path>(&db_path)->required(), "database path")
     ("auto", "configure module automatically")
+    ("diff", po::value<fs::path>(&diff_file_path), "compare functions with another version of the executable")
+    ("diff-db", po::value<fs::path>(&diff_db_path), "database path of the other executable")
+    ("bench-scroll", "scroll the whole disassembly without printing it and report timings")
+    ("bench-format", "format the whole disassembly without cache and report the number of lines per second")
+    ("export", po::value<fs::path>(&export_path), "write the whole disassembly to a file instead of printing it")
+    ("export-format", po::value<std::string>(&export_fmt), "format of the exported file: text (default) or jsonl")
+    ("coverage", "print the number of bytes of each cell type")
+    ("notify-delay", po::value<u32>(&notify_delay), "delay in ms between document notifications, 0 notifies each change")
+    ("bench-analysis", "report the analysis time and the number of notifications")
+    ("attach-views", "attach views which do the same work as the qt ones during the analysis")
+    ("timeout", po::value<u32>(&timeout), "cancel each analysis task after this number of seconds")
     ;
   po::variables_map var_map;
 
@@ -291,19 +378,23 @@ int main(int argc, char **argv)
     if (var_map.count("auto"))
       auto_cfg = true;
 
+    if (var_map.count("bench-scroll"))
+      bench_scroll = true;
+
+    if (var_map.count("bench-format"))
+      bench_format = true;
+
+    if (var_map.count("bench-analysis"))
+      bench_analysis = true;
+
+    if (var_map.count("attach-views"))
+      attach_views = true;
+
     Log::Write("ui_text") << "Analyzing the following file: \"" << file_path.string() << "\"" << LogEnd;
     Log::Write("ui_text") << "Database will be saved to the file: \"" << db_path.string() << "\"" << LogEnd;
     Log::Write("ui_text") << "Using the following path for modules: \"" << mod_path.string() << "\"" << LogEnd;
 
-    Medusa m;
-    if (!m.NewDocument(
-      std::make_shared<FileBinaryStream>(file_path),
-      [&](boost::filesystem::path& rDatabasePath, std::list<Medusa::Filter> const& rExtensionFilter)
-    {
-      rDatabasePath = db_path;
-      return true;
-    },
-      [&](
+    auto configure_document = [&](
       BinaryStream::SPType& rspBinStrm,
       Database::SPType& rspDatabase,
       Loader::SPType& rspLoader,
@@ -347,7 +438,8 @@ int main(int argc, char **argv)
 
       std::cout << std::endl;
 
-      ConfigurationModel CfgMdl;
+      // Options of the loader, e.g. the streaming of raw images
+      ConfigurationModel& CfgMdl = rspLoader->GetConfigurationModel();
 
       if (!auto_cfg)
       {
@@ -374,16 +466,177 @@ int main(int argc, char **argv)
         rspDatabase = AskForDb(mod_mgr.GetDatabases());
       }
 
+      return true;
+    };
+
+    Medusa m;
+    m.GetDocument().GetChangeJournal().SetDelay(notify_delay);
+    std::unique_ptr<BenchViews> bench_views;
+    if (attach_views)
+      bench_views.reset(new BenchViews(m.GetDocument()));
+
+    if (timeout != 0)
+      m.SetTasksTimeout(timeout);
+
+    auto analysis_start_time = std::chrono::steady_clock::now();
+    if (!m.NewDocument(
+      std::make_shared<FileBinaryStream>(file_path),
+      [&](boost::filesystem::path& rDatabasePath, std::list<Medusa::Filter> const& rExtensionFilter)
+    {
+      rDatabasePath = db_path;
       return true;
     },
+      configure_document,
       [](){ std::cout << "Analyzing..." << std::endl; return true; },
       [](){ return true; }))
       throw std::runtime_error("failed to create new document");
 
     m.WaitForTasks();
 
+    if (bench_analysis)
+    {
+      auto analysis_end_time = std::chrono::steady_clock::now();
+      auto const& journal = m.GetDocument().GetChangeJournal();
+      std::cout
+        << "analysis: " << std::chrono::duration_cast<std::chrono::milliseconds>(analysis_end_time - analysis_start_time).count() << "ms"
+        << ", " << journal.GetChangeNo() << " change(s)"
+        << " delivered in " << journal.GetBatchNo() << " batch(es)";
+      if (bench_views)
+        std::cout << ", " << bench_views->GetNotificationNo() << " view notification(s)";
+      else
+        std::cout << ", no view attached";
+      std::cout << std::endl;
+    }
+
+    if (!diff_file_path.empty())
+    {
+      if (diff_db_path.empty())
+        diff_db_path = diff_file_path.string() + ".mdb";
+
+      Log::Write("ui_text") << "Comparing with the following file: \"" << diff_file_path.string() << "\"" << LogEnd;
+
+      Medusa diff_m;
+      if (!diff_m.NewDocument(
+        std::make_shared<FileBinaryStream>(diff_file_path),
+        [&](boost::filesystem::path& rDatabasePath, std::list<Medusa::Filter> const& rExtensionFilter)
+      {
+        rDatabasePath = diff_db_path;
+        return true;
+      },
+        configure_document,
+        [](){ std::cout << "Analyzing..." << std::endl; return true; },
+        [](){ return true; }))
+        throw std::runtime_error("failed to create new document");
+
+      diff_m.WaitForTasks();
+
+      BinaryDiff diff(m.GetDocument(), diff_m.GetDocument());
+      if (!diff.Compute())
+        throw std::runtime_error("failed to compare documents");
+      diff.Report(std::cout);
+      return EXIT_SUCCESS;
+    }
+
+    if (var_map.count("coverage"))
+    {
+      static char const* s_cell_type_names[] = { "unknown", "instruction", "value", "character", "string" };
+      Overview overview(m.GetDocument());
+      auto stats = overview.GetStatistics();
+      u64 total_size = stats.GetSize();
+      for (u8 cell_type = 0; cell_type < Overview::CellTypeNo; ++cell_type)
+      {
+        u64 cell_size = stats.m_Sizes[cell_type];
+        std::cout
+          << std::setw(12) << std::left << s_cell_type_names[cell_type]
+          << std::setw(12) << std::right << cell_size << " byte(s) "
+          << std::setw(6) << std::fixed << std::setprecision(2)
+          << (total_size ? cell_size * 100.0 / total_size : 0.0) << "%"
+          << std::endl;
+      }
+      std::cout << std::setw(12) << std::left << "total" << std::setw(12) << std::right << total_size << " byte(s)" << std::endl;
+      return EXIT_SUCCESS;
+    }
+
+    if (!export_path.empty())
+    {
+      ListingExporter::OutputType export_type;
+      if (export_fmt == "text")
+        export_type = ListingExporter::TextOutput;
+      else if (export_fmt == "jsonl")
+        export_type = ListingExporter::JsonLinesOutput;
+      else
+        throw std::runtime_error("unknown export format: " + export_fmt);
+
+      ListingExporter exporter(m, FormatDisassembly::ShowAddress | FormatDisassembly::AddSpaceBeforeXref);
+      auto start_time = std::chrono::steady_clock::now();
+      if (!exporter.Export(export_path, export_type))
+        throw std::runtime_error("failed to export disassembly to " + export_path.string());
+      auto end_time = std::chrono::steady_clock::now();
+      auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+      u64 line_cnt = exporter.GetNumberOfLines();
+      std::cout
+        << "export: " << line_cnt << " line(s)"
+        << " in " << elapsed_ms << "ms"
+        << ", " << (elapsed_ms ? line_cnt * 1000 / elapsed_ms : line_cnt) << " line(s)/s"
+        << std::endl;
+      return EXIT_SUCCESS;
+    }
+
     int step = 100;
     TextFullDisassemblyView tfdv(m, FormatDisassembly::ShowAddress | FormatDisassembly::AddSpaceBeforeXref, 80, step, m.GetDocument().GetStartAddress());
+
+    if (bench_scroll)
+    {
+      // The first pass fills the line cache, the second one should only replay it
+      for (int pass = 0; pass < 2; ++pass)
+      {
+        tfdv.GoTo(m.GetDocument().GetFirstAddress(), false);
+        tfdv.Refresh();
+        auto const& cache = tfdv.GetLineCache();
+        u64 hit_cnt = cache.GetHitCount(), miss_cnt = cache.GetMissCount();
+        u32 move_cnt = 0;
+        auto start_time = std::chrono::steady_clock::now();
+        while (tfdv.MoveView(0, 1))
+          ++move_cnt;
+        auto end_time = std::chrono::steady_clock::now();
+        std::cout
+          << "scroll pass " << pass << ": " << move_cnt << " line(s)"
+          << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() << "ms"
+          << ", cache hit: " << (cache.GetHitCount() - hit_cnt)
+          << ", miss: " << (cache.GetMissCount() - miss_cnt)
+          << ", cached lines: " << cache.GetLiveLineNo()
+          << std::endl;
+      }
+      return EXIT_SUCCESS;
+    }
+
+    if (bench_format)
+    {
+      // The same PrintData is reused for each chunk, like a view does when it's refreshed
+      u32 const flags = FormatDisassembly::ShowAddress | FormatDisassembly::AddSpaceBeforeXref;
+      PrintData print;
+      FormatDisassembly fmt(m, print);
+      Address cur_addr = m.GetDocument().GetFirstAddress();
+      u64 line_cnt = 0;
+      auto start_time = std::chrono::steady_clock::now();
+      for (;;)
+      {
+        fmt(cur_addr, flags, 0x100);
+        line_cnt += print.GetNumberOfLines();
+        Address last_addr;
+        if (!print.GetLastAddress(last_addr) || !m.GetDocument().GetNextAddress(last_addr, cur_addr))
+          break;
+      }
+      auto end_time = std::chrono::steady_clock::now();
+      auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+      std::cout
+        << "format: " << line_cnt << " line(s)"
+        << " in " << elapsed_ms << "ms"
+        << ", " << (elapsed_ms ? line_cnt * 1000 / elapsed_ms : line_cnt) << " line(s)/s"
+        << std::endl;
+      return EXIT_SUCCESS;
+    }
+
     do tfdv.Print();
     while (tfdv.MoveView(0, step));
   }